@@ -240,8 +240,9 @@ void SVNRepos::dump(File &path, OutputStream &dataOut,
                      " (%ld)"), youngest), );
     }
 
-  SVN_JNI_ERR(svn_repos_dump_fs4(repos, dataOut.getStream(requestPool),
+  SVN_JNI_ERR(svn_repos_dump_fs5(repos, dataOut.getStream(requestPool),
                                  lower, upper, incremental, useDeltas,
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE,
                                  true, true,
                                  notifyCallback != NULL
                                     ? ReposNotifyCallback::notify
@@ -641,9 +642,10 @@ SVNRepos::verify(File &path, Revision &revisionStart, Revision &revisionEnd,
       (SVN_ERR_INCORRECT_PARAMS, NULL,
        _("Start revision cannot be higher than end revision")), );
 
-  SVN_JNI_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_JNI_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                    checkNormalization,
                                    metadataOnly,
+                                   1,
                                    (!notifyCallback ? NULL
                                     : ReposNotifyCallback::notify),
                                    notifyCallback,
@@ -669,7 +671,7 @@ void SVNRepos::pack(File &path, ReposNotifyCallback *notifyCallback)
                               path.getInternalStyle(requestPool), NULL,
                               requestPool.getPool(), requestPool.getPool()), );
 
-  SVN_JNI_ERR(svn_repos_fs_pack2(repos,
+  SVN_JNI_ERR(svn_repos_fs_pack3(repos, 1,
                                  notifyCallback != NULL
                                     ? ReposNotifyCallback::notify
                                     : NULL,
@@ -110,6 +110,11 @@ typedef svn_error_t *(*svn_cache__error_handler_t)(svn_error_t *err,
  */
 typedef struct svn_memcache_t svn_memcache_t;
 
+/**
+ * An opaque structure representing a persistent, disk-backed cache store.
+ */
+typedef struct svn_cache__disk_t svn_cache__disk_t;
+
 /**
  * An opaque structure representing a membuffer cache object.
  */
@@ -120,6 +125,35 @@ typedef struct svn_membuffer_t svn_membuffer_t;
  */
 typedef struct svn_cache__t svn_cache__t;
 
+/**
+ * Access and fill level statistics of a single shard of a membuffer cache.
+ * See svn_cache__membuffer_cache_create().
+ */
+typedef struct svn_cache__shard_info_t
+{
+  /** Number of lookups issued by threads local to this shard.
+   */
+  apr_uint64_t gets;
+
+  /** Number of lookups that found their data in this shard, including
+   * those issued by threads local to other shards.
+   */
+  apr_uint64_t hits;
+
+  /** Number of lookups issued by threads local to this shard that found
+   * their data in another shard.
+   */
+  apr_uint64_t remote_hits;
+
+  /** Size of the data currently stored in this shard.
+   */
+  apr_uint64_t used_size;
+
+  /** Amount of memory reserved for cached data in this shard.
+   */
+  apr_uint64_t data_size;
+} svn_cache__shard_info_t;
+
 /**
  * A structure containing typical statistics about a given cache instance.
  * Use svn_cache__get_info() to get this data. Note that not all types
@@ -148,6 +182,12 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t failures;
 
+  /** Number of setter calls that have been ignored because the cache
+   * was full and the item did not seem worth evicting other entries.
+   * Always 0 for caches without an admission policy.
+   */
+  apr_uint64_t rejects;
+
   /** Size of the data currently stored in the cache.
    * May be 0 if that information is not available.
    */
@@ -179,6 +219,11 @@ typedef struct svn_cache__info_t
    * highest array index.
    */
   apr_uint64_t histogram[32];
+
+  /** Per-shard statistics as an array of #svn_cache__shard_info_t.
+   * NULL if the cache has not been sharded.
+   */
+  apr_array_header_t *shards;
 } svn_cache__info_t;
 
 /**
@@ -270,6 +315,82 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
                                      apr_pool_t *result_pool,
                                      apr_pool_t *scratch_pool);
 
+/**
+ * Open the disk cache store in directory @a path, creating it if necessary,
+ * and return it in @a *disk_p.  The store keeps its data in an append-only
+ * log that will be reset once it would grow beyond @a max_size bytes.
+ *
+ * The contents survive process restarts and the store may be used by
+ * multiple processes at the same time.  Within a process, all calls for
+ * the same @a path return the same store, which lives until the process
+ * ends; @a max_size is only used by the first call.  Use @a scratch_pool
+ * for temporary allocations.
+ */
+svn_error_t *
+svn_cache__disk_open(svn_cache__disk_t **disk_p,
+                     const char *path,
+                     apr_uint64_t max_size,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_cache__disk_open() but always open a new store instance for
+ * @a path that is not shared with any other caller.  It will be closed
+ * when @a result_pool gets cleaned up.  Separate instances behave like
+ * separate processes using the same store, which is mainly useful for
+ * testing.
+ */
+svn_error_t *
+svn_cache__disk_open_private(svn_cache__disk_t **disk_p,
+                             const char *path,
+                             apr_uint64_t max_size,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/**
+ * Creates a new cache in @a *cache_p, storing its data in the disk cache
+ * store @a disk.  The elements in the cache will be indexed by keys of
+ * length @a klen, which may be APR_HASH_KEY_STRING if they are strings.
+ * Values will be serialized using @a serialize_func and deserialized using
+ * @a deserialize_func.  Because the same store may hold many different
+ * kinds of values, @a prefix should be specified to differentiate this
+ * cache from other caches.  Since the data is persistent, @a prefix must
+ * not depend on the process state.  @a *cache_p will be allocated in
+ * @a result_pool.
+ *
+ * If @a deserialize_func is NULL, then the data is returned as an
+ * svn_stringbuf_t; if @a serialize_func is NULL, then the data is
+ * assumed to be an svn_stringbuf_t.
+ *
+ * These caches are always thread safe.
+ *
+ * These caches do not support svn_cache__iter.
+ */
+svn_error_t *
+svn_cache__create_disk(svn_cache__t **cache_p,
+                       svn_cache__disk_t *disk,
+                       svn_cache__serialize_func_t serialize_func,
+                       svn_cache__deserialize_func_t deserialize_func,
+                       apr_ssize_t klen,
+                       const char *prefix,
+                       apr_pool_t *result_pool);
+
+/**
+ * Creates a new cache in @a *cache_p that combines the caches @a first
+ * and @a second, which must use the same key and value types.  Lookups
+ * will be tried in @a first and then in @a second.  Items found in
+ * @a second only will be copied to @a first.  New items will be written
+ * to both caches.  @a *cache_p will be allocated in @a result_pool.
+ *
+ * The result is thread safe if both underlying caches are.
+ *
+ * These caches do not support svn_cache__iter.
+ */
+svn_error_t *
+svn_cache__create_tiered(svn_cache__t **cache_p,
+                         svn_cache__t *first,
+                         svn_cache__t *second,
+                         apr_pool_t *result_pool);
+
 /**
  * Creates a new membuffer cache object in @a *cache. It will contain
  * up to @a total_size bytes of data, using @a directory_size bytes
@@ -288,6 +409,15 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
  * specific upper limit and the setting will be capped there automatically.
  * If the number is 0, a default will be derived from @a total_size.
  *
+ * On NUMA machines, @a shard_count should be set to the number of NUMA
+ * nodes.  The cache memory will then be split into that many independent
+ * shards, each one further divided into segments as described above.
+ * Threads write to and read from the shard local to the NUMA node that
+ * they are running on and will only look into other shards if the item
+ * could not be found locally.  The shard count will be reduced as
+ * necessary to give each shard a reasonable minimum size.  Values of 0
+ * and 1 as well as non-thread-safe caches disable sharding.
+ *
  * If access to the resulting cache object is guaranteed to be serialized,
  * @a thread_safe may be set to @c FALSE for maximum performance.
  *
@@ -306,10 +436,48 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   apr_size_t total_size,
                                   apr_size_t directory_size,
                                   apr_size_t segment_count,
+                                  apr_size_t shard_count,
                                   svn_boolean_t thread_safe,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place all cache data and
+ * management structures in a shared memory segment.  All processes forked
+ * from the current one after this call will share the same cache contents.
+ * Access is synchronized across threads and processes.  Writes will be
+ * skipped if the respective segment is currently locked.
+ *
+ * If @a shm_name is not @c NULL, it will be used as the file name that
+ * identifies the shared memory segment.  Otherwise, anonymous shared memory
+ * will be used, which is not supported on all platforms.  In either case,
+ * the segment can only be used by processes forked from the creator.
+ *
+ * Every child process must call svn_cache__membuffer_child_init() before
+ * accessing the cache.  Sharding is not supported for shared caches.
+ *
+ * Allocations will be made in @a result_pool, which must not be cleared
+ * or destroyed while any process uses the cache.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         const char *shm_name,
+                                         apr_pool_t *result_pool);
+
+/**
+ * Prepare the membuffer @a cache for use in a newly forked child process.
+ * This is a no-op for caches not created by
+ * svn_cache__membuffer_cache_create_shared() and for @a cache being
+ * @c NULL.  Use @a pool for allocations that must live as long as the
+ * child process.
+ */
+svn_error_t *
+svn_cache__membuffer_child_init(svn_membuffer_t *cache,
+                                apr_pool_t *pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -554,9 +722,27 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Create the process-global membuffer cache right away, using the current
+ * cache configuration, and place it in shared memory such that all
+ * processes forked from the current one will share it.  @a shm_name will
+ * be passed through to svn_cache__membuffer_cache_create_shared().
+ *
+ * This must be called before the global cache is being used for the first
+ * time.  Calling it again is a no-op.  If the configuration does not ask
+ * for a cache or if it can't be created, caching will be disabled.
+ *
+ * Child processes should call svn_cache__membuffer_child_init() with the
+ * result of svn_cache__get_global_membuffer_cache().
+ */
+svn_error_t *
+svn_cache__share_global_membuffer_cache(const char *shm_name);
+
 /**
  * Return total access and size stats over all membuffer caches as they
- * share the underlying data buffer.  The result will be allocated in POOL.
+ * share the underlying data buffer.  If the global membuffer cache has been
+ * sharded, per-shard statistics will be returned as well.  The result will
+ * be allocated in POOL.
  */
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
@@ -0,0 +1,106 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_cpu.h
+ * @brief Run-time detection of CPU features
+ */
+
+#ifndef SVN_CPU_H
+#define SVN_CPU_H
+
+#include <apr.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Hot loops, e.g. in the delta and checksum code, may provide alternative
+ * implementations that use vector instructions not available on every CPU
+ * of the target architecture.  Those implementations get compiled with the
+ * respective instruction set enabled for the individual function only and
+ * are selected at run-time based on svn_cpu__features().
+ *
+ * @defgroup svn_cpu CPU feature detection
+ * @{
+ */
+
+/** Non-zero if the compiler supports x86 vector intrinsics for functions
+ * that are compiled for an instruction set beyond the default target.
+ */
+#if (   defined(__x86_64__) || defined(_M_X64) \
+     || defined(__i386__) || defined(_M_IX86)) \
+    && (   defined(_MSC_VER) || defined(__clang__) \
+        || (defined(__GNUC__) \
+            && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define SVN_CPU__X86_SIMD 1
+#else
+#define SVN_CPU__X86_SIMD 0
+#endif
+
+/** Mark the following function definition as being compiled for the
+ * instruction set extensions given in the string literal @a features,
+ * e.g. "sse2" or "avx2".  The function must only be called if
+ * svn_cpu__features() reports all of them as available.
+ */
+#if SVN_CPU__X86_SIMD && !defined(_MSC_VER)
+#define SVN_CPU__TARGET(features) __attribute__((target(features)))
+#else
+#define SVN_CPU__TARGET(features)
+#endif
+
+/** @name CPU feature flags as returned by svn_cpu__features().
+ * @{
+ */
+#define SVN_CPU__SSE2   0x0001
+#define SVN_CPU__AVX2   0x0002
+/** SHA extensions plus the SSSE3 and SSE4.1 instructions used with them. */
+#define SVN_CPU__SHA    0x0004
+#define SVN_CPU__SSSE3  0x0008
+/** @} */
+
+/** Return the set of CPU features that are supported by the processor and
+ * the OS and that have not been disabled by svn_cpu__set_features_mask().
+ * Returns 0 on architectures without any known optional features.
+ *
+ * This function is cheap to call and thread-safe.
+ */
+apr_uint32_t
+svn_cpu__features(void);
+
+/** Restrict the set of CPU features reported by svn_cpu__features() to
+ * those in @a mask.  This is meant for tests and benchmarks that want to
+ * compare the results of different implementations.  Pass ~0 to enable
+ * all features again.
+ */
+void
+svn_cpu__set_features_mask(apr_uint32_t mask);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_CPU_H */
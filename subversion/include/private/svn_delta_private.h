@@ -33,6 +33,7 @@
 #include "svn_error.h"
 #include "svn_delta.h"
 #include "svn_editor.h"
+#include "private/svn_subr_private.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -108,6 +109,141 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Like svn_txdelta__read_raw_window_len() but also return the length of
+    the window's source view in @a *sview_len.  If that is 0, the window
+    does not depend on any source data. */
+svn_error_t *
+svn_txdelta__read_raw_window_header(apr_size_t *window_len,
+                                    apr_size_t *sview_len,
+                                    svn_stream_t *stream,
+                                    apr_pool_t *pool);
+
+/** Callback type used to find the zstd dictionary with the given
+ * @a dict_id when reading svndiff version 4 data.  Return it in @a *dict.
+ * @a baton is the baton given to svn_txdelta__read_svndiff_window_dict().
+ * The dictionary must remain valid at least as long as the windows read.
+ * Use @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_txdelta__dict_func_t)(const svn__zstd_dict_t **dict,
+                            void *baton,
+                            apr_uint32_t dict_id,
+                            apr_pool_t *scratch_pool);
+
+/** Similar to svn_txdelta_read_svndiff_window() but use @a dict_func with
+ * @a dict_baton to find the dictionaries for svndiff version 4 data that
+ * has been compressed against one.  If @a dict_func is @c NULL, such data
+ * cannot be read.
+ */
+svn_error_t *
+svn_txdelta__read_svndiff_window_dict(svn_txdelta_window_t **window,
+                                      svn_stream_t *stream,
+                                      int svndiff_version,
+                                      svn_txdelta__dict_func_t dict_func,
+                                      void *dict_baton,
+                                      apr_pool_t *pool);
+
+/** Parse the header of the unparsed svndiff version @a svndiff_version
+ * window @a raw_window, as read after svn_txdelta__read_raw_window_len(),
+ * and return the IDs of the zstd dictionaries that its instructions and
+ * new data sections have been compressed against in @a *ins_dict_id and
+ * @a *new_dict_id, respectively.  Either will be 0 if the section does
+ * not require a dictionary, which is always the case for versions other
+ * than 4.  This allows callers to resolve the dictionaries up-front, e.g.
+ * before handing the window to another thread.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_txdelta__svndiff_window_dict_ids(apr_uint32_t *ins_dict_id,
+                                     apr_uint32_t *new_dict_id,
+                                     const svn_string_t *raw_window,
+                                     int svndiff_version,
+                                     apr_pool_t *scratch_pool);
+
+/** Similar to svn_txdelta_to_svndiff3() but compress up to
+ * @a thread_count windows in parallel worker threads.  The output is the
+ * same as with svn_txdelta_to_svndiff3().  A @a thread_count of less than
+ * 2 or svndiff version 0 select the serial encoder.
+ *
+ * To keep the threads busy, the handler collects a few windows per thread
+ * before compressing and writing them.  This increases memory usage
+ * accordingly and delays the output.
+ *
+ * If @a svndiff_version is 4 and @a dict is not @c NULL, compress all data
+ * against @a dict, which must remain valid until the handler has been
+ * called with a @c NULL window.  The resulting data can only be read by
+ * svn_txdelta__read_svndiff_window_dict() with a matching dictionary
+ * callback.  This is meant for repository-internal storage only.
+ */
+void
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 const svn__zstd_dict_t *dict,
+                                 int thread_count,
+                                 apr_pool_t *pool);
+
+/** Similar to svn_txdelta_target_push() but produce windows suitable for
+ * svndiff version 3, i.e. with target views of up to 1 MB and source views
+ * of up to 4 MB that slide along with the data in @a source that matched
+ * the target data most recently.  This allows for effective deltification
+ * even if large amounts of data have been inserted or removed.
+ *
+ * Consequently, the source views of consecutive windows may overlap or
+ * leave gaps in between.  The windows can still be processed by e.g.
+ * svn_txdelta_apply() but their source views do not line up with the
+ * target views of the previous delta in a chain.
+ */
+svn_stream_t *
+svn_txdelta__target_push_sliding(svn_txdelta_window_handler_t handler,
+                                 void *handler_baton,
+                                 svn_stream_t *source,
+                                 apr_pool_t *pool);
+
+/** Output buffers passed to svn_txdelta__apply_window() should provide
+ * this many bytes beyond the target view.  That allows for faster copying
+ * of short instructions near the end of the window.
+ */
+#define SVN_TXDELTA__APPLY_PADDING 16
+
+/** Apply the instructions from @a window to the source view @a sbuf of
+ * @a sbuf_len bytes and write the target view directly to @a tbuf, which
+ * has room for @a tbuf_size bytes.  @a tbuf_size must not be less than
+ * @a window->tview_len; any bytes beyond the target view may be
+ * overwritten.  @a sbuf may be @c NULL if @a sbuf_len is 0.
+ *
+ * Unlike svn_txdelta_apply_instructions(), validate all instructions
+ * against the buffers first and return #SVN_ERR_SVNDIFF_INVALID_OPS if
+ * they are out of bounds or don't produce exactly the target view.
+ */
+svn_error_t *
+svn_txdelta__apply_window(const svn_txdelta_window_t *window,
+                          const char *sbuf,
+                          apr_size_t sbuf_len,
+                          char *tbuf,
+                          apr_size_t tbuf_size);
+
+/** Compose the chain of delta @a windows, an array of
+ * <tt>const svn_txdelta_window_t *</tt>, into a single window and return
+ * it allocated in @a result_pool.  The first element is the oldest delta,
+ * i.e. it applies to the source data, and the source view of every other
+ * element is the target view of its predecessor.  @a windows must not be
+ * empty.
+ *
+ * The result is the same as folding the chain with
+ * svn_txdelta_compose_windows(), starting with the newest two windows.
+ * However, all steps share their internal index structures, only two
+ * intermediate windows exist at any time, and the composition stops
+ * early as soon as the composite does not refer to its source anymore.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_txdelta_window_t *
+svn_txdelta__compose_windows_n(const apr_array_header_t *windows,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
@@ -39,6 +39,8 @@
 #include "svn_config.h"
 #include "svn_string.h"
 
+#include "private/svn_cache.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -200,6 +202,9 @@ typedef struct svn_fs_fs__stats_t
   /* stats on all directory prop representations */
   svn_fs_fs__representation_stats_t dir_prop_rep_stats;
 
+  /* stats on all chunks of large file representations */
+  svn_fs_fs__representation_stats_t chunk_rep_stats;
+
   /* size and count summary over all noderevs */
   svn_fs_fs__node_stats_t total_node_stats;
 
@@ -364,6 +369,20 @@ typedef struct svn_fs_fs__ioctl_build_rep_cache_input_t
 /* See svn_fs_fs__build_rep_cache(). */
 SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_BUILD_REP_CACHE, SVN_FS_TYPE_FSFS, 1004);
 
+typedef struct svn_fs_fs__ioctl_get_disk_cache_output_t
+{
+  /* The persistent cache store configured in fsfs.conf.  May be NULL. */
+  svn_cache__disk_t *disk_cache;
+
+  /* The instance ID of the filesystem.  Keys in DISK_CACHE should include
+   * it to not clash with a recreated repository of the same UUID. */
+  const char *instance_id;
+} svn_fs_fs__ioctl_get_disk_cache_output_t;
+
+/* Return the persistent cache store of the filesystem, allowing other
+ * layers to put their own data into it. */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_GET_DISK_CACHE, SVN_FS_TYPE_FSFS, 1005);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -379,7 +379,11 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
  * as @c NULL.
  *
  * In contrast to the dump editor used inside svn_repos_dump_fs4(), this
- * one supports only deltas mode.
+ * one supports only deltas mode.  If @a compression_level is
+ * #SVN_DELTA_COMPRESSION_LEVEL_NONE, the deltas will be written as
+ * uncompressed svndiff version 0.  Otherwise, they will be compressed
+ * with zstd at that level (svndiff version 4), using up to
+ * @a thread_count threads.
  *
  * ### TODO: Unify with the dump editor inside svn_repos_dump_fs4().
  */
@@ -388,6 +392,8 @@ svn_repos__get_dump_editor(const svn_delta_editor_t **editor,
                            void **edit_baton,
                            svn_stream_t *stream,
                            const char *update_anchor_relpath,
+                           int compression_level,
+                           int thread_count,
                            apr_pool_t *pool);
 
 #ifdef __cplusplus
@@ -295,6 +295,64 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
                                            svn_stream_t *inner_stream,
                                            apr_pool_t *pool);
 
+/**
+ * Opaque context that calculates the MD5 and, optionally, the SHA1
+ * checksum over the same data.  Unlike two separate #svn_checksum_ctx_t,
+ * it updates both checksums piece by piece while the data is still in
+ * the CPU cache.
+ */
+typedef struct svn_checksum__md5_sha1_ctx_t svn_checksum__md5_sha1_ctx_t;
+
+/**
+ * Return a new context for the MD5 and, if @a with_sha1 is set, the SHA1
+ * checksum.  Allocate it in @a pool.
+ */
+svn_checksum__md5_sha1_ctx_t *
+svn_checksum__md5_sha1_ctx_create(svn_boolean_t with_sha1,
+                                  apr_pool_t *pool);
+
+/**
+ * Reset @a ctx to the checksums of no data.
+ */
+void
+svn_checksum__md5_sha1_ctx_reset(svn_checksum__md5_sha1_ctx_t *ctx);
+
+/**
+ * Feed @a len bytes from @a data into both checksums in @a ctx.
+ */
+svn_error_t *
+svn_checksum__md5_sha1_update(svn_checksum__md5_sha1_ctx_t *ctx,
+                              const void *data,
+                              apr_size_t len);
+
+/**
+ * Return the checksums over all data fed into @a ctx in @a *md5_checksum
+ * and @a *sha1_checksum, allocated in @a pool.  Either output parameter
+ * may be @c NULL.  If @a ctx does not calculate SHA1, @a *sha1_checksum
+ * will be set to @c NULL.  @a ctx itself remains unchanged.
+ */
+svn_error_t *
+svn_checksum__md5_sha1_final(svn_checksum_t **md5_checksum,
+                             svn_checksum_t **sha1_checksum,
+                             const svn_checksum__md5_sha1_ctx_t *ctx,
+                             apr_pool_t *pool);
+
+/**
+ * Return a stream that calculates the MD5 and SHA1 checksums over all
+ * data written to the @a inner_stream in a single pass.  When the returned
+ * stream gets closed, write the checksums to @a *md5_checksum and
+ * @a *sha1_checksum, either of which may be @c NULL.
+ * Allocate the result in @a pool.
+ *
+ * @note The stream returned only supports #svn_stream_write,
+ * #svn_stream_close and, if @a inner_stream does, #svn_stream_reset.
+ */
+svn_stream_t *
+svn_checksum__wrap_write_stream_md5_sha1(svn_checksum_t **md5_checksum,
+                                         svn_checksum_t **sha1_checksum,
+                                         svn_stream_t *inner_stream,
+                                         apr_pool_t *pool);
+
 /**
  * Return a 32 bit FNV-1a checksum for the first @a len bytes in @a input.
  *
@@ -505,6 +563,16 @@ svn_version__at_least(const svn_version_t *version,
 /* Slowest, best compression method & level provided by zlib. */
 #define SVN__COMPRESSION_ZLIB_MAX     9
 
+/* Fastest, least effective compression level provided by zstd. */
+#define SVN__COMPRESSION_ZSTD_MIN     1
+
+/* Default compression level provided by zstd. */
+#define SVN__COMPRESSION_ZSTD_DEFAULT 3
+
+/* Slowest, best compression level that we use with zstd.  Higher levels
+   exist but need much more memory for little gain on delta windows. */
+#define SVN__COMPRESSION_ZSTD_MAX     19
+
 /* Encode VAL into the buffer P using the variable-length 7b/8b unsigned
    integer format.  Return the incremented value of P after the
    encoded bytes have been written.  P must point to a buffer of size
@@ -591,6 +659,89 @@ svn__decompress_lz4(const void *data, apr_size_t len,
                     svn_stringbuf_t *out,
                     apr_size_t limit);
 
+/* Return TRUE if this build of Subversion supports zstd compression.
+ * If it doesn't, svn__compress_zstd() and svn__decompress_zstd() will
+ * return SVN_ERR_UNSUPPORTED_FEATURE.
+ */
+svn_boolean_t
+svn__zstd_available(void);
+
+/* Same as svn__compress_zlib(), but use zstd compression with the given
+ * COMPRESSION_LEVEL, ranging from SVN__COMPRESSION_ZSTD_MIN to
+ * SVN__COMPRESSION_ZSTD_MAX.  SVN__COMPRESSION_NONE is valid for
+ * COMPRESSION_LEVEL as well.
+ */
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int compression_level);
+
+/* Same as svn__decompress_zlib(), but use zstd compression.
+ */
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit);
+
+/* Opaque zstd compression dictionary, prepared for use with
+ * svn__compress_zstd_dict() and svn__decompress_zstd_dict().  Instances
+ * are immutable and may be shared between threads.
+ */
+typedef struct svn__zstd_dict_t svn__zstd_dict_t;
+
+/* Train a zstd dictionary of at most MAX_SIZE bytes from SAMPLES, an array
+ * of svn_string_t *, and return its raw contents in *DICT.  Tag it with
+ * DICT_ID, which must not be 0.  If there is not enough sample data to
+ * train a useful dictionary, set *DICT to NULL.
+ *
+ * Allocate *DICT in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn__zstd_train_dict(svn_stringbuf_t **dict,
+                     const apr_array_header_t *samples,
+                     apr_size_t max_size,
+                     apr_uint32_t dict_id,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Prepare the dictionary CONTENTS as produced by svn__zstd_train_dict()
+ * for compression at COMPRESSION_LEVEL and for decompression.  Return the
+ * result in *DICT, allocated in RESULT_POOL.
+ */
+svn_error_t *
+svn__zstd_dict_create(svn__zstd_dict_t **dict,
+                      const svn_string_t *contents,
+                      int compression_level,
+                      apr_pool_t *result_pool);
+
+/* Return the ID that DICT has been tagged with. */
+apr_uint32_t
+svn__zstd_dict_id(const svn__zstd_dict_t *dict);
+
+/* Return the ID of the dictionary required to decompress DATA of LEN
+ * bytes, as produced by svn__compress_zstd_dict().  Return 0 if DATA does
+ * not need a dictionary, e.g. because it is not compressed at all.
+ */
+apr_uint32_t
+svn__zstd_get_dict_id(const void *data, apr_size_t len);
+
+/* Same as svn__compress_zstd() but compress against DICT, using the
+ * compression level that DICT has been created with.
+ */
+svn_error_t *
+svn__compress_zstd_dict(const void *data, apr_size_t len,
+                        svn_stringbuf_t *out,
+                        const svn__zstd_dict_t *dict);
+
+/* Same as svn__decompress_zstd() but use DICT, which must be the
+ * dictionary identified by svn__zstd_get_dict_id() for DATA.
+ */
+svn_error_t *
+svn__decompress_zstd_dict(const void *data, apr_size_t len,
+                          svn_stringbuf_t *out,
+                          apr_size_t limit,
+                          const svn__zstd_dict_t *dict);
+
 /** @} */
 
 /**
@@ -746,6 +897,14 @@ const char *svn_lz4__compiled_version(void);
  */
 int svn_lz4__runtime_version(void);
 
+/* Return the zstd version we compiled against or NULL if zstd support
+ * is not available. */
+const char *svn_zstd__compiled_version(void);
+
+/* Return the zstd version we run against or NULL if zstd support is not
+ * available. */
+const char *svn_zstd__runtime_version(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,223 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_task.h
+ * @brief Processing independent work items in parallel
+ */
+
+#ifndef SVN_TASK_H
+#define SVN_TASK_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+#include "svn_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Many operations, e.g. verifying or packing a repository, consist of a
+ * long sequence of independent work items whose results need to be
+ * reported in a well-defined order.  svn_task__run_ordered() processes
+ * these items in worker threads while the results get consumed in order
+ * by the calling thread.  A #svn_task__queue_t does the same for items
+ * that only become known one at a time.
+ *
+ * Neither the worker threads nor the consumer need to care about
+ * synchronization.  However, any state shared between work items must
+ * either be read-only or be synchronized by the caller.  Most notably,
+ * objects like #svn_fs_t are not thread-safe, so each worker thread
+ * should create its own instances through a
+ * #svn_task__thread_context_func_t.
+ *
+ * @defgroup svn_task Parallel processing of work items
+ * @{
+ */
+
+/**
+ * Callback function type that initializes the per-thread state for the
+ * work item processing.  Return that state in @a *thread_context.
+ * @a baton is the context baton given to svn_task__run_ordered().
+ *
+ * Allocate @a *thread_context in @a result_pool, which will be cleaned up
+ * after the respective thread finished all its work items.  Use
+ * @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_task__thread_context_func_t)(void **thread_context,
+                                   void *baton,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
+/**
+ * Callback function type that processes work item number @a index.
+ * @a baton is the process baton given to svn_task__run_ordered() and
+ * @a thread_context is the per-thread state as created by the respective
+ * #svn_task__thread_context_func_t or @c NULL if no such function has been
+ * provided.  Set @a *result to the output to pass to the
+ * #svn_task__output_func_t.  It may be @c NULL.
+ *
+ * Allocate @a *result in @a result_pool.  Use @a scratch_pool for
+ * temporary allocations.
+ *
+ * Returning an error will terminate the whole operation.  Implementations
+ * that want to report per-item failures should return them as part of
+ * @a *result instead.
+ */
+typedef svn_error_t *
+(*svn_task__process_func_t)(void **result,
+                            void *baton,
+                            void *thread_context,
+                            apr_int64_t index,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/**
+ * Callback function type that consumes the @a result of work item number
+ * @a index as returned by the #svn_task__process_func_t.  @a baton is the
+ * output baton given to svn_task__run_ordered().  Use @a scratch_pool for
+ * temporary allocations.
+ *
+ * Returning an error will terminate the whole operation.
+ */
+typedef svn_error_t *
+(*svn_task__output_func_t)(void *baton,
+                           void *result,
+                           apr_int64_t index,
+                           apr_pool_t *scratch_pool);
+
+/**
+ * Process the work items 0 .. @a count - 1 by calling @a process_func
+ * with @a process_baton for each of them, using up to @a thread_count
+ * worker threads.  Call @a output_func with @a output_baton for each
+ * result from the calling thread, strictly in the order of the item
+ * indexes.  @a output_func may be @c NULL.
+ *
+ * If @a context_func is not @c NULL, call it with @a context_baton once
+ * per worker thread and pass the result to all @a process_func calls in
+ * that thread.
+ *
+ * To limit memory usage, at most a small multiple of @a thread_count items
+ * will be processed ahead of the last item passed to @a output_func.
+ * If @a thread_count is less than 2 or APR does not support threads, all
+ * items will be processed sequentially in the calling thread.
+ *
+ * The first error returned by any callback will cancel the processing of
+ * the remaining items and will be returned.  @a cancel_func with
+ * @a cancel_baton will be polled periodically from the calling thread.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_task__run_ordered(apr_int64_t count,
+                      int thread_count,
+                      svn_task__process_func_t process_func,
+                      void *process_baton,
+                      svn_task__thread_context_func_t context_func,
+                      void *context_baton,
+                      svn_task__output_func_t output_func,
+                      void *output_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool);
+
+/**
+ * Opaque queue of work items for the case that the number of items is
+ * not known in advance, e.g. because they get produced by some callback
+ * driven from elsewhere.
+ */
+typedef struct svn_task__queue_t svn_task__queue_t;
+
+/**
+ * Create a work @a queue in @a result_pool that processes the items
+ * added by svn_task__queue_push() in up to @a thread_count worker threads
+ * and consumes their results in the calling thread, strictly in the order
+ * they were pushed.
+ *
+ * The parameters have the same meaning as for svn_task__run_ordered()
+ * with one exception: there is no separate process baton.  Instead,
+ * @a process_func will be called with the item passed to
+ * svn_task__queue_push() as its baton.
+ *
+ * Cleaning up @a result_pool will stop all worker threads, discarding
+ * any pending items.  Pre-cleanups make sure that this happens before any
+ * sub-pool of @a result_pool gets destroyed, so the items may safely
+ * reference data allocated in those.
+ */
+svn_error_t *
+svn_task__queue_create(svn_task__queue_t **queue,
+                       int thread_count,
+                       svn_task__process_func_t process_func,
+                       svn_task__thread_context_func_t context_func,
+                       void *context_baton,
+                       svn_task__output_func_t output_func,
+                       void *output_baton,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *result_pool);
+
+/**
+ * Add @a item to the end of @a queue.  @a item must remain valid until
+ * its result has been passed to the output function.
+ *
+ * If too many items are in flight already, this will first wait for the
+ * oldest one to complete and call the output function for it.  Without
+ * worker threads, @a item gets processed and its output consumed before
+ * this function returns.
+ *
+ * If this returns an error, @a queue has been stopped and must not be
+ * used anymore.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_task__queue_push(svn_task__queue_t *queue,
+                     void *item,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Wait for all items in @a queue to be processed and consume their
+ * results.  Unlike svn_task__queue_finish(), keep the worker threads
+ * running, so more items may be pushed afterwards.
+ *
+ * If this returns an error, @a queue has been stopped and must not be
+ * used anymore.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_task__queue_wait(svn_task__queue_t *queue,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Wait for all items in @a queue to be processed, consume their results
+ * and stop the worker threads.  @a queue must not be used afterwards.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_task__queue_finish(svn_task__queue_t *queue,
+                       apr_pool_t *scratch_pool);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TASK_H */
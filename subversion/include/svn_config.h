@@ -161,6 +161,10 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_MEMORY_CACHE_SIZE         "memory-cache-size"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_DIFF_IGNORE_CONTENT_TYPE  "diff-ignore-content-type"
+/** @since New in 1.15. */
+#define SVN_CONFIG_OPTION_BLAME_THREADS             "blame-threads"
+/** @since New in 1.15. */
+#define SVN_CONFIG_OPTION_SERVER_SIDE_BLAME         "server-side-blame"
 #define SVN_CONFIG_SECTION_TUNNELS              "tunnels"
 #define SVN_CONFIG_SECTION_AUTO_PROPS           "auto-props"
 /** @since New in 1.8. */
@@ -404,6 +404,15 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_LIST\
             SVN_DAV_PROP_NS_DAV "svn/list"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * 'blame' requests.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_DAV_NS_DAV_SVN_BLAME\
+            SVN_DAV_PROP_NS_DAV "svn/blame"
+
 /** Presence of this in a DAV header in an OPTIONS response indicates
  * that the transmitter (in this case, the server) knows how to handle
  * svndiff2 format encoding.
@@ -413,6 +422,15 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_SVNDIFF2\
             SVN_DAV_PROP_NS_DAV "svn/svndiff2"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * svndiff4 (zstd) format encoding.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_DAV_NS_DAV_SVN_SVNDIFF4\
+            SVN_DAV_PROP_NS_DAV "svn/svndiff4"
+
 /** Presence of this in a DAV header in an OPTIONS response indicates
  * that the transmitter (in this case, the server) sends the result
  * checksum in the response to a successful PUT request.
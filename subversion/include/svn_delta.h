@@ -526,7 +526,13 @@ svn_txdelta_apply(svn_stream_t *source,
  *
  * @since New in 1.7.  Since 1.10, @a svndiff_version can be 2 for the
  * svndiff2 format.  @a compression_level is currently ignored if
- * @a svndiff_version is set to 2.
+ * @a svndiff_version is set to 2.  Since 1.15, @a svndiff_version can be 3
+ * for the svndiff3 format, which is compressed like svndiff2 but permits
+ * windows with large and sliding source views, or 4 for the svndiff4
+ * format, which uses Zstandard compression.  In the latter case,
+ * @a compression_level selects the zstd compression level, with
+ * #SVN_DELTA_COMPRESSION_LEVEL_NONE disabling compression.  svndiff4 is
+ * only available if Subversion has been built with zstd support.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
@@ -487,6 +487,16 @@ typedef struct svn_diff_file_options_t
    *
    * @since New in 1.9 */
   int context_size;
+
+  /** Whether to use the histogram algorithm instead of the default Myers
+   * algorithm to match lines.  The histogram algorithm anchors the diff
+   * on lines that occur rarely in the original file and is much faster on
+   * large files with many repeated lines.  It also tends to produce more
+   * readable diffs for source code.  Only diffs between two and three
+   * files use it.  The default is @c FALSE.
+   *
+   * @since New in 1.15 */
+  svn_boolean_t histogram;
 } svn_diff_file_options_t;
 
 /** Allocate a @c svn_diff_file_options_t structure in @a pool, initializing
@@ -510,6 +520,7 @@ svn_diff_file_options_create(apr_pool_t *pool);
  * - --ignore-eol-style
  * - --show-c-function, -p @since New in 1.5.
  * - --context, -U ARG @since New in 1.9.
+ * - --histogram @since New in 1.15.
  * - --unified, -u (for compatibility, does nothing).
  */
 svn_error_t *
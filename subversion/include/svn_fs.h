@@ -3301,11 +3301,35 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
                                              apr_pool_t *pool);
 
 /**
- * Possibly update the filesystem located in the directory @a path
+ * Possibly update the filesystem located in the directory @a db_path
  * to use disk space more efficiently.
  *
+ * If @a jobs is larger than 1, backends that support it may process up
+ * to @a jobs parts of the filesystem, e.g. FSFS shards, in parallel.
+ * @a notify_func will still only be called from the calling thread.
+ * The start and the end notifications will each be sent in shard order
+ * but the processing of later shards may start before earlier ones
+ * complete.  @a cancel_func, however, may be called from multiple
+ * threads.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             int jobs,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a jobs set to 1.
+ *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
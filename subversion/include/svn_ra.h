@@ -37,6 +37,7 @@
 #include "svn_types.h"
 #include "svn_string.h"
 #include "svn_delta.h"
+#include "svn_diff.h"
 #include "svn_auth.h"
 #include "svn_mergeinfo.h"
 
@@ -1915,6 +1916,66 @@ svn_ra_get_file_revs(svn_ra_session_t *session,
                      void *handler_baton,
                      apr_pool_t *pool);
 
+/**
+ * Callback type to be used with svn_ra_blame().  It will be invoked for
+ * every run of lines that were last changed in the same revision.
+ *
+ * The run starts at line number @a start_line, counting from 0, and
+ * extends up to the start of the next run or, for the last one, to the
+ * end of the file.  @a revision is the revision in which these lines were
+ * last changed and @a rev_props contains its revision properties.  If the
+ * lines have not been changed since the start of the blamed revision
+ * range, @a revision will be #SVN_INVALID_REVNUM and @a rev_props will be
+ * @c NULL.
+ *
+ * @a baton is the user-provided receiver baton.  @a scratch_pool may be
+ * used for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *(* svn_ra_blame_receiver_t)(apr_int64_t start_line,
+                                                 svn_revnum_t revision,
+                                                 apr_hash_t *rev_props,
+                                                 void *baton,
+                                                 apr_pool_t *scratch_pool);
+
+/**
+ * Let the server calculate the blame information for file @a path as
+ * seen in revision @a end and report it to @a receiver with
+ * @a receiver_baton, ordered by line number.  Lines that have last been
+ * changed in a revision older than @a start will be reported as
+ * #SVN_INVALID_REVNUM.  @a start must not be larger than @a end.
+ *
+ * The lines of subsequent file revisions are matched using
+ * @a diff_options, which may be @c NULL to use the default options.  Only
+ * the @c ignore_space, @c ignore_eol_style and @c histogram options will
+ * be used.
+ *
+ * The result is the same as one would get by processing the output of
+ * svn_ra_get_file_revs2() for the same range without merged revisions on
+ * the client side.  The server, however, caches the line origins of all
+ * file revisions it has seen, which makes repeated requests much cheaper.
+ *
+ * @a path is interpreted relative to the URL in @a session.
+ *
+ * If the server doesn't support the 'blame' command, return
+ * #SVN_ERR_UNSUPPORTED_FEATURE in preference to any other error that
+ * might otherwise be returned.
+ *
+ * Use @a scratch_pool for temporary memory allocation.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_ra_blame(svn_ra_session_t *session,
+             const char *path,
+             svn_revnum_t start,
+             svn_revnum_t end,
+             const svn_diff_file_options_t *diff_options,
+             svn_ra_blame_receiver_t receiver,
+             void *receiver_baton,
+             apr_pool_t *scratch_pool);
+
 /**
  * Lock each path in @a path_revs, which is a hash whose keys are the
  * paths to be locked, and whose values are the corresponding base
@@ -2265,6 +2326,14 @@ svn_ra_has_capability(svn_ra_session_t *session,
  */
 #define SVN_RA_CAPABILITY_LIST "list"
 
+/**
+ * The capability of a server to calculate blame information, i.e. to
+ * understand the blame command.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_RA_CAPABILITY_BLAME "blame"
+
 
 /*       *** PLEASE READ THIS IF YOU ADD A NEW CAPABILITY ***
  *
@@ -35,6 +35,7 @@
 #include "svn_types.h"
 #include "svn_string.h"
 #include "svn_delta.h"
+#include "svn_diff.h"
 #include "svn_fs.h"
 #include "svn_io.h"
 #include "svn_mergeinfo.h"
@@ -728,10 +729,27 @@ svn_repos_hotcopy(const char *src_path,
 
 /**
  * Possibly update the repository, @a repos, to use a more efficient
- * filesystem representation.  Use @a pool for allocations.
+ * filesystem representation.  Use up to @a jobs threads if the backend
+ * supports that; see svn_fs_pack2().  Use @a pool for allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_fs_pack3(svn_repos_t *repos,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Like svn_repos_fs_pack3(), but with @a jobs set to 1.
  *
  * @since New in 1.7.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_fs_pack2(svn_repos_t *repos,
                    svn_repos_notify_func_t notify_func,
@@ -2464,6 +2482,67 @@ svn_repos_get_file_revs(svn_repos_t *repos,
                         void *handler_baton,
                         apr_pool_t *pool);
 
+/**
+ * Callback type to be used with svn_repos_blame().  It will be invoked
+ * for every run of lines that were last changed in the same revision.
+ *
+ * The run starts at line number @a start_line, counting from 0, and
+ * extends up to the start of the next run or, for the last one, to the
+ * end of the file.  @a revision is the revision in which these lines were
+ * last changed and @a rev_props contains its revision properties.  If the
+ * lines have not been changed since the start of the blamed revision
+ * range, @a revision will be #SVN_INVALID_REVNUM and @a rev_props will be
+ * @c NULL.
+ *
+ * @a baton is the user-provided receiver baton.  @a scratch_pool may be
+ * used for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *(* svn_repos_blame_receiver_t)(apr_int64_t start_line,
+                                                    svn_revnum_t revision,
+                                                    apr_hash_t *rev_props,
+                                                    void *baton,
+                                                    apr_pool_t *scratch_pool);
+
+/**
+ * Calculate the blame information for file @a path in @a repos as seen in
+ * revision @a end and report it to @a receiver with @a receiver_baton,
+ * ordered by line number.  Lines that have last been changed in a revision
+ * older than @a start will be reported as #SVN_INVALID_REVNUM.  Invalid
+ * revision numbers for @a start and @a end mean HEAD.  @a start must not
+ * be larger than @a end.
+ *
+ * The lines of subsequent file revisions are matched using @a diff_options,
+ * which may be @c NULL to use the default options.  Only those options
+ * that affect which lines are considered changed will be used.
+ *
+ * The result is the same as calculating the blame on the client side from
+ * the data reported by svn_repos_get_file_revs2() for the same @a start,
+ * @a end, @a authz_read_func and @a authz_read_baton without merged
+ * revisions.  For every node revision of @a path, the line origins get
+ * cached, so blaming a newer revision of the file only requires diffs
+ * against the latest cached one.
+ *
+ * @a cancel_func and @a cancel_baton will be called periodically to check
+ * for cancellation.  @a scratch_pool is used for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_blame(svn_repos_t *repos,
+                const char *path,
+                svn_revnum_t start,
+                svn_revnum_t end,
+                const svn_diff_file_options_t *diff_options,
+                svn_repos_authz_func_t authz_read_func,
+                void *authz_read_baton,
+                svn_repos_blame_receiver_t receiver,
+                void *receiver_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool);
+
 
 /* ---------------------------------------------------------------*/
 
@@ -3138,10 +3217,10 @@ enum svn_repos_load_uuid
   svn_repos_load_uuid_force
 };
 
-/** Callback type for use with svn_repos_verify_fs3().  @a revision
+/** Callback type for use with svn_repos_verify_fs4().  @a revision
  * and @a verify_err are the details of a single verification failure
- * that occurred during the svn_repos_verify_fs3() call.  @a baton is
- * the same baton given to svn_repos_verify_fs3().  @a scratch_pool is
+ * that occurred during the svn_repos_verify_fs4() call.  @a baton is
+ * the same baton given to svn_repos_verify_fs4().  @a scratch_pool is
  * provided for the convenience of the implementor, who should not
  * expect it to live longer than a single callback call.
  *
@@ -3151,7 +3230,7 @@ enum svn_repos_load_uuid
  * should also call svn_error_dup() for @a verify_err.  Implementors of this
  * callback are forbidden to call svn_error_clear() for @a verify_err.
  *
- * @see svn_repos_verify_fs3
+ * @see svn_repos_verify_fs4
  *
  * @since New in 1.9.
  */
@@ -3224,12 +3303,41 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * cancel_baton as argument to see if the caller wishes to cancel the
  * verification.
  *
+ * If @a jobs is larger than 1, verify up to @a jobs revisions in parallel,
+ * each using its own connection to the file system.  Notifications,
+ * @a verify_callback invocations and the returned error will still be
+ * reported strictly in revision order, i.e. the output is the same as
+ * with a single job.  Note that @a cancel_func may then be called from
+ * multiple threads.
+ *
  * Use @a scratch_pool for temporary allocation.
  *
  * @see svn_repos_verify_callback_t
  *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_verify_fs4(), but with @a jobs set to 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -3287,7 +3395,7 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * Dump the contents of the filesystem within already-open @a repos into
  * writable @a dumpstream.  If @a dumpstream is
  * @c NULL, this is effectively a primitive verify.  It is not complete,
- * however; see instead svn_repos_verify_fs3().
+ * however; see instead svn_repos_verify_fs4().
  *
  * Begin at revision @a start_rev, and dump every revision up through
  * @a end_rev.  If @a start_rev is #SVN_INVALID_REVNUM, start at revision
@@ -3304,6 +3412,12 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * be done with full plain text.  A dump with @a use_deltas set cannot
  * be loaded by Subversion 1.0.x.
  *
+ * If @a use_deltas is @c TRUE and @a deltas_compression_level is not
+ * #SVN_DELTA_COMPRESSION_LEVEL_NONE, the deltas will be compressed using
+ * Zstandard at that level (svndiff4).  Such dumps can only be loaded by
+ * Subversion 1.15 or newer built with zstd support.  Return
+ * #SVN_ERR_UNSUPPORTED_FEATURE if this build does not support zstd.
+ *
  * If @a include_revprops is @c TRUE, output the revision properties as
  * well, otherwise omit them.
  *
@@ -3344,8 +3458,34 @@ svn_repos_verify_fs(svn_repos_t *repos,
  *
  * Use @a scratch_pool for temporary allocation.
  *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_dump_fs5(svn_repos_t *repos,
+                   svn_stream_t *stream,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   svn_boolean_t incremental,
+                   svn_boolean_t use_deltas,
+                   int deltas_compression_level,
+                   svn_boolean_t include_revprops,
+                   svn_boolean_t include_changes,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_repos_dump_filter_func_t filter_func,
+                   void *filter_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Similar to svn_repos_dump_fs5(), but always writing uncompressed
+ * deltas.
+ *
  * @since New in 1.10.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_dump_fs4(svn_repos_t *repos,
                    svn_stream_t *stream,
@@ -36,13 +36,13 @@
 #include "svn_props.h"
 #include "svn_hash.h"
 #include "svn_sorts.h"
+#include "svn_config.h"
 
+#include "private/svn_task.h"
 #include "private/svn_wc_private.h"
 
 #include "svn_private_config.h"
 
-#include <assert.h>
-
 /* The metadata associated with a particular revision. */
 struct rev
 {
@@ -57,21 +57,54 @@ struct blame
 {
   const struct rev *rev;    /* the responsible revision */
   apr_off_t start;          /* the starting diff-token (line) */
-  struct blame *next;       /* the next chunk */
 };
 
-/* A chain of blame chunks */
+/* A chain of blame chunks.  The chunks are ordered by their START token.
+   The first one starts at token 0 and each chunk extends up to the start
+   of the next one, the last chunk up to the end of the file.  Every diff
+   gets applied by merging it with BLAME into SPARE in a single pass and
+   swapping the arrays afterwards. */
 struct blame_chain
 {
-  struct blame *blame;      /* linked list of blame chunks */
-  struct blame *avail;      /* linked list of free blame chunks */
-  struct apr_pool_t *pool;  /* Allocate members from this pool. */
+  apr_array_header_t *blame;  /* array of struct blame, empty initially */
+  apr_array_header_t *spare;  /* unused array of struct blame */
 };
 
-/* The baton use for the diff output routine. */
-struct diff_baton {
+/* A temporary file containing the contents of some revision.  It will be
+   deleted as soon as neither the blame operation itself nor any pending
+   diff refers to it anymore. */
+struct blame_file
+{
+  const char *path;         /* the temporary file */
+  apr_pool_t *pool;         /* the file lives as long as this pool */
+  int refcount;             /* number of references to this structure */
+};
+
+/* A range of changed lines reported by the diff between two revisions. */
+struct hunk
+{
+  apr_off_t original_start;
+  apr_off_t original_length;
+  apr_off_t modified_start;
+  apr_off_t modified_length;
+};
+
+/* A diff between two subsequent revisions to be calculated by the task
+   queue and to be added to the blame CHAIN afterwards. */
+struct blame_diff
+{
+  struct blame_file *last_file;   /* NULL for the first revision */
+  struct blame_file *cur_file;
   struct blame_chain *chain;
-  const struct rev *rev;
+  const struct rev *rev;          /* the rev to blame changed lines on */
+  const svn_diff_file_options_t *diff_options;
+};
+
+/* The result of diff_task. */
+struct diff_result
+{
+  struct blame_diff *diff;        /* the diff that this result is for */
+  apr_array_header_t *hunks;      /* array of struct hunk */
 };
 
 /* The baton used for a file revision. Lives the entire operation */
@@ -81,23 +114,25 @@ struct file_rev_baton {
   const char *target;
   svn_client_ctx_t *ctx;
   const svn_diff_file_options_t *diff_options;
-  /* name of file containing the previous revision of the file */
-  const char *last_filename;
+  /* the file containing the previous revision of the file */
+  struct blame_file *last_file;
   struct rev *last_rev;   /* the rev of the last modification */
   struct blame_chain *chain;      /* the original blame chain. */
   const char *repos_root_url;    /* To construct a url */
   apr_pool_t *mainpool;  /* lives during the whole sequence of calls */
-  apr_pool_t *lastpool;  /* pool used during previous call */
   apr_pool_t *currpool;  /* pool used during this call */
 
+  /* The diffs between subsequent revisions get calculated in this queue
+     while we reconstruct the contents of the next revisions.  The queue,
+     the temporary files and the queued diffs are allocated in FILEPOOL. */
+  svn_task__queue_t *queue;
+  apr_pool_t *filepool;
+
   /* These are used for tracking merged revisions. */
   svn_boolean_t include_merged_revisions;
   struct blame_chain *merged_chain;  /* the merged blame chain. */
-  /* name of file containing the previous merged revision of the file */
-  const char *last_original_filename;
-  /* pools for files which may need to persist for more than one rev. */
-  apr_pool_t *filepool;
-  apr_pool_t *prevfilepool;
+  /* the file containing the previous merged revision of the file */
+  struct blame_file *last_original_file;
 
   svn_boolean_t check_mime_type;
 
@@ -115,7 +150,7 @@ struct delta_baton {
   void *wrapped_baton;
   struct file_rev_baton *file_rev_baton;
   svn_stream_t *source_stream;  /* the delta source */
-  const char *filename;
+  struct blame_file *file;
   svn_boolean_t is_merged_revision;
   struct rev *rev;     /* the rev struct for the current revision */
 };
@@ -123,136 +158,108 @@ struct delta_baton {
 
 
 
-/* Return a blame chunk associated with REV for a change starting
-   at token START, and allocated in CHAIN->mainpool. */
-static struct blame *
-blame_create(struct blame_chain *chain,
+/* Return a new, empty blame chain allocated in POOL. */
+static struct blame_chain *
+blame_chain_create(apr_pool_t *pool)
+{
+  struct blame_chain *chain = apr_palloc(pool, sizeof(*chain));
+  chain->blame = apr_array_make(pool, 16, sizeof(struct blame));
+  chain->spare = apr_array_make(pool, 16, sizeof(struct blame));
+  return chain;
+}
+
+/* Append a chunk of blame associated with REV starting at token START to
+   BLAMES.  Merge it with the last chunk, if they belong to the same REV,
+   and drop any chunks that would become empty. */
+static void
+blame_append(apr_array_header_t *blames,
              const struct rev *rev,
              apr_off_t start)
 {
   struct blame *blame;
-  if (chain->avail)
+
+  while (blames->nelts)
     {
-      blame = chain->avail;
-      chain->avail = blame->next;
+      blame = &APR_ARRAY_IDX(blames, blames->nelts - 1, struct blame);
+      if (blame->rev == rev)
+        return;
+      if (blame->start < start)
+        break;
+
+      apr_array_pop(blames);
     }
-  else
-    blame = apr_palloc(chain->pool, sizeof(*blame));
+
+  blame = apr_array_push(blames);
   blame->rev = rev;
   blame->start = start;
-  blame->next = NULL;
-  return blame;
 }
 
-/* Destroy a blame chunk. */
+/* Append the blame for the tokens FROM up to but not including TO from
+   the chunks in OLD to BLAMES, moving them by DELTA tokens.  A negative
+   TO means "up to the end of the file".  *NEXT is the index of the first
+   chunk in OLD that has not been copied yet and will be updated. */
 static void
-blame_destroy(struct blame_chain *chain,
-              struct blame *blame)
+blame_copy_range(apr_array_header_t *blames,
+                 const apr_array_header_t *old,
+                 int *next,
+                 apr_off_t from,
+                 apr_off_t to,
+                 apr_off_t delta)
 {
-  blame->next = chain->avail;
-  chain->avail = blame;
-}
+  if (to >= 0 && from >= to)
+    return;
 
-/* Return the blame chunk that contains token OFF, starting the search at
-   BLAME. */
-static struct blame *
-blame_find(struct blame *blame, apr_off_t off)
-{
-  struct blame *prev = NULL;
-  while (blame)
+  /* Find the chunk containing FROM.  The first chunk starts at 0. */
+  while (   *next < old->nelts
+         && APR_ARRAY_IDX(old, *next, struct blame).start <= from)
+    ++*next;
+
+  blame_append(blames, APR_ARRAY_IDX(old, *next - 1, struct blame).rev,
+               from + delta);
+
+  /* Copy all further chunks starting within the range. */
+  for (; *next < old->nelts; ++*next)
     {
-      if (blame->start > off) break;
-      prev = blame;
-      blame = blame->next;
+      const struct blame *blame = &APR_ARRAY_IDX(old, *next, struct blame);
+      if (to >= 0 && blame->start >= to)
+        break;
+
+      blame_append(blames, blame->rev, blame->start + delta);
     }
-  return prev;
 }
 
-/* Shift the start-point of BLAME and all subsequence blame-chunks
-   by ADJUST tokens */
+/* Update CHAIN for the changes described by HUNKS, an array of struct
+   hunk ordered by position, and blame the changed lines on REV. */
 static void
-blame_adjust(struct blame *blame, apr_off_t adjust)
+blame_apply_diff(struct blame_chain *chain,
+                 const apr_array_header_t *hunks,
+                 const struct rev *rev)
 {
-  while (blame)
+  apr_array_header_t *blames = chain->spare;
+  apr_off_t original_pos = 0;
+  apr_off_t delta = 0;
+  int next = 0;
+  int i;
+
+  apr_array_clear(blames);
+  for (i = 0; i < hunks->nelts; ++i)
     {
-      blame->start += adjust;
-      blame = blame->next;
-    }
-}
+      const struct hunk *hunk = &APR_ARRAY_IDX(hunks, i, struct hunk);
 
-/* Delete the blame associated with the region from token START to
-   START + LENGTH */
-static svn_error_t *
-blame_delete_range(struct blame_chain *chain,
-                   apr_off_t start,
-                   apr_off_t length)
-{
-  struct blame *first = blame_find(chain->blame, start);
-  struct blame *last = blame_find(chain->blame, start + length);
-  struct blame *tail = last->next;
-
-  if (first != last)
-    {
-      struct blame *walk = first->next;
-      while (walk != last)
-        {
-          struct blame *next = walk->next;
-          blame_destroy(chain, walk);
-          walk = next;
-        }
-      first->next = last;
-      last->start = start;
-      if (first->start == start)
-        {
-          *first = *last;
-          blame_destroy(chain, last);
-          last = first;
-        }
-    }
+      /* The lines between the hunks keep their blame. */
+      blame_copy_range(blames, chain->blame, &next, original_pos,
+                       hunk->original_start, delta);
+      if (hunk->modified_length)
+        blame_append(blames, rev, hunk->modified_start);
 
-  if (tail && tail->start == last->start + length)
-    {
-      *last = *tail;
-      blame_destroy(chain, tail);
-      tail = last->next;
+      original_pos = hunk->original_start + hunk->original_length;
+      delta = hunk->modified_start + hunk->modified_length - original_pos;
     }
 
-  blame_adjust(tail, -length);
-
-  return SVN_NO_ERROR;
-}
-
-/* Insert a chunk of blame associated with REV starting
-   at token START and continuing for LENGTH tokens */
-static svn_error_t *
-blame_insert_range(struct blame_chain *chain,
-                   const struct rev *rev,
-                   apr_off_t start,
-                   apr_off_t length)
-{
-  struct blame *head = chain->blame;
-  struct blame *point = blame_find(head, start);
-  struct blame *insert;
-
-  if (point->start == start)
-    {
-      insert = blame_create(chain, point->rev, point->start + length);
-      point->rev = rev;
-      insert->next = point->next;
-      point->next = insert;
-    }
-  else
-    {
-      struct blame *middle;
-      middle = blame_create(chain, rev, start);
-      insert = blame_create(chain, point->rev, start + length);
-      middle->next = insert;
-      insert->next = point->next;
-      point->next = middle;
-    }
-  blame_adjust(insert->next, length);
+  blame_copy_range(blames, chain->blame, &next, original_pos, -1, delta);
 
-  return SVN_NO_ERROR;
+  chain->spare = chain->blame;
+  chain->blame = blames;
 }
 
 /* Callback for diff between subsequent revisions */
@@ -265,14 +272,13 @@ output_diff_modified(void *baton,
                      apr_off_t latest_start,
                      apr_off_t latest_length)
 {
-  struct diff_baton *db = baton;
-
-  if (original_length)
-    SVN_ERR(blame_delete_range(db->chain, modified_start, original_length));
+  apr_array_header_t *hunks = baton;
+  struct hunk *hunk = apr_array_push(hunks);
 
-  if (modified_length)
-    SVN_ERR(blame_insert_range(db->chain, db->rev, modified_start,
-                               modified_length));
+  hunk->original_start = original_start;
+  hunk->original_length = original_length;
+  hunk->modified_start = modified_start;
+  hunk->modified_length = modified_length;
 
   return SVN_NO_ERROR;
 }
@@ -282,42 +288,133 @@ static const svn_diff_output_fns_t output_fns = {
         output_diff_modified
 };
 
-/* Add the blame for the diffs between LAST_FILE and CUR_FILE to CHAIN,
-   for revision REV.  LAST_FILE may be NULL in which
-   case blame is added for every line of CUR_FILE. */
+/* Return a new temporary file in *FILE and a stream to write its contents
+   to in *STREAM.  Allocate both in a sub-pool of FRB->FILEPOOL. */
 static svn_error_t *
-add_file_blame(const char *last_file,
-               const char *cur_file,
-               struct blame_chain *chain,
-               struct rev *rev,
-               const svn_diff_file_options_t *diff_options,
-               svn_cancel_func_t cancel_func,
-               void *cancel_baton,
-               apr_pool_t *pool)
+blame_file_create(struct blame_file **file,
+                  svn_stream_t **stream,
+                  struct file_rev_baton *frb)
+{
+  apr_pool_t *pool = svn_pool_create(frb->filepool);
+  struct blame_file *new_file = apr_palloc(pool, sizeof(*new_file));
+
+  SVN_ERR(svn_stream_open_unique(stream, &new_file->path, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 pool, pool));
+  new_file->pool = pool;
+  new_file->refcount = 1;
+
+  *file = new_file;
+  return SVN_NO_ERROR;
+}
+
+/* Add a reference to FILE, which may be NULL, and return it. */
+static struct blame_file *
+blame_file_ref(struct blame_file *file)
+{
+  if (file)
+    file->refcount++;
+
+  return file;
+}
+
+/* Remove a reference to FILE, which may be NULL.  Delete the file when
+   the last reference is gone. */
+static void
+blame_file_release(struct blame_file *file)
 {
-  if (!last_file)
+  if (file && --file->refcount == 0)
+    svn_pool_destroy(file->pool);
+}
+
+/* Implements svn_task__process_func_t.  Calculate the diff described by
+   the struct blame_diff in BATON and return its hunks as a struct
+   diff_result.  This only reads the files and may run in any thread. */
+static svn_error_t *
+diff_task(void **result,
+          void *baton,
+          void *thread_context,
+          apr_int64_t index,
+          apr_pool_t *result_pool,
+          apr_pool_t *scratch_pool)
+{
+  struct blame_diff *diff = baton;
+  struct diff_result *diff_result = apr_palloc(result_pool,
+                                               sizeof(*diff_result));
+
+  diff_result->diff = diff;
+  diff_result->hunks = apr_array_make(result_pool, 16, sizeof(struct hunk));
+
+  if (diff->last_file)
     {
-      SVN_ERR_ASSERT(chain->blame == NULL);
-      chain->blame = blame_create(chain, rev, 0);
+      svn_diff_t *file_diff;
+
+      SVN_ERR(svn_diff_file_diff_2(&file_diff, diff->last_file->path,
+                                   diff->cur_file->path, diff->diff_options,
+                                   scratch_pool));
+      SVN_ERR(svn_diff_output2(file_diff, diff_result->hunks, &output_fns,
+                               NULL, NULL));
     }
-  else
-    {
-      svn_diff_t *diff;
-      struct diff_baton diff_baton;
 
-      diff_baton.chain = chain;
-      diff_baton.rev = rev;
+  *result = diff_result;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Add the blame for the struct
+   diff_result in RESULT to its chain.  This gets called for the diffs in
+   the order they have been queued. */
+static svn_error_t *
+apply_diff_task(void *baton,
+                void *result,
+                apr_int64_t index,
+                apr_pool_t *scratch_pool)
+{
+  struct diff_result *diff_result = result;
+  struct blame_diff *diff = diff_result->diff;
+  struct blame_chain *chain = diff->chain;
 
-      /* We have a previous file.  Get the diff and adjust blame info. */
-      SVN_ERR(svn_diff_file_diff_2(&diff, last_file, cur_file,
-                                   diff_options, pool));
-      SVN_ERR(svn_diff_output2(diff, &diff_baton, &output_fns,
-                               cancel_func, cancel_baton));
+  if (!diff->last_file)
+    {
+      /* Blame every line of the first revision on it. */
+      SVN_ERR_ASSERT(chain->blame->nelts == 0);
+      blame_append(chain->blame, diff->rev, 0);
     }
+  else
+    {
+      SVN_ERR_ASSERT(chain->blame->nelts > 0);
+      blame_apply_diff(chain, diff_result->hunks, diff->rev);
+    }
+
+  blame_file_release(diff->last_file);
+  blame_file_release(diff->cur_file);
 
   return SVN_NO_ERROR;
 }
 
+/* Queue the blame for the diffs between LAST_FILE and CUR_FILE to be
+   added to CHAIN, for revision REV.  LAST_FILE may be NULL in which
+   case blame is added for every line of CUR_FILE.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+add_file_blame(struct blame_file *last_file,
+               struct blame_file *cur_file,
+               struct blame_chain *chain,
+               const struct rev *rev,
+               struct file_rev_baton *frb,
+               apr_pool_t *scratch_pool)
+{
+  struct blame_diff *diff = apr_palloc(frb->filepool, sizeof(*diff));
+
+  diff->last_file = blame_file_ref(last_file);
+  diff->cur_file = blame_file_ref(cur_file);
+  diff->chain = chain;
+  diff->rev = rev;
+  diff->diff_options = frb->diff_options;
+
+  return svn_error_trace(svn_task__queue_push(frb->queue, diff,
+                                              scratch_pool));
+}
+
 /* Record the blame information for the revision in BATON->file_rev_baton.
  */
 static svn_error_t *
@@ -342,47 +439,28 @@ update_blame(void *baton)
     chain = frb->chain;
 
   /* Process this file. */
-  SVN_ERR(add_file_blame(frb->last_filename,
-                         dbaton->filename, chain, dbaton->rev,
-                         frb->diff_options,
-                         frb->ctx->cancel_func, frb->ctx->cancel_baton,
-                         frb->currpool));
+  SVN_ERR(add_file_blame(frb->last_file, dbaton->file, chain, dbaton->rev,
+                         frb, frb->currpool));
 
   /* If we are including merged revisions, and the current revision is not a
      merged one, we need to add its blame info to the chain for the original
      line of history. */
   if (frb->include_merged_revisions && ! dbaton->is_merged_revision)
     {
-      apr_pool_t *tmppool;
-
-      SVN_ERR(add_file_blame(frb->last_original_filename,
-                             dbaton->filename, frb->chain, dbaton->rev,
-                             frb->diff_options,
-                             frb->ctx->cancel_func, frb->ctx->cancel_baton,
-                             frb->currpool));
-
-      /* This filename could be around for a while, potentially, so
-         use the longer lifetime pool, and switch it with the previous one*/
-      svn_pool_clear(frb->prevfilepool);
-      tmppool = frb->filepool;
-      frb->filepool = frb->prevfilepool;
-      frb->prevfilepool = tmppool;
-
-      frb->last_original_filename = apr_pstrdup(frb->filepool,
-                                                dbaton->filename);
+      SVN_ERR(add_file_blame(frb->last_original_file, dbaton->file,
+                             frb->chain, dbaton->rev, frb, frb->currpool));
+
+      /* This file could be around for a while, potentially. */
+      blame_file_release(frb->last_original_file);
+      frb->last_original_file = blame_file_ref(dbaton->file);
     }
 
   /* Prepare for next revision. */
 
-  /* Remember the file name so we can diff it with the next revision. */
-  frb->last_filename = dbaton->filename;
-
-  /* Switch pools. */
-  {
-    apr_pool_t *tmp_pool = frb->lastpool;
-    frb->lastpool = frb->currpool;
-    frb->currpool = tmp_pool;
-  }
+  /* Remember the file so we can diff it with the next revision.
+     The reference held by DBATON gets passed on to FRB. */
+  blame_file_release(frb->last_file);
+  frb->last_file = dbaton->file;
 
   return SVN_NO_ERROR;
 }
@@ -434,9 +512,8 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
 {
   struct file_rev_baton *frb = baton;
   svn_stream_t *last_stream;
-  svn_stream_t *cur_stream;
+  svn_stream_t *cur_stream = NULL;
   struct delta_baton *delta_baton;
-  apr_pool_t *filepool;
 
   /* Clear the current pool. */
   svn_pool_clear(frb->currpool);
@@ -484,9 +561,8 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   /* If there were no content changes and no (potential) merges, we couldn't
      care less about this revision now.  Note that we checked the mime type
      above, so things work if the user just changes the mime type in a commit.
-     Also note that we don't switch the pools in this case.  This is important,
-     since the tempfile will be removed by the pool and we need the tempfile
-     from the last revision with content changes. */
+     The file of the last revision with content changes stays around because
+     FRB still refers to it. */
   if (!content_delta_handler
       && (!frb->include_merged_revisions || merged_revision))
     return SVN_NO_ERROR;
@@ -495,22 +571,20 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   delta_baton = apr_pcalloc(frb->currpool, sizeof(*delta_baton));
 
   /* Prepare the text delta window handler. */
-  if (frb->last_filename)
-    SVN_ERR(svn_stream_open_readonly(&delta_baton->source_stream, frb->last_filename,
+  if (frb->last_file)
+    SVN_ERR(svn_stream_open_readonly(&delta_baton->source_stream,
+                                     frb->last_file->path,
                                      frb->currpool, pool));
   else
     /* Means empty stream below. */
     delta_baton->source_stream = NULL;
   last_stream = svn_stream_disown(delta_baton->source_stream, pool);
 
-  if (frb->include_merged_revisions && !merged_revision)
-    filepool = frb->filepool;
+  /* Without content changes, we can simply diff against the last file. */
+  if (content_delta_handler || !frb->last_file)
+    SVN_ERR(blame_file_create(&delta_baton->file, &cur_stream, frb));
   else
-    filepool = frb->currpool;
-
-  SVN_ERR(svn_stream_open_unique(&cur_stream, &delta_baton->filename, NULL,
-                                 svn_io_file_del_on_pool_cleanup,
-                                 filepool, filepool));
+    delta_baton->file = blame_file_ref(frb->last_file);
 
   /* Wrap the window handler with our own. */
   delta_baton->file_rev_baton = frb;
@@ -549,7 +623,7 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
     {
       /* We shouldn't get more than one revision outside the
          specified range (unless we alsoe receive merged revisions) */
-      SVN_ERR_ASSERT((frb->last_filename == NULL)
+      SVN_ERR_ASSERT((frb->last_file == NULL)
                      || frb->include_merged_revisions);
 
       /* The file existed before start_rev; generate no blame info for
@@ -581,78 +655,122 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
     }
   else
     {
-      /* Apply an empty delta, i.e. simply copy the old contents.
-         We can't simply use the existing file due to the pool rotation logic.
+      /* Apply an empty delta, i.e. keep the old contents, if any.
          Trigger the blame update magic. */
-      SVN_ERR(svn_stream_copy3(last_stream, cur_stream, NULL, NULL, pool));
+      if (delta_baton->file != frb->last_file)
+        SVN_ERR(svn_stream_copy3(last_stream, cur_stream, NULL, NULL, pool));
       SVN_ERR(update_blame(delta_baton));
     }
 
   return SVN_NO_ERROR;
 }
 
-/* Ensure that CHAIN_ORIG and CHAIN_MERGED have the same number of chunks,
-   and that for every chunk C, CHAIN_ORIG[C] and CHAIN_MERGED[C] have the
-   same starting value.  Both CHAIN_ORIG and CHAIN_MERGED should not be
-   NULL.  */
-static void
-normalize_blames(struct blame_chain *chain,
-                 struct blame_chain *chain_merged,
-                 apr_pool_t *pool)
+/* The baton used by server_blame_receiver. */
+struct server_blame_baton
 {
-  struct blame *walk, *walk_merged;
-
-  /* Walk over the CHAIN's blame chunks and CHAIN_MERGED's blame chunks,
-     creating new chunks as needed. */
-  for (walk = chain->blame, walk_merged = chain_merged->blame;
-       walk->next && walk_merged->next;
-       walk = walk->next, walk_merged = walk_merged->next)
-    {
-      /* The current chunks should always be starting at the same offset. */
-      assert(walk->start == walk_merged->start);
+  struct blame_chain *chain;  /* the blame chain to fill */
+  apr_hash_t *revs;           /* struct rev per revision number */
+  struct rev *unknown_rev;    /* for lines changed before the start rev */
+  apr_pool_t *pool;           /* lives during the whole operation */
+};
 
-      if (walk->next->start < walk_merged->next->start)
-        {
-          /* insert a new chunk in CHAIN_MERGED. */
-          struct blame *tmp = blame_create(chain_merged, walk_merged->rev,
-                                           walk->next->start);
-          tmp->next = walk_merged->next;
-          walk_merged->next = tmp;
-        }
+/* Append the run of lines starting at START_LINE to the blame chain in
+   BATON, a struct server_blame_baton, and blame it on REVISION with
+   REV_PROPS.  Implements svn_ra_blame_receiver_t. */
+static svn_error_t *
+server_blame_receiver(apr_int64_t start_line,
+                      svn_revnum_t revision,
+                      apr_hash_t *rev_props,
+                      void *baton,
+                      apr_pool_t *scratch_pool)
+{
+  struct server_blame_baton *sbb = baton;
+  struct rev *rev;
 
-      if (walk->next->start > walk_merged->next->start)
+  if (SVN_IS_VALID_REVNUM(revision))
+    {
+      rev = apr_hash_get(sbb->revs, &revision, sizeof(revision));
+      if (!rev)
         {
-          /* insert a new chunk in CHAIN. */
-          struct blame *tmp = blame_create(chain, walk->rev,
-                                           walk_merged->next->start);
-          tmp->next = walk->next;
-          walk->next = tmp;
+          rev = apr_pcalloc(sbb->pool, sizeof(*rev));
+          rev->revision = revision;
+          rev->rev_props = svn_prop_hash_dup(rev_props, sbb->pool);
+          apr_hash_set(sbb->revs, &rev->revision, sizeof(rev->revision),
+                       rev);
         }
     }
-
-  /* If both NEXT pointers are null, the lists are equally long, otherwise
-     we need to extend one of them.  If CHAIN is longer, append new chunks
-     to CHAIN_MERGED until its length matches that of CHAIN. */
-  while (walk->next != NULL)
+  else
     {
-      struct blame *tmp = blame_create(chain_merged, walk_merged->rev,
-                                       walk->next->start);
-      walk_merged->next = tmp;
-
-      walk_merged = walk_merged->next;
-      walk = walk->next;
+      rev = sbb->unknown_rev;
     }
 
-  /* Same as above, only extend CHAIN to match CHAIN_MERGED. */
-  while (walk_merged->next != NULL)
+  blame_append(sbb->chain->blame, rev, start_line);
+
+  return SVN_NO_ERROR;
+}
+
+/* Ensure that CHAIN and CHAIN_MERGED have the same number of chunks,
+   and that for every chunk C, CHAIN[C] and CHAIN_MERGED[C] have the
+   same starting value.  Both CHAIN and CHAIN_MERGED should not be
+   empty.  */
+static void
+normalize_blames(struct blame_chain *chain,
+                 struct blame_chain *chain_merged)
+{
+  const apr_array_header_t *blames = chain->blame;
+  const apr_array_header_t *blames_merged = chain_merged->blame;
+  apr_array_header_t *normalized = chain->spare;
+  apr_array_header_t *normalized_merged = chain_merged->spare;
+  int i = 0, k = 0;
+  apr_off_t start = 0;
+
+  apr_array_clear(normalized);
+  apr_array_clear(normalized_merged);
+
+  /* Both chains start at token 0.  Walk over the union of their chunk
+     boundaries and split the chunks of either chain as needed. */
+  while (TRUE)
     {
-      struct blame *tmp = blame_create(chain, walk->rev,
-                                       walk_merged->next->start);
-      walk->next = tmp;
+      const struct blame *blame = &APR_ARRAY_IDX(blames, i, struct blame);
+      const struct blame *blame_merged
+        = &APR_ARRAY_IDX(blames_merged, k, struct blame);
+      struct blame *new_blame;
+
+      new_blame = apr_array_push(normalized);
+      new_blame->rev = blame->rev;
+      new_blame->start = start;
 
-      walk = walk->next;
-      walk_merged = walk_merged->next;
+      new_blame = apr_array_push(normalized_merged);
+      new_blame->rev = blame_merged->rev;
+      new_blame->start = start;
+
+      /* Continue with the next chunk boundary in either chain. */
+      if (i + 1 < blames->nelts)
+        {
+          start = APR_ARRAY_IDX(blames, i + 1, struct blame).start;
+          if (   k + 1 < blames_merged->nelts
+              && APR_ARRAY_IDX(blames_merged, k + 1, struct blame).start
+                   < start)
+            start = APR_ARRAY_IDX(blames_merged, k + 1, struct blame).start;
+        }
+      else if (k + 1 < blames_merged->nelts)
+        start = APR_ARRAY_IDX(blames_merged, k + 1, struct blame).start;
+      else
+        break;
+
+      if (   i + 1 < blames->nelts
+          && APR_ARRAY_IDX(blames, i + 1, struct blame).start == start)
+        ++i;
+      if (   k + 1 < blames_merged->nelts
+          && APR_ARRAY_IDX(blames_merged, k + 1, struct blame).start
+               == start)
+        ++k;
     }
+
+  chain->spare = chain->blame;
+  chain->blame = normalized;
+  chain_merged->spare = chain_merged->blame;
+  chain_merged->blame = normalized_merged;
 }
 
 svn_error_t *
@@ -673,11 +791,14 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
   struct file_rev_baton frb;
   svn_ra_session_t *ra_session;
   svn_revnum_t start_revnum, end_revnum;
-  struct blame *walk, *walk_merged = NULL;
   apr_pool_t *iterpool;
   svn_stream_t *last_stream;
   svn_stream_t *stream;
   const char *target_abspath_or_url;
+  svn_config_t *cfg;
+  apr_int64_t thread_count;
+  svn_boolean_t server_side;
+  int i;
 
   if (start->kind == svn_opt_revision_unspecified
       || end->kind == svn_opt_revision_unspecified)
@@ -778,20 +899,12 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
   frb.ctx = ctx;
   frb.diff_options = diff_options;
   frb.include_merged_revisions = include_merged_revisions;
-  frb.last_filename = NULL;
+  frb.last_file = NULL;
   frb.last_rev = NULL;
-  frb.last_original_filename = NULL;
-  frb.chain = apr_palloc(pool, sizeof(*frb.chain));
-  frb.chain->blame = NULL;
-  frb.chain->avail = NULL;
-  frb.chain->pool = pool;
+  frb.last_original_file = NULL;
+  frb.chain = blame_chain_create(pool);
   if (include_merged_revisions)
-    {
-      frb.merged_chain = apr_palloc(pool, sizeof(*frb.merged_chain));
-      frb.merged_chain->blame = NULL;
-      frb.merged_chain->avail = NULL;
-      frb.merged_chain->pool = pool;
-    }
+    frb.merged_chain = blame_chain_create(pool);
   frb.backwards = (frb.start_rev > frb.end_rev);
   frb.last_revnum = SVN_INVALID_REVNUM;
   frb.last_props = NULL;
@@ -800,27 +913,76 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
   SVN_ERR(svn_ra_get_repos_root2(ra_session, &frb.repos_root_url, pool));
 
   frb.mainpool = pool;
-  /* The callback will flip the following two pools, because it needs
-     information from the previous call.  Obviously, it can't rely on
-     the lifetime of the pool provided by get_file_revs. */
-  frb.lastpool = svn_pool_create(pool);
   frb.currpool = svn_pool_create(pool);
-  if (include_merged_revisions)
+
+  /* Calculate the diffs in up to "blame-threads" worker threads while
+     get_file_revs reconstructs the subsequent revisions.  Cleaning up
+     FILEPOOL will stop the workers before the files get removed. */
+  cfg = ctx->config
+      ? svn_hash_gets(ctx->config, SVN_CONFIG_CATEGORY_CONFIG)
+      : NULL;
+  SVN_ERR(svn_config_get_int64(cfg, &thread_count,
+                               SVN_CONFIG_SECTION_MISCELLANY,
+                               SVN_CONFIG_OPTION_BLAME_THREADS, 1));
+  thread_count = MAX(1, MIN(thread_count, 64));
+
+  /* Let the server calculate the blame if it can.  It does not know about
+     merged revisions, local modifications or blaming backwards, though. */
+  SVN_ERR(svn_config_get_bool(cfg, &server_side,
+                              SVN_CONFIG_SECTION_MISCELLANY,
+                              SVN_CONFIG_OPTION_SERVER_SIDE_BLAME, TRUE));
+  if (include_merged_revisions
+      || frb.backwards
+      || end->kind == svn_opt_revision_working)
+    server_side = FALSE;
+  if (server_side)
+    SVN_ERR(svn_ra_has_capability(ra_session, &server_side,
+                                  SVN_RA_CAPABILITY_BLAME, pool));
+  if (server_side)
+    thread_count = 1;
+
+  frb.filepool = svn_pool_create(pool);
+  SVN_ERR(svn_task__queue_create(&frb.queue, (int)thread_count,
+                                 diff_task, NULL, NULL,
+                                 apply_diff_task, NULL,
+                                 ctx->cancel_func, ctx->cancel_baton,
+                                 frb.filepool));
+
+  if (server_side)
     {
-      frb.filepool = svn_pool_create(pool);
-      frb.prevfilepool = svn_pool_create(pool);
+      /* The server sends us the complete blame chain.  We only need the
+         contents of the end revision to go with it.  Since we never see
+         the individual file revisions, there are no blame_revision
+         notifications on this path. */
+      struct server_blame_baton sbb;
+
+      sbb.chain = frb.chain;
+      sbb.revs = apr_hash_make(pool);
+      sbb.unknown_rev = apr_pcalloc(pool, sizeof(*sbb.unknown_rev));
+      sbb.unknown_rev->revision = SVN_INVALID_REVNUM;
+      sbb.pool = pool;
+
+      SVN_ERR(svn_ra_blame(ra_session, "", start_revnum, end_revnum,
+                           diff_options, server_blame_receiver, &sbb, pool));
+
+      SVN_ERR(blame_file_create(&frb.last_file, &stream, &frb));
+      SVN_ERR(svn_ra_get_file(ra_session, "", end_revnum, stream, NULL, NULL,
+                              pool));
+      SVN_ERR(svn_stream_close(stream));
+    }
+  else
+    {
+      /* Collect all blame information.
+         We need to ensure that we get one revision before the start_rev,
+         if available so that we can know what was actually changed in the
+         start revision. */
+      SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
+                                    frb.backwards ? start_revnum
+                                                  : MAX(0, start_revnum-1),
+                                    end_revnum,
+                                    include_merged_revisions,
+                                    file_rev_handler, &frb, pool));
     }
-
-  /* Collect all blame information.
-     We need to ensure that we get one revision before the start_rev,
-     if available so that we can know what was actually changed in the start
-     revision. */
-  SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
-                                frb.backwards ? start_revnum
-                                              : MAX(0, start_revnum-1),
-                                end_revnum,
-                                include_merged_revisions,
-                                file_rev_handler, &frb, pool));
 
   if (end->kind == svn_opt_revision_working)
     {
@@ -839,7 +1001,7 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
           svn_stream_t *tempfile;
           svn_opt_revision_t rev;
           svn_boolean_t normalize_eols = FALSE;
-          const char *temppath;
+          struct blame_file *wc_file;
 
           if (status->prop_status != svn_wc_status_none)
             {
@@ -867,31 +1029,32 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
                                                     ctx->cancel_baton,
                                                     pool, pool));
 
-          SVN_ERR(svn_stream_open_unique(&tempfile, &temppath, NULL,
-                                         svn_io_file_del_on_pool_cleanup,
-                                         pool, pool));
+          SVN_ERR(blame_file_create(&wc_file, &tempfile, &frb));
 
           SVN_ERR(svn_stream_copy3(wcfile, tempfile, ctx->cancel_func,
                                    ctx->cancel_baton, pool));
 
-          SVN_ERR(add_file_blame(frb.last_filename, temppath, frb.chain, NULL,
-                                 frb.diff_options,
-                                 ctx->cancel_func, ctx->cancel_baton, pool));
+          SVN_ERR(add_file_blame(frb.last_file, wc_file, frb.chain, NULL,
+                                 &frb, pool));
 
-          frb.last_filename = temppath;
+          blame_file_release(frb.last_file);
+          frb.last_file = wc_file;
         }
     }
 
+  /* Wait for all blame information to be complete. */
+  SVN_ERR(svn_task__queue_finish(frb.queue, pool));
+
   /* Report the blame to the caller. */
 
   /* The callback has to have been called at least once. */
-  SVN_ERR_ASSERT(frb.last_filename != NULL);
+  SVN_ERR_ASSERT(frb.last_file != NULL);
 
   /* Create a pool for the iteration below. */
   iterpool = svn_pool_create(pool);
 
   /* Open the last file and get a stream. */
-  SVN_ERR(svn_stream_open_readonly(&last_stream, frb.last_filename,
+  SVN_ERR(svn_stream_open_readonly(&last_stream, frb.last_file->path,
                                    pool, pool));
   stream = svn_subst_stream_translated(last_stream,
                                        "\n", TRUE, NULL, FALSE, pool);
@@ -905,21 +1068,31 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
          semantically a copy, and we want to use the revision on the branch as
          the most recently changed revision.  ### Is this really what we want
          to do here?  Do the semantics of copy change? */
-      if (!frb.chain->blame)
-        frb.chain->blame = blame_create(frb.chain, frb.last_rev, 0);
+      if (frb.chain->blame->nelts == 0)
+        blame_append(frb.chain->blame, frb.last_rev, 0);
 
-      normalize_blames(frb.chain, frb.merged_chain, pool);
-      walk_merged = frb.merged_chain->blame;
+      normalize_blames(frb.chain, frb.merged_chain);
     }
 
   /* Process each blame item. */
-  for (walk = frb.chain->blame; walk; walk = walk->next)
+  for (i = 0; i < frb.chain->blame->nelts; ++i)
     {
+      const struct blame *walk = &APR_ARRAY_IDX(frb.chain->blame, i,
+                                                struct blame);
+      const struct blame *walk_merged = NULL;
       apr_off_t line_no;
+      apr_off_t end = -1;
       svn_revnum_t merged_rev;
       const char *merged_path;
       apr_hash_t *merged_rev_props;
 
+      if (i + 1 < frb.chain->blame->nelts)
+        end = APR_ARRAY_IDX(frb.chain->blame, i + 1, struct blame).start;
+
+      if (include_merged_revisions)
+        walk_merged = &APR_ARRAY_IDX(frb.merged_chain->blame, i,
+                                     struct blame);
+
       if (walk_merged)
         {
           merged_rev = walk_merged->rev->revision;
@@ -933,9 +1106,7 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
           merged_path = NULL;
         }
 
-      for (line_no = walk->start;
-           !walk->next || line_no < walk->next->start;
-           ++line_no)
+      for (line_no = walk->start; end < 0 || line_no < end; ++line_no)
         {
           svn_boolean_t eof;
           svn_stringbuf_t *sb;
@@ -964,20 +1135,12 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
             }
           if (eof) break;
         }
-
-      if (walk_merged)
-        walk_merged = walk_merged->next;
     }
 
   SVN_ERR(svn_stream_close(stream));
 
-  svn_pool_destroy(frb.lastpool);
   svn_pool_destroy(frb.currpool);
-  if (include_merged_revisions)
-    {
-      svn_pool_destroy(frb.filepool);
-      svn_pool_destroy(frb.prevfilepool);
-    }
+  svn_pool_destroy(frb.filepool);
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
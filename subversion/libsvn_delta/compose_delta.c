@@ -23,11 +23,13 @@
 
 
 #include <assert.h>
+#include <string.h>
 
 #include <apr_general.h>        /* For APR_INLINE */
 
 #include "svn_delta.h"
 #include "svn_pools.h"
+#include "private/svn_delta_private.h"
 #include "delta.h"
 
 /* Define a MIN macro if this platform doesn't already have one. */
@@ -35,119 +37,77 @@
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
-
-/* ==================================================================== */
-/* Support for efficient small-block allocation from pools. */
-
-/* The following structs will be allocated and freed often: */
-
-/* A node in the range index tree. */
-typedef struct range_index_node_t range_index_node_t;
-struct range_index_node_t
-{
-  /* 'offset' and 'limit' define the range in the source window. */
-  apr_size_t offset;
-  apr_size_t limit;
-
-  /* 'target_offset' is where that range is represented in the target. */
-  apr_size_t target_offset;
-
-  /* 'left' and 'right' link the node into a splay tree. */
-  range_index_node_t *left, *right;
-
-  /* 'prev' and 'next' link it into an ordered, doubly-linked list. */
-  range_index_node_t *prev, *next;
-};
-
-/* A node in a list of ranges for source and target op copies. */
-enum range_kind
-  {
-    range_from_source,
-    range_from_target
-  };
-
-typedef struct range_list_node_t range_list_node_t;
-struct range_list_node_t
-{
-  /* Where does the range come from?
-     'offset' and 'limit' always refer to the "virtual" source data
-     for the second delta window. For a target range, the actual
-     offset to use for generating the target op is 'target_offset';
-     that field isn't used by source ranges. */
-  enum range_kind kind;
-
-  /* 'offset' and 'limit' define the range. */
-  apr_size_t offset;
-  apr_size_t limit;
-
-  /* 'target_offset' is the start of the range in the target. */
-  apr_size_t target_offset;
 
-  /* 'prev' and 'next' link the node into an ordered, doubly-linked list. */
-  range_list_node_t *prev, *next;
-};
+/* ==================================================================== */
+/* Growable arrays of small structs. */
 
+/* Make sure that the array *ELEMENTS with *CAPACITY entries of
+   ELEMENT_SIZE bytes each, LENGTH of which are in use, can hold at
+   least MIN_CAPACITY entries.  Reallocate it in POOL if necessary.
 
-/* This is what will be allocated: */
-typedef union alloc_block_t alloc_block_t;
-union alloc_block_t
+   The arrays get reused across compositions and only ever grow, so
+   the memory wasted in POOL by reallocation is bounded by the final
+   array size. */
+static void
+ensure_capacity(void **elements,
+                int *capacity,
+                int length,
+                int min_capacity,
+                apr_size_t element_size,
+                apr_pool_t *pool)
 {
-  range_index_node_t index_node;
-  range_list_node_t list_node;
+  if (*capacity < min_capacity)
+    {
+      int new_capacity = *capacity ? 2 * *capacity : 16;
+      void *new_elements;
 
-  /* Links free blocks into a freelist. */
-  alloc_block_t *next_free;
-};
+      while (new_capacity < min_capacity)
+        new_capacity *= 2;
 
+      new_elements = apr_palloc(pool, new_capacity * element_size);
+      if (length)
+        memcpy(new_elements, *elements, length * element_size);
 
-/* Allocate a block. */
-static APR_INLINE void *
-alloc_block(apr_pool_t *pool, alloc_block_t **free_list)
-{
-  alloc_block_t *block;
-  if (*free_list == NULL)
-    block = apr_palloc(pool, sizeof(*block));
-  else
-    {
-      block = *free_list;
-      *free_list = block->next_free;
+      *elements = new_elements;
+      *capacity = new_capacity;
     }
-  return block;
 }
 
-/* Return the block back to the free list. */
-static APR_INLINE void
-free_block(void *ptr, alloc_block_t **free_list)
-{
-  /* Wrapper functions take care of type safety. */
-  alloc_block_t *const block = ptr;
-  block->next_free = *free_list;
-  *free_list = block;
-}
 
 
-
 /* ==================================================================== */
 /* Mapping offsets in the target stream to txdelta ops. */
 
 typedef struct offset_index_t
 {
   int length;
+  int capacity;
   apr_size_t *offs;
+  apr_pool_t *pool;
 } offset_index_t;
 
-/* Create an index mapping target stream offsets to delta ops in
-   WINDOW. Allocate from POOL. */
+/* Create an empty offset index.  Allocate from POOL. */
 
 static offset_index_t *
-create_offset_index(const svn_txdelta_window_t *window, apr_pool_t *pool)
+create_offset_index(apr_pool_t *pool)
+{
+  offset_index_t *ndx = apr_pcalloc(pool, sizeof(*ndx));
+  ndx->pool = pool;
+  return ndx;
+}
+
+/* Fill NDX such that it maps target stream offsets to delta ops in
+   WINDOW.  Any previous contents of NDX will be replaced. */
+
+static void
+fill_offset_index(offset_index_t *ndx, const svn_txdelta_window_t *window)
 {
-  offset_index_t *ndx = apr_palloc(pool, sizeof(*ndx));
   apr_size_t offset = 0;
   int i;
 
+  ensure_capacity((void **)&ndx->offs, &ndx->capacity, 0,
+                  window->num_ops + 1, sizeof(*ndx->offs), ndx->pool);
   ndx->length = window->num_ops;
-  ndx->offs = apr_palloc(pool, (ndx->length + 1) * sizeof(*ndx->offs));
 
   for (i = 0; i < ndx->length; ++i)
     {
@@ -155,8 +115,6 @@ create_offset_index(const svn_txdelta_window_t *window, apr_pool_t *pool)
       offset += window->ops[i].length;
     }
   ndx->offs[ndx->length] = offset;
-
-  return ndx;
 }
 
 /* Find the index of the delta op thet defines that data at OFFSET in
@@ -212,164 +170,152 @@ search_offset_index(const offset_index_t *ndx,
 /* ==================================================================== */
 /* Mapping ranges in the source stream to ranges in the composed delta. */
 
-/* The range index tree. */
+/* An entry in the range index. */
+typedef struct range_index_node_t
+{
+  /* 'offset' and 'limit' define the range in the source window. */
+  apr_size_t offset;
+  apr_size_t limit;
+
+  /* 'target_offset' is where that range is represented in the target. */
+  apr_size_t target_offset;
+} range_index_node_t;
+
+/* A range for source and target op copies. */
+enum range_kind
+  {
+    range_from_source,
+    range_from_target
+  };
+
+typedef struct range_list_node_t
+{
+  /* Where does the range come from?
+     'offset' and 'limit' always refer to the "virtual" source data
+     for the second delta window. For a target range, the actual
+     offset to use for generating the target op is 'target_offset';
+     that field isn't used by source ranges. */
+  enum range_kind kind;
+
+  /* 'offset' and 'limit' define the range. */
+  apr_size_t offset;
+  apr_size_t limit;
+
+  /* 'target_offset' is the start of the range in the target. */
+  apr_size_t target_offset;
+} range_list_node_t;
+
+/* The range index.
+
+   NODES is an array of LENGTH ranges, sorted by offset.  No range
+   encloses another one, hence the limits are sorted as well.  This
+   replaces the splay tree that we used to have: lookups are a binary
+   search over a contiguous array, and since the source copies in a
+   delta window tend to come in ascending order, new ranges are mostly
+   appended at the end.
+
+   LIST is the scratch array that build_range_list() fills. */
 typedef struct range_index_t
 {
-  range_index_node_t *tree;
-  alloc_block_t *free_list;
+  range_index_node_t *nodes;
+  int length;
+  int capacity;
+
+  range_list_node_t *list;
+  int list_length;
+  int list_capacity;
+
+  /* The result of the last search; used as a hint for the next one. */
+  int hint;
+
   apr_pool_t *pool;
 } range_index_t;
 
-/* Create a range index tree. Allocate from POOL. */
+/* Create an empty range index.  Allocate from POOL. */
 static range_index_t *
 create_range_index(apr_pool_t *pool)
 {
-  range_index_t *ndx = apr_palloc(pool, sizeof(*ndx));
-  ndx->tree = NULL;
+  range_index_t *ndx = apr_pcalloc(pool, sizeof(*ndx));
   ndx->pool = pool;
-  ndx->free_list = NULL;
   return ndx;
 }
 
-/* Allocate a node for the range index tree. */
-static range_index_node_t *
-alloc_range_index_node(range_index_t *ndx,
-                       apr_size_t offset,
-                       apr_size_t limit,
-                       apr_size_t target_offset)
-{
-  range_index_node_t *const node = alloc_block(ndx->pool, &ndx->free_list);
-  node->offset = offset;
-  node->limit = limit;
-  node->target_offset = target_offset;
-  node->left = node->right = NULL;
-  node->prev = node->next = NULL;
-  return node;
-}
-
-/* Free a node from the range index tree. */
+/* Remove all ranges from NDX but keep the memory for reuse. */
 static void
-free_range_index_node(range_index_t *ndx, range_index_node_t *node)
+clear_range_index(range_index_t *ndx)
 {
-  if (node->next)
-    node->next->prev = node->prev;
-  if (node->prev)
-    node->prev->next = node->next;
-  free_block(node, &ndx->free_list);
+  ndx->length = 0;
+  ndx->list_length = 0;
+  ndx->hint = 0;
 }
 
-
-/* Splay the index tree, using OFFSET as the key. */
-
-static void
-splay_range_index(apr_size_t offset, range_index_t *ndx)
+/* Return the index of the last range in NDX whose offset is not larger
+   than OFFSET.  Return -1 if there is no such range. */
+static int
+search_range_index(range_index_t *ndx, apr_size_t offset)
 {
-  range_index_node_t *tree = ndx->tree;
-  range_index_node_t scratch_node;
-  range_index_node_t *left, *right;
+  const range_index_node_t *const nodes = ndx->nodes;
+  int lo = 0;
+  int hi = ndx->length;
 
-  if (tree == NULL)
-    return;
-
-  scratch_node.left = scratch_node.right = NULL;
-  left = right = &scratch_node;
-
-  for (;;)
+  /* Try the previous result and its successor first.  That covers
+     the common case of ascending source copies. */
+  if (ndx->hint < hi)
     {
-      if (offset < tree->offset)
-        {
-          if (tree->left != NULL
-              && offset < tree->left->offset)
-            {
-              /* Right rotation */
-              range_index_node_t *const node = tree->left;
-              tree->left = node->right;
-              node->right = tree;
-              tree = node;
-            }
-          if (tree->left == NULL)
-            break;
-
-          /* Remember the right subtree */
-          right->left = tree;
-          right = tree;
-          tree = tree->left;
-        }
-      else if (offset > tree->offset)
-        {
-          if (tree->right != NULL
-              && offset > tree->right->offset)
-            {
-              /* Left rotation */
-              range_index_node_t *const node = tree->right;
-              tree->right = node->left;
-              node->left = tree;
-              tree = node;
-            }
-          if (tree->right == NULL)
-            break;
-
-          /* Remember the left subtree */
-          left->right = tree;
-          left = tree;
-          tree = tree->right;
-        }
+      if (offset < nodes[ndx->hint].offset)
+        hi = ndx->hint;
+      else if (   ndx->hint + 1 == hi
+               || offset < nodes[ndx->hint + 1].offset)
+        return ndx->hint;
       else
-        break;
+        lo = ndx->hint + 1;
     }
 
-  /* Link in the left and right subtrees */
-  left->right = tree->left;
-  right->left = tree->right;
-  tree->left  = scratch_node.right;
-  tree->right = scratch_node.left;
-
-  /* The basic top-down splay is finished, but we may still need to
-     turn the tree around. What we want is to put the node with the
-     largest offset where node->offset <= offset at the top of the
-     tree, so that we can insert the new data (or search for existing
-     ranges) to the right of the root. This makes cleaning up the
-     tree after an insert much simpler, and -- incidentally -- makes
-     the whole range index magic work. */
-  if (offset < tree->offset && tree->left != NULL)
+  /* Find the first range that starts after OFFSET. */
+  while (lo < hi)
     {
-      if (tree->left->right == NULL)
-        {
-          /* A single right rotation is enough. */
-          range_index_node_t *const node = tree->left;
-          tree->left = node->right; /* Which is always NULL. */
-          node->right = tree;
-          tree = node;
-        }
+      const int mid = lo + (hi - lo) / 2;
+      if (offset < nodes[mid].offset)
+        hi = mid;
       else
-        {
-          /* Slide down to the rightmost node in the left subtree. */
-          range_index_node_t **nodep = &tree->left;
-          while ((*nodep)->right != NULL)
-            nodep = &(*nodep)->right;
-
-          /* Now move this node to root in one giant promotion. */
-          right = tree;
-          left = tree->left;
-          tree = *nodep;
-          *nodep = tree->left;
-          right->left = tree->right; /* Which is always NULL, too. */
-          tree->left = left;
-          tree->right = right;
-        }
+        lo = mid + 1;
+    }
+
+  ndx->hint = lo > 0 ? lo - 1 : 0;
+  return lo - 1;
+}
+
+/* Remove the COUNT ranges starting at index FIRST from NDX. */
+static void
+remove_ranges(range_index_t *ndx, int first, int count)
+{
+  if (count > 0)
+    {
+      memmove(&ndx->nodes[first], &ndx->nodes[first + count],
+              (ndx->length - first - count) * sizeof(*ndx->nodes));
+      ndx->length -= count;
     }
+}
 
-  /* Sanity check ... */
-  assert((offset >= tree->offset)
-         || ((tree->left == NULL)
-             && (tree->prev == NULL)));
-  ndx->tree = tree;
+/* Make room for a new range at index POS in NDX. */
+static void
+open_range_slot(range_index_t *ndx, int pos)
+{
+  ensure_capacity((void **)&ndx->nodes, &ndx->capacity, ndx->length,
+                  ndx->length + 1, sizeof(*ndx->nodes), ndx->pool);
+  memmove(&ndx->nodes[pos + 1], &ndx->nodes[pos],
+          (ndx->length - pos) * sizeof(*ndx->nodes));
+  ++ndx->length;
 }
 
 
-/* Remove all ranges from NDX that fall into the root's range.  To
-   keep the range index as small as possible, we must also remove
-   nodes that don't fall into the new range, but have become redundant
+/* Add a range [OFFSET, LIMIT) into NDX. If NDX already contains a
+   range that encloses [OFFSET, LIMIT), do nothing. Otherwise, remove
+   all ranges from NDX that are superseded by the new range.
+   POS must be the result of search_range_index() for OFFSET.
+
+   To keep the range index as small as possible, we must also remove
+   ranges that don't fall into the new range, but have become redundant
    because the new range overlaps the beginning of the next range.
    Like this:
 
@@ -382,212 +328,136 @@ splay_range_index(apr_size_t offset, range_index_t *ndx)
    range-1, which has become redundant now.
 
    FIXME: But, of course, there's a catch. range-1 must still remain
-   in the tree if we want to optimize the number of target copy ops in
+   in the index if we want to optimize the number of target copy ops in
    the case were a copy falls within range-1, but starts before
    range-2 and ends after new-range. */
 
 static void
-delete_subtree(range_index_t *ndx, range_index_node_t *node)
+insert_range(apr_size_t offset, apr_size_t limit, apr_size_t target_offset,
+             range_index_t *ndx, int pos)
 {
-  if (node != NULL)
+  range_index_node_t *node;
+  int first, last;
+
+  if (pos < 0)
     {
-      delete_subtree(ndx, node->left);
-      delete_subtree(ndx, node->right);
-      free_range_index_node(ndx, node);
+      /* Insert the range in front of all others. */
+      pos = 0;
+      open_range_slot(ndx, pos);
     }
-}
-
-static void
-clean_tree(range_index_t *ndx, apr_size_t limit)
-{
-  apr_size_t top_offset = limit + 1;
-  range_index_node_t **nodep = &ndx->tree->right;
-  while (*nodep != NULL)
+  else
     {
-      range_index_node_t *const node = *nodep;
-      apr_size_t const offset =
-        (node->right != NULL && node->right->offset < top_offset
-         ? node->right->offset
-         : top_offset);
-
-      if (node->limit <= limit
-          || (node->offset < limit && offset < limit))
-        {
-          *nodep = node->right;
-          node->right = NULL;
-          delete_subtree(ndx, node);
-        }
-      else
+      node = &ndx->nodes[pos];
+      if (limit <= node->limit)
+        /* Ignore the range */
+        return;
+
+      if (offset > node->offset)
         {
-          top_offset = node->offset;
-          nodep = &node->left;
+          /* If the next range starts within NODE and extends beyond
+             the new one, both together already cover it. */
+          if (   pos + 1 < ndx->length
+              && node->limit >= ndx->nodes[pos + 1].offset
+              && limit <= ndx->nodes[pos + 1].limit)
+            /* Ignore the range */
+            return;
+
+          /* Unless NODE is covered by its predecessor and the new
+             range, insert the new range after NODE. */
+          if (pos == 0 || ndx->nodes[pos - 1].limit <= offset)
+            open_range_slot(ndx, ++pos);
         }
     }
-}
 
+  /* Put the new data into its slot, potentially replacing a range
+     that has become redundant. */
+  node = &ndx->nodes[pos];
+  node->offset = offset;
+  node->limit = limit;
+  node->target_offset = target_offset;
 
-/* Add a range [OFFSET, LIMIT) into NDX. If NDX already contains a
-   range that encloses [OFFSET, LIMIT), do nothing. Otherwise, remove
-   all ranges from NDX that are superseded by the new range.
-   NOTE: The range index must be splayed to OFFSET! */
-
-static void
-insert_range(apr_size_t offset, apr_size_t limit, apr_size_t target_offset,
-             range_index_t *ndx)
-{
-  range_index_node_t *node = NULL;
-
-  if (ndx->tree == NULL)
-    {
-      node = alloc_range_index_node(ndx, offset, limit, target_offset);
-      ndx->tree = node;
-    }
-  else
+  /* Remove the ranges that the new one supersedes.  Since the limits
+     are sorted, these form a contiguous block after the new range. */
+  first = pos + 1;
+  for (last = first; last < ndx->length; ++last)
     {
-      if (offset == ndx->tree->offset
-          && limit > ndx->tree->limit)
-        {
-          ndx->tree->limit = limit;
-          ndx->tree->target_offset = target_offset;
-          clean_tree(ndx, limit);
-        }
-      else if (offset > ndx->tree->offset
-               && limit > ndx->tree->limit)
-        {
-          /* We have to make the same sort of checks as clean_tree()
-             does for superseded ranges. Have to merge these someday. */
+      const range_index_node_t *const next = &ndx->nodes[last];
+      if (next->limit <= limit)
+        continue;
 
-          const svn_boolean_t insert_range_p =
-            (!ndx->tree->next
-             || ndx->tree->limit < ndx->tree->next->offset
-             || limit > ndx->tree->next->limit);
+      if (   next->offset < limit
+          && last + 1 < ndx->length
+          && ndx->nodes[last + 1].offset < limit)
+        continue;
 
-          if (insert_range_p)
-            {
-              /* Again, we have to check if the new node and the one
-                 to the left of the root override root's range. */
-              if (ndx->tree->prev && ndx->tree->prev->limit > offset)
-                {
-                  /* Replace the data in the splayed node. */
-                  ndx->tree->offset = offset;
-                  ndx->tree->limit = limit;
-                  ndx->tree->target_offset = target_offset;
-                }
-              else
-                {
-                  /* Insert the range to the right of the splayed node. */
-                  node = alloc_range_index_node(ndx, offset, limit,
-                                                target_offset);
-                  if ((node->next = ndx->tree->next) != NULL)
-                    node->next->prev = node;
-                  ndx->tree->next = node;
-                  node->prev = ndx->tree;
-
-                  node->right = ndx->tree->right;
-                  ndx->tree->right = NULL;
-                  node->left = ndx->tree;
-                  ndx->tree = node;
-                }
-              clean_tree(ndx, limit);
-            }
-          else
-            /* Ignore the range */;
-        }
-      else if (offset < ndx->tree->offset)
-        {
-          assert(ndx->tree->left == NULL);
-
-          /* Insert the range left of the splayed node */
-          node = alloc_range_index_node(ndx, offset, limit, target_offset);
-          node->left = node->prev = NULL;
-          node->right = node->next = ndx->tree;
-          ndx->tree = node->next->prev = node;
-          clean_tree(ndx, limit);
-        }
-      else
-        /* Ignore the range */;
+      break;
     }
+
+  remove_ranges(ndx, first, last - first);
 }
 
 
-
+
 /* ==================================================================== */
 /* Juggling with lists of ranges. */
 
-/* Allocate a node and add it to the range list. LIST is the head of
-   the range list, TAIL is the last node in the list. NDX holds the
-   freelist; OFFSET, LIMIT and KIND are node data. */
-static range_list_node_t *
-alloc_range_list(range_list_node_t **list,
-                 range_list_node_t **tail,
-                 range_index_t *ndx,
-                 enum range_kind kind,
-                 apr_size_t offset,
-                 apr_size_t limit,
-                 apr_size_t target_offset)
+/* Append a node to the range list in NDX. KIND, OFFSET, LIMIT and
+   TARGET_OFFSET are node data. */
+static void
+append_range(range_index_t *ndx,
+             enum range_kind kind,
+             apr_size_t offset,
+             apr_size_t limit,
+             apr_size_t target_offset)
 {
-  range_list_node_t *const node = alloc_block(ndx->pool, &ndx->free_list);
+  range_list_node_t *node;
+
+  ensure_capacity((void **)&ndx->list, &ndx->list_capacity,
+                  ndx->list_length, ndx->list_length + 1,
+                  sizeof(*ndx->list), ndx->pool);
+
+  node = &ndx->list[ndx->list_length++];
   node->kind = kind;
   node->offset = offset;
   node->limit = limit;
   node->target_offset = target_offset;
-  if (*list == NULL)
-    {
-      node->prev = node->next = NULL;
-      *list = *tail = node;
-    }
-  else
-    {
-      node->prev = *tail;
-      node->next = NULL;
-      (*tail)->next = node;
-      *tail = node;
-    }
-  return *list;
-}
-
-/* Free a range list. LIST is the head of the list, NDX holds the freelist. */
-static void
-free_range_list(range_list_node_t *list, range_index_t *ndx)
-{
-  while (list)
-    {
-      range_list_node_t *const node = list;
-      list = node->next;
-      free_block(node, &ndx->free_list);
-    }
 }
 
 
 /* Based on the data in NDX, build a list of ranges that cover
-   [OFFSET, LIMIT) in the "virtual" source data.
-   NOTE: The range index must be splayed to OFFSET! */
+   [OFFSET, LIMIT) in the "virtual" source data and store it in
+   NDX->LIST.  POS must be the result of search_range_index() for
+   OFFSET. */
 
-static range_list_node_t *
-build_range_list(apr_size_t offset, apr_size_t limit, range_index_t *ndx)
+static void
+build_range_list(apr_size_t offset, apr_size_t limit, range_index_t *ndx,
+                 int pos)
 {
-  range_list_node_t *range_list = NULL;
-  range_list_node_t *last_range = NULL;
-  range_index_node_t *node = ndx->tree;
+  int i = pos < 0 ? 0 : pos;
 
+  ndx->list_length = 0;
   while (offset < limit)
     {
-      if (node == NULL)
-        return alloc_range_list(&range_list, &last_range, ndx,
-                                range_from_source,
-                                offset, limit, 0);
+      const range_index_node_t *node;
 
+      if (i >= ndx->length)
+        {
+          append_range(ndx, range_from_source, offset, limit, 0);
+          return;
+        }
+
+      node = &ndx->nodes[i];
       if (offset < node->offset)
         {
           if (limit <= node->offset)
-            return alloc_range_list(&range_list, &last_range, ndx,
-                                    range_from_source,
-                                    offset, limit, 0);
+            {
+              append_range(ndx, range_from_source, offset, limit, 0);
+              return;
+            }
           else
             {
-              alloc_range_list(&range_list, &last_range, ndx,
-                               range_from_source,
-                               offset, node->offset, 0);
+              append_range(ndx, range_from_source,
+                           offset, node->offset, 0);
               offset = node->offset;
             }
         }
@@ -600,23 +470,24 @@ build_range_list(apr_size_t offset, apr_size_t limit, range_index_t *ndx)
              uses vdelta). */
 
           if (offset >= node->limit)
-            node = node->next;
+            ++i;
           else
             {
               const apr_size_t target_offset =
                 offset - node->offset + node->target_offset;
 
               if (limit <= node->limit)
-                return alloc_range_list(&range_list, &last_range, ndx,
-                                        range_from_target,
-                                        offset, limit, target_offset);
+                {
+                  append_range(ndx, range_from_target,
+                               offset, limit, target_offset);
+                  return;
+                }
               else
                 {
-                  alloc_range_list(&range_list, &last_range, ndx,
-                                   range_from_target,
-                                   offset, node->limit, target_offset);
+                  append_range(ndx, range_from_target,
+                               offset, node->limit, target_offset);
                   offset = node->limit;
-                  node = node->next;
+                  ++i;
                 }
             }
         }
@@ -760,19 +631,24 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
 /* Bringing it all together. */
 
 
-svn_txdelta_window_t *
-svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
-                            const svn_txdelta_window_t *window_B,
-                            apr_pool_t *pool)
+/* Compose WINDOW_A and WINDOW_B and return the result allocated in
+   POOL.  OFFSET_INDEX and RANGE_INDEX are scratch structures that may
+   be reused for further compositions. */
+static svn_txdelta_window_t *
+compose_windows(const svn_txdelta_window_t *window_A,
+                const svn_txdelta_window_t *window_B,
+                offset_index_t *offset_index,
+                range_index_t *range_index,
+                apr_pool_t *pool)
 {
   svn_txdelta__ops_baton_t build_baton = { 0 };
   svn_txdelta_window_t *composite;
-  apr_pool_t *subpool = svn_pool_create(pool);
-  offset_index_t *offset_index = create_offset_index(window_A, subpool);
-  range_index_t *range_index = create_range_index(subpool);
   apr_size_t target_offset = 0;
   int i;
 
+  fill_offset_index(offset_index, window_A);
+  clear_range_index(range_index);
+
   /* Read the description of the delta composition algorithm in
      notes/fs-improvements.txt before going any further.
      You have been warned. */
@@ -799,13 +675,15 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
              same as window_A's _target_ stream! */
           const apr_size_t offset = op->offset;
           const apr_size_t limit = op->offset + op->length;
-          range_list_node_t *range_list, *range;
+          const range_list_node_t *range, *end;
           apr_size_t tgt_off = target_offset;
+          int pos;
 
-          splay_range_index(offset, range_index);
-          range_list = build_range_list(offset, limit, range_index);
+          pos = search_range_index(range_index, offset);
+          build_range_list(offset, limit, range_index, pos);
 
-          for (range = range_list; range; range = range->next)
+          end = range_index->list + range_index->list_length;
+          for (range = range_index->list; range != end; ++range)
             {
               if (range->kind == range_from_target)
                 svn_txdelta__insert_op(&build_baton, svn_txdelta_target,
@@ -821,19 +699,99 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
             }
           assert(tgt_off == target_offset + op->length);
 
-          free_range_list(range_list, range_index);
-          insert_range(offset, limit, target_offset, range_index);
+          insert_range(offset, limit, target_offset, range_index, pos);
         }
 
       /* Remember the new offset in the would-be target stream. */
       target_offset += op->length;
     }
 
-  svn_pool_destroy(subpool);
-
   composite = svn_txdelta__make_window(&build_baton, pool);
   composite->sview_offset = window_A->sview_offset;
   composite->sview_len = window_A->sview_len;
   composite->tview_len = window_B->tview_len;
   return composite;
 }
+
+svn_txdelta_window_t *
+svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
+                            const svn_txdelta_window_t *window_B,
+                            apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_txdelta_window_t *composite
+    = compose_windows(window_A, window_B, create_offset_index(subpool),
+                      create_range_index(subpool), pool);
+
+  svn_pool_destroy(subpool);
+  return composite;
+}
+
+svn_txdelta_window_t *
+svn_txdelta__compose_windows_n(const apr_array_header_t *windows,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  const svn_txdelta_window_t *composite;
+  const svn_txdelta_window_t *first;
+  svn_txdelta_window_t *result = NULL;
+  offset_index_t *offset_index;
+  range_index_t *range_index;
+  apr_pool_t *window_pools[2];
+  int current = 0;
+  int i;
+
+  SVN_ERR_ASSERT_NO_RETURN(windows->nelts > 0);
+
+  first = APR_ARRAY_IDX(windows, 0, const svn_txdelta_window_t *);
+  composite = APR_ARRAY_IDX(windows, windows->nelts - 1,
+                            const svn_txdelta_window_t *);
+
+  offset_index = create_offset_index(scratch_pool);
+  range_index = create_range_index(scratch_pool);
+  window_pools[0] = svn_pool_create(scratch_pool);
+  window_pools[1] = svn_pool_create(scratch_pool);
+
+  /* Fold the chain from the newest window towards the oldest one.  All
+     compositions share the same index structures and the intermediate
+     results alternate between two pools, so the memory footprint does
+     not grow with the chain length. */
+  for (i = windows->nelts - 2; i >= 0; --i)
+    {
+      const svn_txdelta_window_t *window
+        = APR_ARRAY_IDX(windows, i, const svn_txdelta_window_t *);
+      apr_pool_t *pool;
+
+      /* Once the composite does not copy from its source anymore,
+         the remaining windows cannot contribute anything. */
+      if (composite->src_ops == 0)
+        break;
+
+      if (i == 0)
+        {
+          result = compose_windows(window, composite, offset_index,
+                                   range_index, result_pool);
+        }
+      else
+        {
+          pool = window_pools[current];
+          svn_pool_clear(pool);
+          current = 1 - current;
+
+          composite = compose_windows(window, composite, offset_index,
+                                      range_index, pool);
+        }
+    }
+
+  if (result == NULL)
+    {
+      result = svn_txdelta_window_dup(composite, result_pool);
+      result->sview_offset = first->sview_offset;
+      result->sview_len = first->sview_len;
+    }
+
+  svn_pool_destroy(window_pools[0]);
+  svn_pool_destroy(window_pools[1]);
+
+  return result;
+}
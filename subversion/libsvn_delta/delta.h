@@ -44,6 +44,16 @@ extern "C" {
 
 #define SVN_DELTA_WINDOW_SIZE 102400
 
+/* The maximum target view size of svndiff version 3 windows. */
+
+#define SVN_DELTA_LARGE_WINDOW_SIZE (1024 * 1024)
+
+/* The maximum source view size of svndiff version 3 windows.  Since those
+   source views slide along with the matching source data, they are wider
+   than the target views to also catch data that has been moved around. */
+
+#define SVN_DELTA_LARGE_SOURCE_VIEW_SIZE (4 * SVN_DELTA_LARGE_WINDOW_SIZE)
+
 
 /* Context/baton for building an operation sequence. */
 
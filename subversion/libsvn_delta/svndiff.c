@@ -35,17 +35,24 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_task.h"
 
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
+static const char SVNDIFF_V4[] = { 'S', 'V', 'N', 4 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 4)
+    return SVNDIFF_V4;
+  else if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -63,16 +70,54 @@ struct encoder_baton {
   svn_boolean_t header_done;
   int version;
   int compression_level;
+  /* Dictionary to compress version 4 data against.  May be NULL. */
+  const svn__zstd_dict_t *dict;
   /* Pool for temporary allocations, will be cleared periodically. */
   apr_pool_t *scratch_pool;
+
+  /* Number of threads encoding windows in parallel.  Only used by
+     parallel_window_handler(). */
+  int thread_count;
+  /* Copies of the windows (svn_txdelta_window_t *) that have not been
+     encoded yet.  Only used by parallel_window_handler(). */
+  apr_array_header_t *pending;
+  /* Pool containing the PENDING windows, will be cleared after each
+     batch. */
+  apr_pool_t *pending_pool;
 };
 
+/* Number of windows per thread that parallel_window_handler() collects
+   before encoding them as a batch.  More windows mean less thread
+   synchronization but require more memory. */
+#define WINDOWS_PER_THREAD 4
+
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
-/* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
-   1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+
+/* Return the maximum target view size permitted in svndiff VERSION. */
+static apr_size_t
+max_tview_len(int version)
+{
+  return version == 3 ? SVN_DELTA_LARGE_WINDOW_SIZE : SVN_DELTA_WINDOW_SIZE;
+}
+
+/* Return the maximum source view size permitted in svndiff VERSION. */
+static apr_size_t
+max_sview_len(int version)
+{
+  return version == 3 ? SVN_DELTA_LARGE_SOURCE_VIEW_SIZE
+                      : SVN_DELTA_WINDOW_SIZE;
+}
+
+/* Return a value at least as big as the largest possible instructions
+   section in svndiff VERSION: in theory, the instructions could be
+   max_tview_len() 1-byte copy-from-source instructions (though this is
+   very unlikely). */
+static apr_size_t
+max_instruction_section_len(int version)
+{
+  return max_tview_len(version) * MAX_INSTRUCTION_LEN;
+}
 
 
 /* Append an encoded integer to a string.  */
@@ -150,9 +195,26 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
   return SVN_NO_ERROR;
 }
 
+/* Compress LEN bytes of DATA for svndiff version 4 into OUT, using DICT
+   if that is not NULL and COMPRESSION_LEVEL otherwise. */
+static svn_error_t *
+compress_zstd_section(const void *data,
+                      apr_size_t len,
+                      svn_stringbuf_t *out,
+                      int compression_level,
+                      const svn__zstd_dict_t *dict)
+{
+  if (dict)
+    return svn_error_trace(svn__compress_zstd_dict(data, len, out, dict));
+
+  return svn_error_trace(svn__compress_zstd(data, len, out,
+                                            compression_level));
+}
+
 /* Encodes delta window WINDOW to svndiff-format.
    The svndiff version is VERSION. COMPRESSION_LEVEL is the
-   compression level to use.
+   compression level to use.  DICT is the optional zstd dictionary
+   to use with VERSION 4.
    Returned values will be allocated in POOL or refer to *WINDOW
    fields. */
 static svn_error_t *
@@ -162,6 +224,7 @@ encode_window(svn_stringbuf_t **instructions_p,
               svn_txdelta_window_t *window,
               int version,
               int compression_level,
+              const svn__zstd_dict_t *dict,
               apr_pool_t *pool)
 {
   svn_stringbuf_t *instructions;
@@ -198,7 +261,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version == 4)
+    {
+      svn_stringbuf_t *compressed_instructions;
+      compressed_instructions = svn_stringbuf_create_empty(pool);
+      SVN_ERR(compress_zstd_section(instructions->data, instructions->len,
+                                    compressed_instructions,
+                                    compression_level, dict));
+      instructions = compressed_instructions;
+    }
+  else if (version == 2 || version == 3)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +289,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version == 4)
+    {
+      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(compress_zstd_section(window->new_data->data,
+                                    window->new_data->len,
+                                    compressed, compression_level, dict));
+      newdata = svn_stringbuf__morph_into_string(compressed);
+    }
+  else if (version == 2 || version == 3)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -245,6 +326,32 @@ encode_window(svn_stringbuf_t **instructions_p,
   return SVN_NO_ERROR;
 }
 
+/* Write the window HEADER, INSTRUCTIONS and NEWDATA as returned by
+   encode_window() to the output stream in EB. */
+static svn_error_t *
+write_encoded_window(struct encoder_baton *eb,
+                     const svn_stringbuf_t *header,
+                     const svn_stringbuf_t *instructions,
+                     const svn_string_t *newdata)
+{
+  apr_size_t len;
+
+  len = header->len;
+  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
+  if (instructions->len > 0)
+    {
+      len = instructions->len;
+      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
+    }
+  if (newdata->len > 0)
+    {
+      len = newdata->len;
+      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Note: When changing things here, check the related comment in
    the svn_txdelta_to_svndiff_stream() function.  */
 static svn_error_t *
@@ -282,21 +389,105 @@ window_handler(svn_txdelta_window_t *window, void *baton)
   svn_pool_clear(eb->scratch_pool);
 
   SVN_ERR(encode_window(&instructions, &header, &newdata, window,
-                        eb->version, eb->compression_level,
+                        eb->version, eb->compression_level, eb->dict,
                         eb->scratch_pool));
 
   /* Write out the window.  */
-  len = header->len;
-  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
-  if (instructions->len > 0)
+  return svn_error_trace(write_encoded_window(eb, header, instructions,
+                                              newdata));
+}
+
+/* Result of encode_window_task(). */
+typedef struct encoded_window_t
+{
+  svn_stringbuf_t *header;
+  svn_stringbuf_t *instructions;
+  const svn_string_t *newdata;
+} encoded_window_t;
+
+/* Implements svn_task__process_func_t.  Encode the pending window number
+   INDEX from struct encoder_baton *BATON and return it as an
+   encoded_window_t.  This only reads from BATON and may therefore run in
+   any thread. */
+static svn_error_t *
+encode_window_task(void **result,
+                   void *baton,
+                   void *thread_context,
+                   apr_int64_t index,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  struct encoder_baton *eb = baton;
+  svn_txdelta_window_t *window
+    = APR_ARRAY_IDX(eb->pending, (int)index, svn_txdelta_window_t *);
+  encoded_window_t *encoded = apr_palloc(result_pool, sizeof(*encoded));
+
+  SVN_ERR(encode_window(&encoded->instructions, &encoded->header,
+                        &encoded->newdata, window, eb->version,
+                        eb->compression_level, eb->dict, result_pool));
+
+  *result = encoded;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Write the encoded_window_t *RESULT
+   to the output of struct encoder_baton *BATON. */
+static svn_error_t *
+write_window_task(void *baton,
+                  void *result,
+                  apr_int64_t index,
+                  apr_pool_t *scratch_pool)
+{
+  encoded_window_t *encoded = result;
+
+  return svn_error_trace(write_encoded_window(baton, encoded->header,
+                                              encoded->instructions,
+                                              encoded->newdata));
+}
+
+/* Like window_handler() but collect the windows and encode them in
+   batches, using multiple threads.  The output is the same. */
+static svn_error_t *
+parallel_window_handler(svn_txdelta_window_t *window, void *baton)
+{
+  struct encoder_baton *eb = baton;
+
+  /* Make sure we write the header.  */
+  if (!eb->header_done)
     {
-      len = instructions->len;
-      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
+      apr_size_t len = SVNDIFF_HEADER_SIZE;
+      SVN_ERR(svn_stream_write(eb->output, get_svndiff_header(eb->version),
+                               &len));
+      eb->header_done = TRUE;
     }
-  if (newdata->len > 0)
+
+  /* The caller may reuse WINDOW after we return, so we need a copy. */
+  if (window)
     {
-      len = newdata->len;
-      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
+      APR_ARRAY_PUSH(eb->pending, svn_txdelta_window_t *)
+        = svn_txdelta_window_dup(window, eb->pending_pool);
+      if (eb->pending->nelts < eb->thread_count * WINDOWS_PER_THREAD)
+        return SVN_NO_ERROR;
+    }
+
+  /* Encode and write the current batch. */
+  svn_pool_clear(eb->scratch_pool);
+  if (eb->pending->nelts)
+    SVN_ERR(svn_task__run_ordered(eb->pending->nelts, eb->thread_count,
+                                  encode_window_task, eb, NULL, NULL,
+                                  write_window_task, eb, NULL, NULL,
+                                  eb->scratch_pool));
+
+  apr_array_clear(eb->pending);
+  svn_pool_clear(eb->pending_pool);
+
+  if (window == NULL)
+    {
+      /* We're done; clean up. */
+      SVN_ERR(svn_stream_close(eb->output));
+
+      svn_pool_destroy(eb->scratch_pool);
+      svn_pool_destroy(eb->pending_pool);
     }
 
   return SVN_NO_ERROR;
@@ -309,6 +500,21 @@ svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
                         int svndiff_version,
                         int compression_level,
                         apr_pool_t *pool)
+{
+  svn_txdelta__to_svndiff_parallel(handler, handler_baton, output,
+                                   svndiff_version, compression_level,
+                                   NULL, 1, pool);
+}
+
+void
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 const svn__zstd_dict_t *dict,
+                                 int thread_count,
+                                 apr_pool_t *pool)
 {
   struct encoder_baton *eb;
 
@@ -318,8 +524,24 @@ svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
   eb->scratch_pool = svn_pool_create(pool);
   eb->version = svndiff_version;
   eb->compression_level = compression_level;
+  eb->dict = svndiff_version == 4 ? dict : NULL;
+  eb->thread_count = thread_count;
+
+  /* Uncompressed windows are cheap to encode, so threads won't help. */
+  if (thread_count > 1 && svndiff_version != 0)
+    {
+      eb->pending = apr_array_make(pool, thread_count * WINDOWS_PER_THREAD,
+                                   sizeof(svn_txdelta_window_t *));
+      eb->pending_pool = svn_pool_create(pool);
+      *handler = parallel_window_handler;
+    }
+  else
+    {
+      eb->pending = NULL;
+      eb->pending_pool = NULL;
+      *handler = window_handler;
+    }
 
-  *handler = window_handler;
   *handler_baton = eb;
 }
 
@@ -542,16 +764,47 @@ count_and_verify_instructions(int *ninst,
   return SVN_NO_ERROR;
 }
 
+/* Decompress the svndiff version 4 section of LEN bytes at DATA into OUT,
+   limiting the result to LIMIT bytes.  If the section has been compressed
+   against a dictionary, get it from DICT_FUNC and DICT_BATON.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+decompress_zstd_section(const void *data,
+                        apr_size_t len,
+                        svn_stringbuf_t *out,
+                        apr_size_t limit,
+                        svn_txdelta__dict_func_t dict_func,
+                        void *dict_baton,
+                        apr_pool_t *scratch_pool)
+{
+  apr_uint32_t dict_id = svn__zstd_get_dict_id(data, len);
+  const svn__zstd_dict_t *dict;
+
+  if (dict_id == 0)
+    return svn_error_trace(svn__decompress_zstd(data, len, out, limit));
+
+  if (dict_func == NULL)
+    return svn_error_createf(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                             _("Svndiff data requires unknown compression "
+                               "dictionary %u"), (unsigned int)dict_id);
+
+  SVN_ERR(dict_func(&dict, dict_baton, dict_id, scratch_pool));
+  return svn_error_trace(svn__decompress_zstd_dict(data, len, out, limit,
+                                                   dict));
+}
+
 /* Given the five integer fields of a window header and a pointer to
    the remainder of the window contents, fill in a delta window
    structure *WINDOW.  New allocations will be performed in POOL;
    the new_data field of *WINDOW will refer directly to memory pointed
-   to by DATA. */
+   to by DATA.  DICT_FUNC and DICT_BATON are used to find the zstd
+   dictionaries for version 4 data; DICT_FUNC may be NULL. */
 static svn_error_t *
 decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
               apr_size_t sview_len, apr_size_t tview_len, apr_size_t inslen,
               apr_size_t newlen, const unsigned char *data, apr_pool_t *pool,
-              unsigned int version)
+              unsigned int version,
+              svn_txdelta__dict_func_t dict_func, void *dict_baton)
 {
   const unsigned char *insend;
   int ninst;
@@ -565,15 +818,33 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version == 4)
+    {
+      svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(decompress_zstd_section(insend, newlen, ndout,
+                                      max_tview_len(version),
+                                      dict_func, dict_baton, pool));
+      SVN_ERR(decompress_zstd_section(data, insend - data, instout,
+                                      max_instruction_section_len(version),
+                                      dict_func, dict_baton, pool));
+
+      newlen = ndout->len;
+      data = (unsigned char *)instout->data;
+      insend = (unsigned char *)instout->data + instout->len;
+
+      new_data = svn_stringbuf__morph_into_string(ndout);
+    }
+  else if (version == 2 || version == 3)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
+                                  max_tview_len(version)));
       SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  max_instruction_section_len(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -589,7 +860,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
                                    SVN_DELTA_WINDOW_SIZE));
       SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   max_instruction_section_len(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -653,6 +924,10 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
+      else if (memcmp(buffer, SVNDIFF_V4 + db->header_bytes, nheader) == 0)
+        db->version = 4;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -710,11 +985,12 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
+          if (tview_len > max_tview_len(db->version) ||
+              sview_len > max_sview_len(db->version) ||
               /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              newlen > (max_tview_len(db->version)
+                        + SVN__MAX_ENCODED_UINT_LEN) ||
+              inslen > max_instruction_section_len(db->version))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -758,7 +1034,7 @@ write_handler(void *baton,
       /* Decode the window and send it off. */
       SVN_ERR(decode_window(&window, db->sview_offset, db->sview_len,
                             db->tview_len, db->inslen, db->newlen, p,
-                            db->subpool, db->version));
+                            db->subpool, db->version, NULL, NULL));
       SVN_ERR(db->consumer_func(&window, db->consumer_baton));
 
       p += db->inslen + db->newlen;
@@ -894,12 +1170,13 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow
+   as well as for the size limits of svndiff VERSION. */
 static svn_error_t *
 read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
-                   apr_size_t *header_len)
+                   apr_size_t *header_len, int version)
 {
   unsigned char c;
 
@@ -921,11 +1198,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_tview_len(version) ||
+      *sview_len > max_sview_len(version) ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_tview_len(version) + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > max_instruction_section_len(version))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -944,13 +1221,26 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
                                 svn_stream_t *stream,
                                 int svndiff_version,
                                 apr_pool_t *pool)
+{
+  return svn_error_trace(svn_txdelta__read_svndiff_window_dict(
+                           window, stream, svndiff_version, NULL, NULL,
+                           pool));
+}
+
+svn_error_t *
+svn_txdelta__read_svndiff_window_dict(svn_txdelta_window_t **window,
+                                      svn_stream_t *stream,
+                                      int svndiff_version,
+                                      svn_txdelta__dict_func_t dict_func,
+                                      void *dict_baton,
+                                      apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, len, header_len;
   unsigned char *buf;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len, svndiff_version));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
@@ -959,7 +1249,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
                             _("Unexpected end of svndiff input"));
   *window = apr_palloc(pool, sizeof(**window));
   return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
-                       newlen, buf, pool, svndiff_version);
+                       newlen, buf, pool, svndiff_version,
+                       dict_func, dict_baton);
 }
 
 
@@ -974,7 +1265,7 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_off_t offset;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len, svndiff_version));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -984,17 +1275,64 @@ svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool)
+{
+  apr_size_t sview_len;
+
+  return svn_error_trace(svn_txdelta__read_raw_window_header(window_len,
+                                                             &sview_len,
+                                                             stream, pool));
+}
+
+svn_error_t *
+svn_txdelta__read_raw_window_header(apr_size_t *window_len,
+                                    apr_size_t *sview_len,
+                                    svn_stream_t *stream,
+                                    apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
-  apr_size_t sview_len, tview_len, inslen, newlen, header_len;
+  apr_size_t tview_len, inslen, newlen, header_len;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+  /* We don't know the svndiff version here, so apply the most lenient
+     size limits.  The window will be checked again when being parsed. */
+  SVN_ERR(read_window_header(stream, &sview_offset, sview_len, &tview_len,
+                             &inslen, &newlen, &header_len, 3));
 
   *window_len = inslen + newlen + header_len;
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_txdelta__svndiff_window_dict_ids(apr_uint32_t *ins_dict_id,
+                                     apr_uint32_t *new_dict_id,
+                                     const svn_string_t *raw_window,
+                                     int svndiff_version,
+                                     apr_pool_t *scratch_pool)
+{
+  svn_filesize_t sview_offset;
+  apr_size_t sview_len, tview_len, inslen, newlen, header_len;
+  const char *data;
+
+  *ins_dict_id = 0;
+  *new_dict_id = 0;
+  if (svndiff_version != 4)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(read_window_header(svn_stream_from_string(raw_window,
+                                                    scratch_pool),
+                             &sview_offset, &sview_len, &tview_len,
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
+  if (raw_window->len - header_len < inslen + newlen)
+    return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                            _("Unexpected end of svndiff input"));
+
+  data = raw_window->data + header_len;
+  *ins_dict_id = svn__zstd_get_dict_id(data, inslen);
+  *new_dict_id = svn__zstd_get_dict_id(data + inslen, newlen);
+
+  return SVN_NO_ERROR;
+}
+
 typedef struct svndiff_stream_baton_t
 {
   apr_pool_t *scratch_pool;
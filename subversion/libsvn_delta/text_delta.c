@@ -33,8 +33,12 @@
 #include "svn_pools.h"
 #include "svn_checksum.h"
 
+#include "private/svn_delta_private.h"
+
 #include "delta.h"
 
+#include "svn_private_config.h"
+
 
 /* Text delta stream descriptor. */
 
@@ -83,6 +87,38 @@ struct tpush_baton {
 };
 
 
+/* Target-push stream descriptor for source views sliding along with the
+   matching source data. */
+
+struct sliding_baton {
+  /* These are copied from parameters passed to
+     svn_txdelta__target_push_sliding. */
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  apr_pool_t *pool;
+
+  /* Private data.  BUF contains the SOURCE_LEN bytes of the current source
+     view, starting at SOURCE_OFFSET, followed by space for the target data.
+     The read pointer of SOURCE is always at SOURCE_OFFSET + SOURCE_LEN. */
+  char *buf;
+  svn_filesize_t source_offset;
+  apr_size_t source_len;
+  svn_boolean_t source_done;
+
+  /* Target data collected for the next window, starting at TARGET_OFFSET
+     within the target text. */
+  char *tbuf;
+  apr_size_t target_len;
+  svn_filesize_t target_offset;
+
+  /* Offset in SOURCE minus offset in the target text for the last source
+     copy that we found.  Used to predict where to look for the next
+     matches. */
+  svn_filesize_t drift;
+};
+
+
 /* Text delta applicator.  */
 
 struct apply_baton {
@@ -603,6 +639,176 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
 
 
 
+/* Functions for implementing a "target push" delta with sliding source
+   views. */
+
+/* Move the source view in SB to START, which must not be less than the
+   current view's offset, and fill it with as much source data as
+   possible. */
+static svn_error_t *
+slide_source_view(struct sliding_baton *sb, svn_filesize_t start)
+{
+  svn_filesize_t end = sb->source_offset + sb->source_len;
+
+  if (start >= end)
+    {
+      /* No overlap with the current view.  Skip the gap. */
+      svn_filesize_t gap = start - end;
+      while (gap > 0 && !sb->source_done)
+        {
+          apr_size_t chunk = gap > SVN_DELTA_LARGE_SOURCE_VIEW_SIZE
+                           ? SVN_DELTA_LARGE_SOURCE_VIEW_SIZE
+                           : (apr_size_t)gap;
+          SVN_ERR(svn_stream_skip(sb->source, chunk));
+          gap -= chunk;
+        }
+
+      sb->source_len = 0;
+    }
+  else
+    {
+      /* Keep the overlapping part. */
+      apr_size_t discard = (apr_size_t)(start - sb->source_offset);
+      memmove(sb->buf, sb->buf + discard, sb->source_len - discard);
+      sb->source_len -= discard;
+    }
+
+  sb->source_offset = start;
+
+  if (!sb->source_done && sb->source_len < SVN_DELTA_LARGE_SOURCE_VIEW_SIZE)
+    {
+      apr_size_t len = SVN_DELTA_LARGE_SOURCE_VIEW_SIZE - sb->source_len;
+      apr_size_t requested = len;
+
+      SVN_ERR(svn_stream_read_full(sb->source, sb->buf + sb->source_len,
+                                   &len));
+      sb->source_len += len;
+      sb->source_done = len < requested;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Compute a window for the target data buffered in SB, send it to the
+   window handler and reset the target buffer.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+send_sliding_window(struct sliding_baton *sb,
+                    apr_pool_t *scratch_pool)
+{
+  svn_txdelta_window_t *window;
+  svn_filesize_t start;
+  apr_size_t tpos;
+  int i;
+
+  /* Center the source view around the data that we expect to match the
+     target data, i.e. just continue where the last match left off. */
+  start = sb->target_offset + sb->drift
+        - (SVN_DELTA_LARGE_SOURCE_VIEW_SIZE - sb->target_len) / 2;
+  if (start < sb->source_offset)
+    start = sb->source_offset;
+
+  SVN_ERR(slide_source_view(sb, start));
+
+  memcpy(sb->buf + sb->source_len, sb->tbuf, sb->target_len);
+  window = compute_window(sb->buf, sb->source_len, sb->target_len,
+                          sb->source_offset, scratch_pool);
+
+  /* Remember the drift of the last source copy. */
+  for (i = 0, tpos = 0; i < window->num_ops; ++i)
+    {
+      const svn_txdelta_op_t *op = &window->ops[i];
+      if (op->action_code == svn_txdelta_source)
+        sb->drift = (sb->source_offset + (svn_filesize_t)op->offset)
+                  - (sb->target_offset + (svn_filesize_t)tpos);
+
+      tpos += op->length;
+    }
+
+  SVN_ERR(sb->wh(window, sb->whb));
+
+  sb->target_offset += sb->target_len;
+  sb->target_len = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* This is the write handler for a sliding target-push delta stream.  It
+ * buffers target data and fires off delta windows when the target data
+ * buffer is full. */
+static svn_error_t *
+sliding_write_handler(void *baton, const char *data, apr_size_t *len)
+{
+  struct sliding_baton *sb = baton;
+  apr_size_t chunk_len, data_len = *len;
+  apr_pool_t *pool = svn_pool_create(sb->pool);
+
+  while (data_len > 0)
+    {
+      svn_pool_clear(pool);
+
+      /* Copy in the target data, up to SVN_DELTA_LARGE_WINDOW_SIZE. */
+      chunk_len = SVN_DELTA_LARGE_WINDOW_SIZE - sb->target_len;
+      if (chunk_len > data_len)
+        chunk_len = data_len;
+      memcpy(sb->tbuf + sb->target_len, data, chunk_len);
+      data += chunk_len;
+      data_len -= chunk_len;
+      sb->target_len += chunk_len;
+
+      /* If we're full of target data, compute and fire off a window. */
+      if (sb->target_len == SVN_DELTA_LARGE_WINDOW_SIZE)
+        SVN_ERR(send_sliding_window(sb, pool));
+    }
+
+  svn_pool_destroy(pool);
+  return SVN_NO_ERROR;
+}
+
+/* This is the close handler for a sliding target-push delta stream.  It
+ * sends a final window if there is any buffered target data, and then
+ * sends a NULL window signifying the end of the window stream. */
+static svn_error_t *
+sliding_close_handler(void *baton)
+{
+  struct sliding_baton *sb = baton;
+
+  /* Send a final window if we have any residual target data. */
+  if (sb->target_len > 0)
+    SVN_ERR(send_sliding_window(sb, sb->pool));
+
+  /* Send a final NULL window signifying the end. */
+  return sb->wh(NULL, sb->whb);
+}
+
+svn_stream_t *
+svn_txdelta__target_push_sliding(svn_txdelta_window_handler_t handler,
+                                 void *handler_baton,
+                                 svn_stream_t *source,
+                                 apr_pool_t *pool)
+{
+  struct sliding_baton *sb;
+  svn_stream_t *stream;
+
+  /* Initialize baton. */
+  sb = apr_pcalloc(pool, sizeof(*sb));
+  sb->source = source;
+  sb->wh = handler;
+  sb->whb = handler_baton;
+  sb->pool = pool;
+  sb->buf = apr_palloc(pool, SVN_DELTA_LARGE_SOURCE_VIEW_SIZE
+                             + SVN_DELTA_LARGE_WINDOW_SIZE);
+  sb->tbuf = apr_palloc(pool, SVN_DELTA_LARGE_WINDOW_SIZE);
+
+  /* Create and return writable stream. */
+  stream = svn_stream_create(sb, pool);
+  svn_stream_set_write(stream, sliding_write_handler);
+  svn_stream_set_close(stream, sliding_close_handler);
+  return stream;
+}
+
+
+
 /* Functions for applying deltas.  */
 
 /* Ensure that BUF has enough space for VIEW_LEN bytes.  */
@@ -622,63 +828,124 @@ size_buffer(char **buf, apr_size_t *buf_size,
   return SVN_NO_ERROR;
 }
 
+/* Number of bytes that we copy at once for short instructions and
+ * pattern fills.  A memcpy() of that constant size compiles into a
+ * single vector load and store on all relevant platforms. */
+#define WIDE_COPY_SIZE SVN_TXDELTA__APPLY_PADDING
+
+/* Fill the LEN bytes at TARGET with the pattern of OVERLAP bytes that
+ * precedes it, i.e. starts at SOURCE == TARGET - OVERLAP.  OVERLAP must
+ * be less than WIDE_COPY_SIZE and LEN must not be less than that. */
+static void
+patterning_fill(char *target, const char *source,
+                apr_size_t overlap, apr_size_t len)
+{
+  /* Replicate the pattern into a full vector.  Storing that vector at
+   * multiples of the pattern length writes the same bytes again where
+   * two stores overlap. */
+  const apr_size_t stride = WIDE_COPY_SIZE - WIDE_COPY_SIZE % overlap;
+  char pattern[WIDE_COPY_SIZE];
+  apr_size_t i;
+
+  for (i = 0; i < WIDE_COPY_SIZE; ++i)
+    pattern[i] = source[i % overlap];
+
+  while (len >= WIDE_COPY_SIZE)
+    {
+      memcpy(target, pattern, WIDE_COPY_SIZE);
+      target += stride;
+      len -= stride;
+    }
+
+  memcpy(target, pattern, len);
+}
+
 /* Copy LEN bytes from SOURCE to TARGET.  Unlike memmove() or memcpy(),
- * create repeating patterns if the source and target ranges overlap.
- * Return a pointer to the first byte after the copied target range.  */
-static APR_INLINE char *
+ * create repeating patterns if the source and target ranges overlap.  */
+static APR_INLINE void
 patterning_copy(char *target, const char *source, apr_size_t len)
 {
+  apr_size_t overlap = target - source;
+
+  /* Runs of a single byte value are by far the most common case. */
+  if (overlap == 1)
+    {
+      memset(target, *source, len);
+      return;
+    }
+
+  /* Short patterns are best replicated in vector registers. */
+  if (overlap < WIDE_COPY_SIZE && len >= WIDE_COPY_SIZE)
+    {
+      patterning_fill(target, source, overlap, len);
+      return;
+    }
+
   /* If the source and target overlap, repeat the overlapping pattern
      in the target buffer. Always copy from the source buffer because
      presumably it will be in the L1 cache after the first iteration
      and doing this should avoid pipeline stalls due to write/read
-     dependencies. */
-  const apr_size_t overlap = target - source;
+     dependencies.  Every copy doubles the length of the pattern that
+     is available at SOURCE, so we need O(log(LEN)) copies only. */
   while (len > overlap)
     {
       memcpy(target, source, overlap);
       target += overlap;
       len -= overlap;
+      overlap *= 2;
     }
 
   /* Copy any remaining source pattern. */
   if (len)
-    {
-      memcpy(target, source, len);
-      target += len;
-    }
-
-  return target;
+    memcpy(target, source, len);
 }
 
-void
-svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
-                               const char *sbuf, char *tbuf,
-                               apr_size_t *tlen)
+/* Apply the instructions from WINDOW to a source view SBUF of SBUF_LEN
+ * bytes and write the first *TLEN bytes of the target view to TBUF.
+ * TBUF has room for TBUF_SIZE >= *TLEN bytes, all of which may be
+ * overwritten.  If the target view is shorter than *TLEN, set *TLEN to
+ * the number of bytes actually produced.
+ *
+ * Stop at the first instruction that does not fit into the buffers and
+ * return its index.  Return -1 if all instructions are valid.
+ *
+ * Short instructions copy WIDE_COPY_SIZE bytes at once if both buffers
+ * permit it.  Any extra bytes that get written thereby are overwritten
+ * by the following instructions. */
+static int
+apply_ops(const svn_txdelta_window_t *window,
+          const char *sbuf,
+          apr_size_t sbuf_len,
+          char *tbuf,
+          apr_size_t *tlen,
+          apr_size_t tbuf_size)
 {
   const svn_txdelta_op_t *op;
+  const svn_txdelta_op_t *const end = window->ops + window->num_ops;
+  const char *const new_data = window->new_data ? window->new_data->data
+                                                : NULL;
+  const apr_size_t new_len = window->new_data ? window->new_data->len : 0;
   apr_size_t tpos = 0;
 
-  /* Nothing to do for empty buffers.
-   * This check allows for NULL TBUF in that case. */
-  if (*tlen == 0)
-    return;
-
-  for (op = window->ops; op < window->ops + window->num_ops; op++)
+  for (op = window->ops; op < end; op++)
     {
       const apr_size_t buf_len = (op->length < *tlen - tpos
                                   ? op->length : *tlen - tpos);
+      const char *source;
+      apr_size_t available;
 
-      /* Check some invariants common to all instructions.  */
-      assert(tpos + op->length <= window->tview_len);
+      if (op->length > window->tview_len - tpos)
+        return (int)(op - window->ops);
 
       switch (op->action_code)
         {
         case svn_txdelta_source:
           /* Copy from source area.  */
-          assert(sbuf);
-          assert(op->offset + op->length <= window->sview_len);
-          memcpy(tbuf + tpos, sbuf + op->offset, buf_len);
+          if (op->offset > sbuf_len || op->length > sbuf_len - op->offset)
+            return (int)(op - window->ops);
+
+          source = sbuf + op->offset;
+          available = sbuf_len - op->offset;
           break;
 
         case svn_txdelta_target:
@@ -688,30 +955,95 @@ svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
            * Note that most copies won't have overlapping source and
            * target ranges (they are just a result of self-compressed
            * data) but a small percentage will.  */
-          assert(op->offset < tpos);
-          patterning_copy(tbuf + tpos, tbuf + op->offset, buf_len);
+          if (op->offset >= tpos)
+            return (int)(op - window->ops);
+
+          source = tbuf + op->offset;
+          available = tpos - op->offset;
+          if (available < buf_len)
+            {
+              patterning_copy(tbuf + tpos, source, buf_len);
+              source = NULL;
+            }
           break;
 
         case svn_txdelta_new:
           /* Copy from window new area.  */
-          assert(op->offset + op->length <= window->new_data->len);
-          memcpy(tbuf + tpos,
-                 window->new_data->data + op->offset,
-                 buf_len);
+          if (op->offset > new_len || op->length > new_len - op->offset)
+            return (int)(op - window->ops);
+
+          source = new_data + op->offset;
+          available = new_len - op->offset;
           break;
 
         default:
-          assert(!"Invalid delta instruction code");
+          return (int)(op - window->ops);
+        }
+
+      if (source)
+        {
+          if (   buf_len <= WIDE_COPY_SIZE
+              && available >= WIDE_COPY_SIZE
+              && tbuf_size - tpos >= WIDE_COPY_SIZE)
+            memcpy(tbuf + tpos, source, WIDE_COPY_SIZE);
+          else
+            memcpy(tbuf + tpos, source, buf_len);
         }
 
       tpos += op->length;
       if (tpos >= *tlen)
-        return;                 /* The buffer is full. */
+        return -1;              /* The buffer is full. */
     }
 
-  /* Check that we produced the right amount of data.  */
-  assert(tpos == window->tview_len);
   *tlen = tpos;
+  return -1;
+}
+
+void
+svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
+                               const char *sbuf, char *tbuf,
+                               apr_size_t *tlen)
+{
+  const apr_size_t requested = *tlen;
+
+  /* Nothing to do for empty buffers.
+   * This check allows for NULL TBUF in that case. */
+  if (requested == 0)
+    return;
+
+  if (apply_ops(window, sbuf, window->sview_len, tbuf, tlen, requested) >= 0)
+    assert(!"Invalid delta instruction");
+
+  /* Check that we produced the right amount of data.  */
+  assert(*tlen == requested || *tlen == window->tview_len);
+}
+
+svn_error_t *
+svn_txdelta__apply_window(const svn_txdelta_window_t *window,
+                          const char *sbuf,
+                          apr_size_t sbuf_len,
+                          char *tbuf,
+                          apr_size_t tbuf_size)
+{
+  apr_size_t tlen = window->tview_len;
+  int invalid_op;
+
+  SVN_ERR_ASSERT(tbuf_size >= tlen);
+  if (tlen == 0)
+    return SVN_NO_ERROR;
+
+  invalid_op = apply_ops(window, sbuf, sbuf_len, tbuf, &tlen, tbuf_size);
+  if (invalid_op >= 0)
+    return svn_error_createf(SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
+                             _("Invalid diff stream: insn %d "
+                               "cannot be decoded"),
+                             invalid_op);
+
+  if (tlen != window->tview_len)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_OPS, NULL,
+                            _("Delta does not fill the target window"));
+
+  return SVN_NO_ERROR;
 }
 
 /* Apply WINDOW to the streams given by APPL.  */
@@ -748,8 +1080,11 @@ apply_window(svn_txdelta_window_t *window, void *baton)
                      && (window->sview_offset + window->sview_len
                          >= ab->sbuf_offset + ab->sbuf_len)));
 
-  /* Make sure there's enough room in the target buffer.  */
-  SVN_ERR(size_buffer(&ab->tbuf, &ab->tbuf_size, window->tview_len, ab->pool));
+  /* Make sure there's enough room in the target buffer.  The padding
+     allows for faster copying of short instructions.  */
+  SVN_ERR(size_buffer(&ab->tbuf, &ab->tbuf_size,
+                      window->tview_len + SVN_TXDELTA__APPLY_PADDING,
+                      ab->pool));
 
   /* Prepare the source buffer for reading from the input stream.  */
   if (window->sview_offset != ab->sbuf_offset
@@ -772,7 +1107,22 @@ apply_window(svn_txdelta_window_t *window, void *baton)
           ab->sbuf_len -= start;
         }
       else
-        ab->sbuf_len = 0;
+        {
+          /* Source views that slide along with the source data, as used
+           * by svndiff version 3, may leave gaps.  Skip them. */
+          svn_filesize_t gap = window->sview_offset
+                             - (ab->sbuf_offset + ab->sbuf_len);
+          while (gap > 0)
+            {
+              apr_size_t chunk = gap > SVN_DELTA_LARGE_SOURCE_VIEW_SIZE
+                               ? SVN_DELTA_LARGE_SOURCE_VIEW_SIZE
+                               : (apr_size_t)gap;
+              SVN_ERR(svn_stream_skip(ab->source, chunk));
+              gap -= chunk;
+            }
+
+          ab->sbuf_len = 0;
+        }
       ab->sbuf_offset = window->sview_offset;
     }
 
@@ -789,9 +1139,9 @@ apply_window(svn_txdelta_window_t *window, void *baton)
 
   /* Apply the window instructions to the source view to generate
      the target view.  */
+  SVN_ERR(svn_txdelta__apply_window(window, ab->sbuf, window->sview_len,
+                                    ab->tbuf, ab->tbuf_size));
   len = window->tview_len;
-  svn_txdelta_apply_instructions(window, ab->sbuf, ab->tbuf, &len);
-  SVN_ERR_ASSERT(len == window->tview_len);
 
   /* Write out the output. */
 
@@ -29,8 +29,14 @@
 
 #include "svn_hash.h"
 #include "svn_delta.h"
+#include "private/svn_cpu.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+#if SVN_CPU__X86_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -44,15 +50,27 @@
  */
 #define MATCH_BLOCKSIZE 64
 
-/* Size of the checksum presence FLAGS array in BLOCKS_T.  With standard
-   MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about 20x
-   the number of checksums that actually occur, i.e. we expect a >95%
+/* log2(MATCH_BLOCKSIZE * 0x10000), i.e. the shift that gives the weight
+   of the character leaving the rolling checksum window. */
+#define MATCH_BLOCKSIZE_SHIFT 22
+
+/* Minimum size of the checksum presence FLAGS array in BLOCKS_T.  With
+   standard MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about
+   20x the number of checksums that actually occur, i.e. we expect a >95%
    probability that non-matching checksums get already detected by checking
-   against the FLAGS array.
+   against the FLAGS array.  Larger source views get proportionally larger
+   FLAGS arrays, up to MAX_FLAGS_COUNT.
    Must be a power of 2.
  */
 #define FLAGS_COUNT (32 * 1024)
 
+/* Maximum size of the checksum presence FLAGS array in BLOCKS_T.  We
+   address the bytes in FLAGS with the 16 bit multiplicative part of the
+   adler32 sum, so we can't use more than that.
+   Must be a power of 2.
+ */
+#define MAX_FLAGS_COUNT (8 * 0x10000)
+
 /* "no" / "invalid" / "unused" value for positions within the delta windows
  */
 #define NO_POSITION ((apr_uint32_t)-1)
@@ -137,8 +155,10 @@ struct blocks
      as "known not to have a match".
      The mapping of adler32 checksum bits is [0..2][16..27] (LSB -> MSB),
      i.e. address the byte by the multiplicative part of adler32 and address
-     the bits in that byte by the additive part of adler32. */
-  char flags[FLAGS_COUNT / 8];
+     the bits in that byte by the additive part of adler32.
+     FLAGS_MASK + 1 is the number of bytes in FLAGS. */
+  char *flags;
+  apr_uint32_t flags_mask;
 
   /* The vector of blocks.  A pos value of NO_POSITION represents an unused
      slot. */
@@ -156,13 +176,14 @@ static apr_uint32_t hash_func(apr_uint32_t sum)
   return sum ^ (sum >> 12);
 }
 
-/* Return the offset in BLOCKS.FLAGS for the adler32 SUM. */
-static apr_uint32_t hash_flags(apr_uint32_t sum)
+/* Return the offset in BLOCKS->FLAGS for the adler32 SUM. */
+static APR_INLINE apr_uint32_t
+hash_flags(const struct blocks *blocks, apr_uint32_t sum)
 {
   /* The upper half of SUM has a wider value range than the lower 16 bit.
      Also, we want to a different folding than HASH_FUNC to minimize
      correlation between different hash levels. */
-  return (sum >> 16) & ((FLAGS_COUNT / 8) - 1);
+  return (sum >> 16) & blocks->flags_mask;
 }
 
 /* Insert a block with the checksum ADLERSUM at position POS in the source
@@ -182,7 +203,7 @@ add_block(struct blocks *blocks, apr_uint32_t adlersum, apr_uint32_t pos)
 
   blocks->slots[h].adlersum = adlersum;
   blocks->slots[h].pos = pos;
-  blocks->flags[hash_flags(adlersum)] |= 1 << (adlersum & 7);
+  blocks->flags[hash_flags(blocks, adlersum)] |= 1 << (adlersum & 7);
 }
 
 /* Find a block in BLOCKS with the checksum ADLERSUM and matching the content
@@ -216,6 +237,7 @@ init_blocks_table(const char *data,
   apr_size_t nblocks;
   apr_size_t wnslots = 1;
   apr_uint32_t nslots;
+  apr_uint32_t nflags;
   apr_uint32_t i;
 
   /* Be pessimistic about the block count. */
@@ -247,8 +269,16 @@ init_blocks_table(const char *data,
       blocks->slots[i].pos = NO_POSITION;
     }
 
+  /* Scale the FLAGS array with the number of blocks such that large
+     source views don't saturate it.  With the default window size, this
+     will always be FLAGS_COUNT. */
+  nflags = FLAGS_COUNT;
+  while (nflags < MAX_FLAGS_COUNT && nflags < 8 * nslots)
+    nflags *= 2;
+
   /* No checksum entries in SLOTS, yet => reset all checksum flags. */
-  memset(blocks->flags, 0, sizeof(blocks->flags));
+  blocks->flags_mask = nflags / 8 - 1;
+  blocks->flags = apr_pcalloc(pool, nflags / 8);
 
   /* If there is an odd block at the end of the buffer, we will
      not use that shorter block for deltification (only indirectly
@@ -278,7 +308,7 @@ find_match(const struct blocks *blocks,
            apr_size_t pending_insert_start)
 {
   apr_size_t apos, bpos = *bposp;
-  apr_size_t delta, max_delta;
+  apr_size_t delta, max_delta, back;
 
   apos = find_block(blocks, rolling, b + bpos);
 
@@ -296,12 +326,13 @@ find_match(const struct blocks *blocks,
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
      content has been sampled only every MATCH_BLOCKSIZE positions).  */
-  while (apos > 0 && bpos > pending_insert_start && a[apos-1] == b[bpos-1])
-    {
-      --apos;
-      --bpos;
-      ++delta;
-    }
+  max_delta = bpos - pending_insert_start < apos
+            ? bpos - pending_insert_start
+            : apos;
+  back = svn_cstring__reverse_match_length(a + apos, b + bpos, max_delta);
+  apos -= back;
+  bpos -= back;
+  delta += back;
 
   *aposp = apos;
   *bposp = bpos;
@@ -309,6 +340,207 @@ find_match(const struct blocks *blocks,
   return MATCH_BLOCKSIZE + delta;
 }
 
+/* Return TRUE if BLOCKS may contain a block with checksum ADLERSUM.
+   FALSE means that there is definitely no match. */
+static APR_INLINE svn_boolean_t
+may_match(const struct blocks *blocks,
+          apr_uint32_t adlersum)
+{
+  return (blocks->flags[hash_flags(blocks, adlersum)]
+          & (1 << (adlersum & 7))) != 0;
+}
+
+/* Function type used to quickly skip target positions that can't match.
+   Starting at LO in B, advance the rolling checksum *ROLLING until it may
+   match any entry in BLOCKS or until LO reaches UPPER.  Return the new LO.
+ */
+typedef apr_size_t (*skip_func_t)(const struct blocks *blocks,
+                                  apr_uint32_t *rolling,
+                                  const char *b,
+                                  apr_size_t lo,
+                                  apr_size_t upper);
+
+/* Portable implementation of skip_func_t. */
+static apr_size_t
+skip_mismatches(const struct blocks *blocks,
+                apr_uint32_t *rolling,
+                const char *b,
+                apr_size_t lo,
+                apr_size_t upper)
+{
+  apr_uint32_t sum = *rolling;
+
+  while (!may_match(blocks, sum) && lo < upper)
+    {
+      sum = adler32_replace(sum, b[lo], b[lo+MATCH_BLOCKSIZE]);
+      lo++;
+    }
+
+  *rolling = sum;
+  return lo;
+}
+
+#if SVN_CPU__X86_SIMD
+
+/* The vector implementations below evaluate adler32_replace for several
+   consecutive positions at once.  For the J-th step from a start value R0
+   and with C_K being the change caused by step K, i.e.
+
+     C_K = IN_K - OUT_K - OUT_K * MATCH_BLOCKSIZE * 0x10000
+
+   the chain of updates can be written as
+
+     L_J = R0 + C_0 + ... + C_J-1
+     R_J = L_J + (L_1 + ... + L_J) * 0x10000
+
+   because (0x10000 + 1)^J == J * 0x10000 + 1 modulo 2^32.  Thus, two
+   prefix sums give us all intermediate checksums without any of them
+   depending on its predecessor.
+ */
+
+/* Return the inclusive prefix sums over the four 32 bit elements in X. */
+SVN_CPU__TARGET("sse2")
+static APR_INLINE __m128i
+prefix_sum_sse2(__m128i x)
+{
+  x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+  return _mm_add_epi32(x, _mm_slli_si128(x, 8));
+}
+
+/* SSE2 implementation of skip_func_t, processing 4 positions at once. */
+SVN_CPU__TARGET("sse2")
+static apr_size_t
+skip_mismatches_sse2(const struct blocks *blocks,
+                     apr_uint32_t *rolling,
+                     const char *b,
+                     apr_size_t lo,
+                     apr_size_t upper)
+{
+  const __m128i zero = _mm_setzero_si128();
+  apr_uint32_t sum = *rolling;
+
+  while (lo + 4 <= upper && !may_match(blocks, sum))
+    {
+      apr_uint32_t sums[4];
+      int i;
+      int out_chars, in_chars;
+      __m128i out, in, changes, low, all;
+
+      /* Expand the 4 outgoing and incoming chars to 32 bits each. */
+      memcpy(&out_chars, b + lo, sizeof(out_chars));
+      memcpy(&in_chars, b + lo + MATCH_BLOCKSIZE, sizeof(in_chars));
+      out = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(out_chars),
+                                                 zero),
+                               zero);
+      in = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(in_chars),
+                                                zero),
+                              zero);
+
+      /* C_K, then L_J and R_J as described above. */
+      changes = _mm_sub_epi32(_mm_sub_epi32(in, out),
+                              _mm_slli_epi32(out, MATCH_BLOCKSIZE_SHIFT));
+      low = _mm_add_epi32(prefix_sum_sse2(changes),
+                          _mm_set1_epi32((int)sum));
+      all = _mm_add_epi32(low, _mm_slli_epi32(prefix_sum_sse2(low), 16));
+      _mm_storeu_si128((__m128i *)sums, all);
+
+      for (i = 0; i < 3; ++i)
+        if (may_match(blocks, sums[i]))
+          {
+            *rolling = sums[i];
+            return lo + i + 1;
+          }
+
+      sum = sums[3];
+      lo += 4;
+    }
+
+  *rolling = sum;
+  return skip_mismatches(blocks, rolling, b, lo, upper);
+}
+
+/* Return the inclusive prefix sums over the eight 32 bit elements in X. */
+SVN_CPU__TARGET("avx2")
+static APR_INLINE __m256i
+prefix_sum_avx2(__m256i x)
+{
+  __m256i carry;
+
+  /* Prefix sums within each 128 bit lane. */
+  x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+  x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+
+  /* Add the total of the lower lane to all elements of the upper lane. */
+  carry = _mm256_permute2x128_si256(x, x, 0x08);
+  carry = _mm256_shuffle_epi32(carry, 0xff);
+
+  return _mm256_add_epi32(x, carry);
+}
+
+/* AVX2 implementation of skip_func_t, processing 8 positions at once. */
+SVN_CPU__TARGET("avx2")
+static apr_size_t
+skip_mismatches_avx2(const struct blocks *blocks,
+                     apr_uint32_t *rolling,
+                     const char *b,
+                     apr_size_t lo,
+                     apr_size_t upper)
+{
+  apr_uint32_t sum = *rolling;
+
+  while (lo + 8 <= upper && !may_match(blocks, sum))
+    {
+      apr_uint32_t sums[8];
+      int i;
+      __m256i out, in, changes, low, all;
+
+      /* Expand the 8 outgoing and incoming chars to 32 bits each. */
+      out = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b + lo)));
+      in = _mm256_cvtepu8_epi32(
+             _mm_loadl_epi64((const __m128i *)(b + lo + MATCH_BLOCKSIZE)));
+
+      /* C_K, then L_J and R_J as described above. */
+      changes = _mm256_sub_epi32(_mm256_sub_epi32(in, out),
+                                 _mm256_slli_epi32(out,
+                                                   MATCH_BLOCKSIZE_SHIFT));
+      low = _mm256_add_epi32(prefix_sum_avx2(changes),
+                             _mm256_set1_epi32((int)sum));
+      all = _mm256_add_epi32(low,
+                             _mm256_slli_epi32(prefix_sum_avx2(low), 16));
+      _mm256_storeu_si256((__m256i *)sums, all);
+
+      for (i = 0; i < 7; ++i)
+        if (may_match(blocks, sums[i]))
+          {
+            *rolling = sums[i];
+            return lo + i + 1;
+          }
+
+      sum = sums[7];
+      lo += 8;
+    }
+
+  *rolling = sum;
+  return skip_mismatches(blocks, rolling, b, lo, upper);
+}
+
+#endif /* SVN_CPU__X86_SIMD */
+
+/* Return the fastest skip_func_t implementation for the current CPU. */
+static skip_func_t
+get_skip_func(void)
+{
+#if SVN_CPU__X86_SIMD
+  apr_uint32_t features = svn_cpu__features();
+  if (features & SVN_CPU__AVX2)
+    return skip_mismatches_avx2;
+  if (features & SVN_CPU__SSE2)
+    return skip_mismatches_sse2;
+#endif
+
+  return skip_mismatches;
+}
+
 /* Utility for compute_delta() that compares the range B[START,BSIZE) with
  * the range of similar size before A[ASIZE]. Create corresponding copy and
  * insert operations.
@@ -378,6 +610,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   struct blocks blocks;
   apr_uint32_t rolling;
   apr_size_t lo = 0, pending_insert_start = 0, upper;
+  skip_func_t skip = get_skip_func();
 
   /* Optimization: directly compare window starts. If more than 4
    * bytes match, we can immediately create a matching windows.
@@ -414,12 +647,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
-             && lo < upper)
-        {
-          rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
-          lo++;
-        }
+      lo = skip(&blocks, &rolling, b, lo, upper);
 
       /* LO is still <= UPPER, i.e. the following lookup is legal:
          Closely check whether we've got a match for the current location.
@@ -114,6 +114,48 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
               apr_off_t suffix_lines,
               apr_pool_t *pool);
 
+/*
+ * Like svn_diff__lcs() but use the histogram algorithm: Recursively split
+ * the sequences at the longest common run of lines that contains the
+ * line with the fewest occurrences in the first sequence.  Lines unique to
+ * both sequences are natural split points, so in the absence of repeated
+ * lines this is the patience diff.  Only ranges without any suitable split
+ * point get passed on to the Myers algorithm.
+ *
+ * The result has the same structure as the one of svn_diff__lcs() and
+ * refers to the same position list elements.  Its cost is roughly linear
+ * in the length of the sequences for typical inputs and does not blow up
+ * for long sequences of repeated or changed lines.
+ */
+svn_diff__lcs_t *
+svn_diff__lcs_histogram(svn_diff__position_t *position_list1,
+                        svn_diff__position_t *position_list2,
+                        svn_diff__token_index_t *token_counts_list1,
+                        svn_diff__token_index_t *token_counts_list2,
+                        svn_diff__token_index_t num_tokens,
+                        apr_off_t prefix_lines,
+                        apr_off_t suffix_lines,
+                        apr_pool_t *pool);
+
+/* Like svn_diff_diff_2() but use svn_diff__lcs_histogram() instead of
+ * svn_diff__lcs() if HISTOGRAM is set. */
+svn_error_t *
+svn_diff__diff_2(svn_diff_t **diff,
+                 void *diff_baton,
+                 const svn_diff_fns2_t *vtable,
+                 svn_boolean_t histogram,
+                 apr_pool_t *pool);
+
+/* Like svn_diff_diff3_2() but use svn_diff__lcs_histogram() instead of
+ * svn_diff__lcs() for the two-way diffs against the original if HISTOGRAM
+ * is set. */
+svn_error_t *
+svn_diff__diff3(svn_diff_t **diff,
+                void *diff_baton,
+                const svn_diff_fns2_t *vtable,
+                svn_boolean_t histogram,
+                apr_pool_t *pool);
+
 
 /*
  * Returns number of tokens in a tree
@@ -128,6 +170,37 @@ void
 svn_diff__tree_create(svn_diff__tree_t **tree, apr_pool_t *pool);
 
 
+/* State of a 64 bit hash function for the contents of a line.  Feeding
+ * the data in pieces gives the same result as feeding it in one go, so
+ * lines that span buffers can be hashed without copying them.  Treat the
+ * members as private.
+ */
+typedef struct svn_diff__line_hash_t
+{
+  apr_uint64_t hash;
+  apr_uint64_t pending;
+  apr_uint64_t length;
+} svn_diff__line_hash_t;
+
+/* Initialize STATE for a new line. */
+void
+svn_diff__line_hash_init(svn_diff__line_hash_t *state);
+
+/* Add LEN bytes at DATA to the line hashed in STATE. */
+void
+svn_diff__line_hash_update(svn_diff__line_hash_t *state,
+                           const char *data,
+                           apr_size_t len);
+
+/* Return the hash value of the data fed into STATE. */
+apr_uint64_t
+svn_diff__line_hash_final(const svn_diff__line_hash_t *state);
+
+/* Return the 32 bit hash value to be returned by the datasource_get_next_token
+ * callback for a line with the 64 bit hash value HASH. */
+#define SVN_DIFF__LINE_HASH_32(hash) \
+  ((apr_uint32_t)((hash) ^ ((hash) >> 32)))
+
 /*
  * Get all tokens from a datasource.  Return the
  * last item in the (circular) list.
@@ -49,8 +49,13 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
-#include "private/svn_adler32.h"
 #include "private/svn_diff_private.h"
+#include "private/svn_cpu.h"
+
+#if SVN_CPU__X86_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 /* A token, i.e. a line read from a file. */
 typedef struct svn_diff__file_token_t
@@ -66,6 +71,8 @@ typedef struct svn_diff__file_token_t
   apr_off_t raw_length;
   /* Total length - after normalization. */
   apr_off_t length;
+  /* Line hash of the normalized contents. */
+  apr_uint64_t hash;
 } svn_diff__file_token_t;
 
 
@@ -91,8 +98,17 @@ typedef struct svn_diff__file_baton_t
     /* Where the identical suffix starts in this datasource */
     int suffix_start_chunk;
     apr_off_t suffix_offset_in_chunk;
+
+    /* Buffers of the chunks that we are done reading tokens from, indexed
+     * by chunk number, or NULL.  Their contents have been normalized in
+     * the same way as BUFFER.  The array has one entry per chunk of the
+     * file. */
+    char **chunks;
   } files[4];
 
+  /* Number of chunks kept in the CHUNKS of all FILES together. */
+  int cached_chunks;
+
   /* List of free tokens that may be reused. */
   svn_diff__file_token_t *tokens;
 
@@ -130,6 +146,15 @@ datasource_to_index(svn_diff_datasource_e datasource)
 #define CHUNK_SHIFT 17
 #define CHUNK_SIZE (1 << CHUNK_SHIFT)
 
+/* Keep up to this many chunks of all files of a diff together in memory
+ * while reading tokens.  Comparing tokens in those chunks then requires
+ * no I/O.  This costs up to CACHED_CHUNKS_MAX * CHUNK_SIZE bytes, i.e.
+ * 32MB, per diff in addition to the CHUNK_SIZE buffer of each file, plus
+ * one pointer per chunk for each file that keeps any.  The budget is
+ * handed out first come, first served; the chunks of files read later
+ * are read again from disk when needed. */
+#define CACHED_CHUNKS_MAX 256
+
 #define chunk_to_offset(chunk) ((chunk) << CHUNK_SHIFT)
 #define offset_to_chunk(offset) ((offset) >> CHUNK_SHIFT)
 #define offset_in_chunk(offset) ((offset) & (CHUNK_SIZE - 1))
@@ -372,136 +397,796 @@ static svn_boolean_t contains_eol(apr_uintptr_t chunk)
 }
 #endif
 
-/* Find the prefix which is identical between all elements of the FILE array.
- * Return the number of prefix lines in PREFIX_LINES.  REACHED_ONE_EOF will be
- * set to TRUE if one of the FILEs reached its end while scanning prefix,
- * i.e. at least one file consisted entirely of prefix.  Otherwise,
- * REACHED_ONE_EOF is set to FALSE.
+/* Function type used to quickly skip data that is identical in all files
+ * while scanning for the identical prefix or suffix.
  *
- * After this function is finished, the buffers, chunks, curp's and endp's
- * of the FILEs are set to point at the first byte after the prefix. */
-static svn_error_t *
-find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
-                      struct file_info file[], apr_size_t file_len,
-                      apr_pool_t *pool)
+ * DATA contains one position for each of the FILE_LEN files.  Compare the
+ * bytes following these positions when scanning forward, or the bytes
+ * preceding them when scanning backward, and return the number of bytes,
+ * up to MAX_LEN, that are equal in all files.  Implementations may stop
+ * short of the first mismatch; the caller examines the remaining bytes one
+ * by one.
+ *
+ * Add the number of eols within the skipped bytes to *LINES, counting them
+ * just like the byte-wise loops of the callers do.  *HAD_EOL is the state
+ * of those loops: whether the byte before the skipped data was a '\r' when
+ * scanning forward, or whether the byte after it was a '\n' when scanning
+ * backward.  Update it if any bytes got skipped.
+ */
+typedef apr_size_t (*scan_func_t)(apr_off_t *lines,
+                                  svn_boolean_t *had_eol,
+                                  const char *data[],
+                                  apr_size_t file_len,
+                                  apr_size_t max_len);
+
+/* Portable implementation of scan_func_t for forward scans.
+ * It compares whole machine words and examines the words that contain
+ * an eol byte by byte. */
+static apr_size_t
+scan_forward(apr_off_t *lines,
+             svn_boolean_t *had_cr,
+             const char *data[],
+             apr_size_t file_len,
+             apr_size_t max_len)
 {
-  svn_boolean_t had_cr = FALSE;
-  svn_boolean_t is_match;
-  apr_off_t lines = 0;
-  apr_size_t i;
+  apr_size_t pos = 0;
 
-  *reached_one_eof = FALSE;
+#if SVN_UNALIGNED_ACCESS_IS_OK
+  apr_size_t i;
 
-  for (i = 1, is_match = TRUE; i < file_len; i++)
-    is_match = is_match && *file[0].curp == *file[i].curp;
-  while (is_match)
+  for (; max_len - pos >= sizeof(apr_uintptr_t); pos += sizeof(apr_uintptr_t))
     {
-#if SVN_UNALIGNED_ACCESS_IS_OK
-      apr_ssize_t max_delta, delta;
-#endif /* SVN_UNALIGNED_ACCESS_IS_OK */
+      apr_uintptr_t chunk = *(const apr_uintptr_t *)(data[0] + pos);
+
+      for (i = 1; i < file_len; i++)
+        if (chunk != *(const apr_uintptr_t *)(data[i] + pos))
+          return pos;
 
-      /* ### TODO: see if we can take advantage of
-         diff options like ignore_eol_style or ignore_space. */
-      /* check for eol, and count */
-      if (*file[0].curp == '\r')
+      if (contains_eol(chunk))
+        {
+          for (i = pos; i < pos + sizeof(apr_uintptr_t); i++)
+            if (data[0][i] == '\r')
+              {
+                (*lines)++;
+                *had_cr = TRUE;
+              }
+            else
+              {
+                if (data[0][i] == '\n' && !*had_cr)
+                  (*lines)++;
+                *had_cr = FALSE;
+              }
+        }
+      else
         {
-          lines++;
-          had_cr = TRUE;
+          /* Skipped data without EOL markers, so last char was not a CR. */
+          *had_cr = FALSE;
         }
-      else if (*file[0].curp == '\n' && !had_cr)
+    }
+#endif
+
+  return pos;
+}
+
+/* Portable implementation of scan_func_t for backward scans.
+ * It compares whole machine words and examines the words that contain
+ * an eol byte by byte. */
+static apr_size_t
+scan_backward(apr_off_t *lines,
+              svn_boolean_t *had_nl,
+              const char *data[],
+              apr_size_t file_len,
+              apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+#if SVN_UNALIGNED_ACCESS_IS_OK
+  apr_size_t i;
+
+  for (; max_len - pos >= sizeof(apr_uintptr_t); pos += sizeof(apr_uintptr_t))
+    {
+      const char *start = data[0] - pos - sizeof(apr_uintptr_t);
+      apr_uintptr_t chunk = *(const apr_uintptr_t *)start;
+
+      for (i = 1; i < file_len; i++)
+        if (chunk != *(const apr_uintptr_t *)
+                        (data[i] - pos - sizeof(apr_uintptr_t)))
+          return pos;
+
+      if (contains_eol(chunk))
         {
-          lines++;
+          for (i = sizeof(apr_uintptr_t); i > 0; i--)
+            if (start[i - 1] == '\n')
+              {
+                (*lines)++;
+                *had_nl = TRUE;
+              }
+            else
+              {
+                if (start[i - 1] == '\r' && !*had_nl)
+                  (*lines)++;
+                *had_nl = FALSE;
+              }
         }
       else
         {
-          had_cr = FALSE;
+          /* We skipped some bytes, so there are no closing EOLs */
+          *had_nl = FALSE;
         }
+    }
+#endif
 
-      INCREMENT_POINTERS(file, file_len, pool);
+  return pos;
+}
 
-#if SVN_UNALIGNED_ACCESS_IS_OK
+#if SVN_CPU__X86_SIMD
+
+/* The vectorized scanners below compare 16 or 32 bytes at once.  Their
+ * results, just like the positions of the '\r' and '\n' characters, get
+ * collected in bit masks with one bit per byte.  Thus, eols don't stop
+ * the scan but simply get counted: every '\r' ends a line and so does
+ * every '\n' that does not directly follow a '\r'.
+ */
+
+/* Return the index of the lowest set bit in the non-zero VALUE. */
+static APR_INLINE int
+lowest_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return (int)index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+/* Return the index of the highest set bit in the non-zero VALUE. */
+static APR_INLINE int
+highest_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse(&index, value);
+  return (int)index;
+#else
+  return 31 - __builtin_clz(value);
+#endif
+}
+
+/* Return the number of set bits in VALUE. */
+static APR_INLINE int
+count_bits(apr_uint32_t value)
+{
+  value = value - ((value >> 1) & 0x55555555);
+  value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+  value = (value + (value >> 4)) & 0x0f0f0f0f;
+
+  return (int)((value * 0x01010101) >> 24);
+}
+
+/* Return the number of lines that end in a block of data scanned forward,
+ * given the masks CR and NL of its '\r' and '\n' bytes.  PREV_CR is 1 if
+ * the byte before the block is a '\r' and 0 otherwise. */
+static APR_INLINE int
+count_eols_forward(apr_uint32_t cr,
+                   apr_uint32_t nl,
+                   apr_uint32_t prev_cr)
+{
+  return count_bits(cr) + count_bits(nl & ~((cr << 1) | prev_cr));
+}
+
+/* Return the number of lines that end in a block of data scanned backward,
+ * given the masks CR and NL of its '\r' and '\n' bytes.  NEXT_NL has the
+ * bit of the block's last byte set if the byte following the block is a
+ * '\n' and is 0 otherwise. */
+static APR_INLINE int
+count_eols_backward(apr_uint32_t cr,
+                    apr_uint32_t nl,
+                    apr_uint32_t next_nl)
+{
+  return count_bits(nl) + count_bits(cr & ~((nl >> 1) | next_nl));
+}
+
+/* SSE2 implementation of scan_func_t for forward scans. */
+SVN_CPU__TARGET("sse2")
+static apr_size_t
+scan_forward_sse2(apr_off_t *lines,
+                  svn_boolean_t *had_cr,
+                  const char *data[],
+                  apr_size_t file_len,
+                  apr_size_t max_len)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i nl = _mm_set1_epi8('\n');
+  apr_uint32_t prev_cr = *had_cr ? 1 : 0;
+  apr_size_t pos;
+  apr_size_t i;
+
+  for (pos = 0; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i first = _mm_loadu_si128((const __m128i *)(data[0] + pos));
+      apr_uint32_t cr_bits
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(first, cr));
+      apr_uint32_t nl_bits
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(first, nl));
+      apr_uint32_t mismatch = 0;
 
-      /* Try to advance as far as possible with machine-word granularity.
-       * Determine how far we may advance with chunky ops without reaching
-       * endp for any of the files.
-       * Signedness is important here if curp gets close to endp.
-       */
-      max_delta = file[0].endp - file[0].curp - sizeof(apr_uintptr_t);
       for (i = 1; i < file_len; i++)
         {
-          delta = file[i].endp - file[i].curp - sizeof(apr_uintptr_t);
-          if (delta < max_delta)
-            max_delta = delta;
+          __m128i other = _mm_loadu_si128((const __m128i *)(data[i] + pos));
+          mismatch |= (apr_uint32_t)_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(first, other)) ^ 0xffff;
         }
 
-      is_match = TRUE;
-      for (delta = 0; delta < max_delta; delta += sizeof(apr_uintptr_t))
+      if (mismatch)
         {
-          apr_uintptr_t chunk = *(const apr_uintptr_t *)(file[0].curp + delta);
-          if (contains_eol(chunk))
-            break;
+          int len = lowest_bit(mismatch);
+          apr_uint32_t valid = ((apr_uint32_t)1 << len) - 1;
 
-          for (i = 1; i < file_len; i++)
-            if (chunk != *(const apr_uintptr_t *)(file[i].curp + delta))
-              {
-                is_match = FALSE;
-                break;
-              }
+          *lines += count_eols_forward(cr_bits & valid, nl_bits & valid,
+                                       prev_cr);
+          if (len)
+            prev_cr = (cr_bits >> (len - 1)) & 1;
 
-          if (! is_match)
-            break;
+          *had_cr = prev_cr != 0;
+          return pos + len;
+        }
+
+      *lines += count_eols_forward(cr_bits, nl_bits, prev_cr);
+      prev_cr = cr_bits >> 15;
+    }
+
+  *had_cr = prev_cr != 0;
+  return pos;
+}
+
+/* AVX2 implementation of scan_func_t for forward scans. */
+SVN_CPU__TARGET("avx2")
+static apr_size_t
+scan_forward_avx2(apr_off_t *lines,
+                  svn_boolean_t *had_cr,
+                  const char *data[],
+                  apr_size_t file_len,
+                  apr_size_t max_len)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i nl = _mm256_set1_epi8('\n');
+  apr_uint32_t prev_cr = *had_cr ? 1 : 0;
+  apr_size_t pos;
+  apr_size_t i;
+
+  for (pos = 0; max_len - pos >= sizeof(__m256i); pos += sizeof(__m256i))
+    {
+      __m256i first = _mm256_loadu_si256((const __m256i *)(data[0] + pos));
+      apr_uint32_t cr_bits
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(first, cr));
+      apr_uint32_t nl_bits
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(first, nl));
+      apr_uint32_t mismatch = 0;
+
+      for (i = 1; i < file_len; i++)
+        {
+          __m256i other
+            = _mm256_loadu_si256((const __m256i *)(data[i] + pos));
+          mismatch |= ~(apr_uint32_t)_mm256_movemask_epi8(
+                         _mm256_cmpeq_epi8(first, other));
         }
 
-      if (delta /* > 0*/)
+      if (mismatch)
         {
-          /* We either found a mismatch or an EOL at or shortly behind curp+delta
-           * or we cannot proceed with chunky ops without exceeding endp.
-           * In any way, everything up to curp + delta is equal and not an EOL.
-           */
-          for (i = 0; i < file_len; i++)
-            file[i].curp += delta;
+          int len = lowest_bit(mismatch);
+          apr_uint32_t valid = ((apr_uint32_t)1 << len) - 1;
 
-          /* Skipped data without EOL markers, so last char was not a CR. */
-          had_cr = FALSE;
+          *lines += count_eols_forward(cr_bits & valid, nl_bits & valid,
+                                       prev_cr);
+          if (len)
+            prev_cr = (cr_bits >> (len - 1)) & 1;
+
+          *had_cr = prev_cr != 0;
+          return pos + len;
+        }
+
+      *lines += count_eols_forward(cr_bits, nl_bits, prev_cr);
+      prev_cr = cr_bits >> 31;
+    }
+
+  *had_cr = prev_cr != 0;
+  return pos;
+}
+
+/* SSE2 implementation of scan_func_t for backward scans. */
+SVN_CPU__TARGET("sse2")
+static apr_size_t
+scan_backward_sse2(apr_off_t *lines,
+                   svn_boolean_t *had_nl,
+                   const char *data[],
+                   apr_size_t file_len,
+                   apr_size_t max_len)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i nl = _mm_set1_epi8('\n');
+  apr_uint32_t next_nl = *had_nl ? 0x8000 : 0;
+  apr_size_t pos;
+  apr_size_t i;
+
+  for (pos = 0; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      apr_size_t start = pos + sizeof(__m128i);
+      __m128i last = _mm_loadu_si128((const __m128i *)(data[0] - start));
+      apr_uint32_t cr_bits
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(last, cr));
+      apr_uint32_t nl_bits
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(last, nl));
+      apr_uint32_t mismatch = 0;
+
+      for (i = 1; i < file_len; i++)
+        {
+          __m128i other = _mm_loadu_si128((const __m128i *)(data[i] - start));
+          mismatch |= (apr_uint32_t)_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(last, other)) ^ 0xffff;
         }
+
+      /* The highest mismatching byte is the one closest to DATA. */
+      if (mismatch)
+        {
+          int first = highest_bit(mismatch) + 1;
+          apr_uint32_t valid = ~(((apr_uint32_t)1 << first) - 1);
+
+          *lines += count_eols_backward(cr_bits & valid, nl_bits & valid,
+                                        next_nl);
+          if (first < 16)
+            next_nl = (nl_bits >> first) & 1;
+
+          *had_nl = next_nl != 0;
+          return pos + sizeof(__m128i) - first;
+        }
+
+      *lines += count_eols_backward(cr_bits, nl_bits, next_nl);
+      next_nl = (nl_bits & 1) << 15;
+    }
+
+  *had_nl = next_nl != 0;
+  return pos;
+}
+
+/* AVX2 implementation of scan_func_t for backward scans. */
+SVN_CPU__TARGET("avx2")
+static apr_size_t
+scan_backward_avx2(apr_off_t *lines,
+                   svn_boolean_t *had_nl,
+                   const char *data[],
+                   apr_size_t file_len,
+                   apr_size_t max_len)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i nl = _mm256_set1_epi8('\n');
+  apr_uint32_t next_nl = *had_nl ? 0x80000000 : 0;
+  apr_size_t pos;
+  apr_size_t i;
+
+  for (pos = 0; max_len - pos >= sizeof(__m256i); pos += sizeof(__m256i))
+    {
+      apr_size_t start = pos + sizeof(__m256i);
+      __m256i last = _mm256_loadu_si256((const __m256i *)(data[0] - start));
+      apr_uint32_t cr_bits
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(last, cr));
+      apr_uint32_t nl_bits
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(last, nl));
+      apr_uint32_t mismatch = 0;
+
+      for (i = 1; i < file_len; i++)
+        {
+          __m256i other
+            = _mm256_loadu_si256((const __m256i *)(data[i] - start));
+          mismatch |= ~(apr_uint32_t)_mm256_movemask_epi8(
+                         _mm256_cmpeq_epi8(last, other));
+        }
+
+      /* The highest mismatching byte is the one closest to DATA. */
+      if (mismatch)
+        {
+          int first = highest_bit(mismatch) + 1;
+          apr_uint32_t valid = first < 32
+                             ? ~(((apr_uint32_t)1 << first) - 1)
+                             : 0;
+
+          *lines += count_eols_backward(cr_bits & valid, nl_bits & valid,
+                                        next_nl);
+          if (first < 32)
+            next_nl = (nl_bits >> first) & 1;
+
+          *had_nl = next_nl != 0;
+          return pos + sizeof(__m256i) - first;
+        }
+
+      *lines += count_eols_backward(cr_bits, nl_bits, next_nl);
+      next_nl = (nl_bits & 1) << 31;
+    }
+
+  *had_nl = next_nl != 0;
+  return pos;
+}
+
+#endif /* SVN_CPU__X86_SIMD */
+
+/* Return the fastest scan_func_t implementation for forward scans on the
+ * current CPU. */
+static scan_func_t
+get_forward_scan_func(void)
+{
+#if SVN_CPU__X86_SIMD
+  apr_uint32_t features = svn_cpu__features();
+  if (features & SVN_CPU__AVX2)
+    return scan_forward_avx2;
+  if (features & SVN_CPU__SSE2)
+    return scan_forward_sse2;
 #endif
 
-      *reached_one_eof = is_one_at_eof(file, file_len);
-      if (*reached_one_eof)
-        break;
+  return scan_forward;
+}
+
+/* Return the fastest scan_func_t implementation for backward scans on the
+ * current CPU. */
+static scan_func_t
+get_backward_scan_func(void)
+{
+#if SVN_CPU__X86_SIMD
+  apr_uint32_t features = svn_cpu__features();
+  if (features & SVN_CPU__AVX2)
+    return scan_backward_avx2;
+  if (features & SVN_CPU__SSE2)
+    return scan_backward_sse2;
+#endif
+
+  return scan_backward;
+}
+
+/* Return the offset of the current position of FILE within the file. */
+static APR_INLINE apr_off_t
+get_file_offset(const struct file_info *file)
+{
+  return chunk_to_offset((apr_off_t)file->chunk)
+         + (file->curp - file->buffer);
+}
+
+/* Check whether one of the FILEs has its pointers at or before the
+ * respective offset in MIN_OFFSET, i.e. has reached the identical prefix
+ * while scanning backwards. */
+static svn_boolean_t
+is_one_at_prefix(struct file_info file[], apr_size_t file_len,
+                 const apr_off_t min_offset[])
+{
+  apr_size_t i;
+
+  for (i = 0; i < file_len; i++)
+    if (get_file_offset(&file[i]) <= min_offset[i])
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Move the pointers of FILE to OFFSET within CHUNK, reading that chunk
+ * into the buffer if necessary. */
+static svn_error_t *
+seek_chunk(struct file_info *file, int chunk, apr_off_t offset,
+           apr_pool_t *pool)
+{
+  if (file->chunk != chunk)
+    {
+      apr_off_t length = chunk == offset_to_chunk(file->size)
+                       ? offset_in_chunk(file->size)
+                       : CHUNK_SIZE;
+
+      SVN_ERR(read_chunk(file->file, file->buffer, length,
+                         chunk_to_offset((apr_off_t)chunk), pool));
+      file->chunk = chunk;
+      file->endp = file->buffer + length;
+    }
+
+  file->curp = file->buffer + offset;
+
+  return SVN_NO_ERROR;
+}
+
+/* Move the pointers of FILE past the next eol sequence or to EOF if there
+ * is none.  Set *HAD_EOL to TRUE in the former case, to FALSE otherwise.
+ * Unless BUF is NULL, append all bytes passed to it. */
+static svn_error_t *
+skip_line(svn_boolean_t *had_eol, svn_stringbuf_t *buf,
+          struct file_info *file, apr_pool_t *pool)
+{
+  *had_eol = FALSE;
+  while (!is_one_at_eof(file, 1))
+    {
+      char c = *file->curp;
+
+      if (buf)
+        svn_stringbuf_appendbyte(buf, c);
+      INCREMENT_POINTERS(file, 1, pool);
+
+      if (c == '\n' || c == '\r')
+        {
+          if (c == '\r' && !is_one_at_eof(file, 1) && *file->curp == '\n')
+            {
+              if (buf)
+                svn_stringbuf_appendbyte(buf, '\n');
+              INCREMENT_POINTERS(file, 1, pool);
+            }
+
+          *had_eol = TRUE;
+          break;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Move the pointers of FILE, which must be at the start of a line, back to
+ * the start of the previous line, which must not start before MIN_OFFSET,
+ * and set BUF to the contents of that line.  Set *FOUND to FALSE and leave
+ * the pointers anywhere after MIN_OFFSET if there is no such line. */
+static svn_error_t *
+skip_line_backward(svn_boolean_t *found, svn_stringbuf_t *buf,
+                   struct file_info *file, apr_off_t min_offset,
+                   apr_pool_t *pool)
+{
+  apr_off_t offset = get_file_offset(file);
+  apr_size_t i;
+  char c;
+
+  *found = FALSE;
+  svn_stringbuf_setempty(buf);
+  if (offset <= min_offset)
+    return SVN_NO_ERROR;
+
+  /* The eol sequence that ends the line.  If there is none, our position
+   * was not at the start of a line. */
+  DECREMENT_POINTERS(file, 1, pool);
+  c = *file->curp;
+  if (c != '\n' && c != '\r')
+    return SVN_NO_ERROR;
+
+  svn_stringbuf_appendbyte(buf, c);
+  if (c == '\n' && --offset > min_offset)
+    {
+      DECREMENT_POINTERS(file, 1, pool);
+      if (*file->curp == '\r')
+        svn_stringbuf_appendbyte(buf, '\r');
       else
-        for (i = 1, is_match = TRUE; i < file_len; i++)
-          is_match = is_match && *file[0].curp == *file[i].curp;
+        INCREMENT_POINTERS(file, 1, pool);
     }
 
-  if (had_cr)
+  /* Collect the line contents up to the previous eol. */
+  for (offset = get_file_offset(file); offset > min_offset; offset--)
     {
-      /* Check if we ended in the middle of a \r\n for one file, but \r for
-         another. If so, back up one byte, so the next loop will back up
-         the entire line. Also decrement lines, since we counted one
-         too many for the \r. */
-      svn_boolean_t ended_at_nonmatching_newline = FALSE;
-      for (i = 0; i < file_len; i++)
-        if (file[i].curp < file[i].endp)
-          ended_at_nonmatching_newline = ended_at_nonmatching_newline
-                                         || *file[i].curp == '\n';
-      if (ended_at_nonmatching_newline)
+      DECREMENT_POINTERS(file, 1, pool);
+      c = *file->curp;
+      if (c == '\n' || c == '\r')
         {
-          lines--;
-          DECREMENT_POINTERS(file, file_len, pool);
+          INCREMENT_POINTERS(file, 1, pool);
+          break;
+        }
+
+      svn_stringbuf_appendbyte(buf, c);
+    }
+
+  /* We collected the line backwards. */
+  for (i = 0; i < buf->len / 2; i++)
+    {
+      c = buf->data[i];
+      buf->data[i] = buf->data[buf->len - 1 - i];
+      buf->data[buf->len - 1 - i] = c;
+    }
+
+  *found = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Compare the lines at the current positions of all FILEs after normalizing
+ * them according to OPTIONS and set *MATCH to whether they are all equal.
+ * If MIN_OFFSET is NULL, compare the lines that start at those positions
+ * and that end with an eol.  Otherwise, compare the lines that end right
+ * before those positions and that don't start before the respective
+ * offset in MIN_OFFSET.
+ *
+ * If all lines match, move the FILEs' pointers past them in the respective
+ * direction.  Otherwise, leave the pointers unchanged.  BUFFERS are used
+ * as temporary storage. */
+static svn_error_t *
+match_normalized_lines(svn_boolean_t *match, struct file_info file[],
+                       apr_size_t file_len, const apr_off_t *min_offset,
+                       const svn_diff_file_options_t *options,
+                       svn_stringbuf_t *buffers[2], apr_pool_t *pool)
+{
+  int chunk[4];
+  apr_off_t offset[4];
+  char *first_line = NULL;
+  apr_off_t first_length = 0;
+  apr_size_t i;
+
+  for (i = 0; i < file_len; i++)
+    {
+      svn_stringbuf_t *buf = buffers[i ? 1 : 0];
+      svn_diff__normalize_state_t state = svn_diff__normalize_state_normal;
+      char *line;
+      apr_off_t length;
+
+      chunk[i] = file[i].chunk;
+      offset[i] = file[i].curp - file[i].buffer;
+
+      if (min_offset)
+        {
+          SVN_ERR(skip_line_backward(match, buf, &file[i], min_offset[i],
+                                     pool));
+        }
+      else
+        {
+          svn_stringbuf_setempty(buf);
+          SVN_ERR(skip_line(match, buf, &file[i], pool));
+        }
+
+      if (! *match)
+        break;
+
+      line = buf->data;
+      length = buf->len;
+      svn_diff__normalize_buffer(&line, &length, &state, buf->data, options);
+
+      if (i == 0)
+        {
+          first_line = line;
+          first_length = length;
+        }
+      else if (length != first_length
+               || memcmp(line, first_line, (apr_size_t)length) != 0)
+        {
+          *match = FALSE;
+          break;
         }
     }
 
-  /* Back up one byte, so we point at the last identical byte */
-  DECREMENT_POINTERS(file, file_len, pool);
+  /* Restore the positions of all files we moved. */
+  if (! *match)
+    {
+      apr_size_t moved = i + 1;
+
+      for (i = 0; i < moved; i++)
+        SVN_ERR(seek_chunk(&file[i], chunk[i], offset[i], pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Find the prefix which is identical between all elements of the FILE array.
+ * Return the number of prefix lines in PREFIX_LINES.  REACHED_ONE_EOF will be
+ * set to TRUE if one of the FILEs reached its end while scanning prefix,
+ * i.e. at least one file consisted entirely of prefix.  Otherwise,
+ * REACHED_ONE_EOF is set to FALSE.
+ *
+ * If OPTIONS ignore whitespace or eol styles, lines that are equal after
+ * normalization are part of the prefix as well.  BUFFERS are used as
+ * temporary storage to compare them.
+ *
+ * After this function is finished, the buffers, chunks, curp's and endp's
+ * of the FILEs are set to point at the first byte after the prefix. */
+static svn_error_t *
+find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
+                      struct file_info file[], apr_size_t file_len,
+                      const svn_diff_file_options_t *options,
+                      svn_stringbuf_t *buffers[2],
+                      apr_pool_t *pool)
+{
+  scan_func_t scan = get_forward_scan_func();
+  svn_boolean_t had_cr;
+  svn_boolean_t is_match;
+  apr_off_t lines = 0;
+  apr_size_t i;
+
+  *reached_one_eof = FALSE;
+
+  while (1)
+    {
+      had_cr = FALSE;
+      for (i = 1, is_match = TRUE; i < file_len; i++)
+        is_match = is_match && *file[0].curp == *file[i].curp;
+      while (is_match)
+        {
+          const char *data[4];
+          apr_size_t max_len = CHUNK_SIZE;
+
+          /* check for eol, and count */
+          if (*file[0].curp == '\r')
+            {
+              lines++;
+              had_cr = TRUE;
+            }
+          else if (*file[0].curp == '\n' && !had_cr)
+            {
+              lines++;
+            }
+          else
+            {
+              had_cr = FALSE;
+            }
+
+          INCREMENT_POINTERS(file, file_len, pool);
+
+          /* Try to advance as far as possible with block-wise comparisons.
+           * Determine how far we may advance without reaching endp for any
+           * of the files.  Leave at least one byte to be checked below. */
+          for (i = 0; i < file_len; i++)
+            {
+              apr_size_t remaining = file[i].endp - file[i].curp;
+              if (remaining < max_len)
+                max_len = remaining;
+
+              data[i] = file[i].curp;
+            }
+
+          if (max_len > 1)
+            {
+              apr_size_t delta = scan(&lines, &had_cr, data, file_len,
+                                      max_len - 1);
+              for (i = 0; i < file_len; i++)
+                file[i].curp += delta;
+            }
+
+          *reached_one_eof = is_one_at_eof(file, file_len);
+          if (*reached_one_eof)
+            break;
+          else
+            for (i = 1, is_match = TRUE; i < file_len; i++)
+              is_match = is_match && *file[0].curp == *file[i].curp;
+        }
+
+      if (had_cr)
+        {
+          /* Check if we ended in the middle of a \r\n for one file, but \r
+             for another. If so, back up one byte, so the next loop will back
+             up the entire line. Also decrement lines, since we counted one
+             too many for the \r. */
+          svn_boolean_t ended_at_nonmatching_newline = FALSE;
+          for (i = 0; i < file_len; i++)
+            if (file[i].curp < file[i].endp)
+              ended_at_nonmatching_newline = ended_at_nonmatching_newline
+                                             || *file[i].curp == '\n';
+          if (ended_at_nonmatching_newline)
+            {
+              lines--;
+              DECREMENT_POINTERS(file, file_len, pool);
+            }
+        }
+
+      /* Back up one byte, so we point at the last identical byte */
+      DECREMENT_POINTERS(file, file_len, pool);
+
+      /* Back up to the last eol sequence (\n, \r\n or \r) */
+      while (!is_one_at_bof(file, file_len) &&
+             *file[0].curp != '\n' && *file[0].curp != '\r')
+        DECREMENT_POINTERS(file, file_len, pool);
 
-  /* Back up to the last eol sequence (\n, \r\n or \r) */
-  while (!is_one_at_bof(file, file_len) &&
-         *file[0].curp != '\n' && *file[0].curp != '\r')
-    DECREMENT_POINTERS(file, file_len, pool);
+      /* Slide one byte forward, to point past the eol sequence */
+      INCREMENT_POINTERS(file, file_len, pool);
 
-  /* Slide one byte forward, to point past the eol sequence */
-  INCREMENT_POINTERS(file, file_len, pool);
+      if (*reached_one_eof
+          || (! options->ignore_eol_style
+              && options->ignore_space == svn_diff_file_ignore_space_none))
+        break;
+
+      /* The next lines differ.  But they might still be equal when
+         ignoring whitespace or eol styles.  If so, continue behind them. */
+      SVN_ERR(match_normalized_lines(&is_match, file, file_len, NULL,
+                                     options, buffers, pool));
+      if (! is_match)
+        break;
+
+      lines++;
+      *reached_one_eof = is_one_at_eof(file, file_len);
+      if (*reached_one_eof)
+        break;
+    }
 
   *prefix_lines = lines;
 
@@ -526,7 +1211,9 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
 #endif
 
 /* Find the suffix which is identical between all elements of the FILE array.
- * Return the number of suffix lines in SUFFIX_LINES.
+ * Return the number of suffix lines in SUFFIX_LINES.  Lines that are equal
+ * after normalizing them according to OPTIONS are part of the suffix as
+ * well.  BUFFERS are used as temporary storage to compare them.
  *
  * Before this function is called the FILEs' pointers and chunks should be
  * positioned right after the identical prefix (which is the case after
@@ -534,13 +1221,15 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
  * ultimately stop. */
 static svn_error_t *
 find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
-                      apr_size_t file_len, apr_pool_t *pool)
+                      apr_size_t file_len,
+                      const svn_diff_file_options_t *options,
+                      svn_stringbuf_t *buffers[2],
+                      apr_pool_t *pool)
 {
   struct file_info file_for_suffix[4] = { { 0 }  };
   apr_off_t length[4];
-  apr_off_t suffix_min_chunk0;
-  apr_off_t suffix_min_offset0;
-  apr_off_t min_file_size;
+  apr_off_t prefix_end[4];
+  scan_func_t scan = get_backward_scan_func();
   int suffix_lines_to_keep = SUFFIX_LINES_TO_KEEP;
   svn_boolean_t is_match;
   apr_off_t lines = 0;
@@ -583,157 +1272,155 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
       file_for_suffix[i].curp = file_for_suffix[i].endp - 1;
     }
 
-  /* Get the chunk and pointer offset (for file[0]) at which we should stop
-     scanning backward for the identical suffix, i.e. when we reach prefix. */
-  suffix_min_chunk0 = file[0].chunk;
-  suffix_min_offset0 = file[0].curp - file[0].buffer;
+  /* Get the offsets at which we should stop scanning backward for the
+     identical suffix, i.e. when we reach the prefix.  Because lines that
+     only match after normalization may differ in length, these are
+     tracked per file. */
+  for (i = 0; i < file_len; i++)
+    prefix_end[i] = get_file_offset(&file[i]);
 
-  /* Compensate if other files are smaller than file[0] */
-  for (i = 1, min_file_size = file[0].size; i < file_len; i++)
-    if (file[i].size < min_file_size)
-      min_file_size = file[i].size;
-  if (file[0].size > min_file_size)
+  while (1)
     {
-      suffix_min_chunk0 += (file[0].size - min_file_size) / CHUNK_SIZE;
-      suffix_min_offset0 += (file[0].size - min_file_size) % CHUNK_SIZE;
-    }
+      svn_boolean_t scanned_any;
 
-  /* Scan backwards until mismatch or until we reach the prefix. */
-  for (i = 1, is_match = TRUE; i < file_len; i++)
-    is_match = is_match
-               && *file_for_suffix[0].curp == *file_for_suffix[i].curp;
-  if (is_match && *file_for_suffix[0].curp != '\r'
-               && *file_for_suffix[0].curp != '\n')
-    /* Count an extra line for the last line not ending in an eol. */
-    lines++;
-
-  had_nl = FALSE;
-  while (is_match)
-    {
-      svn_boolean_t reached_prefix;
-#if SVN_UNALIGNED_ACCESS_IS_OK
-      /* Initialize the minimum pointer positions. */
-      const char *min_curp[4];
-      svn_boolean_t can_read_word;
-#endif /* SVN_UNALIGNED_ACCESS_IS_OK */
-
-      /* ### TODO: see if we can take advantage of
-         diff options like ignore_eol_style or ignore_space. */
-      /* check for eol, and count */
-      if (*file_for_suffix[0].curp == '\n')
-        {
-          lines++;
-          had_nl = TRUE;
-        }
-      else if (*file_for_suffix[0].curp == '\r' && !had_nl)
-        {
-          lines++;
-        }
-      else
+      /* Scan backwards until mismatch or until we reach the prefix. */
+      for (i = 1, is_match = TRUE; i < file_len; i++)
+        is_match = is_match
+                   && *file_for_suffix[0].curp == *file_for_suffix[i].curp;
+      if (is_match && *file_for_suffix[0].curp != '\r'
+                   && *file_for_suffix[0].curp != '\n')
+        /* Count an extra line for the last line not ending in an eol. */
+        lines++;
+
+      scanned_any = is_match;
+      had_nl = FALSE;
+      while (is_match)
         {
-          had_nl = FALSE;
-        }
-
-      DECREMENT_POINTERS(file_for_suffix, file_len, pool);
-
-#if SVN_UNALIGNED_ACCESS_IS_OK
-      for (i = 0; i < file_len; i++)
-        min_curp[i] = file_for_suffix[i].buffer;
+          const char *data[4];
+          apr_off_t max_len = CHUNK_SIZE;
 
-      /* If we are in the same chunk that contains the last part of the common
-         prefix, use the min_curp[0] pointer to make sure we don't get a
-         suffix that overlaps the already determined common prefix. */
-      if (file_for_suffix[0].chunk == suffix_min_chunk0)
-        min_curp[0] += suffix_min_offset0;
+          /* check for eol, and count */
+          if (*file_for_suffix[0].curp == '\n')
+            {
+              lines++;
+              had_nl = TRUE;
+            }
+          else if (*file_for_suffix[0].curp == '\r' && !had_nl)
+            {
+              lines++;
+            }
+          else
+            {
+              had_nl = FALSE;
+            }
 
-      /* Scan quickly by reading with machine-word granularity. */
-      for (i = 0, can_read_word = TRUE; can_read_word && i < file_len; i++)
-        can_read_word = ((file_for_suffix[i].curp + 1 - sizeof(apr_uintptr_t))
-                         > min_curp[i]);
+          DECREMENT_POINTERS(file_for_suffix, file_len, pool);
+          if (is_one_at_bof(file_for_suffix, file_len))
+            break;
 
-      while (can_read_word)
-        {
-          apr_uintptr_t chunk;
+          /* Scan quickly with block-wise comparisons.  Make sure we don't
+             get a suffix that overlaps the already determined common prefix
+             and leave the first byte of each chunk for the byte-wise loop.
+           */
+          for (i = 0; i < file_len; i++)
+            {
+              apr_off_t chunk_start
+                = chunk_to_offset((apr_off_t)file_for_suffix[i].chunk);
+              apr_off_t available = file_for_suffix[i].curp
+                                    - file_for_suffix[i].buffer;
+
+              if (prefix_end[i] > chunk_start)
+                available -= prefix_end[i] - chunk_start;
+              if (available < max_len)
+                max_len = available;
+
+              /* For each file curp is positioned at the current byte, but we
+                 want to examine the current byte and the ones before it. */
+              data[i] = file_for_suffix[i].curp + 1;
+            }
 
-          /* For each file curp is positioned at the current byte, but we
-             want to examine the current byte and the ones before the current
-             location as one machine word. */
+          if (max_len > 0)
+            {
+              apr_size_t delta = scan(&lines, &had_nl, data, file_len,
+                                      (apr_size_t)max_len);
+              for (i = 0; i < file_len; i++)
+                file_for_suffix[i].curp -= delta;
+            }
 
-          chunk = *(const apr_uintptr_t *)(file_for_suffix[0].curp + 1
-                                             - sizeof(apr_uintptr_t));
-          if (contains_eol(chunk))
+          if (is_one_at_prefix(file_for_suffix, file_len, prefix_end))
             break;
 
-          for (i = 1, is_match = TRUE; is_match && i < file_len; i++)
-            is_match = (chunk
-                           == *(const apr_uintptr_t *)
-                                    (file_for_suffix[i].curp + 1
-                                       - sizeof(apr_uintptr_t)));
+          is_match = TRUE;
+          for (i = 1; i < file_len; i++)
+            is_match = is_match
+                       && *file_for_suffix[0].curp == *file_for_suffix[i].curp;
+        }
 
-          if (! is_match)
-            break;
+      /* Slide one byte forward, to point at the first byte of identical
+         suffix */
+      INCREMENT_POINTERS(file_for_suffix, file_len, pool);
 
-          for (i = 0; i < file_len; i++)
+      /* Slide forward until we find an eol sequence to add the rest of the
+         line we're in. */
+      if (scanned_any)
+        {
+          svn_boolean_t had_cr = FALSE;
+          while (!is_one_at_eof(file_for_suffix, file_len)
+                 && *file_for_suffix[0].curp != '\n'
+                 && *file_for_suffix[0].curp != '\r')
+            INCREMENT_POINTERS(file_for_suffix, file_len, pool);
+
+          /* Slide one or two more bytes, to point past the eol. */
+          if (!is_one_at_eof(file_for_suffix, file_len)
+              && *file_for_suffix[0].curp == '\r')
             {
-              file_for_suffix[i].curp -= sizeof(apr_uintptr_t);
-              can_read_word = can_read_word
-                              && (  (file_for_suffix[i].curp + 1
-                                       - sizeof(apr_uintptr_t))
-                                  > min_curp[i]);
+              lines--;
+              had_cr = TRUE;
+              INCREMENT_POINTERS(file_for_suffix, file_len, pool);
+            }
+          if (!is_one_at_eof(file_for_suffix, file_len)
+              && *file_for_suffix[0].curp == '\n')
+            {
+              if (!had_cr)
+                lines--;
+              INCREMENT_POINTERS(file_for_suffix, file_len, pool);
             }
-
-          /* We skipped some bytes, so there are no closing EOLs */
-          had_nl = FALSE;
         }
 
-      /* The > min_curp[i] check leaves at least one final byte for checking
-         in the non block optimized case below. */
-#endif
+      if (! options->ignore_eol_style
+          && options->ignore_space == svn_diff_file_ignore_space_none)
+        break;
 
-      reached_prefix = file_for_suffix[0].chunk == suffix_min_chunk0
-                       && (file_for_suffix[0].curp - file_for_suffix[0].buffer)
-                          == suffix_min_offset0;
-      if (reached_prefix || is_one_at_bof(file_for_suffix, file_len))
+      /* The previous lines differ.  But they might still be equal when
+         ignoring whitespace or eol styles.  If so, continue before them. */
+      SVN_ERR(match_normalized_lines(&is_match, file_for_suffix, file_len,
+                                     prefix_end, options, buffers, pool));
+      if (! is_match)
         break;
 
-      is_match = TRUE;
-      for (i = 1; i < file_len; i++)
-        is_match = is_match
-                   && *file_for_suffix[0].curp == *file_for_suffix[i].curp;
-    }
+      lines++;
+      if (is_one_at_prefix(file_for_suffix, file_len, prefix_end))
+        break;
 
-  /* Slide one byte forward, to point at the first byte of identical suffix */
-  INCREMENT_POINTERS(file_for_suffix, file_len, pool);
+      /* Continue with the eol of the line before. */
+      DECREMENT_POINTERS(file_for_suffix, file_len, pool);
+    }
 
-  /* Slide forward until we find an eol sequence to add the rest of the line
-     we're in. Then add SUFFIX_LINES_TO_KEEP more lines. Stop if at least
-     one file reaches its end. */
-  do
+  /* Add SUFFIX_LINES_TO_KEEP more lines to the middle section.  Stop if
+     at least one file reaches its end.  The files may be positioned
+     differently by now, so advance them independently. */
+  while (!is_one_at_eof(file_for_suffix, file_len)
+         && suffix_lines_to_keep--)
     {
-      svn_boolean_t had_cr = FALSE;
-      while (!is_one_at_eof(file_for_suffix, file_len)
-             && *file_for_suffix[0].curp != '\n'
-             && *file_for_suffix[0].curp != '\r')
-        INCREMENT_POINTERS(file_for_suffix, file_len, pool);
-
-      /* Slide one or two more bytes, to point past the eol. */
-      if (!is_one_at_eof(file_for_suffix, file_len)
-          && *file_for_suffix[0].curp == '\r')
-        {
-          lines--;
-          had_cr = TRUE;
-          INCREMENT_POINTERS(file_for_suffix, file_len, pool);
-        }
-      if (!is_one_at_eof(file_for_suffix, file_len)
-          && *file_for_suffix[0].curp == '\n')
+      for (i = 0; i < file_len; i++)
         {
-          if (!had_cr)
+          svn_boolean_t had_eol;
+
+          SVN_ERR(skip_line(&had_eol, NULL, &file_for_suffix[i], pool));
+          if (i == 0 && had_eol)
             lines--;
-          INCREMENT_POINTERS(file_for_suffix, file_len, pool);
         }
     }
-  while (!is_one_at_eof(file_for_suffix, file_len)
-         && suffix_lines_to_keep--);
 
   if (is_one_at_eof(file_for_suffix, file_len))
     lines = 0;
@@ -780,6 +1467,7 @@ datasources_open(void *baton,
   apr_off_t length[4];
 #ifndef SVN_DISABLE_PREFIX_SUFFIX_SCANNING
   svn_boolean_t reached_one_eof;
+  svn_stringbuf_t *buffers[2];
 #endif
   apr_size_t i;
 
@@ -820,13 +1508,18 @@ datasources_open(void *baton,
 
 #ifndef SVN_DISABLE_PREFIX_SUFFIX_SCANNING
 
+  buffers[0] = svn_stringbuf_create_empty(file_baton->pool);
+  buffers[1] = svn_stringbuf_create_empty(file_baton->pool);
+
   SVN_ERR(find_identical_prefix(&reached_one_eof, prefix_lines,
-                                files, datasources_len, file_baton->pool));
+                                files, datasources_len, file_baton->options,
+                                buffers, file_baton->pool));
 
   if (!reached_one_eof)
     /* No file consisted totally of identical prefix,
      * so there may be some identical suffix.  */
     SVN_ERR(find_identical_suffix(suffix_lines, files, datasources_len,
+                                  file_baton->options, buffers,
                                   file_baton->pool));
 
 #endif
@@ -863,11 +1556,12 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
   char *eol;
   apr_off_t last_chunk;
   apr_off_t length;
-  apr_uint32_t h = 0;
+  svn_diff__line_hash_t line_hash;
   /* Did the last chunk end in a CR character? */
   svn_boolean_t had_cr = FALSE;
 
   *token = NULL;
+  svn_diff__line_hash_init(&line_hash);
 
   curp = file->curp;
   endp = file->endp;
@@ -950,9 +1644,22 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
             file_token->norm_offset += (c - curp);
           }
         file_token->length += length;
-        h = svn__adler32(h, c, length);
+        svn_diff__line_hash_update(&line_hash, c, (apr_size_t)length);
       }
 
+      /* Keep the chunk that we are done with for token_compare(). */
+      if (file_baton->cached_chunks < CACHED_CHUNKS_MAX)
+        {
+          if (file->chunks == NULL)
+            file->chunks = apr_pcalloc(file_baton->pool,
+                                       sizeof(*file->chunks)
+                                       * (apr_size_t)(last_chunk + 1));
+
+          file->chunks[file->chunk] = file->buffer;
+          file_baton->cached_chunks++;
+          file->buffer = apr_palloc(file_baton->pool, CHUNK_SIZE);
+        }
+
       curp = endp = file->buffer;
       file->chunk++;
       length = file->chunk == last_chunk ?
@@ -1007,7 +1714,10 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
 
       file_token->length += length;
 
-      *hash = svn__adler32(h, c, length);
+      svn_diff__line_hash_update(&line_hash, c, (apr_size_t)length);
+      file_token->hash = svn_diff__line_hash_final(&line_hash);
+
+      *hash = SVN_DIFF__LINE_HASH_32(file_token->hash);
       *token = file_token;
     }
 
@@ -1016,6 +1726,29 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
 
 #define COMPARE_CHUNK_SIZE 4096
 
+/* Return a pointer to the normalized contents of TOKEN from FILE, if they
+ * are still in memory.  Return NULL otherwise. */
+static char *
+token_in_memory(const struct file_info *file,
+                const svn_diff__file_token_t *token)
+{
+  apr_off_t chunk = offset_to_chunk(token->norm_offset);
+
+  /* If the start of the token is in memory, the entire token is
+   * in memory.
+   */
+  if (chunk == file->chunk)
+    return file->buffer + offset_in_chunk(token->norm_offset);
+
+  /* Tokens from earlier chunks must not continue in the next one. */
+  if (file->chunks && chunk <= offset_to_chunk(file->size)
+      && file->chunks[chunk]
+      && offset_to_chunk(token->offset + token->raw_length - 1) == chunk)
+    return file->chunks[chunk] + offset_in_chunk(token->norm_offset);
+
+  return NULL;
+}
+
 /* Implements svn_diff_fns2_t::token_compare */
 static svn_error_t *
 token_compare(void *baton, void *token1, void *token2, int *compare)
@@ -1054,6 +1787,14 @@ token_compare(void *baton, void *token1, void *token2, int *compare)
       return SVN_NO_ERROR;
     }
 
+  /* Tokens with different line hashes differ.  Only tokens with equal
+   * hashes, i.e. almost always equal tokens, need to be compared. */
+  if (file_token[0]->hash != file_token[1]->hash)
+    {
+      *compare = file_token[0]->hash < file_token[1]->hash ? -1 : 1;
+      return SVN_NO_ERROR;
+    }
+
   for (i = 0; i < 2; ++i)
     {
       int idx = datasource_to_index(file_token[i]->datasource);
@@ -1062,14 +1803,9 @@ token_compare(void *baton, void *token1, void *token2, int *compare)
       offset[i] = file_token[i]->norm_offset;
       state[i] = svn_diff__normalize_state_normal;
 
-      if (offset_to_chunk(offset[i]) == file[i]->chunk)
+      bufp[i] = token_in_memory(file[i], file_token[i]);
+      if (bufp[i])
         {
-          /* If the start of the token is in memory, the entire token is
-           * in memory.
-           */
-          bufp[i] = file[i]->buffer;
-          bufp[i] += offset_in_chunk(offset[i]);
-
           length[i] = total_length;
           raw_length[i] = 0;
         }
@@ -1182,6 +1918,9 @@ static const svn_diff_fns2_t svn_diff__file_vtable =
 /* Id for the --ignore-eol-style option, which doesn't have a short name. */
 #define SVN_DIFF__OPT_IGNORE_EOL_STYLE 256
 
+/* Id for the --histogram option, which doesn't have a short name. */
+#define SVN_DIFF__OPT_HISTOGRAM 257
+
 /* Options supported by svn_diff_file_options_parse(). */
 static const apr_getopt_option_t diff_options[] =
 {
@@ -1193,6 +1932,7 @@ static const apr_getopt_option_t diff_options[] =
    * ### we don't have optional argument support. */
   { "unified", 'u', 0, NULL },
   { "context", 'U', 1, NULL },
+  { "histogram", SVN_DIFF__OPT_HISTOGRAM, 0, NULL },
   { NULL, 0, 0, NULL }
 };
 
@@ -1298,6 +2038,9 @@ svn_diff_file_options_parse(svn_diff_file_options_t *options,
         case 'U':
           SVN_ERR(svn_cstring_atoi(&options->context_size, opt_arg));
           break;
+        case SVN_DIFF__OPT_HISTOGRAM:
+          options->histogram = TRUE;
+          break;
         default:
           break;
         }
@@ -1326,7 +2069,8 @@ svn_diff_file_diff_2(svn_diff_t **diff,
   baton.files[1].path = modified;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff_2(diff, &baton, &svn_diff__file_vtable,
+                           options->histogram, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
@@ -1348,7 +2092,8 @@ svn_diff_file_diff3_2(svn_diff_t **diff,
   baton.files[2].path = latest;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff3_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff3(diff, &baton, &svn_diff__file_vtable,
+                          options->histogram, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
@@ -22,9 +22,15 @@
  */
 
 
+#include <stdlib.h>
+
 #include <apr.h>
 #include <apr_pools.h>
 #include <apr_general.h>
+#include <apr_tables.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "diff.h"
 
@@ -228,6 +234,35 @@ prepend_lcs(svn_diff__lcs_t *lcs, apr_off_t lines,
 }
 
 
+/* Return a new lcs chunk of length 0 that marks the end of the position
+ * lists POSITION_LIST1 and POSITION_LIST2 followed by SUFFIX_LINES lines.
+ * Either list may be NULL, in which case PREFIX_LINES lines precede the
+ * end.  Allocate the result in POOL. */
+static svn_diff__lcs_t *
+create_eof_lcs(svn_diff__position_t *position_list1,
+               svn_diff__position_t *position_list2,
+               apr_off_t prefix_lines,
+               apr_off_t suffix_lines,
+               apr_pool_t *pool)
+{
+  svn_diff__lcs_t *lcs = apr_palloc(pool, sizeof(*lcs));
+
+  lcs->position[0] = apr_pcalloc(pool, sizeof(*lcs->position[0]));
+  lcs->position[0]->offset = position_list1
+                             ? position_list1->offset + suffix_lines + 1
+                             : prefix_lines + suffix_lines + 1;
+  lcs->position[1] = apr_pcalloc(pool, sizeof(*lcs->position[1]));
+  lcs->position[1]->offset = position_list2
+                             ? position_list2->offset + suffix_lines + 1
+                             : prefix_lines + suffix_lines + 1;
+  lcs->length = 0;
+  lcs->refcount = 1;
+  lcs->next = NULL;
+
+  return lcs;
+}
+
+
 svn_diff__lcs_t *
 svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
               svn_diff__position_t *position_list2, /* pointer to tail (ring) */
@@ -253,18 +288,8 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
   /* Since EOF is always a sync point we tack on an EOF link
    * with sentinel positions
    */
-  lcs = apr_palloc(pool, sizeof(*lcs));
-  lcs->position[0] = apr_pcalloc(pool, sizeof(*lcs->position[0]));
-  lcs->position[0]->offset = position_list1
-                             ? position_list1->offset + suffix_lines + 1
-                             : prefix_lines + suffix_lines + 1;
-  lcs->position[1] = apr_pcalloc(pool, sizeof(*lcs->position[1]));
-  lcs->position[1]->offset = position_list2
-                             ? position_list2->offset + suffix_lines + 1
-                             : prefix_lines + suffix_lines + 1;
-  lcs->length = 0;
-  lcs->refcount = 1;
-  lcs->next = NULL;
+  lcs = create_eof_lcs(position_list1, position_list2, prefix_lines,
+                       suffix_lines, pool);
 
   if (position_list1 == NULL || position_list2 == NULL)
     {
@@ -373,3 +398,638 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
   else
     return lcs;
 }
+
+
+/*
+ * The histogram algorithm, as introduced by JGit and also used by Git.
+ *
+ * Myers' algorithm needs O((M+N)D) time for D differences.  That is fine
+ * for small changes but large generated files, e.g. with thousands of
+ * identical lines, make it crawl because there are many equally good
+ * paths to explore.
+ *
+ * The histogram algorithm instead looks for the common line that occurs
+ * least often in the first sequence, extends it to a maximal run of
+ * matching lines and uses that run to split both sequences into the parts
+ * before and after it.  These parts are processed the same way until no
+ * common lines are left.  Lines that are unique in both sequences are the
+ * best split points.  Like the patience diff, we use all of them in one
+ * step as long as there are any, which keeps the number of steps low.
+ * Small ranges whose common lines all occur too often to serve as split
+ * points get handed over to svn_diff__lcs().  Larger ones get split at
+ * the middle occurrence of their least frequent common line first, so
+ * highly repetitive input never reaches svn_diff__lcs() as a whole.
+ *
+ * The result is not necessarily minimal but usually matches the structure
+ * of the text better than the one of the Myers algorithm.
+ */
+
+/* Lines that occur more often than this within the first sequence of
+ * a range will not be used as split points. */
+#define HISTOGRAM_MAX_CHAIN 64
+
+/* Ranges without split points that have more lines than this in both
+ * sequences together will be split before being handed to svn_diff__lcs().
+ * The latter needs O((M+N)D) time, i.e. at most about a million steps
+ * for this size. */
+#define HISTOGRAM_MYERS_MAX 1024
+
+/* A pair of ranges within the two sequences, given as half-open index
+ * intervals [START[i], END[i]). */
+typedef struct histogram_range_t
+{
+  apr_off_t start[2];
+  apr_off_t end[2];
+} histogram_range_t;
+
+/* LENGTH matching lines, starting at index START[i] in the sequences. */
+typedef struct histogram_match_t
+{
+  apr_off_t start[2];
+  apr_off_t length;
+} histogram_match_t;
+
+/* State shared by all steps of the histogram algorithm. */
+typedef struct histogram_baton_t
+{
+  /* The elements of both position lists in order. */
+  svn_diff__position_t **positions[2];
+
+  /* Number of different tokens, i.e. the size of the following arrays. */
+  svn_diff__token_index_t num_tokens;
+
+  /* Per token, the number of occurrences in either sequence of the
+   * current range and the index of the last one in the first sequence.
+   * COUNTS are all 0 in between steps, LAST is only valid for tokens
+   * with non-zero COUNTS[0]. */
+  svn_diff__token_index_t *counts[2];
+  apr_off_t *last;
+
+  /* Per line of the first sequence, the index of the previous occurrence
+   * of the same token within the current range or -1. */
+  apr_off_t *previous;
+
+  /* Per token, its index in the reduced token set used by myers_range()
+   * or -1 outside that function. */
+  svn_diff__token_index_t *token_map;
+
+  /* Ranges still to process, array of histogram_range_t. */
+  apr_array_header_t *ranges;
+
+  /* Matches found so far in no particular order, array of
+   * histogram_match_t. */
+  apr_array_header_t *matches;
+
+  /* For temporary allocations within a step. */
+  apr_pool_t *scratch_pool;
+} histogram_baton_t;
+
+/* Token of the line with the given INDEX in sequence I of BATON. */
+#define TOKEN(baton, i, index) ((baton)->positions[i][index]->token_index)
+
+/* Add LENGTH matching lines starting at START0 and START1 to BATON. */
+static void
+add_match(histogram_baton_t *baton,
+          apr_off_t start0,
+          apr_off_t start1,
+          apr_off_t length)
+{
+  histogram_match_t *match = apr_array_push(baton->matches);
+
+  match->start[0] = start0;
+  match->start[1] = start1;
+  match->length = length;
+}
+
+/* Schedule the ranges [START0, END0) and [START1, END1) in BATON for
+ * processing unless one of them is empty. */
+static void
+add_range(histogram_baton_t *baton,
+          apr_off_t start0,
+          apr_off_t end0,
+          apr_off_t start1,
+          apr_off_t end1)
+{
+  histogram_range_t *range;
+
+  if (start0 == end0 || start1 == end1)
+    return;
+
+  range = apr_array_push(baton->ranges);
+  range->start[0] = start0;
+  range->end[0] = end0;
+  range->start[1] = start1;
+  range->end[1] = end1;
+}
+
+/* Find the matching lines within RANGE of BATON using svn_diff__lcs().
+ *
+ * To keep the effort proportional to the size of RANGE, run it on copies
+ * of the position list elements with tokens renumbered such that only
+ * those found in RANGE remain. */
+static void
+myers_range(histogram_baton_t *baton,
+            const histogram_range_t *range)
+{
+  svn_diff__position_t *copies[2];
+  svn_diff__token_index_t **counts = baton->counts;
+  svn_diff__token_index_t num_tokens = 0;
+  apr_off_t length[2];
+  svn_diff__lcs_t *lcs;
+  int i;
+  apr_off_t k;
+
+  for (i = 0; i < 2; ++i)
+    {
+      length[i] = range->end[i] - range->start[i];
+      copies[i] = apr_palloc(baton->scratch_pool,
+                             sizeof(*copies[i]) * (apr_size_t)length[i]);
+
+      for (k = 0; k < length[i]; ++k)
+        {
+          svn_diff__token_index_t token
+            = TOKEN(baton, i, range->start[i] + k);
+
+          if (baton->token_map[token] < 0)
+            baton->token_map[token] = num_tokens++;
+
+          copies[i][k].token_index = baton->token_map[token];
+          copies[i][k].offset
+            = baton->positions[i][range->start[i] + k]->offset;
+          copies[i][k].next = &copies[i][(k + 1) % length[i]];
+          counts[i][copies[i][k].token_index]++;
+        }
+    }
+
+  lcs = svn_diff__lcs(&copies[0][length[0] - 1], &copies[1][length[1] - 1],
+                      counts[0], counts[1], num_tokens, 0, 0,
+                      baton->scratch_pool);
+
+  for (; lcs->length > 0; lcs = lcs->next)
+    add_match(baton,
+              lcs->position[0] - copies[0] + range->start[0],
+              lcs->position[1] - copies[1] + range->start[1],
+              lcs->length);
+
+  /* Restore the invariants of BATON. */
+  for (i = 0; i < 2; ++i)
+    for (k = range->start[i]; k < range->end[i]; ++k)
+      {
+        svn_diff__token_index_t token = TOKEN(baton, i, k);
+
+        if (baton->token_map[token] >= 0)
+          {
+            counts[i][baton->token_map[token]] = 0;
+            counts[1 - i][baton->token_map[token]] = 0;
+            baton->token_map[token] = -1;
+          }
+      }
+
+  svn_pool_clear(baton->scratch_pool);
+}
+
+/* Clear the COUNTS in BATON for all lines within [START[i], END[i]). */
+static void
+reset_counts(histogram_baton_t *baton,
+             const apr_off_t start[2],
+             const apr_off_t end[2])
+{
+  int i;
+  apr_off_t k;
+
+  for (i = 0; i < 2; ++i)
+    for (k = start[i]; k < end[i]; ++k)
+      baton->counts[i][TOKEN(baton, i, k)] = 0;
+}
+
+/* Split the range [START[i], END[i]) of BATON at the longest sequence of
+ * lines that are unique to both sequences and appear in the same order
+ * in both of them.  COUNTS and LAST in BATON must be up to date.
+ * Return FALSE if there are no such lines. */
+static svn_boolean_t
+patience_split(histogram_baton_t *baton,
+               const apr_off_t start[2],
+               const apr_off_t end[2])
+{
+  apr_off_t *unique[2];
+  apr_off_t *tails;
+  apr_off_t *predecessors;
+  apr_off_t count = 0;
+  apr_off_t length = 0;
+  apr_off_t next[2];
+  apr_off_t j, k;
+
+  /* Collect the unique lines in the order of the second sequence. */
+  for (j = start[1]; j < end[1]; ++j)
+    {
+      svn_diff__token_index_t token = TOKEN(baton, 1, j);
+      if (baton->counts[0][token] == 1 && baton->counts[1][token] == 1)
+        ++count;
+    }
+
+  if (count == 0)
+    return FALSE;
+
+  unique[0] = apr_palloc(baton->scratch_pool, sizeof(*unique[0]) * count);
+  unique[1] = apr_palloc(baton->scratch_pool, sizeof(*unique[1]) * count);
+  tails = apr_palloc(baton->scratch_pool, sizeof(*tails) * count);
+  predecessors = apr_palloc(baton->scratch_pool,
+                            sizeof(*predecessors) * count);
+
+  count = 0;
+  for (j = start[1]; j < end[1]; ++j)
+    {
+      svn_diff__token_index_t token = TOKEN(baton, 1, j);
+      if (baton->counts[0][token] == 1 && baton->counts[1][token] == 1)
+        {
+          unique[0][count] = baton->last[token];
+          unique[1][count] = j;
+          ++count;
+        }
+    }
+
+  /* Find the longest increasing subsequence of their positions in the
+   * first sequence by patience sorting.  TAILS[l] is the pair that ends
+   * the best subsequence of length l+1 found so far. */
+  for (k = 0; k < count; ++k)
+    {
+      apr_off_t lower = 0;
+      apr_off_t upper = length;
+
+      while (lower < upper)
+        {
+          apr_off_t middle = lower + (upper - lower) / 2;
+          if (unique[0][tails[middle]] < unique[0][k])
+            lower = middle + 1;
+          else
+            upper = middle;
+        }
+
+      predecessors[k] = lower > 0 ? tails[lower - 1] : -1;
+      tails[lower] = k;
+      if (lower == length)
+        ++length;
+    }
+
+  /* Walk the subsequence backwards and split the range at every line in
+   * it.  The ranges in between get their common prefixes and suffixes
+   * matched when processed. */
+  next[0] = end[0];
+  next[1] = end[1];
+  for (k = tails[length - 1]; k >= 0; k = predecessors[k])
+    {
+      add_match(baton, unique[0][k], unique[1][k], 1);
+      add_range(baton, unique[0][k] + 1, next[0], unique[1][k] + 1, next[1]);
+      next[0] = unique[0][k];
+      next[1] = unique[1][k];
+    }
+
+  add_range(baton, start[0], next[0], start[1], next[1]);
+  svn_pool_clear(baton->scratch_pool);
+
+  return TRUE;
+}
+
+/* Extend the matching lines at index I and J of the sequences in BATON
+ * to a maximal run [RUN_START[k], RUN_END[k]) within [START[k], END[k]).
+ * Return the lowest number of occurrences in the first sequence of any
+ * line in that run.  COUNTS in BATON must be up to date. */
+static svn_diff__token_index_t
+extend_run(apr_off_t run_start[2],
+           apr_off_t run_end[2],
+           histogram_baton_t *baton,
+           const apr_off_t start[2],
+           const apr_off_t end[2],
+           apr_off_t i,
+           apr_off_t j)
+{
+  svn_diff__token_index_t count = baton->counts[0][TOKEN(baton, 0, i)];
+
+  run_start[0] = i;
+  run_start[1] = j;
+  run_end[0] = i + 1;
+  run_end[1] = j + 1;
+
+  while (run_start[0] > start[0] && run_start[1] > start[1]
+         && TOKEN(baton, 0, run_start[0] - 1)
+            == TOKEN(baton, 1, run_start[1] - 1))
+    {
+      --run_start[0];
+      --run_start[1];
+      count = MIN(count, baton->counts[0][TOKEN(baton, 0, run_start[0])]);
+    }
+
+  while (run_end[0] < end[0] && run_end[1] < end[1]
+         && TOKEN(baton, 0, run_end[0]) == TOKEN(baton, 1, run_end[1]))
+    {
+      count = MIN(count, baton->counts[0][TOKEN(baton, 0, run_end[0])]);
+      ++run_end[0];
+      ++run_end[1];
+    }
+
+  return count;
+}
+
+/* Find the matching lines within RANGE of BATON, either directly or by
+ * splitting it into smaller ranges to be processed later. */
+static void
+histogram_range(histogram_baton_t *baton,
+                const histogram_range_t *range)
+{
+  apr_off_t start[2], end[2];
+  apr_off_t best_start[2] = { 0, 0 };
+  apr_off_t best_length = 0;
+  svn_diff__token_index_t best_count = HISTOGRAM_MAX_CHAIN + 1;
+  svn_diff__token_index_t rare_token = 0;
+  svn_diff__token_index_t rare_count = 0;
+  svn_boolean_t has_common = FALSE;
+  apr_off_t i, j, next_j;
+
+  /* Matching lines at either end need no further consideration. */
+  start[0] = range->start[0];
+  start[1] = range->start[1];
+  end[0] = range->end[0];
+  end[1] = range->end[1];
+
+  while (start[0] < end[0] && start[1] < end[1]
+         && TOKEN(baton, 0, start[0]) == TOKEN(baton, 1, start[1]))
+    {
+      ++start[0];
+      ++start[1];
+    }
+
+  if (start[0] > range->start[0])
+    add_match(baton, range->start[0], range->start[1],
+              start[0] - range->start[0]);
+
+  while (start[0] < end[0] && start[1] < end[1]
+         && TOKEN(baton, 0, end[0] - 1) == TOKEN(baton, 1, end[1] - 1))
+    {
+      --end[0];
+      --end[1];
+    }
+
+  if (end[0] < range->end[0])
+    add_match(baton, end[0], end[1], range->end[0] - end[0]);
+
+  if (start[0] == end[0] || start[1] == end[1])
+    return;
+
+  /* Build the histogram of the first sequence. */
+  for (i = start[0]; i < end[0]; ++i)
+    {
+      svn_diff__token_index_t token = TOKEN(baton, 0, i);
+
+      baton->previous[i] = baton->counts[0][token] ? baton->last[token]
+                                                   : -1;
+      baton->last[token] = i;
+      baton->counts[0][token]++;
+    }
+
+  for (j = start[1]; j < end[1]; ++j)
+    baton->counts[1][TOKEN(baton, 1, j)]++;
+
+  /* Lines unique to both sequences are the best split points, so use all
+   * of them at once. */
+  if (patience_split(baton, start, end))
+    {
+      reset_counts(baton, start, end);
+      return;
+    }
+
+  /* Find the longest run of matching lines around the least frequent
+   * line of the second sequence that also occurs in the first one. */
+  for (j = start[1]; j < end[1]; j = next_j)
+    {
+      svn_diff__token_index_t token = TOKEN(baton, 1, j);
+
+      next_j = j + 1;
+      if (baton->counts[0][token] == 0)
+        continue;
+
+      has_common = TRUE;
+      if (rare_count == 0 || baton->counts[0][token] < rare_count)
+        {
+          rare_token = token;
+          rare_count = baton->counts[0][token];
+        }
+
+      if (baton->counts[0][token] > best_count)
+        continue;
+
+      i = baton->last[token];
+      while (i >= start[0])
+        {
+          apr_off_t run_start[2], run_end[2];
+          svn_diff__token_index_t count
+            = extend_run(run_start, run_end, baton, start, end, i, j);
+
+          /* The lines of this run have been covered now. */
+          next_j = MAX(next_j, run_end[1]);
+
+          if (count < best_count
+              || (count == best_count
+                  && run_end[0] - run_start[0] > best_length))
+            {
+              best_start[0] = run_start[0];
+              best_start[1] = run_start[1];
+              best_length = run_end[0] - run_start[0];
+              best_count = count;
+            }
+
+          /* Earlier occurrences within the run would only find the
+           * same run again. */
+          while (i >= run_start[0])
+            i = baton->previous[i];
+        }
+    }
+
+  /* Without usable split points, large ranges would take svn_diff__lcs()
+   * too long.  Pair the middle occurrences of the least frequent common
+   * line in both sequences instead and split at the run around them. */
+  if (best_length == 0 && has_common
+      && end[0] - start[0] + end[1] - start[1] > HISTOGRAM_MYERS_MAX)
+    {
+      apr_off_t run_start[2], run_end[2];
+      svn_diff__token_index_t skip;
+
+      i = baton->last[rare_token];
+      for (skip = rare_count - 1 - rare_count / 2; skip > 0; --skip)
+        i = baton->previous[i];
+
+      skip = baton->counts[1][rare_token] / 2;
+      for (j = start[1]; ; ++j)
+        if (TOKEN(baton, 1, j) == rare_token && skip-- == 0)
+          break;
+
+      extend_run(run_start, run_end, baton, start, end, i, j);
+      best_start[0] = run_start[0];
+      best_start[1] = run_start[1];
+      best_length = run_end[0] - run_start[0];
+    }
+
+  reset_counts(baton, start, end);
+
+  if (best_length > 0)
+    {
+      add_match(baton, best_start[0], best_start[1], best_length);
+      add_range(baton, start[0], best_start[0], start[1], best_start[1]);
+      add_range(baton, best_start[0] + best_length, end[0],
+                best_start[1] + best_length, end[1]);
+    }
+  else if (has_common)
+    {
+      histogram_range_t remainder;
+
+      remainder.start[0] = start[0];
+      remainder.start[1] = start[1];
+      remainder.end[0] = end[0];
+      remainder.end[1] = end[1];
+
+      myers_range(baton, &remainder);
+    }
+}
+
+/* Order histogram_match_t elements by position.  Implements the
+ * comparison function signature of qsort(). */
+static int
+compare_matches(const void *lhs,
+                const void *rhs)
+{
+  const histogram_match_t *lhs_match = lhs;
+  const histogram_match_t *rhs_match = rhs;
+
+  if (lhs_match->start[0] < rhs_match->start[0])
+    return -1;
+
+  return lhs_match->start[0] > rhs_match->start[0] ? 1 : 0;
+}
+
+
+svn_diff__lcs_t *
+svn_diff__lcs_histogram(svn_diff__position_t *position_list1,
+                        svn_diff__position_t *position_list2,
+                        svn_diff__token_index_t *token_counts_list1,
+                        svn_diff__token_index_t *token_counts_list2,
+                        svn_diff__token_index_t num_tokens,
+                        apr_off_t prefix_lines,
+                        apr_off_t suffix_lines,
+                        apr_pool_t *pool)
+{
+  histogram_baton_t baton;
+  svn_diff__position_t *position_list[2];
+  apr_off_t length[2];
+  svn_diff__lcs_t *lcs = NULL;
+  svn_diff__lcs_t **lcs_ref = &lcs;
+  svn_diff__lcs_t *last_lcs = NULL;
+  svn_diff__lcs_t *eof_lcs;
+  apr_pool_t *subpool;
+  svn_diff__token_index_t token_index;
+  int i;
+  int k;
+
+  /* Without lines to compare, there is nothing to gain. */
+  if (position_list1 == NULL || position_list2 == NULL)
+    return svn_diff__lcs(position_list1, position_list2, token_counts_list1,
+                         token_counts_list2, num_tokens, prefix_lines,
+                         suffix_lines, pool);
+
+  subpool = svn_pool_create(pool);
+
+  position_list[0] = position_list1;
+  position_list[1] = position_list2;
+
+  for (i = 0; i < 2; ++i)
+    {
+      svn_diff__position_t *position = position_list[i]->next;
+      apr_off_t index;
+
+      length[i] = position_list[i]->offset - position->offset + 1;
+      baton.positions[i] = apr_palloc(subpool, sizeof(*baton.positions[i])
+                                               * (apr_size_t)length[i]);
+      for (index = 0; index < length[i]; ++index)
+        {
+          baton.positions[i][index] = position;
+          position = position->next;
+        }
+    }
+
+  baton.num_tokens = num_tokens;
+  baton.counts[0] = apr_pcalloc(subpool,
+                                sizeof(*baton.counts[0]) * num_tokens);
+  baton.counts[1] = apr_pcalloc(subpool,
+                                sizeof(*baton.counts[1]) * num_tokens);
+  baton.last = apr_palloc(subpool, sizeof(*baton.last) * num_tokens);
+  baton.previous = apr_palloc(subpool,
+                              sizeof(*baton.previous) * (apr_size_t)length[0]);
+  baton.token_map = apr_palloc(subpool,
+                               sizeof(*baton.token_map) * num_tokens);
+  for (token_index = 0; token_index < num_tokens; ++token_index)
+    baton.token_map[token_index] = -1;
+
+  baton.ranges = apr_array_make(subpool, 16, sizeof(histogram_range_t));
+  baton.matches = apr_array_make(subpool, 16, sizeof(histogram_match_t));
+  baton.scratch_pool = svn_pool_create(subpool);
+
+  /* Process all ranges, starting with the whole sequences.  Since the
+   * ranges never overlap, the order doesn't matter. */
+  add_range(&baton, 0, length[0], 0, length[1]);
+  while (baton.ranges->nelts)
+    {
+      histogram_range_t range
+        = *(histogram_range_t *)apr_array_pop(baton.ranges);
+      histogram_range(&baton, &range);
+    }
+
+  /* Chain the matches in order, merging adjacent ones. */
+  qsort(baton.matches->elts, baton.matches->nelts,
+        baton.matches->elt_size, compare_matches);
+
+  for (k = 0; k < baton.matches->nelts; ++k)
+    {
+      const histogram_match_t *match
+        = &APR_ARRAY_IDX(baton.matches, k, histogram_match_t);
+      svn_diff__position_t *position[2];
+
+      position[0] = baton.positions[0][match->start[0]];
+      position[1] = baton.positions[1][match->start[1]];
+
+      if (last_lcs
+          && last_lcs->position[0]->offset + last_lcs->length
+             == position[0]->offset
+          && last_lcs->position[1]->offset + last_lcs->length
+             == position[1]->offset)
+        {
+          last_lcs->length += match->length;
+          continue;
+        }
+
+      last_lcs = apr_palloc(pool, sizeof(*last_lcs));
+      last_lcs->position[0] = position[0];
+      last_lcs->position[1] = position[1];
+      last_lcs->length = match->length;
+      last_lcs->refcount = 1;
+
+      *lcs_ref = last_lcs;
+      lcs_ref = &last_lcs->next;
+    }
+
+  svn_pool_destroy(subpool);
+
+  /* Append the common suffix and the EOF marker, prepend the common
+   * prefix, just like svn_diff__lcs() does. */
+  eof_lcs = create_eof_lcs(position_list1, position_list2, prefix_lines,
+                           suffix_lines, pool);
+  if (suffix_lines)
+    *lcs_ref = prepend_lcs(eof_lcs, suffix_lines,
+                           eof_lcs->position[0]->offset - suffix_lines,
+                           eof_lcs->position[1]->offset - suffix_lines,
+                           pool);
+  else
+    *lcs_ref = eof_lcs;
+
+  if (prefix_lines)
+    return prepend_lcs(lcs, prefix_lines, 1, 1, pool);
+  else
+    return lcs;
+}
@@ -34,25 +34,31 @@
 
 
 /*
- * Prime number to use as the size of the hash table.  This number was
- * not selected by testing of any kind and may need tweaking.
+ * Initial number of slots in the token hash table.  Must be a power of two.
  */
-#define SVN_DIFF__HASH_SIZE 127
+#define SVN_DIFF__HASH_SIZE_MIN 1024
 
 struct svn_diff__node_t
 {
-  svn_diff__node_t       *parent;
-  svn_diff__node_t       *left;
-  svn_diff__node_t       *right;
-
   apr_uint32_t            hash;
   svn_diff__token_index_t index;
   void                   *token;
 };
 
+/* Despite its name, this is an open-addressing hash table with linear
+ * probing.  It maps tokens to their index, i.e. the order in which the
+ * different tokens have been seen first.  The table is never more than
+ * half full, so lookups rarely need more than one or two probes and only
+ * call token_compare() when the hash values match.
+ */
 struct svn_diff__tree_t
 {
-  svn_diff__node_t       *root[SVN_DIFF__HASH_SIZE];
+  /* The slots.  Unused ones have a NULL token. */
+  svn_diff__node_t       *nodes;
+
+  /* log2 of the number of slots. */
+  int                     shift;
+
   apr_pool_t             *pool;
   svn_diff__token_index_t node_count;
 };
@@ -77,71 +83,203 @@ svn_diff__tree_create(svn_diff__tree_t **tree, apr_pool_t *pool)
   *tree = apr_pcalloc(pool, sizeof(**tree));
   (*tree)->pool = pool;
   (*tree)->node_count = 0;
+  (*tree)->shift = 0;
+  while ((1 << (*tree)->shift) < SVN_DIFF__HASH_SIZE_MIN)
+    (*tree)->shift++;
+
+  (*tree)->nodes = apr_pcalloc(pool, sizeof(*(*tree)->nodes)
+                                     * SVN_DIFF__HASH_SIZE_MIN);
+}
+
+/* Return the first slot to probe in TREE for HASH.  The callers' hash
+ * functions may not spread their values evenly over all bits, so use
+ * Fibonacci hashing to select the slot from the upper bits of the product.
+ */
+static APR_INLINE apr_size_t
+first_slot(const svn_diff__tree_t *tree, apr_uint32_t hash)
+{
+  return (apr_size_t)((hash * APR_UINT64_C(0x9e3779b97f4a7c15))
+                      >> (64 - tree->shift));
 }
 
+/* Double the number of slots in TREE. */
+static void
+tree_grow(svn_diff__tree_t *tree)
+{
+  svn_diff__node_t *old_nodes = tree->nodes;
+  apr_size_t old_size = (apr_size_t)1 << tree->shift;
+  apr_size_t mask;
+  apr_size_t i;
+
+  tree->shift++;
+  mask = ((apr_size_t)1 << tree->shift) - 1;
+  tree->nodes = apr_pcalloc(tree->pool, sizeof(*tree->nodes) * (mask + 1));
+
+  for (i = 0; i < old_size; ++i)
+    if (old_nodes[i].token)
+      {
+        apr_size_t slot = first_slot(tree, old_nodes[i].hash);
+        while (tree->nodes[slot].token)
+          slot = (slot + 1) & mask;
+
+        tree->nodes[slot] = old_nodes[i];
+      }
+}
 
+/* Find TOKEN with hash value HASH in TREE and return its index in *INDEX.
+ * Add it to TREE first if it has not been seen before. */
 static svn_error_t *
-tree_insert_token(svn_diff__node_t **node, svn_diff__tree_t *tree,
+tree_insert_token(svn_diff__token_index_t *index, svn_diff__tree_t *tree,
                   void *diff_baton,
                   const svn_diff_fns2_t *vtable,
                   apr_uint32_t hash, void *token)
 {
-  svn_diff__node_t *new_node;
-  svn_diff__node_t **node_ref;
-  svn_diff__node_t *parent;
+  svn_diff__node_t *node;
+  apr_size_t mask = ((apr_size_t)1 << tree->shift) - 1;
+  apr_size_t slot;
   int rv;
 
   SVN_ERR_ASSERT(token);
 
-  parent = NULL;
-  node_ref = &tree->root[hash % SVN_DIFF__HASH_SIZE];
-
-  while (*node_ref != NULL)
+  for (slot = first_slot(tree, hash);
+       tree->nodes[slot].token;
+       slot = (slot + 1) & mask)
     {
-      parent = *node_ref;
-
-      rv = hash - parent->hash;
-      if (!rv)
-        SVN_ERR(vtable->token_compare(diff_baton, parent->token, token, &rv));
+      node = &tree->nodes[slot];
+      if (node->hash != hash)
+        continue;
 
+      SVN_ERR(vtable->token_compare(diff_baton, node->token, token, &rv));
       if (rv == 0)
         {
           /* Discard the previous token.  This helps in cases where
            * only recently read tokens are still in memory.
            */
           if (vtable->token_discard != NULL)
-            vtable->token_discard(diff_baton, parent->token);
+            vtable->token_discard(diff_baton, node->token);
 
-          parent->token = token;
-          *node = parent;
+          node->token = token;
+          *index = node->index;
 
           return SVN_NO_ERROR;
         }
-      else if (rv > 0)
-        {
-          node_ref = &parent->left;
-        }
-      else
-        {
-          node_ref = &parent->right;
-        }
     }
 
-  /* Create a new node */
-  new_node = apr_palloc(tree->pool, sizeof(*new_node));
-  new_node->parent = parent;
-  new_node->left = NULL;
-  new_node->right = NULL;
-  new_node->hash = hash;
-  new_node->token = token;
-  new_node->index = tree->node_count++;
+  /* Fill the empty slot */
+  node = &tree->nodes[slot];
+  node->hash = hash;
+  node->token = token;
+  node->index = tree->node_count++;
+  *index = node->index;
 
-  *node = *node_ref = new_node;
+  /* Keep the table at most half full. */
+  if ((apr_size_t)tree->node_count > (mask >> 1))
+    tree_grow(tree);
 
   return SVN_NO_ERROR;
 }
 
 
+/* Multipliers taken from MurmurHash3. */
+#define LINE_HASH_C1 APR_UINT64_C(0x87c37b91114253d5)
+#define LINE_HASH_C2 APR_UINT64_C(0x4cf5ad432745937f)
+
+#define ROTL64(value, bits) (((value) << (bits)) | ((value) >> (64 - (bits))))
+
+/* Return the little-endian 64 bit word at DATA.  Most compilers turn this
+ * into a single load on little-endian machines. */
+static APR_INLINE apr_uint64_t
+load_word(const unsigned char *data)
+{
+  return (apr_uint64_t)data[0]
+       | ((apr_uint64_t)data[1] << 8)
+       | ((apr_uint64_t)data[2] << 16)
+       | ((apr_uint64_t)data[3] << 24)
+       | ((apr_uint64_t)data[4] << 32)
+       | ((apr_uint64_t)data[5] << 40)
+       | ((apr_uint64_t)data[6] << 48)
+       | ((apr_uint64_t)data[7] << 56);
+}
+
+/* Return the scrambled WORD to be mixed into the hash. */
+static APR_INLINE apr_uint64_t
+scramble_word(apr_uint64_t word)
+{
+  word *= LINE_HASH_C1;
+  word = ROTL64(word, 31);
+  return word * LINE_HASH_C2;
+}
+
+/* Mix WORD into HASH and return the result. */
+static APR_INLINE apr_uint64_t
+mix_word(apr_uint64_t hash, apr_uint64_t word)
+{
+  hash ^= scramble_word(word);
+  hash = ROTL64(hash, 27);
+  return hash * 5 + 0x52dce729;
+}
+
+void
+svn_diff__line_hash_init(svn_diff__line_hash_t *state)
+{
+  state->hash = 0;
+  state->pending = 0;
+  state->length = 0;
+}
+
+void
+svn_diff__line_hash_update(svn_diff__line_hash_t *state,
+                           const char *data,
+                           apr_size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  apr_uint64_t hash = state->hash;
+  unsigned int filled = (unsigned int)(state->length % 8);
+
+  state->length += len;
+
+  /* Complete the word left over from the previous call. */
+  if (filled)
+    {
+      for (; filled < 8 && len > 0; ++filled, ++p, --len)
+        state->pending |= (apr_uint64_t)*p << (filled * 8);
+
+      if (filled < 8)
+        return;
+
+      hash = mix_word(hash, state->pending);
+      state->pending = 0;
+    }
+
+  for (; len >= 8; p += 8, len -= 8)
+    hash = mix_word(hash, load_word(p));
+
+  for (filled = 0; filled < len; ++filled)
+    state->pending |= (apr_uint64_t)p[filled] << (filled * 8);
+
+  state->hash = hash;
+}
+
+apr_uint64_t
+svn_diff__line_hash_final(const svn_diff__line_hash_t *state)
+{
+  apr_uint64_t hash = state->hash;
+
+  if (state->length % 8)
+    hash ^= scramble_word(state->pending);
+
+  /* Finalization as in MurmurHash3. */
+  hash ^= state->length;
+  hash ^= hash >> 33;
+  hash *= APR_UINT64_C(0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  hash *= APR_UINT64_C(0xc4ceb9fe1a85ec53);
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+
 /*
  * Get all tokens from a datasource.  Return the
  * last item in the (circular) list.
@@ -158,7 +296,7 @@ svn_diff__get_tokens(svn_diff__position_t **position_list,
   svn_diff__position_t *start_position;
   svn_diff__position_t *position = NULL;
   svn_diff__position_t **position_ref;
-  svn_diff__node_t *node;
+  svn_diff__token_index_t token_index;
   void *token;
   apr_off_t offset;
   apr_uint32_t hash;
@@ -176,12 +314,13 @@ svn_diff__get_tokens(svn_diff__position_t **position_list,
         break;
 
       offset++;
-      SVN_ERR(tree_insert_token(&node, tree, diff_baton, vtable, hash, token));
+      SVN_ERR(tree_insert_token(&token_index, tree, diff_baton, vtable,
+                                hash, token));
 
       /* Create a new position */
       position = apr_palloc(pool, sizeof(*position));
       position->next = NULL;
-      position->token_index = node->index;
+      position->token_index = token_index;
       position->offset = offset;
 
       *position_ref = position;
@@ -58,6 +58,18 @@ svn_fs_hotcopy(const char *src_path, const char *dest_path,
                                          FALSE, NULL, NULL, pool));
 }
 
+svn_error_t *
+svn_fs_pack(const char *path,
+            svn_fs_pack_notify_t notify_func,
+            void *notify_baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *pool)
+{
+  return svn_error_trace(svn_fs_pack2(path, 1, notify_func, notify_baton,
+                                      cancel_func, cancel_baton, pool));
+}
+
 svn_error_t *
 svn_fs_begin_txn(svn_fs_txn_t **txn_p, svn_fs_t *fs, svn_revnum_t rev,
                  apr_pool_t *pool)
@@ -1025,6 +1025,7 @@ base_bdb_recover(svn_fs_t *fs,
 static svn_error_t *
 base_bdb_pack(svn_fs_t *fs,
               const char *path,
+              int jobs,
               svn_fs_pack_notify_t notify_func,
               void *notify_baton,
               svn_cancel_func_t cancel,
@@ -30,7 +30,9 @@
 #include "private/svn_delta_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_task.h"
 #include "private/svn_temp_serializer.h"
 
 #include "fs_fs.h"
@@ -40,6 +42,7 @@
 #include "pack.h"
 #include "util.h"
 #include "temp_serializer.h"
+#include "compression_dict.h"
 
 #include "../libsvn_fs/fs-loader.h"
 #include "../libsvn_delta/delta.h"  /* for SVN_DELTA_WINDOW_SIZE */
@@ -133,6 +136,8 @@ dbg_log_access(svn_fs_t *fs,
         description = "  PLAIN";
       else if (header->type == svn_fs_fs__rep_self_delta)
         description = "  DELTA";
+      else if (header->type == svn_fs_fs__rep_chunked)
+        description = "  CHUNKED";
       else
         description = apr_psprintf(scratch_pool,
                                    "  DELTA against %ld/%" APR_UINT64_T_FMT,
@@ -193,21 +198,6 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
-   FS instead of a block size. */
-static svn_error_t *
-aligned_seek(svn_fs_t *fs,
-             apr_file_t *file,
-             apr_off_t *buffer_start,
-             apr_off_t offset,
-             apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(file, ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
-}
-
 /* Open the revision file for revision REV in filesystem FS and store
    the newly opened file in FILE.  Seek to location OFFSET before
    returning.  Perform temporary allocations in POOL. */
@@ -227,7 +217,7 @@ open_and_seek_revision(svn_fs_fs__revision_file_t **file,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL, item,
                                  pool));
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset, pool));
 
   *file = rev_file;
 
@@ -249,7 +239,7 @@ open_and_seek_transaction(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, NULL, SVN_INVALID_REVNUM,
                                  &rep->txn_id, rep->item_index, pool));
-  SVN_ERR(aligned_seek(fs, (*file)->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(*file, NULL, offset, pool));
 
   return SVN_NO_ERROR;
 }
@@ -533,6 +523,142 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
   return svn_error_trace(err);
 }
 
+/* Sort svn_fs_fs__id_part_t elements by revision and item index.
+ * Implements svn_sort__array compare function. */
+static int
+compare_rev_items(const void *lhs,
+                  const void *rhs)
+{
+  const svn_fs_fs__id_part_t *lhs_item = lhs;
+  const svn_fs_fs__id_part_t *rhs_item = rhs;
+
+  if (lhs_item->revision != rhs_item->revision)
+    return lhs_item->revision < rhs_item->revision ? -1 : 1;
+
+  if (lhs_item->number != rhs_item->number)
+    return lhs_item->number < rhs_item->number ? -1 : 1;
+
+  return 0;
+}
+
+/* Read the COUNT noderevs ITEMS from REVISION in FS and put them into the
+ * noderev cache.  ITEMS must be sorted by item index.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+prefetch_noderevs_in_rev(svn_fs_t *fs,
+                         svn_revnum_t revision,
+                         const svn_fs_fs__id_part_t *items,
+                         int count,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_uint64_t *item_indexes = apr_palloc(scratch_pool,
+                                          count * sizeof(*item_indexes));
+  apr_off_t *offsets = apr_palloc(scratch_pool, count * sizeof(*offsets));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < count; ++i)
+    item_indexes[i] = items[i].number;
+
+  /* Resolve all offsets at once. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
+                                           scratch_pool, iterpool));
+  SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, revision,
+                                  item_indexes, count, scratch_pool));
+
+  /* Read and cache the noderevs in item index order.  After packing,
+   * that is not necessarily their order within the file. */
+  for (i = 0; i < count; ++i)
+    {
+      node_revision_t *noderev;
+      pair_cache_key_t key = { 0 };
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offsets[i],
+                                       iterpool));
+      SVN_ERR(svn_fs_fs__read_noderev(&noderev, rev_file->stream,
+                                      iterpool, iterpool));
+      SVN_ERR(fixup_node_revision(fs, noderev, iterpool));
+
+      key.revision = revision;
+      key.second = items[i].number;
+      SVN_ERR(svn_cache__set(ffd->node_revision_cache, &key, noderev,
+                             iterpool));
+    }
+
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__prefetch_node_revisions(svn_fs_t *fs,
+                                   const apr_array_header_t *entries,
+                                   apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_array_header_t *items;
+  apr_pool_t *iterpool;
+  int i, first, last;
+
+  /* Without a cache, there is no place to prefetch into. */
+  if (!ffd->node_revision_cache || entries->nelts < 2)
+    return SVN_NO_ERROR;
+
+  /* Collect all committed noderevs that are not in the cache, yet. */
+  items = apr_array_make(scratch_pool, entries->nelts,
+                         sizeof(svn_fs_fs__id_part_t));
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const svn_fs_dirent_t *dirent
+        = APR_ARRAY_IDX(entries, i, const svn_fs_dirent_t *);
+      const svn_fs_fs__id_part_t *rev_item;
+      pair_cache_key_t key = { 0 };
+      svn_boolean_t is_cached;
+
+      if (svn_fs_fs__id_is_txn(dirent->id))
+        continue;
+
+      rev_item = svn_fs_fs__id_rev_item(dirent->id);
+      key.revision = rev_item->revision;
+      key.second = rev_item->number;
+      SVN_ERR(svn_cache__has_key(&is_cached, ffd->node_revision_cache, &key,
+                                 scratch_pool));
+      if (!is_cached)
+        APR_ARRAY_PUSH(items, svn_fs_fs__id_part_t) = *rev_item;
+    }
+
+  /* Group them by revision and process each revision in one go. */
+  svn_sort__array(items, compare_rev_items);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (first = 0; first < items->nelts; first = last)
+    {
+      svn_revnum_t revision
+        = APR_ARRAY_IDX(items, first, svn_fs_fs__id_part_t).revision;
+
+      for (last = first + 1; last < items->nelts; ++last)
+        if (APR_ARRAY_IDX(items, last, svn_fs_fs__id_part_t).revision
+            != revision)
+          break;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(prefetch_noderevs_in_rev(fs, revision,
+                                       &APR_ARRAY_IDX(items, first,
+                                                      svn_fs_fs__id_part_t),
+                                       last - first, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Given a revision file REV_FILE, opened to REV in FS, find the Node-ID
    of the header located at OFFSET and store it in *ID_P.  Allocate
@@ -547,7 +673,7 @@ get_fs_id_at_offset(svn_fs_id_t **id_p,
 {
   node_revision_t *noderev;
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset, pool));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev,
                                   rev_file->stream,
                                   pool, pool));
@@ -581,7 +707,6 @@ get_root_changes_offset(apr_off_t *root_offset,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_off_t rev_offset;
-  apr_seek_where_t seek_relative;
   svn_stringbuf_t *trailer;
   char buffer[64];
   apr_off_t start;
@@ -600,12 +725,10 @@ get_root_changes_offset(apr_off_t *root_offset,
   if (rev_file->is_packed && ((rev + 1) % ffd->max_files_per_dir != 0))
     {
       SVN_ERR(svn_fs_fs__get_packed_offset(&end, fs, rev + 1, pool));
-      seek_relative = APR_SET;
     }
   else
     {
-      seek_relative = APR_END;
-      end = 0;
+      SVN_ERR(svn_fs_fs__rev_file_size(&end, rev_file, pool));
     }
 
   /* Offset of the revision from the start of the pack file, if applicable. */
@@ -616,8 +739,6 @@ get_root_changes_offset(apr_off_t *root_offset,
 
   /* We will assume that the last line containing the two offsets
      will never be longer than 64 characters. */
-  SVN_ERR(svn_io_file_seek(rev_file->file, seek_relative, &end, pool));
-
   if (end < sizeof(buffer))
     {
       len = (apr_size_t)end;
@@ -630,9 +751,8 @@ get_root_changes_offset(apr_off_t *root_offset,
     }
 
   /* Read in this last block, from which we will identify the last line. */
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
-                                 pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, start, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len, NULL, pool));
 
   /* Parse the last line. */
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
@@ -746,27 +866,24 @@ typedef struct rep_state_t
   int chunk_index;  /* number of the window to read */
 } rep_state_t;
 
-/* Simple wrapper around svn_io_file_get_offset to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
                 rep_state_t *rs,
                 apr_pool_t *pool)
 {
-  return svn_error_trace(svn_io_file_get_offset(offset,
-                                                rs->sfile->rfile->file,
-                                                pool));
+  return svn_error_trace(svn_fs_fs__rev_file_offset(offset,
+                                                    rs->sfile->rfile));
 }
 
-/* Simple wrapper around svn_io_file_aligned_seek to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_seek to simplify callers. */
 static svn_error_t *
 rs_aligned_seek(rep_state_t *rs,
                 apr_off_t *buffer_start,
                 apr_off_t offset,
                 apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(rs->sfile->rfile->file,
-                                                  ffd->block_size,
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rs->sfile->rfile,
                                                   buffer_start, offset,
                                                   pool));
 }
@@ -809,8 +926,8 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
     {
       char buf[4];
       SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf),
+                                       NULL, pool));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -826,6 +943,24 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Set *SLIDING to TRUE, if the delta representation RS uses sliding source
+   views (svndiff version 3), i.e. if its windows can't be combined with
+   the windows of its base representation one by one.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+uses_sliding_windows(svn_boolean_t *sliding,
+                     rep_state_t *rs,
+                     apr_pool_t *scratch_pool)
+{
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+  SVN_ERR(auto_read_diff_version(rs, scratch_pool));
+
+  *sliding = rs->ver == 3;
+
+  return SVN_NO_ERROR;
+}
+
 /* See create_rep_state, which wraps this and adds another error. */
 static svn_error_t *
 create_rep_state_body(rep_state_t **rep_state,
@@ -964,8 +1099,10 @@ create_rep_state_body(rep_state_t **rep_state,
   *rep_state = rs;
   *rep_header = rh;
 
-  if (rh->type == svn_fs_fs__rep_plain)
-    /* This is a plaintext, so just return the current rep_state. */
+  if (   rh->type == svn_fs_fs__rep_plain
+      || rh->type == svn_fs_fs__rep_chunked)
+    /* This is a plaintext or a chunk list, so just return the current
+       rep_state. */
     return SVN_NO_ERROR;
 
   /* skip "SVNx" diff marker */
@@ -1182,6 +1319,14 @@ struct rep_read_baton
   /* The plaintext state, if there is a plaintext. */
   rep_state_t *src_state;
 
+  /* If not NULL, the reconstructed fulltext to use as base for the last
+     delta in RS_LIST, or the fulltext itself if RS_LIST is empty.  This
+     is used for representations with sliding source views. */
+  svn_stream_t *src_stream;
+
+  /* Number of bytes already consumed from SRC_STREAM. */
+  svn_filesize_t src_stream_offset;
+
   /* The index of the current delta chunk, if we are reading a delta. */
   int chunk_index;
 
@@ -1244,6 +1389,7 @@ get_window_key(window_cache_key_t *key, rep_state_t *rs)
 
 /* Implement svn_cache__partial_getter_func_t for raw txdelta windows.
  * Parse the raw data and return a svn_fs_fs__txdelta_cached_window_t.
+ * BATON is the svn_fs_t * providing the compression dictionaries.
  */
 static svn_error_t *
 parse_raw_window(void **out,
@@ -1268,8 +1414,9 @@ parse_raw_window(void **out,
   stream = svn_stream_from_string(&raw_window, result_pool);
 
   /* parse it */
-  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream, window->ver,
-                                          result_pool));
+  SVN_ERR(svn_txdelta__read_svndiff_window_dict(
+            &result->window, stream, window->ver,
+            svn_fs_fs__get_compression_dict, baton, result_pool));
 
   /* complete the window and return it */
   result->end_offset = window->end_offset;
@@ -1320,7 +1467,8 @@ get_cached_window(svn_txdelta_window_t **window_p,
         {
           SVN_ERR(svn_cache__get_partial((void **) &cached_window, is_cached,
                                          rs->raw_window_cache, &key,
-                                         parse_raw_window, NULL, result_pool));
+                                         parse_raw_window, rs->sfile->fs,
+                                         result_pool));
           if (*is_cached)
             SVN_ERR(svn_cache__set(rs->window_cache, &key, cached_window,
                                    scratch_pool));
@@ -1422,10 +1570,33 @@ set_cached_combined_window(svn_stringbuf_t *window,
   return SVN_NO_ERROR;
 }
 
+/* Set *STREAM_P to a stream delivering the fulltext of the delta
+   representation RS in FS with header REP_HEADER, which uses sliding
+   source views.  Allocate the stream in RESULT_POOL.  Defined below. */
+static svn_error_t *
+create_sliding_stream(svn_stream_t **stream_p,
+                      rep_state_t *rs,
+                      svn_fs_fs__rep_header_t *rep_header,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool);
+
+/* Set *STREAM_P to a stream delivering the fulltext of the chunked
+   representation REP in FS, whose chunk list can be read from RS.
+   Allocate the stream in RESULT_POOL.  Defined below. */
+static svn_error_t *
+create_chunked_stream(svn_stream_t **stream_p,
+                      rep_state_t *rs,
+                      const representation_t *rep,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool);
+
 /* Build an array of rep_state structures in *LIST giving the delta
    reps from first_rep to a plain-text or self-compressed rep.  Set
    *SRC_STATE to the plain-text rep we find at the end of the chain,
    or to NULL if the final delta representation is self-compressed.
+   If the chain ends at a delta rep with sliding source views or at a
+   chunked rep instead, set *SRC_STREAM to a stream delivering that rep's
+   fulltext and *SRC_STATE to NULL.  Otherwise, set *SRC_STREAM to NULL.
    The representation to start from is designated by filesystem FS, id
    ID, and representation REP.
    Also, set *WINDOW_P to the base window content for *LIST, if it
@@ -1435,6 +1606,7 @@ static svn_error_t *
 build_rep_list(apr_array_header_t **list,
                svn_stringbuf_t **window_p,
                rep_state_t **src_state,
+               svn_stream_t **src_stream,
                svn_fs_t *fs,
                representation_t *first_rep,
                apr_pool_t *pool)
@@ -1443,10 +1615,12 @@ build_rep_list(apr_array_header_t **list,
   rep_state_t *rs = NULL;
   svn_fs_fs__rep_header_t *rep_header;
   svn_boolean_t is_cached = FALSE;
+  svn_boolean_t sliding;
   shared_file_t *shared_file = NULL;
   apr_pool_t *iterpool = svn_pool_create(pool);
 
   *list = apr_array_make(pool, 1, sizeof(rep_state_t *));
+  *src_stream = NULL;
   rep = *first_rep;
 
   /* for the top-level rep, we need the rep_args */
@@ -1484,6 +1658,26 @@ build_rep_list(apr_array_header_t **list,
           break;
         }
 
+      /* Chunked reps get reconstructed from their chunks. */
+      if (rep_header->type == svn_fs_fs__rep_chunked)
+        {
+          SVN_ERR(create_chunked_stream(src_stream, rs, &rep, fs, pool));
+          *src_state = NULL;
+          break;
+        }
+
+      /* Windows with sliding source views don't line up with the windows
+         of the reps above them.  Reconstruct this rep's fulltext by
+         other means and use it as the base for the rest of the chain. */
+      SVN_ERR(uses_sliding_windows(&sliding, rs, iterpool));
+      if (sliding)
+        {
+          SVN_ERR(create_sliding_stream(src_stream, rs, rep_header, fs,
+                                        pool));
+          *src_state = NULL;
+          break;
+        }
+
       /* Push this rep onto the list.  If it's self-compressed, we're done. */
       APR_ARRAY_PUSH(*list, rep_state_t *) = rs;
       if (rep_header->type == svn_fs_fs__rep_self_delta)
@@ -1541,17 +1735,20 @@ rep_read_get_baton(struct rep_read_baton **rb_p,
   return SVN_NO_ERROR;
 }
 
-/* Skip forwards to THIS_CHUNK in REP_STATE and then read the next delta
-   window into *NWIN.  Note that RS->CHUNK_INDEX will be THIS_CHUNK rather
-   than THIS_CHUNK + 1 when this function returns. */
+/* Skip forwards to THIS_CHUNK in REP_STATE.  If the delta window can be
+   found in the cache, return it in *NWIN and set *IS_CACHED.  Otherwise,
+   position the rev file of RS at the start of that window and leave *NWIN
+   untouched.  Note that RS->CHUNK_INDEX will be THIS_CHUNK when this
+   function returns. */
 static svn_error_t *
-read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
-                  rep_state_t *rs, apr_pool_t *result_pool,
-                  apr_pool_t *scratch_pool)
+locate_delta_window(svn_txdelta_window_t **nwin,
+                    svn_boolean_t *is_cached,
+                    int this_chunk,
+                    rep_state_t *rs,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
 {
-  svn_boolean_t is_cached;
   apr_off_t start_offset;
-  apr_off_t end_offset;
   apr_pool_t *iterpool;
 
   SVN_ERR_ASSERT(rs->chunk_index <= this_chunk);
@@ -1560,9 +1757,9 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
                          NULL, SVN_FS_FS__ITEM_TYPE_ANY_REP, scratch_pool));
 
   /* Read the next window.  But first, try to find it in the cache. */
-  SVN_ERR(get_cached_window(nwin, rs, this_chunk, &is_cached,
+  SVN_ERR(get_cached_window(nwin, rs, this_chunk, is_cached,
                             result_pool, scratch_pool));
-  if (is_cached)
+  if (*is_cached)
     return SVN_NO_ERROR;
 
   /* someone has to actually read the data from file.  Open it */
@@ -1581,9 +1778,9 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
 
       /* reading the whole block probably also provided us with the
          desired txdelta window */
-      SVN_ERR(get_cached_window(nwin, rs, this_chunk, &is_cached,
+      SVN_ERR(get_cached_window(nwin, rs, this_chunk, is_cached,
                                 result_pool, scratch_pool));
-      if (is_cached)
+      if (*is_cached)
         return SVN_NO_ERROR;
     }
 
@@ -1602,8 +1799,22 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   while (rs->chunk_index < this_chunk)
     {
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
-                                              rs->ver, iterpool));
+      if (rs->sfile->rfile->data)
+        {
+          /* There is no APR file pointer to advance in mapped mode. */
+          apr_size_t window_len;
+          SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                                   rs->sfile->rfile->stream,
+                                                   iterpool));
+          start_offset += window_len;
+          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
+        }
+      else
+        {
+          SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
+                                                  rs->ver, iterpool));
+        }
+
       rs->chunk_index++;
       SVN_ERR(get_file_offset(&start_offset, rs, iterpool));
       rs->current = start_offset - rs->start;
@@ -1613,22 +1824,385 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
                                   "beyond the end of the "
                                   "representation"));
     }
-  svn_pool_destroy(iterpool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Skip forwards to THIS_CHUNK in REP_STATE and then read the next delta
+   window into *NWIN.  Note that RS->CHUNK_INDEX will be THIS_CHUNK rather
+   than THIS_CHUNK + 1 when this function returns. */
+static svn_error_t *
+read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
+                  rep_state_t *rs, apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  svn_boolean_t is_cached;
+  apr_off_t end_offset;
+
+  SVN_ERR(locate_delta_window(nwin, &is_cached, this_chunk, rs,
+                              result_pool, scratch_pool));
+  if (is_cached)
+    return SVN_NO_ERROR;
+
+  /* Actually read the next window. */
+  SVN_ERR(svn_txdelta__read_svndiff_window_dict(
+            nwin, rs->sfile->rfile->stream, rs->ver,
+            svn_fs_fs__get_compression_dict, rs->sfile->fs, result_pool));
+  SVN_ERR(get_file_offset(&end_offset, rs, scratch_pool));
+  rs->current = end_offset - rs->start;
+  if (rs->current > rs->size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Reading one svndiff window read beyond "
+                              "the end of the representation"));
+
+  /* the window has not been cached before, thus cache it now
+   * (if caching is used for them at all) */
+  if (SVN_IS_VALID_REVNUM(rs->revision))
+    SVN_ERR(set_cached_window(*nwin, rs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Below this total size of raw delta windows to parse for a chunk,
+   handing them to worker threads costs more than it saves.  Handing over
+   takes a few microseconds per window while inflating 32kB of zlib data
+   takes a few hundred. */
+#define DELTA_READ_PARALLEL_MIN (32 * 1024)
+
+/* A raw delta window to be parsed by parse_delta_window_task. */
+typedef struct parse_window_item_t
+{
+  /* Unparsed window as read from the rev / pack file. */
+  svn_string_t *raw_window;
+
+  /* svndiff version of RAW_WINDOW. */
+  int version;
+
+  /* The compression dictionary required by RAW_WINDOW, NULL if it does
+     not need one.  It has been looked up by the calling thread because
+     doing so may update the FS' state. */
+  const svn__zstd_dict_t *dict;
+
+  /* The window as parsed by the worker, allocated in its result pool. */
+  svn_txdelta_window_t *parsed;
+
+  /* Where to store the parsed window and the pool to allocate it in. */
+  svn_txdelta_window_t **window;
+  apr_pool_t *result_pool;
+} parse_window_item_t;
+
+/* Implements svn_txdelta__dict_func_t.  BATON is the svn__zstd_dict_t
+   that has been looked up for the window being parsed. */
+static svn_error_t *
+resolved_dict_func(const svn__zstd_dict_t **dict,
+                   void *baton,
+                   apr_uint32_t dict_id,
+                   apr_pool_t *scratch_pool)
+{
+  const svn__zstd_dict_t *resolved = baton;
+
+  if (resolved == NULL || svn__zstd_dict_id(resolved) != dict_id)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Invalid compression dictionary ID %u"),
+                             (unsigned int)dict_id);
+
+  *dict = resolved;
+  return SVN_NO_ERROR;
+}
+
+/* Set *DICT to the compression dictionary required by the unparsed
+   svndiff version VERSION window RAW_WINDOW in FS, or to NULL if it does
+   not need one.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_raw_window_dict(const svn__zstd_dict_t **dict,
+                    svn_fs_t *fs,
+                    const svn_string_t *raw_window,
+                    int version,
+                    apr_pool_t *scratch_pool)
+{
+  apr_uint32_t ins_dict_id, new_dict_id;
+
+  SVN_ERR(svn_txdelta__svndiff_window_dict_ids(&ins_dict_id, &new_dict_id,
+                                               raw_window, version,
+                                               scratch_pool));
+
+  /* Both sections of a window get compressed against the same
+     dictionary, if any. */
+  if (ins_dict_id && new_dict_id && ins_dict_id != new_dict_id)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Delta window uses more than one "
+                              "compression dictionary"));
+
+  *dict = NULL;
+  if (ins_dict_id || new_dict_id)
+    SVN_ERR(svn_fs_fs__get_compression_dict(dict, fs,
+                                            MAX(ins_dict_id, new_dict_id),
+                                            scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Parse the raw window of the
+   parse_window_item_t *BATON into its PARSED member and return the item
+   in *RESULT.  No shared state is accessed, not even the FS, so this may
+   run in any thread. */
+static svn_error_t *
+parse_delta_window_task(void **result,
+                        void *baton,
+                        void *thread_context,
+                        apr_int64_t index,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  parse_window_item_t *item = baton;
+  svn_stream_t *stream = svn_stream_from_string(item->raw_window,
+                                                scratch_pool);
+
+  SVN_ERR(svn_txdelta__read_svndiff_window_dict(&item->parsed, stream,
+                                                item->version,
+                                                resolved_dict_func,
+                                                (void *)item->dict,
+                                                result_pool));
+
+  *result = item;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Copy the window parsed for the
+   parse_window_item_t *RESULT to where the item wants it. */
+static svn_error_t *
+collect_delta_window_task(void *baton,
+                          void *result,
+                          apr_int64_t index,
+                          apr_pool_t *scratch_pool)
+{
+  parse_window_item_t *item = result;
+  *item->window = svn_txdelta_window_dup(item->parsed, item->result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *QUEUE to the worker threads parsing delta windows for FS, starting
+   them if necessary. */
+static svn_error_t *
+get_delta_read_queue(svn_task__queue_t **queue,
+                     svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->delta_read_queue == NULL)
+    {
+      apr_pool_t *pool = svn_pool_create(fs->pool);
+      svn_error_t *err = svn_task__queue_create(&ffd->delta_read_queue,
+                                                ffd->delta_read_threads,
+                                                parse_delta_window_task,
+                                                NULL, NULL,
+                                                collect_delta_window_task,
+                                                NULL, NULL, NULL, pool);
+      if (err)
+        {
+          ffd->delta_read_queue = NULL;
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+
+      ffd->delta_read_pool = pool;
+    }
+
+  *queue = ffd->delta_read_queue;
+  return SVN_NO_ERROR;
+}
+
+/* Parse the COUNT raw windows in ITEMS.  Unless that would not pay off,
+   let the worker threads of FS do it.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+parse_delta_windows(parse_window_item_t *items,
+                    int count,
+                    svn_fs_t *fs,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_task__queue_t *queue;
+  apr_size_t total_len = 0;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  for (i = 0; i < count; ++i)
+    total_len += items[i].raw_window->len;
+
+  if (count < 2 || total_len < DELTA_READ_PARALLEL_MIN)
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      for (i = 0; i < count; ++i)
+        {
+          void *result;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(parse_delta_window_task(&result, &items[i], NULL, i,
+                                          items[i].result_pool, iterpool));
+          *items[i].window = items[i].parsed;
+        }
+      svn_pool_destroy(iterpool);
+
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(get_delta_read_queue(&queue, fs));
+  for (i = 0; i < count && !err; ++i)
+    err = svn_task__queue_push(queue, &items[i], scratch_pool);
+  if (!err)
+    err = svn_task__queue_wait(queue, scratch_pool);
+
+  /* The queue is unusable after a failure.  Start over next time. */
+  if (err)
+    {
+      ffd->delta_read_queue = NULL;
+      svn_pool_destroy(ffd->delta_read_pool);
+      ffd->delta_read_pool = NULL;
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Like calling read_delta_window for the elements of RB->RS_LIST for the
+   current chunk, append the respective windows to WINDOWS and return the
+   number of windows that need to be combined in *COUNT.
+
+   Reading the raw window data happens in the calling thread but parsing
+   and decompressing them may be done by the worker threads of RB->FS.
+   Like the serial reading in get_combined_window, we stop at the first
+   window that does not depend on its predecessors.  Before parsing them,
+   we can only tell that for windows without a source view, though.  So,
+   this may fetch windows of deeper chain links that turn out not to be
+   needed.  The respective rep states will be advanced past them.
+
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_delta_windows_parallel(apr_array_header_t *windows,
+                            int *count,
+                            struct rep_read_baton *rb,
+                            apr_pool_t *scratch_pool)
+{
+  int i;
+  int nelts = rb->rs_list->nelts;
+  parse_window_item_t *items;
+  int item_count = 0;
+  svn_boolean_t *is_raw;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  items = apr_pcalloc(scratch_pool, nelts * sizeof(*items));
+  is_raw = apr_pcalloc(scratch_pool, nelts * sizeof(*is_raw));
+
+  /* Fetch the raw windows, unless already cached. */
+  for (i = 0; i < nelts; ++i)
+    {
+      rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+      svn_txdelta_window_t *window = NULL;
+      svn_boolean_t is_cached;
+      apr_off_t start_offset;
+      apr_size_t window_len;
+      apr_size_t sview_len;
+      svn_string_t *raw_window;
+      parse_window_item_t *item;
+
+      svn_pool_clear(iterpool);
+
+      /* Deeper links may have fewer windows, e.g. when the file grew.
+         If we got here, the previous window has a source view but may
+         still not use it.  Whether that was legitimate will be checked
+         after parsing it. */
+      if (   i > 0 && rs->chunk_index == rb->chunk_index
+          && rs->current >= rs->size)
+        break;
+
+      SVN_ERR(locate_delta_window(&window, &is_cached, rb->chunk_index, rs,
+                                  windows->pool, iterpool));
+      APR_ARRAY_PUSH(windows, svn_txdelta_window_t *) = window;
+      if (is_cached)
+        {
+          if (window->src_ops == 0)
+            break;
+
+          continue;
+        }
+
+      /* Read the raw window data only. */
+      start_offset = rs->start + rs->current;
+      SVN_ERR(svn_txdelta__read_raw_window_header(&window_len, &sview_len,
+                                                  rs->sfile->rfile->stream,
+                                                  iterpool));
+      if (window_len > rs->size - rs->current)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Reading one svndiff window read beyond "
+                                  "the end of the representation"));
+
+      /* For mapped files, this points directly into the mapping, which
+         stays valid until all windows have been parsed. */
+      raw_window = apr_palloc(scratch_pool, sizeof(*raw_window));
+      raw_window->len = window_len;
+      SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_get_data(&raw_window->data,
+                                           rs->sfile->rfile, window_len,
+                                           scratch_pool));
+
+      rs->current += window_len;
+      is_raw[i] = TRUE;
+
+      item = &items[item_count++];
+      item->raw_window = raw_window;
+      item->version = rs->ver;
+      item->result_pool = windows->pool;
+      SVN_ERR(get_raw_window_dict(&item->dict, rb->fs, raw_window, rs->ver,
+                                  iterpool));
+
+      /* Without a source view, there can't be any source copies. */
+      if (sview_len == 0)
+        break;
+    }
+
+  /* Parse them, concurrently if worth it.  WINDOWS won't grow anymore,
+     so its elements stay where they are. */
+  for (i = 0, item_count = 0; i < windows->nelts; ++i)
+    if (is_raw[i])
+      items[item_count++].window
+        = &APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *);
+
+  SVN_ERR(parse_delta_windows(items, item_count, rb->fs, scratch_pool));
+
+  /* Cache the new windows and find the first one that does not depend on
+     its predecessors. */
+  *count = windows->nelts;
+  for (i = 0; i < windows->nelts; ++i)
+    {
+      rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+      svn_txdelta_window_t *window
+        = APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *);
+
+      svn_pool_clear(iterpool);
+
+      if (is_raw[i] && SVN_IS_VALID_REVNUM(rs->revision))
+        SVN_ERR(set_cached_window(window, rs, iterpool));
+
+      /* Windows beyond the ones to combine won't be touched by our caller.
+         Put their rep states behind the window we just read. */
+      if (i >= *count)
+        rs->chunk_index++;
+      else if (window->src_ops == 0)
+        *count = i + 1;
+    }
 
-  /* Actually read the next window. */
-  SVN_ERR(svn_txdelta_read_svndiff_window(nwin, rs->sfile->rfile->stream,
-                                          rs->ver, result_pool));
-  SVN_ERR(get_file_offset(&end_offset, rs, scratch_pool));
-  rs->current = end_offset - rs->start;
-  if (rs->current > rs->size)
+  /* If we ran out of windows in a deeper link, the last window that we
+     found must not need it. */
+  if (*count == windows->nelts && *count < nelts
+      && APR_ARRAY_IDX(windows, *count - 1, svn_txdelta_window_t *)->src_ops)
     return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Reading one svndiff window read beyond "
-                              "the end of the representation"));
+                            _("Delta window refers to a base "
+                              "representation window that does not "
+                              "exist"));
 
-  /* the window has not been cached before, thus cache it now
-   * (if caching is used for them at all) */
-  if (SVN_IS_VALID_REVNUM(rs->revision))
-    SVN_ERR(set_cached_window(*nwin, rs, scratch_pool));
+  svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
 }
@@ -1651,8 +2225,8 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size,
+                                   NULL, result_pool));
   (*nwin)->data[size] = 0;
 
   /* Update RS. */
@@ -1672,6 +2246,47 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+/* Read SIZE bytes starting at OFFSET from the reconstructed base fulltext
+   in RB into *NWIN, allocated in RESULT_POOL.  Since that stream can't be
+   rewound, OFFSET must not be before the data already consumed. */
+static svn_error_t *
+read_stream_window(svn_stringbuf_t **nwin,
+                   struct rep_read_baton *rb,
+                   svn_filesize_t offset,
+                   apr_size_t size,
+                   apr_pool_t *result_pool)
+{
+  apr_size_t len = size;
+
+  if (offset < rb->src_stream_offset)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("svndiff source view offset is corrupt"));
+
+  /* Windows whose source data was not needed may have been skipped. */
+  while (rb->src_stream_offset < offset)
+    {
+      apr_size_t to_skip = offset - rb->src_stream_offset > APR_SIZE_MAX
+                         ? APR_SIZE_MAX
+                         : (apr_size_t)(offset - rb->src_stream_offset);
+
+      SVN_ERR(svn_stream_skip(rb->src_stream, to_skip));
+      rb->src_stream_offset += to_skip;
+    }
+
+  *nwin = svn_stringbuf_create_ensure(size, result_pool);
+  SVN_ERR(svn_stream_read_full(rb->src_stream, (*nwin)->data, &len));
+  rb->src_stream_offset += len;
+  if (len != size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Delta base representation ended "
+                              "unexpectedly"));
+
+  (*nwin)->len = size;
+  (*nwin)->data[size] = 0;
+
+  return SVN_NO_ERROR;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1685,6 +2300,8 @@ get_combined_window(svn_stringbuf_t **result,
   svn_stringbuf_t *source, *buf = rb->base_window;
   rep_state_t *rs;
   apr_pool_t *iterpool;
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  svn_error_t *err;
 
   /* Read all windows that we need to combine. This is fine because
      the size of each window is relatively small (100kB) and skip-
@@ -1693,21 +2310,28 @@ get_combined_window(svn_stringbuf_t **result,
   window_pool = svn_pool_create(rb->pool);
   windows = apr_array_make(window_pool, 0, sizeof(svn_txdelta_window_t *));
   iterpool = svn_pool_create(rb->pool);
-  for (i = 0; i < rb->rs_list->nelts; ++i)
+  if (ffd->delta_read_threads > 1 && rb->rs_list->nelts > 1)
     {
-      svn_txdelta_window_t *window;
+      SVN_ERR(read_delta_windows_parallel(windows, &i, rb, iterpool));
+    }
+  else
+    {
+      for (i = 0; i < rb->rs_list->nelts; ++i)
+        {
+          svn_txdelta_window_t *window;
 
-      svn_pool_clear(iterpool);
+          svn_pool_clear(iterpool);
 
-      rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
-      SVN_ERR(read_delta_window(&window, rb->chunk_index, rs, window_pool,
-                                iterpool));
+          rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+          SVN_ERR(read_delta_window(&window, rb->chunk_index, rs, window_pool,
+                                    iterpool));
 
-      APR_ARRAY_PUSH(windows, svn_txdelta_window_t *) = window;
-      if (window->src_ops == 0)
-        {
-          ++i;
-          break;
+          APR_ARRAY_PUSH(windows, svn_txdelta_window_t *) = window;
+          if (window->src_ops == 0)
+            {
+              ++i;
+              break;
+            }
         }
     }
 
@@ -1741,18 +2365,30 @@ get_combined_window(svn_stringbuf_t **result,
           else
             SVN_ERR(skip_plain_window(rb->src_state, window->sview_len));
         }
+      else if (source == NULL && rb->src_stream != NULL && window->src_ops)
+        {
+          /* Same as above but for a reconstructed base fulltext.  Here,
+           * we position explicitly and skip lazily. */
+          SVN_ERR(read_stream_window(&source, rb, window->sview_offset,
+                                     window->sview_len, pool));
+        }
 
       /* Combine this window with the current one. */
       new_pool = svn_pool_create(rb->pool);
-      buf = svn_stringbuf_create_ensure(window->tview_len, new_pool);
-      buf->len = window->tview_len;
+      buf = svn_stringbuf_create_ensure(window->tview_len
+                                        + SVN_TXDELTA__APPLY_PADDING,
+                                        new_pool);
+
+      err = svn_txdelta__apply_window(window,
+                                      source ? source->data : NULL,
+                                      source ? source->len : 0,
+                                      buf->data, buf->blocksize);
+      if (err)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, err,
+                                _("svndiff window is corrupt"));
 
-      svn_txdelta_apply_instructions(window, source ? source->data : NULL,
-                                     buf->data, &buf->len);
-      if (buf->len != window->tview_len)
-        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
-                                _("svndiff window length is "
-                                  "corrupt"));
+      buf->len = window->tview_len;
+      buf->data[buf->len] = '\0';
 
       /* Cache windows only if the whole rep content could be read as a
          single chunk.  Only then will no other chunk need a deeper RS
@@ -1809,6 +2445,11 @@ get_contents_from_windows(struct rep_read_baton *rb,
   char *cur = buf;
   rep_state_t *rs;
 
+  /* Special case for when there are no delta reps, only a reconstructed
+     fulltext. */
+  if (rb->rs_list->nelts == 0 && rb->src_stream)
+    return svn_error_trace(svn_stream_read_full(rb->src_stream, buf, len));
+
   /* Special case for when there are no delta reps, only a plain
      text. */
   if (rb->rs_list->nelts == 0)
@@ -1840,8 +2481,8 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
           offset = rs->start + rs->current;
           SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len,
+                                           NULL, rb->pool));
         }
 
       rs->current += copy_len;
@@ -1896,6 +2537,384 @@ get_contents_from_windows(struct rep_read_baton *rb,
   return SVN_NO_ERROR;
 }
 
+/* Read function used on streams returned by read_raw_representation().
+ */
+static svn_error_t *
+rep_read_raw_contents(void *baton,
+                      char *buf,
+                      apr_size_t *len)
+{
+  struct rep_read_baton *rb = baton;
+
+  return svn_error_trace(get_contents_from_windows(rb, buf, len));
+}
+
+/* Set *CONTENTS_P to a stream delivering the fulltext of REP in FS.
+   Unlike read_representation(), neither use the fulltext cache nor
+   verify the checksum.  This is used to provide the base fulltext of
+   representations with sliding source views.  Allocate the stream in
+   RESULT_POOL. */
+static svn_error_t *
+read_raw_representation(svn_stream_t **contents_p,
+                        svn_fs_t *fs,
+                        representation_t *rep,
+                        apr_pool_t *result_pool)
+{
+  struct rep_read_baton *rb;
+  pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM, 0 };
+
+  SVN_ERR(rep_read_get_baton(&rb, fs, rep, fulltext_cache_key,
+                             result_pool));
+  SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
+                         &rb->src_state, &rb->src_stream, rb->fs,
+                         &rb->rep, rb->filehandle_pool));
+
+  *contents_p = svn_stream_create(rb, result_pool);
+  svn_stream_set_read2(*contents_p, NULL /* only full read support */,
+                       rep_read_raw_contents);
+  svn_stream_set_close(*contents_p, rep_read_contents_close);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for streams returned by create_sliding_stream(). */
+typedef struct sliding_read_baton_t
+{
+  /* The delta representation to read the windows from. */
+  rep_state_t *rs;
+
+  /* Applies the windows to the base fulltext and writes the result into
+     BUFFER.  NULL, after the final window has been sent. */
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  /* Reconstructed fulltext not yet delivered starts at BUFFER_POS. */
+  svn_stringbuf_t *buffer;
+  apr_size_t buffer_pos;
+
+  /* Cleared for every new window. */
+  apr_pool_t *window_pool;
+} sliding_read_baton_t;
+
+/* Implement svn_read_fn_t for streams returned by create_sliding_stream().
+ */
+static svn_error_t *
+sliding_read(void *baton,
+             char *buf,
+             apr_size_t *len)
+{
+  sliding_read_baton_t *sb = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t copy_len = sb->buffer->len - sb->buffer_pos;
+      svn_txdelta_window_t *window = NULL;
+
+      if (copy_len)
+        {
+          if (copy_len > remaining)
+            copy_len = remaining;
+
+          memcpy(buf, sb->buffer->data + sb->buffer_pos, copy_len);
+          sb->buffer_pos += copy_len;
+          buf += copy_len;
+          remaining -= copy_len;
+          continue;
+        }
+
+      /* All data has been delivered? */
+      if (sb->handler == NULL)
+        break;
+
+      /* Reconstruct the next chunk of fulltext. */
+      svn_stringbuf_setempty(sb->buffer);
+      sb->buffer_pos = 0;
+      svn_pool_clear(sb->window_pool);
+
+      if (sb->rs->current < sb->rs->size)
+        {
+          SVN_ERR(read_delta_window(&window, sb->rs->chunk_index, sb->rs,
+                                    sb->window_pool, sb->window_pool));
+          sb->rs->chunk_index++;
+        }
+
+      SVN_ERR(sb->handler(window, sb->handler_baton));
+      if (window == NULL)
+        sb->handler = NULL;
+    }
+
+  *len -= remaining;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+create_sliding_stream(svn_stream_t **stream_p,
+                      rep_state_t *rs,
+                      svn_fs_fs__rep_header_t *rep_header,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool)
+{
+  sliding_read_baton_t *sb = apr_pcalloc(result_pool, sizeof(*sb));
+  svn_stream_t *base;
+
+  if (rep_header->type == svn_fs_fs__rep_self_delta)
+    {
+      base = svn_stream_empty(result_pool);
+    }
+  else
+    {
+      representation_t base_rep = { 0 };
+
+      base_rep.revision = rep_header->base_revision;
+      base_rep.item_index = rep_header->base_item_index;
+      base_rep.size = rep_header->base_length;
+      svn_fs_fs__id_txn_reset(&base_rep.txn_id);
+
+      SVN_ERR(read_raw_representation(&base, fs, &base_rep, result_pool));
+    }
+
+  sb->rs = rs;
+  sb->buffer = svn_stringbuf_create_empty(result_pool);
+  sb->window_pool = svn_pool_create(result_pool);
+  svn_txdelta_apply(base, svn_stream_from_stringbuf(sb->buffer, result_pool),
+                    NULL, NULL, result_pool,
+                    &sb->handler, &sb->handler_baton);
+
+  *stream_p = svn_stream_create(sb, result_pool);
+  svn_stream_set_read2(*stream_p, NULL /* only full read support */,
+                       sliding_read);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the chunk list of the chunked representation REP from RS and
+   return it in *CHUNKS as an array of representation_t *.  Chunks that
+   are stored in the same revision or transaction as REP will refer to
+   those.  Allocate the result in RESULT_POOL and use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+read_chunk_list(apr_array_header_t **chunks,
+                rep_state_t *rs,
+                const representation_t *rep,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *text;
+  int i;
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+
+  text = svn_stringbuf_create_ensure((apr_size_t)rs->size, scratch_pool);
+  SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, text->data,
+                                   (apr_size_t)rs->size, NULL,
+                                   scratch_pool));
+  text->len = (apr_size_t)rs->size;
+  text->data[text->len] = '\0';
+
+  SVN_ERR(svn_fs_fs__parse_chunk_list(chunks,
+                                      svn_stringbuf__morph_into_string(text),
+                                      result_pool, scratch_pool));
+
+  for (i = 0; i < (*chunks)->nelts; ++i)
+    {
+      representation_t *chunk = APR_ARRAY_IDX(*chunks, i,
+                                              representation_t *);
+      if (SVN_IS_VALID_REVNUM(chunk->revision))
+        {
+          svn_fs_fs__id_txn_reset(&chunk->txn_id);
+        }
+      else
+        {
+          chunk->revision = rep->revision;
+          chunk->txn_id = rep->txn_id;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for streams returned by create_chunked_stream(). */
+typedef struct chunked_read_baton_t
+{
+  /* The FS containing the chunks. */
+  svn_fs_t *fs;
+
+  /* All chunks of the representation as representation_t *. */
+  apr_array_header_t *chunks;
+
+  /* Index of the next chunk in CHUNKS to read. */
+  int next_chunk;
+
+  /* Contents of the current chunk, NULL between chunks. */
+  svn_stream_t *current;
+
+  /* Number of bytes not yet delivered from CURRENT. */
+  svn_filesize_t remaining;
+
+  /* Contains CURRENT.  Cleared for every new chunk. */
+  apr_pool_t *chunk_pool;
+} chunked_read_baton_t;
+
+/* Make the next chunk in CB the current one. */
+static svn_error_t *
+open_next_chunk(chunked_read_baton_t *cb)
+{
+  representation_t *chunk = APR_ARRAY_IDX(cb->chunks, cb->next_chunk,
+                                          representation_t *);
+
+  svn_pool_clear(cb->chunk_pool);
+  SVN_ERR(read_raw_representation(&cb->current, cb->fs, chunk,
+                                  cb->chunk_pool));
+  cb->remaining = chunk->expanded_size;
+  cb->next_chunk++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_read_fn_t for streams returned by create_chunked_stream().
+ */
+static svn_error_t *
+chunked_read(void *baton,
+             char *buf,
+             apr_size_t *len)
+{
+  chunked_read_baton_t *cb = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t to_read, read;
+
+      if (cb->current == NULL)
+        {
+          /* All data has been delivered? */
+          if (cb->next_chunk == cb->chunks->nelts)
+            break;
+
+          SVN_ERR(open_next_chunk(cb));
+        }
+
+      to_read = (apr_size_t)MIN(cb->remaining, remaining);
+      read = to_read;
+      SVN_ERR(svn_stream_read_full(cb->current, buf, &read));
+      if (read != to_read)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Chunk representation ended "
+                                  "unexpectedly"));
+
+      buf += read;
+      remaining -= read;
+      cb->remaining -= read;
+
+      if (cb->remaining == 0)
+        {
+          SVN_ERR(svn_stream_close(cb->current));
+          cb->current = NULL;
+        }
+    }
+
+  *len -= remaining;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_stream_skip_fn_t for streams returned by
+   create_chunked_stream().  Skip whole chunks without reading them. */
+static svn_error_t *
+chunked_skip(void *baton,
+             apr_size_t len)
+{
+  chunked_read_baton_t *cb = baton;
+
+  while (len > 0)
+    {
+      apr_size_t to_skip;
+
+      if (cb->current == NULL)
+        {
+          representation_t *chunk;
+
+          if (cb->next_chunk == cb->chunks->nelts)
+            break;
+
+          chunk = APR_ARRAY_IDX(cb->chunks, cb->next_chunk,
+                                representation_t *);
+          if (chunk->expanded_size <= len)
+            {
+              len -= (apr_size_t)chunk->expanded_size;
+              cb->next_chunk++;
+              continue;
+            }
+
+          SVN_ERR(open_next_chunk(cb));
+        }
+
+      to_skip = (apr_size_t)MIN(cb->remaining, len);
+      SVN_ERR(svn_stream_skip(cb->current, to_skip));
+      len -= to_skip;
+      cb->remaining -= to_skip;
+
+      if (cb->remaining == 0)
+        {
+          SVN_ERR(svn_stream_close(cb->current));
+          cb->current = NULL;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+create_chunked_stream(svn_stream_t **stream_p,
+                      rep_state_t *rs,
+                      const representation_t *rep,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool)
+{
+  chunked_read_baton_t *cb = apr_pcalloc(result_pool, sizeof(*cb));
+  apr_pool_t *scratch_pool = svn_pool_create(result_pool);
+
+  SVN_ERR(read_chunk_list(&cb->chunks, rs, rep, result_pool, scratch_pool));
+  svn_pool_destroy(scratch_pool);
+
+  cb->fs = fs;
+  cb->chunk_pool = svn_pool_create(result_pool);
+
+  *stream_p = svn_stream_create(cb, result_pool);
+  svn_stream_set_read2(*stream_p, NULL /* only full read support */,
+                       chunked_read);
+  svn_stream_set_skip(*stream_p, chunked_skip);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__get_chunk_list(apr_array_header_t **chunks,
+                          svn_fs_t *fs,
+                          representation_t *rep,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rep_header;
+
+  SVN_ERR(create_rep_state(&rs, &rep_header, NULL, rep, fs, scratch_pool,
+                           scratch_pool));
+  if (rep_header->type == svn_fs_fs__rep_chunked)
+    SVN_ERR(read_chunk_list(chunks, rs, rep, result_pool, scratch_pool));
+  else
+    *chunks = NULL;
+
+  if (rs->sfile->rfile)
+    SVN_ERR(svn_fs_fs__close_revision_file(rs->sfile->rfile));
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton type for get_fulltext_partial. */
 typedef struct fulltext_baton_t
 {
@@ -2131,8 +3150,8 @@ rep_read_contents(void *baton,
       /* Window stream not initialized, yet.  Do it now. */
       rb->len = rb->rep.expanded_size;
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &rb->rep,
-                             rb->filehandle_pool));
+                             &rb->src_state, &rb->src_stream, rb->fs,
+                             &rb->rep, rb->filehandle_pool));
 
       /* In case we did read from the fulltext cache before, make the
        * window stream catch up.  Also, initialize the fulltext buffer
@@ -2267,6 +3286,7 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   apr_off_t offset,
                                   apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_read_baton *rb;
   pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM, 0 };
   rep_state_t *rs = apr_pcalloc(pool, sizeof(*rs));
@@ -2294,9 +3314,11 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   rs->sfile->rfile->start_revision = SVN_INVALID_REVNUM;
   rs->sfile->rfile->file = file;
   rs->sfile->rfile->stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  rs->sfile->rfile->block_size = ffd->block_size;
+  rs->sfile->rfile->pool = pool;
 
   /* Read the rep header. */
-  SVN_ERR(aligned_seek(fs, file, NULL, offset, pool));
+  SVN_ERR(rs_aligned_seek(rs, NULL, offset, pool));
   SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                      pool, pool));
   SVN_ERR(get_file_offset(&rs->start, rs, pool));
@@ -2306,12 +3328,30 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   SVN_ERR(dbg_log_access(fs, SVN_INVALID_REVNUM, 0, rh,
                          SVN_FS_FS__ITEM_TYPE_ANY_REP, pool));
 
+  /* Read the "SVNx" diff marker. */
+  if (   rh->type != svn_fs_fs__rep_plain
+      && rh->type != svn_fs_fs__rep_chunked)
+    SVN_ERR(auto_read_diff_version(rs, pool));
+
   /* Build the representation list (delta chain). */
   if (rh->type == svn_fs_fs__rep_plain)
     {
       rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
       rb->src_state = rs;
     }
+  else if (rh->type == svn_fs_fs__rep_chunked)
+    {
+      rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+      rb->src_state = NULL;
+      SVN_ERR(create_chunked_stream(&rb->src_stream, rs, rep, fs, pool));
+    }
+  else if (rs->ver == 3)
+    {
+      /* Sliding source views.  Apply the delta to the base fulltext. */
+      rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+      rb->src_state = NULL;
+      SVN_ERR(create_sliding_stream(&rb->src_stream, rs, rh, fs, pool));
+    }
   else if (rh->type == svn_fs_fs__rep_self_delta)
     {
       rb->rs_list = apr_array_make(pool, 1, sizeof(rep_state_t *));
@@ -2322,9 +3362,6 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
     {
       representation_t next_rep = { 0 };
 
-      /* skip "SVNx" diff marker */
-      rs->current = 4;
-
       /* REP's base rep is inside a proper revision.
        * It can be reconstructed in the usual way.  */
       next_rep.revision = rh->base_revision;
@@ -2333,8 +3370,8 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       svn_fs_fs__id_txn_reset(&next_rep.txn_id);
 
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &next_rep,
-                             rb->filehandle_pool));
+                             &rb->src_state, &rb->src_stream, rb->fs,
+                             &next_rep, rb->filehandle_pool));
 
       /* Insert the access to REP as the first element of the delta chain. */
       SVN_ERR(svn_sort__array_insert2(rb->rs_list, &rs, 0));
@@ -2482,6 +3519,7 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   svn_stream_t *source_stream, *target_stream;
   rep_state_t *rep_state;
   svn_fs_fs__rep_header_t *rep_header;
+  svn_boolean_t sliding = FALSE;
   fs_fs_data_t *ffd = fs->fsap_data;
 
   /* Try a shortcut: if the target is stored as a delta against the source,
@@ -2493,7 +3531,17 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
       SVN_ERR(create_rep_state(&rep_state, &rep_header, NULL,
                                 target->data_rep, fs, pool, pool));
 
-      if (source && source->data_rep && target->data_rep)
+      /* Windows with sliding source views exceed the limits of older
+         svndiff consumers.  Never hand them out as they are. */
+      if (   rep_header->type != svn_fs_fs__rep_plain
+          && rep_header->type != svn_fs_fs__rep_chunked)
+        SVN_ERR(uses_sliding_windows(&sliding, rep_state, pool));
+
+      if (sliding)
+        {
+          /* Fall through to the generic code below. */
+        }
+      else if (source && source->data_rep && target->data_rep)
         {
           /* If that matches source, then use this delta as is.
              Note that we want an actual delta here.  E.g. a self-delta would
@@ -3142,9 +4190,10 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
             }
 
           /* Actual reading and parsing are the same, though. */
-          SVN_ERR(aligned_seek(context->fs, context->revision_file->file,
-                               NULL, changes_offset + context->next_offset,
-                               scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(context->revision_file, NULL,
+                                           changes_offset
+                                             + context->next_offset,
+                                           scratch_pool));
 
           SVN_ERR(svn_fs_fs__read_changes(changes,
                                           context->revision_file->stream,
@@ -3153,9 +4202,8 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
           /* Construct the info object for the entries block we just read. */
           changes_list = apr_pcalloc(scratch_pool, sizeof(*changes_list));
-          SVN_ERR(svn_io_file_get_offset(&changes_list->end_offset,
-                                         context->revision_file->file,
-                                         scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_offset(&changes_list->end_offset,
+                                             context->revision_file));
           changes_list->end_offset -= changes_offset;
           changes_list->start_offset = context->next_offset;
           changes_list->count = (*changes)->nelts;
@@ -3226,7 +4274,8 @@ init_rep_state(rep_state_t *rs,
   rs->item_index = entry->item.number;
   rs->header_size = rep_header->header_size;
   rs->start = entry->offset + rs->header_size;
-  rs->current = rep_header->type == svn_fs_fs__rep_plain ? 0 : 4;
+  rs->current = (   rep_header->type == svn_fs_fs__rep_plain
+                 || rep_header->type == svn_fs_fs__rep_chunked) ? 0 : 4;
   rs->size = entry->size - rep_header->header_size - 7;
   rs->ver = -1;
   rs->chunk_index = 0;
@@ -3338,8 +4387,8 @@ cache_windows(svn_fs_t *fs,
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, window_len,
+                                           NULL, iterpool));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3388,6 +4437,10 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
   apr_off_t offset;
   window_cache_key_t key = { 0 };
 
+  /* Chunk lists are only read once per stream.  Nothing to cache. */
+  if (rep_header->type == svn_fs_fs__rep_chunked)
+    return SVN_NO_ERROR;
+
   if (   (rep_header->type != svn_fs_fs__rep_plain
           && (!ffd->txdelta_window_cache || !ffd->raw_window_cache))
       || (rep_header->type == svn_fs_fs__rep_plain
@@ -3415,12 +4468,12 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset,
+                                       scratch_pool));
 
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data, rs.size,
+                                       &plaintext->len, result_pool));
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3511,15 +4564,14 @@ read_item(svn_stream_t **stream,
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
 
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
+  /* Get the item's contents.  For mapped files, this does not copy. */
+  svn_string_t *text = apr_palloc(pool, sizeof(*text));
   text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  SVN_ERR(svn_fs_fs__rev_file_get_data(&text->data, rev_file, text->len,
+                                       pool));
 
   /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
+  *stream = svn_stream_from_string(text, pool);
   digest = svn__fnv1a_32x4(text->data, text->len);
 
   /* Checksums will match most of the time. */
@@ -3718,8 +4770,8 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
-      SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
-                           iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, &block_start, offset,
+                                       iterpool));
 
       /* read all items from the block */
       for (i = 0; i < entries->nelts; ++i)
@@ -3751,8 +4803,8 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, NULL,
+                                               entry->offset, iterpool));
               switch (entry->type)
                 {
                   case SVN_FS_FS__ITEM_TYPE_FILE_REP:
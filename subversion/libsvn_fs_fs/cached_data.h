@@ -51,6 +51,16 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
                              apr_pool_t *result_pool,
                              apr_pool_t *scratch_pool);
 
+/* Make sure that the node-revisions of all svn_fs_dirent_t * in ENTRIES
+   are in FS' noderev cache.  Committed noderevs that are not cached, yet,
+   will be read using a single batched index lookup per revision.  This is
+   a no-op if the noderev cache has been disabled.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_fs__prefetch_node_revisions(svn_fs_t *fs,
+                                   const apr_array_header_t *entries,
+                                   apr_pool_t *scratch_pool);
+
 /* Set *ROOT_ID to the node-id for the root of revision REV in
    filesystem FS.  Do any allocations in POOL. */
 svn_error_t *
@@ -105,6 +115,17 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   apr_off_t offset,
                                   apr_pool_t *pool);
 
+/* If the representation REP in FS is stored as a list of chunks, return
+   the chunk representations in *CHUNKS as an array of representation_t *.
+   Otherwise, set *CHUNKS to NULL.  Allocate the result in RESULT_POOL and
+   use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__get_chunk_list(apr_array_header_t **chunks,
+                          svn_fs_t *fs,
+                          representation_t *rep,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
 /* Attempt to fetch the text representation of node-revision NODEREV as
    seen in filesystem FS and pass it along with the BATON to the PROCESSOR.
    Set *SUCCESS only of the data could be provided and the processing
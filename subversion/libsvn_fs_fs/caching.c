@@ -346,13 +346,57 @@ create_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+/* If DISK is not NULL, put a disk cache for the given SERIALIZER,
+ * DESERIALIZER, KLEN and PREFIX behind *CACHE_P.  If *CACHE_P is NULL,
+ * use the disk cache alone.  Unless NO_HANDLER is true, cache errors
+ * will be reported as warnings to the FS warning callback and otherwise
+ * be ignored.
+ *
+ * The cache is allocated in RESULT_POOL.
+ */
+static svn_error_t *
+add_disk_tier(svn_cache__t **cache_p,
+              svn_cache__disk_t *disk,
+              svn_cache__serialize_func_t serializer,
+              svn_cache__deserialize_func_t deserializer,
+              apr_ssize_t klen,
+              const char *prefix,
+              svn_fs_t *fs,
+              svn_boolean_t no_handler,
+              apr_pool_t *result_pool)
+{
+  svn_cache__t *disk_cache;
+
+  if (disk == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__create_disk(&disk_cache, disk, serializer,
+                                 deserializer, klen, prefix, result_pool));
+  if (*cache_p)
+    SVN_ERR(svn_cache__create_tiered(cache_p, *cache_p, disk_cache,
+                                     result_pool));
+  else
+    *cache_p = disk_cache;
+
+  SVN_ERR(init_callbacks(*cache_p, fs,
+                         no_handler ? NULL
+                                    : warn_and_continue_on_cache_errors,
+                         result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  /* The disk cache outlives this process.  A repository that got deleted
+     and recreated at the same path with the same UUID must not pick up
+     the old contents from it, so qualify the keys with the instance ID. */
   const char *prefix = apr_pstrcat(pool,
                                    "fsfs:", fs->uuid,
+                                   ":", ffd->instance_id,
                                    "/", normalize_key_part(fs->path, pool),
                                    ":",
                                    SVN_VA_NULL);
@@ -546,6 +590,14 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_disk_tier(&(ffd->fulltext_cache),
+                            ffd->disk_cache,
+                            NULL, NULL,
+                            sizeof(pair_cache_key_t),
+                            apr_pstrcat(pool, prefix, "TEXT", SVN_VA_NULL),
+                            fs,
+                            no_handler,
+                            fs->pool));
 
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
@@ -654,6 +706,15 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_disk_tier(&(ffd->combined_window_cache),
+                            ffd->disk_cache,
+                            NULL, NULL,
+                            sizeof(window_cache_key_t),
+                            apr_pstrcat(pool, prefix, "COMBINED_WINDOW",
+                                        SVN_VA_NULL),
+                            fs,
+                            no_handler,
+                            fs->pool));
     }
   else
     {
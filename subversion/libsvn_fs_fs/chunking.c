@@ -0,0 +1,154 @@
+/* chunking.c : content-defined chunking of large file contents
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_sorts.h"
+
+#include "chunking.h"
+
+struct svn_fs_fs__chunker_t
+{
+  /* Pseudo-random value per byte value, rolled into HASH. */
+  apr_uint64_t gear[256];
+
+  /* Boundary conditions below and above the average chunk size.
+   * MASK_SMALL selects more bits than MASK_LARGE. */
+  apr_uint64_t mask_small;
+  apr_uint64_t mask_large;
+
+  /* Chunk size limits in bytes. */
+  apr_size_t min_size;
+  apr_size_t average_size;
+  apr_size_t max_size;
+
+  /* Rolling hash and size of the current chunk so far. */
+  apr_uint64_t hash;
+  apr_size_t size;
+};
+
+/* Return a mask selecting the topmost BITS bits of a 64 bit value.
+ * These depend on the largest number of recent bytes in the Gear hash. */
+static apr_uint64_t
+top_bits(int bits)
+{
+  return ~(~APR_UINT64_C(0) >> bits);
+}
+
+svn_fs_fs__chunker_t *
+svn_fs_fs__chunker_create(apr_size_t average_size,
+                          apr_pool_t *result_pool)
+{
+  svn_fs_fs__chunker_t *chunker = apr_pcalloc(result_pool, sizeof(*chunker));
+  apr_uint64_t state = APR_UINT64_C(0x5356452d43444321);
+  int bits = 0;
+  int i;
+
+  average_size = MAX(average_size, SVN_FS_FS__CHUNK_SIZE_MIN);
+  average_size = MIN(average_size, SVN_FS_FS__CHUNK_SIZE_MAX);
+  while (((apr_size_t)2 << bits) <= average_size)
+    ++bits;
+
+  /* The chunk boundaries must never change for a given average size or
+   * we will stop finding matching chunks.  Hence, fill the Gear table
+   * from a fixed seed using the SplitMix64 generator. */
+  for (i = 0; i < 256; ++i)
+    {
+      apr_uint64_t value;
+
+      state += APR_UINT64_C(0x9e3779b97f4a7c15);
+      value = state;
+      value = (value ^ (value >> 30)) * APR_UINT64_C(0xbf58476d1ce4e5b9);
+      value = (value ^ (value >> 27)) * APR_UINT64_C(0x94d049bb133111eb);
+      chunker->gear[i] = value ^ (value >> 31);
+    }
+
+  chunker->mask_small = top_bits(bits + 1);
+  chunker->mask_large = top_bits(bits - 1);
+  chunker->average_size = (apr_size_t)1 << bits;
+  chunker->min_size = chunker->average_size / 4;
+  chunker->max_size = chunker->average_size * 4;
+
+  return chunker;
+}
+
+apr_size_t
+svn_fs_fs__chunker_max_size(const svn_fs_fs__chunker_t *chunker)
+{
+  return chunker->max_size;
+}
+
+apr_size_t
+svn_fs_fs__chunker_scan(svn_boolean_t *boundary,
+                        svn_fs_fs__chunker_t *chunker,
+                        const char *data,
+                        apr_size_t len)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+  apr_uint64_t hash = chunker->hash;
+  apr_size_t offset = chunker->size;
+  apr_size_t i, end;
+
+  /* Boundaries within the minimum chunk size would be ignored anyway.
+   * Don't even hash that data. */
+  i = offset < chunker->min_size
+    ? MIN(chunker->min_size - offset, len)
+    : 0;
+
+  /* Up to the average size, use the stricter boundary condition. */
+  end = offset < chunker->average_size
+      ? MIN(chunker->average_size - offset, len)
+      : 0;
+  for (; i < end; ++i)
+    {
+      hash = (hash << 1) + chunker->gear[bytes[i]];
+      if ((hash & chunker->mask_small) == 0)
+        goto found;
+    }
+
+  /* Beyond that, use the more lenient one up to the maximum size. */
+  end = MIN(chunker->max_size - offset, len);
+  for (; i < end; ++i)
+    {
+      hash = (hash << 1) + chunker->gear[bytes[i]];
+      if ((hash & chunker->mask_large) == 0)
+        goto found;
+    }
+
+  /* Enforce the maximum chunk size. */
+  if (offset + i == chunker->max_size)
+    {
+      chunker->hash = 0;
+      chunker->size = 0;
+      *boundary = TRUE;
+      return i;
+    }
+
+  chunker->hash = hash;
+  chunker->size = offset + len;
+  *boundary = FALSE;
+  return len;
+
+ found:
+  chunker->hash = 0;
+  chunker->size = 0;
+  *boundary = TRUE;
+  return i + 1;
+}
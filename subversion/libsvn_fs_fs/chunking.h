@@ -0,0 +1,84 @@
+/* chunking.h : content-defined chunking of large file contents
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_CHUNKING_H
+#define SVN_LIBSVN_FS_FS_CHUNKING_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* If enabled by the "chunking-threshold" setting, file contents larger
+ * than that threshold get split into chunks at positions determined by
+ * a rolling hash over the data.  Because the chunk boundaries depend on
+ * the local content only, an insertion or removal in a large file only
+ * changes the chunks around it.  Every chunk is stored as a separate
+ * representation that gets shared through the rep-cache, and the file
+ * contents become a CHUNKED representation listing those chunks.
+ *
+ * The chunker follows the FastCDC approach: a Gear hash, no boundaries
+ * within the first quarter of the average chunk size, a stricter boundary
+ * condition below and a more lenient one above the average size and a
+ * forced boundary at four times the average size.
+ */
+
+/* Default and limits of the average chunk size in bytes. */
+#define SVN_FS_FS__CHUNK_SIZE_DEFAULT 0x10000
+#define SVN_FS_FS__CHUNK_SIZE_MIN     0x1000
+#define SVN_FS_FS__CHUNK_SIZE_MAX     0x1000000
+
+/* Opaque chunker state. */
+typedef struct svn_fs_fs__chunker_t svn_fs_fs__chunker_t;
+
+/* Return a new chunker, allocated in RESULT_POOL, that produces chunks
+ * of AVERAGE_SIZE bytes on average.  AVERAGE_SIZE will be rounded down
+ * to a power of two and clipped to the limits given above.
+ */
+svn_fs_fs__chunker_t *
+svn_fs_fs__chunker_create(apr_size_t average_size,
+                          apr_pool_t *result_pool);
+
+/* Return the maximum size of the chunks produced by CHUNKER. */
+apr_size_t
+svn_fs_fs__chunker_max_size(const svn_fs_fs__chunker_t *chunker);
+
+/* Scan the LEN bytes at DATA, which directly follow the data scanned by
+ * the previous calls to CHUNKER.  If the current chunk ends within DATA,
+ * set *BOUNDARY and return the number of bytes up to and including the
+ * chunk's last byte; CHUNKER will then start a new chunk.  Otherwise,
+ * clear *BOUNDARY and return LEN.
+ */
+apr_size_t
+svn_fs_fs__chunker_scan(svn_boolean_t *boundary,
+                        svn_fs_fs__chunker_t *chunker,
+                        const char *data,
+                        apr_size_t len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_CHUNKING_H */
@@ -0,0 +1,221 @@
+/* compression_dict.c : per-shard zstd compression dictionaries
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+
+#include "private/svn_string_private.h"
+
+#include "compression_dict.h"
+#include "util.h"
+
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* zstd reserves dictionary IDs below this value.  Shard N uses the ID
+ * DICT_ID_BASE + N. */
+#define DICT_ID_BASE 0x8000
+
+/* Return the dictionary ID for SHARD. */
+static apr_uint32_t
+dict_id_for_shard(apr_int64_t shard)
+{
+  return (apr_uint32_t)(DICT_ID_BASE + shard);
+}
+
+/* Pool cleanup function destroying the root pool DATA. */
+static apr_status_t
+destroy_dicts_pool(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_fs_fs__initialize_compression_dicts(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* Dictionaries may be read from any thread, so they need a pool with
+   * an allocator of their own. */
+  ffd->compression_dicts_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  apr_pool_cleanup_register(fs->pool, ffd->compression_dicts_pool,
+                            destroy_dicts_pool, apr_pool_cleanup_null);
+
+  ffd->compression_dicts = apr_hash_make(ffd->compression_dicts_pool);
+  ffd->write_dict_shard = -1;
+  ffd->write_dict = NULL;
+
+  return svn_error_trace(svn_mutex__init(&ffd->compression_dicts_lock, TRUE,
+                                         fs->pool));
+}
+
+svn_error_t *
+svn_fs_fs__write_compression_dict(svn_fs_t *fs,
+                                  const char *pack_file_dir,
+                                  apr_int64_t shard,
+                                  const apr_array_header_t *samples,
+                                  svn_boolean_t flush_to_disk,
+                                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stringbuf_t *dict;
+
+  SVN_ERR(svn__zstd_train_dict(&dict, samples,
+                               (apr_size_t)ffd->compression_dict_size,
+                               dict_id_for_shard(shard),
+                               scratch_pool, scratch_pool));
+  if (dict == NULL)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_io_write_atomic2(
+                           svn_dirent_join(pack_file_dir,
+                                           PATH_COMPRESSION_DICT,
+                                           scratch_pool),
+                           dict->data, dict->len, NULL, flush_to_disk,
+                           scratch_pool));
+}
+
+/* Set *DICT to the dictionary with DICT_ID in FS, reading it from disk if
+ * necessary.  If MUST_EXIST is not set and the respective shard has no
+ * dictionary, set *DICT to NULL.  The caller must hold the
+ * COMPRESSION_DICTS_LOCK.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+get_dict(const svn__zstd_dict_t **dict,
+         svn_fs_t *fs,
+         apr_uint32_t dict_id,
+         svn_boolean_t must_exist,
+         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_int64_t shard = (apr_int64_t)dict_id - DICT_ID_BASE;
+  svn__zstd_dict_t *result;
+  svn_stringbuf_t *contents;
+  svn_string_t *contents_str;
+  const char *path;
+  svn_error_t *err;
+
+  result = apr_hash_get(ffd->compression_dicts, &dict_id, sizeof(dict_id));
+  if (result)
+    {
+      *dict = result;
+      return SVN_NO_ERROR;
+    }
+
+  /* The shard may have been packed after we last checked. */
+  if (   dict_id >= DICT_ID_BASE
+      && !svn_fs_fs__is_packed_rev(fs, shard * ffd->max_files_per_dir))
+    SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, scratch_pool));
+
+  if (   dict_id < DICT_ID_BASE
+      || ffd->format < SVN_FS_FS__MIN_COMPRESSION_DICT_FORMAT
+      || !svn_fs_fs__is_packed_rev(fs, shard * ffd->max_files_per_dir))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Invalid compression dictionary ID %u"),
+                             (unsigned int)dict_id);
+
+  path = svn_fs_fs__path_rev_packed(fs, shard * ffd->max_files_per_dir,
+                                    PATH_COMPRESSION_DICT, scratch_pool);
+  err = svn_stringbuf_from_file2(&contents, path, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err) && !must_exist)
+    {
+      svn_error_clear(err);
+      *dict = NULL;
+      return SVN_NO_ERROR;
+    }
+  else if (err)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, err,
+                             _("Can't read compression dictionary of "
+                               "shard %s"),
+                             apr_psprintf(scratch_pool, "%" APR_INT64_T_FMT,
+                                          shard));
+
+  contents_str = svn_stringbuf__morph_into_string(contents);
+  SVN_ERR(svn__zstd_dict_create(&result, contents_str,
+                                ffd->delta_compression_level,
+                                ffd->compression_dicts_pool));
+  if (svn__zstd_dict_id(result) != dict_id)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Compression dictionary '%s' has ID %u "
+                               "instead of %u"),
+                             svn_dirent_local_style(path, scratch_pool),
+                             (unsigned int)svn__zstd_dict_id(result),
+                             (unsigned int)dict_id);
+
+  apr_hash_set(ffd->compression_dicts,
+               apr_pmemdup(ffd->compression_dicts_pool, &dict_id,
+                           sizeof(dict_id)),
+               sizeof(dict_id), result);
+
+  *dict = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__get_compression_dict(const svn__zstd_dict_t **dict,
+                                void *baton,
+                                apr_uint32_t dict_id,
+                                apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_MUTEX__WITH_LOCK(ffd->compression_dicts_lock,
+                       get_dict(dict, fs, dict_id, TRUE, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__get_write_compression_dict(const svn__zstd_dict_t **dict,
+                                      svn_fs_t *fs,
+                                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_int64_t shard;
+
+  *dict = NULL;
+  if (!ffd->compression_dict_size)
+    return SVN_NO_ERROR;
+
+  /* The most recently packed shard provides the dictionary. */
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, scratch_pool));
+  shard = ffd->min_unpacked_rev / ffd->max_files_per_dir - 1;
+  if (shard < 0)
+    return SVN_NO_ERROR;
+
+  if (shard != ffd->write_dict_shard)
+    {
+      SVN_MUTEX__WITH_LOCK(ffd->compression_dicts_lock,
+                           get_dict(&ffd->write_dict, fs,
+                                    dict_id_for_shard(shard), FALSE,
+                                    scratch_pool));
+      ffd->write_dict_shard = shard;
+    }
+
+  *dict = ffd->write_dict;
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,90 @@
+/* compression_dict.h : per-shard zstd compression dictionaries
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_COMPRESSION_DICT_H
+#define SVN_LIBSVN_FS_FS_COMPRESSION_DICT_H
+
+#include "svn_error.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* If enabled by the "compression-dictionary-size" setting, packing a
+ * shard trains a zstd dictionary from the small representations in that
+ * shard and stores it as PATH_COMPRESSION_DICT in the pack directory.
+ * New representations get compressed against the dictionary of the most
+ * recently packed shard.  The dictionary ID tells readers which shard's
+ * dictionary they need; existing data is never rewritten.
+ */
+
+/* Initialize the dictionary-related members of FS' fs_fs_data_t. */
+svn_error_t *
+svn_fs_fs__initialize_compression_dicts(svn_fs_t *fs);
+
+/* Representations of up to this many bytes on disk contribute samples
+ * to the dictionary training. */
+#define SVN_FS_FS__DICT_SAMPLE_ITEM_SIZE 0x1000
+
+/* Collect up to this many times the dictionary size in samples. */
+#define SVN_FS_FS__DICT_SAMPLE_FACTOR 100
+
+/* Train a dictionary for SHARD in FS from SAMPLES, an array of
+ * svn_string_t *, and write it to PACK_FILE_DIR.  If there is not enough
+ * data to train a dictionary, don't write anything.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__write_compression_dict(svn_fs_t *fs,
+                                  const char *pack_file_dir,
+                                  apr_int64_t shard,
+                                  const apr_array_header_t *samples,
+                                  svn_boolean_t flush_to_disk,
+                                  apr_pool_t *scratch_pool);
+
+/* Implements svn_txdelta__dict_func_t for BATON being the svn_fs_t * to
+ * read from.  Dictionaries will be cached in the FS and may be used
+ * concurrently by multiple threads.  Looking them up may update the FS'
+ * state, though, and must happen in the thread owning the FS.
+ */
+svn_error_t *
+svn_fs_fs__get_compression_dict(const svn__zstd_dict_t **dict,
+                                void *baton,
+                                apr_uint32_t dict_id,
+                                apr_pool_t *scratch_pool);
+
+/* Set *DICT to the dictionary to compress new representations in FS
+ * against.  Set it to NULL if dictionaries are disabled or none is
+ * available.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__get_write_compression_dict(const svn__zstd_dict_t **dict,
+                                      svn_fs_t *fs,
+                                      apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_COMPRESSION_DICT_H */
@@ -34,6 +34,7 @@
 #include "svn_pools.h"
 #include "fs.h"
 #include "fs_fs.h"
+#include "compression_dict.h"
 #include "tree.h"
 #include "lock.h"
 #include "hotcopy.h"
@@ -328,6 +329,17 @@ fs_ioctl(svn_fs_t *fs, svn_fs_ioctl_code_t ctlcode,
           *output_p = NULL;
           return SVN_NO_ERROR;
         }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_GET_DISK_CACHE.code)
+        {
+          fs_fs_data_t *ffd = fs->fsap_data;
+          svn_fs_fs__ioctl_get_disk_cache_output_t *output
+            = apr_pcalloc(result_pool, sizeof(*output));
+
+          output->disk_cache = ffd->disk_cache;
+          output->instance_id = apr_pstrdup(result_pool, ffd->instance_id);
+          *output_p = output;
+          return SVN_NO_ERROR;
+        }
     }
 
   return svn_error_create(SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE, NULL, NULL);
@@ -375,6 +387,8 @@ initialize_fs_struct(svn_fs_t *fs)
 
   fs->vtable = &fs_vtable;
   fs->fsap_data = ffd;
+  SVN_ERR(svn_fs_fs__initialize_compression_dicts(fs));
+
   return SVN_NO_ERROR;
 }
 
@@ -444,6 +458,35 @@ fs_open(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_instance(svn_fs_t **instance_p,
+                         svn_fs_t *fs,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *instance_ffd;
+  svn_fs_t *instance = apr_pcalloc(result_pool, sizeof(*instance));
+
+  instance->pool = result_pool;
+  instance->warning = fs->warning;
+  instance->warning_baton = fs->warning_baton;
+  instance->config = fs->config;
+
+  SVN_ERR(initialize_fs_struct(instance));
+  SVN_ERR(svn_fs_fs__open(instance, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(instance, scratch_pool));
+
+  /* FS has already been registered with the process-wide data, so we
+     don't need the COMMON_POOL_LOCK to pick it up. */
+  instance_ffd = instance->fsap_data;
+  instance_ffd->shared = ffd->shared;
+  instance_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+
+  *instance_p = instance;
+  return SVN_NO_ERROR;
+}
+
 
 
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
@@ -545,6 +588,7 @@ fs_verify(svn_fs_t *fs, const char *path,
 static svn_error_t *
 fs_pack(svn_fs_t *fs,
         const char *path,
+        int jobs,
         svn_fs_pack_notify_t notify_func,
         void *notify_baton,
         svn_cancel_func_t cancel_func,
@@ -554,7 +598,7 @@ fs_pack(svn_fs_t *fs,
         apr_pool_t *common_pool)
 {
   SVN_ERR(fs_open(fs, path, common_pool_lock, pool, common_pool));
-  return svn_fs_fs__pack(fs, 0, notify_func, notify_baton,
+  return svn_fs_fs__pack(fs, 0, jobs, notify_func, notify_baton,
                          cancel_func, cancel_baton, pool);
 }
 
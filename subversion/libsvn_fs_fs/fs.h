@@ -36,6 +36,8 @@
 #include "private/svn_fs_private.h"
 #include "private/svn_sqlite.h"
 #include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_task.h"
 
 #include "rev_file.h"
 
@@ -70,6 +72,8 @@ extern "C" {
                                                  /* Current revprop generation*/
 #define PATH_MANIFEST         "manifest"         /* Manifest file name */
 #define PATH_PACKED           "pack"             /* Packed revision data file */
+#define PATH_COMPRESSION_DICT "dict"             /* zstd dictionary of a
+                                                    packed shard */
 #define PATH_EXT_PACKED_SHARD ".pack"            /* Extension for packed
                                                     shards */
 #define PATH_EXT_L2P_INDEX    ".l2p"             /* extension of the log-
@@ -92,6 +96,8 @@ extern "C" {
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
+#define PATH_TXN_CHUNK_REPS "chunk-reps"   /* New chunk reps to put into the
+                                              rep-cache upon commit */
 
 /* Names of files in legacy FS formats */
 #define PATH_REV           "rev"           /* Proto rev file */
@@ -100,8 +106,12 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_DISK_CACHE_PATH    "disk-cache-path"
+#define CONFIG_OPTION_DISK_CACHE_SIZE    "disk-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
+#define CONFIG_OPTION_CHUNKING_THRESHOLD "chunking-threshold"
+#define CONFIG_OPTION_CHUNK_SIZE         "chunk-size"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
 #define CONFIG_OPTION_ENABLE_DIR_DELTIFICATION   "enable-dir-deltification"
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
@@ -115,10 +125,15 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_USE_MMAP           "use-mmap"
+#define CONFIG_OPTION_DELTA_READ_THREADS "delta-read-threads"
+#define CONFIG_OPTION_DELTA_WRITE_THREADS "delta-write-threads"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
 #define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_LARGE_DELTA_WINDOWS "large-delta-windows"
+#define CONFIG_OPTION_COMPRESSION_DICTIONARY_SIZE "compression-dictionary-size"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -127,7 +142,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +215,21 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3, i.e. large
+   sliding delta windows. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
+/* The minimum format number that supports svndiff version 4, i.e. zstd
+   compression. */
+#define SVN_FS_FS__MIN_SVNDIFF4_FORMAT 9
+
+/* The minimum format number that supports per-shard compression
+   dictionaries. */
+#define SVN_FS_FS__MIN_COMPRESSION_DICT_FORMAT 9
+
+/* The minimum format number that supports CHUNKED representations. */
+#define SVN_FS_FS__MIN_CHUNKED_REP_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -315,7 +345,8 @@ typedef enum compression_type_t
 {
   compression_type_none,
   compression_type_zlib,
-  compression_type_lz4
+  compression_type_lz4,
+  compression_type_zstd
 } compression_type_t;
 
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
@@ -336,6 +367,25 @@ typedef struct fs_fs_data_t
   /* Rev / pack file read granularity in bytes. */
   apr_int64_t block_size;
 
+  /* If set, map committed rev / pack files into memory and read from
+     there instead of using buffered file I/O. */
+  svn_boolean_t use_mmap;
+
+  /* Number of threads to use for parsing the delta windows of a delta
+     chain when reconstructing a fulltext.  Values below 2 disable
+     threading. */
+  int delta_read_threads;
+
+  /* Worker threads parsing delta windows, see DELTA_READ_THREADS.  They
+     are started on demand and run until DELTA_READ_POOL, a sub-pool of
+     the FS pool, gets cleaned up.  NULL until first used. */
+  svn_task__queue_t *delta_read_queue;
+  apr_pool_t *delta_read_pool;
+
+  /* Number of threads to use for compressing the delta windows of new
+     representations.  Values below 2 disable threading. */
+  int delta_write_threads;
+
   /* Capacity in entries of log-to-phys index pages */
   apr_int64_t l2p_page_size;
 
@@ -356,6 +406,10 @@ typedef struct fs_fs_data_t
   /* Access to the configured memcached instances.  May be NULL. */
   svn_memcache_t *memcache;
 
+  /* Persistent second-level cache for fulltexts and combined windows.
+     May be NULL. */
+  svn_cache__disk_t *disk_cache;
+
   /* If TRUE, don't ignore any cache-related errors.  If FALSE, errors from
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
@@ -473,6 +527,13 @@ typedef struct fs_fs_data_t
    * and allowed by the configuration. */
   svn_boolean_t rep_sharing_allowed;
 
+  /* File contents of at least this many bytes get stored as chunks
+   * shared through the rep-cache.  0 disables chunking. */
+  apr_int64_t chunking_threshold;
+
+  /* Average size of these chunks in bytes. */
+  apr_int64_t chunk_size;
+
   /* File size limit in bytes up to which multiple revprops shall be packed
    * into a single file. */
   apr_int64_t revprop_pack_size;
@@ -496,9 +557,32 @@ typedef struct fs_fs_data_t
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
-  /* Compression level (currently, only used with compression_type_zlib). */
+  /* Compression level (used with compression_type_zlib and
+     compression_type_zstd). */
   int delta_compression_level;
 
+  /* Write new representations in svndiff3 format, i.e. with large delta
+   * windows and sliding source views. */
+  svn_boolean_t large_delta_windows;
+
+  /* Maximum size in bytes of the zstd dictionary trained for each packed
+   * shard.  0 disables the training and use of dictionaries. */
+  apr_int64_t compression_dict_size;
+
+  /* zstd dictionaries read so far, mapping the apr_uint32_t dictionary ID
+   * to the svn__zstd_dict_t *.  Windows may be parsed in other threads,
+   * so all access must be serialized by COMPRESSION_DICTS_LOCK and the
+   * dictionaries live in their own root pool COMPRESSION_DICTS_POOL. */
+  apr_hash_t *compression_dicts;
+  svn_mutex__t *compression_dicts_lock;
+  apr_pool_t *compression_dicts_pool;
+
+  /* Shard whose dictionary has last been looked up for compressing new
+   * representations (-1 if none) and that dictionary.  The latter may be
+   * NULL if that shard has no dictionary. */
+  apr_int64_t write_dict_shard;
+  const svn__zstd_dict_t *write_dict;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -35,6 +35,7 @@
 #include "svn_version.h"
 
 #include "cached_data.h"
+#include "chunking.h"
 #include "id.h"
 #include "index.h"
 #include "low_level.h"
@@ -693,7 +694,8 @@ parse_compression_option(compression_type_t *compression_type_p,
   int level;
   svn_boolean_t is_valid = TRUE;
 
-  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9 */
+  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9
+   *               | zstd | zstd-1 ... zstd-19 */
   if (strcmp(value, "none") == 0)
     {
       type = compression_type_none;
@@ -723,6 +725,26 @@ parse_compression_option(compression_type_t *compression_type_p,
       else
         is_valid = FALSE;
     }
+  else if (strncmp(value, "zstd", 4) == 0)
+    {
+      const char *p = value + 4;
+
+      type = compression_type_zstd;
+      if (*p == 0)
+        {
+          level = SVN__COMPRESSION_ZSTD_DEFAULT;
+        }
+      else if (*p == '-')
+        {
+          p++;
+          SVN_ERR(svn_cstring_atoi(&level, p));
+          if (   level < SVN__COMPRESSION_ZSTD_MIN
+              || level > SVN__COMPRESSION_ZSTD_MAX)
+            is_valid = FALSE;
+        }
+      else
+        is_valid = FALSE;
+    }
   else
     {
       is_valid = FALSE;
@@ -761,6 +783,30 @@ read_config(fs_fs_data_t *ffd,
   else
     ffd->rep_sharing_allowed = FALSE;
 
+  /* Initialize the chunking settings.  Chunks are only useful if they
+     can be shared. */
+  SVN_ERR(svn_config_get_int64(config, &ffd->chunking_threshold,
+                               CONFIG_SECTION_REP_SHARING,
+                               CONFIG_OPTION_CHUNKING_THRESHOLD,
+                               0));
+  SVN_ERR(svn_config_get_int64(config, &ffd->chunk_size,
+                               CONFIG_SECTION_REP_SHARING,
+                               CONFIG_OPTION_CHUNK_SIZE,
+                               SVN_FS_FS__CHUNK_SIZE_DEFAULT / 0x400));
+  ffd->chunking_threshold = MAX(0, ffd->chunking_threshold) * 0x400;
+  ffd->chunk_size
+    = MIN(MAX(SVN_FS_FS__CHUNK_SIZE_MIN / 0x400, ffd->chunk_size),
+          SVN_FS_FS__CHUNK_SIZE_MAX / 0x400) * 0x400;
+  if (ffd->chunking_threshold)
+    {
+      if (ffd->format < SVN_FS_FS__MIN_CHUNKED_REP_FORMAT)
+        return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                _("The 'chunking-threshold' option requires "
+                                  "filesystem format 9 or higher"));
+      if (!ffd->rep_sharing_allowed)
+        ffd->chunking_threshold = 0;
+    }
+
   /* Initialize deltification settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
@@ -849,6 +895,27 @@ read_config(fs_fs_data_t *ffd,
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->use_mmap,
+                              CONFIG_SECTION_IO,
+                              CONFIG_OPTION_USE_MMAP,
+                              FALSE));
+
+  {
+    apr_int64_t delta_read_threads;
+    SVN_ERR(svn_config_get_int64(config, &delta_read_threads,
+                                 CONFIG_SECTION_IO,
+                                 CONFIG_OPTION_DELTA_READ_THREADS, 0));
+    ffd->delta_read_threads = (int)MIN(MAX(delta_read_threads, 0), 64);
+  }
+
+  {
+    apr_int64_t delta_write_threads;
+    SVN_ERR(svn_config_get_int64(config, &delta_write_threads,
+                                 CONFIG_SECTION_IO,
+                                 CONFIG_OPTION_DELTA_WRITE_THREADS, 0));
+    ffd->delta_write_threads = (int)MIN(MAX(delta_write_threads, 0), 64);
+  }
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -891,6 +958,18 @@ read_config(fs_fs_data_t *ffd,
                                       _("Compression type 'lz4' requires "
                                         "filesystem format 8 or higher"));
             }
+          if (ffd->delta_compression_type == compression_type_zstd)
+            {
+              if (ffd->format < SVN_FS_FS__MIN_SVNDIFF4_FORMAT)
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' requires "
+                                          "filesystem format 9 or higher"));
+              if (!svn__zstd_available())
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' is not "
+                                          "supported by this build of "
+                                          "Subversion"));
+            }
         }
       else if (compression_level_val)
         {
@@ -926,6 +1005,41 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->large_delta_windows,
+                              CONFIG_SECTION_DELTIFICATION,
+                              CONFIG_OPTION_LARGE_DELTA_WINDOWS,
+                              FALSE));
+  if (ffd->large_delta_windows)
+    {
+      if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+        return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                _("The 'large-delta-windows' option requires "
+                                  "filesystem format 9 or higher"));
+      if (ffd->delta_compression_type != compression_type_lz4)
+        return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                _("The 'large-delta-windows' option requires "
+                                  "'lz4' compression"));
+    }
+
+  SVN_ERR(svn_config_get_int64(config, &ffd->compression_dict_size,
+                               CONFIG_SECTION_DELTIFICATION,
+                               CONFIG_OPTION_COMPRESSION_DICTIONARY_SIZE,
+                               0));
+  ffd->compression_dict_size
+    = MIN(MAX(0, ffd->compression_dict_size), 1024) * 0x400;
+  if (   ffd->compression_dict_size
+      && ffd->format < SVN_FS_FS__MIN_COMPRESSION_DICT_FORMAT)
+    return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                            _("The 'compression-dictionary-size' option "
+                              "requires filesystem format 9 or higher"));
+  if (   ffd->compression_dict_size
+      && (   ffd->delta_compression_type != compression_type_zstd
+          || !ffd->use_log_addressing))
+    return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                            _("The 'compression-dictionary-size' option "
+                              "requires 'zstd' compression and a "
+                              "repository with logical addressing"));
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -946,6 +1060,28 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* disk cache configuration */
+  {
+    const char *disk_cache_path;
+    apr_int64_t disk_cache_size;
+
+    svn_config_get(config, &disk_cache_path, CONFIG_SECTION_CACHES,
+                   CONFIG_OPTION_DISK_CACHE_PATH, NULL);
+    SVN_ERR(svn_config_get_int64(config, &disk_cache_size,
+                                 CONFIG_SECTION_CACHES,
+                                 CONFIG_OPTION_DISK_CACHE_SIZE,
+                                 1024));
+
+    if (disk_cache_path && *disk_cache_path && disk_cache_size > 0)
+      SVN_ERR(svn_cache__disk_open(&ffd->disk_cache,
+                                   svn_dirent_join(fs_path, disk_cache_path,
+                                                   scratch_pool),
+                                   (apr_uint64_t)disk_cache_size * 0x100000,
+                                   scratch_pool));
+    else
+      ffd->disk_cache = NULL;
+  }
+
   return SVN_NO_ERROR;
 }
 
@@ -978,6 +1114,19 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### A persistent cache for file contents and delta combinations may be"     NL
+"### placed on local disk behind the in-memory caches.  Unlike those, it"    NL
+"### survives server restarts and is shared between all server processes,"   NL
+"### avoiding slow, expensive reconstruction of long delta chains after"     NL
+"### e.g. an httpd restart.  To enable it, set disk-cache-path to a local"   NL
+"### directory that is writable by all server processes.  Relative paths"    NL
+"### are relative to the db directory.  Multiple repositories may share"     NL
+"### the same directory.  disk-cache-size limits the cache contents; once"   NL
+"### it is exceeded, the cache gets cleared.  It is given in MB and"         NL
+"### defaults to 1024 MB.  The disk cache is disabled by default."           NL
+"# " CONFIG_OPTION_DISK_CACHE_PATH " = /var/cache/svn"                       NL
+"# " CONFIG_OPTION_DISK_CACHE_SIZE " = 1024"                                 NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -994,6 +1143,25 @@ write_config(svn_fs_t *fs,
 "### 'svnadmin verify' will check the rep-cache regardless of this setting." NL
 "### rep-sharing is enabled by default."                                     NL
 "# " CONFIG_OPTION_ENABLE_REP_SHARING " = true"                              NL
+"###"                                                                        NL
+"### Rep-sharing only finds identical file contents.  Large files that"      NL
+"### differ in just a few places, e.g. disk images or archives, can be"      NL
+"### split into chunks of varying sizes instead.  The chunk boundaries are"  NL
+"### determined by the contents, such that unchanged parts of a file will"   NL
+"### produce the same chunks.  Every chunk is stored only once per"          NL
+"### repository and shared via the rep-cache like any other content."       NL
+"### The following parameter enables chunking for file contents of at"       NL
+"### least that many kBytes.  Files below that size are stored as usual."    NL
+"### Chunking requires rep-sharing to be enabled and a format 9"            NL
+"### repository, available in Subversion 1.15 and higher."                   NL
+"### Chunking is disabled (0) by default."                                   NL
+"# " CONFIG_OPTION_CHUNKING_THRESHOLD " = 0"                                 NL
+"###"                                                                        NL
+"### The average size of these chunks in kBytes.  It will be rounded down"   NL
+"### to a power of two between 4 and 16384.  Smaller chunks find more"       NL
+"### duplicates but add more overhead.  Changing this value later will"      NL
+"### prevent new chunks from matching existing ones.  The default is 64."    NL
+"# " CONFIG_OPTION_CHUNK_SIZE " = 64"                                        NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DELTIFICATION "]"                                         NL
 "### To conserve space, the filesystem stores data as differences against"   NL
@@ -1059,19 +1227,27 @@ write_config(svn_fs_t *fs,
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
-"### select between available algorithms (zlib, lz4).  zlib is a general-"   NL
-"### purpose compression algorithm.  lz4 is a fast compression algorithm"    NL
-"### which should be preferred for repositories with large and, possibly,"   NL
-"### incompressible files.  Note that the compression ratio of lz4 is"       NL
-"### usually lower than the one provided by zlib, but using it can"          NL
+"### select between available algorithms (zlib, lz4, zstd).  zlib is a"      NL
+"### general-purpose compression algorithm.  lz4 is a fast compression"      NL
+"### algorithm which should be preferred for repositories with large and,"   NL
+"### possibly, incompressible files.  Note that the compression ratio of lz4" NL
+"### is usually lower than the one provided by zlib, but using it can"       NL
 "### significantly speed up commits as well as reading the data."            NL
 "### lz4 compression algorithm is supported, starting from format 8"         NL
 "### repositories, available in Subversion 1.10 and higher."                 NL
+"### zstd (Zstandard) achieves compression ratios similar to zlib while"     NL
+"### being almost as fast as lz4 to decompress.  Higher levels compress"     NL
+"### better but slow down commits.  zstd compression is supported,"         NL
+"### starting from format 9 repositories, available in Subversion 1.15 and"  NL
+"### higher, and requires a build with zstd support.  Repositories"          NL
+"### containing zstd-compressed data cannot be read by builds without it."   NL
 "### The syntax of this option is:"                                          NL
 "###   " CONFIG_OPTION_COMPRESSION " = none | lz4 | zlib | zlib-1 ... zlib-9" NL
+"###                 | zstd | zstd-1 ... zstd-19"                            NL
 "### Versions prior to Subversion 1.10 will ignore this option."             NL
 "### The default value is 'lz4' if supported by the repository format and"   NL
-"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5'."         NL
+"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5' and"      NL
+"### 'zstd' is equivalent to 'zstd-3'."                                      NL
 "# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
 "###"                                                                        NL
 "### DEPRECATED: The new '" CONFIG_OPTION_COMPRESSION "' option deprecates previously used" NL
@@ -1080,6 +1256,31 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### Large binary files, e.g. archives or installers, often don't deltify"   NL
+"### well because the default delta windows are only 100 kBytes wide."       NL
+"### Inserting a few bytes near the start of such a file may cause the whole"NL
+"### file to be stored again.  If this option is enabled, new file"         NL
+"### representations will be stored with 1 MByte delta windows whose source" NL
+"### data slides along with the changes in the file (svndiff version 3)."    NL
+"### This requires lz4 compression and a format 9 repository, available in"  NL
+"### Subversion 1.15 and higher; use 'svnadmin upgrade' to upgrade older"    NL
+"### repositories before enabling it.  It costs more memory and CPU when"    NL
+"### committing."                                                            NL
+"### Large delta windows are disabled by default."                           NL
+"# " CONFIG_OPTION_LARGE_DELTA_WINDOWS " = false"                            NL
+"###"                                                                        NL
+"### Small representations, e.g. directories and short source files,"        NL
+"### compress poorly because each of them is compressed individually."       NL
+"### If this option is set to a non-zero value, packing a shard will"        NL
+"### train a zstd dictionary of up to that many kBytes from the shard's"     NL
+"### contents and store it alongside the pack file.  New representations"    NL
+"### will then be compressed against the dictionary of the most"             NL
+"### recently packed shard.  This requires 'zstd' compression and a"         NL
+"### format 9 repository using logical addressing.  Values of up to 1024"    NL
+"### are supported; 64 is a reasonable choice."                              NL
+"### Compression dictionaries are disabled by default."                      NL
+"# " CONFIG_OPTION_COMPRESSION_DICTIONARY_SIZE " = 0"                        NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1148,6 +1349,35 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### If use-mmap is enabled, revision and pack files will be mapped into"    NL
+"### memory when being read instead of using buffered file I/O.  This saves" NL
+"### a data copy and system calls for every block read and may speed up"     NL
+"### uncached access to large repositories on 64 bit systems.  Files that"   NL
+"### can't be mapped will still be read normally.  Note that on Windows,"    NL
+"### mapped files can't be deleted,  which may interfere with packing."      NL
+"### This option applies to all format versions and defaults to false."      NL
+"# " CONFIG_OPTION_USE_MMAP " = false"                                       NL
+"###"                                                                        NL
+"### Reading files with long delta chains is usually limited by the speed"   NL
+"### at which a single CPU core can decompress and parse the txdelta"        NL
+"### windows.  If delta-read-threads is larger than 1,  up to that many"     NL
+"### threads will parse the windows of the chain links in parallel while"    NL
+"### the rev / pack file data is still being read sequentially.  This uses"  NL
+"### some more memory and may read a few delta windows that turn out not"    NL
+"### to be needed.  The threads are started when first needed and kept"      NL
+"### until the repository is closed.  Values above 64 will be capped."       NL
+"### This option applies to all format versions and defaults to 0 (off)."    NL
+"# " CONFIG_OPTION_DELTA_READ_THREADS " = 0"                                 NL
+"###"                                                                        NL
+"### Similarly, committing large files with compression enabled is usually"  NL
+"### limited by the speed at which a single CPU core can compress the"       NL
+"### delta windows.  If delta-write-threads is larger than 1, up to that"    NL
+"### many threads will compress consecutive windows in parallel.  The data"  NL
+"### written to the repository is the same.  Values above 64 will be"        NL
+"### capped."                                                                NL
+"### This option applies to all format versions and defaults to 0 (off)."    NL
+"# " CONFIG_OPTION_DELTA_WRITE_THREADS " = 0"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1952,6 +2182,13 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11:
+          case 12:
+          case 13:
+          case 14: format = 8;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2323,8 +2560,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 15;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -2398,7 +2638,7 @@ reindex_node(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL,
                                  svn_fs_fs__id_item(id), pool));
 
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset, pool));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev, rev_file->stream,
                                   pool, pool));
 
@@ -48,6 +48,16 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Open another filesystem object for the repository underlying FS and
+   return it in *INSTANCE_P, allocated in RESULT_POOL.  The new instance
+   shares FS' process-wide data but has its own caches and open files,
+   so it can be used from a different thread than FS.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *svn_fs_fs__open_instance(svn_fs_t **instance_p,
+                                      svn_fs_t *fs,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
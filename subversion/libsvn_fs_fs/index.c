@@ -186,6 +186,10 @@ struct svn_fs_fs__packed_number_stream_t
   /* underlying data file containing the packed values */
   apr_file_t *file;
 
+  /* If not NULL, the contents of FILE mapped into memory.  Read from here
+   * instead of FILE then. */
+  const unsigned char *data;
+
   /* Offset within FILE at which the stream data starts
    * (i.e. which offset will reported as offset 0 by packed_stream_offset). */
   apr_off_t stream_start;
@@ -250,13 +254,14 @@ SVN__PREVENT_INLINE
 static svn_error_t *
 packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 {
-  unsigned char buffer[MAX_NUMBER_PREFETCH];
+  unsigned char file_buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *buffer = file_buffer;
   apr_size_t bytes_read = 0;
   apr_size_t i;
   value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
-  apr_status_t err;
+  apr_status_t err = APR_SUCCESS;
 
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
@@ -265,15 +270,19 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
    * i.e. the last number has been incomplete (and not buffered in stream)
    * and need to be re-read.  Therefore, always correct the file pointer.
    */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  if (stream->data)
+    block_start = stream->next_offset
+                - stream->next_offset % stream->block_size;
+  else
+    SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                     &block_start, stream->next_offset,
+                                     stream->pool));
 
   /* prefetch at least one number but, if feasible, don't cross block
    * boundaries.  This shall prevent jumping back and forth between two
    * blocks because the extra data was not actually request _now_.
    */
-  bytes_read = sizeof(buffer);
+  bytes_read = sizeof(file_buffer);
   block_left = stream->block_size - (stream->next_offset - block_start);
   if (block_left >= 10 && block_left < bytes_read)
     bytes_read = (apr_size_t)block_left;
@@ -283,10 +292,18 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
   bytes_read = (apr_size_t)MIN(bytes_read,
                                stream->stream_end - stream->next_offset);
 
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+  if (stream->data)
+    {
+      /* Parse straight from the mapped file. */
+      buffer = stream->data + stream->next_offset;
+    }
+  else
+    {
+      err = apr_file_read(stream->file, file_buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
   while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
@@ -346,11 +363,12 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 /* Create and open a packed number stream reading from offsets START to
  * END in FILE and return it in *STREAM.  Access the file in chunks of
  * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
+ * If FILE has been mapped into memory, the stream will read from there.
  * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
-                   apr_file_t *file,
+                   svn_fs_fs__revision_file_t *file,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -367,10 +385,8 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
-                                   scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, start, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(file, buffer, len, NULL, scratch_pool));
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -378,11 +394,19 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
                                "  expected: %s"
                                "  found: %s"), stream_prefix, buffer);
 
+  /* We will parse mapped data in-place, so it must not extend beyond
+   * the end of the mapping. */
+  if (file->data && end > file->data_size)
+    return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                            _("Index stream extends beyond the end of "
+                              "the file"));
+
   /* Construct the actual stream object. */
   result = apr_palloc(result_pool, sizeof(*result));
 
   result->pool = result_pool;
-  result->file = file;
+  result->file = file->file;
+  result->data = (const unsigned char *)file->data;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -946,7 +970,7 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
 
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
-                                 rev_file->file,
+                                 rev_file,
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -1103,6 +1127,9 @@ typedef struct l2p_page_info_baton_t
   /* offset of ITEM_INDEX within that page */
   apr_uint32_t page_offset;
 
+  /* number of entries in all but the last page of REVISION */
+  apr_uint32_t page_size;
+
   /* revision identifying the l2p index file, also the first rev in that */
   svn_revnum_t first_revision;
 } l2p_page_info_baton_t;
@@ -1165,6 +1192,7 @@ l2p_page_info_copy(l2p_page_info_baton_t *baton,
       baton->entry = first_entry[baton->page_no];
     }
 
+  baton->page_size = header->page_size;
   baton->first_revision = header->first_revision;
 
   return SVN_NO_ERROR;
@@ -1632,6 +1660,158 @@ l2p_index_lookup(apr_off_t *offset,
   return SVN_NO_ERROR;
 }
 
+/* Request data structure for l2p_entries_access_func.
+ */
+typedef struct l2p_entries_baton_t
+{
+  /* in data */
+  /* revision. Used for error messages only */
+  svn_revnum_t revision;
+
+  /* item indexes to look up.  All of them map to the same page. */
+  const apr_uint64_t *item_indexes;
+
+  /* number of elements in ITEM_INDEXES */
+  int count;
+
+  /* item index of the first entry in the page */
+  apr_uint64_t first_item_index;
+
+  /* out data */
+  /* absolute item offsets in rev / pack file, one for each ITEM_INDEXES
+   * element.  Must be provided by the caller. */
+  apr_off_t *offsets;
+} l2p_entries_baton_t;
+
+/* Return the rev / pack file offsets of all items in BATON->ITEM_INDEXES
+ * taken from OFFSETS of PAGE and write them to BATON->OFFSETS.
+ */
+static svn_error_t *
+l2p_page_get_entries(l2p_entries_baton_t *baton,
+                     const l2p_page_t *page,
+                     const apr_uint64_t *offsets,
+                     apr_pool_t *scratch_pool)
+{
+  int i;
+  for (i = 0; i < baton->count; ++i)
+    {
+      apr_uint64_t page_offset
+        = baton->item_indexes[i] - baton->first_item_index;
+
+      /* overflow check */
+      if (page->entry_count <= page_offset)
+        return svn_error_createf(SVN_ERR_FS_INDEX_OVERFLOW , NULL,
+                                 _("Item index %s"
+                                   " too large in revision %ld"),
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_UINT64_T_FMT,
+                                              baton->item_indexes[i]),
+                                 baton->revision);
+
+      baton->offsets[i] = (apr_off_t)offsets[page_offset];
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__partial_getter_func_t: copy the data requested in
+ * l2p_entries_baton_t *BATON from l2p_page_t *DATA into BATON->OFFSETS.
+ * *OUT remains unchanged.
+ */
+static svn_error_t *
+l2p_entries_access_func(void **out,
+                        const void *data,
+                        apr_size_t data_len,
+                        void *baton,
+                        apr_pool_t *result_pool)
+{
+  /* resolve all in-cache pointers */
+  const l2p_page_t *page = data;
+  const apr_uint64_t *offsets
+    = svn_temp_deserializer__ptr(page, (const void *const *)&page->offsets);
+
+  /* return the requested data */
+  return l2p_page_get_entries(baton, page, offsets, result_pool);
+}
+
+/* Using the log-to-phys indexes in FS, find the absolute offsets in the
+ * rev file for the COUNT items ITEM_INDEXES in REVISION and return them
+ * in the respective elements of OFFSETS.
+ *
+ * The index header and the respective index page are being looked up
+ * only once per consecutive run of items mapping to the same page.
+ * Hence, sorted ITEM_INDEXES give the best performance.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+l2p_index_lookup_batch(apr_off_t *offsets,
+                       svn_fs_t *fs,
+                       svn_fs_fs__revision_file_t *rev_file,
+                       svn_revnum_t revision,
+                       const apr_uint64_t *item_indexes,
+                       int count,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__page_cache_key_t key = { 0 };
+  apr_pool_t *iterpool;
+  int first, last;
+
+  assert(revision <= APR_UINT32_MAX);
+  key.revision = (apr_uint32_t)revision;
+  key.is_packed = svn_fs_fs__is_packed_rev(fs, revision);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (first = 0; first < count; first = last)
+    {
+      l2p_page_info_baton_t info_baton;
+      l2p_entries_baton_t page_baton;
+      svn_boolean_t is_cached = FALSE;
+      void *dummy = NULL;
+
+      svn_pool_clear(iterpool);
+
+      /* find the index page for the first item of this run */
+      info_baton.revision = revision;
+      info_baton.item_index = item_indexes[first];
+      SVN_ERR(get_l2p_page_info(&info_baton, rev_file, fs, iterpool));
+
+      /* process all items mapping to the same page in one go */
+      for (last = first + 1; last < count; ++last)
+        if (item_indexes[last] / info_baton.page_size != info_baton.page_no)
+          break;
+
+      page_baton.revision = revision;
+      page_baton.item_indexes = item_indexes + first;
+      page_baton.count = last - first;
+      page_baton.first_item_index
+        = (apr_uint64_t)info_baton.page_no * info_baton.page_size;
+      page_baton.offsets = offsets + first;
+
+      /* try to find the page in the cache and get the OFFSETS from it */
+      key.page = info_baton.page_no;
+      SVN_ERR(svn_cache__get_partial(&dummy, &is_cached,
+                                     ffd->l2p_page_cache, &key,
+                                     l2p_entries_access_func, &page_baton,
+                                     iterpool));
+
+      if (!is_cached)
+        {
+          /* read the page from disk, cache it and extract our results */
+          l2p_page_t *page;
+          SVN_ERR(get_l2p_page(&page, rev_file, fs, info_baton.first_revision,
+                               &info_baton.entry, iterpool));
+          SVN_ERR(svn_cache__set(ffd->l2p_page_cache, &key, page, iterpool));
+          SVN_ERR(l2p_page_get_entries(&page_baton, page, page->offsets,
+                                       iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Using the log-to-phys proto index in transaction TXN_ID in FS, find the
  * absolute offset in the proto rev file for the given ITEM_INDEX and return
  * it in *OFFSET.  Use SCRATCH_POOL for temporary allocations.
@@ -1816,6 +1996,43 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
   return svn_error_trace(err);
 }
 
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *absolute_positions,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        svn_revnum_t revision,
+                        const apr_uint64_t *item_indexes,
+                        int count,
+                        apr_pool_t *scratch_pool)
+{
+  int i;
+
+  if (count == 0)
+    return SVN_NO_ERROR;
+
+  if (svn_fs_fs__use_log_addressing(fs))
+    {
+      /* batched index lookup */
+      SVN_ERR(l2p_index_lookup_batch(absolute_positions, fs, rev_file,
+                                     revision, item_indexes, count,
+                                     scratch_pool));
+    }
+  else
+    {
+      /* with physical addressing, item indexes are offsets relative to
+         the start of the revision within the rev / pack file */
+      apr_off_t rev_offset = 0;
+      if (rev_file->is_packed)
+        SVN_ERR(svn_fs_fs__get_packed_offset(&rev_offset, fs, revision,
+                                             scratch_pool));
+
+      for (i = 0; i < count; ++i)
+        absolute_positions[i] = rev_offset + (apr_off_t)item_indexes[i];
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /*
  * phys-to-log index
  */
@@ -2138,7 +2355,7 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
 
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
-                                 rev_file->file,
+                                 rev_file,
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
@@ -3100,8 +3317,7 @@ calc_fnv1(svn_fs_fs__p2l_entry_t *entry,
 {
   unsigned char buffer[4096];
   svn_checksum_t *checksum;
-  svn_checksum_ctx_t *context
-    = svn_checksum_ctx_create(svn_checksum_fnv1a_32x4, scratch_pool);
+  svn_checksum_ctx_t *context;
   apr_off_t size = entry->size;
 
   /* Special rules apply to unused sections / items.  The data must be a
@@ -3113,16 +3329,26 @@ calc_fnv1(svn_fs_fs__p2l_entry_t *entry,
       return SVN_NO_ERROR;
     }
 
+  /* Mapped files can be checksummed directly, without any context. */
+  if (rev_file->data && entry->offset + size <= rev_file->data_size)
+    {
+      entry->fnv1_checksum = svn__fnv1a_32x4(rev_file->data + entry->offset,
+                                             (apr_size_t)size);
+      return SVN_NO_ERROR;
+    }
+
   /* Read the block and feed it to the checksum calculator. */
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &entry->offset,
-                           scratch_pool));
+  context = svn_checksum_ctx_create(svn_checksum_fnv1a_32x4, scratch_pool);
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, entry->offset,
+                                   scratch_pool));
+
   while (size > 0)
     {
       apr_size_t to_read = size > sizeof(buffer)
                          ? sizeof(buffer)
                          : (apr_size_t)size;
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, to_read, NULL,
-                                     NULL, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, to_read, NULL,
+                                       scratch_pool));
       SVN_ERR(svn_checksum_update(context, buffer, to_read));
       size -= to_read;
     }
@@ -200,6 +200,27 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
                        apr_uint64_t item_index,
                        apr_pool_t *scratch_pool);
 
+/* For the COUNT items ITEM_INDEXES within the committed revision REVISION
+ * in FS, return the positions in the respective rev or pack file in the
+ * corresponding elements of ABSOLUTE_POSITIONS.  The latter must be
+ * provided by the caller.
+ *
+ * This is equivalent to calling svn_fs_fs__item_offset for every item but
+ * fetches the index header only once and processes every index page in a
+ * single pass.  ITEM_INDEXES should therefore be sorted.
+ *
+ * REV_FILE determines whether to access single rev or pack file data.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *absolute_positions,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        svn_revnum_t revision,
+                        const apr_uint64_t *item_indexes,
+                        int count,
+                        apr_pool_t *scratch_pool);
+
 /* Use the log-to-phys indexes in FS to determine the maximum item indexes
  * assigned to revision START_REV to START_REV + COUNT - 1.  That is a
  * close upper limit to the actual number of items in the respective revs.
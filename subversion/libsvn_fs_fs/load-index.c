@@ -20,6 +20,7 @@
  * ====================================================================
  */
 
+#include "svn_dirent_uri.h"
 #include "svn_pools.h"
 
 #include "private/svn_sorts_private.h"
@@ -29,6 +30,8 @@
 #include "util.h"
 #include "transaction.h"
 
+#include "../libsvn_fs/fs-loader.h"
+
 /* From the ENTRIES array of svn_fs_fs__p2l_entry_t*, sorted by offset,
  * return the first offset behind the last item. */
 static apr_off_t
@@ -93,12 +96,42 @@ compare_p2l_entry_revision(const void *lhs,
   return lhs_entry->offset == rhs_entry->offset ? 0 : 1;
 }
 
+/* Copy the first SIZE bytes of REV_FILE to the current position in
+ * TARGET.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+copy_data(apr_file_t *target,
+          svn_fs_fs__revision_file_t *rev_file,
+          apr_off_t size,
+          apr_pool_t *scratch_pool)
+{
+  char *buffer = apr_palloc(scratch_pool, SVN__STREAM_CHUNK_SIZE);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 0, scratch_pool));
+  while (size > 0)
+    {
+      apr_size_t to_copy = (apr_size_t)MIN(size, SVN__STREAM_CHUNK_SIZE);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, to_copy, NULL,
+                                       iterpool));
+      SVN_ERR(svn_io_file_write_full(target, buffer, to_copy, NULL,
+                                     iterpool));
+      size -= to_copy;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__load_index(svn_fs_t *fs,
                       svn_revnum_t revision,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_pool_t *subpool = svn_pool_create(scratch_pool);
 
   /* Check the FS format number. */
@@ -114,17 +147,22 @@ svn_fs_fs__load_index(svn_fs_t *fs,
     {
       const char *l2p_proto_index;
       const char *p2l_proto_index;
+      const char *path;
+      const char *temp_path;
+      apr_file_t *temp_file;
       svn_fs_fs__revision_file_t *rev_file;
       svn_error_t *err;
       apr_off_t max_covered = get_max_covered(entries);
+      apr_off_t data_size;
 
       /* Ensure that the index data is complete. */
       SVN_ERR(check_all_covered(entries, scratch_pool));
 
-      /* Open rev / pack file & trim indexes + footer off it. */
-      SVN_ERR(svn_fs_fs__open_pack_or_rev_file_writable(&rev_file, fs,
-                                                        revision, subpool,
-                                                        subpool));
+      /* Open rev / pack file to find the part before the indexes + footer.
+       * Readers may have the file mapped into memory, so we must never
+       * truncate it in place.  Write a new file and replace the old one. */
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
+                                               subpool, subpool));
 
       /* Remove the existing index info. */
       err = svn_fs_fs__auto_read_footer(rev_file);
@@ -133,8 +171,7 @@ svn_fs_fs__load_index(svn_fs_t *fs,
           /* Even the index footer cannot be read, even less be trusted.
            * Take the range of valid data from the new index data. */
           svn_error_clear(err);
-          SVN_ERR(svn_io_file_trunc(rev_file->file, max_covered,
-                                    subpool));
+          data_size = max_covered;
         }
       else
         {
@@ -149,10 +186,19 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                        apr_psprintf(scratch_pool, "%" APR_UINT64_T_HEX_FMT,
                                     (apr_uint64_t) rev_file->l2p_offset));
 
-          SVN_ERR(svn_io_file_trunc(rev_file->file, rev_file->l2p_offset,
-                                    subpool));
+          data_size = rev_file->l2p_offset;
         }
 
+      /* Copy the revision contents without the old index data into a
+       * temporary file next to the original (will be cleaned up
+       * automatically with SUBPOOL unless moved into place). */
+      path = svn_fs_fs__path_rev_absolute(fs, revision, subpool);
+      SVN_ERR(svn_io_open_unique_file3(&temp_file, &temp_path,
+                                       svn_dirent_dirname(path, subpool),
+                                       svn_io_file_del_on_pool_cleanup,
+                                       subpool, subpool));
+      SVN_ERR(copy_data(temp_file, rev_file, data_size, subpool));
+
       /* Create proto index files for the new index data
        * (will be cleaned up automatically with iterpool). */
       SVN_ERR(svn_fs_fs__p2l_index_from_p2l_entries(&p2l_proto_index, fs,
@@ -161,11 +207,19 @@ svn_fs_fs__load_index(svn_fs_t *fs,
       SVN_ERR(svn_fs_fs__l2p_index_from_p2l_entries(&l2p_proto_index, fs,
                                                     entries, subpool,
                                                     subpool));
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
 
       /* Combine rev data with new index data. */
-      SVN_ERR(svn_fs_fs__add_index_data(fs, rev_file->file, l2p_proto_index,
+      SVN_ERR(svn_fs_fs__add_index_data(fs, temp_file, l2p_proto_index,
                                         p2l_proto_index,
                                         rev_file->start_revision, subpool));
+      SVN_ERR(svn_io_file_close(temp_file, subpool));
+
+      /* Atomically replace the old file.  Readers that still have it
+       * open or mapped continue to see the old contents. */
+      SVN_ERR(svn_fs_fs__move_into_place(temp_path, path, path,
+                                         ffd->flush_to_disk, subpool));
+      SVN_ERR(svn_io_set_file_read_only(path, FALSE, subpool));
     }
 
   svn_pool_destroy(subpool);
@@ -61,6 +61,7 @@
 /* Kinds of representation. */
 #define REP_PLAIN          "PLAIN"
 #define REP_DELTA          "DELTA"
+#define REP_CHUNKED        "CHUNKED"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -1273,6 +1274,12 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
+  if (strcmp(buffer->data, REP_CHUNKED) == 0)
+    {
+      (*header)->type = svn_fs_fs__rep_chunked;
+      return SVN_NO_ERROR;
+    }
+
   (*header)->type = svn_fs_fs__rep_delta;
 
   /* We have hopefully a DELTA vs. a non-empty base revision. */
@@ -1319,6 +1326,10 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
         text = REP_DELTA "\n";
         break;
 
+      case svn_fs_fs__rep_chunked:
+        text = REP_CHUNKED "\n";
+        break;
+
       default:
         text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
                                           " %" SVN_FILESIZE_T_FMT "\n",
@@ -1328,3 +1339,71 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
 
   return svn_error_trace(svn_stream_puts(stream, text));
 }
+
+svn_error_t *
+svn_fs_fs__parse_chunk_list(apr_array_header_t **chunks,
+                            const svn_string_t *text,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  char *last_line = apr_pstrmemdup(scratch_pool, text->data, text->len);
+  char *line;
+
+  *chunks = apr_array_make(result_pool, (int)(text->len / 32 + 1),
+                           sizeof(representation_t *));
+
+  /* Each line is "<revision> <item index> <size> <expanded size>". */
+  while ((line = svn_cstring_tokenize("\n", &last_line)))
+    {
+      representation_t *chunk = apr_pcalloc(result_pool, sizeof(*chunk));
+      char *last_str = line;
+      char *str;
+      apr_int64_t val;
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(parse_revnum(&chunk->revision, (const char **)&str));
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_cstring_atoi64(&val, str));
+      chunk->item_index = (apr_uint64_t)val;
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_cstring_atoi64(&val, str));
+      chunk->size = (svn_filesize_t)val;
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_cstring_atoi64(&val, str));
+      chunk->expanded_size = (svn_filesize_t)val;
+
+      APR_ARRAY_PUSH(*chunks, representation_t *) = chunk;
+    }
+
+  return SVN_NO_ERROR;
+
+ error:
+  return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                          _("Malformed chunk list"));
+}
+
+svn_error_t *
+svn_fs_fs__write_chunk_list_entry(svn_stream_t *stream,
+                                  svn_revnum_t revision,
+                                  const representation_t *chunk,
+                                  apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_stream_printf(stream, scratch_pool,
+                                           "%ld %" APR_UINT64_T_FMT
+                                           " %" SVN_FILESIZE_T_FMT
+                                           " %" SVN_FILESIZE_T_FMT "\n",
+                                           revision, chunk->item_index,
+                                           chunk->size,
+                                           chunk->expanded_size));
+}
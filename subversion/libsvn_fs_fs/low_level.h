@@ -36,7 +36,8 @@
  * - changed path list
  * - node revision
  * - representation (as in "text:" and "props:" lines)
- * - representation header ("PLAIN" and "DELTA" lines)
+ * - representation header ("PLAIN", "DELTA" and "CHUNKED" lines)
+ * - chunk list (contents of "CHUNKED" representations)
  */
 
 /* Given the last "few" bytes (should be at least 40) of revision REV in
@@ -189,7 +190,11 @@ typedef enum svn_fs_fs__rep_type_t
   svn_fs_fs__rep_self_delta,
 
   /* this is a DELTA representation against some base representation */
-  svn_fs_fs__rep_delta
+  svn_fs_fs__rep_delta,
+
+  /* this is a CHUNKED representation, i.e. a list of chunk representations
+   * whose contents need to be concatenated */
+  svn_fs_fs__rep_chunked
 } svn_fs_fs__rep_type_t;
 
 /* This structure is used to hold the information stored in a representation
@@ -233,3 +238,26 @@ svn_error_t *
 svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
                             svn_stream_t *stream,
                             apr_pool_t *scratch_pool);
+
+/* Parse the contents of a CHUNKED representation in TEXT and return the
+ * chunk representations in *CHUNKS as an array of representation_t *.
+ * Only the REVISION, ITEM_INDEX, SIZE and EXPANDED_SIZE members will be
+ * set.  The REVISION will be SVN_INVALID_REVNUM for chunks that are
+ * stored in the same revision as the chunk list.  Allocate the result in
+ * RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__parse_chunk_list(apr_array_header_t **chunks,
+                            const svn_string_t *text,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Write CHUNK as the next entry of a chunk list to STREAM.  Use
+ * SVN_INVALID_REVNUM as REVISION for chunks that are stored in the same
+ * revision (or transaction) as the chunk list.
+ * Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__write_chunk_list_entry(svn_stream_t *stream,
+                                  svn_revnum_t revision,
+                                  const representation_t *chunk,
+                                  apr_pool_t *scratch_pool);
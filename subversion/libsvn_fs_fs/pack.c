@@ -30,6 +30,8 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_task.h"
+#include "private/svn_delta_private.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -39,6 +41,7 @@
 #include "low_level.h"
 #include "revprops.h"
 #include "transaction.h"
+#include "compression_dict.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -221,6 +224,11 @@ typedef struct pack_context_t
    * to NULL that we already processed. */
   apr_array_header_t *reps;
 
+  /* array of svn_fs_fs__id_part_t, the chunks referenced by the chunk
+   * lists within the current revision range.  Will be filled in phase 2
+   * and be cleared after each revision range. */
+  apr_array_header_t *chunks;
+
   /* array of int, marking for each revision, at which offset their items
    * begin in REPS.  Will be filled in phase 2 and be cleared after
    * each revision range. */
@@ -236,6 +244,14 @@ typedef struct pack_context_t
 
   /* ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
+
+  /* array of svn_string_t *, samples of small representation contents to
+   * train the shard's compression dictionary with.  NULL if compression
+   * dictionaries are disabled.  Lives as long as the whole context. */
+  apr_array_header_t *dict_samples;
+
+  /* number of bytes that we still may add to DICT_SAMPLES */
+  apr_size_t dict_sample_budget;
 } pack_context_t;
 
 /* Create and initialize a new pack context for packing shard SHARD_REV in
@@ -331,9 +347,20 @@ initialize_pack_context(pack_context_t *context,
                                        sizeof(reference_t *));
   context->reps = apr_array_make(pool, max_items,
                                  sizeof(svn_fs_fs__p2l_entry_t *));
+  context->chunks = apr_array_make(pool, 16, sizeof(svn_fs_fs__id_part_t));
   SVN_ERR(svn_io_open_unique_file3(&context->reps_file, NULL, temp_dir,
                                    svn_io_file_del_on_close, pool, pool));
 
+  /* samples for the compression dictionary, if enabled */
+  if (ffd->compression_dict_size)
+    {
+      context->dict_samples = apr_array_make(pool, 64,
+                                             sizeof(svn_string_t *));
+      context->dict_sample_budget
+        = (apr_size_t)ffd->compression_dict_size
+        * SVN_FS_FS__DICT_SAMPLE_FACTOR;
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -357,6 +384,7 @@ reset_pack_context(pack_context_t *context,
   apr_array_clear(context->path_order);
   apr_array_clear(context->references);
   apr_array_clear(context->reps);
+  apr_array_clear(context->chunks);
   SVN_ERR(svn_io_file_close(context->reps_file, pool));
 
   svn_pool_clear(context->info_pool);
@@ -580,6 +608,134 @@ get_item(pack_context_t *context,
   return result;
 }
 
+/* Add DATA of LEN bytes to the dictionary samples in CONTEXT unless that
+ * would exceed the sample budget.
+ */
+static void
+add_dict_sample(pack_context_t *context,
+                const char *data,
+                apr_size_t len)
+{
+  apr_pool_t *pool = context->dict_samples->pool;
+
+  if (len == 0 || len > context->dict_sample_budget)
+    return;
+
+  APR_ARRAY_PUSH(context->dict_samples, svn_string_t *)
+    = svn_string_ncreate(data, len, pool);
+  context->dict_sample_budget -= len;
+}
+
+/* Add the contents of the representation ITEM with the parsed HEADER to
+ * the dictionary samples in CONTEXT.  ITEM is the on-disk data including
+ * header and trailer.  For deltified representations, only the new data
+ * in the svndiff windows is used.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+add_dict_samples(pack_context_t *context,
+                 const svn_stringbuf_t *item,
+                 const svn_fs_fs__rep_header_t *header,
+                 apr_pool_t *scratch_pool)
+{
+  static const char trailer[] = "ENDREP\n";
+  svn_string_t contents;
+  svn_stream_t *stream;
+  apr_pool_t *iterpool;
+  svn_boolean_t available;
+  int version;
+
+  if (item->len < header->header_size + sizeof(trailer) - 1)
+    return SVN_NO_ERROR;
+
+  contents.data = item->data + header->header_size;
+  contents.len = item->len - header->header_size - (sizeof(trailer) - 1);
+
+  if (header->type == svn_fs_fs__rep_plain)
+    {
+      add_dict_sample(context, contents.data, contents.len);
+      return SVN_NO_ERROR;
+    }
+
+  /* Deltified data starts with the svndiff header. */
+  if (   contents.len < 4
+      || memcmp(contents.data, "SVN", 3) != 0
+      || contents.data[3] > 4)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed svndiff data in representation"));
+
+  version = contents.data[3];
+  contents.data += 4;
+  contents.len -= 4;
+
+  iterpool = svn_pool_create(scratch_pool);
+  stream = svn_stream_from_string(&contents, scratch_pool);
+  SVN_ERR(svn_stream_data_available(stream, &available));
+  while (available && context->dict_sample_budget)
+    {
+      svn_txdelta_window_t *window;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_txdelta__read_svndiff_window_dict(
+                &window, stream, version, svn_fs_fs__get_compression_dict,
+                context->fs, iterpool));
+      if (window->new_data)
+        add_dict_sample(context, window->new_data->data,
+                        window->new_data->len);
+
+      SVN_ERR(svn_stream_data_available(stream, &available));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the chunk list representation ITEM of REVISION with the parsed
+ * HEADER and append the IDs of all chunks in the current revision range
+ * to CONTEXT->CHUNKS.  ITEM is the on-disk data including header and
+ * trailer.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+add_chunk_references(pack_context_t *context,
+                     svn_revnum_t revision,
+                     const svn_stringbuf_t *item,
+                     const svn_fs_fs__rep_header_t *header,
+                     apr_pool_t *scratch_pool)
+{
+  static const char trailer[] = "ENDREP\n";
+  svn_string_t contents;
+  apr_array_header_t *chunks;
+  int i;
+
+  if (item->len < header->header_size + sizeof(trailer) - 1)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed chunk list"));
+
+  contents.data = item->data + header->header_size;
+  contents.len = item->len - header->header_size - (sizeof(trailer) - 1);
+  SVN_ERR(svn_fs_fs__parse_chunk_list(&chunks, &contents, scratch_pool,
+                                      scratch_pool));
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const representation_t *chunk
+        = APR_ARRAY_IDX(chunks, i, const representation_t *);
+      svn_fs_fs__id_part_t *id = apr_array_push(context->chunks);
+
+      id->revision = SVN_IS_VALID_REVNUM(chunk->revision)
+                   ? chunk->revision
+                   : revision;
+      id->number = chunk->item_index;
+
+      /* Chunks from earlier revision ranges have already been placed. */
+      if (id->revision < context->start_rev)
+        apr_array_pop(context->chunks);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy representation item identified by ENTRY from the current position
  * in REV_FILE into CONTEXT->REPS_FILE.  Add all tracking into needed by
  * our placement algorithm to CONTEXT.  Use POOL for temporary allocations.
@@ -619,8 +775,33 @@ copy_rep_to_temp(pack_context_t *context,
 
   /* copy the whole rep (including header!) to our temp file */
   SVN_ERR(svn_io_file_seek(rev_file, APR_SET, &source_offset, pool));
-  SVN_ERR(copy_file_data(context, context->reps_file, rev_file, entry->size,
-                         pool));
+  if (   rep_header->type == svn_fs_fs__rep_chunked
+      || (   context->dict_samples
+          && context->dict_sample_budget
+          && entry->size <= SVN_FS_FS__DICT_SAMPLE_ITEM_SIZE))
+    {
+      /* chunk list or small rep: keep the data for the chunk tracking
+       * and the dictionary training, respectively */
+      apr_size_t size = (apr_size_t)entry->size;
+      svn_stringbuf_t *item = svn_stringbuf_create_ensure(size, pool);
+
+      SVN_ERR(svn_io_file_read_full2(rev_file, item->data, size,
+                                     NULL, NULL, pool));
+      item->len = size;
+      item->data[size] = '\0';
+      SVN_ERR(svn_io_file_write_full(context->reps_file, item->data, size,
+                                     NULL, pool));
+      if (rep_header->type == svn_fs_fs__rep_chunked)
+        SVN_ERR(add_chunk_references(context, entry->item.revision, item,
+                                     rep_header, pool));
+      else
+        SVN_ERR(add_dict_samples(context, item, rep_header, pool));
+    }
+  else
+    {
+      SVN_ERR(copy_file_data(context, context->reps_file, rev_file,
+                             entry->size, pool));
+    }
 
   return SVN_NO_ERROR;
 }
@@ -739,7 +920,9 @@ copy_node_to_temp(pack_context_t *context,
   const char *sort_path;
   apr_off_t source_offset = entry->offset;
 
-  /* read & parse noderev */
+  /* read & parse noderev.  Position the stream explicitly as it may not
+   * be using the file pointer of REV_FILE. */
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, source_offset, pool));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev, rev_file->stream, pool, pool));
 
   /* create a copy of ENTRY, make it point to the copy destination and
@@ -1244,6 +1427,23 @@ copy_reps_from_temp(pack_context_t *context,
         SVN_ERR(store_item(context, temp_file, node_part, iterpool));
     }
 
+  /* copy the chunks of large files.  No noderev refers to them directly
+     but the chunk lists do.  Chunks that have already been copied or that
+     are shared by multiple chunk lists will not be found a second time.
+     Other representations without a noderev are unused and get dropped. */
+  for (i = 0; i < context->chunks->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *rep_part
+        = get_item(context,
+                   &APR_ARRAY_IDX(context->chunks, i, svn_fs_fs__id_part_t),
+                   TRUE);
+
+      svn_pool_clear(iterpool);
+
+      if (rep_part)
+        SVN_ERR(store_item(context, temp_file, rep_part, iterpool));
+    }
+
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1631,6 +1831,19 @@ pack_log_addressed(svn_fs_t *fs,
   /* last phase: finalize indexes and clean up */
   SVN_ERR(reset_pack_context(&context, iterpool));
   SVN_ERR(close_pack_context(&context, iterpool));
+
+  /* train the compression dictionary for the shard */
+  if (context.dict_samples)
+    {
+      fs_fs_data_t *ffd = fs->fsap_data;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__write_compression_dict(fs, pack_file_dir,
+                                        shard_rev / ffd->max_files_per_dir,
+                                        context.dict_samples, flush_to_disk,
+                                        iterpool));
+    }
+
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1865,12 +2078,16 @@ struct pack_baton
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
   size_t max_mem;
+  int jobs;
 
   /* Additional entries valid when entering pack_shard(). */
   const char *revs_dir;
   const char *revsprops_dir;
   apr_int64_t shard;
 
+  /* When packing in parallel, the first shard to pack. */
+  apr_int64_t first_shard;
+
   /* Additional entries valid when entering synced_pack_shard(). */
   const char *rev_shard_path;
 };
@@ -1957,6 +2174,54 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Set *PACK_FILE_DIR and *SHARD_PATH to the locations of the packed and
+ * the non-packed revision data of SHARD in REVS_DIR.  Allocate them in
+ * POOL.
+ */
+static void
+get_rev_shard_paths(const char **pack_file_dir,
+                    const char **shard_path,
+                    const char *revs_dir,
+                    apr_int64_t shard,
+                    apr_pool_t *pool)
+{
+  *pack_file_dir = svn_dirent_join(revs_dir,
+                  apr_psprintf(pool,
+                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                               shard),
+                  pool);
+  *shard_path = svn_dirent_join(revs_dir,
+                                apr_psprintf(pool, "%" APR_INT64_T_FMT, shard),
+                                pool);
+}
+
+/* Switch the shard described by BATON over to the packed revision data,
+ * which must already be complete, and pack its revprops.  Notify the
+ * caller about the completed shard.
+ */
+static svn_error_t *
+switch_to_packed_shard(struct pack_baton *baton,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  /* Notify caller we're starting to pack this shard. */
+  if (baton->notify_func)
+    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
+                               svn_fs_pack_notify_end, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1975,16 +2240,8 @@ pack_shard(struct pack_baton *baton,
                                svn_fs_pack_notify_start, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  get_rev_shard_paths(&rev_pack_file_dir, &baton->rev_shard_path,
+                      baton->revs_dir, baton->shard, pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -1992,23 +2249,142 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  return svn_error_trace(switch_to_packed_shard(baton, pool));
+}
 
-  /* Notify caller we're starting to pack this shard. */
-  if (baton->notify_func)
-    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_end, pool));
+/* Implements svn_task__thread_context_func_t.  Our svn_fs_t objects are
+ * not thread-safe, so every worker thread gets its own instance of the
+ * filesystem given by the pack_baton BATON.
+ */
+static svn_error_t *
+open_pack_worker_fs(void **thread_context,
+                    void *baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  struct pack_baton *pb = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_fs__open_instance(&fs, pb->fs, result_pool, scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* A shard to pack in a worker thread, as passed to svn_task__queue_push().
+ */
+typedef struct pack_shard_item_t
+{
+  /* The overall pack operation.  Only the members that remain constant
+   * while packing get accessed by the worker threads. */
+  struct pack_baton *pb;
+
+  /* The shard to write the pack file for. */
+  apr_int64_t shard;
+} pack_shard_item_t;
+
+/* Implements svn_task__process_func_t.  Write the pack file for the
+ * pack_shard_item_t BATON, reading the revision data through the
+ * filesystem instance given as THREAD_CONTEXT.
+ */
+static svn_error_t *
+pack_rev_shard_task(void **result,
+                    void *baton,
+                    void *thread_context,
+                    apr_int64_t index,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  pack_shard_item_t *item = baton;
+  struct pack_baton *pb = item->pb;
+  svn_fs_t *fs = thread_context;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *rev_pack_file_dir, *rev_shard_path;
 
+  get_rev_shard_paths(&rev_pack_file_dir, &rev_shard_path, pb->revs_dir,
+                      item->shard, scratch_pool);
+
+  /* All workers share the memory budget. */
+  SVN_ERR(pack_rev_shard(fs, rev_pack_file_dir, rev_shard_path, item->shard,
+                         ffd->max_files_per_dir, pb->max_mem / pb->jobs,
+                         ffd->flush_to_disk, pb->cancel_func,
+                         pb->cancel_baton, scratch_pool));
+
+  *result = NULL;
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_task__output_func_t.  The pack file for shard number
+ * INDEX, counted from the first shard to pack, is complete.  Switch the
+ * repository over to it.  BATON is the pack_baton.
+ */
+static svn_error_t *
+switch_to_packed_shard_task(void *baton,
+                            void *result,
+                            apr_int64_t index,
+                            apr_pool_t *scratch_pool)
+{
+  struct pack_baton *pb = baton;
+  const char *rev_pack_file_dir;
+
+  pb->shard = pb->first_shard + index;
+  get_rev_shard_paths(&rev_pack_file_dir, &pb->rev_shard_path,
+                      pb->revs_dir, pb->shard, scratch_pool);
+
+  return svn_error_trace(switch_to_packed_shard(pb, scratch_pool));
+}
+
+/* Pack shards BATON->SHARD to COMPLETED_SHARDS - 1 using up to
+ * BATON->JOBS worker threads.  The pack files get written concurrently
+ * while the notifications and the min-unpacked-rev updates happen
+ * strictly in order from the calling thread.  As with pack_shard, the
+ * start notification for a shard gets sent before its pack file is being
+ * written.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+pack_shards_in_parallel(struct pack_baton *baton,
+                        apr_int64_t completed_shards,
+                        apr_pool_t *scratch_pool)
+{
+  apr_pool_t *queue_pool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_task__queue_t *queue;
+  apr_int64_t shard;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  baton->first_shard = baton->shard;
+  SVN_ERR(svn_task__queue_create(&queue, baton->jobs, pack_rev_shard_task,
+                                 open_pack_worker_fs, baton,
+                                 switch_to_packed_shard_task, baton,
+                                 baton->cancel_func, baton->cancel_baton,
+                                 queue_pool));
+
+  for (shard = baton->first_shard; shard < completed_shards && !err; ++shard)
+    {
+      pack_shard_item_t *item = apr_pcalloc(scratch_pool, sizeof(*item));
+
+      svn_pool_clear(iterpool);
+
+      item->pb = baton;
+      item->shard = shard;
+
+      if (baton->notify_func)
+        err = baton->notify_func(baton->notify_baton, shard,
+                                 svn_fs_pack_notify_start, iterpool);
+      if (!err)
+        err = svn_task__queue_push(queue, item, iterpool);
+    }
+
+  if (!err)
+    err = svn_task__queue_finish(queue, iterpool);
+
+  /* Upon failure, this stops the workers and discards pending items. */
+  svn_pool_destroy(queue_pool);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2080,10 +2456,13 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+  if (pb->jobs > 1 && completed_shards - pb->shard > 1)
+    return svn_error_trace(pack_shards_in_parallel(pb, completed_shards,
+                                                   pool));
+
   iterpool = svn_pool_create(pool);
-  for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
-       pb->shard < completed_shards;
-       pb->shard++)
+  for (; pb->shard < completed_shards; pb->shard++)
     {
       svn_pool_clear(iterpool);
 
@@ -2100,6 +2479,7 @@ pack_body(void *baton,
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
+                int jobs,
                 svn_fs_pack_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
@@ -2146,6 +2526,7 @@ svn_fs_fs__pack(svn_fs_t *fs,
   pb.cancel_func = cancel_func;
   pb.cancel_baton = cancel_baton;
   pb.max_mem = max_mem ? max_mem : DEFAULT_MAX_MEM;
+  pb.jobs = MAX(jobs, 1);
 
   if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
     {
@@ -32,6 +32,10 @@
    MAX_MEM limits the size of in-memory data structures needed for reordering
    items in format 7 repositories.  0 means use the built-in default.
 
+   If JOBS is larger than 1, write the pack files of up to JOBS shards
+   concurrently.  MAX_MEM is then split evenly between them.  The shards
+   will still be switched over to the packed data in order.
+
    If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress.
    Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
 
@@ -39,6 +43,7 @@
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
+                int jobs,
                 svn_fs_pack_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
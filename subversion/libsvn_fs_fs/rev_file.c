@@ -28,6 +28,9 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
 #include "private/svn_io_private.h"
 #include "svn_private_config.h"
 
@@ -46,6 +49,10 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
+  file->data = NULL;
+  file->data_size = 0;
+  file->data_position = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -120,6 +127,130 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_MMAP
+
+/* Mark type used by the mapped revision file stream. */
+typedef struct mapped_mark_t
+{
+  apr_off_t position;
+} mapped_mark_t;
+
+/* Implements svn_read_fn_t for streams on the memory mapped
+ * svn_fs_fs__revision_file_t given as BATON. */
+static svn_error_t *
+mapped_read(void *baton,
+            char *buffer,
+            apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t left = file->data_size - file->data_position;
+
+  if (left <= 0)
+    *len = 0;
+  else if (*len > left)
+    *len = (apr_size_t)left;
+
+  memcpy(buffer, file->data + file->data_position, *len);
+  file->data_position += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for streams on the memory mapped
+ * svn_fs_fs__revision_file_t given as BATON. */
+static svn_error_t *
+mapped_skip(void *baton,
+            apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->data_position = MIN(file->data_position + (apr_off_t)len,
+                            file->data_size);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_mark_fn_t for streams on the memory mapped
+ * svn_fs_fs__revision_file_t given as BATON. */
+static svn_error_t *
+mapped_mark(void *baton,
+            svn_stream_mark_t **mark,
+            apr_pool_t *pool)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  mapped_mark_t *mapped_mark = apr_palloc(pool, sizeof(*mapped_mark));
+
+  mapped_mark->position = file->data_position;
+  *mark = (svn_stream_mark_t *)mapped_mark;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_seek_fn_t for streams on the memory mapped
+ * svn_fs_fs__revision_file_t given as BATON. */
+static svn_error_t *
+mapped_seek(void *baton,
+            const svn_stream_mark_t *mark)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->data_position = mark
+                      ? ((const mapped_mark_t *)mark)->position
+                      : 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_data_available_fn_t for streams on the memory
+ * mapped svn_fs_fs__revision_file_t given as BATON. */
+static svn_error_t *
+mapped_data_available(void *baton,
+                      svn_boolean_t *data_available)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  *data_available = file->data_position < file->data_size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Map the contents of the already opened FILE into memory and make its
+ * stream read from there.  If that is not possible, e.g. because FILE
+ * is empty or we ran out of address space, silently keep using normal
+ * file access.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+map_revision_file(svn_fs_fs__revision_file_t *file,
+                  apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_mmap_t *mmap;
+  apr_status_t status;
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file->file,
+                               scratch_pool));
+  if (finfo.size == 0 || (apr_uint64_t)finfo.size > APR_SIZE_MAX)
+    return SVN_NO_ERROR;
+
+  status = apr_mmap_create(&mmap, file->file, 0, (apr_size_t)finfo.size,
+                           APR_MMAP_READ, file->pool);
+  if (status)
+    return SVN_NO_ERROR;
+
+  file->mmap = mmap;
+  file->data = mmap->mm;
+  file->data_size = finfo.size;
+  file->data_position = 0;
+
+  file->stream = svn_stream_create(file, file->pool);
+  svn_stream_set_read2(file->stream, mapped_read, mapped_read);
+  svn_stream_set_skip(file->stream, mapped_skip);
+  svn_stream_set_mark(file->stream, mapped_mark);
+  svn_stream_set_seek(file->stream, mapped_seek);
+  svn_stream_set_data_available(file->stream, mapped_data_available);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,6 +291,12 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+#if APR_HAS_MMAP
+          /* Files opened for writing may change underneath the mapping. */
+          if (ffd->use_mmap && !writable)
+            SVN_ERR(map_revision_file(file, scratch_pool));
+#endif
+
           return SVN_NO_ERROR;
         }
 
@@ -237,22 +374,22 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       svn_stringbuf_t *footer;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_size(&filesize, file, file->pool));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, filesize - 1,
+                                       file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, &footer_length,
+                                       sizeof(footer_length), NULL,
+                                       file->pool));
 
       /* Read footer. */
       footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL,
                                        filesize - 1 - footer_length,
                                        file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, footer->data, footer_length,
+                                       &footer->len, file->pool));
       footer->data[footer->len] = '\0';
 
       /* Extract index locations. */
@@ -274,6 +411,7 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *apr_file;
   SVN_ERR(svn_io_file_open(&apr_file,
                            svn_fs_fs__path_txn_proto_rev(fs, txn_id,
@@ -286,6 +424,8 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   (*file)->is_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ffd->block_size;
+  (*file)->pool = result_pool;
 
   return SVN_NO_ERROR;
 }
@@ -295,13 +435,142 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      apr_status_t status = apr_mmap_delete(file->mmap);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap revision file"));
+    }
+#endif
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
+  file->data = NULL;
+  file->data_size = 0;
+  file->data_position = 0;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
 
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset,
+                         apr_pool_t *pool)
+{
+  if (file->data)
+    {
+      if (buffer_start)
+        *buffer_start = file->block_size
+                      ? offset - offset % file->block_size
+                      : offset;
+
+      file->data_position = offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file)
+{
+  if (file->data)
+    {
+      *offset = file->data_position;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_get_offset(offset, file->file,
+                                                file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_size(apr_off_t *size,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_pool_t *pool)
+{
+  if (file->data)
+    {
+      *size = file->data_size;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_size_get(size, file->file, pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes,
+                         apr_size_t *bytes_read,
+                         apr_pool_t *pool)
+{
+  if (file->data)
+    {
+      apr_off_t left = file->data_size - file->data_position;
+      apr_size_t to_copy = left <= 0 ? 0 : (apr_size_t)MIN(left, nbytes);
+
+      if (to_copy < nbytes && !bytes_read)
+        {
+          const char *name;
+          SVN_ERR(svn_io_file_name_get(&name, file->file, pool));
+          return svn_error_wrap_apr(APR_EOF, _("Can't read file '%s'"),
+                                    svn_dirent_local_style(name, pool));
+        }
+
+      memcpy(buf, file->data + file->data_position, to_copy);
+      file->data_position += to_copy;
+      if (bytes_read)
+        *bytes_read = to_copy;
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buf, nbytes,
+                                                bytes_read, NULL, pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_get_data(const char **data,
+                             svn_fs_fs__revision_file_t *file,
+                             apr_size_t nbytes,
+                             apr_pool_t *result_pool)
+{
+  char *buffer;
+
+  if (file->data)
+    {
+      if (file->data_position < 0
+          || (apr_off_t)nbytes > file->data_size - file->data_position)
+        {
+          const char *name;
+          SVN_ERR(svn_io_file_name_get(&name, file->file, result_pool));
+          return svn_error_wrap_apr(APR_EOF, _("Can't read file '%s'"),
+                                    svn_dirent_local_style(name,
+                                                           result_pool));
+        }
+
+      *data = file->data + file->data_position;
+      file->data_position += nbytes;
+
+      return SVN_NO_ERROR;
+    }
+
+  buffer = apr_palloc(result_pool, nbytes);
+  SVN_ERR(svn_io_file_read_full2(file->file, buffer, nbytes, NULL, NULL,
+                                 result_pool));
+  *data = buffer;
+
+  return SVN_NO_ERROR;
+}
@@ -23,6 +23,8 @@
 #ifndef SVN_LIBSVN_FS__REV_FILE_H
 #define SVN_LIBSVN_FS__REV_FILE_H
 
+#include <apr_mmap.h>
+
 #include "svn_fs.h"
 #include "id.h"
 
@@ -54,9 +56,28 @@ typedef struct svn_fs_fs__revision_file_t
   /* rev / pack file */
   apr_file_t *file;
 
-  /* stream based on FILE and not NULL exactly when FILE is not NULL */
+  /* stream based on FILE and not NULL exactly when FILE is not NULL.
+   * If DATA is not NULL, it reads from there instead of FILE. */
   svn_stream_t *stream;
 
+  /* If not NULL, FILE has been mapped into memory in its entirety.
+   * Only ever set for committed, i.e. immutable, revisions.  Those never
+   * get truncated in place - svn_fs_fs__load_index replaces the whole
+   * file instead - so the mapping stays valid until FILE gets closed.
+   * See ffd->use_mmap. */
+  apr_mmap_t *mmap;
+
+  /* The mapped contents of FILE or NULL if MMAP is NULL.  All reads will
+   * be served from here and the file pointer of FILE becomes meaningless.
+   */
+  const char *data;
+
+  /* Number of bytes in DATA.  0 if DATA is NULL. */
+  apr_off_t data_size;
+
+  /* Current read position within DATA. */
+  apr_off_t data_position;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -142,4 +163,58 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file);
 
+/* The following functions access the contents of FILE, transparently
+ * using the memory mapped DATA if available.  They correspond to the
+ * respective svn_io_file_* functions and should be used instead of those
+ * for all reads from revision files.
+ */
+
+/* Move the read position of FILE to OFFSET.  Unless FILE is mapped into
+ * memory, this is svn_io_file_aligned_seek() using FILE's block size and
+ * BUFFER_START may be NULL.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset,
+                         apr_pool_t *pool);
+
+/* Set *OFFSET to the current read position in FILE. */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file);
+
+/* Set *SIZE to the number of bytes in FILE.  Use POOL for temporary
+ * allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_size(apr_off_t *size,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_pool_t *pool);
+
+/* Read NBYTES from the current position in FILE into BUF.  If BYTES_READ
+ * is not NULL, set it to the number of bytes actually read, which will
+ * only be less than NBYTES at the end of the file.  Otherwise, running
+ * into the end of FILE is an error.  Use POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes,
+                         apr_size_t *bytes_read,
+                         apr_pool_t *pool);
+
+/* Set *DATA to the NBYTES following the current position in FILE and
+ * move the read position behind them.  Running into the end of FILE is
+ * an error.
+ *
+ * If FILE is mapped into memory, *DATA points directly into the mapping,
+ * i.e. nothing gets copied.  It is then only valid for as long as FILE
+ * remains open and is not NUL-terminated.  Otherwise, the data will be
+ * read into a buffer allocated in RESULT_POOL.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_get_data(const char **data,
+                             svn_fs_fs__revision_file_t *file,
+                             apr_size_t nbytes,
+                             apr_pool_t *result_pool);
+
 #endif
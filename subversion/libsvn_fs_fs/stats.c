@@ -44,7 +44,9 @@
 
 /* We group representations into 2x2 different kinds plus one default:
  * [dir / file] x [text / prop]. The assignment is done by the first node
- * that references the respective representation.
+ * that references the respective representation.  Chunks of large file
+ * contents are classified by the first chunked representation that
+ * references them.
  */
 typedef enum rep_kind_t
 {
@@ -63,7 +65,10 @@ typedef enum rep_kind_t
   dir_rep,
 
   /* a file rep  */
-  file_rep
+  file_rep,
+
+  /* a chunk of a chunked file rep  */
+  chunk_rep
 } rep_kind_t;
 
 /* A representation fragment.
@@ -324,6 +329,8 @@ add_change(svn_fs_fs__stats_t *stats,
         add_to_histogram(&stats->file_rep_histogram, rep_size);
         add_to_histogram(&stats->file_histogram, expanded_size);
         break;
+      case chunk_rep:
+        break;
     }
 
   /* by extension */
@@ -462,8 +469,8 @@ parse_representation(rep_stats_t **representation,
                            + (apr_off_t)rep->item_index;
 
           SVN_ERR_ASSERT(revision_info->rev_file);
-          SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                                   &offset, scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL,
+                                           offset, scratch_pool));
           SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                              revision_info->rev_file->stream,
                                              scratch_pool, scratch_pool));
@@ -530,8 +537,8 @@ read_phsy_noderev(svn_stringbuf_t **noderev,
   SVN_ERR_ASSERT(revision_info->rev_file);
 
   offset += revision_info->offset;
-  SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                           &offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL, offset,
+                                   scratch_pool));
 
   /* Read it (terminated by an empty line) */
   do
@@ -596,6 +603,49 @@ parse_dir(query_t *query,
   return SVN_NO_ERROR;
 }
 
+/* If the file representation REP is chunked, count the references to its
+ * chunks in QUERY.  REVISION_INFO is the revision containing the noderev
+ * that refers to REP.
+ *
+ * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+parse_chunks(query_t *query,
+             representation_t *rep,
+             revision_info_t *revision_info,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = query->fs->fsap_data;
+  apr_array_header_t *chunks;
+  int i;
+
+  /* Older formats don't support chunking.  Don't read the rep header. */
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF2_FORMAT)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__get_chunk_list(&chunks, query->fs, rep, scratch_pool,
+                                    scratch_pool));
+  if (!chunks)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      rep_stats_t *chunk;
+      SVN_ERR(parse_representation(&chunk, query,
+                                   APR_ARRAY_IDX(chunks, i,
+                                                 representation_t *),
+                                   revision_info, result_pool,
+                                   scratch_pool));
+
+      if (++chunk->ref_count == 1)
+        chunk->kind = chunk_rep;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Parse the noderev given as NODEREV_STR and store the info in QUERY and
  * REVISION_INFO.  In phys. addressing mode, continue reading all DAG nodes,
  * directories and representations linked in that tree structure.
@@ -630,7 +680,12 @@ read_noderev(query_t *query,
 
       /* if we are the first to use this rep, mark it as "text rep" */
       if (++text->ref_count == 1)
-        text->kind = noderev->kind == svn_node_dir ? dir_rep : file_rep;
+        {
+          text->kind = noderev->kind == svn_node_dir ? dir_rep : file_rep;
+          if (noderev->kind == svn_node_file)
+            SVN_ERR(parse_chunks(query, noderev->data_rep, revision_info,
+                                 result_pool, scratch_pool));
+        }
     }
 
   if (noderev->prop_rep)
@@ -1094,10 +1149,8 @@ read_log_rev_or_packfile(query_t *query,
               svn_fs_fs__rep_header_t *header;
               rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
 
-              SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
-                                               rev_file->block_size,
-                                               NULL, entry->offset,
-                                               iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL,
+                                               entry->offset, iterpool));
               SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                                  rev_file->stream,
                                                  iterpool, iterpool));
@@ -1308,6 +1361,9 @@ aggregate_stats(const apr_array_header_t *revisions,
               case dir_property_rep:
                 add_rep_stats(&stats->dir_prop_rep_stats, rep);
                 break;
+              case chunk_rep:
+                add_rep_stats(&stats->chunk_rep_stats, rep);
+                break;
               default:
                 break;
             }
@@ -42,7 +42,10 @@
 #include "cached_data.h"
 #include "lock.h"
 #include "rep-cache.h"
+#include "compression_dict.h"
+#include "chunking.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -97,6 +100,15 @@ path_txn_next_ids(svn_fs_t *fs,
                          PATH_NEXT_IDS, pool);
 }
 
+static APR_INLINE const char *
+path_txn_chunk_reps(svn_fs_t *fs,
+                    const svn_fs_fs__id_part_t *txn_id,
+                    apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         PATH_TXN_CHUNK_REPS, pool);
+}
+
 
 /* The vtable associated with an open transaction object. */
 static txn_vtable_t txn_vtable = {
@@ -531,6 +543,36 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Write the sha1->rep mapping file for the in-transaction REP within FS.
+ * MUTABLE_REP_TRUNCATED is passed to svn_fs_fs__unparse_representation().
+ * Use SCATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+store_rep_sha1_mapping(svn_fs_t *fs,
+                       representation_t *rep,
+                       svn_boolean_t mutable_rep_truncated,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_file_t *rep_file;
+  const char *file_name = path_txn_sha1(fs, &rep->txn_id, rep->sha1_digest,
+                                        scratch_pool);
+  svn_stringbuf_t *rep_string
+    = svn_fs_fs__unparse_representation(rep, ffd->format,
+                                        mutable_rep_truncated,
+                                        scratch_pool, scratch_pool);
+  SVN_ERR(svn_io_file_open(&rep_file, file_name,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE
+                           | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
+
+  SVN_ERR(svn_io_file_write_full(rep_file, rep_string->data,
+                                 rep_string->len, NULL, scratch_pool));
+
+  SVN_ERR(svn_io_file_close(rep_file, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* For the in-transaction NODEREV within FS, write the sha1->rep mapping
  * file in the respective transaction, if rep sharing has been enabled etc.
  * Use SCATCH_POOL for temporary allocations.
@@ -547,26 +589,9 @@ store_sha1_rep_mapping(svn_fs_t *fs,
   if (   ffd->rep_sharing_allowed
       && noderev->data_rep
       && noderev->data_rep->has_sha1)
-    {
-      apr_file_t *rep_file;
-      const char *file_name = path_txn_sha1(fs,
-                                            &noderev->data_rep->txn_id,
-                                            noderev->data_rep->sha1_digest,
-                                            scratch_pool);
-      svn_stringbuf_t *rep_string
-        = svn_fs_fs__unparse_representation(noderev->data_rep,
-                                            ffd->format,
-                                            (noderev->kind == svn_node_dir),
-                                            scratch_pool, scratch_pool);
-      SVN_ERR(svn_io_file_open(&rep_file, file_name,
-                               APR_WRITE | APR_CREATE | APR_TRUNCATE
-                               | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
-
-      SVN_ERR(svn_io_file_write_full(rep_file, rep_string->data,
-                                     rep_string->len, NULL, scratch_pool));
-
-      SVN_ERR(svn_io_file_close(rep_file, scratch_pool));
-    }
+    SVN_ERR(store_rep_sha1_mapping(fs, noderev->data_rep,
+                                   (noderev->kind == svn_node_dir),
+                                   scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -1902,6 +1927,22 @@ fnv1a_checksum_finalize(apr_uint32_t *digest,
   return SVN_NO_ERROR;
 }
 
+/* A chunk of large file contents, stored as a separate representation. */
+typedef struct chunk_t
+{
+  /* The representation holding the chunk's contents. */
+  representation_t *rep;
+
+  /* If the chunk has been written by the current rep_write_baton, this is
+     the offset of its header in the proto-rev file, otherwise -1. */
+  apr_off_t offset;
+
+  /* For chunks written by the current rep_write_baton, size and modified
+     FNV-1a checksum of the on-disk representation including ENDREP. */
+  apr_off_t item_size;
+  apr_uint32_t fnv1_checksum;
+} chunk_t;
+
 /* This baton is used by the representation writing streams.  It keeps
    track of the checksum information as well as the total size of the
    representation so far. */
@@ -1935,12 +1976,34 @@ struct rep_write_baton
      writing to it. */
   void *lockcookie;
 
-  svn_checksum_ctx_t *md5_checksum_ctx;
-  svn_checksum_ctx_t *sha1_checksum_ctx;
+  /* MD5 and SHA1 of the contents, calculated in a single pass. */
+  svn_checksum__md5_sha1_ctx_t *checksum_ctx;
 
   /* calculate a modified FNV-1a checksum of the on-disk representation */
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
 
+  /* Contents not written yet because we don't know whether they will
+     exceed the chunking threshold.  NULL if chunking is disabled or
+     once we know. */
+  svn_spillbuf_t *pending;
+
+  /* Finds the chunk boundaries if the contents get split into chunks.
+     NULL otherwise. */
+  svn_fs_fs__chunker_t *chunker;
+
+  /* Contents of the current chunk so far. */
+  svn_stringbuf_t *chunk_buffer;
+
+  /* All chunks of the contents so far as chunk_t *, in order.  The same
+     chunk may appear more than once. */
+  apr_array_header_t *chunks;
+
+  /* The chunks that we wrote to the proto-rev file, in order. */
+  apr_array_header_t *new_chunks;
+
+  /* All chunks in CHUNKS, indexed by their SHA1 digest. */
+  apr_hash_t *chunk_hash;
+
   /* Local / scratch pool, available for temporary allocations. */
   apr_pool_t *scratch_pool;
 
@@ -1948,6 +2011,18 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
+/* Start splitting the contents written to B into chunks.  Defined below.
+ */
+static svn_error_t *
+start_chunking(struct rep_write_baton *b);
+
+/* Split the LEN bytes at DATA into chunks and write them to B.  Defined
+ * below. */
+static svn_error_t *
+add_chunk_data(struct rep_write_baton *b,
+               const char *data,
+               apr_size_t len);
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -1957,11 +2032,25 @@ rep_write_contents(void *baton,
                    apr_size_t *len)
 {
   struct rep_write_baton *b = baton;
+  fs_fs_data_t *ffd = b->fs->fsap_data;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
+  SVN_ERR(svn_checksum__md5_sha1_update(b->checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Until we know whether the contents will be split into chunks,
+     simply collect them. */
+  if (b->pending)
+    {
+      SVN_ERR(svn_spillbuf__write(b->pending, data, *len, b->scratch_pool));
+      if (b->rep_size >= ffd->chunking_threshold)
+        SVN_ERR(start_chunking(b));
+
+      return SVN_NO_ERROR;
+    }
+
+  if (b->chunker)
+    return svn_error_trace(add_chunk_data(b, data, *len));
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2159,24 +2248,40 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
-static void
+/* Return in *HANDLER and *HANDLER_BATON a window handler that writes
+   svndiff data to OUTPUT in the format configured for FS.  Set
+   LARGE_WINDOWS if the windows were produced for svndiff version 3, i.e.
+   by svn_txdelta__target_push_sliding().  If FS has a compression
+   dictionary for new representations, zstd will use it.  Allocate the
+   result in POOL. */
+static svn_error_t *
 txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                    void **handler_baton,
                    svn_stream_t *output,
                    svn_fs_t *fs,
+                   svn_boolean_t large_windows,
                    apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  const svn__zstd_dict_t *dict = NULL;
   int svndiff_version;
 
   if (ffd->delta_compression_type == compression_type_lz4)
     {
-      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
-      svndiff_version = 2;
+      SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
+      SVN_ERR_ASSERT(   !large_windows
+                     || ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = large_windows ? 3 : 2;
+    }
+  else if (ffd->delta_compression_type == compression_type_zstd)
+    {
+      SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_SVNDIFF4_FORMAT);
+      SVN_ERR(svn_fs_fs__get_write_compression_dict(&dict, fs, pool));
+      svndiff_version = 4;
     }
   else if (ffd->delta_compression_type == compression_type_zlib)
     {
-      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT);
+      SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT);
       svndiff_version = 1;
     }
   else
@@ -2184,8 +2289,65 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
       svndiff_version = 0;
     }
 
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+  svn_txdelta__to_svndiff_parallel(handler, handler_baton, output,
+                                   svndiff_version,
+                                   ffd->delta_compression_level, dict,
+                                   ffd->delta_write_threads, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the header of a new delta representation for B->NODEREV to
+   B->REP_STREAM and set B->DELTA_STREAM to a stream that will write
+   the svndiff data for all contents written to it. */
+static svn_error_t *
+start_delta_rep(struct rep_write_baton *b)
+{
+  svn_fs_t *fs = b->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  representation_t *base_rep;
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  /* Get the base for this delta. */
+  SVN_ERR(choose_delta_base(&base_rep, fs, b->noderev, FALSE,
+                            b->scratch_pool));
+  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
+                                  b->scratch_pool));
+
+  /* Write out the rep header. */
+  if (base_rep)
+    {
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
+    }
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  /* Prepare to write the svndiff data. */
+  SVN_ERR(txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs,
+                             ffd->large_delta_windows, b->result_pool));
+
+  if (ffd->large_delta_windows)
+    b->delta_stream = svn_txdelta__target_push_sliding(wh, whb, source,
+                                                       b->scratch_pool);
+  else
+    b->delta_stream = svn_txdelta_target_push(wh, whb, source,
+                                              b->scratch_pool);
+
+  return SVN_NO_ERROR;
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2198,18 +2360,13 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
-  representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
 
-  b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
-  b->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  b->checksum_ctx = svn_checksum__md5_sha1_ctx_create(TRUE, pool);
 
   b->fs = fs;
   b->result_pool = pool;
@@ -2230,39 +2387,19 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
-  /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
-
-  /* Write out the rep header. */
-  if (base_rep)
-    {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
-    }
-  else
-    {
-      header.type = svn_fs_fs__rep_self_delta;
-    }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
-
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  /* Large contents will be split into chunks.  But we can only tell
+     once we have seen enough of it. */
+  if (ffd->chunking_threshold)
+    b->pending = svn_spillbuf__create(0x10000,
+                                      (apr_size_t)MIN(ffd->chunking_threshold,
+                                                      0x1000000),
+                                      b->scratch_pool);
+  else
+    SVN_ERR(start_delta_rep(b));
 
   *wb_p = b;
 
@@ -2276,22 +2413,18 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
    revision, those can be passed in REPS_HASH (maps a sha1 digest onto
    representation_t*), otherwise pass in NULL for REPS_HASH.
 
-   The content of both representations will be compared, taking REP's content
-   from FILE at OFFSET.  Only if they actually match, will *OLD_REP not be
-   NULL.
+   The contents of the representations have not been compared yet.
 
    Use RESULT_POOL for *OLD_REP  allocations and SCRATCH_POOL for temporaries.
    The lifetime of *OLD_REP is limited by both, RESULT_POOL and REP lifetime.
  */
 static svn_error_t *
-get_shared_rep(representation_t **old_rep,
-               svn_fs_t *fs,
-               representation_t *rep,
-               apr_file_t *file,
-               apr_off_t offset,
-               apr_hash_t *reps_hash,
-               apr_pool_t *result_pool,
-               apr_pool_t *scratch_pool)
+find_shared_rep(representation_t **old_rep,
+                svn_fs_t *fs,
+                representation_t *rep,
+                apr_hash_t *reps_hash,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
 {
   svn_error_t *err;
   fs_fs_data_t *ffd = fs->fsap_data;
@@ -2414,6 +2547,121 @@ get_shared_rep(representation_t **old_rep,
       (*old_rep)->uniquifier = rep->uniquifier;
     }
 
+  return SVN_NO_ERROR;
+}
+
+/* Set *CONTENTS to a stream delivering the contents of OLD_REP in FS,
+   which find_shared_rep() returned for a representation in transaction
+   TXN_ID.  Allocate the stream in POOL. */
+static svn_error_t *
+get_shared_rep_contents(svn_stream_t **contents,
+                        svn_fs_t *fs,
+                        const representation_t *old_rep,
+                        const svn_fs_fs__id_part_t *txn_id,
+                        apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* The existing representation may itself be part of the current
+   * transaction.  In that case, it may be in different stages of
+   * the commit finalization process.
+   *
+   * OLD_REP_NORM is the same as that OLD_REP but it is assigned
+   * explicitly to REP's transaction if OLD_REP does not point
+   * to an already committed revision.  This then prevents the
+   * revision lookup and the txn data will be accessed.
+   */
+  representation_t *old_rep_norm = apr_pmemdup(pool, old_rep,
+                                               sizeof(*old_rep));
+  if (   !SVN_IS_VALID_REVNUM(old_rep_norm->revision)
+      || old_rep_norm->revision > ffd->youngest_rev_cache)
+    old_rep_norm->txn_id = *txn_id;
+
+  return svn_error_trace(svn_fs_fs__get_contents(contents, fs, old_rep_norm,
+                                                 FALSE, pool));
+}
+
+/* Make sure that CONTENTS of REP and OLD_CONTENTS of OLD_REP in FS are
+   the same, after find_shared_rep() returned OLD_REP for REP.  If they
+   are not, return SVN_ERR_FS_AMBIGUOUS_CHECKSUM_REP.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+compare_shared_rep(svn_fs_t *fs,
+                   representation_t *old_rep,
+                   representation_t *rep,
+                   svn_stream_t *contents,
+                   svn_stream_t *old_contents,
+                   apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_boolean_t same;
+  svn_error_t *err;
+
+  /* Note that the stream comparison might also produce MD5 checksum
+   * errors or other failures in case of SHA1 collisions. */
+  err = svn_stream_contents_same2(&same, contents, old_contents,
+                                  scratch_pool);
+
+  /* A mismatch should be extremely rare.
+   * If it does happen, reject the commit. */
+  if (!same || err)
+    {
+      /* SHA1 collision or worse. */
+      svn_checksum_t checksum;
+      svn_stringbuf_t *old_rep_str
+        = svn_fs_fs__unparse_representation(old_rep,
+                                            ffd->format, FALSE,
+                                            scratch_pool,
+                                            scratch_pool);
+      svn_stringbuf_t *rep_str
+        = svn_fs_fs__unparse_representation(rep,
+                                            ffd->format, FALSE,
+                                            scratch_pool,
+                                            scratch_pool);
+      const char *checksum__str;
+
+      checksum.digest = rep->sha1_digest;
+      checksum.kind = svn_checksum_sha1;
+      checksum__str = svn_checksum_to_cstring_display(&checksum,
+                                                      scratch_pool);
+
+      return svn_error_createf(SVN_ERR_FS_AMBIGUOUS_CHECKSUM_REP,
+                               err, "SHA1 of reps '%s' and '%s' "
+                               "matches (%s) but contents differ",
+                               old_rep_str->data, rep_str->data,
+                               checksum__str);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* For REP->SHA1_CHECKSUM, try to find an already existing representation
+   in FS and return it in *OLD_REP.  If no such representation exists or
+   if rep sharing has been disabled for FS, NULL will be returned.  Since
+   there may be new duplicate representations within the same uncommitted
+   revision, those can be passed in REPS_HASH (maps a sha1 digest onto
+   representation_t*), otherwise pass in NULL for REPS_HASH.
+
+   The content of both representations will be compared, taking REP's content
+   from FILE at OFFSET.  Only if they actually match, will *OLD_REP not be
+   NULL.
+
+   Use RESULT_POOL for *OLD_REP  allocations and SCRATCH_POOL for temporaries.
+   The lifetime of *OLD_REP is limited by both, RESULT_POOL and REP lifetime.
+ */
+static svn_error_t *
+get_shared_rep(representation_t **old_rep,
+               svn_fs_t *fs,
+               representation_t *rep,
+               apr_file_t *file,
+               apr_off_t offset,
+               apr_hash_t *reps_hash,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  SVN_ERR(find_shared_rep(old_rep, fs, rep, reps_hash, result_pool,
+                          scratch_pool));
+
   /* If we (very likely) found a matching representation, compare the actual
    * contents such that we can be sure that no rep-cache.db corruption or
    * hash collision produced a false positive. */
@@ -2422,59 +2670,17 @@ get_shared_rep(representation_t **old_rep,
       apr_off_t old_position;
       svn_stream_t *contents;
       svn_stream_t *old_contents;
-      svn_boolean_t same;
-
-      /* The existing representation may itself be part of the current
-       * transaction.  In that case, it may be in different stages of
-       * the commit finalization process.
-       *
-       * OLD_REP_NORM is the same as that OLD_REP but it is assigned
-       * explicitly to REP's transaction if OLD_REP does not point
-       * to an already committed revision.  This then prevents the
-       * revision lookup and the txn data will be accessed.
-       */
-      representation_t old_rep_norm = **old_rep;
-      if (   !SVN_IS_VALID_REVNUM(old_rep_norm.revision)
-          || old_rep_norm.revision > ffd->youngest_rev_cache)
-        old_rep_norm.txn_id = rep->txn_id;
 
       /* Make sure we can later restore FILE's current position. */
       SVN_ERR(svn_io_file_get_offset(&old_position, file, scratch_pool));
 
-      /* Compare the two representations.
-       * Note that the stream comparison might also produce MD5 checksum
-       * errors or other failures in case of SHA1 collisions. */
+      /* Compare the two representations. */
       SVN_ERR(svn_fs_fs__get_contents_from_file(&contents, fs, rep, file,
                                                 offset, scratch_pool));
-      SVN_ERR(svn_fs_fs__get_contents(&old_contents, fs, &old_rep_norm,
-                                      FALSE, scratch_pool));
-      err = svn_stream_contents_same2(&same, contents, old_contents,
-                                      scratch_pool);
-
-      /* A mismatch should be extremely rare.
-       * If it does happen, reject the commit. */
-      if (!same || err)
-        {
-          /* SHA1 collision or worse. */
-          svn_stringbuf_t *old_rep_str
-            = svn_fs_fs__unparse_representation(*old_rep,
-                                                ffd->format, FALSE,
-                                                scratch_pool,
-                                                scratch_pool);
-          svn_stringbuf_t *rep_str
-            = svn_fs_fs__unparse_representation(rep,
-                                                ffd->format, FALSE,
-                                                scratch_pool,
-                                                scratch_pool);
-          const char *checksum__str
-            = svn_checksum_to_cstring_display(&checksum, scratch_pool);
-
-          return svn_error_createf(SVN_ERR_FS_AMBIGUOUS_CHECKSUM_REP,
-                                   err, "SHA1 of reps '%s' and '%s' "
-                                   "matches (%s) but contents differ",
-                                   old_rep_str->data, rep_str->data,
-                                   checksum__str);
-        }
+      SVN_ERR(get_shared_rep_contents(&old_contents, fs, *old_rep,
+                                      &rep->txn_id, scratch_pool));
+      SVN_ERR(compare_shared_rep(fs, *old_rep, rep, contents, old_contents,
+                                 scratch_pool));
 
       /* Restore FILE's read / write position. */
       SVN_ERR(svn_io_file_seek(file, APR_SET, &old_position, scratch_pool));
@@ -2483,27 +2689,461 @@ get_shared_rep(representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
-/* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
- * SHA1 results are only be set if SHA1_CTX is not NULL.
+/* Copy the hash sum calculation results from CTX into REP.
+ * SHA1 results are only be set if CTX calculated them.
  * Use POOL for allocations.
  */
 static svn_error_t *
 digests_final(representation_t *rep,
-              const svn_checksum_ctx_t *md5_ctx,
-              const svn_checksum_ctx_t *sha1_ctx,
+              const svn_checksum__md5_sha1_ctx_t *ctx,
               apr_pool_t *pool)
 {
-  svn_checksum_t *checksum;
+  svn_checksum_t *md5_checksum;
+  svn_checksum_t *sha1_checksum;
 
-  SVN_ERR(svn_checksum_final(&checksum, md5_ctx, pool));
-  memcpy(rep->md5_digest, checksum->digest, svn_checksum_size(checksum));
-  rep->has_sha1 = sha1_ctx != NULL;
+  SVN_ERR(svn_checksum__md5_sha1_final(&md5_checksum, &sha1_checksum, ctx,
+                                       pool));
+  memcpy(rep->md5_digest, md5_checksum->digest,
+         svn_checksum_size(md5_checksum));
+  rep->has_sha1 = sha1_checksum != NULL;
   if (rep->has_sha1)
+    memcpy(rep->sha1_digest, sha1_checksum->digest,
+           svn_checksum_size(sha1_checksum));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all contents collected in B->PENDING to B and stop collecting.
+ */
+static svn_error_t *
+drain_pending(struct rep_write_baton *b)
+{
+  svn_spillbuf_t *pending = b->pending;
+  apr_pool_t *iterpool = svn_pool_create(b->scratch_pool);
+
+  b->pending = NULL;
+  while (TRUE)
+    {
+      const char *data;
+      apr_size_t len;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_spillbuf__read(&data, &len, pending, iterpool));
+      if (data == NULL)
+        break;
+
+      if (b->chunker)
+        SVN_ERR(add_chunk_data(b, data, len));
+      else
+        SVN_ERR(svn_stream_write(b->delta_stream, data, &len));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+start_chunking(struct rep_write_baton *b)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+
+  b->chunker = svn_fs_fs__chunker_create((apr_size_t)ffd->chunk_size,
+                                         b->scratch_pool);
+  b->chunk_buffer = svn_stringbuf_create_ensure(
+                      svn_fs_fs__chunker_max_size(b->chunker),
+                      b->scratch_pool);
+  b->chunks = apr_array_make(b->scratch_pool, 16, sizeof(chunk_t *));
+  b->new_chunks = apr_array_make(b->scratch_pool, 16, sizeof(chunk_t *));
+  b->chunk_hash = svn_hash__make(b->scratch_pool);
+
+  return svn_error_trace(drain_pending(b));
+}
+
+/* Set *CONTENTS to a stream delivering the contents of CHUNK, which is
+   part of the contents written to B.  Allocate the stream in POOL. */
+static svn_error_t *
+get_chunk_contents(svn_stream_t **contents,
+                   struct rep_write_baton *b,
+                   const chunk_t *chunk,
+                   apr_pool_t *pool)
+{
+  if (chunk->offset >= 0)
+    return svn_error_trace(svn_fs_fs__get_contents_from_file(contents,
+                                                             b->fs,
+                                                             chunk->rep,
+                                                             b->file,
+                                                             chunk->offset,
+                                                             pool));
+
+  return svn_error_trace(get_shared_rep_contents(contents, b->fs,
+                                      chunk->rep,
+                                      svn_fs_fs__id_txn_id(b->noderev->id),
+                                      pool));
+}
+
+/* Make sure that the existing CHUNK has the same contents as the current
+   chunk in B, described by REP.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+compare_chunk(struct rep_write_baton *b,
+              const chunk_t *chunk,
+              representation_t *rep,
+              apr_pool_t *scratch_pool)
+{
+  apr_off_t old_position;
+  svn_stream_t *old_contents;
+
+  /* Make sure we can later restore FILE's current position. */
+  SVN_ERR(svn_io_file_get_offset(&old_position, b->file, scratch_pool));
+
+  SVN_ERR(get_chunk_contents(&old_contents, b, chunk, scratch_pool));
+  SVN_ERR(compare_shared_rep(b->fs, chunk->rep, rep,
+                             svn_stream_from_stringbuf(b->chunk_buffer,
+                                                       scratch_pool),
+                             old_contents, scratch_pool));
+
+  /* Restore FILE's read / write position. */
+  SVN_ERR(svn_io_file_seek(b->file, APR_SET, &old_position, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the current chunk of B as a new self-contained representation
+   to the proto-rev file and fill in CHUNK accordingly.  CHUNK->REP has
+   been initialized already.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+write_new_chunk(chunk_t *chunk,
+                struct rep_write_baton *b,
+                apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_header_t header = { 0 };
+  svn_checksum_ctx_t *fnv1a_checksum_ctx = NULL;
+  svn_stream_t *stream;
+  svn_stream_t *delta_stream;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  apr_size_t len = b->chunk_buffer->len;
+  apr_off_t delta_start;
+  apr_off_t offset;
+
+  SVN_ERR(svn_io_file_get_offset(&chunk->offset, b->file, scratch_pool));
+  stream = svn_stream_from_aprfile2(b->file, TRUE, scratch_pool);
+  if (svn_fs_fs__use_log_addressing(b->fs))
+    stream = fnv1a_wrap_stream(&fnv1a_checksum_ctx, stream, scratch_pool);
+
+  /* Never deltify chunks against anything.  That would defeat sharing
+     them between unrelated files. */
+  header.type = svn_fs_fs__rep_self_delta;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, stream, scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&delta_start, b->file, scratch_pool));
+
+  SVN_ERR(txdelta_to_svndiff(&wh, &whb, stream, b->fs, FALSE,
+                             scratch_pool));
+  delta_stream = svn_txdelta_target_push(wh, whb,
+                                         svn_stream_empty(scratch_pool),
+                                         scratch_pool);
+  SVN_ERR(svn_stream_write(delta_stream, b->chunk_buffer->data, &len));
+  SVN_ERR(svn_stream_close(delta_stream));
+
+  SVN_ERR(svn_io_file_get_offset(&offset, b->file, scratch_pool));
+  chunk->rep->size = offset - delta_start;
+
+  SVN_ERR(svn_stream_puts(stream, "ENDREP\n"));
+  SVN_ERR(svn_io_file_get_offset(&offset, b->file, scratch_pool));
+  chunk->item_size = offset - chunk->offset;
+
+  if (fnv1a_checksum_ctx)
+    SVN_ERR(fnv1a_checksum_finalize(&chunk->fnv1_checksum,
+                                    fnv1a_checksum_ctx, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Finish the current chunk of B.  Either share an existing representation
+   with the same contents or write a new one. */
+static svn_error_t *
+write_chunk(struct rep_write_baton *b)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(b->scratch_pool);
+  svn_stringbuf_t *buffer = b->chunk_buffer;
+  svn_checksum__md5_sha1_ctx_t *checksum_ctx;
+  representation_t *rep;
+  representation_t *old_rep;
+  chunk_t *chunk;
+
+  rep = apr_pcalloc(b->scratch_pool, sizeof(*rep));
+  checksum_ctx = svn_checksum__md5_sha1_ctx_create(TRUE, scratch_pool);
+  SVN_ERR(svn_checksum__md5_sha1_update(checksum_ctx, buffer->data,
+                                        buffer->len));
+  SVN_ERR(digests_final(rep, checksum_ctx, scratch_pool));
+  rep->expanded_size = buffer->len;
+  rep->revision = SVN_INVALID_REVNUM;
+  rep->txn_id = *svn_fs_fs__id_txn_id(b->noderev->id);
+
+  /* Chunks may repeat within the same file. */
+  chunk = apr_hash_get(b->chunk_hash, rep->sha1_digest, APR_SHA1_DIGESTSIZE);
+  if (chunk)
+    {
+      SVN_ERR(compare_chunk(b, chunk, rep, scratch_pool));
+    }
+  else
+    {
+      chunk = apr_pcalloc(b->scratch_pool, sizeof(*chunk));
+      chunk->offset = -1;
+
+      SVN_ERR(find_shared_rep(&old_rep, b->fs, rep, NULL, b->scratch_pool,
+                              scratch_pool));
+      if (old_rep)
+        {
+          chunk->rep = old_rep;
+          SVN_ERR(compare_chunk(b, chunk, rep, scratch_pool));
+        }
+      else
+        {
+          chunk->rep = rep;
+          SVN_ERR(write_new_chunk(chunk, b, scratch_pool));
+          APR_ARRAY_PUSH(b->new_chunks, chunk_t *) = chunk;
+        }
+
+      apr_hash_set(b->chunk_hash, rep->sha1_digest, APR_SHA1_DIGESTSIZE,
+                   chunk);
+    }
+
+  APR_ARRAY_PUSH(b->chunks, chunk_t *) = chunk;
+  svn_stringbuf_setempty(buffer);
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+add_chunk_data(struct rep_write_baton *b,
+               const char *data,
+               apr_size_t len)
+{
+  while (len > 0)
+    {
+      svn_boolean_t boundary;
+      apr_size_t scanned = svn_fs_fs__chunker_scan(&boundary, b->chunker,
+                                                   data, len);
+
+      svn_stringbuf_appendbytes(b->chunk_buffer, data, scanned);
+      data += scanned;
+      len -= scanned;
+
+      if (boundary)
+        SVN_ERR(write_chunk(b));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for streams returned by get_chunked_contents(). */
+typedef struct chunks_read_baton_t
+{
+  /* Contains the chunks to read. */
+  struct rep_write_baton *b;
+
+  /* Index of the next chunk to read in B->CHUNKS. */
+  int next_chunk;
+
+  /* Contents of the current chunk, NULL between chunks. */
+  svn_stream_t *current;
+
+  /* Contains CURRENT.  Cleared for every new chunk. */
+  apr_pool_t *chunk_pool;
+} chunks_read_baton_t;
+
+/* Implement svn_read_fn_t for streams returned by get_chunked_contents().
+ */
+static svn_error_t *
+chunks_read(void *baton,
+            char *buf,
+            apr_size_t *len)
+{
+  chunks_read_baton_t *cb = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t read = remaining;
+
+      if (cb->current == NULL)
+        {
+          const chunk_t *chunk;
+
+          /* All data has been delivered? */
+          if (cb->next_chunk == cb->b->chunks->nelts)
+            break;
+
+          chunk = APR_ARRAY_IDX(cb->b->chunks, cb->next_chunk, chunk_t *);
+          svn_pool_clear(cb->chunk_pool);
+          SVN_ERR(get_chunk_contents(&cb->current, cb->b, chunk,
+                                     cb->chunk_pool));
+          cb->next_chunk++;
+        }
+
+      SVN_ERR(svn_stream_read_full(cb->current, buf, &read));
+      buf += read;
+      remaining -= read;
+
+      /* A short read means that we reached the end of the chunk. */
+      if (remaining > 0)
+        cb->current = NULL;
+    }
+
+  *len -= remaining;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CONTENTS to a stream delivering the concatenated contents of all
+   chunks written to B so far.  Allocate the stream in POOL. */
+static svn_stream_t *
+get_chunked_contents(struct rep_write_baton *b,
+                     apr_pool_t *pool)
+{
+  svn_stream_t *contents;
+  chunks_read_baton_t *cb = apr_pcalloc(pool, sizeof(*cb));
+
+  cb->b = b;
+  cb->chunk_pool = svn_pool_create(pool);
+
+  contents = svn_stream_create(cb, pool);
+  svn_stream_set_read2(contents, NULL /* only full read support */,
+                       chunks_read);
+
+  return contents;
+}
+
+/* Like get_shared_rep() but for the chunked representation REP
+   of the contents written to B. */
+static svn_error_t *
+get_shared_chunked_rep(representation_t **old_rep,
+                       struct rep_write_baton *b,
+                       representation_t *rep)
+{
+  SVN_ERR(find_shared_rep(old_rep, b->fs, rep, NULL, b->result_pool,
+                          b->scratch_pool));
+
+  /* The chunks have been compared individually but there may still be
+   * a false positive for the whole contents. */
+  if (*old_rep)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(b->scratch_pool);
+      apr_off_t old_position;
+      svn_stream_t *old_contents;
+
+      SVN_ERR(svn_io_file_get_offset(&old_position, b->file, scratch_pool));
+
+      SVN_ERR(get_shared_rep_contents(&old_contents, b->fs, *old_rep,
+                                      &rep->txn_id, scratch_pool));
+      SVN_ERR(compare_shared_rep(b->fs, *old_rep, rep,
+                                 get_chunked_contents(b, scratch_pool),
+                                 old_contents, scratch_pool));
+
+      SVN_ERR(svn_io_file_seek(b->file, APR_SET, &old_position,
+                               scratch_pool));
+      svn_pool_destroy(scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Allocate item indexes for all new chunks of B.  Then write the chunk
+   list of REP to B->REP_STREAM and set REP->SIZE accordingly.  Return
+   the offset of the chunk list representation in *OFFSET. */
+static svn_error_t *
+write_chunk_list(apr_off_t *offset,
+                 struct rep_write_baton *b,
+                 representation_t *rep)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  svn_fs_fs__rep_header_t header = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(b->scratch_pool);
+  apr_off_t end_offset;
+  int i;
+
+  /* The chunk list will refer to the new chunks by their item index. */
+  for (i = 0; i < b->new_chunks->nelts; ++i)
+    {
+      chunk_t *chunk = APR_ARRAY_IDX(b->new_chunks, i, chunk_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(allocate_item_index(&chunk->rep->item_index, b->fs,
+                                  &rep->txn_id, chunk->offset, iterpool));
+    }
+
+  SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_CHUNKED_REP_FORMAT);
+  SVN_ERR(svn_io_file_get_offset(offset, b->file, b->scratch_pool));
+  header.type = svn_fs_fs__rep_chunked;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  for (i = 0; i < b->chunks->nelts; ++i)
+    {
+      const chunk_t *chunk = APR_ARRAY_IDX(b->chunks, i, chunk_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__write_chunk_list_entry(b->rep_stream,
+                                                chunk->rep->revision,
+                                                chunk->rep, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_io_file_get_offset(&end_offset, b->file, b->scratch_pool));
+  rep->size = end_offset - b->delta_start;
+
+  return SVN_NO_ERROR;
+}
+
+/* Make the chunks that B wrote to the proto-rev file available to other
+   files in the same transaction and remember them for the rep-cache. */
+static svn_error_t *
+store_new_chunks(struct rep_write_baton *b)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__id_txn_id(b->noderev->id);
+  svn_stringbuf_t *reps;
+  apr_pool_t *iterpool;
+  apr_file_t *file;
+  int i;
+
+  if (b->new_chunks->nelts == 0)
+    return SVN_NO_ERROR;
+
+  reps = svn_stringbuf_create_empty(b->scratch_pool);
+  iterpool = svn_pool_create(b->scratch_pool);
+  for (i = 0; i < b->new_chunks->nelts; ++i)
     {
-      SVN_ERR(svn_checksum_final(&checksum, sha1_ctx, pool));
-      memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
+      chunk_t *chunk = APR_ARRAY_IDX(b->new_chunks, i, chunk_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(store_rep_sha1_mapping(b->fs, chunk->rep, FALSE, iterpool));
+      svn_stringbuf_appendstr(reps,
+                              svn_fs_fs__unparse_representation(chunk->rep,
+                                                                ffd->format,
+                                                                FALSE,
+                                                                iterpool,
+                                                                iterpool));
+      svn_stringbuf_appendbyte(reps, '\n');
     }
 
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_io_file_open(&file,
+                           path_txn_chunk_reps(b->fs, txn_id,
+                                               b->scratch_pool),
+                           APR_WRITE | APR_CREATE | APR_APPEND
+                           | APR_BUFFERED, APR_OS_DEFAULT,
+                           b->scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, reps->data, reps->len, NULL,
+                                 b->scratch_pool));
+  SVN_ERR(svn_io_file_close(file, b->scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -2517,9 +3157,22 @@ rep_write_contents_close(void *baton)
   representation_t *rep;
   representation_t *old_rep;
   apr_off_t offset;
+  apr_off_t rep_start = b->rep_offset;
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  /* Contents that stayed below the chunking threshold get stored in a
+     single representation as usual. */
+  if (b->pending)
+    {
+      SVN_ERR(start_delta_rep(b));
+      SVN_ERR(drain_pending(b));
+    }
+
+  /* Write the last chunk. */
+  if (b->chunker && b->chunk_buffer->len)
+    SVN_ERR(write_chunk(b));
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
   if (b->delta_stream)
@@ -2536,13 +3189,22 @@ rep_write_contents_close(void *baton)
   rep->revision = SVN_INVALID_REVNUM;
 
   /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  SVN_ERR(digests_final(rep, b->checksum_ctx, b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
-     identical to the one we just wrote out. */
-  SVN_ERR(get_shared_rep(&old_rep, b->fs, rep, b->file, b->rep_offset, NULL,
-                         b->result_pool, b->scratch_pool));
+     identical to the one we just wrote out.  For chunked contents,
+     do so before writing the chunk list. */
+  if (b->chunker)
+    {
+      SVN_ERR(get_shared_chunked_rep(&old_rep, b, rep));
+      if (!old_rep)
+        SVN_ERR(write_chunk_list(&rep_start, b, rep));
+    }
+  else
+    {
+      SVN_ERR(get_shared_rep(&old_rep, b->fs, rep, b->file, b->rep_offset,
+                             NULL, b->result_pool, b->scratch_pool));
+    }
 
   if (old_rep)
     {
@@ -2557,7 +3219,7 @@ rep_write_contents_close(void *baton)
       /* Write out our cosmetic end marker. */
       SVN_ERR(svn_stream_puts(b->rep_stream, "ENDREP\n"));
       SVN_ERR(allocate_item_index(&rep->item_index, b->fs, &rep->txn_id,
-                                  b->rep_offset, b->scratch_pool));
+                                  rep_start, b->scratch_pool));
 
       b->noderev->data_rep = rep;
     }
@@ -2572,9 +3234,30 @@ rep_write_contents_close(void *baton)
     {
       svn_fs_fs__p2l_entry_t entry;
 
-      entry.offset = b->rep_offset;
+      /* The new chunks precede the chunk list in the proto-rev file. */
+      if (b->chunker)
+        {
+          int i;
+
+          for (i = 0; i < b->new_chunks->nelts; ++i)
+            {
+              chunk_t *chunk = APR_ARRAY_IDX(b->new_chunks, i, chunk_t *);
+
+              entry.offset = chunk->offset;
+              entry.size = chunk->item_size;
+              entry.type = SVN_FS_FS__ITEM_TYPE_FILE_REP;
+              entry.item.revision = SVN_INVALID_REVNUM;
+              entry.item.number = chunk->rep->item_index;
+              entry.fnv1_checksum = chunk->fnv1_checksum;
+
+              SVN_ERR(store_p2l_index_entry(b->fs, &rep->txn_id, &entry,
+                                            b->scratch_pool));
+            }
+        }
+
+      entry.offset = rep_start;
       SVN_ERR(svn_io_file_get_offset(&offset, b->file, b->scratch_pool));
-      entry.size = offset - b->rep_offset;
+      entry.size = offset - rep_start;
       entry.type = SVN_FS_FS__ITEM_TYPE_FILE_REP;
       entry.item.revision = SVN_INVALID_REVNUM;
       entry.item.number = rep->item_index;
@@ -2591,7 +3274,11 @@ rep_write_contents_close(void *baton)
   /* Write the sha1->rep mapping *after* we successfully written node
    * revision to disk. */
   if (!old_rep)
-    SVN_ERR(store_sha1_rep_mapping(b->fs, b->noderev, b->scratch_pool));
+    {
+      SVN_ERR(store_sha1_rep_mapping(b->fs, b->noderev, b->scratch_pool));
+      if (b->chunker)
+        SVN_ERR(store_new_chunks(b));
+    }
 
   SVN_ERR(unlock_proto_rev(b->fs, &rep->txn_id, b->lockcookie,
                            b->scratch_pool));
@@ -2600,6 +3287,51 @@ rep_write_contents_close(void *baton)
   return SVN_NO_ERROR;
 }
 
+/* Add the chunk representations written in transaction TXN_ID of FS to
+   REPS_TO_CACHE as being part of revision NEW_REV.  Allocate them in
+   REPS_POOL and use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+add_chunk_reps_to_cache(apr_array_header_t *reps_to_cache,
+                        svn_fs_t *fs,
+                        const svn_fs_fs__id_part_t *txn_id,
+                        svn_revnum_t new_rev,
+                        apr_pool_t *reps_pool,
+                        apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  apr_array_header_t *lines;
+  svn_error_t *err;
+  int i;
+
+  err = svn_stringbuf_from_file2(&contents,
+                                 path_txn_chunk_reps(fs, txn_id,
+                                                     scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* No chunks in this transaction. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  lines = svn_cstring_split(contents->data, "\n", TRUE, scratch_pool);
+  for (i = 0; i < lines->nelts; ++i)
+    {
+      const char *line = APR_ARRAY_IDX(lines, i, const char *);
+      representation_t *rep;
+
+      SVN_ERR(svn_fs_fs__parse_representation(&rep,
+                                              svn_stringbuf_create(line,
+                                                              scratch_pool),
+                                              reps_pool, scratch_pool));
+      rep->revision = new_rev;
+      APR_ARRAY_PUSH(reps_to_cache, representation_t *) = rep;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Store a writable stream in *CONTENTS_P that will receive all data
    written and store it as the file data representation referenced by
    NODEREV in filesystem FS.  Perform temporary allocations in
@@ -2713,10 +3445,8 @@ struct write_container_baton
 
   apr_size_t size;
 
-  svn_checksum_ctx_t *md5_ctx;
-
-  /* SHA1 calculation is optional. If not needed, this will be NULL. */
-  svn_checksum_ctx_t *sha1_ctx;
+  /* SHA1 calculation is optional and may be disabled in this context. */
+  svn_checksum__md5_sha1_ctx_t *checksum_ctx;
 };
 
 /* The handler for the write_container_rep stream.  BATON is a
@@ -2729,9 +3459,7 @@ write_container_handler(void *baton,
 {
   struct write_container_baton *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
-  if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+  SVN_ERR(svn_checksum__md5_sha1_update(whb->checksum_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2809,9 +3537,10 @@ write_container_rep(representation_t *rep,
   else
     fnv1a_checksum_ctx = NULL;
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__md5_sha1_ctx_create(item_type
+                                          != SVN_FS_FS__ITEM_TYPE_DIR_REP,
+                                        scratch_pool);
 
   stream = svn_stream_create(whb, scratch_pool);
   svn_stream_set_write(stream, write_container_handler);
@@ -2821,7 +3550,7 @@ write_container_rep(representation_t *rep,
   SVN_ERR(writer(stream, collection, scratch_pool));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   rep->expanded_size = whb->size;
@@ -2947,15 +3676,17 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, scratch_pool);
+  SVN_ERR(txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, FALSE,
+                             scratch_pool));
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
                                         scratch_pool);
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__md5_sha1_ctx_create(item_type
+                                          != SVN_FS_FS__ITEM_TYPE_DIR_REP,
+                                        scratch_pool);
 
   /* serialize the hash */
   stream = svn_stream_create(whb, scratch_pool);
@@ -2965,7 +3696,7 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_stream_close(whb->stream));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   SVN_ERR(svn_io_file_get_offset(&rep_end, file, scratch_pool));
@@ -3811,6 +4542,12 @@ commit_body(void *baton, apr_pool_t *pool)
                           directory_ids, cb->reps_to_cache, cb->reps_hash,
                           cb->reps_pool, TRUE, pool));
 
+  /* Chunks of large files have no node-revisions of their own that
+     would put them into the rep-cache. */
+  if (cb->reps_to_cache)
+    SVN_ERR(add_chunk_reps_to_cache(cb->reps_to_cache, cb->fs, txn_id,
+                                    new_rev, cb->reps_pool, pool));
+
   /* Write the changed-path information. */
   SVN_ERR(write_final_changed_path_info(&changed_path_offset, proto_file,
                                         cb->fs, txn_id, changed_paths,
@@ -2359,7 +2359,7 @@ svn_fs_fs__commit_txn(const char **conflict_p,
 
   if (ffd->pack_after_commit)
     {
-      SVN_ERR(svn_fs_fs__pack(fs, 0, NULL, NULL, NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__pack(fs, 0, 1, NULL, NULL, NULL, NULL, pool));
     }
 
   return SVN_NO_ERROR;
@@ -4187,6 +4187,8 @@ crawl_directory_dag_for_mergeinfo(svn_fs_root_t *root,
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
 
   SVN_ERR(svn_fs_fs__dag_dir_entries(&entries, dir_dag, scratch_pool));
+  SVN_ERR(svn_fs_fs__prefetch_node_revisions(root->fs, entries,
+                                             scratch_pool));
   for (i = 0; i < entries->nelts; ++i)
     {
       svn_fs_dirent_t *dirent = APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *);
@@ -4755,6 +4757,7 @@ verify_node(dag_node_t *node,
       APR_ARRAY_PUSH(parent_nodes, dag_node_t*) = node;
 
       SVN_ERR(svn_fs_fs__dag_dir_entries(&entries, node, pool));
+      SVN_ERR(svn_fs_fs__prefetch_node_revisions(fs, entries, pool));
 
       /* Compute CHILDREN_MERGEINFO. */
       for (i = 0; i < entries->nelts; ++i)
@@ -28,6 +28,7 @@
 #include "svn_ctype.h"
 #include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
@@ -1438,6 +1439,7 @@ get_combined_window(svn_stringbuf_t **result,
   svn_stringbuf_t *source, *buf = rb->base_window;
   rep_state_t *rs;
   apr_pool_t *iterpool;
+  svn_error_t *err;
 
   /* Read all windows that we need to combine. This is fine because
      the size of each window is relatively small (100kB) and skip-
@@ -1486,15 +1488,20 @@ get_combined_window(svn_stringbuf_t **result,
 
       /* Combine this window with the current one. */
       new_pool = svn_pool_create(rb->scratch_pool);
-      buf = svn_stringbuf_create_ensure(window->tview_len, new_pool);
-      buf->len = window->tview_len;
+      buf = svn_stringbuf_create_ensure(window->tview_len
+                                        + SVN_TXDELTA__APPLY_PADDING,
+                                        new_pool);
+
+      err = svn_txdelta__apply_window(window,
+                                      source ? source->data : NULL,
+                                      source ? source->len : 0,
+                                      buf->data, buf->blocksize);
+      if (err)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, err,
+                                _("svndiff window is corrupt"));
 
-      svn_txdelta_apply_instructions(window, source ? source->data : NULL,
-                                     buf->data, &buf->len);
-      if (buf->len != window->tview_len)
-        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
-                                _("svndiff window length is "
-                                  "corrupt"));
+      buf->len = window->tview_len;
+      buf->data[buf->len] = '\0';
 
       /* Cache windows only if the whole rep content could be read as a
          single chunk.  Only then will no other chunk need a deeper RS
@@ -500,6 +500,7 @@ x_verify(svn_fs_t *fs,
 static svn_error_t *
 x_pack(svn_fs_t *fs,
        const char *path,
+       int jobs,
        svn_fs_pack_notify_t notify_func,
        void *notify_baton,
        svn_cancel_func_t cancel_func,
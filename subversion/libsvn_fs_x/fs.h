@@ -104,6 +104,7 @@ extern "C" {
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_COMPRESSION        "compression"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -391,6 +392,10 @@ typedef struct svn_fs_x__data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
+  /* svndiff version to use with txdelta storage format in new revs.
+   * This is 1 for zlib and 4 for zstd compression. */
+  int delta_svndiff_version;
+
   /* Compression level to use with txdelta storage format in new revs. */
   int delta_compression_level;
 
@@ -262,6 +262,7 @@ read_config(svn_fs_x__data_t *ffd,
 {
   svn_config_t *config;
   apr_int64_t compression_level;
+  const char *compression;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -281,13 +282,41 @@ read_config(svn_fs_x__data_t *ffd,
                                CONFIG_SECTION_DELTIFICATION,
                                CONFIG_OPTION_MAX_LINEAR_DELTIFICATION,
                                SVN_FS_X_MAX_LINEAR_DELTIFICATION));
-  SVN_ERR(svn_config_get_int64(config, &compression_level,
-                               CONFIG_SECTION_DELTIFICATION,
-                               CONFIG_OPTION_COMPRESSION_LEVEL,
-                               SVN_DELTA_COMPRESSION_LEVEL_DEFAULT));
-  ffd->delta_compression_level
-    = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
-                SVN_DELTA_COMPRESSION_LEVEL_MAX);
+  svn_config_get(config, &compression, CONFIG_SECTION_DELTIFICATION,
+                 CONFIG_OPTION_COMPRESSION, "zlib");
+  if (strcmp(compression, "zstd") == 0)
+    {
+      if (!svn__zstd_available())
+        return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                _("Compression type 'zstd' is not "
+                                  "supported by this build of Subversion"));
+
+      SVN_ERR(svn_config_get_int64(config, &compression_level,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_COMPRESSION_LEVEL,
+                                   SVN__COMPRESSION_ZSTD_DEFAULT));
+      ffd->delta_svndiff_version = 4;
+      ffd->delta_compression_level
+        = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
+                   SVN__COMPRESSION_ZSTD_MAX);
+    }
+  else if (strcmp(compression, "zlib") == 0)
+    {
+      SVN_ERR(svn_config_get_int64(config, &compression_level,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_COMPRESSION_LEVEL,
+                                   SVN_DELTA_COMPRESSION_LEVEL_DEFAULT));
+      ffd->delta_svndiff_version = 1;
+      ffd->delta_compression_level
+        = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
+                    SVN_DELTA_COMPRESSION_LEVEL_MAX);
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("Invalid 'compression' value '%s' in the "
+                                 "config"), compression);
+    }
 
   /* Initialize revprop packing settings in ffd. */
   SVN_ERR(svn_config_get_bool(config, &ffd->compress_packed_revprops,
@@ -457,6 +486,15 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### Instead of zlib, Zstandard (zstd) may be used to compress the data if"  NL
+"### Subversion has been built with zstd support.  It achieves similar"      NL
+"### compression ratios but decompresses much faster.  With zstd, valid"     NL
+"### compression levels range from 0 to 19 and the default is 3."           NL
+"### The syntax of this option is:"                                          NL
+"###   " CONFIG_OPTION_COMPRESSION " = zlib | zstd"                          NL
+"### The default value is 'zlib'."                                           NL
+"# " CONFIG_OPTION_COMPRESSION " = zlib"                                     NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
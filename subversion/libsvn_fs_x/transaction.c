@@ -2007,8 +2007,8 @@ typedef struct rep_write_baton_t
      writing to it. */
   void *lockcookie;
 
-  svn_checksum_ctx_t *md5_checksum_ctx;
-  svn_checksum_ctx_t *sha1_checksum_ctx;
+  /* MD5 and SHA1 of the contents, calculated in a single pass. */
+  svn_checksum__md5_sha1_ctx_t *checksum_ctx;
 
   /* Receives the low-level checksum when closing REP_STREAM. */
   apr_uint32_t fnv1a_checksum;
@@ -2031,8 +2031,7 @@ rep_write_contents(void *baton,
 {
   rep_write_baton_t *b = baton;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
+  SVN_ERR(svn_checksum__md5_sha1_update(b->checksum_ctx, data, *len));
   b->rep_size += *len;
 
   return svn_stream_write(b->delta_stream, data, len);
@@ -2250,17 +2249,14 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
   svn_stream_t *source;
   svn_txdelta_window_handler_t wh;
   void *whb;
-  int diff_version = 1;
+  int diff_version = ffd->delta_svndiff_version;
   svn_fs_x__rep_header_t header = { 0 };
   svn_fs_x__txn_id_t txn_id
     = svn_fs_x__get_txn_id(noderev->noderev_id.change_set);
 
   b = apr_pcalloc(result_pool, sizeof(*b));
 
-  b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1,
-                                                 result_pool);
-  b->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5,
-                                                result_pool);
+  b->checksum_ctx = svn_checksum__md5_sha1_ctx_create(TRUE, result_pool);
 
   b->fs = fs;
   b->result_pool = result_pool;
@@ -2551,26 +2547,26 @@ get_shared_rep(svn_fs_x__representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
-/* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
- * SHA1 results are only be set if SHA1_CTX is not NULL.
+/* Copy the hash sum calculation results from CTX into REP.
+ * SHA1 results are only be set if CTX calculated them.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 digests_final(svn_fs_x__representation_t *rep,
-              const svn_checksum_ctx_t *md5_ctx,
-              const svn_checksum_ctx_t *sha1_ctx,
+              const svn_checksum__md5_sha1_ctx_t *ctx,
               apr_pool_t *scratch_pool)
 {
-  svn_checksum_t *checksum;
+  svn_checksum_t *md5_checksum;
+  svn_checksum_t *sha1_checksum;
 
-  SVN_ERR(svn_checksum_final(&checksum, md5_ctx, scratch_pool));
-  memcpy(rep->md5_digest, checksum->digest, svn_checksum_size(checksum));
-  rep->has_sha1 = sha1_ctx != NULL;
+  SVN_ERR(svn_checksum__md5_sha1_final(&md5_checksum, &sha1_checksum, ctx,
+                                       scratch_pool));
+  memcpy(rep->md5_digest, md5_checksum->digest,
+         svn_checksum_size(md5_checksum));
+  rep->has_sha1 = sha1_checksum != NULL;
   if (rep->has_sha1)
-    {
-      SVN_ERR(svn_checksum_final(&checksum, sha1_ctx, scratch_pool));
-      memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
-    }
+    memcpy(rep->sha1_digest, sha1_checksum->digest,
+           svn_checksum_size(sha1_checksum));
 
   return SVN_NO_ERROR;
 }
@@ -2603,8 +2599,7 @@ rep_write_contents_close(void *baton)
   rep->id.change_set = svn_fs_x__change_set_by_txn(txn_id);
 
   /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  SVN_ERR(digests_final(rep, b->checksum_ctx, b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
@@ -2778,10 +2773,8 @@ typedef struct write_container_baton_t
 
   apr_size_t size;
 
-  svn_checksum_ctx_t *md5_ctx;
-
-  /* SHA1 calculation is optional. If not needed, this will be NULL. */
-  svn_checksum_ctx_t *sha1_ctx;
+  /* SHA1 calculation is optional and may be disabled in this context. */
+  svn_checksum__md5_sha1_ctx_t *checksum_ctx;
 } write_container_baton_t;
 
 /* The handler for the write_container_rep stream.  BATON is a
@@ -2794,9 +2787,7 @@ write_container_handler(void *baton,
 {
   write_container_baton_t *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
-  if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+  SVN_ERR(svn_checksum__md5_sha1_update(whb->checksum_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2886,7 +2877,7 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   apr_off_t offset = 0;
 
   write_container_baton_t *whb;
-  int diff_version = 1;
+  int diff_version = ffd->delta_svndiff_version;
   svn_boolean_t is_props = (item_type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_X__ITEM_TYPE_DIR_PROPS);
 
@@ -2929,9 +2920,10 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
                                         scratch_pool);
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_X__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__md5_sha1_ctx_create(item_type
+                                          != SVN_FS_X__ITEM_TYPE_DIR_REP,
+                                        scratch_pool);
 
   /* serialize the hash */
   stream = svn_stream_create(whb, scratch_pool);
@@ -2941,7 +2933,7 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   SVN_ERR(svn_stream_close(whb->stream));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   SVN_ERR(svn_io_file_get_offset(&rep_end, file, scratch_pool));
@@ -1068,6 +1068,28 @@ svn_error_t *svn_ra_get_file_revs2(svn_ra_session_t *session,
   return svn_error_trace(err);
 }
 
+svn_error_t *svn_ra_blame(svn_ra_session_t *session,
+                          const char *path,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          const svn_diff_file_options_t *diff_options,
+                          svn_ra_blame_receiver_t receiver,
+                          void *receiver_baton,
+                          apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(svn_relpath_is_canonical(path));
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(start) && SVN_IS_VALID_REVNUM(end)
+                 && start <= end);
+  if (!session->vtable->blame)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL, NULL);
+
+  SVN_ERR(svn_ra__assert_capable_server(session, SVN_RA_CAPABILITY_BLAME,
+                                        NULL, scratch_pool));
+
+  return session->vtable->blame(session, path, start, end, diff_options,
+                                receiver, receiver_baton, scratch_pool);
+}
+
 svn_error_t *svn_ra_lock(svn_ra_session_t *session,
                          apr_hash_t *path_revs,
                          const char *comment,
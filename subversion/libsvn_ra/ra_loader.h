@@ -345,6 +345,16 @@ typedef struct svn_ra__vtable_t {
                        void *receiver_baton,
                        apr_pool_t *scratch_pool);
 
+  /* See svn_ra_blame(). */
+  svn_error_t *(*blame)(svn_ra_session_t *session,
+                        const char *path,
+                        svn_revnum_t start,
+                        svn_revnum_t end,
+                        const svn_diff_file_options_t *diff_options,
+                        svn_ra_blame_receiver_t receiver,
+                        void *receiver_baton,
+                        apr_pool_t *scratch_pool);
+
   /* Experimental support below here */
 
   /* See svn_ra__register_editor_shim_callbacks() */
@@ -1676,6 +1676,7 @@ svn_ra_local__has_capability(svn_ra_session_t *session,
       || strcmp(capability, SVN_RA_CAPABILITY_EPHEMERAL_TXNPROPS) == 0
       || strcmp(capability, SVN_RA_CAPABILITY_GET_FILE_REVS_REVERSE) == 0
       || strcmp(capability, SVN_RA_CAPABILITY_LIST) == 0
+      || strcmp(capability, SVN_RA_CAPABILITY_BLAME) == 0
       )
     {
       *has = TRUE;
@@ -1866,6 +1867,55 @@ svn_ra_local__list(svn_ra_session_t *session,
                                         sess->callback_baton, pool));
 }
 
+/* Baton type to be used with blame_receiver. */
+typedef struct blame_receiver_baton_t
+{
+  svn_ra_blame_receiver_t receiver;
+  void *receiver_baton;
+} blame_receiver_baton_t;
+
+/* Implement svn_repos_blame_receiver_t by forwarding to the
+ * svn_ra_blame_receiver_t in BATON. */
+static svn_error_t *
+blame_receiver(apr_int64_t start_line,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  blame_receiver_baton_t *b = baton;
+  return b->receiver(start_line, revision, rev_props, b->receiver_baton,
+                     scratch_pool);
+}
+
+static svn_error_t *
+svn_ra_local__blame(svn_ra_session_t *session,
+                    const char *path,
+                    svn_revnum_t start,
+                    svn_revnum_t end,
+                    const svn_diff_file_options_t *diff_options,
+                    svn_ra_blame_receiver_t receiver,
+                    void *receiver_baton,
+                    apr_pool_t *scratch_pool)
+{
+  svn_ra_local__session_baton_t *sess = session->priv;
+  const char *abs_path = svn_fspath__join(sess->fs_path->data, path,
+                                          scratch_pool);
+
+  blame_receiver_baton_t baton;
+  baton.receiver = receiver;
+  baton.receiver_baton = receiver_baton;
+
+  return svn_error_trace(svn_repos_blame(sess->repos, abs_path, start, end,
+                                         diff_options, NULL, NULL,
+                                         blame_receiver, &baton,
+                                         sess->callbacks
+                                           ? sess->callbacks->cancel_func
+                                           : NULL,
+                                         sess->callback_baton,
+                                         scratch_pool));
+}
+
 /*----------------------------------------------------------------*/
 
 static const svn_version_t *
@@ -1917,6 +1967,7 @@ static const svn_ra__vtable_t ra_local_vtable =
   svn_ra_local__get_inherited_props,
   NULL /* set_svn_ra_open */,
   svn_ra_local__list ,
+  svn_ra_local__blame,
   svn_ra_local__register_editor_shim_callbacks,
   svn_ra_local__get_commit_ev2,
   NULL /* replay_range_ev2 */
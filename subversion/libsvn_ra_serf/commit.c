@@ -1886,6 +1886,8 @@ negotiate_put_encoding(int *svndiff_version_p,
       if (session->supports_svndiff2 &&
           svn_ra_serf__is_low_latency_connection(session))
         svndiff_version = 2;
+      else if (session->supports_svndiff4)
+        svndiff_version = 4;
       else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
@@ -1895,15 +1897,17 @@ negotiate_put_encoding(int *svndiff_version_p,
     }
   else if (session->using_compression == svn_tristate_true)
     {
-      /* Otherwise, prefer svndiff1, as svndiff2 is not a reasonable
-       * substitute for svndiff1 with default compression level.  (It gives
-       * better speed and compression ratio comparable to svndiff1 with
-       * compression level 1, but not 5).
+      /* Otherwise, prefer svndiff4 and then svndiff1, as svndiff2 is not
+       * a reasonable substitute for svndiff1 with default compression
+       * level.  (It gives better speed and compression ratio comparable to
+       * svndiff1 with compression level 1, but not 5).
        *
        * Note: For future compatibility, we also handle a theoretically
        * possible case where the server has advertised only svndiff2 support.
        */
-      if (session->supports_svndiff1)
+      if (session->supports_svndiff4)
+        svndiff_version = 4;
+      else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
         svndiff_version = 2;
@@ -0,0 +1,261 @@
+/*
+ * get_blame.c :  entry point for the server-side blame RA function
+ *                in ra_serf
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <apr_uri.h>
+#include <serf.h>
+
+#include "svn_hash.h"
+#include "svn_base64.h"
+#include "svn_xml.h"
+#include "svn_diff.h"
+
+#include "svn_private_config.h"
+
+#include "ra_serf.h"
+#include "../libsvn_ra/ra_loader.h"
+
+
+
+/*
+ * This enum represents the current state of our XML parsing for a REPORT.
+ */
+enum blame_report_state_e {
+  INITIAL = XML_STATE_INITIAL,
+  REPORT,
+  CHUNK,
+  REV_PROP
+};
+
+typedef struct blame_report_context_t {
+  apr_pool_t *pool;
+
+  /* parameters set by our caller */
+  const char *path;
+  svn_revnum_t start;
+  svn_revnum_t end;
+  const svn_diff_file_options_t *diff_options;
+
+  /* The server sends the revision properties only with the first chunk
+     of each revision.  Maps revision numbers to property hashes, all
+     allocated in POOL. */
+  apr_hash_t *rev_props;
+
+  /* blame receiver function and baton */
+  svn_ra_blame_receiver_t receiver;
+  void *receiver_baton;
+} blame_report_context_t;
+
+#define S_ SVN_XML_NAMESPACE
+static const svn_ra_serf__xml_transition_t blame_report_ttable[] = {
+  { INITIAL, S_, "blame-report", REPORT,
+    FALSE, { NULL }, FALSE },
+
+  { REPORT, S_, "chunk", CHUNK,
+    FALSE, { "line", "?rev", NULL }, TRUE },
+
+  { CHUNK, S_, "rev-prop", REV_PROP,
+    TRUE, { "name", "?encoding", NULL }, TRUE },
+
+  { 0 }
+};
+
+/* Return the property hash for REVISION in BLAME_CTX, creating it if
+   it does not exist yet. */
+static apr_hash_t *
+get_rev_props(blame_report_context_t *blame_ctx,
+              svn_revnum_t revision)
+{
+  apr_hash_t *props = apr_hash_get(blame_ctx->rev_props, &revision,
+                                   sizeof(revision));
+  if (!props)
+    {
+      svn_revnum_t *key = apr_pmemdup(blame_ctx->pool, &revision,
+                                      sizeof(revision));
+      props = apr_hash_make(blame_ctx->pool);
+      apr_hash_set(blame_ctx->rev_props, key, sizeof(*key), props);
+    }
+
+  return props;
+}
+
+/* Conforms to svn_ra_serf__xml_closed_t  */
+static svn_error_t *
+blame_report_closed(svn_ra_serf__xml_estate_t *xes,
+                    void *baton,
+                    int leaving_state,
+                    const svn_string_t *cdata,
+                    apr_hash_t *attrs,
+                    apr_pool_t *scratch_pool)
+{
+  blame_report_context_t *blame_ctx = baton;
+
+  if (leaving_state == REV_PROP)
+    {
+      apr_hash_t *gathered = svn_ra_serf__xml_gather_since(xes, CHUNK);
+      const char *rev_str = svn_hash_gets(gathered, "rev");
+      const char *name = svn_hash_gets(attrs, "name");
+      const char *encoding = svn_hash_gets(attrs, "encoding");
+      svn_revnum_t revision;
+      const svn_string_t *value;
+
+      if (!rev_str)
+        return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                                _("Revision property without revision"));
+      SVN_ERR(svn_revnum_parse(&revision, rev_str, NULL));
+
+      if (encoding && strcmp(encoding, "base64") == 0)
+        value = svn_base64_decode_string(cdata, blame_ctx->pool);
+      else
+        value = svn_string_dup(cdata, blame_ctx->pool);
+
+      svn_hash_sets(get_rev_props(blame_ctx, revision),
+                    apr_pstrdup(blame_ctx->pool, name), value);
+    }
+  else if (leaving_state == CHUNK)
+    {
+      const char *line_str = svn_hash_gets(attrs, "line");
+      const char *rev_str = svn_hash_gets(attrs, "rev");
+      apr_int64_t start_line;
+      svn_revnum_t revision = SVN_INVALID_REVNUM;
+      apr_hash_t *props = NULL;
+
+      SVN_ERR(svn_cstring_atoi64(&start_line, line_str));
+      if (rev_str)
+        {
+          SVN_ERR(svn_revnum_parse(&revision, rev_str, NULL));
+          props = get_rev_props(blame_ctx, revision);
+        }
+
+      SVN_ERR(blame_ctx->receiver(start_line, revision, props,
+                                  blame_ctx->receiver_baton, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__request_body_delegate_t */
+static svn_error_t *
+create_blame_report_body(serf_bucket_t **body_bkt,
+                         void *baton,
+                         serf_bucket_alloc_t *alloc,
+                         apr_pool_t *pool /* request pool */,
+                         apr_pool_t *scratch_pool)
+{
+  serf_bucket_t *buckets;
+  blame_report_context_t *blame_ctx = baton;
+  const svn_diff_file_options_t *diff_options = blame_ctx->diff_options;
+
+  buckets = serf_bucket_aggregate_create(alloc);
+
+  svn_ra_serf__add_open_tag_buckets(buckets, alloc,
+                                    "S:blame-report",
+                                    "xmlns:S", SVN_XML_NAMESPACE,
+                                    SVN_VA_NULL);
+
+  svn_ra_serf__add_tag_buckets(buckets,
+                               "S:path", blame_ctx->path,
+                               alloc);
+  svn_ra_serf__add_tag_buckets(buckets,
+                               "S:start-revision",
+                               apr_ltoa(pool, blame_ctx->start),
+                               alloc);
+  svn_ra_serf__add_tag_buckets(buckets,
+                               "S:end-revision",
+                               apr_ltoa(pool, blame_ctx->end),
+                               alloc);
+
+  if (diff_options->ignore_space == svn_diff_file_ignore_space_change)
+    svn_ra_serf__add_tag_buckets(buckets, "S:ignore-space", "change", alloc);
+  else if (diff_options->ignore_space == svn_diff_file_ignore_space_all)
+    svn_ra_serf__add_tag_buckets(buckets, "S:ignore-space", "all", alloc);
+
+  if (diff_options->ignore_eol_style)
+    svn_ra_serf__add_empty_tag_buckets(buckets, alloc,
+                                       "S:ignore-eol-style", SVN_VA_NULL);
+  if (diff_options->histogram)
+    svn_ra_serf__add_empty_tag_buckets(buckets, alloc,
+                                       "S:histogram", SVN_VA_NULL);
+
+  svn_ra_serf__add_close_tag_buckets(buckets, alloc,
+                                     "S:blame-report");
+
+  *body_bkt = buckets;
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_ra_serf__blame(svn_ra_session_t *ra_session,
+                   const char *path,
+                   svn_revnum_t start,
+                   svn_revnum_t end,
+                   const svn_diff_file_options_t *diff_options,
+                   svn_ra_blame_receiver_t receiver,
+                   void *receiver_baton,
+                   apr_pool_t *scratch_pool)
+{
+  blame_report_context_t *blame_ctx;
+  svn_ra_serf__session_t *session = ra_session->priv;
+  svn_ra_serf__handler_t *handler;
+  svn_ra_serf__xml_context_t *xmlctx;
+  const char *req_url;
+
+  blame_ctx = apr_pcalloc(scratch_pool, sizeof(*blame_ctx));
+  blame_ctx->pool = scratch_pool;
+  blame_ctx->path = path;
+  blame_ctx->start = start;
+  blame_ctx->end = end;
+  blame_ctx->diff_options = diff_options;
+  blame_ctx->rev_props = apr_hash_make(scratch_pool);
+  blame_ctx->receiver = receiver;
+  blame_ctx->receiver_baton = receiver_baton;
+
+  /* END is the peg revision of PATH. */
+  SVN_ERR(svn_ra_serf__get_stable_url(&req_url, NULL /* latest_revnum */,
+                                      session,
+                                      NULL /* url */, end,
+                                      scratch_pool, scratch_pool));
+
+  xmlctx = svn_ra_serf__xml_context_create(blame_report_ttable,
+                                           NULL, blame_report_closed, NULL,
+                                           blame_ctx,
+                                           scratch_pool);
+  handler = svn_ra_serf__create_expat_handler(session, xmlctx, NULL,
+                                              scratch_pool);
+
+  handler->method = "REPORT";
+  handler->path = req_url;
+  handler->body_delegate = create_blame_report_body;
+  handler->body_delegate_baton = blame_ctx;
+  handler->body_type = "text/xml";
+
+  SVN_ERR(svn_ra_serf__context_run_one(handler, scratch_pool));
+
+  if (handler->sline.code != 200)
+    SVN_ERR(svn_ra_serf__unexpected_status(handler));
+
+  return SVN_NO_ERROR;
+}
@@ -39,6 +39,7 @@
 #include "../libsvn_ra/ra_loader.h"
 #include "svn_private_config.h"
 #include "private/svn_fspath.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 
@@ -242,11 +243,21 @@ capabilities_headers_iterator_callback(void *baton,
           svn_hash_sets(session->capabilities,
                         SVN_RA_CAPABILITY_LIST, capability_yes);
         }
+      if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_BLAME, vals))
+        {
+          svn_hash_sets(session->capabilities,
+                        SVN_RA_CAPABILITY_BLAME, capability_yes);
+        }
       if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_SVNDIFF2, vals))
         {
           /* Same for svndiff2. */
           session->supports_svndiff2 = TRUE;
         }
+      if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_SVNDIFF4, vals))
+        {
+          /* And svndiff4, which we can only produce with zstd. */
+          session->supports_svndiff4 = svn__zstd_available();
+        }
       if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM, vals))
         {
           session->supports_put_result_checksum = TRUE;
@@ -396,6 +407,8 @@ options_response_handler(serf_request_t *request,
                     capability_no);
       svn_hash_sets(session->capabilities, SVN_RA_CAPABILITY_LIST,
                     capability_no);
+      svn_hash_sets(session->capabilities, SVN_RA_CAPABILITY_BLAME,
+                    capability_no);
 
       /* Then see which ones we can discover. */
       serf_bucket_headers_do(hdrs, capabilities_headers_iterator_callback,
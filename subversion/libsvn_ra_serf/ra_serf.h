@@ -269,6 +269,9 @@ struct svn_ra_serf__session_t {
   /* Indicates whether the server can understand svndiff version 2. */
   svn_boolean_t supports_svndiff2;
 
+  /* Indicates whether the server can understand svndiff version 4. */
+  svn_boolean_t supports_svndiff4;
+
   /* Indicates whether the server sends the result checksum in the response
    * to a successful PUT request. */
   svn_boolean_t supports_put_result_checksum;
@@ -1443,6 +1446,17 @@ svn_ra_serf__list(svn_ra_session_t *ra_session,
                   void *receiver_baton,
                   apr_pool_t *scratch_pool);
 
+/* Implements svn_ra__vtable_t.blame(). */
+svn_error_t *
+svn_ra_serf__blame(svn_ra_session_t *ra_session,
+                   const char *path,
+                   svn_revnum_t start,
+                   svn_revnum_t end,
+                   const svn_diff_file_options_t *diff_options,
+                   svn_ra_blame_receiver_t receiver,
+                   void *receiver_baton,
+                   apr_pool_t *scratch_pool);
+
 /* Request a mergeinfo-report from the URL attached to SESSION,
    and fill in the MERGEINFO hash with the results.
 
@@ -762,6 +762,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* supports_rev_rsrc_replay */
   /* supports_svndiff1 */
   /* supports_svndiff2 */
+  /* supports_svndiff4 */
   /* supports_put_result_checksum */
   /* conn_latency */
 
@@ -1068,6 +1069,7 @@ static const svn_ra__vtable_t serf_vtable = {
   svn_ra_serf__get_inherited_props,
   NULL /* set_svn_ra_open */,
   svn_ra_serf__list,
+  svn_ra_serf__blame,
   svn_ra_serf__register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
   NULL /* replay_range_ev2 */
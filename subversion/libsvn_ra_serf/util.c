@@ -45,6 +45,7 @@
 #include "private/svn_fspath.h"
 #include "private/svn_auth_private.h"
 #include "private/svn_cert.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 
@@ -2062,7 +2063,9 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
          don't care about worse compression ratio. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
+        svn__zstd_available()
+          ? "gzip,svndiff2;q=0.9,svndiff4;q=0.85,svndiff1;q=0.8,svndiff;q=0.7"
+          : "gzip,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
     }
   else
     {
@@ -2070,10 +2073,14 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
          svndiff2 is not a reasonable substitute for svndiff1 with default
          compression level, because, while it is faster, it also gives worse
          compression ratio.  While we can use svndiff2 in some cases (see
-         above), we can't do this generally. */
+         above), we can't do this generally.  svndiff4 gives a ratio at
+         least as good as svndiff1 and decodes faster, so prefer it if we
+         have been built with zstd. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7");
+        svn__zstd_available()
+          ? "gzip,svndiff4;q=0.95,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7"
+          : "gzip,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7");
     }
 }
 
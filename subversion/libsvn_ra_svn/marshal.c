@@ -273,13 +273,17 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   if (svn_ra_svn_compression_level(conn) <= 0)
     return 0;
 
-  /* Prefer SVNDIFF2 over SVNDIFF1. */
+  /* Prefer SVNDIFF4 over SVNDIFF2 over SVNDIFF1.  SVNDIFF4 requires
+   * zstd support on both sides. */
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF4_ACCEPTED)
+      && svn__zstd_available())
+    return 4;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
     return 2;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
     return 1;
 
-  /* The connection does not support SVNDIFF1/2; default to "version 0". */
+  /* The connection does not support SVNDIFF1/2/4; default to "version 0". */
   return 0;
 }
 
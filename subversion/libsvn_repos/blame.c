@@ -0,0 +1,797 @@
+/* blame.c : calculating blame information in the repository
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_diff.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_subr_private.h"
+#include "svn_private_config.h"
+
+#include "repos.h"
+
+
+
+/* The line-origin map of a file node revision is an array of line_run_t.
+ * The runs are ordered by their START line.  The first one starts at
+ * line 0 and each run extends up to the start of the next one, the last
+ * run up to the end of the file.  There are no empty runs and no two
+ * adjacent runs with the same REVISION.  An empty file has no runs.
+ *
+ * The maps always describe the whole history of the node, i.e. they are
+ * independent of any revision range or authz restrictions.  This allows
+ * us to cache them per node revision.
+ */
+typedef struct line_run_t
+{
+  /* First line of the run. */
+  apr_int64_t start;
+
+  /* The revision in which these lines have last been changed. */
+  svn_revnum_t revision;
+} line_run_t;
+
+/* A location in the history of the blamed file. */
+typedef struct location_t
+{
+  const char *path;
+  svn_revnum_t revision;
+
+  /* Key of the node revision in the line-origin cache. */
+  const char *key;
+} location_t;
+
+/* Baton used with the svn_diff_output_fns_t callbacks when applying the
+ * diff between two file revisions to the line-origin map of the first. */
+typedef struct apply_baton_t
+{
+  /* Line-origin map of the original file. */
+  const apr_array_header_t *runs;
+
+  /* Index of the run in RUNS that contains ORIGINAL_POS. */
+  int current;
+
+  /* The next original line to process and the line in the modified file
+   * that it corresponds to. */
+  apr_int64_t original_pos;
+  apr_int64_t modified_pos;
+
+  /* The revision to blame changed lines on. */
+  svn_revnum_t revision;
+
+  /* Line-origin map of the modified file, being built. */
+  apr_array_header_t *result;
+} apply_baton_t;
+
+
+
+/* Implements svn_cache__serialize_func_t for line-origin maps.
+ * The runs get stored as varint-encoded pairs of line deltas and
+ * revisions, preceded by the number of runs. */
+static svn_error_t *
+serialize_runs(void **data,
+               apr_size_t *data_len,
+               void *in,
+               apr_pool_t *pool)
+{
+  const apr_array_header_t *runs = in;
+  unsigned char *buffer, *p;
+  apr_int64_t last_start = 0;
+  int i;
+
+  buffer = apr_palloc(pool, (2 * runs->nelts + 1)
+                            * SVN__MAX_ENCODED_UINT_LEN);
+  p = svn__encode_uint(buffer, runs->nelts);
+  for (i = 0; i < runs->nelts; ++i)
+    {
+      const line_run_t *run = &APR_ARRAY_IDX(runs, i, line_run_t);
+
+      p = svn__encode_uint(p, run->start - last_start);
+      p = svn__encode_uint(p, run->revision);
+      last_start = run->start;
+    }
+
+  *data = buffer;
+  *data_len = p - buffer;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for line-origin maps. */
+static svn_error_t *
+deserialize_runs(void **out,
+                 void *data,
+                 apr_size_t data_len,
+                 apr_pool_t *pool)
+{
+  const unsigned char *p = data;
+  const unsigned char *end = p + data_len;
+  apr_array_header_t *runs;
+  apr_uint64_t count, value;
+  apr_int64_t start = 0;
+
+  p = svn__decode_uint(&count, p, end);
+  if (p == NULL || count > data_len)
+    return svn_error_create(SVN_ERR_CORRUPT_PACKED_DATA, NULL,
+                            _("Malformed line-origin map"));
+
+  runs = apr_array_make(pool, (int)count, sizeof(line_run_t));
+  while (runs->nelts < (int)count)
+    {
+      line_run_t *run = apr_array_push(runs);
+
+      p = svn__decode_uint(&value, p, end);
+      if (p == NULL)
+        break;
+      start += value;
+      run->start = start;
+
+      p = svn__decode_uint(&value, p, end);
+      if (p == NULL)
+        break;
+      run->revision = (svn_revnum_t)value;
+    }
+
+  if (p != end)
+    return svn_error_create(SVN_ERR_CORRUPT_PACKED_DATA, NULL,
+                            _("Malformed line-origin map"));
+
+  *out = runs;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__error_handler_t.  The line-origin cache is only an
+ * optimization, so we simply recalculate whatever we could not read. */
+static svn_error_t *
+ignore_cache_errors(svn_error_t *err,
+                    void *baton,
+                    apr_pool_t *pool)
+{
+  svn_error_clear(err);
+  return SVN_NO_ERROR;
+}
+
+/* Set *CACHE to the line-origin cache of REPOS, creating it if necessary.
+ * The data lives in the global membuffer cache and, if the filesystem has
+ * a persistent cache store, in that store as well.  Set *CACHE to NULL if
+ * neither is available.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+get_blame_cache(svn_cache__t **cache,
+                svn_repos_t *repos,
+                apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  svn_fs_fs__ioctl_get_disk_cache_output_t *output;
+  svn_cache__t *disk_cache = NULL;
+  const char *uuid;
+  const char *prefix;
+  svn_error_t *err;
+
+  if (repos->blame_cache)
+    {
+      *cache = repos->blame_cache;
+      return SVN_NO_ERROR;
+    }
+
+  /* Only FSFS may provide a persistent cache store. */
+  err = svn_fs_ioctl(repos->fs, SVN_FS_FS__IOCTL_GET_DISK_CACHE, NULL,
+                     (void **)&output, NULL, NULL, scratch_pool,
+                     scratch_pool);
+  if (err && err->apr_err == SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE)
+    {
+      svn_error_clear(err);
+      output = NULL;
+    }
+  else
+    SVN_ERR(err);
+
+  /* The disk cache survives the repository, so tell a recreated one with
+     the same UUID apart by its instance ID. */
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+  prefix = apr_pstrcat(scratch_pool, "blame:", uuid,
+                       output ? ":" : "", output ? output->instance_id : "",
+                       "/", svn_fs_path(repos->fs, scratch_pool), ":",
+                       SVN_VA_NULL);
+
+  if (membuffer)
+    SVN_ERR(svn_cache__create_membuffer_cache(&repos->blame_cache,
+                                              membuffer,
+                                              serialize_runs,
+                                              deserialize_runs,
+                                              APR_HASH_KEY_STRING,
+                                              prefix,
+                                       SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                              TRUE, /* thread_safe */
+                                              FALSE, /* short_lived */
+                                              repos->pool,
+                                              scratch_pool));
+
+  if (output && output->disk_cache)
+    SVN_ERR(svn_cache__create_disk(&disk_cache, output->disk_cache,
+                                   serialize_runs, deserialize_runs,
+                                   APR_HASH_KEY_STRING, prefix,
+                                   repos->pool));
+
+  if (repos->blame_cache && disk_cache)
+    SVN_ERR(svn_cache__create_tiered(&repos->blame_cache,
+                                     repos->blame_cache, disk_cache,
+                                     repos->pool));
+  else if (disk_cache)
+    repos->blame_cache = disk_cache;
+
+  if (repos->blame_cache)
+    SVN_ERR(svn_cache__set_error_handler(repos->blame_cache,
+                                         ignore_cache_errors, NULL,
+                                         scratch_pool));
+
+  *cache = repos->blame_cache;
+  return SVN_NO_ERROR;
+}
+
+
+
+/* Append a run of lines starting at START and last changed in REVISION
+ * to RUNS.  Merge it with the last run if it has the same REVISION. */
+static void
+append_run(apr_array_header_t *runs,
+           apr_int64_t start,
+           svn_revnum_t revision)
+{
+  line_run_t *run;
+
+  if (runs->nelts
+      && APR_ARRAY_IDX(runs, runs->nelts - 1, line_run_t).revision
+           == revision)
+    return;
+
+  run = apr_array_push(runs);
+  run->start = start;
+  run->revision = revision;
+}
+
+/* Copy the origins of the original lines from AB->ORIGINAL_POS up to
+ * ORIGINAL_END to AB->RESULT, starting at AB->MODIFIED_POS. */
+static void
+copy_lines(apply_baton_t *ab,
+           apr_int64_t original_end)
+{
+  const apr_array_header_t *runs = ab->runs;
+
+  while (ab->original_pos < original_end)
+    {
+      const line_run_t *run;
+      apr_int64_t run_end;
+
+      while (   ab->current + 1 < runs->nelts
+             && APR_ARRAY_IDX(runs, ab->current + 1, line_run_t).start
+                  <= ab->original_pos)
+        ++ab->current;
+
+      run = &APR_ARRAY_IDX(runs, ab->current, line_run_t);
+      append_run(ab->result, ab->modified_pos, run->revision);
+
+      run_end = ab->current + 1 < runs->nelts
+              ? APR_ARRAY_IDX(runs, ab->current + 1, line_run_t).start
+              : original_end;
+      run_end = MIN(run_end, original_end);
+
+      ab->modified_pos += run_end - ab->original_pos;
+      ab->original_pos = run_end;
+    }
+}
+
+/* Implements svn_diff_output_fns_t.output_common. */
+static svn_error_t *
+output_common(void *baton,
+              apr_off_t original_start,
+              apr_off_t original_length,
+              apr_off_t modified_start,
+              apr_off_t modified_length,
+              apr_off_t latest_start,
+              apr_off_t latest_length)
+{
+  apply_baton_t *ab = baton;
+
+  copy_lines(ab, original_start + original_length);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_diff_output_fns_t.output_diff_modified. */
+static svn_error_t *
+output_diff_modified(void *baton,
+                     apr_off_t original_start,
+                     apr_off_t original_length,
+                     apr_off_t modified_start,
+                     apr_off_t modified_length,
+                     apr_off_t latest_start,
+                     apr_off_t latest_length)
+{
+  apply_baton_t *ab = baton;
+
+  copy_lines(ab, original_start);
+  SVN_ERR_ASSERT(ab->modified_pos == modified_start);
+
+  if (modified_length)
+    append_run(ab->result, modified_start, ab->revision);
+
+  ab->original_pos += original_length;
+  ab->modified_pos += modified_length;
+
+  return SVN_NO_ERROR;
+}
+
+static const svn_diff_output_fns_t apply_fns = {
+  output_common,
+  output_diff_modified
+};
+
+/* Write the contents of PATH in ROOT to a temporary file and return its
+ * name in *FILE_PATH.  The file gets deleted when POOL is cleaned up. */
+static svn_error_t *
+write_temp_file(const char **file_path,
+                svn_fs_root_t *root,
+                const char *path,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *pool)
+{
+  svn_stream_t *contents;
+  svn_stream_t *stream;
+
+  SVN_ERR(svn_fs_file_contents(&contents, root, path, pool));
+  SVN_ERR(svn_stream_open_unique(&stream, file_path, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 pool, pool));
+
+  return svn_error_trace(svn_stream_copy3(contents, stream,
+                                          cancel_func, cancel_baton, pool));
+}
+
+/* Collect the history of PATH in REPOS as seen in END, youngest location
+ * first, in *LOCATIONS.  Stop after the first location found in CACHE,
+ * returning its index in *HIT and its line-origin map in *HIT_RUNS, or at
+ * the start of the history, setting *HIT to -1.  Cache keys start with
+ * KEY_PREFIX.  If CACHE is NULL, we cannot store the maps of the older
+ * locations for later use; stop after the first location older than
+ * START instead, setting *HIT to -1 as well.
+ *
+ * If AUTHZ_READ_FUNC is not NULL, check the readability of all locations
+ * down to the first one older than START.  If any of these is unreadable,
+ * set *BASE to the index of the oldest readable location before it, like
+ * svn_repos_get_file_revs2() would stop its history walk there.
+ * Otherwise, set *BASE to -1.  We may need to go beyond that point,
+ * though, to find a cached line-origin map.
+ *
+ * Allocate the results in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+find_locations(apr_array_header_t **locations,
+               int *hit,
+               apr_array_header_t **hit_runs,
+               int *base,
+               svn_repos_t *repos,
+               const char *path,
+               svn_revnum_t start,
+               svn_revnum_t end,
+               svn_cache__t *cache,
+               const char *key_prefix,
+               svn_repos_authz_func_t authz_read_func,
+               void *authz_read_baton,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool, *last_pool;
+  svn_fs_history_t *history;
+  svn_fs_root_t *root;
+  svn_node_kind_t kind;
+  svn_boolean_t check_authz = (authz_read_func != NULL);
+
+  *locations = apr_array_make(result_pool, 16, sizeof(location_t));
+  *hit = -1;
+  *hit_runs = NULL;
+  *base = -1;
+
+  /* We switch between two pools while looping, since the history object
+     of the last iteration needs to remain available. */
+  iterpool = svn_pool_create(scratch_pool);
+  last_pool = svn_pool_create(scratch_pool);
+
+  /* The path had better be a file in this revision. */
+  SVN_ERR(svn_fs_revision_root(&root, repos->fs, end, scratch_pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, path, scratch_pool));
+  if (kind != svn_node_file)
+    return svn_error_createf(SVN_ERR_FS_NOT_FILE, NULL,
+                             _("'%s' is not a file in revision %ld"),
+                             path, end);
+
+  SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool,
+                               scratch_pool));
+  while (1)
+    {
+      location_t *location;
+      const svn_fs_id_t *id;
+      const char *tmp_path;
+      svn_revnum_t tmp_revnum;
+      svn_fs_root_t *tmp_root;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
+                                   iterpool));
+      if (!history)
+        break;
+      SVN_ERR(svn_fs_history_location(&tmp_path, &tmp_revnum,
+                                      history, iterpool));
+      SVN_ERR(svn_fs_revision_root(&tmp_root, repos->fs, tmp_revnum,
+                                   iterpool));
+
+      if (check_authz)
+        {
+          svn_boolean_t readable;
+
+          SVN_ERR(authz_read_func(&readable, tmp_root, tmp_path,
+                                  authz_read_baton, iterpool));
+          if (!readable)
+            {
+              if ((*locations)->nelts == 0)
+                return svn_error_createf(SVN_ERR_AUTHZ_UNREADABLE, NULL,
+                                         _("Path '%s' is not readable in "
+                                           "revision %ld"),
+                                         tmp_path, tmp_revnum);
+
+              *base = (*locations)->nelts - 1;
+              check_authz = FALSE;
+            }
+        }
+
+      SVN_ERR(svn_fs_node_id(&id, tmp_root, tmp_path, iterpool));
+
+      location = apr_array_push(*locations);
+      location->path = apr_pstrdup(result_pool, tmp_path);
+      location->revision = tmp_revnum;
+      location->key = apr_pstrcat(result_pool, key_prefix,
+                                  svn_fs_unparse_id(id, iterpool)->data,
+                                  SVN_VA_NULL);
+
+      /* Readability only matters down to the state before START. */
+      if (tmp_revnum < start)
+        check_authz = FALSE;
+
+      if (cache && *hit < 0)
+        {
+          svn_boolean_t found;
+
+          SVN_ERR(svn_cache__get((void **)hit_runs, &found, cache,
+                                 location->key, result_pool));
+          if (found)
+            *hit = (*locations)->nelts - 1;
+        }
+
+      if (*hit >= 0 && !check_authz)
+        break;
+
+      /* All lines of this location are older than START, so they will
+         be reported as such no matter where they originate. */
+      if (!cache && tmp_revnum < start)
+        break;
+
+      /* Swap pools. */
+      {
+        apr_pool_t *tmp_pool = iterpool;
+        iterpool = last_pool;
+        last_pool = tmp_pool;
+      }
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(last_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Calculate the line-origin map of the file at LOCATIONS[0] in REPOS and
+ * return it in *RUNS.  If HIT is not negative, it is the index of the
+ * first location in LOCATIONS with a known map HIT_RUNS.  Otherwise,
+ * all lines of the last location in LOCATIONS are attributed to it.
+ * That is exact for the first revision of the file and good enough for
+ * a location older than the blame range.  Unless CACHE is NULL, store
+ * the maps of all locations younger than that in it.
+ *
+ * Allocate *RUNS in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+calculate_runs(apr_array_header_t **runs,
+               svn_repos_t *repos,
+               const apr_array_header_t *locations,
+               int hit,
+               apr_array_header_t *hit_runs,
+               const svn_diff_file_options_t *diff_options,
+               svn_cache__t *cache,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool, *last_pool;
+  apr_pool_t *file_pool = NULL;
+  const location_t *last;
+  svn_fs_root_t *last_root;
+  const char *last_file = NULL;
+  apr_array_header_t *last_runs;
+  int i;
+
+  /* Nothing to do if we know the youngest one already. */
+  if (hit == 0)
+    {
+      *runs = hit_runs;
+      return SVN_NO_ERROR;
+    }
+
+  /* We switch between two pools while looping, since we need the root
+     and the line-origin map of the last iteration. */
+  iterpool = svn_pool_create(scratch_pool);
+  last_pool = svn_pool_create(scratch_pool);
+
+  if (hit > 0)
+    {
+      last = &APR_ARRAY_IDX(locations, hit, location_t);
+      last_runs = hit_runs;
+      SVN_ERR(svn_fs_revision_root(&last_root, repos->fs, last->revision,
+                                   last_pool));
+    }
+  else
+    {
+      svn_filesize_t length;
+
+      /* All lines of the first revision of the file originate there.
+         Without a cache, we may have stopped at an older location than
+         START; its lines then count as unchanged since before START. */
+      hit = locations->nelts - 1;
+      last = &APR_ARRAY_IDX(locations, hit, location_t);
+      last_runs = apr_array_make(last_pool, 1, sizeof(line_run_t));
+      SVN_ERR(svn_fs_revision_root(&last_root, repos->fs, last->revision,
+                                   last_pool));
+      SVN_ERR(svn_fs_file_length(&length, last_root, last->path,
+                                 last_pool));
+      if (length > 0)
+        append_run(last_runs, 0, last->revision);
+
+      if (cache)
+        SVN_ERR(svn_cache__set(cache, last->key, last_runs, last_pool));
+    }
+
+  for (i = hit - 1; i >= 0; --i)
+    {
+      const location_t *location = &APR_ARRAY_IDX(locations, i, location_t);
+      apr_array_header_t *cur_runs;
+      svn_fs_root_t *root;
+      svn_boolean_t changed;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_fs_revision_root(&root, repos->fs, location->revision,
+                                   iterpool));
+
+      /* Property changes keep all line origins. */
+      SVN_ERR(svn_fs_contents_different(&changed, last_root, last->path,
+                                        root, location->path, iterpool));
+      if (changed)
+        {
+          apr_pool_t *cur_file_pool = svn_pool_create(scratch_pool);
+          const char *cur_file;
+          apply_baton_t ab = { 0 };
+          svn_diff_t *diff;
+
+          /* We only write the contents of a revision to a temporary file
+             when we need it, which is once at most. */
+          if (!last_file)
+            {
+              file_pool = svn_pool_create(scratch_pool);
+              SVN_ERR(write_temp_file(&last_file, last_root, last->path,
+                                      cancel_func, cancel_baton,
+                                      file_pool));
+            }
+          SVN_ERR(write_temp_file(&cur_file, root, location->path,
+                                  cancel_func, cancel_baton, cur_file_pool));
+
+          SVN_ERR(svn_diff_file_diff_2(&diff, last_file, cur_file,
+                                       diff_options, iterpool));
+
+          ab.runs = last_runs;
+          ab.revision = location->revision;
+          ab.result = apr_array_make(iterpool, last_runs->nelts + 1,
+                                     sizeof(line_run_t));
+          SVN_ERR(svn_diff_output2(diff, &ab, &apply_fns,
+                                   cancel_func, cancel_baton));
+          cur_runs = ab.result;
+
+          svn_pool_destroy(file_pool);
+          file_pool = cur_file_pool;
+          last_file = cur_file;
+        }
+      else
+        {
+          cur_runs = apr_array_copy(iterpool, last_runs);
+        }
+
+      if (cache)
+        SVN_ERR(svn_cache__set(cache, location->key, cur_runs, iterpool));
+
+      last = location;
+      last_root = root;
+      last_runs = cur_runs;
+
+      /* Swap pools. */
+      {
+        apr_pool_t *tmp_pool = iterpool;
+        iterpool = last_pool;
+        last_pool = tmp_pool;
+      }
+    }
+
+  *runs = apr_array_copy(result_pool, last_runs);
+
+  if (file_pool)
+    svn_pool_destroy(file_pool);
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(last_pool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos_blame(svn_repos_t *repos,
+                const char *path,
+                svn_revnum_t start,
+                svn_revnum_t end,
+                const svn_diff_file_options_t *diff_options,
+                svn_repos_authz_func_t authz_read_func,
+                void *authz_read_baton,
+                svn_repos_blame_receiver_t receiver,
+                void *receiver_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  svn_diff_file_options_t *options;
+  svn_cache__t *cache;
+  const char *key_prefix;
+  apr_array_header_t *locations;
+  apr_array_header_t *hit_runs;
+  apr_array_header_t *runs;
+  apr_hash_t *rev_props;
+  svn_revnum_t base_rev = SVN_INVALID_REVNUM;
+  svn_revnum_t last_rev = SVN_INVALID_REVNUM;
+  apr_pool_t *iterpool;
+  int hit, base;
+  int i;
+
+  if (!SVN_IS_VALID_REVNUM(start) || !SVN_IS_VALID_REVNUM(end))
+    {
+      svn_revnum_t youngest_rev;
+      SVN_ERR(svn_fs_youngest_rev(&youngest_rev, repos->fs, scratch_pool));
+
+      if (!SVN_IS_VALID_REVNUM(start))
+        start = youngest_rev;
+      if (!SVN_IS_VALID_REVNUM(end))
+        end = youngest_rev;
+    }
+
+  if (end < start)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Cannot calculate blame information for "
+                               "the reverse revision range r%ld:%ld"),
+                             start, end);
+
+  /* Make sure we catch up on the latest revprop changes.  This is the only
+   * time we will refresh the revprop data in this query. */
+  SVN_ERR(svn_fs_refresh_revision_props(repos->fs, scratch_pool));
+
+  /* Only these options affect the lines being matched.  They determine
+   * the line origins and must therefore be part of the cache key. */
+  options = svn_diff_file_options_create(scratch_pool);
+  if (diff_options)
+    {
+      options->ignore_space = diff_options->ignore_space;
+      options->ignore_eol_style = diff_options->ignore_eol_style;
+      options->histogram = diff_options->histogram;
+    }
+
+  key_prefix = apr_psprintf(scratch_pool, "%d%d%d:",
+                            (int)options->ignore_space,
+                            options->ignore_eol_style ? 1 : 0,
+                            options->histogram ? 1 : 0);
+
+  SVN_ERR(get_blame_cache(&cache, repos, scratch_pool));
+  SVN_ERR(find_locations(&locations, &hit, &hit_runs, &base, repos, path,
+                         start, end, cache, key_prefix,
+                         authz_read_func, authz_read_baton,
+                         cancel_func, cancel_baton,
+                         scratch_pool, scratch_pool));
+  SVN_ERR(calculate_runs(&runs, repos, locations, hit, hit_runs, options,
+                         cache, cancel_func, cancel_baton,
+                         scratch_pool, scratch_pool));
+
+  /* Like svn_repos_get_file_revs2(), pretend that the file has been added
+   * in the oldest readable location. */
+  if (base >= 0)
+    base_rev = APR_ARRAY_IDX(locations, base, location_t).revision;
+
+  /* Report the runs, merging those that become indistinguishable. */
+  rev_props = apr_hash_make(scratch_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < runs->nelts; ++i)
+    {
+      const line_run_t *run = &APR_ARRAY_IDX(runs, i, line_run_t);
+      svn_revnum_t revision = run->revision;
+      apr_hash_t *props = NULL;
+
+      svn_pool_clear(iterpool);
+
+      if (SVN_IS_VALID_REVNUM(base_rev) && revision < base_rev)
+        revision = base_rev;
+      if (revision < start)
+        revision = SVN_INVALID_REVNUM;
+
+      if (i > 0 && revision == last_rev)
+        continue;
+      last_rev = revision;
+
+      if (SVN_IS_VALID_REVNUM(revision))
+        {
+          props = apr_hash_get(rev_props, &revision, sizeof(revision));
+          if (!props)
+            {
+              svn_revnum_t *key = apr_pmemdup(scratch_pool, &revision,
+                                              sizeof(revision));
+              SVN_ERR(svn_fs_revision_proplist2(&props, repos->fs, revision,
+                                                FALSE, scratch_pool,
+                                                iterpool));
+              apr_hash_set(rev_props, key, sizeof(*key), props);
+            }
+        }
+
+      SVN_ERR(receiver(run->start, revision, props, receiver_baton,
+                       iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
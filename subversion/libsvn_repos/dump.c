@@ -42,9 +42,11 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_fs_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
 #include "private/svn_fspath.h"
+#include "private/svn_task.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -320,11 +322,13 @@ tracker_path_delete(path_tracker_t *tracker,
    in which case the delta will be computed against an empty file, as
    per the svn_fs_get_file_delta_stream docstring.  Record the length
    of the temporary file in *LEN, and rewind the file before
-   returning. */
+   returning.  Unless COMPRESSION_LEVEL is SVN_DELTA_COMPRESSION_LEVEL_NONE,
+   write the delta in svndiff4 format, compressed at that level. */
 static svn_error_t *
 store_delta(apr_file_t **tempfile, svn_filesize_t *len,
             svn_fs_root_t *oldroot, const char *oldpath,
-            svn_fs_root_t *newroot, const char *newpath, apr_pool_t *pool)
+            svn_fs_root_t *newroot, const char *newpath,
+            int compression_level, apr_pool_t *pool)
 {
   svn_stream_t *temp_stream;
   apr_off_t offset;
@@ -342,8 +346,12 @@ store_delta(apr_file_t **tempfile, svn_filesize_t *len,
   /* Compute the delta and send it to the temporary file. */
   SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, oldroot, oldpath,
                                        newroot, newpath, pool));
-  svn_txdelta_to_svndiff3(&wh, &whb, temp_stream, 0,
-                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  if (compression_level == SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    svn_txdelta_to_svndiff3(&wh, &whb, temp_stream, 0,
+                            SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  else
+    svn_txdelta_to_svndiff3(&wh, &whb, temp_stream, 4, compression_level,
+                            pool);
   SVN_ERR(svn_txdelta_send_txstream(delta_stream, wh, whb, pool));
 
   /* Get the length of the temporary file and rewind it. */
@@ -670,6 +678,10 @@ struct edit_baton
   /* True if dumped nodes should output deltas instead of full text. */
   svn_boolean_t use_deltas;
 
+  /* zstd compression level for deltas or SVN_DELTA_COMPRESSION_LEVEL_NONE
+     for uncompressed deltas. */
+  int deltas_compression_level;
+
   /* True if this "dump" is in fact a verify. */
   svn_boolean_t verify;
 
@@ -1466,7 +1478,8 @@ dump_node(struct edit_baton *eb,
              file, so that we can find its length.  Output a header
              saying our text contents are a delta. */
           SVN_ERR(store_delta(&delta_file, &textlen, compare_root,
-                              compare_path, eb->fs_root, path, pool));
+                              compare_path, eb->fs_root, path,
+                              eb->deltas_compression_level, pool));
           svn_repos__dumpfile_header_push(
             headers, SVN_REPOS_DUMPFILE_TEXT_DELTA, "true");
 
@@ -1891,6 +1904,7 @@ get_dump_editor(const svn_delta_editor_t **editor,
                 void *notify_baton,
                 svn_revnum_t oldest_dumped_rev,
                 svn_boolean_t use_deltas,
+                int deltas_compression_level,
                 svn_boolean_t verify,
                 svn_boolean_t check_normalization,
                 apr_pool_t *pool)
@@ -1913,6 +1927,7 @@ get_dump_editor(const svn_delta_editor_t **editor,
   eb->fs = fs;
   eb->current_rev = to_rev;
   eb->use_deltas = use_deltas;
+  eb->deltas_compression_level = deltas_compression_level;
   eb->verify = verify;
   eb->check_normalization = check_normalization;
   eb->found_old_reference = found_old_reference;
@@ -2023,12 +2038,13 @@ dump_filter_authz_func(svn_boolean_t *allowed,
 
 /* The main dumper. */
 svn_error_t *
-svn_repos_dump_fs4(svn_repos_t *repos,
+svn_repos_dump_fs5(svn_repos_t *repos,
                    svn_stream_t *stream,
                    svn_revnum_t start_rev,
                    svn_revnum_t end_rev,
                    svn_boolean_t incremental,
                    svn_boolean_t use_deltas,
+                   int deltas_compression_level,
                    svn_boolean_t include_revprops,
                    svn_boolean_t include_changes,
                    svn_repos_notify_func_t notify_func,
@@ -2080,6 +2096,16 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                                "(youngest revision is %ld)"),
                              end_rev, youngest);
 
+  /* Compressed deltas require zstd support. */
+  if (!use_deltas)
+    deltas_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+  if (   deltas_compression_level != SVN_DELTA_COMPRESSION_LEVEL_NONE
+      && !svn__zstd_available())
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Compressed deltas require Zstandard support, "
+                              "which is not available in this build of "
+                              "Subversion"));
+
   /* We use read authz callback to implement dump filtering. If there is no
    * read access for some node, it will be excluded from dump as well as
    * references to it (e.g. copy source). */
@@ -2143,7 +2169,8 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                               "", stream, &found_old_reference,
                               &found_old_mergeinfo, NULL,
                               notify_func, notify_baton,
-                              start_rev, use_deltas_for_rev, FALSE, FALSE,
+                              start_rev, use_deltas_for_rev,
+                              deltas_compression_level, FALSE, FALSE,
                               iterpool));
 
       /* Drive the editor in one way or another. */
@@ -2383,7 +2410,8 @@ verify_one_revision(svn_fs_t *fs,
                           verify_close_directory,
                           notify_func, notify_baton,
                           start_rev,
-                          FALSE, TRUE, /* use_deltas, verify */
+                          FALSE, SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                          TRUE, /* use_deltas, level, verify */
                           check_normalization,
                           scratch_pool));
   SVN_ERR(svn_delta_get_cancellation_editor(cancel_func, cancel_baton,
@@ -2459,12 +2487,219 @@ report_error(svn_revnum_t revision,
     }
 }
 
+/* Baton type used by verify_revisions_in_parallel() and its callbacks.
+ * All members are read-only while the worker threads are running. */
+typedef struct verify_parallel_baton_t
+{
+  /* Location and configuration of the file system to verify. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* Revision range to verify. */
+  svn_revnum_t start_rev;
+  svn_boolean_t check_normalization;
+
+  /* Where to send notifications and errors, in revision order. */
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+
+  /* Re-usable notification object for successfully verified revisions. */
+  svn_repos_notify_t *rev_end_notify;
+
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} verify_parallel_baton_t;
+
+/* Outcome of the verification of a single revision as produced by a
+ * worker thread. */
+typedef struct verify_rev_result_t
+{
+  /* Notifications (svn_repos_notify_t *) sent during verification, in the
+   * order they have been received. */
+  apr_array_header_t *notifications;
+
+  /* Verification error.  NULL, if the revision is fine or the error has
+   * been passed on to the verify callback. */
+  svn_error_t *err;
+} verify_rev_result_t;
+
+/* Pool cleanup function for a verify_rev_result_t DATA.  If the run has
+ * been aborted before the result could be reported, the verification
+ * error would otherwise be leaked. */
+static apr_status_t
+clear_rev_result(void *data)
+{
+  verify_rev_result_t *rev_result = data;
+
+  svn_error_clear(rev_result->err);
+  rev_result->err = NULL;
+
+  return APR_SUCCESS;
+}
+
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+ * array of notifications given as BATON. */
+static void
+buffer_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *notifications = baton;
+  apr_pool_t *pool = notifications->pool;
+  svn_repos_notify_t *copy = apr_pmemdup(pool, notify, sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(pool, notify->warning_str);
+  copy->path = apr_pstrdup(pool, notify->path);
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Implements svn_task__thread_context_func_t.  File system objects are
+ * not thread-safe, so open a separate instance for each worker thread. */
+static svn_error_t *
+open_verify_fs(void **thread_context,
+               void *baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  verify_parallel_baton_t *vb = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_open2(&fs, vb->fs_path, vb->fs_config, result_pool,
+                       scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Verify revision
+ * BATON->START_REV + INDEX in the file system given as THREAD_CONTEXT
+ * and return the outcome as a verify_rev_result_t. */
+static svn_error_t *
+verify_rev_task(void **result,
+                void *baton,
+                void *thread_context,
+                apr_int64_t index,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  verify_parallel_baton_t *vb = baton;
+  svn_fs_t *fs = thread_context;
+  svn_revnum_t rev = vb->start_rev + (svn_revnum_t)index;
+  verify_rev_result_t *rev_result = apr_pcalloc(result_pool,
+                                                sizeof(*rev_result));
+
+  rev_result->notifications = apr_array_make(result_pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+  rev_result->err = verify_one_revision(fs, rev,
+                                        vb->notify_func
+                                          ? buffer_notification
+                                          : NULL,
+                                        rev_result->notifications,
+                                        vb->start_rev,
+                                        vb->check_normalization,
+                                        vb->cancel_func, vb->cancel_baton,
+                                        scratch_pool);
+
+  /* Cancellation ends the whole run and is not a verification failure. */
+  if (rev_result->err && rev_result->err->apr_err == SVN_ERR_CANCELLED)
+    return svn_error_trace(rev_result->err);
+
+  /* The run may end before this result gets reported. */
+  apr_pool_cleanup_register(result_pool, rev_result, clear_rev_result,
+                            apr_pool_cleanup_null);
+
+  *result = rev_result;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Report the verify_rev_result_t
+ * RESULT for revision BATON->START_REV + INDEX exactly like the
+ * sequential loop in svn_repos_verify_fs4() would. */
+static svn_error_t *
+report_rev_result(void *baton,
+                  void *result,
+                  apr_int64_t index,
+                  apr_pool_t *scratch_pool)
+{
+  verify_parallel_baton_t *vb = baton;
+  verify_rev_result_t *rev_result = result;
+  svn_revnum_t rev = vb->start_rev + (svn_revnum_t)index;
+  int i;
+
+  if (vb->notify_func)
+    for (i = 0; i < rev_result->notifications->nelts; ++i)
+      vb->notify_func(vb->notify_baton,
+                      APR_ARRAY_IDX(rev_result->notifications, i,
+                                    svn_repos_notify_t *),
+                      scratch_pool);
+
+  if (rev_result->err)
+    {
+      /* report_error() takes ownership of the error. */
+      svn_error_t *err = rev_result->err;
+      rev_result->err = NULL;
+
+      SVN_ERR(report_error(rev, err, vb->verify_callback,
+                           vb->verify_baton, scratch_pool));
+    }
+  else if (vb->notify_func)
+    {
+      vb->rev_end_notify->revision = rev;
+      vb->notify_func(vb->notify_baton, vb->rev_end_notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify revisions START_REV to END_REV in FS using up to JOBS threads.
+ * All other parameters have the same meaning as for
+ * svn_repos_verify_fs4().  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+verify_revisions_in_parallel(svn_fs_t *fs,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             svn_boolean_t check_normalization,
+                             int jobs,
+                             svn_repos_notify_func_t notify_func,
+                             void *notify_baton,
+                             svn_repos_verify_callback_t verify_callback,
+                             void *verify_baton,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool)
+{
+  verify_parallel_baton_t vb;
+
+  vb.fs_path = svn_fs_path(fs, scratch_pool);
+  vb.fs_config = svn_fs_config(fs, scratch_pool);
+  vb.start_rev = start_rev;
+  vb.check_normalization = check_normalization;
+  vb.notify_func = notify_func;
+  vb.notify_baton = notify_baton;
+  vb.verify_callback = verify_callback;
+  vb.verify_baton = verify_baton;
+  vb.rev_end_notify = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                              scratch_pool);
+  vb.cancel_func = cancel_func;
+  vb.cancel_baton = cancel_baton;
+
+  return svn_error_trace(svn_task__run_ordered(end_rev - start_rev + 1, jobs,
+                                               verify_rev_task, &vb,
+                                               open_verify_fs, &vb,
+                                               report_rev_result, &vb,
+                                               cancel_func, cancel_baton,
+                                               scratch_pool));
+}
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2537,7 +2772,16 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
-  if (!metadata_only)
+  if (!metadata_only && jobs > 1 && end_rev > start_rev)
+    {
+      SVN_ERR(verify_revisions_in_parallel(fs, start_rev, end_rev,
+                                           check_normalization, jobs,
+                                           notify_func, notify_baton,
+                                           verify_callback, verify_baton,
+                                           cancel_func, cancel_baton,
+                                           iterpool));
+    }
+  else if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
         svn_pool_clear(iterpool);
@@ -30,6 +30,10 @@
 #include "svn_dirent_uri.h"
 
 #include "private/svn_repos_private.h"
+#include "private/svn_delta_private.h"
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
 
 #include <assert.h>
 
@@ -154,6 +158,13 @@ struct dump_edit_baton {
   /* Pool for per-revision allocations */
   apr_pool_t *pool;
 
+  /* zstd compression level for the text deltas or
+     SVN_DELTA_COMPRESSION_LEVEL_NONE. */
+  int compression_level;
+
+  /* Number of threads to compress text deltas with. */
+  int thread_count;
+
   /* Temporary file used for textdelta application along with its
      absolute path; these two variables should be allocated in the
      per-edit-session pool */
@@ -886,9 +897,15 @@ apply_textdelta(void *file_baton, const char *base_checksum,
   delta_filestream = svn_stream_from_aprfile2(eb->delta_file, TRUE, pool);
 
   /* Prepare to write the delta to the delta_filestream */
-  svn_txdelta_to_svndiff3(handler, handler_baton,
-                          delta_filestream, 0,
-                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  if (eb->compression_level == SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    svn_txdelta_to_svndiff3(handler, handler_baton,
+                            delta_filestream, 0,
+                            SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  else
+    svn_txdelta__to_svndiff_parallel(handler, handler_baton,
+                                     delta_filestream, 4,
+                                     eb->compression_level, NULL,
+                                     eb->thread_count, pool);
 
   /* Record that there's text to be dumped, and its base checksum. */
   fb->dump_text = TRUE;
@@ -999,14 +1016,25 @@ svn_repos__get_dump_editor(const svn_delta_editor_t **editor,
                            void **edit_baton,
                            svn_stream_t *stream,
                            const char *update_anchor_relpath,
+                           int compression_level,
+                           int thread_count,
                            apr_pool_t *pool)
 {
   struct dump_edit_baton *eb;
   svn_delta_editor_t *de;
 
+  if (   compression_level != SVN_DELTA_COMPRESSION_LEVEL_NONE
+      && !svn__zstd_available())
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Compressed deltas require Zstandard support, "
+                              "which is not available in this build of "
+                              "Subversion"));
+
   eb = apr_pcalloc(pool, sizeof(struct dump_edit_baton));
   eb->stream = stream;
   eb->update_anchor_relpath = update_anchor_relpath;
+  eb->compression_level = compression_level;
+  eb->thread_count = thread_count;
   eb->pending_db = NULL;
 
   /* Create a special per-revision pool */
@@ -29,6 +29,8 @@
 #include "svn_fs.h"
 #include "svn_config.h"
 
+#include "private/svn_cache.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -153,6 +155,10 @@ struct svn_repos_t
      those constants' addresses, therefore). */
   apr_hash_t *repository_capabilities;
 
+  /* Line-origin maps of file node revisions as calculated by
+     svn_repos_blame().  NULL until first used. */
+  svn_cache__t *blame_cache;
+
   /* Pool from which this structure was allocated.  Also used for
      auxiliary repository-related data that requires a matching
      lifespan.  (As the svn_repos_t structure tends to be relatively
@@ -25,7 +25,14 @@
 #include <apr.h>
 #include <zlib.h>
 
+#include "svn_sorts.h"
 #include "private/svn_adler32.h"
+#include "private/svn_cpu.h"
+
+#if SVN_CPU__X86_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 /**
  * An Adler-32 implementation per RFC1950.
@@ -41,6 +48,187 @@
  */
 #define ADLER_MOD_BASE 65521
 
+/*
+ * Largest number of bytes that can be added to the running sums before
+ * they must be reduced modulo ADLER_MOD_BASE to prevent overflows.
+ * This is zlib's NMAX.
+ */
+#define ADLER_MAX_RUN 5552
+
+/*
+ * The vectorized implementations process the data in blocks of this size.
+ */
+#define SIMD_BLOCK_SIZE 32
+
+/*
+ * Start with CHECKSUM and update the checksum by processing a chunk
+ * of DATA sized LEN.  LEN must be less than ADLER_MAX_RUN.
+ */
+static apr_uint32_t
+adler32_short(apr_uint32_t checksum, const unsigned char *input,
+              apr_size_t len)
+{
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+  apr_uint32_t b;
+
+  /* Some loop unrolling
+   * (approx. one clock tick per byte + 2 ticks loop overhead)
+   */
+  for (; len >= 8; len -= 8, input += 8)
+    {
+      s1 += input[0]; s2 += s1;
+      s1 += input[1]; s2 += s1;
+      s1 += input[2]; s2 += s1;
+      s1 += input[3]; s2 += s1;
+      s1 += input[4]; s2 += s1;
+      s1 += input[5]; s2 += s1;
+      s1 += input[6]; s2 += s1;
+      s1 += input[7]; s2 += s1;
+    }
+
+  /* Adler-32 calculation as a simple two ticks per iteration loop.
+   */
+  while (len--)
+    {
+      b = *input++;
+      s1 += b;
+      s2 += s1;
+    }
+
+  return ((s2 % ADLER_MOD_BASE) << 16) | (s1 % ADLER_MOD_BASE);
+}
+
+#if SVN_CPU__X86_SIMD
+
+/* The vectorized implementations below follow the same scheme:
+ *
+ * Within a block of SIMD_BLOCK_SIZE bytes, the I-th byte gets added to S1
+ * once and SIMD_BLOCK_SIZE - I times to S2.  The former is what the SAD
+ * instruction against 0 calculates; the latter is a multiply-add with a
+ * vector of descending weights.  Additionally, every block adds
+ * SIMD_BLOCK_SIZE times the S1 value from before that block to S2, which
+ * we accumulate in PS and multiply at the end of each run.
+ */
+
+/* Return the sum of the 4 32 bit values in V. */
+SVN_CPU__TARGET("sse2")
+static APR_INLINE apr_uint32_t
+sum_epi32(__m128i v)
+{
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(v);
+}
+
+/* Start with CHECKSUM and update it with the BLOCKS * SIMD_BLOCK_SIZE
+ * bytes at INPUT, using SSSE3 instructions. */
+SVN_CPU__TARGET("ssse3")
+static apr_uint32_t
+adler32_ssse3(apr_uint32_t checksum, const unsigned char *input,
+              apr_size_t blocks)
+{
+  const __m128i weights_hi = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                           24, 23, 22, 21, 20, 19, 18, 17);
+  const __m128i weights_lo = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                           8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+
+  while (blocks)
+    {
+      apr_size_t run = MIN(blocks, ADLER_MAX_RUN / SIMD_BLOCK_SIZE);
+      __m128i ps = _mm_cvtsi32_si128((int)(s1 * run));
+      __m128i v2 = _mm_cvtsi32_si128((int)s2);
+      __m128i v1 = zero;
+
+      blocks -= run;
+      do
+        {
+          __m128i bytes1 = _mm_loadu_si128((const __m128i *)input);
+          __m128i bytes2 = _mm_loadu_si128((const __m128i *)(input + 16));
+
+          ps = _mm_add_epi32(ps, v1);
+
+          v1 = _mm_add_epi32(v1, _mm_sad_epu8(bytes1, zero));
+          v2 = _mm_add_epi32(v2,
+                             _mm_madd_epi16(_mm_maddubs_epi16(bytes1,
+                                                              weights_hi),
+                                            ones));
+          v1 = _mm_add_epi32(v1, _mm_sad_epu8(bytes2, zero));
+          v2 = _mm_add_epi32(v2,
+                             _mm_madd_epi16(_mm_maddubs_epi16(bytes2,
+                                                              weights_lo),
+                                            ones));
+
+          input += SIMD_BLOCK_SIZE;
+        }
+      while (--run);
+
+      v2 = _mm_add_epi32(v2, _mm_slli_epi32(ps, 5));
+      s1 = (s1 + sum_epi32(v1)) % ADLER_MOD_BASE;
+      s2 = sum_epi32(v2) % ADLER_MOD_BASE;
+    }
+
+  return (s2 << 16) | s1;
+}
+
+/* Start with CHECKSUM and update it with the BLOCKS * SIMD_BLOCK_SIZE
+ * bytes at INPUT, using AVX2 instructions. */
+SVN_CPU__TARGET("avx2")
+static apr_uint32_t
+adler32_avx2(apr_uint32_t checksum, const unsigned char *input,
+             apr_size_t blocks)
+{
+  const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                           24, 23, 22, 21, 20, 19, 18, 17,
+                                           16, 15, 14, 13, 12, 11, 10, 9,
+                                           8, 7, 6, 5, 4, 3, 2, 1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+
+  while (blocks)
+    {
+      apr_size_t run = MIN(blocks, ADLER_MAX_RUN / SIMD_BLOCK_SIZE);
+      __m256i ps = _mm256_setr_epi32((int)(s1 * run), 0, 0, 0, 0, 0, 0, 0);
+      __m256i v2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+      __m256i v1 = zero;
+
+      blocks -= run;
+      do
+        {
+          __m256i bytes = _mm256_loadu_si256((const __m256i *)input);
+
+          ps = _mm256_add_epi32(ps, v1);
+          v1 = _mm256_add_epi32(v1, _mm256_sad_epu8(bytes, zero));
+          v2 = _mm256_add_epi32(v2,
+                                _mm256_madd_epi16(_mm256_maddubs_epi16(bytes,
+                                                                 weights),
+                                                  ones));
+
+          input += SIMD_BLOCK_SIZE;
+        }
+      while (--run);
+
+      v2 = _mm256_add_epi32(v2, _mm256_slli_epi32(ps, 5));
+      s1 = (s1 + sum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v1),
+                                         _mm256_extracti128_si256(v1, 1))))
+         % ADLER_MOD_BASE;
+      s2 = sum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v2),
+                                   _mm256_extracti128_si256(v2, 1)))
+         % ADLER_MOD_BASE;
+    }
+
+  return (s2 << 16) | s1;
+}
+
+#endif /* SVN_CPU__X86_SIMD */
+
 /*
  * Start with CHECKSUM and update the checksum by processing a chunk
  * of DATA sized LEN.
@@ -57,6 +245,22 @@ svn__adler32(apr_uint32_t checksum, const char *data, apr_off_t len)
    */
   if (len >= 80)
     {
+#if SVN_CPU__X86_SIMD
+      apr_uint32_t features = svn_cpu__features();
+      if (features & (SVN_CPU__AVX2 | SVN_CPU__SSSE3))
+        {
+          const unsigned char *input = (const unsigned char *)data;
+          apr_size_t blocks = (apr_size_t)(len / SIMD_BLOCK_SIZE);
+
+          checksum = features & SVN_CPU__AVX2
+                   ? adler32_avx2(checksum, input, blocks)
+                   : adler32_ssse3(checksum, input, blocks);
+
+          return adler32_short(checksum, input + blocks * SIMD_BLOCK_SIZE,
+                               (apr_size_t)(len % SIMD_BLOCK_SIZE));
+        }
+#endif
+
       /* Larger buffers can be efficiently handled by Marc Adler's
        * optimized code. Also, new zlib versions will come with
        * SIMD code for x86 and x64.
@@ -67,35 +271,7 @@ svn__adler32(apr_uint32_t checksum, const char *data, apr_off_t len)
     }
   else
     {
-      const unsigned char *input = (const unsigned char *)data;
-      apr_uint32_t s1 = checksum & 0xFFFF;
-      apr_uint32_t s2 = checksum >> 16;
-      apr_uint32_t b;
-
-      /* Some loop unrolling
-       * (approx. one clock tick per byte + 2 ticks loop overhead)
-       */
-      for (; len >= 8; len -= 8, input += 8)
-        {
-          s1 += input[0]; s2 += s1;
-          s1 += input[1]; s2 += s1;
-          s1 += input[2]; s2 += s1;
-          s1 += input[3]; s2 += s1;
-          s1 += input[4]; s2 += s1;
-          s1 += input[5]; s2 += s1;
-          s1 += input[6]; s2 += s1;
-          s1 += input[7]; s2 += s1;
-        }
-
-      /* Adler-32 calculation as a simple two ticks per iteration loop.
-       */
-      while (len--)
-        {
-          b = *input++;
-          s1 += b;
-          s2 += s1;
-        }
-
-      return ((s2 % ADLER_MOD_BASE) << 16) | (s1 % ADLER_MOD_BASE);
+      return adler32_short(checksum, (const unsigned char *)data,
+                           (apr_size_t)len);
     }
 }
@@ -0,0 +1,902 @@
+/*
+ * cache-disk.c: persistent, disk-backed caching for Subversion
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_md5.h>
+
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+#include "cache.h"
+
+/* A note on the design:
+ *
+ * All data lives in a single log file "data" within the cache directory.
+ * New entries always get appended to it.  Each record consists of a
+ * record_header_t, followed by the full key (cache prefix, NUL, key) and
+ * the serialized value.  Once the log would grow beyond its maximum size,
+ * it gets truncated and the cache starts over.  Appending and truncating
+ * is serialized between processes by an exclusive lock on the "lock" file
+ * in the same directory.
+ *
+ * Each process keeps an in-memory index mapping the MD5 of the full key
+ * to the record offset.  It gets filled lazily by scanning the record
+ * headers in the log, i.e. upon the first lookup after process start and
+ * whenever a lookup misses, we pick up any records that other processes
+ * have added in the meantime.
+ *
+ * Readers don't take the file lock.  Instead, every record read gets
+ * verified against the full key and a checksum over the value.  Thus,
+ * stale index entries e.g. after another process truncated the log simply
+ * produce cache misses.  Records that end beyond the end of the log prove
+ * that it has been truncated, so we rebuild the whole index then.
+ */
+
+/* Marker at the start of every record. */
+#define RECORD_MAGIC 0x53564e43
+
+/* Upper limit for the size of a single value.  Appending a record holds
+ * the cross-process file lock and the value gets read into memory in its
+ * entirety upon lookup.  So, keep this small enough that neither blocks
+ * other processes nor wastes memory for too long. */
+#define MAX_VALUE_SIZE 0x400000
+
+/* Header of every record in the log. */
+typedef struct record_header_t
+{
+  /* Always RECORD_MAGIC. */
+  apr_uint32_t magic;
+
+  /* Length of the full key following this header. */
+  apr_uint32_t key_len;
+
+  /* Length of the serialized value following the key. */
+  apr_uint32_t value_len;
+
+  /* FNV-1a checksum over the value. */
+  apr_uint32_t checksum;
+
+  /* MD5 of the full key.  Allows us to index the log reading just the
+   * headers. */
+  unsigned char digest[APR_MD5_DIGESTSIZE];
+} record_header_t;
+
+/* In-memory index entry for a record in the log. */
+typedef struct entry_t
+{
+  /* Offset of the record header within the log. */
+  apr_off_t offset;
+
+  /* Copied from the record header. */
+  apr_uint32_t key_len;
+  apr_uint32_t value_len;
+} entry_t;
+
+/* The store that may be shared by many svn_cache__t instances. */
+struct svn_cache__disk_t
+{
+  /* The log file, opened for appending. */
+  apr_file_t *data_file;
+
+  /* Lock file to serialize writers between processes. */
+  apr_file_t *lock_file;
+
+  /* Truncate the log before it would grow beyond this size. */
+  apr_off_t max_size;
+
+  /* Maps key digests to entry_t *. */
+  apr_hash_t *index;
+
+  /* INDEX and its entries are allocated in here. */
+  apr_pool_t *index_pool;
+
+  /* All records before this offset have been added to INDEX. */
+  apr_off_t scan_end;
+
+  /* Serializes all access to this structure from within this process. */
+  svn_mutex__t *mutex;
+
+  /* Pool used for the lifetime of this structure. */
+  apr_pool_t *pool;
+};
+
+/* The (internal) cache object. */
+typedef struct disk_cache_t
+{
+  /* The store that holds the data. */
+  svn_cache__disk_t *disk;
+
+  /* A prefix used to differentiate our data from other caches sharing
+   * the same store. */
+  const char *prefix;
+
+  /* The size of the key: either a fixed number of bytes or
+   * APR_HASH_KEY_STRING. */
+  apr_ssize_t klen;
+
+  /* Used to marshal values in and out of the cache. */
+  svn_cache__serialize_func_t serialize_func;
+  svn_cache__deserialize_func_t deserialize_func;
+} disk_cache_t;
+
+/* Key as actually stored in the log.  */
+typedef struct full_key_t
+{
+  /* CACHE->PREFIX, NUL, key. */
+  char *data;
+
+  /* Length of DATA in bytes. */
+  apr_uint32_t len;
+
+  /* MD5 over DATA. */
+  unsigned char digest[APR_MD5_DIGESTSIZE];
+} full_key_t;
+
+/* Construct the FULL_KEY for KEY in CACHE.  Allocate it in POOL. */
+static void
+build_key(full_key_t *full_key,
+          disk_cache_t *cache,
+          const void *key,
+          apr_pool_t *pool)
+{
+  apr_size_t prefix_len = strlen(cache->prefix) + 1;
+  apr_size_t key_len = cache->klen == APR_HASH_KEY_STRING
+                     ? strlen(key)
+                     : (apr_size_t)cache->klen;
+
+  full_key->len = (apr_uint32_t)(prefix_len + key_len);
+  full_key->data = apr_palloc(pool, full_key->len);
+  memcpy(full_key->data, cache->prefix, prefix_len);
+  memcpy(full_key->data + prefix_len, key, key_len);
+
+  apr_md5(full_key->digest, full_key->data, full_key->len);
+}
+
+/* Drop all index information in DISK. */
+static void
+reset_index(svn_cache__disk_t *disk)
+{
+  svn_pool_clear(disk->index_pool);
+  disk->index = apr_hash_make(disk->index_pool);
+  disk->scan_end = 0;
+}
+
+/* Return the maximum size of a value that we will store in DISK. */
+static apr_size_t
+max_value_size(svn_cache__disk_t *disk)
+{
+  return (apr_size_t)MIN(disk->max_size / 8, MAX_VALUE_SIZE);
+}
+
+/* Read LEN bytes at OFFSET from the log in DISK into BUFFER.  Set
+ * *COMPLETE to FALSE if the log ends before that, e.g. because another
+ * process truncated it.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_at(svn_boolean_t *complete,
+        svn_cache__disk_t *disk,
+        void *buffer,
+        apr_size_t len,
+        apr_off_t offset,
+        apr_pool_t *scratch_pool)
+{
+  apr_size_t bytes_read;
+  svn_boolean_t hit_eof;
+
+  SVN_ERR(svn_io_file_seek(disk->data_file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(disk->data_file, buffer, len, &bytes_read,
+                                 &hit_eof, scratch_pool));
+  *complete = bytes_read == len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all records in the log of DISK that have not been indexed yet.
+ * Reset the index if the log has been truncated by some other process.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+catch_up(svn_cache__disk_t *disk,
+         apr_pool_t *scratch_pool)
+{
+  apr_off_t size;
+  svn_boolean_t restarted = FALSE;
+
+  SVN_ERR(svn_io_file_size_get(&size, disk->data_file, scratch_pool));
+  if (size < disk->scan_end)
+    reset_index(disk);
+
+  while (disk->scan_end + (apr_off_t)sizeof(record_header_t) <= size)
+    {
+      record_header_t header;
+      apr_off_t record_end;
+      entry_t *entry;
+      svn_boolean_t complete;
+
+      /* The log may have been truncated since we determined its size.
+       * Records appended later will be found by the next scan. */
+      SVN_ERR(read_at(&complete, disk, &header, sizeof(header),
+                      disk->scan_end, scratch_pool));
+      if (!complete)
+        break;
+
+      if (header.magic != RECORD_MAGIC)
+        {
+          /* The log has been truncated and refilled by some other process
+           * since our last scan.  Start over once.  If the log still
+           * looks broken, ignore its current contents.  Records appended
+           * later will still be found. */
+          if (!restarted && disk->scan_end > 0)
+            {
+              reset_index(disk);
+              restarted = TRUE;
+              continue;
+            }
+
+          disk->scan_end = size;
+          break;
+        }
+
+      /* Still being written? */
+      record_end = disk->scan_end + sizeof(header)
+                 + header.key_len + header.value_len;
+      if (record_end > size)
+        break;
+
+      entry = apr_hash_get(disk->index, header.digest, sizeof(header.digest));
+      if (entry == NULL)
+        {
+          entry = apr_palloc(disk->index_pool, sizeof(*entry));
+          apr_hash_set(disk->index,
+                       apr_pmemdup(disk->index_pool, header.digest,
+                                   sizeof(header.digest)),
+                       sizeof(header.digest), entry);
+        }
+
+      entry->offset = disk->scan_end;
+      entry->key_len = header.key_len;
+      entry->value_len = header.value_len;
+
+      disk->scan_end = record_end;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the record described by ENTRY from the log in DISK and return its
+ * value in *DATA, *SIZE.  The buffer will be allocated in RESULT_POOL and
+ * have an extra NUL terminator.  If the record does not match FULL_KEY
+ * or is damaged, set *DATA to NULL.  If the log ends before the end of
+ * the record, also set *TRUNCATED.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+read_entry(char **data,
+           apr_size_t *size,
+           svn_boolean_t *truncated,
+           svn_cache__disk_t *disk,
+           const entry_t *entry,
+           const full_key_t *full_key,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  record_header_t header;
+  char *stored_key;
+  char *value;
+  svn_boolean_t complete;
+
+  *data = NULL;
+  *size = 0;
+  *truncated = FALSE;
+
+  if (entry->key_len != full_key->len)
+    return SVN_NO_ERROR;
+
+  /* Anything unexpected means that the log has changed underneath our
+   * index and we simply report a miss. */
+  SVN_ERR(read_at(&complete, disk, &header, sizeof(header), entry->offset,
+                  scratch_pool));
+  if (   !complete
+      || header.magic != RECORD_MAGIC
+      || header.key_len != entry->key_len
+      || header.value_len != entry->value_len)
+    {
+      *truncated = !complete;
+      return SVN_NO_ERROR;
+    }
+
+  stored_key = apr_palloc(scratch_pool, header.key_len);
+  value = apr_palloc(result_pool, header.value_len + 1);
+  SVN_ERR(read_at(&complete, disk, stored_key, header.key_len,
+                  entry->offset + sizeof(header), scratch_pool));
+  if (complete)
+    SVN_ERR(read_at(&complete, disk, value, header.value_len,
+                    entry->offset + sizeof(header) + header.key_len,
+                    scratch_pool));
+
+  if (!complete)
+    {
+      *truncated = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  if (   memcmp(stored_key, full_key->data, full_key->len) == 0
+      && svn__fnv1a_32(value, header.value_len) == header.checksum)
+    {
+      value[header.value_len] = '\0';
+      *data = value;
+      *size = header.value_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Core functionality of our getters: look up the record for FULL_KEY in
+ * DISK and return its value in *DATA, *SIZE.  The buffer will be
+ * allocated in RESULT_POOL and have an extra NUL terminator.  If there is
+ * no such record, set *DATA to NULL.
+ *
+ * The caller must hold DISK->MUTEX.
+ */
+static svn_error_t *
+read_record(char **data,
+            apr_size_t *size,
+            svn_cache__disk_t *disk,
+            const full_key_t *full_key,
+            apr_pool_t *result_pool)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(result_pool);
+  entry_t *entry;
+  svn_boolean_t truncated = FALSE;
+
+  *data = NULL;
+  *size = 0;
+
+  entry = apr_hash_get(disk->index, full_key->digest,
+                       sizeof(full_key->digest));
+  if (entry == NULL)
+    {
+      SVN_ERR(catch_up(disk, scratch_pool));
+      entry = apr_hash_get(disk->index, full_key->digest,
+                           sizeof(full_key->digest));
+    }
+
+  if (entry)
+    SVN_ERR(read_entry(data, size, &truncated, disk, entry, full_key,
+                       result_pool, scratch_pool));
+
+  /* The log has been truncated since we indexed ENTRY.  None of our index
+   * data can be trusted anymore.  Re-sync with the current log, which may
+   * contain a new copy of the record, and try once more. */
+  if (truncated)
+    {
+      reset_index(disk);
+      SVN_ERR(catch_up(disk, scratch_pool));
+      entry = apr_hash_get(disk->index, full_key->digest,
+                           sizeof(full_key->digest));
+      if (entry)
+        SVN_ERR(read_entry(data, size, &truncated, disk, entry, full_key,
+                           result_pool, scratch_pool));
+    }
+
+  if (entry && *data == NULL)
+    apr_hash_set(disk->index, full_key->digest, sizeof(full_key->digest),
+                 NULL);
+
+  svn_pool_destroy(scratch_pool);
+  return SVN_NO_ERROR;
+}
+
+/* Append LEN bytes of DATA to the log in DISK.  If DATA is NULL, append
+ * a record that will never verify, i.e. effectively remove FULL_KEY from
+ * the cache.  The caller must hold the file lock and DISK->MUTEX. */
+static svn_error_t *
+append_record(svn_cache__disk_t *disk,
+              const full_key_t *full_key,
+              const void *data,
+              apr_size_t len,
+              apr_pool_t *scratch_pool)
+{
+  record_header_t header;
+  apr_off_t size;
+  apr_off_t record_len = sizeof(header) + full_key->len + len;
+  entry_t *entry;
+
+  /* Pick up what other processes wrote.  Since nobody else may write now,
+   * anything beyond the last complete record is a leftover from an
+   * interrupted write and must be removed. */
+  SVN_ERR(catch_up(disk, scratch_pool));
+  SVN_ERR(svn_io_file_size_get(&size, disk->data_file, scratch_pool));
+  if (size > disk->scan_end)
+    {
+      SVN_ERR(svn_io_file_trunc(disk->data_file, disk->scan_end,
+                                scratch_pool));
+      size = disk->scan_end;
+    }
+
+  /* Start over when the log is full. */
+  if (size + record_len > disk->max_size)
+    {
+      SVN_ERR(svn_io_file_trunc(disk->data_file, 0, scratch_pool));
+      reset_index(disk);
+      size = 0;
+    }
+
+  header.magic = RECORD_MAGIC;
+  header.key_len = full_key->len;
+  header.value_len = (apr_uint32_t)len;
+  header.checksum = data ? svn__fnv1a_32(data, len)
+                         : ~svn__fnv1a_32("", 0);
+  memcpy(header.digest, full_key->digest, sizeof(header.digest));
+
+  SVN_ERR(svn_io_file_write_full(disk->data_file, &header, sizeof(header),
+                                 NULL, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(disk->data_file, full_key->data,
+                                 full_key->len, NULL, scratch_pool));
+  if (len)
+    SVN_ERR(svn_io_file_write_full(disk->data_file, data, len, NULL,
+                                   scratch_pool));
+
+  entry = apr_hash_get(disk->index, full_key->digest,
+                       sizeof(full_key->digest));
+  if (entry == NULL)
+    {
+      entry = apr_palloc(disk->index_pool, sizeof(*entry));
+      apr_hash_set(disk->index,
+                   apr_pmemdup(disk->index_pool, full_key->digest,
+                               sizeof(full_key->digest)),
+                   sizeof(full_key->digest), entry);
+    }
+
+  entry->offset = size;
+  entry->key_len = full_key->len;
+  entry->value_len = (apr_uint32_t)len;
+  disk->scan_end = size + record_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Core functionality of our setters: store LEN bytes of DATA under
+ * FULL_KEY in DISK.  If DATA is NULL, remove FULL_KEY from DISK instead.
+ * Use SCRATCH_POOL for temporary allocations.
+ * The caller must hold DISK->MUTEX.
+ */
+static svn_error_t *
+write_record(svn_cache__disk_t *disk,
+             const full_key_t *full_key,
+             const void *data,
+             apr_size_t len,
+             apr_pool_t *scratch_pool)
+{
+  apr_status_t status;
+  svn_error_t *err;
+
+  status = apr_file_lock(disk->lock_file, APR_FLOCK_EXCLUSIVE);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock disk cache"));
+
+  err = append_record(disk, full_key, data, len, scratch_pool);
+
+  status = apr_file_unlock(disk->lock_file);
+  if (status && !err)
+    err = svn_error_wrap_apr(status, _("Can't unlock disk cache"));
+
+  return svn_error_trace(err);
+}
+
+static svn_error_t *
+disk_cache_get(void **value_p,
+               svn_boolean_t *found,
+               void *cache_void,
+               const void *key,
+               apr_pool_t *result_pool)
+{
+  disk_cache_t *cache = cache_void;
+  full_key_t full_key;
+  char *data;
+  apr_size_t size;
+
+  *value_p = NULL;
+  *found = FALSE;
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  build_key(&full_key, cache, key, result_pool);
+  SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                       read_record(&data, &size, cache->disk, &full_key,
+                                   result_pool));
+  if (data == NULL)
+    return SVN_NO_ERROR;
+
+  if (cache->deserialize_func)
+    {
+      SVN_ERR(cache->deserialize_func(value_p, data, size, result_pool));
+    }
+  else
+    {
+      svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
+      value->data = data;
+      value->blocksize = size + 1;
+      value->len = size;
+      *value_p = value;
+    }
+
+  *found = TRUE;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+disk_cache_has_key(svn_boolean_t *found,
+                   void *cache_void,
+                   const void *key,
+                   apr_pool_t *scratch_pool)
+{
+  disk_cache_t *cache = cache_void;
+  full_key_t full_key;
+  entry_t *entry;
+
+  *found = FALSE;
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  /* Don't read the actual data.  Trust the index. */
+  build_key(&full_key, cache, key, scratch_pool);
+  SVN_ERR(svn_mutex__lock(cache->disk->mutex));
+  entry = apr_hash_get(cache->disk->index, full_key.digest,
+                       sizeof(full_key.digest));
+  if (entry == NULL)
+    {
+      svn_error_t *err = catch_up(cache->disk, scratch_pool);
+      if (!err)
+        entry = apr_hash_get(cache->disk->index, full_key.digest,
+                             sizeof(full_key.digest));
+
+      SVN_ERR(svn_mutex__unlock(cache->disk->mutex, err));
+    }
+  else
+    {
+      SVN_ERR(svn_mutex__unlock(cache->disk->mutex, SVN_NO_ERROR));
+    }
+
+  *found = entry != NULL;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+disk_cache_set(void *cache_void,
+               const void *key,
+               void *value,
+               apr_pool_t *scratch_pool)
+{
+  disk_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  full_key_t full_key;
+  void *data;
+  apr_size_t data_len;
+
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  subpool = svn_pool_create(scratch_pool);
+  if (cache->serialize_func)
+    {
+      SVN_ERR(cache->serialize_func(&data, &data_len, value, subpool));
+    }
+  else
+    {
+      svn_stringbuf_t *value_str = value;
+      data = value_str->data;
+      data_len = value_str->len;
+    }
+
+  if (data_len < max_value_size(cache->disk))
+    {
+      build_key(&full_key, cache, key, subpool);
+      SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                           write_record(cache->disk, &full_key, data,
+                                        data_len, subpool));
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+disk_cache_get_partial(void **value_p,
+                       svn_boolean_t *found,
+                       void *cache_void,
+                       const void *key,
+                       svn_cache__partial_getter_func_t func,
+                       void *baton,
+                       apr_pool_t *result_pool)
+{
+  disk_cache_t *cache = cache_void;
+  full_key_t full_key;
+  char *data;
+  apr_size_t size;
+
+  *found = FALSE;
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  build_key(&full_key, cache, key, result_pool);
+  SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                       read_record(&data, &size, cache->disk, &full_key,
+                                   result_pool));
+  if (data == NULL)
+    return SVN_NO_ERROR;
+
+  *found = TRUE;
+  return svn_error_trace(func(value_p, data, size, baton, result_pool));
+}
+
+static svn_error_t *
+disk_cache_set_partial(void *cache_void,
+                       const void *key,
+                       svn_cache__partial_setter_func_t func,
+                       void *baton,
+                       apr_pool_t *scratch_pool)
+{
+  disk_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  full_key_t full_key;
+  char *data;
+  apr_size_t size;
+
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  subpool = svn_pool_create(scratch_pool);
+  build_key(&full_key, cache, key, subpool);
+  SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                       read_record(&data, &size, cache->disk, &full_key,
+                                   subpool));
+
+  /* If we found it, modify it and write it back to the log. */
+  if (data)
+    {
+      SVN_ERR(func((void **)&data, &size, baton, subpool));
+
+      /* If it became too large, the old value must not survive either. */
+      if (size >= max_value_size(cache->disk))
+        {
+          data = NULL;
+          size = 0;
+        }
+
+      SVN_MUTEX__WITH_LOCK(cache->disk->mutex,
+                           write_record(cache->disk, &full_key, data, size,
+                                        subpool));
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+disk_cache_iter(svn_boolean_t *completed,
+                void *cache_void,
+                svn_iter_apr_hash_cb_t user_cb,
+                void *user_baton,
+                apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a disk cache"));
+}
+
+static svn_boolean_t
+disk_cache_is_cachable(void *cache_void, apr_size_t size)
+{
+  disk_cache_t *cache = cache_void;
+
+  /* Don't let single items flush large parts of the log or block other
+   * processes for long. */
+  return size < max_value_size(cache->disk);
+}
+
+static svn_error_t *
+disk_cache_get_info(void *cache_void,
+                    svn_cache__info_t *info,
+                    svn_boolean_t reset,
+                    apr_pool_t *result_pool)
+{
+  disk_cache_t *cache = cache_void;
+
+  info->id = apr_pstrdup(result_pool, cache->prefix);
+
+  /* The whole log is shared between all caches using the same store. */
+  SVN_ERR(svn_mutex__lock(cache->disk->mutex));
+  info->used_entries = apr_hash_count(cache->disk->index);
+  info->used_size = cache->disk->scan_end;
+  SVN_ERR(svn_mutex__unlock(cache->disk->mutex, SVN_NO_ERROR));
+
+  info->data_size = info->used_size;
+  info->total_size = cache->disk->max_size;
+  info->total_entries = info->used_entries;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_cache__vtable_t disk_cache_vtable = {
+  disk_cache_get,
+  disk_cache_has_key,
+  disk_cache_set,
+  disk_cache_iter,
+  disk_cache_is_cachable,
+  disk_cache_get_partial,
+  disk_cache_set_partial,
+  disk_cache_get_info
+};
+
+svn_error_t *
+svn_cache__create_disk(svn_cache__t **cache_p,
+                       svn_cache__disk_t *disk,
+                       svn_cache__serialize_func_t serialize_func,
+                       svn_cache__deserialize_func_t deserialize_func,
+                       apr_ssize_t klen,
+                       const char *prefix,
+                       apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  disk_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->disk = disk;
+  cache->serialize_func = serialize_func;
+  cache->deserialize_func = deserialize_func;
+  cache->klen = klen;
+  cache->prefix = apr_pstrdup(result_pool, prefix);
+
+  wrapper->vtable = &disk_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
+
+
+/*** Process-wide registry of opened stores. ***/
+
+/* Status of the registry initialization. */
+static volatile svn_atomic_t registry_init_state = 0;
+
+/* Maps absolute store paths to svn_cache__disk_t *.  Never cleaned up. */
+static apr_hash_t *registry = NULL;
+
+/* Serializes access to REGISTRY. */
+static svn_mutex__t *registry_mutex = NULL;
+
+/* Pool that REGISTRY and its mutex live in. */
+static apr_pool_t *registry_pool = NULL;
+
+/* Implements svn_atomic__err_init_func_t. */
+static svn_error_t *
+init_registry(void *baton,
+              apr_pool_t *pool)
+{
+  registry_pool = svn_pool_create(NULL);
+  registry = apr_hash_make(registry_pool);
+
+  return svn_error_trace(svn_mutex__init(&registry_mutex, TRUE,
+                                         registry_pool));
+}
+
+/* Open the store in directory PATH and return it in *DISK_P.  The store
+ * lives in a sub-pool of RESULT_POOL, which may be NULL. */
+static svn_error_t *
+open_store(svn_cache__disk_t **disk_p,
+           const char *path,
+           apr_uint64_t max_size,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool = svn_pool_create(result_pool);
+  svn_cache__disk_t *disk = apr_pcalloc(pool, sizeof(*disk));
+  svn_error_t *err;
+
+  disk->pool = pool;
+  disk->max_size = (apr_off_t)MIN(max_size, APR_INT64_MAX);
+  disk->index_pool = svn_pool_create(pool);
+  disk->index = apr_hash_make(disk->index_pool);
+  disk->scan_end = 0;
+
+  err = svn_io_make_dir_recursively(path, scratch_pool);
+  if (!err)
+    err = svn_io_file_open(&disk->data_file,
+                           svn_dirent_join(path, "data", scratch_pool),
+                           APR_READ | APR_WRITE | APR_APPEND | APR_CREATE
+                             | APR_BINARY,
+                           APR_OS_DEFAULT, pool);
+  if (!err)
+    err = svn_io_file_open(&disk->lock_file,
+                           svn_dirent_join(path, "lock", scratch_pool),
+                           APR_READ | APR_WRITE | APR_CREATE,
+                           APR_OS_DEFAULT, pool);
+  if (!err)
+    err = svn_mutex__init(&disk->mutex, TRUE, pool);
+
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  *disk_p = disk;
+  return SVN_NO_ERROR;
+}
+
+/* Look up the store for PATH in the registry or open and register it.
+ * The caller must hold REGISTRY_MUTEX. */
+static svn_error_t *
+get_store(svn_cache__disk_t **disk_p,
+          const char *path,
+          apr_uint64_t max_size,
+          apr_pool_t *scratch_pool)
+{
+  *disk_p = svn_hash_gets(registry, path);
+  if (*disk_p == NULL)
+    {
+      SVN_ERR(open_store(disk_p, path, max_size, NULL, scratch_pool));
+      svn_hash_sets(registry, apr_pstrdup(registry_pool, path), *disk_p);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__disk_open(svn_cache__disk_t **disk_p,
+                     const char *path,
+                     apr_uint64_t max_size,
+                     apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_atomic__init_once(&registry_init_state, init_registry, NULL,
+                                scratch_pool));
+
+  SVN_ERR(svn_dirent_get_absolute(&path, path, scratch_pool));
+  SVN_MUTEX__WITH_LOCK(registry_mutex,
+                       get_store(disk_p, path, max_size, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__disk_open_private(svn_cache__disk_t **disk_p,
+                             const char *path,
+                             apr_uint64_t max_size,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(open_store(disk_p, path, max_size, result_pool,
+                                    scratch_pool));
+}
@@ -24,6 +24,8 @@
 #include <assert.h>
 #include <apr_md5.h>
 #include <apr_thread_rwlock.h>
+#include <apr_global_mutex.h>
+#include <apr_shm.h>
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
@@ -40,6 +42,7 @@
 
 #include "cache.h"
 #include "fnv1a.h"
+#include "sysinfo.h"
 
 /*
  * This svn_cache__t implementation actually consists of two parts:
@@ -63,8 +66,14 @@
  * Only the start address of these two data parts are given as a native
  * pointer. All other references are expressed as offsets to these pointers.
  * With that design, it is relatively easy to share the same data structure
- * between different processes and / or to persist them on disk. These
- * out-of-process features have not been implemented, yet.
+ * between different processes and / or to persist them on disk.
+ *
+ * The former is supported through svn_cache__membuffer_cache_create_shared.
+ * It places the segment structures, directories and data buffers in one
+ * shared memory segment that all processes forked from the creator map at
+ * the same address.  The segment locks are then replaced by cross-process
+ * mutexes.  Prefix indexes are not portable between processes, so shared
+ * caches always store full keys.
  *
  * Superficially, cache levels are being used as usual: insertion happens
  * into L1 and evictions will promote items to L2.  But their whole point
@@ -129,6 +138,22 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Plain lookups don't even take the segment lock.  They rely on a per-
+ * segment sequence number that every writer bumps before and after it
+ * modifies the segment.  A reader that sees the same even sequence number
+ * before and after copying an item knows that its copy is consistent.
+ * Only if that fails repeatedly, it falls back to taking the read lock.
+ * Hence, concurrent readers never contend on the same lock object.
+ *
+ * On NUMA machines, the set of segments may be replicated into shards,
+ * one per NUMA node.  Items get written to the shard local to the writing
+ * thread and lookups probe the local shard first before falling back to
+ * the remote ones.  Since directory groups and data buffers get touched
+ * lazily, i.e. not before the first write to them, the OS will allocate
+ * each shard's memory pages on the node that uses it ("first touch").
+ * A write removes any copy of the same key from all other shards, so
+ * there will be no outdated copies.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -164,6 +189,17 @@
  */
 #define MIN_SEGMENT_SIZE APR_UINT64_C(0x10000)
 
+/* Don't create shards smaller than this.  Smaller shards would severely
+ * limit the size of cachable items and reduce the hit rate since most
+ * items would be cached in only one of them.
+ */
+#define MIN_SHARD_SIZE (2 * DEFAULT_MIN_SEGMENT_SIZE)
+
+/* The maximum number of shards.  Should match the largest number of
+ * NUMA nodes that we expect to see.
+ */
+#define MAX_SHARD_COUNT 64
+
 /* The maximum number of segments allowed. Larger numbers reduce the size
  * of each segment, in turn reducing the max size of a cachable item.
  * Also, each segment gets its own lock object. The actual number supported
@@ -197,6 +233,34 @@
  */
 #define MAX_ITEM_SIZE ((apr_uint32_t)(0 - ITEM_ALIGNMENT))
 
+/* Number of counters in the frequency sketch that get updated for each
+ * access, i.e. the number of hash functions of the count-min sketch.
+ */
+#define SKETCH_DEPTH 4
+
+/* Frequency sketch counters saturate at this value.  TinyLFU uses 4 bit
+ * counters and so do we, albeit stored in full bytes for simplicity.
+ */
+#define SKETCH_MAX_COUNT 15
+
+/* After this many accesses per sketch counter, all counters get halved
+ * such that the sketch reflects recent rather than historic popularity.
+ */
+#define SKETCH_AGING_PERIOD 10
+
+/* The admission filter only kicks in once the segment's data buffer is
+ * filled beyond 1 - 1 / 2^ADMISSION_FILL_SHIFT.  Until then, there is
+ * no need to protect existing entries against eviction.
+ */
+#define ADMISSION_FILL_SHIFT 3
+
+/* Items of default or low priority must have been requested at least
+ * this often (as far as the frequency sketch can tell) to be admitted
+ * into a full cache segment.  A single failed lookup followed by a set
+ * is not enough, i.e. one-hit wonders will not evict other entries.
+ */
+#define ADMISSION_MIN_FREQUENCY 2
+
 /* We use this structure to identify cache entries. There cannot be two
  * entries with the same entry key. However unlikely, though, two different
  * full keys (see full_key_t) may have the same entry key.  That is a
@@ -696,11 +760,16 @@ typedef struct cache_level_t
  */
 struct svn_membuffer_t
 {
-  /* Number of cache segments. Must be a power of 2.
+  /* Number of cache segments per shard. Must be a power of 2.
      Please note that this structure represents only one such segment
      and that all segments must / will report the same values here. */
   apr_uint32_t segment_count;
 
+  /* Number of shards, i.e. the segment array has SHARD_COUNT times
+     SEGMENT_COUNT elements with the segments of each shard being stored
+     consecutively.  Must be > 0.  Same for all segments. */
+  apr_uint32_t shard_count;
+
   /* Collection of prefixes shared among all instances accessing the
    * same membuffer cache backend.  If a prefix is contained in this
    * pool then all cache instances using an equal prefix must actually
@@ -796,6 +865,40 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Number of reads counted in TOTAL_READS that have been served by
+   * another shard.  Always 0 for unsharded caches.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t remote_hits;
+
+  /* Number of insertions that have been refused by the admission filter.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t total_rejects;
+
+  /* Count-min sketch approximating the number of recent lookups per key,
+   * SKETCH_SIZE counters of which SKETCH_DEPTH get incremented for every
+   * lookup.  Used to decide whether new items shall be admitted to the
+   * cache once it is full.  See admit_item.
+   *
+   * Updates are not synchronized.  Lost or duplicated increments only
+   * affect the admission decision for single items, which is a mere
+   * heuristics anyway.
+   */
+  unsigned char *sketch;
+
+  /* Number of counters in SKETCH.  Always a power of two.
+   */
+  apr_uint32_t sketch_size;
+
+  /* Number of lookups recorded in SKETCH since the last aging.
+   */
+  apr_uint64_t sketch_additions;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -813,21 +916,67 @@ struct svn_membuffer_t
   svn_boolean_t allow_blocking_writes;
 #endif
 
+  /* Cross-process lock used instead of LOCK if the cache lives in shared
+   * memory.  NULL for process-local caches.  Readers and writers alike
+   * need exclusive access here but lock-free lookups remain available.
+   */
+  apr_global_mutex_t *shared_lock;
+
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
   svn_atomic_t write_lock_count;
+
+  /* Sequence counter for lock-free readers.  Writers increment it right
+   * after acquiring the write lock and again just before releasing it,
+   * i.e. the value is odd while the segment is being modified.  A reader
+   * that sees the same even value before and after its lookup knows that
+   * the data it read is consistent.  See membuffer_cache_get_optimistic.
+   *
+   * Only to be accessed through get_write_sequence and
+   * bump_write_sequence. */
+  volatile svn_atomic_t write_sequence;
 };
 
 /* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Acquire the cross-process lock of CACHE.  If SUCCESS is not NULL, don't
+ * wait for the lock but set *SUCCESS to FALSE if it is currently busy.
+ */
+static svn_error_t *
+lock_shared_cache(svn_membuffer_t *cache, svn_boolean_t *success)
+{
+  apr_status_t status;
+  if (success)
+    {
+      status = apr_global_mutex_trylock(cache->shared_lock);
+      if (SVN_LOCK_IS_BUSY(status))
+        {
+          *success = FALSE;
+          status = APR_SUCCESS;
+        }
+    }
+  else
+    {
+      status = apr_global_mutex_lock(cache->shared_lock);
+    }
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock shared cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    return lock_shared_cache(cache, NULL);
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +1000,10 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+  /* Shared caches never block writers. */
+  if (cache->shared_lock)
+    return lock_shared_cache(cache, success);
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -888,13 +1041,18 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    return lock_shared_cache(cache, NULL);
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  {
+    apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't write-lock cache mutex"));
+  }
 
   return SVN_NO_ERROR;
 #else
@@ -908,6 +1066,19 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_unlock(cache->shared_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't unlock shared cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1098,35 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Return the current write sequence number of CACHE.
+ *
+ * We use a no-op CAS instead of svn_atomic_read because the former
+ * implies a full memory barrier on all platforms.  This ensures that
+ * none of the reader's cache data accesses get reordered across this
+ * call.  Since it would replace 0 with 0, the CAS never actually changes
+ * the sequence number.
+ */
+static APR_INLINE apr_uint32_t
+get_write_sequence(svn_membuffer_t *cache)
+{
+  return svn_atomic_cas(&cache->write_sequence, 0, 0);
+}
+
+/* Increment the write sequence number of CACHE.  Must be called exactly
+ * twice per modification of CACHE: once after the write lock has been
+ * acquired and once before it gets released.
+ *
+ * Since there is at most one writer per segment, the CAS can't fail.
+ * We don't use svn_atomic_inc here because mixing it with CAS operations
+ * on the same variable is not portable.
+ */
+static APR_INLINE void
+bump_write_sequence(svn_membuffer_t *cache)
+{
+  apr_uint32_t sequence = cache->write_sequence;
+  svn_atomic_cas(&cache->write_sequence, sequence + 1, sequence);
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -949,6 +1149,7 @@ do {                                        \
 #define WITH_WRITE_LOCK(cache, expr)                            \
 do {                                                            \
   svn_boolean_t got_lock = TRUE;                                \
+  svn_error_t *write_err;                                       \
   SVN_ERR(write_lock_cache(cache, &got_lock));                  \
   if (!got_lock)                                                \
     {                                                           \
@@ -959,7 +1160,10 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  bump_write_sequence(cache);                                   \
+  write_err = (expr);                                           \
+  bump_write_sequence(cache);                                   \
+  SVN_ERR(unlock_cache(cache, write_err));                      \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1327,14 +1531,28 @@ insert_entry(svn_membuffer_t *cache, entry_t *entry)
   assert(level->current_data <= level->start_offset + level->size);
 }
 
-/* Map a KEY of 16 bytes to the CACHE and group that shall contain the
- * respective item.
+/* Return the index of the shard in CACHE that is local to the calling
+ * thread.
+ */
+static APR_INLINE apr_uint32_t
+get_local_shard(svn_membuffer_t *cache)
+{
+  return cache->shard_count > 1
+       ? (apr_uint32_t)svn_sysinfo__current_numa_node() % cache->shard_count
+       : 0;
+}
+
+/* Map a KEY of 16 bytes to the segment in SHARD of CACHE and the group
+ * within that segment that shall contain the respective item.  *CACHE
+ * must be the first segment of the whole cache and will be replaced with
+ * the selected segment.
  */
 static apr_uint32_t
 get_group_index(svn_membuffer_t **cache,
-                const entry_key_t *key)
+                const entry_key_t *key,
+                apr_uint32_t shard)
 {
-  svn_membuffer_t *segment0 = *cache;
+  svn_membuffer_t *segment0 = *cache + shard * (*cache)->segment_count;
   apr_uint64_t key0 = key->fingerprint[0];
   apr_uint64_t key1 = key->fingerprint[1];
 
@@ -1550,6 +1768,69 @@ find_entry(svn_membuffer_t *cache,
   return entry;
 }
 
+/* Lock-free variant of find_entry with FIND_EMPTY set to FALSE.
+ *
+ * The caller does not hold any lock, i.e. CACHE may get modified
+ * concurrently and we may see inconsistent or outdated directory
+ * contents.  Therefore, all indexes and offsets taken from the directory
+ * are being validated before use and the number of groups visited is
+ * limited.  The result is only meaningful if the write sequence number
+ * of CACHE did not change while this function was running.
+ */
+static entry_t *
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find)
+{
+  apr_uint64_t data_size = cache->l2.start_offset + cache->l2.size;
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  apr_size_t key_len = to_find->entry_key.key_len;
+  entry_group_t *group = &cache->directory[group_index];
+  apr_uint32_t chain_length;
+
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  for (chain_length = 0;
+       chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      apr_uint32_t used = MIN(group->header.used, GROUP_SIZE);
+      apr_uint32_t next;
+      apr_uint32_t i;
+
+      for (i = 0; i < used; ++i)
+        {
+          entry_t *entry = &group->entries[i];
+          if (entry_keys_match(&entry->key, &to_find->entry_key))
+            {
+              apr_uint64_t offset = entry->offset;
+
+              /* Short keys are fully defined by the entry key. */
+              if (!key_len)
+                return entry;
+
+              /* Don't trust OFFSET until we checked it. */
+              if (offset > data_size || key_len > data_size - offset)
+                return NULL;
+
+              return memcmp(to_find->full_key.data, cache->data + offset,
+                            key_len) == 0
+                   ? entry
+                   : NULL;
+            }
+        }
+
+      next = group->header.next;
+      if (next == NO_INDEX || next >= group_limit)
+        break;
+
+      group = &cache->directory[next];
+    }
+
+  return NULL;
+}
+
 /* Move a surviving ENTRY from just behind the insertion window to
  * its beginning and move the insertion window up accordingly.
  */
@@ -1832,32 +2113,98 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Source of the memory for all cache segments and their buffers.
+ */
+typedef struct cache_memory_t
+{
+  /* Allocate from this pool if SHM_BASE is NULL. */
+  apr_pool_t *pool;
+
+  /* Start of the shared memory segment to allocate from or NULL for
+   * process-local caches. */
+  char *shm_base;
+
+  /* Number of bytes already allocated from SHM_BASE. */
+  apr_size_t shm_used;
+} cache_memory_t;
+
+/* Return a block of SIZE bytes from MEMORY.  If ZERO is set, the block
+ * will be cleared.  Return NULL if we ran out of memory.
+ */
+static void *
+cache_memory_alloc(cache_memory_t *memory,
+                   apr_size_t size,
+                   svn_boolean_t zero)
+{
+  void *result;
+  if (memory->shm_base == NULL)
+    return zero ? apr_pcalloc(memory->pool, size)
+                : apr_palloc(memory->pool, size);
+
+  /* The shared memory segment has been sized to fit everything we are
+   * going to allocate.  Keep all blocks aligned. */
+  result = memory->shm_base + memory->shm_used;
+  memory->shm_used += ALIGN_VALUE(size);
+  if (zero)
+    memset(result, 0, size);
+
+  return result;
+}
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, place all
+ * cache data in a shared memory segment with the optional file name
+ * SHM_NAME and synchronize access across processes.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       apr_size_t shard_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       const char *shm_name,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  cache_memory_t memory = { 0 };
 
   apr_uint32_t seg;
+  apr_uint32_t total_segment_count;
   apr_uint32_t group_count;
   apr_uint32_t main_group_count;
   apr_uint32_t spare_group_count;
   apr_uint32_t group_init_size;
+  apr_uint32_t sketch_size;
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   * Prefix indexes are only valid within the current process, so shared
+   * caches must not use them.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
+  SVN_ERR(prefix_pool_create(&prefix_pool, shared ? 0 : total_size / 100,
+                             thread_safe, pool));
   total_size -= total_size / 100;
 
+  /* Limit the number of shards such that they don't get too small.
+   * Sharding only makes sense for multi-threaded caches.
+   */
+  if (shard_count > MAX_SHARD_COUNT)
+    shard_count = MAX_SHARD_COUNT;
+  if (shard_count * MIN_SHARD_SIZE > total_size)
+    shard_count = total_size / MIN_SHARD_SIZE;
+  if (shard_count < 1 || !thread_safe)
+    shard_count = 1;
+
+  /* From here on, all size limits apply per shard.
+   */
+  total_size /= shard_count;
+  directory_size /= shard_count;
+
   /* Limit the total size (only relevant if we can address > 4GB)
    */
 #if APR_SIZEOF_VOIDP > 4
@@ -1910,8 +2257,7 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
+  total_segment_count = (apr_uint32_t)(segment_count * shard_count);
 
   /* Split total cache size into segments of equal size
    */
@@ -1963,11 +2309,54 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
-  for (seg = 0; seg < segment_count; ++seg)
+
+  /* Roughly one frequency counter per index entry provides a sufficiently
+   * low error rate for the admission filter. */
+  sketch_size = 64;
+  while (sketch_size <= group_count * GROUP_SIZE / 2)
+    sketch_size *= 2;
+
+  /* Shared caches get all their memory in one go.
+   */
+  memory.pool = pool;
+  if (shared)
+    {
+#if APR_HAS_SHARED_MEMORY
+      apr_shm_t *shm;
+      apr_status_t status;
+      apr_size_t segment_size = ALIGN_VALUE(group_count
+                                            * sizeof(entry_group_t))
+                              + ALIGN_VALUE(group_init_size)
+                              + (apr_size_t)ALIGN_VALUE(data_size)
+                              + ALIGN_VALUE(sketch_size);
+      apr_size_t shm_size = ALIGN_VALUE(total_segment_count * sizeof(*c))
+                          + total_segment_count * segment_size;
+
+      /* Named segments may be left over from a previous run. */
+      if (shm_name)
+        apr_shm_remove(shm_name, pool);
+
+      status = apr_shm_create(&shm, shm_size, shm_name, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory for cache"));
+
+      memory.shm_base = apr_shm_baseaddr_get(shm);
+#else
+      return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                              _("Shared memory is not supported"));
+#endif
+    }
+
+  /* allocate cache as an array of segments / cache objects */
+  c = cache_memory_alloc(&memory, total_segment_count * sizeof(*c), FALSE);
+
+  for (seg = 0; seg < total_segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
        */
       c[seg].segment_count = (apr_uint32_t)segment_count;
+      c[seg].shard_count = (apr_uint32_t)shard_count;
       c[seg].prefix_pool = prefix_pool;
 
       c[seg].group_count = main_group_count;
@@ -1977,13 +2366,16 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
-         Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+         Group initialization will take care of that in stead.  This also
+         makes the first write to each page determine its NUMA node. */
+      c[seg].directory
+        = cache_memory_alloc(&memory, group_count * sizeof(entry_group_t),
+                             FALSE);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized
+        = cache_memory_alloc(&memory, group_init_size, TRUE);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2396,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = cache_memory_alloc(&memory,
+                                       (apr_size_t)ALIGN_VALUE(data_size),
+                                       FALSE);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2012,11 +2406,18 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].remote_hits = 0;
+      c[seg].total_rejects = 0;
+
+      c[seg].sketch = cache_memory_alloc(&memory, sketch_size, TRUE);
+      c[seg].sketch_size = sketch_size;
+      c[seg].sketch_additions = 0;
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      if (   c[seg].data == NULL || c[seg].directory == NULL
+          || c[seg].sketch == NULL)
         {
           /* We are OOM. There is no need to proceed with "half a cache".
            */
@@ -2044,8 +2445,23 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
 #endif
+
+      /* Shared caches are synchronized across all threads and processes.
+       */
+      c[seg].shared_lock = NULL;
+      if (shared)
+        {
+          apr_status_t status =
+              apr_global_mutex_create(&c[seg].shared_lock, NULL,
+                                      APR_LOCK_DEFAULT, pool);
+          if (status)
+            return svn_error_wrap_apr(status,
+                                      _("Can't create shared cache mutex"));
+        }
+
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+      c[seg].write_sequence = 0;
     }
 
   /* done here
@@ -2054,11 +2470,68 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  apr_size_t shard_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, shard_count,
+                                                thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, NULL, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         const char *shm_name,
+                                         apr_pool_t *pool)
+{
+  /* The process-local locks are not needed as all access will be
+   * serialized by the cross-process mutexes. */
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, 1,
+                                                FALSE, FALSE,
+                                                TRUE, shm_name, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_child_init(svn_membuffer_t *cache,
+                                apr_pool_t *pool)
+{
+  apr_uint32_t seg;
+
+  if (cache == NULL)
+    return SVN_NO_ERROR;
+
+  for (seg = 0; seg < cache->segment_count * cache->shard_count; ++seg)
+    if (cache[seg].shared_lock)
+      {
+        apr_status_t status
+          = apr_global_mutex_child_init(&cache[seg].shared_lock, NULL, pool);
+        if (status)
+          return svn_error_wrap_apr(status,
+                                    _("Can't attach to shared cache mutex"));
+      }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
   apr_size_t seg;
-  apr_size_t segment_count = cache->segment_count;
+  apr_size_t segment_count = cache->segment_count * cache->shard_count;
 
   /* Length of the group_initialized array in bytes.
      See also svn_cache__membuffer_cache_create(). */
@@ -2078,6 +2551,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      bump_write_sequence(&cache[seg]);
 
       /* Mark all groups as "not initialized", which implies "empty". */
       cache[seg].first_spare_group = NO_INDEX;
@@ -2102,6 +2576,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
+      bump_write_sequence(&cache[seg]);
       SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
     }
 
@@ -2125,6 +2600,38 @@ entry_exists_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Number of times we try to read from a cache segment without locking
+ * it before we give up and fall back to a locked lookup.
+ */
+#define OPTIMISTIC_READ_ATTEMPTS 3
+
+/* Look for the cache entry in group GROUP_INDEX of CACHE, identified
+ * by the hash value TO_FIND, without locking CACHE.  Return TRUE and set
+ * *ENTRY to the entry found or NULL if we could do so while no writer
+ * modified CACHE.  Return FALSE, if the caller needs to retry with a read
+ * lock.  See membuffer_cache_get_optimistic for more details.
+ */
+static svn_boolean_t
+find_entry_lock_free(svn_membuffer_t *cache,
+                     apr_uint32_t group_index,
+                     const full_key_t *to_find,
+                     entry_t **entry)
+{
+  int attempt;
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      apr_uint32_t sequence = get_write_sequence(cache);
+      if (sequence & 1)
+        return FALSE;
+
+      *entry = find_entry_optimistic(cache, group_index, to_find);
+      if (get_write_sequence(cache) == sequence)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND and set *FOUND accordingly.
  */
@@ -2134,6 +2641,13 @@ entry_exists(svn_membuffer_t *cache,
              const full_key_t *to_find,
              svn_boolean_t *found)
 {
+  entry_t *entry;
+  if (find_entry_lock_free(cache, group_index, to_find, &entry))
+    {
+      *found = entry != NULL;
+      return SVN_NO_ERROR;
+    }
+
   WITH_READ_LOCK(cache,
                  entry_exists_internal(cache,
                                        group_index,
@@ -2143,6 +2657,88 @@ entry_exists(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Return the index of the sketch counter in CACHE that is to be used as
+ * the I-th hash function for KEY.
+ */
+static APR_INLINE apr_uint32_t
+get_sketch_index(svn_membuffer_t *cache,
+                 const entry_key_t *key,
+                 int i)
+{
+  /* Derive the hashes from the two halves of the fingerprint
+   * (Kirsch-Mitzenmacher double hashing).  Make the step odd such that
+   * we never hit the same counter twice. */
+  apr_uint64_t hash = key->fingerprint[0]
+                    + (apr_uint64_t)i * (key->fingerprint[1] | 1);
+
+  return (apr_uint32_t)(hash ^ (hash >> 32)) & (cache->sketch_size - 1);
+}
+
+/* Record a lookup of KEY in the frequency sketch of CACHE.
+ */
+static void
+record_access(svn_membuffer_t *cache,
+              const entry_key_t *key)
+{
+  int i;
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    {
+      unsigned char *counter = &cache->sketch[get_sketch_index(cache, key, i)];
+      if (*counter < SKETCH_MAX_COUNT)
+        ++*counter;
+    }
+
+  /* Let old popularity fade out by halving all counters every now and
+   * then.  Concurrent threads may do that at the same time, which only
+   * makes the sketch forget a bit faster. */
+  if (++cache->sketch_additions
+        >= (apr_uint64_t)cache->sketch_size * SKETCH_AGING_PERIOD)
+    {
+      apr_uint32_t k;
+      cache->sketch_additions = 0;
+      for (k = 0; k < cache->sketch_size; ++k)
+        cache->sketch[k] >>= 1;
+    }
+}
+
+/* Return the estimated number of recent lookups of KEY in CACHE.
+ */
+static apr_uint32_t
+estimate_frequency(svn_membuffer_t *cache,
+                   const entry_key_t *key)
+{
+  apr_uint32_t result = SKETCH_MAX_COUNT;
+  int i;
+
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    result = MIN(result, cache->sketch[get_sketch_index(cache, key, i)]);
+
+  return result;
+}
+
+/* Return TRUE, if a new item with KEY, SIZE and PRIORITY shall be added
+ * to CACHE.  This is always the case as long as CACHE is not nearly full.
+ * Otherwise, inserting the item would evict other entries and we only
+ * do that for important items or items that have been requested before.
+ * This protects the cache content against scans, e.g. during an export.
+ */
+static svn_boolean_t
+admit_item(svn_membuffer_t *cache,
+           const entry_key_t *key,
+           apr_size_t size,
+           apr_uint32_t priority)
+{
+  apr_uint64_t capacity = cache->l1.size + cache->l2.size;
+
+  if (priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
+    return TRUE;
+
+  if (cache->data_used + size <= capacity - (capacity >> ADMISSION_FILL_SHIFT))
+    return TRUE;
+
+  return estimate_frequency(cache, key) >= ADMISSION_MIN_FREQUENCY;
+}
+
 /* Given the SIZE and PRIORITY of a new item, return the cache level
    (L1 or L2) in fragment CACHE that this item shall be inserted into.
    If we can't find nor make enough room for the item, return NULL.
@@ -2255,6 +2851,15 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
       return SVN_NO_ERROR;
     }
 
+  /* Don't let new items of little value displace cached data.
+   */
+  if (   entry == NULL && buffer
+      && !admit_item(cache, &to_find->entry_key, size, priority))
+    {
+      cache->total_rejects++;
+      buffer = NULL;
+    }
+
   /* if necessary, enlarge the insertion window.
    */
   level = buffer ? select_level(cache, size, priority) : NULL;
@@ -2310,6 +2915,37 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Remove the entry identified by KEY from SHARD of CACHE, if it exists.
+ * CACHE must be the first segment of the whole cache.
+ */
+static svn_error_t *
+drop_remote_copy(svn_membuffer_t *cache,
+                 const full_key_t *key,
+                 apr_uint32_t shard)
+{
+  svn_boolean_t exists;
+  apr_uint32_t group_index = get_group_index(&cache, &key->entry_key, shard);
+
+  /* Usually, there is no such copy and we can exit quickly. */
+  SVN_ERR(entry_exists(cache, group_index, key, &exists));
+  if (exists)
+    {
+      entry_t *entry;
+
+      SVN_ERR(force_write_lock_cache(cache));
+      bump_write_sequence(cache);
+
+      entry = find_entry(cache, group_index, key, FALSE);
+      if (entry)
+        drop_entry(cache, entry);
+
+      bump_write_sequence(cache);
+      SVN_ERR(unlock_cache(cache, SVN_NO_ERROR));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Try to insert the ITEM and use the KEY to uniquely identify it.
  * However, there is no guarantee that it will actually be put into
  * the cache. If there is already some data associated to the KEY,
@@ -2331,10 +2967,13 @@ membuffer_cache_set(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   void *buffer = NULL;
   apr_size_t size = 0;
+  apr_uint32_t local_shard = get_local_shard(cache);
+  svn_membuffer_t *segment = cache;
+  apr_uint32_t i;
 
   /* find the entry group that will hold the key.
    */
-  group_index = get_group_index(&cache, &key->entry_key);
+  group_index = get_group_index(&segment, &key->entry_key, local_shard);
 
   /* Serialize data data.
    */
@@ -2343,8 +2982,8 @@ membuffer_cache_set(svn_membuffer_t *cache,
 
   /* The actual cache data access needs to sync'ed
    */
-  WITH_WRITE_LOCK(cache,
-                  membuffer_cache_set_internal(cache,
+  WITH_WRITE_LOCK(segment,
+                  membuffer_cache_set_internal(segment,
                                                key,
                                                group_index,
                                                buffer,
@@ -2352,6 +2991,13 @@ membuffer_cache_set(svn_membuffer_t *cache,
                                                priority,
                                                DEBUG_CACHE_MEMBUFFER_TAG
                                                scratch_pool));
+
+  /* Other shards must not keep outdated copies.
+   */
+  for (i = 1; i < cache->shard_count; ++i)
+    SVN_ERR(drop_remote_copy(cache, key,
+                             (local_shard + i) % cache->shard_count));
+
   return SVN_NO_ERROR;
 }
 
@@ -2394,7 +3040,6 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   /* The actual cache data access needs to sync'ed
    */
   entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
   if (entry == NULL)
     {
       /* no such entry found.
@@ -2433,6 +3078,91 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+
+/* Lock-free variant of membuffer_cache_get_internal.
+ *
+ * Look for the cache entry in group GROUP_INDEX of CACHE, identified
+ * by the hash value TO_FIND, while other threads may modify CACHE.
+ * Return TRUE, if we found a consistent state, i.e. no writer has been
+ * active during the lookup.  In that case, *BUFFER and *ITEM_SIZE are
+ * set as in membuffer_cache_get_internal.  Return FALSE otherwise and
+ * leave it to the caller to redo the lookup with the read lock being held.
+ * Allocations will be done in RESULT_POOL.
+ *
+ * The basic scheme is that of a sequence lock: Writers keep the segment's
+ * sequence number odd while they are active and bump it to the next even
+ * number when they are done.  So, if we see the same even number before
+ * and after reading the entry data, that data is valid.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+  apr_size_t key_len = to_find->entry_key.key_len;
+  int attempt;
+
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      apr_uint32_t sequence = get_write_sequence(cache);
+      entry_t *entry;
+      apr_uint64_t offset = 0;
+      apr_size_t size = 0;
+      apr_size_t copy_size;
+
+      /* A writer is active.  Waiting for the lock is cheaper than
+       * spinning. */
+      if (sequence & 1)
+        return FALSE;
+
+      /* Take a snapshot of the entry header. */
+      entry = find_entry_optimistic(cache, group_index, to_find);
+      if (entry)
+        {
+          offset = entry->offset;
+          size = entry->size;
+        }
+
+      /* Verify the snapshot before we allocate anything based on it. */
+      if (get_write_sequence(cache) != sequence)
+        continue;
+
+      if (entry == NULL)
+        {
+          *buffer = NULL;
+          *item_size = 0;
+
+          return TRUE;
+        }
+
+      /* Copy the data and verify that it has not been modified while we
+       * were doing so.  Retries will waste some memory in RESULT_POOL but
+       * are rare and limited in number. */
+      copy_size = ALIGN_VALUE(size) - key_len;
+      *buffer = apr_palloc(result_pool, copy_size);
+      memcpy(*buffer, cache->data + offset + key_len, copy_size);
+
+      if (get_write_sequence(cache) != sequence)
+        continue;
+
+      /* A writer might now be re-using ENTRY for some other item.  That
+       * would only result in the wrong entry getting the hit count bump,
+       * which is harmless. */
+      increment_hit_counters(cache, entry);
+      *item_size = size - key_len;
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+#endif /* SVN_DEBUG_CACHE_MEMBUFFER */
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
@@ -2447,20 +3177,49 @@ membuffer_cache_get(svn_membuffer_t *cache,
                     apr_pool_t *result_pool)
 {
   apr_uint32_t group_index;
-  char *buffer;
+  char *buffer = NULL;
   apr_size_t size;
+  apr_uint32_t local_shard = get_local_shard(cache);
+  svn_membuffer_t *local_segment = NULL;
+  apr_uint32_t i;
 
-  /* find the entry group that will hold the key.
-   */
-  group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+  /* Probe the local shard first. */
+  for (i = 0; i < cache->shard_count && buffer == NULL; ++i)
+    {
+      /* find the entry group that will hold the key.
+       */
+      svn_membuffer_t *segment = cache;
+      group_index = get_group_index(&segment, &key->entry_key,
+                                    (local_shard + i) % cache->shard_count);
+
+      /* Try without locking first.  Debug builds always take the lock
+       * because they need to verify the entry tags.
+       */
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+      if (!membuffer_cache_get_optimistic(segment, group_index, key,
+                                          &buffer, &size, result_pool))
+#endif
+        WITH_READ_LOCK(segment,
+                       membuffer_cache_get_internal(segment,
+                                                    group_index,
+                                                    key,
+                                                    &buffer,
+                                                    &size,
+                                                    DEBUG_CACHE_MEMBUFFER_TAG
+                                                    result_pool));
+
+      /* Account for the lookup in the local segment only. */
+      if (i == 0)
+        {
+          local_segment = segment;
+          local_segment->total_reads++;
+          record_access(local_segment, &key->entry_key);
+        }
+      else if (buffer)
+        {
+          local_segment->remote_hits++;
+        }
+    }
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2512,16 +3271,43 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
                         const full_key_t *key,
                         svn_boolean_t *found)
 {
-  /* find the entry group that will hold the key.
-   */
-  apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
-  cache->total_reads++;
+  apr_uint32_t local_shard = get_local_shard(cache);
+  apr_uint32_t i;
 
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_has_key_internal(cache,
-                                                  group_index,
-                                                  key,
-                                                  found));
+  *found = FALSE;
+  for (i = 0; i < cache->shard_count && !*found; ++i)
+    {
+      /* find the entry group that will hold the key.
+       */
+      svn_membuffer_t *segment = cache;
+      apr_uint32_t group_index
+        = get_group_index(&segment, &key->entry_key,
+                          (local_shard + i) % cache->shard_count);
+      entry_t *entry;
+
+      if (i == 0)
+        {
+          segment->total_reads++;
+          record_access(segment, &key->entry_key);
+        }
+
+      /* Try without locking first. */
+      if (find_entry_lock_free(segment, group_index, key, &entry))
+        {
+          if (entry)
+            increment_hit_counters(segment, entry);
+
+          *found = entry != NULL;
+        }
+      else
+        {
+          WITH_READ_LOCK(segment,
+                         membuffer_cache_has_key_internal(segment,
+                                                          group_index,
+                                                          key,
+                                                          found));
+        }
+    }
 
   return SVN_NO_ERROR;
 }
@@ -2549,7 +3335,6 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
                                      apr_pool_t *result_pool)
 {
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
   if (entry == NULL)
     {
       *item = NULL;
@@ -2599,13 +3384,29 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
                             DEBUG_CACHE_MEMBUFFER_TAG_ARG
                             apr_pool_t *result_pool)
 {
-  apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  apr_uint32_t local_shard = get_local_shard(cache);
+  apr_uint32_t i;
 
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_partial_internal
-                     (cache, group_index, key, item, found,
-                      deserializer, baton, DEBUG_CACHE_MEMBUFFER_TAG
-                      result_pool));
+  *found = FALSE;
+  for (i = 0; i < cache->shard_count && !*found; ++i)
+    {
+      svn_membuffer_t *segment = cache;
+      apr_uint32_t group_index
+        = get_group_index(&segment, &key->entry_key,
+                          (local_shard + i) % cache->shard_count);
+
+      if (i == 0)
+        {
+          segment->total_reads++;
+          record_access(segment, &key->entry_key);
+        }
+
+      WITH_READ_LOCK(segment,
+                     membuffer_cache_get_partial_internal
+                         (segment, group_index, key, item, found,
+                          deserializer, baton, DEBUG_CACHE_MEMBUFFER_TAG
+                          result_pool));
+    }
 
   return SVN_NO_ERROR;
 }
@@ -2739,14 +3540,24 @@ membuffer_cache_set_partial(svn_membuffer_t *cache,
                             DEBUG_CACHE_MEMBUFFER_TAG_ARG
                             apr_pool_t *scratch_pool)
 {
-  /* cache item lookup
+  apr_uint32_t i;
+
+  /* Concurrent writes may have left copies in multiple shards.
+   * Update all of them.
    */
-  apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
-  WITH_WRITE_LOCK(cache,
-                  membuffer_cache_set_partial_internal
-                     (cache, group_index, key, func, baton,
-                      DEBUG_CACHE_MEMBUFFER_TAG
-                      scratch_pool));
+  for (i = 0; i < cache->shard_count; ++i)
+    {
+      /* cache item lookup
+       */
+      svn_membuffer_t *segment = cache;
+      apr_uint32_t group_index = get_group_index(&segment, &key->entry_key,
+                                                 i);
+      WITH_WRITE_LOCK(segment,
+                      membuffer_cache_set_partial_internal
+                         (segment, group_index, key, func, baton,
+                          DEBUG_CACHE_MEMBUFFER_TAG
+                          scratch_pool));
+    }
 
   /* done here -> unlock the cache
    */
@@ -3127,7 +3938,8 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
   info->data_size += segment->l1.size + segment->l2.size;
   info->used_size += segment->data_used;
   info->total_size += segment->l1.size + segment->l2.size +
-      segment->group_count * GROUP_SIZE * sizeof(entry_t);
+      segment->group_count * GROUP_SIZE * sizeof(entry_t) +
+      segment->sketch_size;
 
   info->used_entries += segment->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
@@ -3165,7 +3977,9 @@ svn_membuffer_cache_get_info(void *cache_void,
 
   /* collect info from shared cache back-end */
 
-  for (i = 0; i < cache->membuffer->segment_count; ++i)
+  for (i = 0;
+       i < cache->membuffer->segment_count * cache->membuffer->shard_count;
+       ++i)
     {
       svn_membuffer_t *segment = cache->membuffer + i;
       WITH_READ_LOCK(segment,
@@ -3451,6 +4265,7 @@ svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
   info->gets += segment->total_reads;
   info->sets += segment->total_writes;
   info->hits += segment->total_hits;
+  info->rejects += segment->total_rejects;
 
   WITH_READ_LOCK(segment,
                   svn_membuffer_get_segment_info(segment, info, TRUE));
@@ -3465,16 +4280,41 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
   svn_cache__info_t *info = apr_pcalloc(pool, sizeof(*info));
+  apr_uint32_t shard_count = membuffer->shard_count;
 
   /* cache front-end specific data */
 
   info->id = "membuffer globals";
 
+  if (shard_count > 1)
+    {
+      info->shards = apr_array_make(pool, shard_count,
+                                    sizeof(svn_cache__shard_info_t));
+      for (i = 0; i < shard_count; ++i)
+        memset(apr_array_push(info->shards), 0,
+               sizeof(svn_cache__shard_info_t));
+    }
+
   /* collect info from shared cache back-end */
 
-  for (i = 0; i < membuffer->segment_count; ++i)
-    svn_error_clear(svn_membuffer_get_global_segment_info(membuffer + i,
-                                                          info));
+  for (i = 0; i < membuffer->segment_count * shard_count; ++i)
+    {
+      svn_membuffer_t *segment = membuffer + i;
+      svn_error_clear(svn_membuffer_get_global_segment_info(segment, info));
+
+      if (info->shards)
+        {
+          svn_cache__shard_info_t *shard
+            = &APR_ARRAY_IDX(info->shards, i / membuffer->segment_count,
+                             svn_cache__shard_info_t);
+
+          shard->gets += segment->total_reads;
+          shard->hits += segment->total_hits;
+          shard->remote_hits += segment->remote_hits;
+          shard->used_size += segment->data_used;
+          shard->data_size += segment->l1.size + segment->l2.size;
+        }
+    }
 
   return info;
 }
@@ -0,0 +1,213 @@
+/*
+ * cache-tiered.c: two-level cache for Subversion
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+
+#include "svn_private_config.h"
+#include "private/svn_cache.h"
+
+#include "cache.h"
+
+/* The (internal) cache object. */
+typedef struct tiered_cache_t
+{
+  /* Fast, usually in-memory cache that gets asked first. */
+  svn_cache__t *first;
+
+  /* Slower but larger or more persistent cache behind FIRST. */
+  svn_cache__t *second;
+} tiered_cache_t;
+
+static svn_error_t *
+tiered_cache_get(void **value_p,
+                 svn_boolean_t *found,
+                 void *cache_void,
+                 const void *key,
+                 apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->first, key, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->second, key, result_pool));
+
+  /* Promote the item such that the next lookup will be fast again. */
+  if (*found)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(result_pool);
+      SVN_ERR(svn_cache__set(cache->first, key, *value_p, scratch_pool));
+      svn_pool_destroy(scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_has_key(svn_boolean_t *found,
+                     void *cache_void,
+                     const void *key,
+                     apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__has_key(found, cache->first, key, scratch_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__has_key(found, cache->second, key, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set(void *cache_void,
+                 const void *key,
+                 void *value,
+                 apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set(cache->first, key, value, scratch_pool));
+  SVN_ERR(svn_cache__set(cache->second, key, value, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_iter(svn_boolean_t *completed,
+                  void *cache_void,
+                  svn_iter_apr_hash_cb_t user_cb,
+                  void *user_baton,
+                  apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a tiered cache"));
+}
+
+static svn_boolean_t
+tiered_cache_is_cachable(void *cache_void, apr_size_t size)
+{
+  tiered_cache_t *cache = cache_void;
+
+  return svn_cache__is_cachable(cache->first, size)
+      || svn_cache__is_cachable(cache->second, size);
+}
+
+static svn_error_t *
+tiered_cache_get_partial(void **value_p,
+                         svn_boolean_t *found,
+                         void *cache_void,
+                         const void *key,
+                         svn_cache__partial_getter_func_t func,
+                         void *baton,
+                         apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* We can't promote partial results.  The next full get will do that. */
+  SVN_ERR(svn_cache__get_partial(value_p, found, cache->first, key, func,
+                                 baton, result_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__get_partial(value_p, found, cache->second, key, func,
+                                   baton, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set_partial(void *cache_void,
+                         const void *key,
+                         svn_cache__partial_setter_func_t func,
+                         void *baton,
+                         apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set_partial(cache->first, key, func, baton,
+                                 scratch_pool));
+  SVN_ERR(svn_cache__set_partial(cache->second, key, func, baton,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_get_info(void *cache_void,
+                      svn_cache__info_t *info,
+                      svn_boolean_t reset,
+                      apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+  svn_cache__info_t first_info;
+  svn_cache__info_t second_info;
+
+  SVN_ERR(svn_cache__get_info(cache->first, &first_info, reset,
+                              result_pool));
+  SVN_ERR(svn_cache__get_info(cache->second, &second_info, reset,
+                              result_pool));
+
+  /* Access counts are those of the tiered cache itself.
+   * Report the combined storage. */
+  info->id = first_info.id;
+  info->used_size = first_info.used_size + second_info.used_size;
+  info->data_size = first_info.data_size + second_info.data_size;
+  info->total_size = first_info.total_size + second_info.total_size;
+  info->used_entries = first_info.used_entries + second_info.used_entries;
+  info->total_entries = first_info.total_entries
+                      + second_info.total_entries;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_cache__vtable_t tiered_cache_vtable = {
+  tiered_cache_get,
+  tiered_cache_has_key,
+  tiered_cache_set,
+  tiered_cache_iter,
+  tiered_cache_is_cachable,
+  tiered_cache_get_partial,
+  tiered_cache_set_partial,
+  tiered_cache_get_info
+};
+
+svn_error_t *
+svn_cache__create_tiered(svn_cache__t **cache_p,
+                         svn_cache__t *first,
+                         svn_cache__t *second,
+                         apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  tiered_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->first = first;
+  cache->second = second;
+
+  wrapper->vtable = &tiered_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
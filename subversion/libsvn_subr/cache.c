@@ -252,12 +252,16 @@ svn_cache__format_info(const svn_cache__info_t *info,
                   / (double)(info->gets ? info->gets : 1);
   double write_rate = (100.0 * (double)info->sets)
                     / (double)(misses ? misses : 1);
+  apr_uint64_t inserts = info->sets + info->rejects;
+  double reject_rate = (100.0 * (double)info->rejects)
+                     / (double)(inserts ? inserts : 1);
   double data_usage_rate = (100.0 * (double)info->used_size)
                          / (double)(info->data_size ? info->data_size : 1);
   double data_entry_rate = (100.0 * (double)info->used_entries)
                  / (double)(info->total_entries ? info->total_entries : 1);
 
   const char *histogram = "";
+  const char *shards = "";
   if (!access_only)
     {
       svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
@@ -277,6 +281,31 @@ svn_cache__format_info(const svn_cache__info_t *info,
       histogram = text->data;
     }
 
+  if (!access_only && info->shards)
+    {
+      svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
+
+      int i;
+      for (i = 0; i < info->shards->nelts; ++i)
+        {
+          const svn_cache__shard_info_t *shard
+            = &APR_ARRAY_IDX(info->shards, i, svn_cache__shard_info_t);
+
+          svn_stringbuf_appendcstr(text,
+            apr_psprintf(result_pool,
+                         "shard %2d: %" APR_UINT64_T_FMT " gets"
+                         ", %" APR_UINT64_T_FMT " hits"
+                         ", %" APR_UINT64_T_FMT " remote hits"
+                         ", %" APR_UINT64_T_FMT " of %" APR_UINT64_T_FMT
+                         " MB used\n",
+                         i, shard->gets, shard->hits, shard->remote_hits,
+                         shard->used_size / _1MB,
+                         shard->data_size / _1MB));
+        }
+
+      shards = text->data;
+    }
+
   return access_only
        ? svn_string_createf(result_pool,
                             "%s\n"
@@ -296,11 +325,13 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             "sets    : %" APR_UINT64_T_FMT
                             " (%5.2f%% of misses)\n"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "rejects : %" APR_UINT64_T_FMT
+                            " (%5.2f%% of insertions)\n"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
                             "          %" APR_UINT64_T_FMT " entries (%5.2f%%)"
-                            " of %" APR_UINT64_T_FMT " total\n%s",
+                            " of %" APR_UINT64_T_FMT " total\n%s%s",
 
                             info->id,
 
@@ -308,6 +339,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->hits, hit_rate,
                             info->sets, write_rate,
                             info->failures,
+                            info->rejects, reject_rate,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
@@ -315,5 +347,6 @@ svn_cache__format_info(const svn_cache__info_t *info,
 
                             info->used_entries, data_entry_rate,
                             info->total_entries,
-                            histogram);
+                            histogram,
+                            shards);
 }
@@ -28,6 +28,9 @@
 
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "svn_private_config.h"
+
+#include "sysinfo.h"
 
 /* The cache settings as a process-wide singleton.
  */
@@ -64,6 +67,14 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* Set by svn_cache__share_global_membuffer_cache before creating the
+ * global membuffer cache.  The shared memory name may be NULL. */
+static svn_boolean_t share_global_cache = FALSE;
+static const char *global_cache_shm_name = NULL;
+
+/* Set by initialize_cache if the global cache lives in shared memory. */
+static svn_boolean_t global_cache_is_shared = FALSE;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +131,28 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      /* Multi-threaded servers on NUMA machines get one shard per node.
+       * The cache will reduce that number if the cache is too small. */
+      if (share_global_cache)
+        err = svn_cache__membuffer_cache_create_shared(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            global_cache_shm_name,
+            pool);
+      else
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            svn_cache_config_get()->single_threaded
+              ? 1
+              : svn_sysinfo__numa_node_count(pool),
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -145,6 +170,7 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 
       /* done */
       *cache_p = cache;
+      global_cache_is_shared = share_global_cache;
     }
 
   return SVN_NO_ERROR;
@@ -173,6 +199,22 @@ svn_cache__get_global_membuffer_cache(void)
   return cache;
 }
 
+svn_error_t *
+svn_cache__share_global_membuffer_cache(const char *shm_name)
+{
+  share_global_cache = TRUE;
+  global_cache_shm_name = shm_name;
+
+  /* Creation errors simply disable caching. */
+  if (   svn_cache__get_global_membuffer_cache()
+      && !global_cache_is_shared)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Can't share the in-memory cache after it "
+                              "has been used"));
+
+  return SVN_NO_ERROR;
+}
+
 void
 svn_cache_config_set(const svn_cache_config_t *settings)
 {
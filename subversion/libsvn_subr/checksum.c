@@ -35,6 +35,7 @@
 
 #include "checksum.h"
 #include "fnv1a.h"
+#include "sha1.h"
 
 #include "private/svn_subr_private.h"
 
@@ -475,7 +476,7 @@ svn_checksum(svn_checksum_t **checksum,
              apr_size_t len,
              apr_pool_t *pool)
 {
-  apr_sha1_ctx_t sha1_ctx;
+  svn__sha1_ctx_t sha1_ctx;
 
   SVN_ERR(validate_kind(kind));
   *checksum = svn_checksum_create(kind, pool);
@@ -487,9 +488,9 @@ svn_checksum(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_init(&sha1_ctx);
-        apr_sha1_update(&sha1_ctx, data, (unsigned int)len);
-        apr_sha1_final((unsigned char *)(*checksum)->digest, &sha1_ctx);
+        svn__sha1_init(&sha1_ctx);
+        svn__sha1_update(&sha1_ctx, data, len);
+        svn__sha1_final((unsigned char *)(*checksum)->digest, &sha1_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -550,8 +551,8 @@ svn_checksum_ctx_create(svn_checksum_kind_t kind,
         break;
 
       case svn_checksum_sha1:
-        ctx->apr_ctx = apr_palloc(pool, sizeof(apr_sha1_ctx_t));
-        apr_sha1_init(ctx->apr_ctx);
+        ctx->apr_ctx = apr_palloc(pool, sizeof(svn__sha1_ctx_t));
+        svn__sha1_init(ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -580,8 +581,7 @@ svn_checksum_ctx_reset(svn_checksum_ctx_t *ctx)
         break;
 
       case svn_checksum_sha1:
-        memset(ctx->apr_ctx, 0, sizeof(apr_sha1_ctx_t));
-        apr_sha1_init(ctx->apr_ctx);
+        svn__sha1_init(ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -611,7 +611,7 @@ svn_checksum_update(svn_checksum_ctx_t *ctx,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_update(ctx->apr_ctx, data, (unsigned int)len);
+        svn__sha1_update(ctx->apr_ctx, data, len);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -644,7 +644,7 @@ svn_checksum_final(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_final((unsigned char *)(*checksum)->digest, ctx->apr_ctx);
+        svn__sha1_final((unsigned char *)(*checksum)->digest, ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -665,6 +665,97 @@ svn_checksum_final(svn_checksum_t **checksum,
   return SVN_NO_ERROR;
 }
 
+/* When calculating MD5 and SHA1 in one pass, feed the data to both in
+ * pieces of this many bytes.  That is small enough for each piece to still
+ * be in the L1 cache when the second checksum gets updated. */
+#define MD5_SHA1_BLOCK_SIZE 0x2000
+
+struct svn_checksum__md5_sha1_ctx_t
+{
+  apr_md5_ctx_t md5_ctx;
+  svn__sha1_ctx_t sha1_ctx;
+
+  /* If not set, only calculate the MD5 checksum. */
+  svn_boolean_t with_sha1;
+};
+
+svn_checksum__md5_sha1_ctx_t *
+svn_checksum__md5_sha1_ctx_create(svn_boolean_t with_sha1,
+                                  apr_pool_t *pool)
+{
+  svn_checksum__md5_sha1_ctx_t *ctx = apr_palloc(pool, sizeof(*ctx));
+  ctx->with_sha1 = with_sha1;
+  svn_checksum__md5_sha1_ctx_reset(ctx);
+
+  return ctx;
+}
+
+void
+svn_checksum__md5_sha1_ctx_reset(svn_checksum__md5_sha1_ctx_t *ctx)
+{
+  apr_md5_init(&ctx->md5_ctx);
+  svn__sha1_init(&ctx->sha1_ctx);
+}
+
+svn_error_t *
+svn_checksum__md5_sha1_update(svn_checksum__md5_sha1_ctx_t *ctx,
+                              const void *data,
+                              apr_size_t len)
+{
+  const char *input = data;
+
+  if (!ctx->with_sha1)
+    {
+      apr_md5_update(&ctx->md5_ctx, data, len);
+      return SVN_NO_ERROR;
+    }
+
+  while (len > 0)
+    {
+      apr_size_t to_process = MIN(len, MD5_SHA1_BLOCK_SIZE);
+
+      apr_md5_update(&ctx->md5_ctx, input, to_process);
+      svn__sha1_update(&ctx->sha1_ctx, input, to_process);
+
+      input += to_process;
+      len -= to_process;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_checksum__md5_sha1_final(svn_checksum_t **md5_checksum,
+                             svn_checksum_t **sha1_checksum,
+                             const svn_checksum__md5_sha1_ctx_t *ctx,
+                             apr_pool_t *pool)
+{
+  /* apr_md5_final() modifies the context it finalizes. */
+  apr_md5_ctx_t md5_ctx = ctx->md5_ctx;
+
+  if (md5_checksum)
+    {
+      *md5_checksum = svn_checksum_create(svn_checksum_md5, pool);
+      apr_md5_final((unsigned char *)(*md5_checksum)->digest, &md5_ctx);
+    }
+
+  if (sha1_checksum)
+    {
+      if (ctx->with_sha1)
+        {
+          *sha1_checksum = svn_checksum_create(svn_checksum_sha1, pool);
+          svn__sha1_final((unsigned char *)(*sha1_checksum)->digest,
+                          &ctx->sha1_ctx);
+        }
+      else
+        {
+          *sha1_checksum = NULL;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 apr_size_t
 svn_checksum_size(const svn_checksum_t *checksum)
 {
@@ -854,3 +945,93 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
 
   return result;
 }
+
+/* Baton used by the stream returned by
+ * svn_checksum__wrap_write_stream_md5_sha1.
+ */
+typedef struct md5_sha1_stream_baton_t
+{
+  /* Stream we are wrapping.  Forward all operations to it. */
+  svn_stream_t *inner_stream;
+
+  /* Build the checksums in here. */
+  svn_checksum__md5_sha1_ctx_t *context;
+
+  /* Write the final checksums here.  Either may be NULL. */
+  svn_checksum_t **md5_checksum;
+  svn_checksum_t **sha1_checksum;
+
+  /* Allocate the resulting checksums here. */
+  apr_pool_t *pool;
+} md5_sha1_stream_baton_t;
+
+/* Implement svn_write_fn_t.
+ * Update the checksums and pass data on to the inner stream.
+ */
+static svn_error_t *
+write_handler_md5_sha1(void *baton,
+                       const char *data,
+                       apr_size_t *len)
+{
+  md5_sha1_stream_baton_t *b = baton;
+
+  SVN_ERR(svn_checksum__md5_sha1_update(b->context, data, *len));
+  SVN_ERR(svn_stream_write(b->inner_stream, data, len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_close_fn_t.
+ * Finalize the checksum calculation and write results.  Close inner stream.
+ */
+static svn_error_t *
+close_handler_md5_sha1(void *baton)
+{
+  md5_sha1_stream_baton_t *b = baton;
+
+  SVN_ERR(svn_checksum__md5_sha1_final(b->md5_checksum, b->sha1_checksum,
+                                       b->context, b->pool));
+
+  return svn_error_trace(svn_stream_close(b->inner_stream));
+}
+
+/* Implement svn_stream_seek_fn_t.
+ * Like svn_stream_checksummed2, only support resetting the stream.
+ */
+static svn_error_t *
+seek_handler_md5_sha1(void *baton,
+                      const svn_stream_mark_t *mark)
+{
+  md5_sha1_stream_baton_t *b = baton;
+
+  if (mark)
+    return svn_error_create(SVN_ERR_STREAM_SEEK_NOT_SUPPORTED, NULL, NULL);
+
+  svn_checksum__md5_sha1_ctx_reset(b->context);
+  return svn_error_trace(svn_stream_reset(b->inner_stream));
+}
+
+svn_stream_t *
+svn_checksum__wrap_write_stream_md5_sha1(svn_checksum_t **md5_checksum,
+                                         svn_checksum_t **sha1_checksum,
+                                         svn_stream_t *inner_stream,
+                                         apr_pool_t *pool)
+{
+  svn_stream_t *outer_stream;
+
+  md5_sha1_stream_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+  baton->inner_stream = inner_stream;
+  baton->context = svn_checksum__md5_sha1_ctx_create(sha1_checksum != NULL,
+                                                     pool);
+  baton->md5_checksum = md5_checksum;
+  baton->sha1_checksum = sha1_checksum;
+  baton->pool = pool;
+
+  outer_stream = svn_stream_create(baton, pool);
+  svn_stream_set_write(outer_stream, write_handler_md5_sha1);
+  svn_stream_set_close(outer_stream, close_handler_md5_sha1);
+  if (svn_stream_supports_reset(inner_stream))
+    svn_stream_set_seek(outer_stream, seek_handler_md5_sha1);
+
+  return outer_stream;
+}
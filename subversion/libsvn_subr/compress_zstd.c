@@ -0,0 +1,485 @@
+/*
+ * compress_zstd.c:  Zstandard data compression routines
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+#ifdef SVN_HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+
+svn_boolean_t
+svn__zstd_available(void)
+{
+  return TRUE;
+}
+
+/* Return an error with CODE describing the zstd error RESULT. */
+static svn_error_t *
+zstd_error(apr_status_t code, size_t result)
+{
+  return svn_error_create(code, NULL, ZSTD_getErrorName(result));
+}
+
+/* Prepared dictionary.  CONTENTS has been copied into both contexts. */
+struct svn__zstd_dict_t
+{
+  /* ID from the dictionary header. */
+  apr_uint32_t id;
+
+  /* Dictionary prepared for compression. */
+  ZSTD_CDict *cdict;
+
+  /* Dictionary prepared for decompression. */
+  ZSTD_DDict *ddict;
+};
+
+/* Pool cleanup function releasing the zstd contexts in svn__zstd_dict_t
+ * *DATA. */
+static apr_status_t
+dict_cleanup(void *data)
+{
+  svn__zstd_dict_t *dict = data;
+
+  ZSTD_freeCDict(dict->cdict);
+  ZSTD_freeDDict(dict->ddict);
+
+  return APR_SUCCESS;
+}
+
+/* Implement svn__compress_zstd() and svn__compress_zstd_dict().
+ * CDICT may be NULL, in which case COMPRESSION_LEVEL will be used. */
+static svn_error_t *
+compress(const void *data, apr_size_t len,
+         svn_stringbuf_t *out,
+         int compression_level,
+         const ZSTD_CDict *cdict)
+{
+  apr_size_t hdrlen;
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN];
+  unsigned char *p;
+  size_t compressed_data_len;
+  size_t max_compressed_data_len;
+
+  p = svn__encode_uint(buf, (apr_uint64_t)len);
+  hdrlen = p - buf;
+  svn_stringbuf_setempty(out);
+  svn_stringbuf_appendbytes(out, (const char *)buf, hdrlen);
+
+  /* Short strings and SVN__COMPRESSION_NONE are stored as they are. */
+  if (compression_level == SVN__COMPRESSION_NONE || len < 32)
+    {
+      svn_stringbuf_appendbytes(out, data, len);
+      return SVN_NO_ERROR;
+    }
+
+  if (compression_level > SVN__COMPRESSION_ZSTD_MAX)
+    compression_level = SVN__COMPRESSION_ZSTD_MAX;
+
+  max_compressed_data_len = ZSTD_compressBound(len);
+  svn_stringbuf_ensure(out, max_compressed_data_len + hdrlen);
+  if (cdict)
+    {
+      ZSTD_CCtx *cctx = ZSTD_createCCtx();
+      if (cctx == NULL)
+        return svn_error_create(SVN_ERR_ZSTD_COMPRESSION_FAILED, NULL,
+                                _("Can't create zstd compression context"));
+
+      compressed_data_len = ZSTD_compress_usingCDict(cctx,
+                                                     out->data + out->len,
+                                                     max_compressed_data_len,
+                                                     data, len, cdict);
+      ZSTD_freeCCtx(cctx);
+    }
+  else
+    {
+      compressed_data_len = ZSTD_compress(out->data + out->len,
+                                          max_compressed_data_len,
+                                          data, len, compression_level);
+    }
+
+  if (ZSTD_isError(compressed_data_len))
+    return zstd_error(SVN_ERR_ZSTD_COMPRESSION_FAILED, compressed_data_len);
+
+  if (compressed_data_len >= len)
+    {
+      /* Compression didn't help :(, just append the original text */
+      svn_stringbuf_appendbytes(out, data, len);
+    }
+  else
+    {
+      out->len += compressed_data_len;
+      out->data[out->len] = 0;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn__decompress_zstd() and svn__decompress_zstd_dict().
+ * DDICT may be NULL. */
+static svn_error_t *
+decompress(const void *data, apr_size_t len,
+           svn_stringbuf_t *out,
+           apr_size_t limit,
+           const ZSTD_DDict *ddict)
+{
+  apr_size_t hdrlen;
+  apr_size_t compressed_data_len;
+  apr_size_t decompressed_data_len;
+  apr_uint64_t u64;
+  const unsigned char *p = data;
+  size_t rv;
+
+  /* First thing in the string is the original length.  */
+  p = svn__decode_uint(&u64, p, p + len);
+  if (p == NULL)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of compressed data failed: "
+                              "no size"));
+  if (u64 > limit)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of compressed data failed: "
+                              "size too large"));
+  decompressed_data_len = (apr_size_t)u64;
+  hdrlen = p - (const unsigned char *)data;
+  compressed_data_len = len - hdrlen;
+
+  svn_stringbuf_setempty(out);
+  svn_stringbuf_ensure(out, decompressed_data_len);
+
+  if (compressed_data_len == decompressed_data_len)
+    {
+      /* Data is in the original, uncompressed form. */
+      memcpy(out->data, p, decompressed_data_len);
+    }
+  else
+    {
+      if (ddict)
+        {
+          ZSTD_DCtx *dctx = ZSTD_createDCtx();
+          if (dctx == NULL)
+            return svn_error_create(SVN_ERR_ZSTD_DECOMPRESSION_FAILED, NULL,
+                                    _("Can't create zstd decompression "
+                                      "context"));
+
+          rv = ZSTD_decompress_usingDDict(dctx,
+                                          out->data, decompressed_data_len,
+                                          p, compressed_data_len, ddict);
+          ZSTD_freeDCtx(dctx);
+        }
+      else
+        {
+          rv = ZSTD_decompress(out->data, decompressed_data_len,
+                               p, compressed_data_len);
+        }
+
+      if (ZSTD_isError(rv))
+        return zstd_error(SVN_ERR_ZSTD_DECOMPRESSION_FAILED, rv);
+
+      if (rv != decompressed_data_len)
+        return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA,
+                                NULL,
+                                _("Size of uncompressed data "
+                                  "does not match stored original length"));
+    }
+
+  out->data[decompressed_data_len] = 0;
+  out->len = decompressed_data_len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int compression_level)
+{
+  return svn_error_trace(compress(data, len, out, compression_level, NULL));
+}
+
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit)
+{
+  return svn_error_trace(decompress(data, len, out, limit, NULL));
+}
+
+svn_error_t *
+svn__zstd_train_dict(svn_stringbuf_t **dict,
+                     const apr_array_header_t *samples,
+                     apr_size_t max_size,
+                     apr_uint32_t dict_id,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *result;
+  apr_size_t total_size = 0;
+  size_t *sample_sizes;
+  char *buffer;
+  char *p;
+  size_t dict_size;
+  int i;
+
+  SVN_ERR_ASSERT(dict_id != 0);
+
+  /* ZDICT expects all samples to be concatenated in a single buffer. */
+  for (i = 0; i < samples->nelts; ++i)
+    total_size += APR_ARRAY_IDX(samples, i, const svn_string_t *)->len;
+
+  buffer = apr_palloc(scratch_pool, total_size + 1);
+  sample_sizes = apr_palloc(scratch_pool,
+                            (samples->nelts + 1) * sizeof(*sample_sizes));
+  for (p = buffer, i = 0; i < samples->nelts; ++i)
+    {
+      const svn_string_t *sample
+        = APR_ARRAY_IDX(samples, i, const svn_string_t *);
+
+      memcpy(p, sample->data, sample->len);
+      p += sample->len;
+      sample_sizes[i] = sample->len;
+    }
+
+  result = svn_stringbuf_create_ensure(max_size, result_pool);
+  dict_size = ZDICT_trainFromBuffer(result->data, max_size, buffer,
+                                    sample_sizes, (unsigned)samples->nelts);
+
+  /* Training fails if there are too few or too small samples.
+   * Not having a dictionary is a valid outcome in that case. */
+  if (ZDICT_isError(dict_size) || dict_size < 8)
+    {
+      *dict = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  result->len = dict_size;
+  result->data[dict_size] = 0;
+
+  /* The dictionary ID is stored in little-endian byte order right after
+   * the 4 byte magic number. */
+  p = result->data + 4;
+  p[0] = (char)(dict_id & 0xff);
+  p[1] = (char)((dict_id >> 8) & 0xff);
+  p[2] = (char)((dict_id >> 16) & 0xff);
+  p[3] = (char)((dict_id >> 24) & 0xff);
+  if (ZDICT_getDictID(result->data, result->len) != dict_id)
+    return svn_error_create(SVN_ERR_ZSTD_COMPRESSION_FAILED, NULL,
+                            _("Unexpected zstd dictionary format"));
+
+  *dict = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn__zstd_dict_create(svn__zstd_dict_t **dict,
+                      const svn_string_t *contents,
+                      int compression_level,
+                      apr_pool_t *result_pool)
+{
+  svn__zstd_dict_t *result = apr_pcalloc(result_pool, sizeof(*result));
+
+  if (compression_level < SVN__COMPRESSION_ZSTD_MIN)
+    compression_level = SVN__COMPRESSION_ZSTD_MIN;
+  else if (compression_level > SVN__COMPRESSION_ZSTD_MAX)
+    compression_level = SVN__COMPRESSION_ZSTD_MAX;
+
+  result->id = ZDICT_getDictID(contents->data, contents->len);
+  if (result->id == 0)
+    return svn_error_create(SVN_ERR_ZSTD_DECOMPRESSION_FAILED, NULL,
+                            _("Invalid zstd dictionary"));
+
+  result->cdict = ZSTD_createCDict(contents->data, contents->len,
+                                   compression_level);
+  result->ddict = ZSTD_createDDict(contents->data, contents->len);
+  apr_pool_cleanup_register(result_pool, result, dict_cleanup,
+                            apr_pool_cleanup_null);
+
+  if (result->cdict == NULL || result->ddict == NULL)
+    return svn_error_create(SVN_ERR_ZSTD_DECOMPRESSION_FAILED, NULL,
+                            _("Invalid zstd dictionary"));
+
+  *dict = result;
+  return SVN_NO_ERROR;
+}
+
+apr_uint32_t
+svn__zstd_dict_id(const svn__zstd_dict_t *dict)
+{
+  return dict->id;
+}
+
+apr_uint32_t
+svn__zstd_get_dict_id(const void *data, apr_size_t len)
+{
+  apr_uint64_t u64;
+  const unsigned char *p = data;
+  apr_size_t compressed_data_len;
+
+  p = svn__decode_uint(&u64, p, p + len);
+  if (p == NULL)
+    return 0;
+
+  /* Uncompressed data never requires a dictionary. */
+  compressed_data_len = len - (p - (const unsigned char *)data);
+  if (compressed_data_len == u64)
+    return 0;
+
+  return ZSTD_getDictID_fromFrame(p, compressed_data_len);
+}
+
+svn_error_t *
+svn__compress_zstd_dict(const void *data, apr_size_t len,
+                        svn_stringbuf_t *out,
+                        const svn__zstd_dict_t *dict)
+{
+  /* The compression level is part of DICT->CDICT. */
+  return svn_error_trace(compress(data, len, out, SVN__COMPRESSION_ZSTD_MIN,
+                                  dict->cdict));
+}
+
+svn_error_t *
+svn__decompress_zstd_dict(const void *data, apr_size_t len,
+                          svn_stringbuf_t *out,
+                          apr_size_t limit,
+                          const svn__zstd_dict_t *dict)
+{
+  return svn_error_trace(decompress(data, len, out, limit, dict->ddict));
+}
+
+const char *
+svn_zstd__compiled_version(void)
+{
+  static const char zstd_version_str[] = APR_STRINGIFY(ZSTD_VERSION_MAJOR) "."
+                                         APR_STRINGIFY(ZSTD_VERSION_MINOR) "."
+                                         APR_STRINGIFY(ZSTD_VERSION_RELEASE);
+
+  return zstd_version_str;
+}
+
+const char *
+svn_zstd__runtime_version(void)
+{
+  return ZSTD_versionString();
+}
+
+#else /* !SVN_HAVE_ZSTD */
+
+svn_boolean_t
+svn__zstd_available(void)
+{
+  return FALSE;
+}
+
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int compression_level)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard compression is not supported "
+                            "by this build of Subversion"));
+}
+
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard decompression is not supported "
+                            "by this build of Subversion"));
+}
+
+svn_error_t *
+svn__zstd_train_dict(svn_stringbuf_t **dict,
+                     const apr_array_header_t *samples,
+                     apr_size_t max_size,
+                     apr_uint32_t dict_id,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard compression is not supported "
+                            "by this build of Subversion"));
+}
+
+svn_error_t *
+svn__zstd_dict_create(svn__zstd_dict_t **dict,
+                      const svn_string_t *contents,
+                      int compression_level,
+                      apr_pool_t *result_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard compression is not supported "
+                            "by this build of Subversion"));
+}
+
+apr_uint32_t
+svn__zstd_dict_id(const svn__zstd_dict_t *dict)
+{
+  return 0;
+}
+
+apr_uint32_t
+svn__zstd_get_dict_id(const void *data, apr_size_t len)
+{
+  return 0;
+}
+
+svn_error_t *
+svn__compress_zstd_dict(const void *data, apr_size_t len,
+                        svn_stringbuf_t *out,
+                        const svn__zstd_dict_t *dict)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard compression is not supported "
+                            "by this build of Subversion"));
+}
+
+svn_error_t *
+svn__decompress_zstd_dict(const void *data, apr_size_t len,
+                          svn_stringbuf_t *out,
+                          apr_size_t limit,
+                          const svn__zstd_dict_t *dict)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard decompression is not supported "
+                            "by this build of Subversion"));
+}
+
+const char *
+svn_zstd__compiled_version(void)
+{
+  return NULL;
+}
+
+const char *
+svn_zstd__runtime_version(void)
+{
+  return NULL;
+}
+
+#endif /* SVN_HAVE_ZSTD */
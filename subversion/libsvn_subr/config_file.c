@@ -1511,6 +1511,17 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### to show meaningful differences for binary file formats.  [New"  NL
         "### in 1.9]"                                                        NL
         "# diff-ignore-content-type = no"                                    NL
+        "### Set blame-threads to the number of threads that 'svn blame'"    NL
+        "### may use to compare subsequent revisions of the file while it"   NL
+        "### retrieves further revisions from the repository.  This speeds"  NL
+        "### up blaming files with a long history.  [New in 1.15]"           NL
+        "# blame-threads = 1"                                                NL
+        "### Set server-side-blame to 'no' to make 'svn blame' calculate"    NL
+        "### the blame information locally even if the server is able to"    NL
+        "### do it.  Servers that support this reuse the results of"         NL
+        "### earlier blame operations and avoid sending every revision of"   NL
+        "### the file to the client.  [New in 1.15]"                         NL
+        "# server-side-blame = yes"                                          NL
         ""                                                                   NL
         "### Section for configuring automatic properties."                  NL
         "[auto-props]"                                                       NL
@@ -0,0 +1,130 @@
+/*
+ * cpu.c :  run-time detection of CPU features
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "private/svn_cpu.h"
+
+#if SVN_CPU__X86_SIMD && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#elif SVN_CPU__X86_SIMD
+#include <cpuid.h>
+#endif
+
+/* Bit set in DETECTED_FEATURES once detection has been run. */
+#define FEATURES_DETECTED 0x80000000
+
+/* Cached result of detect_features() plus FEATURES_DETECTED.
+ * Races during initialization are benign because every thread will
+ * store the same value. */
+static volatile apr_uint32_t detected_features = 0;
+
+/* Features that the user allows us to report. */
+static volatile apr_uint32_t features_mask = ~(apr_uint32_t)0;
+
+/* Ask the CPU and the OS which of the features we know of are available. */
+static apr_uint32_t
+detect_features(void)
+{
+  apr_uint32_t result = 0;
+
+#if SVN_CPU__X86_SIMD && defined(_MSC_VER)
+
+  int info[4];
+  int max_leaf;
+  int sse_ok, avx_ok;
+
+  __cpuid(info, 0);
+  max_leaf = info[0];
+
+  if (max_leaf >= 1)
+    {
+      __cpuid(info, 1);
+      if (info[3] & (1 << 26))
+        result |= SVN_CPU__SSE2;
+
+      if (info[2] & (1 << 9))
+        result |= SVN_CPU__SSSE3;
+
+      /* The SHA extensions are used together with SSSE3 and SSE4.1. */
+      sse_ok = (info[2] & (1 << 9)) && (info[2] & (1 << 19));
+
+      /* AVX state must be enabled by the OS (OSXSAVE and XCR0). */
+      avx_ok = (info[2] & (1 << 27)) && (info[2] & (1 << 28))
+            && ((_xgetbv(0) & 6) == 6);
+
+      if (max_leaf >= 7)
+        {
+          __cpuidex(info, 7, 0);
+          if (avx_ok && (info[1] & (1 << 5)))
+            result |= SVN_CPU__AVX2;
+          if (sse_ok && (info[1] & (1 << 29)))
+            result |= SVN_CPU__SHA;
+        }
+    }
+
+#elif SVN_CPU__X86_SIMD
+
+  /* These builtins take care of the OS support checks as well. */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    result |= SVN_CPU__SSE2;
+  if (__builtin_cpu_supports("avx2"))
+    result |= SVN_CPU__AVX2;
+  if (__builtin_cpu_supports("ssse3"))
+    result |= SVN_CPU__SSSE3;
+
+  /* Not all compilers know the "sha" feature name.  The SHA extensions
+     only use SSE registers, so there is no OS support to check for. */
+  if (   __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1")
+      && __get_cpuid_max(0, NULL) >= 7)
+    {
+      unsigned int eax, ebx, ecx, edx;
+
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      if (ebx & (1 << 29))
+        result |= SVN_CPU__SHA;
+    }
+
+#endif
+
+  return result;
+}
+
+apr_uint32_t
+svn_cpu__features(void)
+{
+  apr_uint32_t features = detected_features;
+  if (!features)
+    {
+      features = detect_features() | FEATURES_DETECTED;
+      detected_features = features;
+    }
+
+  return features & features_mask & ~FEATURES_DETECTED;
+}
+
+void
+svn_cpu__set_features_mask(apr_uint32_t mask)
+{
+  features_mask = mask;
+}
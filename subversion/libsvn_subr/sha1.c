@@ -0,0 +1,380 @@
+/*
+ * sha1.c :  SHA-1 implementation with run-time CPU dispatch
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "private/svn_cpu.h"
+#include "sha1.h"
+
+/* The SHA intrinsics need a somewhat more recent compiler than the
+ * other vector extensions. */
+#if SVN_CPU__X86_SIMD \
+    && (   (defined(_MSC_VER) && _MSC_VER >= 1900) \
+        || (!defined(_MSC_VER) && (defined(__clang__) || __GNUC__ >= 5)))
+#define SHA1_X86_SHA 1
+#include <immintrin.h>
+#else
+#define SHA1_X86_SHA 0
+#endif
+
+/* Type of the functions that add the BLOCKS * SVN__SHA1_BLOCK_SIZE bytes
+ * at DATA to the intermediate hash value in STATE.
+ */
+typedef void (*sha1_blocks_func_t)(apr_uint32_t state[5],
+                                   const unsigned char *data,
+                                   apr_size_t blocks);
+
+/* Return X rotated left by N bits. */
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* Return the big-endian 32 bit value at P. */
+static APR_INLINE apr_uint32_t
+load_be32(const unsigned char *p)
+{
+  return ((apr_uint32_t)p[0] << 24) | ((apr_uint32_t)p[1] << 16)
+       | ((apr_uint32_t)p[2] << 8) | (apr_uint32_t)p[3];
+}
+
+/* Write VALUE in big-endian order to P. */
+static APR_INLINE void
+store_be32(unsigned char *p, apr_uint32_t value)
+{
+  p[0] = (unsigned char)(value >> 24);
+  p[1] = (unsigned char)(value >> 16);
+  p[2] = (unsigned char)(value >> 8);
+  p[3] = (unsigned char)value;
+}
+
+/* Portable implementation of sha1_blocks_func_t, as per FIPS 180-4. */
+static void
+sha1_blocks_portable(apr_uint32_t state[5],
+                     const unsigned char *data,
+                     apr_size_t blocks)
+{
+  apr_uint32_t w[16];
+
+  for (; blocks > 0; --blocks, data += SVN__SHA1_BLOCK_SIZE)
+    {
+      apr_uint32_t a = state[0];
+      apr_uint32_t b = state[1];
+      apr_uint32_t c = state[2];
+      apr_uint32_t d = state[3];
+      apr_uint32_t e = state[4];
+      int i;
+
+      for (i = 0; i < 80; ++i)
+        {
+          apr_uint32_t f, temp;
+
+          /* Keep only the last 16 words of the message schedule. */
+          if (i < 16)
+            {
+              w[i] = load_be32(data + 4 * i);
+            }
+          else
+            {
+              temp = w[(i + 13) & 15] ^ w[(i + 8) & 15]
+                   ^ w[(i + 2) & 15] ^ w[i & 15];
+              w[i & 15] = ROTL32(temp, 1);
+            }
+
+          if (i < 20)
+            f = (((c ^ d) & b) ^ d) + 0x5a827999;
+          else if (i < 40)
+            f = (b ^ c ^ d) + 0x6ed9eba1;
+          else if (i < 60)
+            f = ((b & c) | ((b | c) & d)) + 0x8f1bbcdc;
+          else
+            f = (b ^ c ^ d) + 0xca62c1d6;
+
+          temp = ROTL32(a, 5) + f + e + w[i & 15];
+          e = d;
+          d = c;
+          c = ROTL32(b, 30);
+          b = a;
+          a = temp;
+        }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+    }
+}
+
+#if SHA1_X86_SHA
+
+/* Implementation of sha1_blocks_func_t using the SHA extensions.
+ * Every step processes 4 rounds while the message schedule for the
+ * following steps gets calculated in MSG0 .. MSG3.  E0 and E1 alternate
+ * in holding the E value of the current step.
+ */
+SVN_CPU__TARGET("sha,sse4.1,ssse3")
+static void
+sha1_blocks_sha(apr_uint32_t state[5],
+                const unsigned char *data,
+                apr_size_t blocks)
+{
+  const __m128i byte_swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                         8, 9, 10, 11, 12, 13, 14, 15);
+  __m128i abcd, e0, e1, abcd_save, e0_save;
+  __m128i msg0, msg1, msg2, msg3;
+
+  abcd = _mm_loadu_si128((const __m128i *)state);
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+/* Load the next 16 message bytes into MSG in host word order. */
+#define LOAD(msg, offset) \
+  msg = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + offset)), \
+                         byte_swap)
+
+/* 4 rounds with round function F, using and updating E_CUR with
+ * message words MSG and saving the state for the next E in E_NEXT. */
+#define ROUNDS(e_cur, e_next, msg, f) \
+  e_cur = _mm_sha1nexte_epu32(e_cur, msg); \
+  e_next = abcd; \
+  abcd = _mm_sha1rnds4_epu32(abcd, e_cur, f)
+
+/* Message schedule steps. */
+#define MSG1(target, msg) target = _mm_sha1msg1_epu32(target, msg)
+#define MSG2(target, msg) target = _mm_sha1msg2_epu32(target, msg)
+#define XOR(target, msg) target = _mm_xor_si128(target, msg)
+
+  for (; blocks > 0; --blocks, data += SVN__SHA1_BLOCK_SIZE)
+    {
+      abcd_save = abcd;
+      e0_save = e0;
+
+      /* Rounds 0 .. 15 */
+      LOAD(msg0, 0);
+      e0 = _mm_add_epi32(e0, msg0);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+      LOAD(msg1, 16);
+      ROUNDS(e1, e0, msg1, 0);
+      MSG1(msg0, msg1);
+
+      LOAD(msg2, 32);
+      ROUNDS(e0, e1, msg2, 0);
+      MSG1(msg1, msg2);
+      XOR(msg0, msg2);
+
+      LOAD(msg3, 48);
+      ROUNDS(e1, e0, msg3, 0);
+      MSG2(msg0, msg3);
+      MSG1(msg2, msg3);
+      XOR(msg1, msg3);
+
+      /* Rounds 16 .. 31 */
+      ROUNDS(e0, e1, msg0, 0);
+      MSG2(msg1, msg0);
+      MSG1(msg3, msg0);
+      XOR(msg2, msg0);
+
+      ROUNDS(e1, e0, msg1, 1);
+      MSG2(msg2, msg1);
+      MSG1(msg0, msg1);
+      XOR(msg3, msg1);
+
+      ROUNDS(e0, e1, msg2, 1);
+      MSG2(msg3, msg2);
+      MSG1(msg1, msg2);
+      XOR(msg0, msg2);
+
+      ROUNDS(e1, e0, msg3, 1);
+      MSG2(msg0, msg3);
+      MSG1(msg2, msg3);
+      XOR(msg1, msg3);
+
+      /* Rounds 32 .. 47 */
+      ROUNDS(e0, e1, msg0, 1);
+      MSG2(msg1, msg0);
+      MSG1(msg3, msg0);
+      XOR(msg2, msg0);
+
+      ROUNDS(e1, e0, msg1, 1);
+      MSG2(msg2, msg1);
+      MSG1(msg0, msg1);
+      XOR(msg3, msg1);
+
+      ROUNDS(e0, e1, msg2, 2);
+      MSG2(msg3, msg2);
+      MSG1(msg1, msg2);
+      XOR(msg0, msg2);
+
+      ROUNDS(e1, e0, msg3, 2);
+      MSG2(msg0, msg3);
+      MSG1(msg2, msg3);
+      XOR(msg1, msg3);
+
+      /* Rounds 48 .. 63 */
+      ROUNDS(e0, e1, msg0, 2);
+      MSG2(msg1, msg0);
+      MSG1(msg3, msg0);
+      XOR(msg2, msg0);
+
+      ROUNDS(e1, e0, msg1, 2);
+      MSG2(msg2, msg1);
+      MSG1(msg0, msg1);
+      XOR(msg3, msg1);
+
+      ROUNDS(e0, e1, msg2, 2);
+      MSG2(msg3, msg2);
+      MSG1(msg1, msg2);
+      XOR(msg0, msg2);
+
+      ROUNDS(e1, e0, msg3, 3);
+      MSG2(msg0, msg3);
+      MSG1(msg2, msg3);
+      XOR(msg1, msg3);
+
+      /* Rounds 64 .. 79 */
+      ROUNDS(e0, e1, msg0, 3);
+      MSG2(msg1, msg0);
+      MSG1(msg3, msg0);
+      XOR(msg2, msg0);
+
+      ROUNDS(e1, e0, msg1, 3);
+      MSG2(msg2, msg1);
+      XOR(msg3, msg1);
+
+      ROUNDS(e0, e1, msg2, 3);
+      MSG2(msg3, msg2);
+
+      ROUNDS(e1, e0, msg3, 3);
+
+      /* Add this block's result to the intermediate hash value. */
+      e0 = _mm_sha1nexte_epu32(e0, e0_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+#undef LOAD
+#undef ROUNDS
+#undef MSG1
+#undef MSG2
+#undef XOR
+
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  _mm_storeu_si128((__m128i *)state, abcd);
+  state[4] = (apr_uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+#endif /* SHA1_X86_SHA */
+
+/* Return the fastest implementation of sha1_blocks_func_t for this CPU. */
+static sha1_blocks_func_t
+get_blocks_func(void)
+{
+#if SHA1_X86_SHA
+  if (svn_cpu__features() & SVN_CPU__SHA)
+    return sha1_blocks_sha;
+#endif
+
+  return sha1_blocks_portable;
+}
+
+void
+svn__sha1_init(svn__sha1_ctx_t *ctx)
+{
+  ctx->state[0] = 0x67452301;
+  ctx->state[1] = 0xefcdab89;
+  ctx->state[2] = 0x98badcfe;
+  ctx->state[3] = 0x10325476;
+  ctx->state[4] = 0xc3d2e1f0;
+  ctx->count = 0;
+}
+
+void
+svn__sha1_update(svn__sha1_ctx_t *ctx,
+                 const void *data,
+                 apr_size_t len)
+{
+  const unsigned char *input = data;
+  apr_size_t used = (apr_size_t)(ctx->count % SVN__SHA1_BLOCK_SIZE);
+  sha1_blocks_func_t blocks_func;
+
+  ctx->count += len;
+
+  /* Small amounts of data only fill up the buffer. */
+  if (used + len < SVN__SHA1_BLOCK_SIZE)
+    {
+      memcpy(ctx->buffer + used, input, len);
+      return;
+    }
+
+  blocks_func = get_blocks_func();
+
+  /* Complete the buffered block. */
+  if (used)
+    {
+      apr_size_t to_copy = SVN__SHA1_BLOCK_SIZE - used;
+      memcpy(ctx->buffer + used, input, to_copy);
+      blocks_func(ctx->state, ctx->buffer, 1);
+
+      input += to_copy;
+      len -= to_copy;
+    }
+
+  /* Process all full blocks directly from the input. */
+  if (len >= SVN__SHA1_BLOCK_SIZE)
+    {
+      apr_size_t blocks = len / SVN__SHA1_BLOCK_SIZE;
+      blocks_func(ctx->state, input, blocks);
+
+      input += blocks * SVN__SHA1_BLOCK_SIZE;
+      len -= blocks * SVN__SHA1_BLOCK_SIZE;
+    }
+
+  memcpy(ctx->buffer, input, len);
+}
+
+void
+svn__sha1_final(unsigned char digest[SVN__SHA1_DIGEST_SIZE],
+                const svn__sha1_ctx_t *ctx)
+{
+  /* Padding: a single 1 bit, zeros and the message length in bits as
+   * a big-endian 64 bit number, completing the last one or two blocks. */
+  unsigned char tail[2 * SVN__SHA1_BLOCK_SIZE];
+  apr_size_t used = (apr_size_t)(ctx->count % SVN__SHA1_BLOCK_SIZE);
+  apr_size_t tail_len = used < SVN__SHA1_BLOCK_SIZE - 8
+                      ? SVN__SHA1_BLOCK_SIZE
+                      : 2 * SVN__SHA1_BLOCK_SIZE;
+  apr_uint64_t bits = ctx->count * 8;
+  apr_uint32_t state[5];
+  int i;
+
+  memcpy(tail, ctx->buffer, used);
+  tail[used] = 0x80;
+  memset(tail + used + 1, 0, tail_len - used - 9);
+  store_be32(tail + tail_len - 8, (apr_uint32_t)(bits >> 32));
+  store_be32(tail + tail_len - 4, (apr_uint32_t)bits);
+
+  memcpy(state, ctx->state, sizeof(state));
+  get_blocks_func()(state, tail, tail_len / SVN__SHA1_BLOCK_SIZE);
+
+  for (i = 0; i < 5; ++i)
+    store_be32(digest + 4 * i, state[i]);
+}
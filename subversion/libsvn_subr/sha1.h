@@ -0,0 +1,76 @@
+/*
+ * sha1.h :  SHA-1 implementation with run-time CPU dispatch
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_SUBR_SHA1_H
+#define SVN_LIBSVN_SUBR_SHA1_H
+
+#include <apr.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Size of a SHA-1 digest in bytes and of the blocks it processes. */
+#define SVN__SHA1_DIGEST_SIZE 20
+#define SVN__SHA1_BLOCK_SIZE 64
+
+/* SHA-1 checksum creation context.  Unlike APR's implementation, this one
+ * uses the SHA extensions of x86 CPUs if they are available at run-time.
+ * Treat the members as private.
+ */
+typedef struct svn__sha1_ctx_t
+{
+  /* Intermediate hash value. */
+  apr_uint32_t state[5];
+
+  /* Total number of bytes fed into the context so far. */
+  apr_uint64_t count;
+
+  /* Incomplete block, its size being COUNT modulo SVN__SHA1_BLOCK_SIZE. */
+  unsigned char buffer[SVN__SHA1_BLOCK_SIZE];
+} svn__sha1_ctx_t;
+
+/* Reset CTX to the initial state, i.e. to the checksum of no data. */
+void
+svn__sha1_init(svn__sha1_ctx_t *ctx);
+
+/* Feed LEN bytes from DATA into CTX. */
+void
+svn__sha1_update(svn__sha1_ctx_t *ctx,
+                 const void *data,
+                 apr_size_t len);
+
+/* Write the SHA-1 digest over all data fed into CTX to DIGEST.
+ * CTX itself remains unchanged.
+ */
+void
+svn__sha1_final(unsigned char digest[SVN__SHA1_DIGEST_SIZE],
+                const svn__sha1_ctx_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_SUBR_SHA1_H */
@@ -32,9 +32,18 @@
 #include <apr_fnmatch.h>
 #include "svn_string.h"  /* loads "svn_types.h" and <apr_pools.h> */
 #include "svn_ctype.h"
+#include "private/svn_cpu.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_string_private.h"
 
+#if SVN_CPU__X86_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+#if SVN_CPU__X86_SIMD && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "svn_private_config.h"
 
 
@@ -1501,6 +1510,116 @@ svn_string__similarity(const svn_string_t *stringa,
     return SVN_STRING__SIM_RANGE_MAX;
 }
 
+#if SVN_CPU__X86_SIMD
+
+/* Return the index of the lowest set bit in the non-zero VALUE. */
+static APR_INLINE int
+lowest_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return (int)index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+/* Return the index of the highest set bit in the non-zero VALUE. */
+static APR_INLINE int
+highest_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse(&index, value);
+  return (int)index;
+#else
+  return 31 - __builtin_clz(value);
+#endif
+}
+
+/* SSE2 implementation of svn_cstring__match_length. */
+SVN_CPU__TARGET("sse2")
+static apr_size_t
+match_length_sse2(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+  for (; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b + pos));
+      apr_uint32_t mismatch
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) ^ 0xffff;
+
+      if (mismatch)
+        return pos + lowest_bit(mismatch);
+    }
+
+  for (; pos < max_len; ++pos)
+    if (a[pos] != b[pos])
+      break;
+
+  return pos;
+}
+
+/* AVX2 implementation of svn_cstring__match_length. */
+SVN_CPU__TARGET("avx2")
+static apr_size_t
+match_length_avx2(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+  for (; max_len - pos >= sizeof(__m256i); pos += sizeof(__m256i))
+    {
+      __m256i lhs = _mm256_loadu_si256((const __m256i *)(a + pos));
+      __m256i rhs = _mm256_loadu_si256((const __m256i *)(b + pos));
+      apr_uint32_t mismatch
+        = ~(apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs));
+
+      if (mismatch)
+        return pos + lowest_bit(mismatch);
+    }
+
+  /* Let SSE2 handle the remainder. */
+  return pos + match_length_sse2(a + pos, b + pos, max_len - pos);
+}
+
+/* SSE2 implementation of svn_cstring__reverse_match_length. */
+SVN_CPU__TARGET("sse2")
+static apr_size_t
+reverse_match_length_sse2(const char *a,
+                          const char *b,
+                          apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = sizeof(__m128i); pos <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a - pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b - pos));
+      apr_uint32_t mismatch
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) ^ 0xffff;
+
+      /* The highest mismatching byte is the one closest to A and B. */
+      if (mismatch)
+        return pos - 1 - highest_bit(mismatch);
+    }
+
+  pos -= sizeof(__m128i);
+  while (++pos <= max_len)
+    if (a[0-pos] != b[0-pos])
+      return pos - 1;
+
+  return max_len;
+}
+
+#endif /* SVN_CPU__X86_SIMD */
+
 apr_size_t
 svn_cstring__match_length(const char *a,
                           const char *b,
@@ -1508,6 +1627,20 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if SVN_CPU__X86_SIMD
+
+  /* Vector compares pay off even for moderately short ranges. */
+  if (max_len >= 16)
+    {
+      apr_uint32_t features = svn_cpu__features();
+      if (features & SVN_CPU__AVX2)
+        return match_length_avx2(a, b, max_len);
+      if (features & SVN_CPU__SSE2)
+        return match_length_sse2(a, b, max_len);
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1536,6 +1669,13 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if SVN_CPU__X86_SIMD
+
+  if (max_len >= 16 && (svn_cpu__features() & SVN_CPU__SSE2))
+    return reverse_match_length_sse2(a, b, max_len);
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
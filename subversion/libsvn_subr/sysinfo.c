@@ -45,6 +45,7 @@
 #include "svn_utf.h"
 #include "svn_version.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_sqlite.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_utf_private.h"
@@ -68,6 +69,10 @@
 #include <elf.h>
 #endif
 
+#if HAVE_SCHED_GETCPU
+#include <sched.h>
+#endif
+
 #ifdef SVN_HAVE_MACOS_PLIST
 #include <CoreFoundation/CoreFoundation.h>
 #include <AvailabilityMacros.h>
@@ -141,7 +146,7 @@ const apr_array_header_t *
 svn_sysinfo__linked_libs(apr_pool_t *pool)
 {
   svn_version_ext_linked_lib_t *lib;
-  apr_array_header_t *array = apr_array_make(pool, 7, sizeof(*lib));
+  apr_array_header_t *array = apr_array_make(pool, 8, sizeof(*lib));
   int lz4_version = svn_lz4__runtime_version();
 
   lib = &APR_ARRAY_PUSH(array, svn_version_ext_linked_lib_t);
@@ -191,9 +196,128 @@ svn_sysinfo__linked_libs(apr_pool_t *pool)
                                       (lz4_version / 100) % 100,
                                       lz4_version % 100);
 
+  if (svn__zstd_available())
+    {
+      lib = &APR_ARRAY_PUSH(array, svn_version_ext_linked_lib_t);
+      lib->name = "Zstd";
+      lib->compiled_version = apr_pstrdup(pool, svn_zstd__compiled_version());
+      lib->runtime_version = apr_pstrdup(pool, svn_zstd__runtime_version());
+    }
+
   return array;
 }
 
+#if __linux__ && HAVE_SCHED_GETCPU
+
+/* Upper limit to the CPU indexes that we can map to NUMA nodes.
+ * Threads on CPUs beyond that limit will be associated with node 0. */
+#define MAX_NUMA_CPUS 4096
+
+/* Maps CPU indexes to NUMA nodes, filled by init_numa_topology. */
+static apr_uint16_t cpu_to_numa_node[MAX_NUMA_CPUS];
+
+/* Number of NUMA nodes found by init_numa_topology. */
+static int numa_node_count = 1;
+
+/* Initialization status of the above. */
+static volatile svn_atomic_t numa_topology_initialized = FALSE;
+
+/* Assign all CPUs given in Linux' CPULIST format, e.g. "0-7,16-23",
+ * to NUMA node NODE in cpu_to_numa_node. */
+static void
+assign_cpus_to_node(const char *cpulist,
+                    int node)
+{
+  while (*cpulist)
+    {
+      char *end;
+      long first = strtol(cpulist, &end, 10);
+      long last = first;
+      if (end == cpulist)
+        break;
+
+      if (*end == '-')
+        {
+          cpulist = end + 1;
+          last = strtol(cpulist, &end, 10);
+          if (end == cpulist)
+            break;
+        }
+
+      for (; first <= last && first < MAX_NUMA_CPUS; ++first)
+        if (first >= 0)
+          cpu_to_numa_node[first] = (apr_uint16_t)node;
+
+      if (*end != ',')
+        break;
+
+      cpulist = end + 1;
+    }
+}
+
+/* Read the NUMA topology from sysfs.  Nodes are expected to be numbered
+ * consecutively, starting at 0.  Implements svn_atomic__err_init_func_t.
+ */
+static svn_error_t *
+init_numa_topology(void *baton,
+                   apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int node;
+
+  for (node = 0; node < APR_UINT16_MAX; ++node)
+    {
+      svn_stringbuf_t *cpulist;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      err = svn_stringbuf_from_file2(&cpulist,
+                                     apr_psprintf(iterpool,
+                                        "/sys/devices/system/node/node%d/cpulist",
+                                        node),
+                                     iterpool);
+      if (err)
+        {
+          svn_error_clear(err);
+          break;
+        }
+
+      assign_cpus_to_node(cpulist->data, node);
+    }
+
+  numa_node_count = node > 1 ? node : 1;
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+int
+svn_sysinfo__numa_node_count(apr_pool_t *scratch_pool)
+{
+#if __linux__ && HAVE_SCHED_GETCPU
+  svn_error_clear(svn_atomic__init_once(&numa_topology_initialized,
+                                        init_numa_topology, NULL,
+                                        scratch_pool));
+  return numa_node_count;
+#else
+  return 1;
+#endif
+}
+
+int
+svn_sysinfo__current_numa_node(void)
+{
+#if __linux__ && HAVE_SCHED_GETCPU
+  int cpu = sched_getcpu();
+  if (cpu >= 0 && cpu < MAX_NUMA_CPUS)
+    return cpu_to_numa_node[cpu];
+#endif
+
+  return 0;
+}
+
 const apr_array_header_t *
 svn_sysinfo__loaded_libs(apr_pool_t *pool)
 {
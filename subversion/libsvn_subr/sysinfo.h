@@ -62,6 +62,21 @@ const apr_array_header_t *svn_sysinfo__linked_libs(apr_pool_t *pool);
  */
 const apr_array_header_t *svn_sysinfo__loaded_libs(apr_pool_t *pool);
 
+/* Return the number of NUMA nodes of the running system or 1, if that
+ * information is not available.  The first call also initializes the
+ * data needed by svn_sysinfo__current_numa_node.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+int svn_sysinfo__numa_node_count(apr_pool_t *scratch_pool);
+
+/* Return the index of the NUMA node that the calling thread is currently
+ * running on or 0 if that information is not available.  This is cheap
+ * enough to be called on every cache access.  Before the first call to
+ * svn_sysinfo__numa_node_count, this will always return 0.
+ */
+int svn_sysinfo__current_numa_node(void);
+
 #ifdef WIN32
 /* Obtain the Windows version information as OSVERSIONINFOEXW structure.
  *
@@ -0,0 +1,820 @@
+/*
+ * task.c :  processing independent work items in parallel
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+
+#include "svn_pools.h"
+
+#include "private/svn_mutex.h"
+#include "private/svn_task.h"
+
+#include "svn_private_config.h"
+
+/* Number of work items per worker thread that may be in flight, i.e.
+ * processed but not consumed yet.  Larger values reduce the chance of
+ * workers idling while the output lags behind but increase the memory
+ * footprint.
+ */
+#define ITEMS_PER_THREAD 4
+
+/* While waiting for results, poll the cancellation callback at least
+ * this often (in microseconds).
+ */
+#define CANCEL_POLL_INTERVAL 100000
+
+/* Process all items in the calling thread.  The parameters are the same
+ * as for svn_task__run_ordered.
+ */
+static svn_error_t *
+run_sequentially(apr_int64_t count,
+                 svn_task__process_func_t process_func,
+                 void *process_baton,
+                 svn_task__thread_context_func_t context_func,
+                 void *context_baton,
+                 svn_task__output_func_t output_func,
+                 void *output_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *context_pool = svn_pool_create(scratch_pool);
+  apr_pool_t *result_pool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  void *thread_context = NULL;
+  apr_int64_t i;
+
+  if (context_func)
+    SVN_ERR(context_func(&thread_context, context_baton, context_pool,
+                         iterpool));
+
+  for (i = 0; i < count; ++i)
+    {
+      void *result;
+
+      svn_pool_clear(result_pool);
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(process_func(&result, process_baton, thread_context, i,
+                           result_pool, iterpool));
+      if (output_func)
+        SVN_ERR(output_func(output_baton, result, i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(result_pool);
+  svn_pool_destroy(context_pool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Buffer for the result of a single work item.
+ */
+typedef struct slot_t
+{
+  /* Root pool that the result is allocated in.  It has its own allocator
+   * because worker and consumer threads take turns in using it. */
+  apr_pool_t *pool;
+
+  /* Item as passed to svn_task__queue_push.  Unused for
+   * svn_task__run_ordered. */
+  void *item;
+
+  /* Result as returned by the process function. */
+  void *result;
+
+  /* Error returned by the process function. */
+  svn_error_t *err;
+
+  /* Set if RESULT and ERR are valid. */
+  svn_boolean_t done;
+} slot_t;
+
+/* Per worker thread data.
+ */
+typedef struct worker_baton_t
+{
+  /* The shared state. */
+  struct run_t *run;
+
+  /* Error that terminated the thread. */
+  svn_error_t *err;
+} worker_baton_t;
+
+/* Shared state of all threads taking part in a svn_task__run_ordered call
+ * or working on a svn_task__queue_t.  All members that are not constant
+ * must only be accessed while holding MUTEX.
+ */
+typedef struct run_t
+{
+  /* Parameters as passed to svn_task__run_ordered. */
+  apr_int64_t count;
+  svn_task__process_func_t process_func;
+  void *process_baton;
+  svn_task__thread_context_func_t context_func;
+  void *context_baton;
+
+  /* If set, pass the items stored in the slots to PROCESS_FUNC instead
+   * of PROCESS_BATON. */
+  svn_boolean_t queued;
+
+  /* If not set, more items may get added, i.e. COUNT may still grow. */
+  svn_boolean_t closed;
+
+  /* Result buffers.  Item I uses SLOTS[I % SLOT_COUNT]. */
+  slot_t *slots;
+  int slot_count;
+
+  /* Next item to be picked up by a worker thread. */
+  apr_int64_t next_item;
+
+  /* Next item to be passed to the output function. */
+  apr_int64_t next_output;
+
+  /* If set, workers shall not pick up any more items. */
+  svn_boolean_t aborted;
+
+  /* Synchronization.  CHANGED gets signalled whenever any of the above
+   * changes. */
+  svn_mutex__t *mutex;
+  apr_thread_cond_t *changed;
+
+  /* The worker threads, STARTED of them actually running. */
+  apr_thread_t **threads;
+  worker_baton_t *batons;
+  int thread_count;
+  int started;
+} run_t;
+
+/* Wake up all threads waiting for some change to RUN.
+ */
+static svn_error_t *
+signal_change(run_t *run)
+{
+  apr_status_t status = apr_thread_cond_broadcast(run->changed);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't broadcast condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *INDEX to the next item to process for RUN.  Wait for slots or,
+ * for queues, new items to become available as necessary.  Set *INDEX to
+ * -1 if there is nothing left to do.  Must be called while holding
+ * RUN->MUTEX.
+ */
+static svn_error_t *
+claim_item(apr_int64_t *index,
+           run_t *run)
+{
+  while (   !run->aborted
+         && (run->next_item < run->count
+               ? run->next_item >= run->next_output + run->slot_count
+               : !run->closed))
+    {
+      apr_status_t status
+        = apr_thread_cond_wait(run->changed, svn_mutex__get(run->mutex));
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't wait for condition variable"));
+    }
+
+  if (run->aborted || run->next_item >= run->count)
+    *index = -1;
+  else
+    *index = run->next_item++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Store RESULT and ERR as the outcome of item INDEX in RUN.
+ * Must be called while holding RUN->MUTEX.
+ */
+static svn_error_t *
+complete_item(run_t *run,
+              apr_int64_t index,
+              void *result,
+              svn_error_t *err)
+{
+  slot_t *slot = &run->slots[index % run->slot_count];
+  slot->result = result;
+  slot->err = err;
+  slot->done = TRUE;
+
+  /* Don't waste any more effort if we are going to fail anyway. */
+  if (err)
+    run->aborted = TRUE;
+
+  return svn_error_trace(signal_change(run));
+}
+
+/* Tell all threads of RUN to stop.  Must be called while holding
+ * RUN->MUTEX.
+ */
+static svn_error_t *
+abort_run(run_t *run)
+{
+  run->aborted = TRUE;
+  return svn_error_trace(signal_change(run));
+}
+
+/* Thread-safe wrapper around abort_run.
+ */
+static svn_error_t *
+stop_run(run_t *run)
+{
+  SVN_MUTEX__WITH_LOCK(run->mutex, abort_run(run));
+  return SVN_NO_ERROR;
+}
+
+/* The main loop of a worker thread for RUN.
+ */
+static svn_error_t *
+process_items(run_t *run)
+{
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  void *thread_context = NULL;
+
+  if (run->context_func)
+    {
+      svn_error_t *err = run->context_func(&thread_context,
+                                           run->context_baton, pool,
+                                           iterpool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+    }
+
+  while (TRUE)
+    {
+      apr_int64_t index;
+      slot_t *slot;
+      void *result = NULL;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      SVN_MUTEX__WITH_LOCK(run->mutex, claim_item(&index, run));
+      if (index < 0)
+        break;
+
+      /* Nobody else will touch this slot until we mark it as done. */
+      slot = &run->slots[index % run->slot_count];
+      err = run->process_func(&result,
+                              run->queued ? slot->item : run->process_baton,
+                              thread_context, index, slot->pool, iterpool);
+
+      SVN_MUTEX__WITH_LOCK(run->mutex,
+                           complete_item(run, index, result, err));
+    }
+
+  svn_pool_destroy(pool);
+  return SVN_NO_ERROR;
+}
+
+/* Thread function executing process_items for the worker_baton_t given
+ * in DATA.
+ */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *thread, void *data)
+{
+  worker_baton_t *baton = data;
+  baton->err = process_items(baton->run);
+
+  /* Don't let the consumer wait for us. */
+  if (baton->err)
+    svn_error_clear(stop_run(baton->run));
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Wait until SLOT has been filled or RUN has been aborted.  Poll
+ * CANCEL_FUNC with CANCEL_BATON while waiting.  Must be called while
+ * holding RUN->MUTEX.
+ */
+static svn_error_t *
+wait_for_slot(run_t *run,
+              slot_t *slot,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton)
+{
+  while (!slot->done && !run->aborted)
+    {
+      apr_status_t status;
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      status = apr_thread_cond_timedwait(run->changed,
+                                         svn_mutex__get(run->mutex),
+                                         CANCEL_POLL_INTERVAL);
+      if (status && !APR_STATUS_IS_TIMEUP(status))
+        return svn_error_wrap_apr(status,
+                                  _("Can't wait for condition variable"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Make the SLOT of the item just consumed available to the workers of
+ * RUN again.  Must be called while holding RUN->MUTEX.
+ */
+static svn_error_t *
+release_slot(run_t *run,
+             slot_t *slot)
+{
+  slot->done = FALSE;
+  slot->item = NULL;
+  slot->result = NULL;
+  run->next_output++;
+
+  return svn_error_trace(signal_change(run));
+}
+
+/* Wait for the result of the next item of RUN and pass it to OUTPUT_FUNC
+ * with OUTPUT_BATON.  Set *CONSUMED to FALSE if the workers gave up on us
+ * before providing that result; their error will be reported when
+ * joining them.  The other parameters are the same as for
+ * svn_task__run_ordered.
+ */
+static svn_error_t *
+consume_item(svn_boolean_t *consumed,
+             run_t *run,
+             svn_task__output_func_t output_func,
+             void *output_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  apr_int64_t index = run->next_output;
+  slot_t *slot = &run->slots[index % run->slot_count];
+
+  SVN_MUTEX__WITH_LOCK(run->mutex,
+                       wait_for_slot(run, slot, cancel_func, cancel_baton));
+
+  *consumed = slot->done;
+  if (!slot->done)
+    return SVN_NO_ERROR;
+
+  if (slot->err)
+    {
+      svn_error_t *err = slot->err;
+      slot->err = NULL;
+      return svn_error_trace(err);
+    }
+
+  if (output_func)
+    SVN_ERR(output_func(output_baton, slot->result, index, scratch_pool));
+
+  svn_pool_clear(slot->pool);
+  SVN_MUTEX__WITH_LOCK(run->mutex, release_slot(run, slot));
+
+  return SVN_NO_ERROR;
+}
+
+/* Consume the results of RUN in order, passing them to OUTPUT_FUNC with
+ * OUTPUT_BATON.  The other parameters are the same as for
+ * svn_task__run_ordered.
+ */
+static svn_error_t *
+consume_results(run_t *run,
+                svn_task__output_func_t output_func,
+                void *output_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (run->next_output < run->count)
+    {
+      svn_boolean_t consumed;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(consume_item(&consumed, run, output_func, output_baton,
+                           cancel_func, cancel_baton, iterpool));
+
+      /* The workers gave up on us.  Their error will be reported by
+       * our caller. */
+      if (!consumed)
+        break;
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Initialize RUN for up to THREAD_COUNT worker threads and start them.
+ * All other members of RUN that are relevant to the workers must have
+ * been set already.  Allocate the synchronization objects in POOL.
+ *
+ * Even if this returns an error, stop_workers must be called.
+ */
+static svn_error_t *
+start_workers(run_t *run,
+              int thread_count,
+              apr_pool_t *pool)
+{
+  apr_status_t status;
+  int i;
+
+  run->slot_count = thread_count * ITEMS_PER_THREAD;
+  run->slots = apr_pcalloc(pool, run->slot_count * sizeof(*run->slots));
+  for (i = 0; i < run->slot_count; ++i)
+    run->slots[i].pool
+      = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  run->thread_count = thread_count;
+  run->threads = apr_pcalloc(pool, thread_count * sizeof(*run->threads));
+  run->batons = apr_pcalloc(pool, thread_count * sizeof(*run->batons));
+
+  SVN_ERR(svn_mutex__init(&run->mutex, TRUE, pool));
+  status = apr_thread_cond_create(&run->changed, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  for (i = 0; i < thread_count; ++i)
+    {
+      run->batons[i].run = run;
+      status = apr_thread_create(&run->threads[i], NULL, worker_thread,
+                                 &run->batons[i], pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create thread"));
+
+      ++run->started;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Stop all workers of RUN, wait for them to exit and release the result
+ * buffers.  Return ERR combined with any errors that occurred while
+ * processing items that have not been consumed.
+ */
+static svn_error_t *
+stop_workers(run_t *run,
+             svn_error_t *err)
+{
+  apr_status_t status;
+  int i;
+
+  if (run->mutex && run->changed)
+    err = svn_error_compose_create(err, stop_run(run));
+
+  for (i = 0; i < run->started; ++i)
+    {
+      apr_status_t thread_status;
+      status = apr_thread_join(&thread_status, run->threads[i]);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+
+      err = svn_error_compose_create(err, run->batons[i].err);
+    }
+
+  /* Report errors from items that we did not get to consume. */
+  for (i = 0; i < run->slot_count; ++i)
+    {
+      err = svn_error_compose_create(err, run->slots[i].err);
+      svn_pool_destroy(run->slots[i].pool);
+    }
+
+  run->started = 0;
+  run->slot_count = 0;
+
+  return svn_error_trace(err);
+}
+
+/* Process the items in THREAD_COUNT worker threads.  The parameters are
+ * the same as for svn_task__run_ordered.
+ */
+static svn_error_t *
+run_in_parallel(apr_int64_t count,
+                int thread_count,
+                svn_task__process_func_t process_func,
+                void *process_baton,
+                svn_task__thread_context_func_t context_func,
+                void *context_baton,
+                svn_task__output_func_t output_func,
+                void *output_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  run_t run = { 0 };
+  svn_error_t *err;
+
+  run.count = count;
+  run.process_func = process_func;
+  run.process_baton = process_baton;
+  run.context_func = context_func;
+  run.context_baton = context_baton;
+  run.closed = TRUE;
+
+  /* Start the workers and consume their results. */
+  err = start_workers(&run, thread_count, scratch_pool);
+  if (!err)
+    err = consume_results(&run, output_func, output_baton,
+                          cancel_func, cancel_baton, scratch_pool);
+
+  /* Even upon failure, we must not return before the workers finished
+   * because they use our pools. */
+  return svn_error_trace(stop_workers(&run, err));
+}
+
+#endif
+
+svn_error_t *
+svn_task__run_ordered(apr_int64_t count,
+                      int thread_count,
+                      svn_task__process_func_t process_func,
+                      void *process_baton,
+                      svn_task__thread_context_func_t context_func,
+                      void *context_baton,
+                      svn_task__output_func_t output_func,
+                      void *output_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  /* There is no point in having more threads than items. */
+  if (thread_count > count)
+    thread_count = (int)count;
+
+  if (thread_count > 1)
+    return svn_error_trace(run_in_parallel(count, thread_count,
+                                           process_func, process_baton,
+                                           context_func, context_baton,
+                                           output_func, output_baton,
+                                           cancel_func, cancel_baton,
+                                           scratch_pool));
+#endif
+
+  return svn_error_trace(run_sequentially(count,
+                                          process_func, process_baton,
+                                          context_func, context_baton,
+                                          output_func, output_baton,
+                                          cancel_func, cancel_baton,
+                                          scratch_pool));
+}
+
+struct svn_task__queue_t
+{
+#if APR_HAS_THREADS
+  /* State shared with the worker threads.  Only used if PARALLEL is set. */
+  run_t run;
+#endif
+
+  /* Set if the items get processed in worker threads. */
+  svn_boolean_t parallel;
+
+  /* Set once the workers have been stopped. */
+  svn_boolean_t stopped;
+
+  /* Parameters as passed to svn_task__queue_create. */
+  svn_task__process_func_t process_func;
+  svn_task__output_func_t output_func;
+  void *output_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Without worker threads, the thread context of the calling thread,
+   * the pool to allocate the item results in and the number of items
+   * processed so far. */
+  void *thread_context;
+  apr_pool_t *result_pool;
+  apr_int64_t count;
+};
+
+#if APR_HAS_THREADS
+
+/* Stop the workers of QUEUE if they are still running.  Return ERR
+ * combined with their errors.
+ */
+static svn_error_t *
+stop_queue(svn_task__queue_t *queue,
+           svn_error_t *err)
+{
+  if (queue->stopped)
+    return svn_error_trace(err);
+
+  queue->stopped = TRUE;
+  return svn_error_trace(stop_workers(&queue->run, err));
+}
+
+/* Pool pre-cleanup function stopping the svn_task__queue_t in DATA.
+ */
+static apr_status_t
+queue_pre_cleanup(void *data)
+{
+  svn_error_clear(stop_queue(data, SVN_NO_ERROR));
+  return APR_SUCCESS;
+}
+
+/* Set the number of items available to the workers of RUN to COUNT.
+ * Must be called while holding RUN->MUTEX.
+ */
+static svn_error_t *
+set_item_count(run_t *run,
+               apr_int64_t count)
+{
+  run->count = count;
+  return svn_error_trace(signal_change(run));
+}
+
+/* Tell the workers of RUN that no more items will be added.  Must be
+ * called while holding RUN->MUTEX.
+ */
+static svn_error_t *
+close_run(run_t *run)
+{
+  run->closed = TRUE;
+  return svn_error_trace(signal_change(run));
+}
+
+#endif
+
+svn_error_t *
+svn_task__queue_create(svn_task__queue_t **queue,
+                       int thread_count,
+                       svn_task__process_func_t process_func,
+                       svn_task__thread_context_func_t context_func,
+                       void *context_baton,
+                       svn_task__output_func_t output_func,
+                       void *output_baton,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *result_pool)
+{
+  svn_task__queue_t *new_queue = apr_pcalloc(result_pool,
+                                             sizeof(*new_queue));
+
+  new_queue->process_func = process_func;
+  new_queue->output_func = output_func;
+  new_queue->output_baton = output_baton;
+  new_queue->cancel_func = cancel_func;
+  new_queue->cancel_baton = cancel_baton;
+
+#if APR_HAS_THREADS
+  if (thread_count > 1)
+    {
+      svn_error_t *err;
+
+      new_queue->parallel = TRUE;
+      new_queue->run.process_func = process_func;
+      new_queue->run.context_func = context_func;
+      new_queue->run.context_baton = context_baton;
+      new_queue->run.queued = TRUE;
+
+      apr_pool_pre_cleanup_register(result_pool, new_queue,
+                                    queue_pre_cleanup);
+
+      err = start_workers(&new_queue->run, thread_count, result_pool);
+      if (err)
+        return svn_error_trace(stop_queue(new_queue, err));
+
+      *queue = new_queue;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  new_queue->result_pool = svn_pool_create(result_pool);
+  if (context_func)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(result_pool);
+      SVN_ERR(context_func(&new_queue->thread_context, context_baton,
+                           result_pool, scratch_pool));
+      svn_pool_destroy(scratch_pool);
+    }
+
+  *queue = new_queue;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_task__queue_push(svn_task__queue_t *queue,
+                     void *item,
+                     apr_pool_t *scratch_pool)
+{
+  void *result;
+
+#if APR_HAS_THREADS
+  if (queue->parallel)
+    {
+      run_t *run = &queue->run;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      /* Only this thread modifies COUNT and NEXT_OUTPUT.  So, we may
+       * read them without holding the lock. */
+      if (run->count >= run->next_output + run->slot_count)
+        {
+          svn_boolean_t consumed;
+          err = consume_item(&consumed, run, queue->output_func,
+                             queue->output_baton, queue->cancel_func,
+                             queue->cancel_baton, scratch_pool);
+          if (err || !consumed)
+            return svn_error_trace(stop_queue(queue, err));
+        }
+
+      /* The slot is ours until we publish the new item count. */
+      run->slots[run->count % run->slot_count].item = item;
+      SVN_MUTEX__WITH_LOCK(run->mutex,
+                           set_item_count(run, run->count + 1));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  if (queue->cancel_func)
+    SVN_ERR(queue->cancel_func(queue->cancel_baton));
+
+  svn_pool_clear(queue->result_pool);
+  SVN_ERR(queue->process_func(&result, item, queue->thread_context,
+                              queue->count, queue->result_pool,
+                              scratch_pool));
+  if (queue->output_func)
+    SVN_ERR(queue->output_func(queue->output_baton, result, queue->count,
+                               scratch_pool));
+
+  queue->count++;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_task__queue_wait(svn_task__queue_t *queue,
+                     apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  if (queue->parallel)
+    {
+      run_t *run = &queue->run;
+      svn_error_t *err;
+
+      err = consume_results(run, queue->output_func, queue->output_baton,
+                            queue->cancel_func, queue->cancel_baton,
+                            scratch_pool);
+
+      /* If the workers gave up on us, stopping them reports why. */
+      if (err || run->next_output < run->count)
+        return svn_error_trace(stop_queue(queue, err));
+    }
+#endif
+
+  /* Without worker threads, all items have been consumed already. */
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_task__queue_finish(svn_task__queue_t *queue,
+                       apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  if (queue->parallel)
+    {
+      run_t *run = &queue->run;
+      svn_error_t *err;
+
+      SVN_MUTEX__WITH_LOCK(run->mutex, close_run(run));
+      err = consume_results(run, queue->output_func, queue->output_baton,
+                            queue->cancel_func, queue->cancel_baton,
+                            scratch_pool);
+
+      return svn_error_trace(stop_queue(queue, err));
+    }
+#endif
+
+  svn_pool_clear(queue->result_pool);
+  return SVN_NO_ERROR;
+}
@@ -30,6 +30,7 @@
 #include "svn_dirent_uri.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -388,10 +389,16 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
-  if (md5_checksum)
+  /* Calculate both checksums in a single pass over the data. */
+  if (md5_checksum && sha1_checksum)
+    *stream = svn_checksum__wrap_write_stream_md5_sha1(md5_checksum,
+                                                       sha1_checksum,
+                                                       *stream,
+                                                       result_pool);
+  else if (md5_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
                                       svn_checksum_md5, FALSE, result_pool);
-  if (sha1_checksum)
+  else if (sha1_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, sha1_checksum,
                                       svn_checksum_sha1, FALSE, result_pool);
 
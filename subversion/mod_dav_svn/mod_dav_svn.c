@@ -42,6 +42,7 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -120,6 +121,10 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Whether all worker processes shall share one in-memory cache.
+ * Like the cache size, this is a process-global setting. */
+static svn_boolean_t shared_memory_cache = FALSE;
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -146,6 +151,19 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
       return HTTP_INTERNAL_SERVER_ERROR;
     }
 
+  /* Create the cache now such that all child processes inherit it. */
+  if (shared_memory_cache)
+    {
+      serr = svn_cache__share_global_membuffer_cache(NULL);
+      if (serr)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_ERR, serr->apr_err, p,
+                        "mod_dav_svn: error creating shared cache: '%s'",
+                        serr->message ? serr->message : "(no more info)");
+          return HTTP_INTERNAL_SERVER_ERROR;
+        }
+    }
+
   /* This returns void, so we can't check for error. */
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
@@ -153,6 +171,26 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   return OK;
 }
 
+/* Implements the #child_init hook. */
+static void
+init_child(apr_pool_t *p, server_rec *s)
+{
+  svn_error_t *serr;
+
+  if (!shared_memory_cache)
+    return;
+
+  serr = svn_cache__membuffer_child_init(
+           svn_cache__get_global_membuffer_cache(), p);
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_ERR, serr->apr_err, s,
+                   "mod_dav_svn: error attaching to shared cache: '%s'",
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+}
+
 static svn_error_t *
 malfunction_handler(svn_boolean_t can_return,
                     const char *file, int line,
@@ -631,6 +669,14 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheShared_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  shared_memory_cache = arg;
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1395,6 +1441,14 @@ static const command_rec cmds[] =
                 "specifies the maximum size in kB per process of Subversion's "
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
+
+  /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheShared", SVNInMemoryCacheShared_cmd, NULL,
+               RSRC_CONF,
+               "places the in-memory object cache in shared memory such "
+               "that all worker processes use the same cache.  "
+               "SVNInMemoryCacheSize then specifies the total size "
+               "(default is Off)."),
   /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
@@ -1436,6 +1490,7 @@ register_hooks(apr_pool_t *pconf)
 {
   ap_hook_pre_config(init_dso, NULL, NULL, APR_HOOK_REALLY_FIRST);
   ap_hook_post_config(init, NULL, NULL, APR_HOOK_MIDDLE);
+  ap_hook_child_init(init_child, NULL, NULL, APR_HOOK_MIDDLE);
 
   /* our provider */
   dav_register_provider(pconf, "svn", &provider);
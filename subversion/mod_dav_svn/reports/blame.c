@@ -0,0 +1,294 @@
+/*
+ * blame.c: mod_dav_svn REPORT handler for server-side blame
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_xml.h>
+
+#include <mod_dav.h>
+
+#include "svn_repos.h"
+#include "svn_string.h"
+#include "svn_types.h"
+#include "svn_base64.h"
+#include "svn_xml.h"
+#include "svn_dav.h"
+#include "svn_pools.h"
+#include "svn_diff.h"
+
+#include "private/svn_log.h"
+#include "private/svn_fspath.h"
+
+#include "../dav_svn.h"
+
+/* Baton type to be used with blame_receiver. */
+typedef struct blame_receiver_baton_t
+{
+  /* this buffers the output for a bit and is automatically flushed,
+     at appropriate times, by the Apache filter system. */
+  apr_bucket_brigade *bb;
+
+  /* where to deliver the output */
+  dav_svn__output *output;
+
+  /* Whether we've written the <S:blame-report> header.  Allows for lazy
+     writes to support mod_dav-based error handling. */
+  svn_boolean_t needs_header;
+
+  /* Revisions whose properties have already been sent.  Key is the
+     revision number.  Allocated in POOL. */
+  apr_hash_t *revisions_sent;
+  apr_pool_t *pool;
+} blame_receiver_baton_t;
+
+
+/* If BRB->needs_header is true, send the "<S:blame-report>" start
+   element and set BRB->needs_header to zero.  Else do nothing. */
+static svn_error_t *
+maybe_send_header(blame_receiver_baton_t *brb)
+{
+  if (brb->needs_header)
+    {
+      SVN_ERR(dav_svn__brigade_puts(brb->bb, brb->output,
+                                    DAV_XML_HEADER DEBUG_CR
+                                    "<S:blame-report xmlns:S=\""
+                                    SVN_XML_NAMESPACE "\" "
+                                    "xmlns:D=\"DAV:\">" DEBUG_CR));
+      brb->needs_header = FALSE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the revision property NAME with value VAL to the client in
+   BRB.  Use POOL for temporary allocations. */
+static svn_error_t *
+send_rev_prop(blame_receiver_baton_t *brb,
+              const char *name,
+              const svn_string_t *val,
+              apr_pool_t *pool)
+{
+  name = apr_xml_quote_string(pool, name, 1);
+
+  if (svn_xml_is_xml_safe(val->data, val->len))
+    {
+      svn_stringbuf_t *tmp = NULL;
+      svn_xml_escape_cdata_string(&tmp, val, pool);
+      SVN_ERR(dav_svn__brigade_printf(brb->bb, brb->output,
+                                      "<S:rev-prop name=\"%s\">%s"
+                                      "</S:rev-prop>" DEBUG_CR,
+                                      name, tmp->data));
+    }
+  else
+    {
+      val = svn_base64_encode_string2(val, TRUE, pool);
+      SVN_ERR(dav_svn__brigade_printf(brb->bb, brb->output,
+                                      "<S:rev-prop name=\"%s\" "
+                                      "encoding=\"base64\">%s"
+                                      "</S:rev-prop>" DEBUG_CR,
+                                      name, val->data));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_blame_receiver_t, sending one <S:chunk> element
+ * per run of lines to the client.  Revision properties are sent only with
+ * the first chunk of the respective revision.  BATON must be a
+ * blame_receiver_baton_t. */
+static svn_error_t *
+blame_receiver(apr_int64_t start_line,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  blame_receiver_baton_t *brb = baton;
+  apr_hash_index_t *hi;
+  svn_revnum_t *key;
+
+  SVN_ERR(maybe_send_header(brb));
+
+  if (!SVN_IS_VALID_REVNUM(revision))
+    return svn_error_trace(dav_svn__brigade_printf(
+                             brb->bb, brb->output,
+                             "<S:chunk line=\"%" APR_INT64_T_FMT "\"/>"
+                             DEBUG_CR, start_line));
+
+  SVN_ERR(dav_svn__brigade_printf(brb->bb, brb->output,
+                                  "<S:chunk line=\"%" APR_INT64_T_FMT "\""
+                                  " rev=\"%ld\">" DEBUG_CR,
+                                  start_line, revision));
+
+  if (!apr_hash_get(brb->revisions_sent, &revision, sizeof(revision)))
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+      key = apr_pmemdup(brb->pool, &revision, sizeof(revision));
+      apr_hash_set(brb->revisions_sent, key, sizeof(*key), key);
+
+      for (hi = apr_hash_first(scratch_pool, rev_props);
+           hi;
+           hi = apr_hash_next(hi))
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(send_rev_prop(brb, apr_hash_this_key(hi),
+                                apr_hash_this_val(hi), iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
+  SVN_ERR(dav_svn__brigade_puts(brb->bb, brb->output,
+                                "</S:chunk>" DEBUG_CR));
+
+  return SVN_NO_ERROR;
+}
+
+dav_error *
+dav_svn__blame_report(const dav_resource *resource,
+                      const apr_xml_doc *doc,
+                      dav_svn__output *output)
+{
+  svn_error_t *serr;
+  dav_error *derr = NULL;
+  apr_xml_elem *child;
+  blame_receiver_baton_t brb = { 0 };
+  dav_svn__authz_read_baton arb;
+  int ns;
+  const char *abs_path = NULL;
+  svn_diff_file_options_t *diff_options
+    = svn_diff_file_options_create(resource->pool);
+
+  /* These get determined from the request document. */
+  svn_revnum_t start = SVN_INVALID_REVNUM;
+  svn_revnum_t end = SVN_INVALID_REVNUM;     /* defaults to HEAD */
+
+  /* Sanity check. */
+  if (!resource->info->repos_path)
+    return dav_svn__new_error(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                              "The request does not specify a repository path");
+  ns = dav_svn__find_ns(doc->namespaces, SVN_XML_NAMESPACE);
+  if (ns == -1)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                    "The request does not contain the 'svn:' "
+                                    "namespace, so it is not going to have "
+                                    "certain required elements");
+    }
+
+  for (child = doc->root->first_child; child != NULL; child = child->next)
+    {
+      /* if this element isn't one of ours, then skip it */
+      if (child->ns != ns)
+        continue;
+
+      if (strcmp(child->name, "start-revision") == 0)
+        start = SVN_STR_TO_REV(dav_xml_get_cdata(child, resource->pool, 1));
+      else if (strcmp(child->name, "end-revision") == 0)
+        end = SVN_STR_TO_REV(dav_xml_get_cdata(child, resource->pool, 1));
+      else if (strcmp(child->name, "ignore-space") == 0)
+        {
+          const char *word = dav_xml_get_cdata(child, resource->pool, 1);
+          if (strcmp(word, "change") == 0)
+            diff_options->ignore_space = svn_diff_file_ignore_space_change;
+          else if (strcmp(word, "all") == 0)
+            diff_options->ignore_space = svn_diff_file_ignore_space_all;
+        }
+      else if (strcmp(child->name, "ignore-eol-style") == 0)
+        diff_options->ignore_eol_style = TRUE; /* presence indicates
+                                                  positivity */
+      else if (strcmp(child->name, "histogram") == 0)
+        diff_options->histogram = TRUE;
+      else if (strcmp(child->name, "path") == 0)
+        {
+          const char *rel_path = dav_xml_get_cdata(child, resource->pool, 0);
+          if ((derr = dav_svn__test_canonical(rel_path, resource->pool)))
+            return derr;
+
+          /* Force REL_PATH to be a relative path, not an fspath. */
+          rel_path = svn_relpath_canonicalize(rel_path, resource->pool);
+
+          /* Append the REL_PATH to the base FS path to get an
+             absolute repository path. */
+          abs_path = svn_fspath__join(resource->info->repos_path, rel_path,
+                                      resource->pool);
+        }
+      /* else unknown element; skip it */
+    }
+
+  if (! abs_path)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                    "Request was missing the path argument");
+    }
+
+  /* Build authz read baton */
+  arb.r = resource->info->r;
+  arb.repos = resource->info->repos;
+
+  /* Build blame receiver baton */
+  brb.bb = apr_brigade_create(resource->pool,  /* not the subpool! */
+                              dav_svn__output_get_bucket_alloc(output));
+  brb.output = output;
+  brb.needs_header = TRUE;
+  brb.revisions_sent = apr_hash_make(resource->pool);
+  brb.pool = resource->pool;
+
+  /* Calculate the blame and send the runs as they come. */
+  serr = svn_repos_blame(resource->info->repos->repos, abs_path, start, end,
+                         diff_options, dav_svn__authz_read_func(&arb), &arb,
+                         blame_receiver, &brb, NULL, NULL, resource->pool);
+  if (serr)
+    {
+      derr = dav_svn__convert_err(serr, HTTP_BAD_REQUEST, NULL,
+                                  resource->pool);
+      goto cleanup;
+    }
+
+  if ((serr = maybe_send_header(&brb)))
+    {
+      derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                  "Error beginning REPORT response.",
+                                  resource->pool);
+      goto cleanup;
+    }
+
+  if ((serr = dav_svn__brigade_puts(brb.bb, brb.output,
+                                    "</S:blame-report>" DEBUG_CR)))
+    {
+      derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                  "Error ending REPORT response.",
+                                  resource->pool);
+      goto cleanup;
+    }
+
+ cleanup:
+
+  dav_svn__operational_log(resource->info,
+                           svn_log__blame(abs_path, start, end,
+                                          resource->pool));
+
+  return dav_svn__final_flush_or_error(resource->info->r, brb.bb, output,
+                                       derr, resource->pool);
+}
@@ -57,6 +57,7 @@
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
 
 #include "dav_svn.h"
 
@@ -1771,7 +1772,10 @@ static int sort_encoding_pref(const void *accept_rec1, const void *accept_rec2)
 
 static int get_svndiff_version(const struct accept_rec *rec)
 {
-  if (strcmp(rec->name, "svndiff2") == 0)
+  /* Only consider svndiff4 if we are able to produce it. */
+  if (strcmp(rec->name, "svndiff4") == 0)
+    return svn__zstd_available() ? 4 : -1;
+  else if (strcmp(rec->name, "svndiff2") == 0)
     return 2;
   else if (strcmp(rec->name, "svndiff1") == 0)
     return 1;
@@ -1796,6 +1800,7 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
   apr_array_header_t *encoding_prefs;
   apr_array_header_t *svndiff_encodings;
   svn_boolean_t accepts_svndiff2 = FALSE;
+  svn_boolean_t accepts_svndiff4 = FALSE;
 
   encoding_prefs = do_header_line(r->pool,
                                   apr_table_get(r->headers_in,
@@ -1819,6 +1824,8 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
 
       if (version == 2)
         accepts_svndiff2 = TRUE;
+      else if (version == 4)
+        accepts_svndiff4 = TRUE;
     }
 
   if (dav_svn__get_compression_level(r) == 0)
@@ -1827,12 +1834,16 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
        * svndiff0 format, which we assume is always supported. */
       *svndiff_version = 0;
     }
-  else if (accepts_svndiff2 && dav_svn__get_compression_level(r) == 1)
+  else if (accepts_svndiff2 && !accepts_svndiff4
+           && dav_svn__get_compression_level(r) == 1)
     {
       /* Enable svndiff2 if the client can read it, and if the server-side
        * compression level is set to 1.  Svndiff2 offers better speed and
        * compression ratio comparable to svndiff1 with compression level 1,
        * but not with other compression levels.
+       *
+       * Clients that accept svndiff4 tell us via the quality values
+       * whether they prefer svndiff2 or svndiff4.
        */
       *svndiff_version = 2;
     }
@@ -133,6 +133,7 @@ enum svnadmin__cmdline_options_t
     svnadmin__incremental,
     svnadmin__keep_going,
     svnadmin__deltas,
+    svnadmin__deltas_compression,
     svnadmin__ignore_uuid,
     svnadmin__force_uuid,
     svnadmin__fs_type,
@@ -159,7 +160,8 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__jobs
   };
 
 /* Option codes and descriptions.
@@ -189,6 +191,12 @@ static const apr_getopt_option_t options_table[] =
     {"deltas",        svnadmin__deltas, 0,
      N_("use deltas in dump output")},
 
+    {"deltas-compression", svnadmin__deltas_compression, 1,
+     N_("compress deltas in dump output with zstd at\n"
+        "                             level ARG (1-19; 0 for no compression).\n"
+        "                             Such dumps require Subversion 1.15+\n"
+        "                             with zstd support to load.")},
+
     {"bypass-hooks",  svnadmin__bypass_hooks, 0,
      N_("bypass the repository hook system")},
 
@@ -298,6 +306,10 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"jobs", svnadmin__jobs, 1,
+     N_("process data in up to ARG parallel threads.\n"
+        "                             Default: 1.")},
+
     {NULL}
   };
 
@@ -382,8 +394,8 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "path exclusions. In particular, when the source of a copy is\n"
     "excluded, the copy is transformed into an add (unlike in 'svndumpfilter').\n"
    )},
-  {'r', svnadmin__incremental, svnadmin__deltas, 'q', 'M', 'F',
-   svnadmin__exclude, svnadmin__include, svnadmin__glob },
+  {'r', svnadmin__incremental, svnadmin__deltas, svnadmin__deltas_compression,
+   'q', 'M', 'F', svnadmin__exclude, svnadmin__include, svnadmin__glob },
   {{'F', N_("write to file ARG instead of stdout")}} },
 
   {"dump-revprops", subcommand_dump_revprops, {0}, {N_(
@@ -520,7 +532,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Possibly compact the repository into a more efficient storage model.\n"
     "This may not apply to all repositories, in which case, exit.\n"
    )},
-   {'q', 'M'} },
+   {'q', 'M', svnadmin__jobs} },
 
   {"recover", subcommand_recover, {0}, {N_(
     "usage: svnadmin recover REPOS_PATH\n"
@@ -630,7 +642,8 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Verify the data stored in the repository.\n"
    )},
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -648,6 +661,7 @@ struct svnadmin_opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t incremental;                        /* --incremental */
   svn_boolean_t use_deltas;                         /* --deltas */
+  int deltas_compression;                           /* --deltas-compression */
   svn_boolean_t use_pre_commit_hook;                /* --use-pre-commit-hook */
   svn_boolean_t use_post_commit_hook;               /* --use-post-commit-hook */
   svn_boolean_t use_pre_revprop_change_hook;        /* --use-pre-revprop-change-hook */
@@ -673,6 +687,7 @@ struct svnadmin_opt_state
   apr_array_header_t *exclude;                      /* --exclude */
   apr_array_header_t *include;                      /* --include */
   svn_boolean_t glob;                               /* --pattern */
+  int jobs;                                         /* --jobs */
 
   const char *config_dir;    /* Overriding Configuration Directory */
 };
@@ -1015,7 +1030,7 @@ struct repos_verify_callback_baton
 };
 
 /* Implementation of svn_repos_verify_callback_t to handle errors coming
-   from svn_repos_verify_fs3(). */
+   from svn_repos_verify_fs4(). */
 static svn_error_t *
 repos_verify_callback(void *baton,
                       svn_revnum_t revision,
@@ -1476,8 +1491,14 @@ subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
                                  "cannot be used simultaneously"));
     }
 
-  SVN_ERR(svn_repos_dump_fs4(repos, out_stream, lower, upper,
+  if (opt_state->deltas_compression != SVN_DELTA_COMPRESSION_LEVEL_NONE
+      && !opt_state->use_deltas)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("'--deltas-compression' requires '--deltas'"));
+
+  SVN_ERR(svn_repos_dump_fs5(repos, out_stream, lower, upper,
                              opt_state->incremental, opt_state->use_deltas,
+                             opt_state->deltas_compression,
                              TRUE, TRUE,
                              !opt_state->quiet ? repos_notify_handler : NULL,
                              feedback_stream,
@@ -1522,8 +1543,9 @@ subcommand_dump_revprops(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stderr, pool);
 
-  SVN_ERR(svn_repos_dump_fs4(repos, out_stream, lower, upper,
-                             FALSE, FALSE, TRUE, FALSE,
+  SVN_ERR(svn_repos_dump_fs5(repos, out_stream, lower, upper,
+                             FALSE, FALSE, SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                             TRUE, FALSE,
                              !opt_state->quiet ? repos_notify_handler : NULL,
                              feedback_stream, NULL, NULL,
                              check_cancel, NULL, pool));
@@ -2188,13 +2210,68 @@ subcommand_setlog(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 }
 
 
+/* Baton for pack_notify_handler. */
+struct pack_notify_baton
+{
+  /* Where to write the progress feedback to. */
+  svn_stream_t *feedback_stream;
+
+  /* The shard whose start has been reported on the current output line,
+     -1 if the line is complete. */
+  apr_int64_t open_shard;
+};
+
+/* Implementation of svn_repos_notify_func_t for 'svnadmin pack'.  When
+   packing in parallel, more shards may start before the first one is
+   done, so keep the output readable by completing the current line
+   first and repeating the shard number where necessary.  All other
+   notifications are handled by repos_notify_handler. */
+static void
+pack_notify_handler(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  struct pack_notify_baton *b = baton;
+
+  switch (notify->action)
+  {
+    case svn_repos_notify_pack_shard_start:
+      if (b->open_shard >= 0)
+        svn_error_clear(svn_stream_puts(b->feedback_stream, "\n"));
+
+      repos_notify_handler(b->feedback_stream, notify, scratch_pool);
+      b->open_shard = notify->shard;
+      return;
+
+    case svn_repos_notify_pack_shard_end:
+      if (b->open_shard != notify->shard)
+        {
+          svn_repos_notify_t start = *notify;
+
+          if (b->open_shard >= 0)
+            svn_error_clear(svn_stream_puts(b->feedback_stream, "\n"));
+
+          start.action = svn_repos_notify_pack_shard_start;
+          repos_notify_handler(b->feedback_stream, &start, scratch_pool);
+        }
+
+      repos_notify_handler(b->feedback_stream, notify, scratch_pool);
+      b->open_shard = -1;
+      return;
+
+    default:
+      repos_notify_handler(b->feedback_stream, notify, scratch_pool);
+      return;
+  }
+}
+
 /* This implements 'svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 {
   struct svnadmin_opt_state *opt_state = baton;
   svn_repos_t *repos;
-  svn_stream_t *feedback_stream = NULL;
+  struct pack_notify_baton pnb = { NULL, -1 };
 
   /* Expect no more arguments. */
   SVN_ERR(parse_args(NULL, os, 0, 0, pool));
@@ -2203,11 +2280,12 @@ subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 
   /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
   if (! opt_state->quiet)
-    feedback_stream = recode_stream_create(stdout, pool);
+    pnb.feedback_stream = recode_stream_create(stdout, pool);
 
   return svn_error_trace(
-    svn_repos_fs_pack2(repos, !opt_state->quiet ? repos_notify_handler : NULL,
-                       feedback_stream, check_cancel, NULL, pool));
+    svn_repos_fs_pack3(repos, opt_state->jobs,
+                       !opt_state->quiet ? pack_notify_handler : NULL,
+                       &pnb, check_cancel, NULL, pool));
 }
 
 
@@ -2272,9 +2350,10 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     apr_array_make(pool, 0, sizeof(struct verification_error *));
   verify_baton.result_pool = pool;
 
-  SVN_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                opt_state->check_normalization,
                                opt_state->metadata_only,
+                               opt_state->jobs,
                                !opt_state->quiet
                                  ? repos_notify_handler : NULL,
                                feedback_stream,
@@ -3076,6 +3155,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -3154,6 +3234,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__deltas:
         opt_state.use_deltas = TRUE;
         break;
+      case svnadmin__deltas_compression:
+        SVN_ERR(svn_cstring_atoi(&opt_state.deltas_compression, opt_arg));
+        if (   opt_state.deltas_compression < SVN_DELTA_COMPRESSION_LEVEL_NONE
+            || opt_state.deltas_compression > SVN__COMPRESSION_ZSTD_MAX)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid compression level '%s'"),
+                                   opt_arg);
+        break;
       case svnadmin__ignore_uuid:
         opt_state.uuid_action = svn_repos_load_uuid_ignore;
         break;
@@ -3290,6 +3378,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__glob:
         opt_state.glob = TRUE;
         break;
+      case svnadmin__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of jobs '%s'"),
+                                   opt_arg);
+        break;
       default:
         {
           SVN_ERR(subcommand_help(NULL, NULL, pool));
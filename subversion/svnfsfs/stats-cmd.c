@@ -449,6 +449,11 @@ print_stats(svn_fs_fs__stats_t *stats,
   print_rep_stats(&stats->dir_prop_rep_stats, pool);
   printf("\nFile property representation statistics:\n");
   print_rep_stats(&stats->file_prop_rep_stats, pool);
+  if (stats->chunk_rep_stats.total.count)
+    {
+      printf("\nChunk representation statistics:\n");
+      print_rep_stats(&stats->chunk_rep_stats, pool);
+    }
 
   printf("\nLargest representations:\n");
   print_largest_reps(stats->largest_changes, pool);
@@ -157,6 +157,8 @@ svn_rdump__get_dump_editor(const svn_delta_editor_t **editor,
                            svn_stream_t *stream,
                            svn_ra_session_t *ra_session,
                            const char *update_anchor_relpath,
+                           int compression_level,
+                           int thread_count,
                            svn_cancel_func_t cancel_func,
                            void *cancel_baton,
                            apr_pool_t *pool)
@@ -170,7 +172,8 @@ svn_rdump__get_dump_editor(const svn_delta_editor_t **editor,
   eb->current_revision = revision;
 
   SVN_ERR(svn_repos__get_dump_editor(editor, edit_baton,
-                                     stream, update_anchor_relpath, pool));
+                                     stream, update_anchor_relpath,
+                                     compression_level, thread_count, pool));
 
   /* Wrap this editor in a cancellation editor. */
   SVN_ERR(svn_delta_get_cancellation_editor(cancel_func, cancel_baton,
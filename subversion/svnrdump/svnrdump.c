@@ -41,6 +41,7 @@
 #include "private/svn_repos_private.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_ra_private.h"
+#include "private/svn_subr_private.h"
 
 
 
@@ -67,7 +68,9 @@ enum svn_svnrdump__longopt_t
     opt_incremental,
     opt_trust_server_cert,
     opt_trust_server_cert_failures,
-    opt_version
+    opt_version,
+    opt_deltas_compression,
+    opt_jobs
   };
 
 #define SVN_SVNRDUMP__BASE_OPTIONS opt_config_dir, \
@@ -90,7 +93,8 @@ static const svn_opt_subcommand_desc3_t svnrdump__cmd_table[] =
        "in a 'dumpfile' portable format.  If only LOWER is given, dump that\n"
        "one revision.\n"
     )},
-    { 'r', 'q', opt_incremental, 'F', SVN_SVNRDUMP__BASE_OPTIONS },
+    { 'r', 'q', opt_incremental, 'F', opt_deltas_compression, opt_jobs,
+      SVN_SVNRDUMP__BASE_OPTIONS },
     {{'F', N_("write to file ARG instead of stdout")}} },
   { "load", load_cmd, { 0 }, {N_(
        "usage: svnrdump load URL\n"
@@ -116,6 +120,18 @@ static const apr_getopt_option_t svnrdump__options[] =
                       N_("no progress (only errors) to stderr")},
     {"incremental",   opt_incremental, 0,
                       N_("dump incrementally")},
+    {"deltas-compression", opt_deltas_compression, 1,
+                      N_("compress deltas in dump output with zstd at\n"
+                         "                             "
+                         "level ARG (1-19; 0 for no compression).\n"
+                         "                             "
+                         "Such dumps require Subversion 1.15+\n"
+                         "                             "
+                         "with zstd support to load.")},
+    {"jobs",          opt_jobs, 1,
+                      N_("compress deltas in up to ARG parallel threads.\n"
+                         "                             "
+                         "Default: 1.")},
     {"skip-revprop",  opt_skip_revprop, 1,
                       N_("skip revision property ARG (e.g., \"svn:author\")")},
     {"config-dir",    opt_config_dir, 1,
@@ -181,6 +197,13 @@ struct replay_baton {
 
   /* Whether to be quiet. */
   svn_boolean_t quiet;
+
+  /* zstd compression level for the deltas or
+     SVN_DELTA_COMPRESSION_LEVEL_NONE. */
+  int deltas_compression;
+
+  /* Number of threads compressing the deltas. */
+  int jobs;
 };
 
 /* Option set */
@@ -195,6 +218,8 @@ typedef struct opt_baton_t {
   svn_opt_revision_t end_revision;
   svn_boolean_t quiet;
   svn_boolean_t incremental;
+  int deltas_compression;
+  int jobs;
   apr_hash_t *skip_revprops;
 } opt_baton_t;
 
@@ -221,7 +246,8 @@ replay_revstart(svn_revnum_t revision,
 
   SVN_ERR(svn_rdump__get_dump_editor(editor, edit_baton, revision,
                                      rb->stdout_stream, rb->extra_ra_session,
-                                     NULL, check_cancel, NULL, pool));
+                                     NULL, rb->deltas_compression, rb->jobs,
+                                     check_cancel, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -418,6 +444,8 @@ dump_initial_full_revision(svn_ra_session_t *session,
                            svn_stream_t *stdout_stream,
                            svn_revnum_t revision,
                            svn_boolean_t quiet,
+                           int deltas_compression,
+                           int jobs,
                            apr_pool_t *pool)
 {
   const svn_ra_reporter3_t *reporter;
@@ -449,7 +477,8 @@ dump_initial_full_revision(svn_ra_session_t *session,
      full dump of REV. */
   SVN_ERR(svn_rdump__get_dump_editor(&dump_editor, &dump_baton, revision,
                                      stdout_stream, extra_ra_session,
-                                     source_relpath, check_cancel, NULL, pool));
+                                     source_relpath, deltas_compression,
+                                     jobs, check_cancel, NULL, pool));
   SVN_ERR(svn_ra_do_update3(session, &reporter, &report_baton, revision,
                             "", svn_depth_infinity, FALSE, FALSE,
                             dump_editor, dump_baton, pool, pool));
@@ -469,7 +498,8 @@ dump_initial_full_revision(svn_ra_session_t *session,
  * the repository URL at which SESSION is rooted, using callbacks
  * which generate Subversion repository dumpstreams describing the
  * changes made in those revisions.  If QUIET is set, don't generate
- * progress messages.
+ * progress messages.  Compress the deltas at DELTAS_COMPRESSION level
+ * using up to JOBS threads.
  */
 static svn_error_t *
 replay_revisions(svn_ra_session_t *session,
@@ -478,6 +508,8 @@ replay_revisions(svn_ra_session_t *session,
                  svn_revnum_t end_revision,
                  svn_boolean_t quiet,
                  svn_boolean_t incremental,
+                 int deltas_compression,
+                 int jobs,
                  const char *dumpfile,
                  apr_pool_t *pool)
 {
@@ -498,6 +530,8 @@ replay_revisions(svn_ra_session_t *session,
   replay_baton->stdout_stream = output_stream;
   replay_baton->extra_ra_session = extra_ra_session;
   replay_baton->quiet = quiet;
+  replay_baton->deltas_compression = deltas_compression;
+  replay_baton->jobs = jobs;
 
   /* Write the magic header and UUID */
   SVN_ERR(svn_repos__dump_magic_header_record(output_stream,
@@ -529,7 +563,8 @@ replay_revisions(svn_ra_session_t *session,
     {
       SVN_ERR(dump_initial_full_revision(session, extra_ra_session,
                                          output_stream, start_revision,
-                                         quiet, pool));
+                                         quiet, deltas_compression, jobs,
+                                         pool));
       start_revision++;
     }
 
@@ -648,6 +683,7 @@ dump_cmd(apr_getopt_t *os,
                           opt_baton->start_revision.value.number,
                           opt_baton->end_revision.value.number,
                           opt_baton->quiet, opt_baton->incremental,
+                          opt_baton->deltas_compression, opt_baton->jobs,
                           opt_baton->dumpfile, pool);
 }
 
@@ -900,6 +936,22 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
         case opt_incremental:
           opt_baton->incremental = TRUE;
           break;
+        case opt_deltas_compression:
+          SVN_ERR(svn_cstring_atoi(&opt_baton->deltas_compression, opt_arg));
+          if (   opt_baton->deltas_compression
+                   < SVN_DELTA_COMPRESSION_LEVEL_NONE
+              || opt_baton->deltas_compression > SVN__COMPRESSION_ZSTD_MAX)
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid compression level '%s'"),
+                                     opt_arg);
+          break;
+        case opt_jobs:
+          SVN_ERR(svn_cstring_atoi(&opt_baton->jobs, opt_arg));
+          if (opt_baton->jobs < 1)
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid number of jobs '%s'"),
+                                     opt_arg);
+          break;
         case opt_skip_revprop:
           SVN_ERR(svn_utf_cstring_to_utf8(&opt_arg, opt_arg, pool));
           svn_hash_sets(opt_baton->skip_revprops, opt_arg, opt_arg);
@@ -48,6 +48,9 @@ extern "C" {
  * if a replay-style drive will instead be used, it should be passed
  * as @c NULL.
  *
+ * Text deltas will be compressed at @a compression_level using up to
+ * @a thread_count threads, see svn_repos__get_dump_editor().
+ *
  * Use @a cancel_func and @a cancel_baton to check for user
  * cancellation of the operation (for timely-but-safe termination).
  */
@@ -58,6 +61,8 @@ svn_rdump__get_dump_editor(const svn_delta_editor_t **editor,
                            svn_stream_t *stream,
                            svn_ra_session_t *ra_session,
                            const char *update_anchor_relpath,
+                           int compression_level,
+                           int thread_count,
                            svn_cancel_func_t cancel_func,
                            void *cancel_baton,
                            apr_pool_t *pool);
@@ -55,6 +55,7 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_subr_private.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -2948,6 +2949,112 @@ get_file_revs(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Baton type to be used with blame_receiver. */
+typedef struct blame_baton_t
+{
+  svn_ra_svn_conn_t *conn;
+
+  /* Revisions whose properties have already been sent to the client.
+   * Key is the revision number.  Allocated in POOL. */
+  apr_hash_t *revisions_sent;
+  apr_pool_t *pool;
+} blame_baton_t;
+
+/* This implements the svn_repos_blame_receiver_t interface.  Revision
+ * properties are sent only with the first run of lines that has been
+ * changed in the respective revision. */
+static svn_error_t *
+blame_receiver(apr_int64_t start_line,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  blame_baton_t *bb = baton;
+
+  SVN_ERR(svn_ra_svn__write_tuple(bb->conn, scratch_pool, "n(?r)(!",
+                                  (apr_uint64_t)start_line, revision));
+
+  if (SVN_IS_VALID_REVNUM(revision)
+      && !apr_hash_get(bb->revisions_sent, &revision, sizeof(revision)))
+    {
+      svn_revnum_t *key = apr_pmemdup(bb->pool, &revision,
+                                      sizeof(revision));
+      apr_hash_set(bb->revisions_sent, key, sizeof(*key), key);
+
+      SVN_ERR(svn_ra_svn__write_tuple(bb->conn, scratch_pool, "!(!"));
+      SVN_ERR(svn_ra_svn__write_proplist(bb->conn, scratch_pool, rev_props));
+      SVN_ERR(svn_ra_svn__write_tuple(bb->conn, scratch_pool, "!)"));
+    }
+
+  SVN_ERR(svn_ra_svn__write_tuple(bb->conn, scratch_pool, "!))"));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+blame(svn_ra_svn_conn_t *conn,
+      apr_pool_t *pool,
+      svn_ra_svn__list_t *params,
+      void *baton)
+{
+  server_baton_t *b = baton;
+  svn_error_t *err, *write_err;
+  blame_baton_t bb;
+  svn_revnum_t start_rev, end_rev;
+  const char *path;
+  const char *full_path;
+  const char *canonical_path;
+  const char *ignore_space_word;
+  svn_diff_file_options_t *diff_options;
+  authz_baton_t ab;
+
+  ab.server = b;
+  ab.conn = conn;
+
+  /* Parse arguments. */
+  diff_options = svn_diff_file_options_create(pool);
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)(?r)wbb",
+                                  &path, &start_rev, &end_rev,
+                                  &ignore_space_word,
+                                  &diff_options->ignore_eol_style,
+                                  &diff_options->histogram));
+  SVN_ERR(svn_relpath_canonicalize_safe(&canonical_path, NULL, path,
+                                        pool, pool));
+  path = canonical_path;
+
+  if (strcmp(ignore_space_word, "change") == 0)
+    diff_options->ignore_space = svn_diff_file_ignore_space_change;
+  else if (strcmp(ignore_space_word, "all") == 0)
+    diff_options->ignore_space = svn_diff_file_ignore_space_all;
+  else
+    diff_options->ignore_space = svn_diff_file_ignore_space_none;
+
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+  full_path = svn_fspath__join(b->repository->fs_path->data, path, pool);
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__blame(full_path, start_rev, end_rev, pool)));
+
+  bb.conn = conn;
+  bb.revisions_sent = apr_hash_make(pool);
+  bb.pool = pool;
+
+  err = svn_repos_blame(b->repository->repos, full_path, start_rev, end_rev,
+                        diff_options, authz_check_access_cb_func(b), &ab,
+                        blame_receiver, &bb, NULL, NULL, pool);
+  write_err = svn_ra_svn__write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 lock(svn_ra_svn_conn_t *conn,
      apr_pool_t *pool,
@@ -3802,6 +3909,7 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "get-locations",   get_locations },
   { "get-location-segments",   get_location_segments },
   { "get-file-revs",   get_file_revs },
+  { "blame",           blame },
   { "lock",            lock },
   { "lock-many",       lock_many },
   { "unlock",          unlock },
@@ -4239,7 +4347,7 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwww?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
@@ -4253,11 +4361,15 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_BLAME,
+                                           svn__zstd_available()
+                                             ? SVN_RA_SVN_CAP_SVNDIFF4_ACCEPTED
+                                             : NULL
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4269,7 +4381,8 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_BLAME
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -55,6 +55,7 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 
@@ -222,6 +223,7 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_SHARED_CACHE    277
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -325,6 +327,14 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+    {"shared-memory-cache", SVNSERVE_OPT_SHARED_CACHE, 0,
+     N_("share one in-memory cache between all connection\n"
+        "                             "
+        "processes instead of one cache per process.\n"
+        "                             "
+        "--memory-cache-size then gives the total size.\n"
+        "                             "
+        "[mode: daemon]")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -725,6 +735,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  svn_boolean_t shared_cache = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -929,6 +940,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_SHARED_CACHE:
+          shared_cache = TRUE;
+          break;
+
         case SVNSERVE_OPT_CLIENT_SPEED:
           {
             apr_size_t bandwidth = (apr_size_t)apr_strtoi64(arg, NULL, 0);
@@ -1297,6 +1312,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_set(&settings);
   }
 
+  /* Forked connection processes inherit the cache created here. */
+  if (shared_cache && handling_mode == connection_mode_fork)
+    SVN_ERR(svn_cache__share_global_membuffer_cache(NULL));
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
@@ -1352,6 +1371,18 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child wouldn't listen to the main server's socket */
               apr_socket_close(sock);
 
+              if (shared_cache)
+                {
+                  err = svn_cache__membuffer_child_init(
+                          svn_cache__get_global_membuffer_cache(),
+                          connection->pool);
+                  if (err)
+                    {
+                      logger__log_error(params.logger, err, NULL, NULL);
+                      svn_error_clear(err);
+                    }
+                }
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
@@ -1419,6 +1419,165 @@ test_copy_pin_externals_select_subtree(const svn_test_opts_t *opts, apr_pool_t *
   return SVN_NO_ERROR;
 }
 
+/* Baton for blame_receiver. */
+typedef struct blame_baton_t
+{
+  /* Revisions that the lines have been blamed on so far. */
+  apr_array_header_t *revisions;
+
+  /* Contents of those lines. */
+  svn_stringbuf_t *contents;
+} blame_baton_t;
+
+/* Implements svn_client_blame_receiver4_t. */
+static svn_error_t *
+blame_receiver(void *baton,
+               apr_int64_t line_no,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               svn_revnum_t merged_revision,
+               apr_hash_t *merged_rev_props,
+               const char *merged_path,
+               const svn_string_t *line,
+               svn_boolean_t local_change,
+               apr_pool_t *pool)
+{
+  blame_baton_t *bb = baton;
+
+  SVN_TEST_ASSERT(line_no == bb->revisions->nelts);
+  APR_ARRAY_PUSH(bb->revisions, svn_revnum_t) = revision;
+  svn_stringbuf_appendbytes(bb->contents, line->data, line->len);
+  svn_stringbuf_appendbyte(bb->contents, '\n');
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame_threads(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  const char *repos_url;
+  const char *url;
+  svn_client_ctx_t *ctx;
+  svn_config_t *cfg;
+  svn_opt_revision_t head_rev = { svn_opt_revision_head, { 0 } };
+  svn_opt_revision_t first_rev = { svn_opt_revision_number, { 1 } };
+  apr_array_header_t *lines = apr_array_make(pool, 0, sizeof(const char *));
+  apr_array_header_t *line_revs = apr_array_make(pool, 0,
+                                                 sizeof(svn_revnum_t));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 1;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents;
+  /* Thread count and server-side blame setting per run.  The last two
+     runs let the server calculate the blame, the second one from its
+     cache. */
+  const char *settings[][2] = { { "1", "no" }, { "4", "no" },
+                                { "1", "yes" }, { "1", "yes" } };
+  int i;
+
+  SVN_ERR(svn_test__create_repos(
+              &repos, svn_test_data_path("test-blame-threads", pool), opts,
+              pool));
+  fs = svn_repos_fs(repos);
+  SVN_ERR(svn_uri_get_file_url_from_dirent(
+              &repos_url, svn_test_data_path("test-blame-threads", pool),
+              pool));
+  url = svn_path_url_add_component2(repos_url, "file", pool);
+
+  /* Create a history of 40 revisions with lines being inserted, deleted
+     and replaced all over the file.  All lines are unique, so we know
+     which revision each line must be blamed on. */
+  for (rev = 1; rev <= 40; ++rev)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *txn_root;
+      svn_revnum_t committed_rev;
+      int changes = rev == 1 ? 1 : 1 + svn_test_rand(&seed) % 5;
+      int added = 0;
+
+      svn_pool_clear(iterpool);
+      while (changes--)
+        {
+          int pos = lines->nelts
+                  ? svn_test_rand(&seed) % (lines->nelts + 1)
+                  : 0;
+          int deleted = svn_test_rand(&seed) % 4;
+          int inserted = rev == 1 ? 100 : svn_test_rand(&seed) % 4;
+          int k;
+
+          deleted = MIN(deleted, lines->nelts - pos);
+          if (deleted)
+            {
+              SVN_ERR(svn_sort__array_delete2(lines, pos, deleted));
+              SVN_ERR(svn_sort__array_delete2(line_revs, pos, deleted));
+            }
+
+          for (k = 0; k < inserted; ++k)
+            {
+              const char *line = apr_psprintf(pool, "line %d of r%ld",
+                                              added++, rev);
+              SVN_ERR(svn_sort__array_insert2(lines, &line, pos + k));
+              SVN_ERR(svn_sort__array_insert2(line_revs, &rev, pos + k));
+            }
+        }
+
+      contents = svn_stringbuf_create_empty(pool);
+      for (i = 0; i < lines->nelts; ++i)
+        {
+          svn_stringbuf_appendcstr(contents,
+                                   APR_ARRAY_IDX(lines, i, const char *));
+          svn_stringbuf_appendbyte(contents, '\n');
+        }
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev - 1, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(txn_root, "file", iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "file", contents->data,
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &committed_rev, txn,
+                                      iterpool));
+      SVN_TEST_ASSERT(committed_rev == rev);
+    }
+
+  /* Blame sequentially, with worker threads and on the server. */
+  SVN_ERR(svn_client_create_context2(&ctx, NULL, pool));
+  SVN_ERR(svn_config_create2(&cfg, FALSE, FALSE, pool));
+  ctx->config = apr_hash_make(pool);
+  svn_hash_sets(ctx->config, SVN_CONFIG_CATEGORY_CONFIG, cfg);
+
+  for (i = 0; i < sizeof(settings) / sizeof(settings[0]); ++i)
+    {
+      blame_baton_t bb;
+      int k;
+
+      svn_pool_clear(iterpool);
+      svn_config_set(cfg, SVN_CONFIG_SECTION_MISCELLANY,
+                     SVN_CONFIG_OPTION_BLAME_THREADS, settings[i][0]);
+      svn_config_set(cfg, SVN_CONFIG_SECTION_MISCELLANY,
+                     SVN_CONFIG_OPTION_SERVER_SIDE_BLAME, settings[i][1]);
+
+      bb.revisions = apr_array_make(iterpool, 0, sizeof(svn_revnum_t));
+      bb.contents = svn_stringbuf_create_empty(iterpool);
+      SVN_ERR(svn_client_blame6(NULL, NULL, url, &head_rev, &first_rev,
+                                &head_rev,
+                                svn_diff_file_options_create(iterpool),
+                                FALSE, FALSE, blame_receiver, &bb,
+                                ctx, iterpool));
+
+      SVN_TEST_STRING_ASSERT(bb.contents->data, contents->data);
+      SVN_TEST_ASSERT(bb.revisions->nelts == lines->nelts);
+      for (k = 0; k < lines->nelts; ++k)
+        SVN_TEST_ASSERT(APR_ARRAY_IDX(bb.revisions, k, svn_revnum_t)
+                        == APR_ARRAY_IDX(line_revs, k, svn_revnum_t));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -1447,6 +1606,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_client_copy7 with externals_to_pin"),
     SVN_TEST_OPTS_PASS(test_copy_pin_externals_select_subtree,
                        "pin externals on selected subtrees only"),
+    SVN_TEST_OPTS_PASS(test_blame_threads,
+                       "test svn_client_blame6 with threads and on server"),
     SVN_TEST_NULL
   };
 
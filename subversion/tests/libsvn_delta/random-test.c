@@ -36,6 +36,9 @@
 #include "svn_delta.h"
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "private/svn_cpu.h"
+#include "private/svn_delta_private.h"
+#include "private/svn_string_private.h"
 
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
@@ -605,6 +608,386 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Return the svndiff representation of the delta from SOURCE to TARGET
+   in *DIFF, encoded in SVNDIFF_VERSION by up to THREAD_COUNT threads.
+   Allocate the result in POOL. */
+static svn_error_t *
+make_svndiff(svn_stringbuf_t **diff,
+             const svn_string_t *source,
+             const svn_string_t *target,
+             int svndiff_version,
+             int thread_count,
+             apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  *diff = svn_stringbuf_create_empty(pool);
+  svn_txdelta__to_svndiff_parallel(&handler, &handler_baton,
+                                   svn_stream_from_stringbuf(*diff, pool),
+                                   svndiff_version, 0, NULL, thread_count,
+                                   pool);
+  svn_txdelta2(&txdelta_stream,
+               svn_stream_from_string(source, pool),
+               svn_stream_from_string(target, pool),
+               FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(txdelta_stream, handler,
+                                                   handler_baton, pool));
+}
+
+/* Implements svn_test_driver_t.  Verify that all CPU-specific delta
+   implementations produce the same output as the portable code. */
+static svn_error_t *
+xdelta_cpu_features_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = (apr_uint32_t)apr_time_now();
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < 20; i++)
+    {
+      svn_stringbuf_t *source, *target;
+      svn_stringbuf_t *diff, *diff_plain;
+      apr_size_t len = 1000 + svn_test_rand(&seed) % (200 * 1024);
+      apr_size_t k;
+
+      svn_pool_clear(iterpool);
+
+      /* Small alphabet for many short, spurious matches. */
+      source = svn_stringbuf_create_ensure(len, iterpool);
+      for (k = 0; k < len; ++k)
+        svn_stringbuf_appendbyte(source, (char)('a' + svn_test_rand(&seed)
+                                                      % (i % 4 ? 4 : 26)));
+
+      /* Derive the target from the source with a few random edits. */
+      target = svn_stringbuf_dup(source, iterpool);
+      for (k = 0; k < 50; ++k)
+        {
+          apr_size_t pos = svn_test_rand(&seed) % target->len;
+          apr_size_t count = svn_test_rand(&seed) % 100;
+          if (k % 2)
+            svn_stringbuf_remove(target, pos, count);
+          else
+            svn_stringbuf_insert(target, pos, source->data,
+                                 count < source->len ? count : source->len);
+        }
+
+      SVN_ERR(make_svndiff(&diff, svn_stringbuf__morph_into_string(source),
+                           svn_stringbuf__morph_into_string(target),
+                           1, 1, iterpool));
+
+      svn_cpu__set_features_mask(0);
+      SVN_ERR(make_svndiff(&diff_plain,
+                           svn_stringbuf__morph_into_string(source),
+                           svn_stringbuf__morph_into_string(target),
+                           1, 1, iterpool));
+      svn_cpu__set_features_mask(~(apr_uint32_t)0);
+
+      if (!svn_stringbuf_compare(diff, diff_plain))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Delta mismatch in iteration %d", i);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t.  Verify that the parallel svndiff encoder
+   produces the same output as the serial one and that it can be applied. */
+static svn_error_t *
+parallel_svndiff_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = (apr_uint32_t)apr_time_now();
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < 12; i++)
+    {
+      svn_stringbuf_t *source, *target, *result;
+      svn_stringbuf_t *diff, *diff_parallel;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *stream;
+      apr_size_t len = 1000 + svn_test_rand(&seed) % (2 * 1024 * 1024);
+      int version = 1 + i % 2;
+      int thread_count = 2 + i % 4;
+      apr_size_t k;
+
+      svn_pool_clear(iterpool);
+
+      /* Somewhat compressible data spanning many windows. */
+      source = svn_stringbuf_create_ensure(len, iterpool);
+      for (k = 0; k < len; ++k)
+        svn_stringbuf_appendbyte(source, (char)('a' + svn_test_rand(&seed)
+                                                      % 16));
+
+      target = svn_stringbuf_dup(source, iterpool);
+      for (k = 0; k < 100; ++k)
+        {
+          apr_size_t pos = svn_test_rand(&seed) % target->len;
+          apr_size_t count = svn_test_rand(&seed) % 1000;
+          if (k % 2)
+            svn_stringbuf_remove(target, pos, count);
+          else
+            svn_stringbuf_insert(target, pos, source->data,
+                                 count < source->len ? count : source->len);
+        }
+
+      SVN_ERR(make_svndiff(&diff, svn_stringbuf__morph_into_string(source),
+                           svn_stringbuf__morph_into_string(target),
+                           version, 1, iterpool));
+      SVN_ERR(make_svndiff(&diff_parallel,
+                           svn_stringbuf__morph_into_string(source),
+                           svn_stringbuf__morph_into_string(target),
+                           version, thread_count, iterpool));
+
+      if (!svn_stringbuf_compare(diff, diff_parallel))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "svndiff mismatch with %d threads in "
+                                 "iteration %d", thread_count, i);
+
+      /* Apply the delta to make sure it is complete. */
+      result = svn_stringbuf_create_empty(iterpool);
+      svn_txdelta_apply(svn_stream_from_stringbuf(source, iterpool),
+                        svn_stream_from_stringbuf(result, iterpool),
+                        NULL, NULL, iterpool, &handler, &handler_baton);
+      stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                         iterpool);
+      SVN_ERR(svn_stream_write(stream, diff_parallel->data,
+                               &diff_parallel->len));
+      SVN_ERR(svn_stream_close(stream));
+
+      SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t.  Verify that composing a whole chain of
+   deltas at once reconstructs the latest version in the chain. */
+static svn_error_t *
+compose_chain_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = (apr_uint32_t)apr_time_now();
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < 20; i++)
+    {
+      apr_array_header_t *windows;
+      svn_stringbuf_t *base, *version, *result;
+      svn_txdelta_window_t *composite;
+      apr_size_t len = 1 + svn_test_rand(&seed) % (64 * 1024);
+      int chain_length = 2 + svn_test_rand(&seed) % 50;
+      apr_size_t j;
+      int k;
+
+      svn_pool_clear(iterpool);
+      windows = apr_array_make(iterpool, chain_length,
+                               sizeof(svn_txdelta_window_t *));
+
+      base = svn_stringbuf_create_ensure(len, iterpool);
+      for (j = 0; j < len; ++j)
+        svn_stringbuf_appendbyte(base, (char)('a' + svn_test_rand(&seed)
+                                                    % 8));
+
+      /* Every version in the chain is an edited copy of its predecessor,
+         such that the deltas mix source and target copies. */
+      version = base;
+      for (k = 0; k < chain_length; ++k)
+        {
+          svn_stringbuf_t *next = svn_stringbuf_dup(version, iterpool);
+          svn_txdelta_stream_t *txdelta_stream;
+          svn_txdelta_window_t *window;
+          int edits = 1 + svn_test_rand(&seed) % 10;
+
+          while (edits--)
+            {
+              apr_size_t pos = svn_test_rand(&seed) % (next->len + 1);
+              apr_size_t count = svn_test_rand(&seed) % 200;
+              if (edits % 2 && pos < next->len)
+                svn_stringbuf_remove(next, pos, count);
+              else
+                svn_stringbuf_insert(next, pos, version->data,
+                                     count < version->len
+                                       ? count : version->len);
+            }
+
+          /* Keep the versions within a single delta window. */
+          if (next->len > SVN_DELTA_WINDOW_SIZE)
+            svn_stringbuf_chop(next, next->len - SVN_DELTA_WINDOW_SIZE);
+          if (next->len == 0)
+            svn_stringbuf_appendbyte(next, 'x');
+
+          svn_txdelta2(&txdelta_stream,
+                       svn_stream_from_stringbuf(version, iterpool),
+                       svn_stream_from_stringbuf(next, iterpool),
+                       FALSE, iterpool);
+          SVN_ERR(svn_txdelta_next_window(&window, txdelta_stream,
+                                          iterpool));
+          APR_ARRAY_PUSH(windows, svn_txdelta_window_t *) = window;
+          version = next;
+        }
+
+      composite = svn_txdelta__compose_windows_n(windows, iterpool,
+                                                 iterpool);
+      SVN_TEST_ASSERT(composite->tview_len == version->len);
+
+      result = svn_stringbuf_create_ensure(composite->tview_len, iterpool);
+      result->len = composite->tview_len;
+      svn_txdelta_apply_instructions(composite,
+                                     base->data + composite->sview_offset,
+                                     result->data, &result->len);
+      result->data[result->len] = '\0';
+
+      if (!svn_stringbuf_compare(result, version))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Composing %d deltas failed in "
+                                 "iteration %d", chain_length, i);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Apply WINDOW to SBUF byte by byte and write the target view to TBUF. */
+static void
+apply_bytewise(const svn_txdelta_window_t *window,
+               const char *sbuf,
+               char *tbuf)
+{
+  apr_size_t tpos = 0;
+  int i;
+
+  for (i = 0; i < window->num_ops; ++i)
+    {
+      const svn_txdelta_op_t *op = &window->ops[i];
+      apr_size_t j;
+
+      for (j = 0; j < op->length; ++j, ++tpos)
+        if (op->action_code == svn_txdelta_source)
+          tbuf[tpos] = sbuf[op->offset + j];
+        else if (op->action_code == svn_txdelta_target)
+          tbuf[tpos] = tbuf[op->offset + j];
+        else
+          tbuf[tpos] = window->new_data->data[op->offset + j];
+    }
+}
+
+static svn_error_t *
+apply_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = (apr_uint32_t)apr_time_now();
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      svn_txdelta_window_t window = { 0 };
+      apr_array_header_t *ops;
+      svn_stringbuf_t *new_data, *source;
+      char *expected, *tbuf;
+      apr_size_t tbuf_size, len;
+      apr_size_t tview_len = 1 + svn_test_rand(&seed) % 4096;
+      apr_size_t sview_len = 1 + svn_test_rand(&seed) % 1024;
+      apr_size_t tpos = 0;
+      svn_txdelta_op_t *op;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      ops = apr_array_make(iterpool, 16, sizeof(svn_txdelta_op_t));
+      new_data = svn_stringbuf_create_empty(iterpool);
+      source = svn_stringbuf_create_ensure(sview_len, iterpool);
+      while (source->len < sview_len)
+        svn_stringbuf_appendbyte(source, (char)svn_test_rand(&seed));
+
+      /* Mix all kinds of instructions, with many short target copies
+         that overlap their own output at all distances. */
+      while (tpos < tview_len)
+        {
+          svn_txdelta_op_t new_op;
+          apr_uint32_t kind = svn_test_rand(&seed) % 3;
+
+          new_op.length = 1 + svn_test_rand(&seed)
+                              % (svn_test_rand(&seed) % 2 ? 24 : 300);
+          if (new_op.length > tview_len - tpos)
+            new_op.length = tview_len - tpos;
+
+          if (kind == 0 && tpos > 0)
+            {
+              new_op.action_code = svn_txdelta_target;
+              new_op.offset = tpos - 1 - svn_test_rand(&seed)
+                                         % (tpos < 40 ? tpos : 40);
+            }
+          else if (kind == 1 && new_op.length <= sview_len)
+            {
+              new_op.action_code = svn_txdelta_source;
+              new_op.offset = svn_test_rand(&seed)
+                              % (sview_len - new_op.length + 1);
+              ++window.src_ops;
+            }
+          else
+            {
+              new_op.action_code = svn_txdelta_new;
+              new_op.offset = new_data->len;
+              while (new_data->len < new_op.offset + new_op.length)
+                svn_stringbuf_appendbyte(new_data,
+                                         (char)svn_test_rand(&seed));
+            }
+
+          APR_ARRAY_PUSH(ops, svn_txdelta_op_t) = new_op;
+          tpos += new_op.length;
+        }
+
+      window.sview_len = sview_len;
+      window.tview_len = tview_len;
+      window.num_ops = ops->nelts;
+      window.ops = (svn_txdelta_op_t *)ops->elts;
+      window.new_data = svn_stringbuf__morph_into_string(new_data);
+
+      expected = apr_palloc(iterpool, tview_len);
+      apply_bytewise(&window, source->data, expected);
+
+      /* Both APIs must reproduce the reference result. */
+      tbuf_size = tview_len + svn_test_rand(&seed)
+                              % (SVN_TXDELTA__APPLY_PADDING + 1);
+      tbuf = apr_palloc(iterpool, tbuf_size);
+      SVN_ERR(svn_txdelta__apply_window(&window, source->data, sview_len,
+                                        tbuf, tbuf_size));
+      if (memcmp(tbuf, expected, tview_len))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "svn_txdelta__apply_window failed in "
+                                 "iteration %d", i);
+
+      len = 1 + svn_test_rand(&seed) % tview_len;
+      tbuf = apr_palloc(iterpool, len);
+      svn_txdelta_apply_instructions(&window, source->data, tbuf, &len);
+      if (memcmp(tbuf, expected, len))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "svn_txdelta_apply_instructions failed in "
+                                 "iteration %d", i);
+
+      /* A target copy reaching beyond the current position is invalid. */
+      op = &APR_ARRAY_IDX(ops, ops->nelts - 1, svn_txdelta_op_t);
+      op->action_code = svn_txdelta_target;
+      op->offset = tview_len - op->length + 1;
+      tbuf = apr_palloc(iterpool, tview_len);
+      err = svn_txdelta__apply_window(&window, source->data, sview_len,
+                                      tbuf, tview_len);
+      SVN_TEST_ASSERT_ERROR(err, SVN_ERR_SVNDIFF_INVALID_OPS);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +1008,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_PASS2(xdelta_cpu_features_test,
+                   "xdelta with and without CPU-specific code"),
+    SVN_TEST_PASS2(parallel_svndiff_test,
+                   "parallel svndiff encoding"),
+    SVN_TEST_PASS2(compose_chain_test,
+                   "compose a chain of deltas at once"),
+    SVN_TEST_PASS2(apply_window_test,
+                   "apply windows with overlapping target copies"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -26,102 +26,52 @@
 
 #include "../../libsvn_delta/compose_delta.c"
 
-static range_index_node_t *prev_node, *prev_prev_node;
-static apr_size_t
-walk_range_index(range_index_node_t *node, const char **msg)
+/* Return the index of the first node in NDX that violates the range
+   index invariants and set *MSG accordingly.  Return -1 if everything
+   is fine. */
+static int
+check_range_index(const range_index_t *ndx, const char **msg)
 {
-  apr_off_t ret;
+  int i;
 
-  if (node == NULL)
-    return 0;
-
-  ret = walk_range_index(node->left, msg);
-  if (ret > 0)
-    return ret;
-
-  if (prev_node != NULL
-      && node->target_offset > 0
-      && (prev_node->offset >= node->offset
-          || (prev_node->limit >= node->limit)))
-    {
-      ret = node->target_offset;
-      node->target_offset = -node->target_offset;
-      *msg = "Oops, the previous node ate me.";
-      return ret;
-    }
-  if (prev_prev_node != NULL
-      && prev_node->target_offset > 0
-      && prev_prev_node->limit > node->offset)
+  for (i = 1; i < ndx->length; ++i)
     {
-      ret = prev_node->target_offset;
-      prev_node->target_offset = -prev_node->target_offset;
-      *msg = "Arrgh, my neighbours are conspiring against me.";
-      return ret;
+      const range_index_node_t *const prev = &ndx->nodes[i - 1];
+      const range_index_node_t *const node = &ndx->nodes[i];
+
+      if (prev->offset >= node->offset || prev->limit >= node->limit)
+        {
+          *msg = "Oops, the previous node ate me.";
+          return i;
+        }
+      if (i > 1 && ndx->nodes[i - 2].limit > node->offset)
+        {
+          *msg = "Arrgh, my neighbours are conspiring against me.";
+          return i - 1;
+        }
     }
-  prev_prev_node = prev_node;
-  prev_node = node;
 
-  return walk_range_index(node->right, msg);
+  return -1;
 }
 
 
 static void
-print_node_data(range_index_node_t *node, const char *msg, apr_off_t ndx)
+print_range_index(const range_index_t *ndx, const char *msg, int bad)
 {
-  if (-node->target_offset == ndx)
+  int i;
+
+  for (i = 0; i < ndx->length; ++i)
     {
-      printf("   * Node: [%3"APR_SIZE_T_FMT
+      const range_index_node_t *const node = &ndx->nodes[i];
+      printf("   %c Node: [%3"APR_SIZE_T_FMT
              ",%3"APR_SIZE_T_FMT
              ") = %-5"APR_SIZE_T_FMT"%s\n",
-             node->offset, node->limit, -node->target_offset, msg);
-    }
-  else
-    {
-      printf("     Node: [%3"APR_SIZE_T_FMT
-             ",%3"APR_SIZE_T_FMT
-             ") = %"APR_SIZE_T_FMT"\n",
-             node->offset, node->limit,
-             node->target_offset);
+             i == bad ? '*' : ' ',
+             node->offset, node->limit, node->target_offset,
+             i == bad ? msg : "");
     }
 }
 
-static void
-print_range_index_r(range_index_node_t *node, const char *msg, apr_off_t ndx)
-{
-  if (node == NULL)
-    return;
-
-  print_range_index_r(node->left, msg, ndx);
-  print_node_data(node, msg, ndx);
-  print_range_index_r(node->right, msg, ndx);
-}
-
-static void
-print_range_index_i(range_index_node_t *node, const char *msg, apr_off_t ndx)
-{
-  if (node == NULL)
-    return;
-
-  while (node->prev)
-    node = node->prev;
-
-  do
-    {
-      print_node_data(node, msg, ndx);
-      node = node->next;
-    }
-  while (node);
-}
-
-static void
-print_range_index(range_index_node_t *node, const char *msg, apr_off_t ndx)
-{
-  printf("  (recursive)\n");
-  print_range_index_r(node, msg, ndx);
-  printf("  (iterative)\n");
-  print_range_index_i(node, msg, ndx);
-}
-
 
 static void
 check_copy_count(int src_cp, int tgt_cp)
@@ -147,46 +97,41 @@ random_range_index_test(apr_pool_t *pool)
   init_params(&seed, &maxlen, &iterations, &dump_files, &print_windows,
               &random_bytes, &bytes_range, pool);
 
-  /* ### This test is expected to fail randomly at the moment, so don't
-     enable it by default. --xbc */
-
   ndx = create_range_index(pool);
   for (i = 1; i <= iterations; ++i)
     {
       apr_size_t offset = svn_test_rand(&seed) % 47;
       apr_size_t limit = offset + svn_test_rand(&seed) % 16 + 1;
-      range_list_node_t *list, *r;
-      apr_size_t ret;
+      const range_list_node_t *r;
+      int pos, bad;
       const char *msg2;
 
       printf("%3d: Inserting [%3"APR_SIZE_T_FMT",%3"APR_SIZE_T_FMT") ...",
              i, offset, limit);
-      splay_range_index(offset, ndx);
-      list = build_range_list(offset, limit, ndx);
-      insert_range(offset, limit, i, ndx);
-      prev_prev_node = prev_node = NULL;
-      ret = walk_range_index(ndx->tree, &msg2);
-      if (ret == 0)
+      pos = search_range_index(ndx, offset);
+      build_range_list(offset, limit, ndx, pos);
+      insert_range(offset, limit, i, ndx, pos);
+      bad = check_range_index(ndx, &msg2);
+      if (bad < 0)
         {
-          for (r = list; r; r = r->next)
+          for (r = ndx->list; r != ndx->list + ndx->list_length; ++r)
             printf(" %s[%3"APR_SIZE_T_FMT",%3"APR_SIZE_T_FMT")",
                    (r->kind == range_from_source ?
                     (++src_cp, "S") : (++tgt_cp, "T")),
                    r->offset, r->limit);
-          free_range_list(list, ndx);
           printf(" OK\n");
         }
       else
         {
           printf(" Ooops!\n");
-          print_range_index(ndx->tree, msg2, ret);
+          print_range_index(ndx, msg2, bad);
           check_copy_count(src_cp, tgt_cp);
           return svn_error_create(SVN_ERR_TEST_FAILED, NULL, "insert_range");
         }
     }
 
-  printf("Final tree state:\n");
-  print_range_index(ndx->tree, "", iterations + 1);
+  printf("Final index state:\n");
+  print_range_index(ndx, "", -1);
   check_copy_count(src_cp, tgt_cp);
   return SVN_NO_ERROR;
 }
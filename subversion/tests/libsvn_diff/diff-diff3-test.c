@@ -27,6 +27,7 @@
 #include "svn_diff.h"
 #include "svn_pools.h"
 #include "svn_utf.h"
+#include "private/svn_cpu.h"
 
 /* Used to terminate lines in large multi-line string literals. */
 #define NL APR_EOL_STR
@@ -2693,6 +2694,240 @@ test_token_compare(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_repeated_lines_across_chunks(apr_pool_t *pool)
+{
+  apr_size_t chunk_size = 1 << 17;
+  int changed_line = 30000;
+  int i;
+  svn_stringbuf_t *original, *modified;
+  svn_diff_file_options_t *diff_opts = svn_diff_file_options_create(pool);
+
+  diff_opts->ignore_space = svn_diff_file_ignore_space_all;
+
+  /* Lines repeating every 1000 lines, spread over several chunks.  Every
+     97th line differs in whitespace only and one line has been changed.
+     Changing the first line as well keeps the identical prefix scanning
+     from skipping all the lines before the other change. */
+  original = svn_stringbuf_create_ensure(chunk_size * 4, pool);
+  modified = svn_stringbuf_create_ensure(chunk_size * 4, pool);
+  for (i = 0; original->len < chunk_size * 3 + 1000; ++i)
+    {
+      svn_stringbuf_appendcstr(original,
+                               apr_psprintf(pool, "line %04d\n", i % 1000));
+      if (i == 0 || i == changed_line)
+        svn_stringbuf_appendcstr(modified, "changed\n");
+      else if (i % 97 == 0)
+        svn_stringbuf_appendcstr(modified,
+                                 apr_psprintf(pool, " line  %04d\n",
+                                              i % 1000));
+      else
+        svn_stringbuf_appendcstr(modified,
+                                 apr_psprintf(pool, "line %04d\n", i % 1000));
+    }
+
+  SVN_ERR(two_way_diff("repeated-lines-original", "repeated-lines-modified",
+                       original->data, modified->data,
+                       apr_psprintf(pool,
+                                    "--- repeated-lines-original" NL
+                                    "+++ repeated-lines-modified" NL
+                                    "@@ -1,4 +1,4 @@" NL
+                                    "-line 0000\n"
+                                    "+changed\n"
+                                    " line 0001\n"
+                                    " line 0002\n"
+                                    " line 0003\n"
+                                    "@@ -%d,7 +%d,7 @@"  NL
+                                    " line 0997\n"
+                                    " line 0998\n"
+                                    " line 0999\n"
+                                    "-line 0000\n"
+                                    "+changed\n"
+                                    " line 0001\n"
+                                    " line 0002\n"
+                                    " line 0003\n",
+                                    changed_line - 2, changed_line - 2),
+                       diff_opts, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_normalized_prefix_suffix(apr_pool_t *pool)
+{
+  apr_size_t chunk_size = 1 << 17;
+  int changed_line = 20000;
+  int mode;
+  int i;
+  svn_stringbuf_t *original, *modified;
+  svn_diff_file_options_t *diff_opts = svn_diff_file_options_create(pool);
+
+  diff_opts->ignore_eol_style = TRUE;
+  diff_opts->ignore_space = svn_diff_file_ignore_space_change;
+
+  /* A file spread over several chunks that got converted to CRLF and
+     where every 7th line differs in whitespace only.  With these lines
+     being ignored, everything but the one changed line is identical
+     prefix or suffix. */
+  original = svn_stringbuf_create_ensure(chunk_size * 4, pool);
+  modified = svn_stringbuf_create_ensure(chunk_size * 5, pool);
+  for (i = 0; original->len < chunk_size * 3 + 1000; ++i)
+    {
+      svn_stringbuf_appendcstr(original,
+                               apr_psprintf(pool, "line %05d\n", i));
+      if (i == changed_line)
+        svn_stringbuf_appendcstr(modified, "changed\r\n");
+      else if (i % 7 == 0)
+        svn_stringbuf_appendcstr(modified,
+                                 apr_psprintf(pool, "line \t %05d\r\n", i));
+      else
+        svn_stringbuf_appendcstr(modified,
+                                 apr_psprintf(pool, "line %05d\r\n", i));
+    }
+
+  /* The vectorized and the portable scanning code must agree. */
+  for (mode = 0; mode < 2; ++mode)
+    {
+      svn_error_t *err;
+
+      svn_cpu__set_features_mask(mode == 0 ? ~(apr_uint32_t)0 : 0);
+      err = two_way_diff("normalized-prefix-original",
+                         "normalized-prefix-modified",
+                         original->data, modified->data,
+                         apr_psprintf(pool,
+                                      "--- normalized-prefix-original" NL
+                                      "+++ normalized-prefix-modified" NL
+                                      "@@ -%d,7 +%d,7 @@" NL
+                                      " line %05d\n"
+                                      " line %05d\n"
+                                      " line %05d\n"
+                                      "-line %05d\n"
+                                      "+changed\r\n"
+                                      " line %05d\n"
+                                      " line %05d\n"
+                                      " line %05d\n",
+                                      changed_line - 2, changed_line - 2,
+                                      changed_line - 3, changed_line - 2,
+                                      changed_line - 1, changed_line,
+                                      changed_line + 1, changed_line + 2,
+                                      changed_line + 3),
+                         diff_opts, pool);
+      svn_cpu__set_features_mask(~(apr_uint32_t)0);
+      SVN_ERR(err);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Generated inputs of test_prefix_suffix_scan(). */
+typedef enum scan_input_t
+{
+  /* A few lines changed. */
+  scan_input_changed,
+
+  /* A few lines changed and the rest converted to CRLF, compared with
+   * --ignore-eol-style. */
+  scan_input_eol_style,
+
+  /* A few lines changed and every tenth line re-indented, compared with
+   * --ignore-space-change. */
+  scan_input_reindented,
+
+  scan_input_count
+} scan_input_t;
+
+static svn_error_t *
+test_prefix_suffix_scan(apr_pool_t *pool)
+{
+  int num_lines = 40000;
+  int input;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Large files that differ in a few lines only, so the identical prefix
+     and suffix scanning does most of the work.  The unified diff of the
+     in-memory diff, which does not use that code, tells what to expect. */
+  for (input = 0; input < scan_input_count; ++input)
+    {
+      svn_stringbuf_t *original = svn_stringbuf_create_empty(iterpool);
+      svn_stringbuf_t *modified = svn_stringbuf_create_empty(iterpool);
+      svn_diff_file_options_t *diff_opts
+        = svn_diff_file_options_create(iterpool);
+      svn_string_t *original_str, *modified_str;
+      svn_stringbuf_t *expected = svn_stringbuf_create_empty(iterpool);
+      svn_stream_t *ostream = svn_stream_from_stringbuf(expected, iterpool);
+      svn_diff_t *diff;
+      int changes = 0;
+      apr_size_t k;
+      int mode;
+      int i;
+
+      for (i = 0; i < num_lines; ++i)
+        {
+          const char *line = apr_psprintf(iterpool,
+                                          "    value_%d = compute(%d, x);",
+                                          i, i % 1000);
+
+          svn_stringbuf_appendcstr(original, line);
+          svn_stringbuf_appendbyte(original, '\n');
+
+          if (i % (num_lines / 4) == num_lines / 8)
+            svn_stringbuf_appendcstr(modified, "    changed();");
+          else if (input == scan_input_reindented && i % 10 == 0)
+            svn_stringbuf_appendcstr(modified,
+                                     apr_pstrcat(iterpool, "\t", line + 4,
+                                                 SVN_VA_NULL));
+          else
+            svn_stringbuf_appendcstr(modified, line);
+
+          svn_stringbuf_appendcstr(modified,
+                                   input == scan_input_eol_style ? "\r\n"
+                                                                 : "\n");
+        }
+
+      diff_opts->ignore_eol_style = (input == scan_input_eol_style);
+      if (input == scan_input_reindented)
+        diff_opts->ignore_space = svn_diff_file_ignore_space_change;
+
+      original_str = svn_string_create_from_buf(original, iterpool);
+      modified_str = svn_string_create_from_buf(modified, iterpool);
+      SVN_ERR(svn_diff_mem_string_diff(&diff, original_str, modified_str,
+                                       diff_opts, iterpool));
+      SVN_ERR(svn_diff_mem_string_output_unified(ostream, diff,
+                                                 "scan-original",
+                                                 "scan-modified",
+                                                 SVN_APR_LOCALE_CHARSET,
+                                                 original_str, modified_str,
+                                                 iterpool));
+      SVN_ERR(svn_stream_close(ostream));
+
+      /* Only the changed lines may show up. */
+      for (k = 0; k + 1 < expected->len; ++k)
+        if (expected->data[k] == '\n' && expected->data[k + 1] == '-')
+          ++changes;
+
+      SVN_TEST_INT_ASSERT(changes, 4);
+
+      /* The vectorized and the portable scanning code must agree. */
+      for (mode = 0; mode < 2; ++mode)
+        {
+          svn_error_t *err;
+
+          svn_cpu__set_features_mask(mode == 0 ? ~(apr_uint32_t)0 : 0);
+          err = two_way_diff("scan-original", "scan-modified",
+                             original->data, modified->data, expected->data,
+                             diff_opts, iterpool);
+          svn_cpu__set_features_mask(~(apr_uint32_t)0);
+          SVN_ERR(err);
+        }
+
+      svn_pool_clear(iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 two_way_issue_3362_v1(apr_pool_t *pool)
 {
@@ -3065,6 +3300,159 @@ three_way_double_add(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_histogram_diff(apr_pool_t *pool)
+{
+  svn_diff_file_options_t *options = svn_diff_file_options_create(pool);
+  apr_pool_t *subpool = svn_pool_create(pool);
+  int i;
+
+  const char *filename1 = svn_test_data_path("histogram1", pool);
+  const char *filename2 = svn_test_data_path("histogram2", pool);
+  const char *filename3 = svn_test_data_path("histogram3", pool);
+  const char *filename4 = svn_test_data_path("histogram4", pool);
+
+  options->histogram = TRUE;
+
+  /* The unique line "c" splits the remainders after the common prefix. */
+  SVN_ERR(two_way_diff("histogram1", "histogram2",
+                       "a\n"
+                       "}\n"
+                       "b\n"
+                       "}\n"
+                       "c\n"
+                       "}\n",
+
+                       "a\n"
+                       "}\n"
+                       "x\n"
+                       "}\n"
+                       "c\n"
+                       "}\n"
+                       "d\n",
+
+                       "--- histogram1"   NL
+                       "+++ histogram2"   NL
+                       "@@ -1,6 +1,7 @@" NL
+                       " a\n"
+                       " }\n"
+                       "-b\n"
+                       "+x\n"
+                       " }\n"
+                       " c\n"
+                       " }\n"
+                       "+d\n",
+                       options, pool));
+
+  seed_val();
+
+  for (i = 0; i < 5; ++i)
+    {
+      svn_stringbuf_t *contents1, *contents2;
+      svn_stringbuf_t *original, *modified1, *modified2, *combined;
+      int num_lines = 2000, num_src = 10, num_dst = 10;
+      svn_boolean_t *lines = apr_pcalloc(subpool, sizeof(*lines) * num_lines);
+      struct random_mod *src_lines = apr_palloc(subpool,
+                                                sizeof(*src_lines) * num_src);
+      struct random_mod *dst_lines = apr_palloc(subpool,
+                                                sizeof(*dst_lines) * num_dst);
+      struct random_mod *mrg_lines = apr_palloc(subpool,
+                                                (sizeof(*mrg_lines)
+                                                 * (num_src + num_dst)));
+
+      /* Many repeated lines.  The histogram algorithm will have to fall
+         back to the Myers algorithm for parts of them. */
+      SVN_ERR(make_random_file(filename1, 1000, 1100, 50, 10, i % 3,
+                               subpool));
+      SVN_ERR(make_random_file(filename2, 1000, 1100, 50, 10, i % 2,
+                               subpool));
+
+      SVN_ERR(svn_stringbuf_from_file2(&contents1, filename1, subpool));
+      SVN_ERR(svn_stringbuf_from_file2(&contents2, filename2, subpool));
+
+      SVN_ERR(three_way_merge("histogram1", "histogram2", "histogram1",
+                              contents1->data, contents2->data,
+                              contents1->data, contents2->data, options,
+                              svn_diff_conflict_display_modified_latest,
+                              subpool));
+
+      /* Distinct lines only. */
+      select_lines(src_lines, num_src, lines, num_lines);
+      select_lines(dst_lines, num_dst, lines, num_lines);
+      memcpy(mrg_lines, src_lines, sizeof(*mrg_lines) * num_src);
+      memcpy(mrg_lines + num_src, dst_lines, sizeof(*mrg_lines) * num_dst);
+
+      SVN_ERR(make_random_merge_file(filename1, num_lines, NULL, 0, subpool));
+      SVN_ERR(make_random_merge_file(filename2, num_lines, src_lines, num_src,
+                                     subpool));
+      SVN_ERR(make_random_merge_file(filename3, num_lines, dst_lines, num_dst,
+                                     subpool));
+      SVN_ERR(make_random_merge_file(filename4, num_lines, mrg_lines,
+                                     num_src + num_dst, subpool));
+
+      SVN_ERR(svn_stringbuf_from_file2(&original, filename1, subpool));
+      SVN_ERR(svn_stringbuf_from_file2(&modified1, filename2, subpool));
+      SVN_ERR(svn_stringbuf_from_file2(&modified2, filename3, subpool));
+      SVN_ERR(svn_stringbuf_from_file2(&combined, filename4, subpool));
+
+      SVN_ERR(three_way_merge("histogram1", "histogram2", "histogram3",
+                              original->data, modified1->data,
+                              modified2->data, combined->data, options,
+                              svn_diff_conflict_display_modified_latest,
+                              subpool));
+
+      SVN_ERR(svn_io_remove_file2(filename4, TRUE, subpool));
+
+      svn_pool_clear(subpool);
+    }
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_histogram_repetitive(apr_pool_t *pool)
+{
+  svn_diff_file_options_t *options = svn_diff_file_options_create(pool);
+  svn_stringbuf_t *original = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *modified = svn_stringbuf_create_empty(pool);
+  int i;
+
+  options->histogram = TRUE;
+
+  /* Eight lines repeated over and over, far more often than the histogram
+     algorithm accepts for split points, with scattered changes that are
+     unique to one side only.  The whole range is too large to be handed
+     to the Myers algorithm at once and must be split first. */
+  for (i = 0; i < 20000; ++i)
+    {
+      const char *line = apr_psprintf(pool, "line %d\n", i % 8);
+
+      svn_stringbuf_appendcstr(original, line);
+      if (i % 97 == 13)
+        svn_stringbuf_appendcstr(modified,
+                                 apr_psprintf(pool, "changed %d\n", i));
+      else if (i % 89 != 7)
+        svn_stringbuf_appendcstr(modified, line);
+
+      if (i % 113 == 0)
+        svn_stringbuf_appendcstr(modified, "added\n");
+    }
+
+  SVN_ERR(three_way_merge("histogram5", "histogram6", "histogram5",
+                          original->data, modified->data,
+                          original->data, modified->data, options,
+                          svn_diff_conflict_display_modified_latest,
+                          pool));
+  SVN_ERR(three_way_merge("histogram6", "histogram5", "histogram6",
+                          modified->data, original->data,
+                          modified->data, original->data, options,
+                          svn_diff_conflict_display_modified_latest,
+                          pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -3103,12 +3491,22 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "identical suffix starts at the boundary of a chunk"),
     SVN_TEST_PASS2(test_token_compare,
                    "compare tokens at the chunk boundary"),
+    SVN_TEST_PASS2(test_repeated_lines_across_chunks,
+                   "compare tokens in earlier chunks"),
     SVN_TEST_PASS2(two_way_issue_3362_v1,
                    "2-way issue #3362 test v1"),
     SVN_TEST_PASS2(two_way_issue_3362_v2,
                    "2-way issue #3362 test v2"),
     SVN_TEST_XFAIL2(three_way_double_add,
                    "3-way merge, double add"),
+    SVN_TEST_PASS2(test_histogram_diff,
+                   "2-way and 3-way diff with the histogram algorithm"),
+    SVN_TEST_PASS2(test_histogram_repetitive,
+                   "histogram diff of highly repetitive input"),
+    SVN_TEST_PASS2(test_normalized_prefix_suffix,
+                   "identical prefix and suffix ignoring whitespace"),
+    SVN_TEST_PASS2(test_prefix_suffix_scan,
+                   "identical prefix and suffix of large files"),
     SVN_TEST_NULL
   };
 
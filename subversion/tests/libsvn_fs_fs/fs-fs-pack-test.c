@@ -28,15 +28,18 @@
 #include "../../libsvn_fs/fs-loader.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
 #include "../../libsvn_fs_fs/util.h"
 
+#include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test_fs.h"
 
@@ -101,6 +104,44 @@ pack_notify(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* When packing in parallel, shards may be started before earlier ones
+   complete.  Both kinds of notifications must still come in shard order
+   and each shard must be started before it completes. */
+struct parallel_pack_notify_baton
+{
+  apr_int64_t next_start;
+  apr_int64_t next_end;
+};
+
+static svn_error_t *
+parallel_pack_notify(void *baton,
+                     apr_int64_t shard,
+                     svn_fs_pack_notify_action_t action,
+                     apr_pool_t *pool)
+{
+  struct parallel_pack_notify_baton *pnb = baton;
+
+  switch (action)
+    {
+      case svn_fs_pack_notify_start:
+        SVN_TEST_ASSERT(shard == pnb->next_start);
+        pnb->next_start++;
+        break;
+
+      case svn_fs_pack_notify_end:
+        SVN_TEST_ASSERT(shard == pnb->next_end);
+        SVN_TEST_ASSERT(shard < pnb->next_start);
+        pnb->next_end++;
+        break;
+
+      default:
+        return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                                "Unknown notification action when packing");
+    }
+
+  return SVN_NO_ERROR;
+}
+
 #define R1_LOG_MSG "Let's serf"
 
 /* Create a filesystem in DIR.  Set the shard size to SHARD_SIZE and create
@@ -191,7 +232,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, 1, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -226,7 +267,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, 1, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -663,7 +704,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1002,7 +1043,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, 1, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1796,7 +1837,7 @@ pack_with_limited_memory(const svn_test_opts_t *opts,
 
       /* Pack it with a narrow memory budget. */
       SVN_ERR(svn_fs_open2(&fs, dir, NULL, iterpool, iterpool));
-      SVN_ERR(svn_fs_fs__pack(fs, max_mem, NULL, NULL, NULL, NULL,
+      SVN_ERR(svn_fs_fs__pack(fs, max_mem, 1, NULL, NULL, NULL, NULL,
                               iterpool));
 
       /* To be sure: Verify that we didn't break the repo. */
@@ -1888,8 +1929,985 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+/* Pack several shards concurrently and check that notifications still
+   arrive in shard order. */
+#define REPO_NAME "test-repo-pack-in-parallel"
+#define SHARD_SIZE 5
+#define MAX_REV 53
+static svn_error_t *
+pack_in_parallel(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  struct parallel_pack_notify_baton pnb;
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  pnb.next_start = 0;
+  pnb.next_end = 0;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 4, parallel_pack_notify, &pnb, NULL, NULL,
+                       pool));
+  SVN_TEST_ASSERT(pnb.next_start == (MAX_REV + 1) / SHARD_SIZE);
+  SVN_TEST_ASSERT(pnb.next_end == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* All revisions must still be readable. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 2; rev <= MAX_REV; ++rev)
+    {
+      svn_fs_root_t *root;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "iota", &contents,
+                                          iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             get_rev_contents(rev, iterpool));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+/* Read and verify a packed repository with memory-mapped file access. */
+#define REPO_NAME "test-repo-read-packed-fs-mmap"
+#define SHARD_SIZE 5
+#define MAX_REV 13
+static svn_error_t *
+read_packed_fs_mmap(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  apr_file_t *file;
+  const char *config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+
+  /* Enable mmap in fsfs.conf. */
+  config = "[" CONFIG_SECTION_IO "]\n" CONFIG_OPTION_USE_MMAP " = true\n";
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->use_mmap);
+
+  for (rev = 2; rev <= MAX_REV; ++rev)
+    {
+      svn_fs_root_t *root;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "iota", &contents,
+                                          iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             get_rev_contents(rev, iterpool));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+
+/* ------------------------------------------------------------------------ */
+
+/* Return a pseudo-random printable string of LEN bytes based on *SEED,
+   allocated in POOL. */
+static svn_stringbuf_t *
+random_text(apr_uint32_t *seed, apr_size_t len, apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(len, pool);
+
+  while (result->len < len)
+    {
+      *seed = *seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(result, (char)('a' + (*seed >> 16) % 26));
+    }
+
+  return result;
+}
+
+/* Reconstruct fulltexts with long delta chains using multiple threads. */
+#define REPO_NAME "test-repo-read-delta-chain-parallel"
+#define MAX_REV 24
+static svn_error_t *
+read_delta_chain_parallel(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev, new_rev;
+  svn_stringbuf_t *contents[MAX_REV + 1];
+  apr_hash_t *fs_config;
+  apr_uint32_t seed = 1;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Revision 1: a file spanning several txdelta windows.  Poorly
+   * compressible data makes the windows large enough to be worth
+   * parsing in parallel. */
+  contents[1] = random_text(&seed, 3 * 102400, pool);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", contents[1]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Modify a few bytes in every window, building a long delta chain. */
+  for (rev = 2; rev <= MAX_REV; ++rev)
+    {
+      apr_size_t pos;
+
+      svn_pool_clear(iterpool);
+      contents[rev] = svn_stringbuf_dup(contents[rev - 1], pool);
+      for (pos = (apr_size_t)rev * 997;
+           pos < contents[rev]->len;
+           pos += 102400)
+        contents[rev]->data[pos] = (char)('A' + rev);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[rev]->data,
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+      SVN_TEST_ASSERT(new_rev == rev);
+    }
+
+  /* Read all revisions back using a new FS instance with disjoint caches
+   * and threaded window parsing. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ((fs_fs_data_t *)fs->fsap_data)->delta_read_threads = 4;
+
+  for (rev = MAX_REV; rev >= 1; --rev)
+    {
+      svn_stringbuf_t *actual;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "f", &actual, iterpool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[rev]));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+/* Read a file whose older delta reps have fewer windows than its younger
+ * ones using threaded window parsing. */
+#define REPO_NAME "test-repo-read-growing-file-parallel"
+#define MAX_REV 12
+static svn_error_t *
+read_growing_file_parallel(const svn_test_opts_t *opts,
+                           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev, new_rev;
+  svn_stringbuf_t *contents[MAX_REV + 1];
+  apr_hash_t *fs_config;
+  apr_uint32_t seed = 1;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Grow the file by half a txdelta window per revision and modify its
+   * start, such that every revision gets stored as a delta.  The latest
+   * revision spans several windows.  Poorly compressible data makes the
+   * windows large enough to be worth parsing in parallel. */
+  contents[0] = svn_stringbuf_create_empty(pool);
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      contents[rev] = svn_stringbuf_dup(contents[rev - 1], pool);
+      svn_stringbuf_appendstr(contents[rev],
+                              random_text(&seed, 51200, iterpool));
+      contents[rev]->data[0] = (char)('A' + rev);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(root, "f", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[rev]->data,
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+      SVN_TEST_ASSERT(new_rev == rev);
+    }
+
+  /* Read all revisions back using a new FS instance with disjoint caches
+   * and threaded window parsing. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ((fs_fs_data_t *)fs->fsap_data)->delta_read_threads = 4;
+
+  for (rev = MAX_REV; rev >= 1; --rev)
+    {
+      svn_stringbuf_t *actual;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "f", &actual, iterpool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[rev]));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+/* Store and read back deltas with large, sliding source views. */
+#define REPO_NAME "test-repo-large-delta-windows"
+static svn_error_t *
+large_delta_windows(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root, *root1, *root2;
+  svn_revnum_t rev, new_rev;
+  svn_stringbuf_t *contents[4], *actual;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  apr_finfo_t finfo;
+  apr_file_t *file;
+  const char *config;
+  apr_uint32_t seed = 1;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support large windows");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Enable large delta windows in fsfs.conf. */
+  config = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+           CONFIG_OPTION_COMPRESSION " = lz4\n"
+           CONFIG_OPTION_LARGE_DELTA_WINDOWS " = true\n";
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->large_delta_windows);
+
+  /* r1: a file spanning several large windows.
+   * r2: the same file with new data at the front, i.e. all of its contents
+   *     moved beyond the reach of traditional source views.
+   * r3: a small change on top of r2, giving a chain of sliding deltas. */
+  contents[1] = random_text(&seed, 3 * 1024 * 1024, pool);
+  contents[2] = random_text(&seed, 300 * 1024, pool);
+  svn_stringbuf_appendstr(contents[2], contents[1]);
+  contents[3] = svn_stringbuf_dup(contents[2], pool);
+  svn_stringbuf_replace(contents[3], 2 * 1024 * 1024, 5, "12345", 5);
+
+  for (rev = 1; rev <= 3; ++rev)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(root, "f", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[rev]->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, pool));
+      SVN_TEST_ASSERT(new_rev == rev);
+    }
+
+  /* The moved data must have been deltified. */
+  SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_rev_absolute(fs, 2, pool),
+                      APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < (apr_off_t)contents[2]->len / 4);
+
+  /* Read everything back using a new FS instance. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 1; rev <= 3; ++rev)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "f", &actual, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[rev]));
+    }
+
+  /* Deltas between revisions must be usable as well. */
+  SVN_ERR(svn_fs_revision_root(&root1, fs, 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root2, fs, 2, pool));
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, root1, "f",
+                                       root2, "f", pool));
+  actual = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(svn_stream_from_stringbuf(contents[1], pool),
+                    svn_stream_from_stringbuf(actual, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  SVN_ERR(svn_txdelta_send_txstream(delta_stream, handler, handler_baton,
+                                    pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[2]));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, 3, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* Read zstd compressed deltas, which use classic delta windows, by
+   combining their windows. */
+#define REPO_NAME "test-repo-zstd-combined-windows"
+#define MAX_REV 4
+static svn_error_t *
+zstd_combined_windows(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev, new_rev;
+  svn_stringbuf_t *contents[MAX_REV + 1], *actual, *rev_file;
+  svn_boolean_t is_svndiff4 = FALSE;
+  svn_cache__info_t info;
+  apr_hash_t *fs_config;
+  apr_file_t *file;
+  const char *config;
+  apr_uint32_t seed = 1;
+  apr_size_t i;
+  fs_fs_data_t *ffd;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support zstd");
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support not compiled in");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Enable zstd compression in fsfs.conf. */
+  config = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+           CONFIG_OPTION_COMPRESSION " = zstd\n";
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* A small file, modified in every revision. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      contents[rev] = rev == 1 ? random_text(&seed, 10000, pool)
+                               : svn_stringbuf_dup(contents[rev - 1], pool);
+      contents[rev]->data[rev * 1000] = (char)('A' + rev);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(root, "f", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[rev]->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, pool));
+      SVN_TEST_ASSERT(new_rev == rev);
+    }
+
+  /* The deltas must actually be svndiff4. */
+  SVN_ERR(svn_stringbuf_from_file2(&rev_file,
+                                   svn_fs_fs__path_rev_absolute(fs, MAX_REV,
+                                                                pool),
+                                   pool));
+  for (i = 0; i + 4 <= rev_file->len && !is_svndiff4; ++i)
+    is_svndiff4 = memcmp(rev_file->data + i, "SVN\4", 4) == 0;
+  SVN_TEST_ASSERT(is_svndiff4);
+
+  /* Read the file back using a new FS instance with disjoint caches.
+   * Only the window combining code caches combined windows. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, MAX_REV, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &actual, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[MAX_REV]));
+
+  ffd = fs->fsap_data;
+  if (ffd->combined_window_cache)
+    {
+      SVN_ERR(svn_cache__get_info(ffd->combined_window_cache, &info, FALSE,
+                                  pool));
+      SVN_TEST_ASSERT(info.sets > 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* Recreate a repository at the same path with the same UUID and make sure
+   that it does not see the old contents in the shared disk cache. */
+#define REPO_NAME "test-repo-recreated-repos-disk-cache"
+static svn_error_t *
+recreated_repos_disk_cache(const svn_test_opts_t *opts,
+                           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t new_rev;
+  svn_stringbuf_t *actual;
+  apr_hash_t *fs_config;
+  apr_file_t *file;
+  const char *cache_path;
+  const char *config;
+  const char *uuid = svn_uuid_generate(pool);
+  const char *contents[] = { "contents of the first repository\n",
+                             "contents of the other repository\n" };
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have FS instance IDs");
+
+  /* A disk cache outside the repository, surviving its deletion. */
+  SVN_ERR(svn_dirent_get_absolute(&cache_path, REPO_NAME "-cache", pool));
+  SVN_ERR(svn_io_remove_dir2(cache_path, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(cache_path);
+  config = apr_pstrcat(pool, "[" CONFIG_SECTION_CACHES "]\n"
+                       CONFIG_OPTION_DISK_CACHE_PATH " = ", cache_path, "\n",
+                       SVN_VA_NULL);
+
+  /* Same path, same UUID, different contents in r1. */
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+      SVN_ERR(svn_fs_set_uuid(fs, uuid, pool));
+
+      SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                      pool),
+                               APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+      SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL,
+                                     pool));
+      SVN_ERR(svn_io_file_close(file, pool));
+
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      SVN_ERR(svn_fs_make_file(root, "f", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[i], pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, pool));
+      SVN_TEST_ASSERT(new_rev == 1);
+
+      /* Read r1 through the disk cache only. */
+      fs_config = apr_hash_make(pool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                               svn_uuid_generate(pool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+      SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "f", &actual, pool));
+      SVN_TEST_STRING_ASSERT(actual->data, contents[i]);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
 
 
+/* Return the contents of small file number I in revision REV, allocated
+   in POOL.  All these files look alike, making them good candidates for
+   dictionary compression. */
+static const char *
+dict_file_contents(int i, svn_revnum_t rev, apr_pool_t *pool)
+{
+  return apr_psprintf(pool,
+                      "/* file%d.c -- changed in r%ld */\n\n"
+                      "#include \"svn_pools.h\"\n\n"
+                      "static svn_error_t *\n"
+                      "function_%d(apr_pool_t *scratch_pool)\n"
+                      "{\n"
+                      "  apr_pool_t *iterpool = svn_pool_create(pool);\n"
+                      "  int i;\n\n"
+                      "  for (i = 0; i < %d; ++i)\n"
+                      "    SVN_ERR(do_something(i, iterpool));\n\n"
+                      "  svn_pool_destroy(iterpool);\n"
+                      "  return SVN_NO_ERROR;\n"
+                      "}\n",
+                      i, rev, i, (int)(i * rev));
+}
+
+/* Pack shards with a compression dictionary and read data compressed
+   against it. */
+#define REPO_NAME "test-repo-compression-dictionary"
+#define SHARD_SIZE 4
+#define MAX_REV 11
+#define FILE_COUNT 100
+static svn_error_t *
+compression_dictionary(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev, new_rev;
+  svn_stringbuf_t *actual;
+  svn_node_kind_t kind;
+  apr_hash_t *fs_config;
+  apr_file_t *file;
+  const char *config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support dictionaries");
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support not compiled in");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "dictionaries require logical addressing");
+
+  /* Enable zstd compression with a 4 kB dictionary in fsfs.conf. */
+  config = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+           CONFIG_OPTION_COMPRESSION " = zstd\n"
+           CONFIG_OPTION_COMPRESSION_DICTIONARY_SIZE " = 4\n";
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->compression_dict_size
+                  == 4 * 0x400);
+
+  /* Each revision changes all files.  Pack after the first shard such that
+   * the later shards get compressed against its dictionary and the last
+   * pack will have to read dictionary-compressed data. */
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      for (i = 0; i < FILE_COUNT; ++i)
+        {
+          const char *path = apr_psprintf(iterpool, "file%d.c", i);
+          if (rev == 1)
+            SVN_ERR(svn_fs_make_file(root, path, iterpool));
+          SVN_ERR(svn_test__set_file_contents(root, path,
+                                              dict_file_contents(i, rev,
+                                                                 iterpool),
+                                              iterpool));
+        }
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+      SVN_TEST_ASSERT(new_rev == rev);
+
+      if (rev == SHARD_SIZE || rev == 2 * SHARD_SIZE)
+        SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL,
+                             iterpool));
+    }
+
+  /* The first shard must have gotten a dictionary. */
+  SVN_ERR(svn_io_check_path(svn_dirent_join_many(pool, REPO_NAME,
+                                                  PATH_REVS_DIR,
+                                                  "0" PATH_EXT_PACKED_SHARD,
+                                                  PATH_COMPRESSION_DICT,
+                                                  SVN_VA_NULL),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* Read everything back using a new FS instance. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      for (i = 0; i < FILE_COUNT; ++i)
+        {
+          const char *path = apr_psprintf(iterpool, "file%d.c", i);
+          SVN_ERR(svn_test__get_file_contents(root, path, &actual,
+                                              iterpool));
+          SVN_TEST_STRING_ASSERT(actual->data,
+                                 dict_file_contents(i, rev, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+#undef FILE_COUNT
+
+/* Store large files as chunks and share them between files and revisions.
+ */
+#define REPO_NAME "test-repo-chunked-files"
+#define SHARD_SIZE 4
+static svn_error_t *
+chunked_files(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root, *root1, *root2;
+  svn_revnum_t rev, new_rev;
+  svn_stringbuf_t *contents[4], *other, *small, *actual;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  apr_hash_t *fs_config;
+  apr_finfo_t finfo;
+  apr_file_t *file;
+  const char *config;
+  fs_fs_data_t *ffd;
+  apr_uint32_t seed = 2;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support chunking");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  /* Chunk everything above 64 kB into chunks of about 4 kB. */
+  config = "[" CONFIG_SECTION_REP_SHARING "]\n"
+           CONFIG_OPTION_CHUNKING_THRESHOLD " = 64\n"
+           CONFIG_OPTION_CHUNK_SIZE " = 4\n";
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->chunking_threshold == 64 * 0x400);
+  SVN_TEST_ASSERT(ffd->chunk_size == 4 * 0x400);
+
+  /* r1: a large file.
+   * r2: some data inserted into its middle plus a new file that shares
+   *     most of its contents with r1.
+   * r3: back to r1 and a file below the threshold. */
+  contents[1] = random_text(&seed, 1024 * 1024, pool);
+  contents[2] = svn_stringbuf_dup(contents[1], pool);
+  svn_stringbuf_insert(contents[2], 300 * 1024, "inserted data", 13);
+  contents[3] = contents[1];
+  other = svn_stringbuf_dup(contents[1], pool);
+  svn_stringbuf_appendstr(other, random_text(&seed, 10 * 1024, pool));
+  small = random_text(&seed, 1024, pool);
+
+  for (rev = 1; rev <= 3; ++rev)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(root, "f", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[rev]->data,
+                                          pool));
+      if (rev == 2)
+        {
+          SVN_ERR(svn_fs_make_file(root, "g", pool));
+          SVN_ERR(svn_test__set_file_contents(root, "g", other->data,
+                                              pool));
+        }
+      if (rev == 3)
+        {
+          SVN_ERR(svn_fs_make_file(root, "h", pool));
+          SVN_ERR(svn_test__set_file_contents(root, "h", small->data,
+                                              pool));
+        }
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, pool));
+      SVN_TEST_ASSERT(new_rev == rev);
+    }
+
+  /* Most chunks of r2 must have been shared with r1. */
+  SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_rev_absolute(fs, 2, pool),
+                      APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < (apr_off_t)contents[2]->len / 4);
+
+  /* Pack the shard and read everything back using a new FS instance. */
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 1; rev <= 3; ++rev)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "f", &actual, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[rev]));
+    }
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, 3, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "g", &actual, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(actual, other));
+  SVN_ERR(svn_test__get_file_contents(root, "h", &actual, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(actual, small));
+
+  /* Deltas between revisions must be usable as well. */
+  SVN_ERR(svn_fs_revision_root(&root1, fs, 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root2, fs, 2, pool));
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, root1, "f",
+                                       root2, "f", pool));
+  actual = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(svn_stream_from_stringbuf(contents[1], pool),
+                    svn_stream_from_stringbuf(actual, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  SVN_ERR(svn_txdelta_send_txstream(delta_stream, handler, handler_baton,
+                                    pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(actual, contents[2]));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, 3, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+/* Append CONFIG to the fsfs.conf file of the repository at REPO_NAME. */
+static svn_error_t *
+append_config(const char *repo_name,
+              const char *config,
+              apr_pool_t *pool)
+{
+  apr_file_t *file;
+
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(repo_name, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-options_require_format_9"
+static svn_error_t *
+options_require_format_9(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  apr_hash_t *fs_config;
+  const char *configs[] =
+    {
+      "[" CONFIG_SECTION_DELTIFICATION "]\n"
+      CONFIG_OPTION_COMPRESSION " = lz4\n"
+      CONFIG_OPTION_LARGE_DELTA_WINDOWS " = true\n",
+
+      "[" CONFIG_SECTION_REP_SHARING "]\n"
+      CONFIG_OPTION_CHUNKING_THRESHOLD " = 1024\n",
+
+      "[" CONFIG_SECTION_DELTIFICATION "]\n"
+      CONFIG_OPTION_COMPRESSION " = zstd\n"
+    };
+  int count = svn__zstd_available() ? 3 : 2;
+  int i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support format 9");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_COMPATIBLE_VERSION, "1.14");
+
+  for (i = 0; i < count; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      /* A format 8 repository must reject the new options. */
+      SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config,
+                                   iterpool));
+      SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->format == 8);
+      SVN_ERR(append_config(REPO_NAME, configs[i], iterpool));
+      SVN_TEST_ASSERT_ERROR(svn_fs_open2(&fs, REPO_NAME, NULL, iterpool,
+                                         iterpool),
+                            SVN_ERR_BAD_CONFIG_VALUE);
+
+      /* After an upgrade, they are accepted. */
+      SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config,
+                                   iterpool));
+      SVN_ERR(svn_fs_upgrade2(REPO_NAME, NULL, NULL, NULL, NULL, iterpool));
+      SVN_ERR(append_config(REPO_NAME, configs[i], iterpool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, iterpool, iterpool));
+      SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->format
+                      == SVN_FS_FS__FORMAT_NUMBER);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+/* Replacing the index of a revision must not affect readers that have
+   the old revision file mapped into memory. */
+#define REPO_NAME "test-repo-load_index_while_mapped"
+#define SHARD_SIZE 5
+#define MAX_REV 13
+static svn_error_t *
+load_index_while_mapped(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__p2l_entry_t entry;
+  apr_array_header_t *entries = apr_array_make(pool, 16, sizeof(void *));
+  apr_array_header_t *alt_entries = apr_array_make(pool, 1, sizeof(void *));
+  apr_off_t size;
+  char *before, *after;
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(append_config(REPO_NAME,
+                        "[" CONFIG_SECTION_IO "]\n"
+                        CONFIG_OPTION_USE_MMAP " = true\n", pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  /* Map the unpacked MAX_REV and remember its contents. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, MAX_REV, pool,
+                                           pool));
+  if (!rev_file->data)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "revision files can't be mapped");
+
+  SVN_ERR(svn_fs_fs__rev_file_size(&size, rev_file, pool));
+  before = apr_palloc(pool, (apr_size_t)size);
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 0, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, before, (apr_size_t)size, NULL,
+                                   pool));
+
+  /* Replace the index with a shorter one that marks everything unused. */
+  SVN_ERR(svn_fs_fs__dump_index(fs, MAX_REV, receive_index, entries,
+                                NULL, NULL, pool));
+  entry = *APR_ARRAY_IDX(entries, entries->nelts - 1,
+                         svn_fs_fs__p2l_entry_t *);
+  entry.size += entry.offset;
+  entry.offset = 0;
+  entry.type = SVN_FS_FS__ITEM_TYPE_UNUSED;
+  entry.item.number = SVN_FS_FS__ITEM_INDEX_UNUSED;
+  entry.item.revision = SVN_INVALID_REVNUM;
+  APR_ARRAY_PUSH(alt_entries, svn_fs_fs__p2l_entry_t *) = &entry;
+  SVN_ERR(svn_fs_fs__load_index(fs, MAX_REV, alt_entries, pool));
+
+  /* The mapping must still show the complete old contents. */
+  after = apr_palloc(pool, (apr_size_t)size);
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, 0, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, after, (apr_size_t)size, NULL,
+                                   pool));
+  SVN_TEST_ASSERT(memcmp(before, after, (apr_size_t)size) == 0);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Restore the original index. */
+  SVN_ERR(svn_fs_fs__load_index(fs, MAX_REV, entries, pool));
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1943,6 +2961,28 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(pack_in_parallel,
+                       "pack multiple shards concurrently"),
+    SVN_TEST_OPTS_PASS(read_packed_fs_mmap,
+                       "read from a packed FSFS using mmap"),
+    SVN_TEST_OPTS_PASS(read_delta_chain_parallel,
+                       "reconstruct delta chains using threads"),
+    SVN_TEST_OPTS_PASS(read_growing_file_parallel,
+                       "read a growing file with delta window threads"),
+    SVN_TEST_OPTS_PASS(large_delta_windows,
+                       "deltas with large sliding source views"),
+    SVN_TEST_OPTS_PASS(zstd_combined_windows,
+                       "combine the windows of zstd deltas"),
+    SVN_TEST_OPTS_PASS(recreated_repos_disk_cache,
+                       "disk cache of a recreated repository"),
+    SVN_TEST_OPTS_PASS(compression_dictionary,
+                       "pack and read with a compression dictionary"),
+    SVN_TEST_OPTS_PASS(chunked_files,
+                       "store large files as shared chunks"),
+    SVN_TEST_OPTS_PASS(options_require_format_9,
+                       "new fsfs.conf options require format 9"),
+    SVN_TEST_OPTS_PASS(load_index_while_mapped,
+                       "replace the index of a mapped revision file"),
     SVN_TEST_NULL
   };
 
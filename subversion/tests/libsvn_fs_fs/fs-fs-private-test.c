@@ -25,6 +25,7 @@
 
 #include "../svn_test.h"
 
+#include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
@@ -36,6 +37,8 @@
 
 #include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/rep-cache.h"
+#include "../../libsvn_fs_fs/rev_file.h"
+#include "../../libsvn_fs_fs/util.h"
 #include "../../libsvn_fs/fs-loader.h"
 
 #include "../svn_test_fs.h"
@@ -424,7 +427,7 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
 
-  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE,
+  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE, 1,
                                              NULL, NULL, NULL, NULL, NULL,
                                              NULL, pool),
                         SVN_ERR_FS_INDEX_CORRUPTION);
@@ -434,7 +437,7 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   load_input.entries = entries;
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
-  SVN_ERR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE, NULL, NULL,
+  SVN_ERR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE, 1, NULL, NULL,
                                NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
@@ -500,7 +503,140 @@ build_rep_cache(const svn_test_opts_t *opts, apr_pool_t *pool)
 }
 
 
-
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-item-offsets-batch-test"
+#define MAX_REV 4
+
+static svn_error_t *
+item_offsets_batch(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  apr_file_t *file;
+  const char *config;
+  apr_array_header_t *max_ids;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have FSFS indexes");
+
+  /* Create a filesystem with tiny L2P pages, so that even small
+   * revisions need several of them. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test log addressing only");
+
+  config = "[" CONFIG_SECTION_IO "]\n" CONFIG_OPTION_L2P_PAGE_SIZE " = 4\n";
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->l2p_page_size == 4);
+
+  /* r1 is the Greek tree, the following revisions change a few nodes. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  for (rev = 1; rev < MAX_REV; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool, "r%ld", rev),
+                                          iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/pi",
+                                          apr_psprintf(iterpool, "r%ld", rev),
+                                          iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/beta",
+                                          apr_psprintf(iterpool, "r%ld", rev),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, 1, MAX_REV, pool, pool));
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_fs_fs__revision_file_t *rev_file;
+      apr_uint64_t *item_indexes;
+      apr_off_t *offsets;
+      int count, i;
+
+      svn_pool_clear(iterpool);
+
+      /* Look up all items of REV in one batch, skipping the unused
+       * item 0.  That spans several index pages. */
+      count = (int)APR_ARRAY_IDX(max_ids, rev - 1, apr_uint64_t) - 1;
+      SVN_TEST_ASSERT(count > 2 * 4);
+
+      item_indexes = apr_palloc(iterpool, count * sizeof(*item_indexes));
+      offsets = apr_palloc(iterpool, count * sizeof(*offsets));
+      for (i = 0; i < count; ++i)
+        item_indexes[i] = i + 1;
+
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rev,
+                                               iterpool, iterpool));
+      SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, rev,
+                                      item_indexes, count, iterpool));
+
+      /* The results must match those of individual lookups. */
+      for (i = 0; i < count; ++i)
+        {
+          apr_off_t offset;
+          SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL,
+                                         item_indexes[i], iterpool));
+          SVN_TEST_ASSERT(offsets[i] == offset);
+        }
+
+      /* Unsorted input is slower but still gives the same results. */
+      for (i = 0; i < count; ++i)
+        item_indexes[i] = count - i;
+
+      SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, rev,
+                                      item_indexes, count, iterpool));
+      for (i = 0; i < count; ++i)
+        {
+          apr_off_t offset;
+          SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL,
+                                         item_indexes[i], iterpool));
+          SVN_TEST_ASSERT(offsets[i] == offset);
+        }
+
+      /* Out-of-range item indexes must be detected. */
+      item_indexes[0] = count + 1;
+      SVN_TEST_ASSERT_ANY_ERROR(svn_fs_fs__item_offsets(offsets, fs,
+                                                        rev_file, rev,
+                                                        item_indexes,
+                                                        count, iterpool));
+
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+
 /* The test table.  */
 
 static int max_threads = 0;
@@ -516,6 +652,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "load the P2L index"),
     SVN_TEST_OPTS_PASS(build_rep_cache,
                        "build the representation cache"),
+    SVN_TEST_OPTS_PASS(item_offsets_batch,
+                       "batched L2P index lookups"),
     SVN_TEST_NULL
   };
 
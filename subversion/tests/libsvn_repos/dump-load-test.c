@@ -29,6 +29,7 @@
 #include "svn_fs.h"
 #include "svn_repos.h"
 #include "private/svn_repos_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -76,8 +77,9 @@ test_dump_bad_props(svn_stringbuf_t **dump_data_p,
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
 
   /* Test that a dump completes without error. */
-  SVN_ERR(svn_repos_dump_fs4(repos, stream, start_rev, end_rev,
-                             FALSE, FALSE, TRUE, TRUE,
+  SVN_ERR(svn_repos_dump_fs5(repos, stream, start_rev, end_rev,
+                             FALSE, FALSE, SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                             TRUE, TRUE,
                              notify_func, notify_baton,
                              NULL, NULL, NULL, NULL,
                              pool));
@@ -273,6 +275,80 @@ test_load_r0_mergeinfo(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Dump deltas compressed with zstd and load them again. */
+static svn_error_t *
+test_dump_load_compressed_deltas(const svn_test_opts_t *opts,
+                                 apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *dump_data = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *loaded;
+  svn_stream_t *stream;
+  int i;
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support is not available");
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-dump-zstd-1",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revisions 1 and 2: a compressible file and a small change to it. */
+  for (i = 0; i < 1000; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "This is line %d.\n", i));
+
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "/foo", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "/foo", contents->data,
+                                      pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  svn_stringbuf_appendcstr(contents, "One more line.\n");
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "/foo", contents->data,
+                                      pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Dump with compressed deltas. */
+  stream = svn_stream_from_stringbuf(dump_data, pool);
+  SVN_ERR(svn_repos_dump_fs5(repos, stream, 0, youngest_rev,
+                             TRUE, TRUE, SVN__COMPRESSION_ZSTD_DEFAULT,
+                             TRUE, TRUE, NULL, NULL, NULL, NULL, NULL, NULL,
+                             pool));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_TEST_ASSERT(strstr(dump_data->data, "SVN\x04"));
+
+  /* Load into a new repository and compare. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-dump-zstd-2",
+                                 opts, pool));
+  stream = svn_stream_from_stringbuf(dump_data, pool);
+  SVN_ERR(svn_repos_load_fs6(repos, stream,
+                             SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                             svn_repos_load_uuid_default, NULL,
+                             FALSE, FALSE, /*use_*_commit_hook*/
+                             TRUE /*validate_props*/,
+                             FALSE /*ignore_dates*/,
+                             FALSE /*normalize_props*/,
+                             NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_ERR(svn_fs_revision_root(&rev_root, svn_repos_fs(repos), youngest_rev,
+                               pool));
+  SVN_ERR(svn_test__get_file_contents(rev_root, "/foo", &loaded, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(loaded, contents));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -284,6 +360,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test dumping with r0 mergeinfo"),
     SVN_TEST_OPTS_PASS(test_load_r0_mergeinfo,
                        "test loading with r0 mergeinfo"),
+    SVN_TEST_OPTS_PASS(test_dump_load_compressed_deltas,
+                       "test dumping and loading zstd deltas"),
     SVN_TEST_NULL
   };
 
@@ -4468,6 +4468,292 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_repos_notify_func_t.  Append each verified revision to
+ * the array of svn_revnum_t given as BATON.  The end of the verification
+ * is recorded as SVN_INVALID_REVNUM. */
+static void
+record_verify_notification(void *baton,
+                           const svn_repos_notify_t *notify,
+                           apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revisions = baton;
+
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    APR_ARRAY_PUSH(revisions, svn_revnum_t) = notify->revision;
+  else if (notify->action == svn_repos_notify_verify_end)
+    APR_ARRAY_PUSH(revisions, svn_revnum_t) = SVN_INVALID_REVNUM;
+}
+
+static svn_error_t *
+test_verify_parallel(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_array_header_t *revisions;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-verify-parallel", opts,
+                                 pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Add enough revisions to keep several threads busy. */
+  for (i = 0; i < 20; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota version %d\n",
+                                                       i),
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* All revisions must be reported exactly once and in order. */
+  revisions = apr_array_make(pool, 0, sizeof(svn_revnum_t));
+  SVN_ERR(svn_repos_verify_fs4(repos, 0, youngest_rev, FALSE, FALSE, 4,
+                               record_verify_notification, revisions,
+                               NULL, NULL, NULL, NULL, pool));
+
+  SVN_TEST_INT_ASSERT(revisions->nelts, youngest_rev + 2);
+  for (i = 0; i <= youngest_rev; ++i)
+    SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t), i);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t)
+                  == SVN_INVALID_REVNUM);
+
+  return SVN_NO_ERROR;
+}
+
+/* One run of lines as reported by svn_repos_blame(). */
+typedef struct blame_run_t
+{
+  apr_int64_t start_line;
+  svn_revnum_t revision;
+} blame_run_t;
+
+/* Implements svn_repos_blame_receiver_t.  Append the run to the array of
+ * blame_run_t given as BATON. */
+static svn_error_t *
+blame_run_receiver(apr_int64_t start_line,
+                   svn_revnum_t revision,
+                   apr_hash_t *rev_props,
+                   void *baton,
+                   apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *runs = baton;
+  blame_run_t *run = apr_array_push(runs);
+
+  run->start_line = start_line;
+  run->revision = revision;
+
+  /* Only lines changed within the range get revision properties. */
+  if (SVN_IS_VALID_REVNUM(revision))
+    SVN_TEST_ASSERT(rev_props
+                    && svn_hash_gets(rev_props, SVN_PROP_REVISION_DATE));
+  else
+    SVN_TEST_ASSERT(rev_props == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Blame PATH in REPOS from START to END and compare the result with the
+ * EXPECTED runs terminated by a run with a negative start line. */
+static svn_error_t *
+check_blame(svn_repos_t *repos,
+            const char *path,
+            svn_revnum_t start,
+            svn_revnum_t end,
+            const blame_run_t *expected,
+            apr_pool_t *pool)
+{
+  apr_array_header_t *runs = apr_array_make(pool, 4, sizeof(blame_run_t));
+  int i;
+
+  SVN_ERR(svn_repos_blame(repos, path, start, end,
+                          svn_diff_file_options_create(pool), NULL, NULL,
+                          blame_run_receiver, runs, NULL, NULL, pool));
+
+  for (i = 0; expected[i].start_line >= 0; ++i)
+    {
+      SVN_TEST_ASSERT(i < runs->nelts);
+      SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(runs, i, blame_run_t).start_line,
+                          expected[i].start_line);
+      SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(runs, i, blame_run_t).revision,
+                          expected[i].revision);
+    }
+  SVN_TEST_INT_ASSERT(runs->nelts, i);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev;
+  int i;
+
+  static const blame_run_t full[] =
+    { { 0, 1 }, { 1, 3 }, { 2, 2 }, { 3, 3 }, { -1, 0 } };
+  static const blame_run_t from_r2[] =
+    { { 0, SVN_INVALID_REVNUM }, { 1, 3 }, { 2, 2 }, { 3, 3 }, { -1, 0 } };
+  static const blame_run_t from_r3[] =
+    { { 0, SVN_INVALID_REVNUM }, { 1, 3 }, { 2, SVN_INVALID_REVNUM },
+      { 3, 3 }, { -1, 0 } };
+  static const blame_run_t at_r2[] =
+    { { 0, 1 }, { 1, 2 }, { -1, 0 } };
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-blame", opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: The greek tree, with a one-line iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r2: Append two lines. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "This is the file 'iota'.\n"
+                                      "line 2\n"
+                                      "line 3\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r3: Change the second line and append another one. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "This is the file 'iota'.\n"
+                                      "changed 2\n"
+                                      "line 3\n"
+                                      "line 4\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r4: Copy iota without changing its contents. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_copy(rev_root, "iota", txn_root, "iota2", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* The history of the copy includes that of its source.  Do everything
+     twice to get the line-origin maps from the cache the second time. */
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(check_blame(repos, "/iota2", 0, youngest_rev, full, pool));
+      SVN_ERR(check_blame(repos, "/iota2", 2, youngest_rev, from_r2, pool));
+      SVN_ERR(check_blame(repos, "/iota2", 3, youngest_rev, from_r3, pool));
+      SVN_ERR(check_blame(repos, "/iota", 0, 2, at_r2, pool));
+    }
+
+  /* Blaming backwards is not supported. */
+  SVN_TEST_ASSERT_ERROR(check_blame(repos, "/iota", 2, 1, full, pool),
+                        SVN_ERR_INCORRECT_PARAMS);
+
+  return SVN_NO_ERROR;
+}
+
+/* Recreate an FSFS repository with the same path and UUID but a different
+   history.  Blame must not pick up the old line-origin maps. */
+static svn_error_t *
+test_blame_recreated_repos(const svn_test_opts_t *opts,
+                           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_file_t *file;
+  const char *cache_path;
+  const char *config;
+  const char *uuid = svn_uuid_generate(pool);
+  int i;
+
+  static const char *r2_contents[] = { "line 1\nline 2\n",
+                                       "line 0\nline 1\n" };
+  static const blame_run_t expected[][3] =
+    { { { 0, 1 }, { 1, 2 }, { -1, 0 } },
+      { { 0, 2 }, { 1, 1 }, { -1, 0 } } };
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS) != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have FS instance IDs");
+
+  /* A disk cache outside the repository, surviving its deletion. */
+  SVN_ERR(svn_dirent_get_absolute(&cache_path,
+                                  "test-repo-blame-recreated-cache", pool));
+  SVN_ERR(svn_io_remove_dir2(cache_path, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(cache_path);
+  config = apr_pstrcat(pool, "[caches]\ndisk-cache-path = ", cache_path,
+                       "\n", SVN_VA_NULL);
+
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_test__create_repos(&repos, "test-repo-blame-recreated",
+                                     opts, pool));
+      SVN_ERR(svn_io_file_open(&file,
+                               svn_dirent_join_many(pool,
+                                                    svn_repos_path(repos,
+                                                                   pool),
+                                                    "db", "fsfs.conf",
+                                                    SVN_VA_NULL),
+                               APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+      SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL,
+                                     pool));
+      SVN_ERR(svn_io_file_close(file, pool));
+
+      SVN_ERR(svn_repos_open3(&repos, svn_repos_path(repos, pool), NULL,
+                              pool, pool));
+      fs = svn_repos_fs(repos);
+      SVN_ERR(svn_fs_set_uuid(fs, uuid, pool));
+
+      /* r1: Add a file. */
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+      SVN_ERR(svn_fs_make_file(txn_root, "f", pool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "f", "line 1\n", pool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+      /* r2: Add a line, at the end or at the start. */
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "f", r2_contents[i],
+                                          pool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+      SVN_ERR(check_blame(repos, "/f", 0, youngest_rev, expected[i], pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4539,6 +4825,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_verify_parallel,
+                       "test svn_repos_verify_fs4 with multiple jobs"),
+    SVN_TEST_OPTS_PASS(test_blame,
+                       "test svn_repos_blame"),
+    SVN_TEST_OPTS_PASS(test_blame_recreated_repos,
+                       "blame in a recreated repository"),
     SVN_TEST_NULL
   };
 
@@ -26,8 +26,14 @@
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
+
+#if APR_HAS_FORK
+#include <unistd.h>   /* For _exit() */
+#endif
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "private/svn_cache.h"
 #include "svn_private_config.h"
@@ -209,7 +215,7 @@ test_membuffer_cache_basic(apr_pool_t *pool)
   svn_cache__t *cache;
   svn_membuffer_t *membuffer;
 
-  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0, 1,
                                             TRUE, TRUE, pool));
 
   /* Create a cache with just one entry. */
@@ -227,6 +233,48 @@ test_membuffer_cache_basic(apr_pool_t *pool)
   return basic_cache_test(cache, FALSE, pool);
 }
 
+static svn_error_t *
+test_membuffer_cache_sharded(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t valueA = 12345;
+  svn_revnum_t valueB = 67890;
+
+  /* Large enough for 2 shards.  Most of that memory will never be
+   * touched. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 160 * 1024 * 1024,
+                                            0, 0, 2, TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Overwriting entries must not leave outdated copies behind. */
+  SVN_ERR(svn_cache__set(cache, "key A", &valueA, pool));
+  SVN_ERR(svn_cache__set(cache, "key A", &valueB, pool));
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key A", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*value == valueB);
+
+  /* Clearing must cover all shards. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+  SVN_ERR(svn_cache__has_key(&found, cache, "key A", pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_cache__deserialize_func_t */
 static svn_error_t *
 raise_error_deserialize_func(void **out,
@@ -267,7 +315,7 @@ test_membuffer_serializer_error_handling(apr_pool_t *pool)
   svn_boolean_t found;
   void *val;
 
-  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0, 1,
                                             TRUE, TRUE, pool));
 
   /* Create a cache with just one entry. */
@@ -299,7 +347,7 @@ test_membuffer_serializer_error_handling(apr_pool_t *pool)
     APR_EGENERAL);
 
   /* Create a new cache. */
-  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0, 1,
                                             TRUE, TRUE, pool));
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
                                             membuffer,
@@ -386,7 +434,7 @@ test_membuffer_cache_clearing(apr_pool_t *pool)
   svn_revnum_t valueB = 67890;
 
   /* Create a simple cache for strings, keyed by strings. */
-  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0, 1,
                                             TRUE, TRUE, pool));
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
                                             membuffer,
@@ -504,7 +552,7 @@ test_membuffer_unaligned_string_keys(apr_pool_t *pool)
   const char *unaligned_key = apr_pstrdup(pool, "_fifty") + 1;
   const char *unaligned_prefix = apr_pstrdup(pool, "_cache:") + 1;
 
-  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0, 1,
                                             TRUE, TRUE, pool));
 
   /* Create a cache with just one entry. */
@@ -554,7 +602,7 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   const char *unaligned_key = apr_pstrdup(pool, "_12345678") + 1;
   const char *unaligned_prefix = apr_pstrdup(pool, "_cache:") + 1;
 
-  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0, 1,
                                             TRUE, TRUE, pool));
 
   /* Create a cache with just one entry. */
@@ -590,6 +638,626 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_membuffer_cache_admission(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_stringbuf_t *value = svn_stringbuf_create_ensure(1000, pool);
+  svn_stringbuf_t *answer;
+  svn_boolean_t found;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* A single-segment cache holding roughly 700 of our items. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024,
+                                            256 * 1024, 1, 1,
+                                            FALSE, FALSE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            APR_HASH_KEY_STRING, "admission",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  memset(value->data, 'x', 1000);
+  value->len = 1000;
+  value->data[value->len] = '\0';
+
+  /* Scan through far more data than the cache can hold. */
+  for (i = 0; i < 2000; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__set(cache, apr_psprintf(iterpool, "scan-%d", i),
+                             value, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  /* The scan must not have pushed out the data cached first. */
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "scan-0", pool));
+  if (!found || !svn_stringbuf_compare(answer, value))
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache lost the first item during a scan");
+
+  /* Items that have not been asked for will not be admitted. */
+  SVN_ERR(svn_cache__set(cache, "once", value, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "once", pool));
+  if (found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "one-hit wonder got admitted to a full cache");
+
+  /* Repeatedly requested items will be. */
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "hot", pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "hot", pool));
+  SVN_ERR(svn_cache__set(cache, "hot", value, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "hot", pool));
+  if (!found || !svn_stringbuf_compare(answer, value))
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache refused to admit a popular item");
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+#if APR_HAS_FORK
+  apr_proc_t proc;
+  apr_status_t status;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+#endif
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 NULL, pool);
+  if (err && (   err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE
+              || APR_STATUS_IS_ENOTIMPL(err->apr_err)))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "anonymous shared memory not supported");
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE,
+                                            pool, pool));
+
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+#if APR_HAS_FORK
+  /* Data written by a child process must be visible to its parent. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      svn_revnum_t forty = 40;
+
+      err = svn_cache__membuffer_child_init(membuffer, pool);
+      if (!err)
+        err = svn_cache__set(cache, "forty", &forty, pool);
+
+      /* Don't run the parent's pool cleanups in the child. */
+      _exit(err ? 1 : 0);
+    }
+  else if (status != APR_INPARENT)
+    {
+      return svn_error_wrap_apr(status, "apr_proc_fork");
+    }
+  else
+    {
+      int exit_code;
+      apr_exit_why_e exit_why;
+
+      status = apr_proc_wait(&proc, &exit_code, &exit_why, APR_WAIT);
+      if (!APR_STATUS_IS_CHILD_DONE(status))
+        return svn_error_wrap_apr(status, "apr_proc_wait");
+      if (!APR_PROC_CHECK_EXIT(exit_why) || exit_code != 0)
+        return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                                "child process failed to write to cache");
+    }
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "forty", pool));
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache failed to find entry written by child");
+  if (*answer != 40)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "expected 40 but found '%ld'", *answer);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Number of keys used by test_membuffer_cache_concurrent_reads. */
+#define CONCURRENT_KEY_COUNT 1000
+
+/* Number of lookups per reader thread in
+ * test_membuffer_cache_concurrent_reads. */
+#define CONCURRENT_GETS_PER_THREAD 20000
+
+/* Parameters and result of a concurrent_access_thread. */
+typedef struct concurrent_baton_t
+{
+  /* The cache back-end shared by all threads. */
+  svn_membuffer_t *membuffer;
+
+  /* If set, write the keys instead of reading them. */
+  svn_boolean_t writer;
+
+  /* Seed to vary the key access sequence between threads. */
+  apr_uint64_t seed;
+
+  /* Error returned by the thread. */
+  svn_error_t *err;
+} concurrent_baton_t;
+
+/* Perform the cache accesses as described by BATON using POOL for all
+ * allocations.  The value stored for each key is the key itself.
+ */
+static svn_error_t *
+concurrent_access(concurrent_baton_t *baton,
+                  apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+  int count = baton->writer ? CONCURRENT_GETS_PER_THREAD / 4
+                            : CONCURRENT_GETS_PER_THREAD;
+
+  /* Every thread needs its own, non-synchronized front-end instance. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            baton->membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(apr_uint64_t),
+                                            "concurrent:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_uint64_t key = (baton->seed + i * 7919) % CONCURRENT_KEY_COUNT;
+      svn_revnum_t value = (svn_revnum_t)key;
+
+      if (i % 1000 == 0)
+        svn_pool_clear(iterpool);
+
+      if (baton->writer)
+        {
+          SVN_ERR(svn_cache__set(cache, &key, &value, iterpool));
+        }
+      else
+        {
+          svn_revnum_t *found_value;
+          svn_boolean_t found;
+
+          SVN_ERR(svn_cache__get((void **) &found_value, &found, cache,
+                                 &key, iterpool));
+          if (found && *found_value != value)
+            return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "expected %ld but found %ld",
+                                     value, *found_value);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Thread function executing concurrent_access for the
+ * concurrent_baton_t given in DATA.
+ */
+static void * APR_THREAD_FUNC
+concurrent_access_thread(apr_thread_t *thread,
+                         void *data)
+{
+  concurrent_baton_t *baton = data;
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  baton->err = concurrent_access(baton, pool);
+  svn_pool_destroy(pool);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Run THREAD_COUNT reader threads and a single writer thread against
+ * MEMBUFFER and return the number of lookups per second in *RATE.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+run_concurrent_reads(double *rate,
+                     svn_membuffer_t *membuffer,
+                     int thread_count,
+                     apr_pool_t *pool)
+{
+  apr_thread_t **threads
+    = apr_pcalloc(pool, (thread_count + 1) * sizeof(*threads));
+  concurrent_baton_t *batons
+    = apr_pcalloc(pool, (thread_count + 1) * sizeof(*batons));
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_time_t start = apr_time_now();
+  apr_time_t duration;
+  int i;
+
+  for (i = 0; i <= thread_count; ++i)
+    {
+      apr_status_t status;
+
+      batons[i].membuffer = membuffer;
+      batons[i].writer = (i == thread_count);
+      batons[i].seed = i * 131;
+
+      status = apr_thread_create(&threads[i], NULL, concurrent_access_thread,
+                                 &batons[i], pool);
+      if (status)
+        return svn_error_wrap_apr(status, "Can't create thread");
+    }
+
+  for (i = 0; i <= thread_count; ++i)
+    {
+      apr_status_t retval;
+      apr_status_t status = apr_thread_join(&retval, threads[i]);
+      if (status)
+        err = svn_error_compose_create(
+                err, svn_error_wrap_apr(status, "Can't join thread"));
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  duration = MAX(apr_time_now() - start, 1);
+  *rate = (double)thread_count * CONCURRENT_GETS_PER_THREAD
+        * APR_USEC_PER_SEC / duration;
+
+  return svn_error_trace(err);
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_cache_concurrent_reads(const svn_test_opts_t *opts,
+                                      apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  apr_uint64_t key;
+  int thread_count;
+
+  /* A single segment makes all threads access the same lock & data. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 4 * 1024 * 1024, 0,
+                                            1, 1, TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(key),
+                                            "concurrent:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  /* Populate the cache. */
+  for (key = 0; key < CONCURRENT_KEY_COUNT; ++key)
+    {
+      svn_revnum_t value = (svn_revnum_t)key;
+      SVN_ERR(svn_cache__set(cache, &key, &value, pool));
+    }
+
+  /* Measure read throughput while a writer keeps modifying the cache.
+   * Invalid data returned by a lookup will make this test fail. */
+  for (thread_count = 1; thread_count <= 64; thread_count *= 2)
+    {
+      double rate;
+      apr_pool_t *iterpool = svn_pool_create(pool);
+
+      SVN_ERR(run_concurrent_reads(&rate, membuffer, thread_count,
+                                   iterpool));
+      if (opts->verbose)
+        printf("%2d threads: %.0f gets/sec\n", thread_count, rate);
+
+      svn_pool_destroy(iterpool);
+    }
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "this test requires APR thread support");
+#endif
+}
+
+static svn_error_t *
+test_disk_cache_basic(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__disk_t *disk;
+  svn_cache__disk_t *disk2;
+  const char *dir;
+  svn_stringbuf_t *text = svn_stringbuf_create("some text", pool);
+  svn_stringbuf_t *answer;
+  svn_boolean_t found;
+  int key = 42;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, "disk_cache_basic", pool));
+  SVN_ERR(svn_cache__disk_open(&disk, dir, 0x100000, pool));
+
+  SVN_ERR(svn_cache__create_disk(&cache, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", pool));
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Other cache instances on the same store see the same data as long as
+   * they use the same prefix. */
+  SVN_ERR(svn_cache__create_disk(&cache, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", pool));
+  SVN_ERR(svn_cache__has_key(&found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(found);
+
+  SVN_ERR(svn_cache__create_disk(&cache, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "other:", pool));
+  SVN_ERR(svn_cache__has_key(&found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  /* Opening the same directory again returns the same store. */
+  SVN_ERR(svn_cache__disk_open(&disk2, dir, 0x100000, pool));
+  SVN_TEST_ASSERT(disk == disk2);
+
+  /* Values without serializer are stringbufs. */
+  SVN_ERR(svn_cache__create_disk(&cache, disk, NULL, NULL, sizeof(key),
+                                 "text:", pool));
+  SVN_ERR(svn_cache__set(cache, &key, text, pool));
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &key, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(answer->data, text->data);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_disk_cache_overflow(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__disk_t *disk;
+  const char *dir;
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *answer;
+  svn_boolean_t found;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, "disk_cache_overflow", pool));
+  SVN_ERR(svn_cache__disk_open(&disk, dir, 4096, pool));
+  SVN_ERR(svn_cache__create_disk(&cache, disk, NULL, NULL, sizeof(i),
+                                 "cache:", pool));
+
+  svn_stringbuf_appendfill(text, 'x', 300);
+
+  /* Writing way more data than fits must reset the store from time to
+   * time but always keep the latest entry. */
+  for (i = 0; i < 100; ++i)
+    {
+      svn_pool_clear(iterpool);
+      text->data[0] = (char)('a' + i % 26);
+
+      SVN_ERR(svn_cache__set(cache, &i, text, iterpool));
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &i,
+                             iterpool));
+      SVN_TEST_ASSERT(found);
+      SVN_TEST_STRING_ASSERT(answer->data, text->data);
+    }
+
+  /* Large items are not accepted. */
+  SVN_TEST_ASSERT(!svn_cache__is_cachable(cache, 4096));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_disk_cache_reopen(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__disk_t *disk;
+  const char *dir;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+  apr_pool_t *store_pool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, "disk_cache_reopen", pool));
+  SVN_ERR(svn_cache__disk_open_private(&disk, dir, 0x100000, store_pool,
+                                       pool));
+  SVN_ERR(svn_cache__create_disk(&cache, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", store_pool));
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Close the store and open it again from what is on disk. */
+  svn_pool_destroy(store_pool);
+  store_pool = svn_pool_create(pool);
+  SVN_ERR(svn_cache__disk_open_private(&disk, dir, 0x100000, store_pool,
+                                       pool));
+  SVN_ERR(svn_cache__create_disk(&cache, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", store_pool));
+
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 20);
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "thirty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 30);
+
+  svn_pool_destroy(store_pool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_disk_cache_two_stores(apr_pool_t *pool)
+{
+  svn_cache__t *first;
+  svn_cache__t *second;
+  svn_cache__disk_t *disk;
+  const char *dir;
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *answer;
+  svn_boolean_t found;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Two independent stores on the same file, as if used by two
+   * processes. */
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, "disk_cache_two_stores", pool));
+  SVN_ERR(svn_cache__disk_open_private(&disk, dir, 4096, pool, pool));
+  SVN_ERR(svn_cache__create_disk(&first, disk, NULL, NULL, sizeof(i),
+                                 "cache:", pool));
+  SVN_ERR(svn_cache__disk_open_private(&disk, dir, 4096, pool, pool));
+  SVN_ERR(svn_cache__create_disk(&second, disk, NULL, NULL, sizeof(i),
+                                 "cache:", pool));
+
+  svn_stringbuf_appendfill(text, 'x', 300);
+
+  /* Each store sees what the other one wrote, even after the other
+   * store had to truncate the log. */
+  for (i = 0; i < 50; ++i)
+    {
+      svn_cache__t *writer = i % 2 ? first : second;
+      svn_cache__t *reader = i % 2 ? second : first;
+
+      svn_pool_clear(iterpool);
+      text->data[0] = (char)('a' + i % 26);
+
+      SVN_ERR(svn_cache__set(writer, &i, text, iterpool));
+      SVN_ERR(svn_cache__get((void **)&answer, &found, reader, &i,
+                             iterpool));
+      SVN_TEST_ASSERT(found);
+      SVN_TEST_STRING_ASSERT(answer->data, text->data);
+    }
+
+  /* Entries that got dropped by truncation are misses in both stores. */
+  i = 0;
+  SVN_ERR(svn_cache__get((void **)&answer, &found, first, &i, iterpool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **)&answer, &found, second, &i, iterpool));
+  SVN_TEST_ASSERT(!found);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_disk_cache_truncated(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__t *other;
+  svn_cache__disk_t *disk;
+  const char *dir;
+  apr_file_t *file;
+  apr_off_t size;
+  svn_revnum_t *answer;
+  svn_revnum_t value = 42;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, "disk_cache_truncated", pool));
+  SVN_ERR(svn_cache__disk_open_private(&disk, dir, 0x100000, pool, pool));
+  SVN_ERR(svn_cache__create_disk(&cache, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", pool));
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Cut the last record short underneath the open cache. */
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(dir, "data", pool),
+                           APR_READ | APR_WRITE, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_size_get(&size, file, pool));
+  SVN_ERR(svn_io_file_trunc(file, size - 1, pool));
+
+  /* That is a miss, not an error.  The intact first record is still
+   * there. */
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "thirty", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 20);
+
+  /* Empty the log and let some other store write a different record in
+   * the same place.  Our cache must find that one and drop the rest. */
+  SVN_ERR(svn_io_file_trunc(file, 0, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_cache__disk_open_private(&disk, dir, 0x100000, pool, pool));
+  SVN_ERR(svn_cache__create_disk(&other, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", pool));
+  SVN_ERR(svn_cache__set(other, "forty", &value, pool));
+
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "forty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 42);
+
+  /* New entries work as usual. */
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_tiered_cache(apr_pool_t *pool)
+{
+  svn_cache__t *first;
+  svn_cache__t *second;
+  svn_cache__t *cache;
+  svn_cache__disk_t *disk;
+  const char *dir;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, "tiered_cache", pool));
+  SVN_ERR(svn_cache__disk_open(&disk, dir, 0x100000, pool));
+
+  /* A first level with just one entry. */
+  SVN_ERR(svn_cache__create_inprocess(&first,
+                                      serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING,
+                                      1,
+                                      1,
+                                      TRUE,
+                                      "",
+                                      pool));
+  SVN_ERR(svn_cache__create_disk(&second, disk,
+                                 serialize_revnum, deserialize_revnum,
+                                 APR_HASH_KEY_STRING, "cache:", pool));
+  SVN_ERR(svn_cache__create_tiered(&cache, first, second, pool));
+
+  /* The second level keeps what the first level drops. */
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  SVN_ERR(svn_cache__get((void **)&answer, &found, first, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 20);
+
+  /* That lookup promoted "twenty" back into the first level. */
+  SVN_ERR(svn_cache__get((void **)&answer, &found, first, "twenty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 20);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -606,6 +1274,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "memcache svn_cache with very long keys"),
     SVN_TEST_PASS2(test_membuffer_cache_basic,
                    "basic membuffer svn_cache test"),
+    SVN_TEST_PASS2(test_membuffer_cache_sharded,
+                   "sharded membuffer svn_cache test"),
     SVN_TEST_PASS2(test_membuffer_serializer_error_handling,
                    "test for error handling in membuffer svn_cache"),
     SVN_TEST_PASS2(test_membuffer_cache_clearing,
@@ -616,6 +1286,24 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_cache_admission,
+                   "test membuffer cache admission policy"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "test membuffer cache in shared memory"),
+    SVN_TEST_OPTS_PASS(test_membuffer_cache_concurrent_reads,
+                       "concurrent membuffer cache reads and writes"),
+    SVN_TEST_PASS2(test_disk_cache_basic,
+                   "basic disk svn_cache test"),
+    SVN_TEST_PASS2(test_disk_cache_overflow,
+                   "disk svn_cache exceeding its size limit"),
+    SVN_TEST_PASS2(test_disk_cache_reopen,
+                   "reopen a disk svn_cache store"),
+    SVN_TEST_PASS2(test_disk_cache_two_stores,
+                   "two disk svn_cache stores sharing a file"),
+    SVN_TEST_PASS2(test_disk_cache_truncated,
+                   "disk svn_cache data truncated while in use"),
+    SVN_TEST_PASS2(test_tiered_cache,
+                   "tiered svn_cache test"),
     SVN_TEST_NULL
   };
 
@@ -27,6 +27,10 @@
 
 #include "svn_error.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
+#include "private/svn_adler32.h"
+#include "private/svn_cpu.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -364,6 +368,174 @@ test_checksummed_stream_reset(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return LEN bytes of pseudo-random data allocated in POOL. */
+static const char *
+random_data(apr_size_t len,
+            apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len);
+  apr_uint32_t seed = 0x12345678;
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      data[i] = (char)(seed >> 16);
+    }
+
+  return data;
+}
+
+static svn_error_t *
+test_sha1_implementations(apr_pool_t *pool)
+{
+  /* Test vectors from FIPS 180.  The second one needs two padding blocks. */
+  static const struct
+    {
+      const char *data;
+      const char *digest;
+    } vectors[] =
+    {
+      { "abc", "a9993e364706816aba3e25717850c26c9cd0d89d" },
+      { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+      { NULL, NULL }
+    };
+  apr_size_t len = 100000;
+  const char *data = random_data(len, pool);
+  svn_checksum_t *expected = NULL;
+  int i;
+
+  for (i = 0; vectors[i].data; ++i)
+    {
+      svn_checksum_t *checksum;
+
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, vectors[i].data,
+                           strlen(vectors[i].data), pool));
+      SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring(checksum, pool),
+                             vectors[i].digest);
+    }
+
+  /* All implementations must produce the same results, no matter how
+     the data gets split. */
+  for (i = 0; i < 2; ++i)
+    {
+      svn_checksum_ctx_t *ctx;
+      svn_checksum_t *checksum;
+      apr_size_t offset, step;
+
+      svn_cpu__set_features_mask(i ? ~(apr_uint32_t)0 : 0);
+
+      ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+      for (offset = 0, step = 1; offset < len; offset += step, step += 7)
+        SVN_ERR(svn_checksum_update(ctx, data + offset,
+                                    MIN(step, len - offset)));
+      SVN_ERR(svn_checksum_final(&checksum, ctx, pool));
+
+      if (expected)
+        SVN_TEST_ASSERT(svn_checksum_match(expected, checksum));
+      expected = checksum;
+
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, data, len, pool));
+      SVN_TEST_ASSERT(svn_checksum_match(expected, checksum));
+    }
+
+  svn_cpu__set_features_mask(~(apr_uint32_t)0);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_md5_sha1_ctx(apr_pool_t *pool)
+{
+  apr_size_t len = 100000;
+  const char *data = random_data(len, pool);
+  svn_checksum_t *expected_md5, *expected_sha1;
+  svn_checksum_t *md5, *sha1;
+  svn_checksum__md5_sha1_ctx_t *ctx;
+
+  SVN_ERR(svn_checksum(&expected_md5, svn_checksum_md5, data, len, pool));
+  SVN_ERR(svn_checksum(&expected_sha1, svn_checksum_sha1, data, len, pool));
+
+  /* Feed the data in pieces larger than the internal block size and
+     restart once. */
+  ctx = svn_checksum__md5_sha1_ctx_create(TRUE, pool);
+  SVN_ERR(svn_checksum__md5_sha1_update(ctx, data, 1000));
+  svn_checksum__md5_sha1_ctx_reset(ctx);
+  SVN_ERR(svn_checksum__md5_sha1_update(ctx, data, 12345));
+  SVN_ERR(svn_checksum__md5_sha1_update(ctx, data + 12345, len - 12345));
+  SVN_ERR(svn_checksum__md5_sha1_final(&md5, &sha1, ctx, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(expected_md5, md5));
+  SVN_TEST_ASSERT(svn_checksum_match(expected_sha1, sha1));
+
+  /* Finalizing must not change the context. */
+  SVN_ERR(svn_checksum__md5_sha1_final(&md5, &sha1, ctx, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(expected_md5, md5));
+  SVN_TEST_ASSERT(svn_checksum_match(expected_sha1, sha1));
+
+  /* MD5 only. */
+  ctx = svn_checksum__md5_sha1_ctx_create(FALSE, pool);
+  SVN_ERR(svn_checksum__md5_sha1_update(ctx, data, len));
+  SVN_ERR(svn_checksum__md5_sha1_final(&md5, &sha1, ctx, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(expected_md5, md5));
+  SVN_TEST_ASSERT(sha1 == NULL);
+
+  /* Stream wrapper. */
+  {
+    svn_stringbuf_t *target = svn_stringbuf_create_empty(pool);
+    svn_stream_t *stream;
+
+    stream = svn_checksum__wrap_write_stream_md5_sha1(
+                 &md5, &sha1, svn_stream_from_stringbuf(target, pool), pool);
+    SVN_ERR(svn_stream_write(stream, data, &len));
+    SVN_ERR(svn_stream_close(stream));
+
+    SVN_TEST_INT_ASSERT(target->len, len);
+    SVN_TEST_ASSERT(svn_checksum_match(expected_md5, md5));
+    SVN_TEST_ASSERT(svn_checksum_match(expected_sha1, sha1));
+  }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_adler32_implementations(apr_pool_t *pool)
+{
+  /* All CPU-specific variants and the portable code. */
+  static const apr_uint32_t masks[] = { 0, SVN_CPU__SSSE3, ~(apr_uint32_t)0 };
+  apr_size_t size = 100000;
+  const char *data = random_data(size, pool);
+  char *all_ones = apr_palloc(pool, size);
+  int i;
+
+  /* This maximizes the intermediate sums. */
+  memset(all_ones, 0xff, size);
+
+  for (i = 0; i < sizeof(masks) / sizeof(masks[0]); ++i)
+    {
+      apr_size_t len;
+
+      svn_cpu__set_features_mask(masks[i]);
+
+      /* Short and long runs at various alignments and start values. */
+      for (len = 0; len < size; len = len < 300 ? len + 1 : len * 3)
+        {
+          apr_size_t offset = len % 17;
+          apr_uint32_t start = len % 2 ? 1 : 0xfff0fff0;
+          apr_size_t to_check = MIN(len, size - offset);
+
+          SVN_TEST_INT_ASSERT(svn__adler32(start, data + offset, to_check),
+                              adler32(start, (const Bytef *)data + offset,
+                                      (uInt)to_check));
+        }
+
+      SVN_TEST_INT_ASSERT(svn__adler32(1, all_ones, size),
+                          adler32(1, (const Bytef *)all_ones, (uInt)size));
+    }
+
+  svn_cpu__set_features_mask(~(apr_uint32_t)0);
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -389,6 +561,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "read from checksummed stream"),
     SVN_TEST_PASS2(test_checksummed_stream_reset,
                    "reset checksummed stream"),
+    SVN_TEST_PASS2(test_sha1_implementations,
+                   "SHA1 implementations"),
+    SVN_TEST_PASS2(test_md5_sha1_ctx,
+                   "combined MD5 and SHA1 calculation"),
+    SVN_TEST_PASS2(test_adler32_implementations,
+                   "Adler-32 implementations"),
     SVN_TEST_NULL
   };
 
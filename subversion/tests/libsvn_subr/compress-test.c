@@ -76,6 +76,151 @@ test_compress_lz4_empty(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_compress_zstd(apr_pool_t *pool)
+{
+  const char input[] =
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb"
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb"
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb";
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+  int level;
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support not compiled in");
+
+  for (level = SVN__COMPRESSION_NONE;
+       level <= SVN__COMPRESSION_ZSTD_MAX;
+       ++level)
+    {
+      SVN_ERR(svn__compress_zstd(input, sizeof(input), compressed, level));
+      if (level != SVN__COMPRESSION_NONE)
+        SVN_TEST_ASSERT(compressed->len < sizeof(input));
+
+      SVN_ERR(svn__decompress_zstd(compressed->data, compressed->len,
+                                   decompressed, 100));
+      SVN_TEST_INT_ASSERT(decompressed->len, sizeof(input));
+      SVN_TEST_STRING_ASSERT(decompressed->data, input);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compress_zstd_empty(apr_pool_t *pool)
+{
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support not compiled in");
+
+  SVN_ERR(svn__compress_zstd("", 0, compressed,
+                             SVN__COMPRESSION_ZSTD_DEFAULT));
+  SVN_ERR(svn__decompress_zstd(compressed->data, compressed->len,
+                               decompressed, 100));
+  SVN_TEST_STRING_ASSERT(decompressed->data, "");
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_decompress_zstd_limit(apr_pool_t *pool)
+{
+  const char input[] =
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb"
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb";
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support not compiled in");
+
+  /* Decompressing more than LIMIT bytes must fail. */
+  SVN_ERR(svn__compress_zstd(input, sizeof(input), compressed,
+                             SVN__COMPRESSION_ZSTD_DEFAULT));
+  SVN_TEST_ASSERT_ERROR(svn__decompress_zstd(compressed->data,
+                                             compressed->len,
+                                             decompressed, 10),
+                        SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA);
+
+  /* Truncated data must be detected. */
+  SVN_TEST_ASSERT_ANY_ERROR(svn__decompress_zstd(compressed->data,
+                                                 compressed->len - 1,
+                                                 decompressed, 100));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compress_zstd_dict(apr_pool_t *pool)
+{
+  apr_array_header_t *samples = apr_array_make(pool, 500,
+                                               sizeof(svn_string_t *));
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *dict_data;
+  svn__zstd_dict_t *dict;
+  const char *input;
+  apr_size_t plain_len;
+  int i;
+
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support not compiled in");
+
+  for (i = 0; i < 500; ++i)
+    APR_ARRAY_PUSH(samples, svn_string_t *)
+      = svn_string_createf(pool,
+                           "<entry name=\"file%d\" kind=\"file\">\n"
+                           "  <commit revision=\"%d\">\n"
+                           "    <author>user%d</author>\n"
+                           "  </commit>\n"
+                           "</entry>\n", i, i * 7, i % 13);
+
+  SVN_ERR(svn__zstd_train_dict(&dict_data, samples, 4096, 0x8005,
+                               pool, pool));
+  SVN_TEST_ASSERT(dict_data != NULL);
+  SVN_TEST_ASSERT(dict_data->len <= 4096);
+
+  SVN_ERR(svn__zstd_dict_create(&dict,
+                                svn_string_ncreate(dict_data->data,
+                                                   dict_data->len, pool),
+                                SVN__COMPRESSION_ZSTD_DEFAULT, pool));
+  SVN_TEST_INT_ASSERT(svn__zstd_dict_id(dict), 0x8005);
+
+  /* Data similar to the samples must compress better with the dictionary
+   * and the compressed data must reference it. */
+  input = "<entry name=\"file4711\" kind=\"file\">\n"
+          "  <commit revision=\"42\">\n"
+          "    <author>user3</author>\n"
+          "  </commit>\n"
+          "</entry>\n";
+  SVN_ERR(svn__compress_zstd(input, strlen(input), compressed,
+                             SVN__COMPRESSION_ZSTD_DEFAULT));
+  plain_len = compressed->len;
+  SVN_ERR(svn__compress_zstd_dict(input, strlen(input), compressed, dict));
+  SVN_TEST_ASSERT(compressed->len < plain_len);
+  SVN_TEST_INT_ASSERT(svn__zstd_get_dict_id(compressed->data,
+                                            compressed->len),
+                      0x8005);
+
+  SVN_ERR(svn__decompress_zstd_dict(compressed->data, compressed->len,
+                                    decompressed, 1000, dict));
+  SVN_TEST_STRING_ASSERT(decompressed->data, input);
+
+  /* Without the dictionary, decompression must fail. */
+  SVN_TEST_ASSERT_ANY_ERROR(svn__decompress_zstd(compressed->data,
+                                                 compressed->len,
+                                                 decompressed, 1000));
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = -1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -87,6 +232,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                  "test svn__compress_lz4()"),
   SVN_TEST_PASS2(test_compress_lz4_empty,
                  "test svn__compress_lz4() with empty input"),
+  SVN_TEST_PASS2(test_compress_zstd,
+                 "test svn__compress_zstd()"),
+  SVN_TEST_PASS2(test_compress_zstd_empty,
+                 "test svn__compress_zstd() with empty input"),
+  SVN_TEST_PASS2(test_decompress_zstd_limit,
+                 "test svn__decompress_zstd() with invalid input"),
+  SVN_TEST_PASS2(test_compress_zstd_dict,
+                 "test zstd compression with a dictionary"),
   SVN_TEST_NULL
 };
 
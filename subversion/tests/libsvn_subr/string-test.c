@@ -40,6 +40,7 @@
 #include "svn_error.h"
 #include "svn_sorts.h"    /* MIN / MAX */
 #include "svn_string.h"   /* This includes <apr_*.h> */
+#include "private/svn_cpu.h"
 #include "private/svn_string_private.h"
 
 /* A quick way to create error messages.  */
@@ -872,6 +873,47 @@ test_string_matching(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_string_matching_long(apr_pool_t *pool)
+{
+  /* Long enough to cover all vector sizes plus a scalar tail. */
+  enum { LEN = 100 };
+  char a[LEN];
+  char b[LEN];
+  apr_size_t len, mismatch;
+
+  memset(a, 'x', LEN);
+  for (len = 0; len <= LEN; ++len)
+    for (mismatch = 0; mismatch <= len; ++mismatch)
+      {
+        apr_size_t match_len, rmatch_len;
+        apr_size_t match_len_plain, rmatch_len_plain;
+
+        /* Place a single mismatch at offset MISMATCH, if < LEN. */
+        memset(b, 'x', LEN);
+        if (mismatch < len)
+          b[mismatch] = 'y';
+
+        match_len = svn_cstring__match_length(a, b, len);
+        rmatch_len = svn_cstring__reverse_match_length(a + len, b + len, len);
+
+        /* The portable code must produce the same results. */
+        svn_cpu__set_features_mask(0);
+        match_len_plain = svn_cstring__match_length(a, b, len);
+        rmatch_len_plain = svn_cstring__reverse_match_length(a + len,
+                                                             b + len, len);
+        svn_cpu__set_features_mask(~(apr_uint32_t)0);
+
+        SVN_TEST_ASSERT(match_len == mismatch);
+        SVN_TEST_ASSERT(rmatch_len == (mismatch < len ? len - mismatch - 1
+                                                      : len));
+        SVN_TEST_ASSERT(match_len == match_len_plain);
+        SVN_TEST_ASSERT(rmatch_len == rmatch_len_plain);
+      }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_cstring_skip_prefix(apr_pool_t *pool)
 {
@@ -1141,6 +1183,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test string similarity scores"),
     SVN_TEST_PASS2(test_string_matching,
                    "test string matching"),
+    SVN_TEST_PASS2(test_string_matching_long,
+                   "test string matching on longer strings"),
     SVN_TEST_PASS2(test_cstring_skip_prefix,
                    "test svn_cstring_skip_prefix()"),
     SVN_TEST_PASS2(test_stringbuf_replace_all,
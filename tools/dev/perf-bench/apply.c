@@ -0,0 +1,277 @@
+/*
+ * apply.c:  measure the application of delta windows
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench apply [FILE...]
+ *
+ * Report the throughput in MB of target data per second of applying
+ * delta windows with svn_txdelta_apply_instructions() and with
+ * svn_txdelta__apply_window().  Without arguments, synthetic windows
+ * dominated by short instructions, by overlapping target copies (runs)
+ * and by long instructions are used.  Otherwise, the windows of each
+ * FILE are taken from the delta against an edited version of it and
+ * from the delta against the empty file.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_delta.h"
+#include "svn_sorts.h"
+
+#include "private/svn_delta_private.h"
+#include "private/svn_string_private.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Size of the source and target views of synthetic windows. */
+#define SYNTHETIC_SIZE (100 * 1024)
+
+/* Apply each set of windows until this many bytes have been produced. */
+#define TARGET_VOLUME (256 * 1024 * 1024)
+
+/* Return a synthetic window with a target view of SYNTHETIC_SIZE bytes
+ * that applies to SOURCE.  Its instructions are between 1 and MAX_LEN
+ * bytes long.  If RUNS is set, most of them are target copies that
+ * overlap with their own output.  Allocate the result in POOL. */
+static svn_txdelta_window_t *
+make_synthetic_window(const svn_stringbuf_t *source,
+                      apr_size_t max_len,
+                      svn_boolean_t runs,
+                      apr_pool_t *pool)
+{
+  apr_array_header_t *ops = apr_array_make(pool, 1024,
+                                           sizeof(svn_txdelta_op_t));
+  svn_txdelta_window_t *window = apr_pcalloc(pool, sizeof(*window));
+  svn_stringbuf_t *new_data = svn_stringbuf_create_empty(pool);
+  apr_uint32_t seed = (apr_uint32_t)max_len;
+  apr_size_t tpos = 0;
+
+  while (tpos < SYNTHETIC_SIZE)
+    {
+      svn_txdelta_op_t op;
+      apr_uint32_t kind = perf_bench__random(&seed) % 8;
+
+      op.length = MIN(1 + perf_bench__random(&seed) % max_len,
+                      SYNTHETIC_SIZE - tpos);
+      if (tpos > 0 && (runs ? kind < 6 : kind == 0))
+        {
+          /* Overlapping target copies repeat a short pattern. */
+          apr_size_t distance = 1 + perf_bench__random(&seed)
+                                    % (runs ? 16 : 256);
+          op.action_code = svn_txdelta_target;
+          op.offset = tpos - MIN(distance, tpos);
+        }
+      else if (kind < 7)
+        {
+          op.action_code = svn_txdelta_source;
+          op.offset = perf_bench__random(&seed)
+                      % (source->len - op.length + 1);
+          ++window->src_ops;
+        }
+      else
+        {
+          op.action_code = svn_txdelta_new;
+          op.offset = new_data->len;
+          svn_stringbuf_appendbytes(new_data, source->data + tpos % 1024,
+                                    MIN(op.length, 1024));
+          op.length = MIN(op.length, 1024);
+        }
+
+      APR_ARRAY_PUSH(ops, svn_txdelta_op_t) = op;
+      tpos += op.length;
+    }
+
+  window->sview_len = source->len;
+  window->tview_len = tpos;
+  window->num_ops = ops->nelts;
+  window->ops = (const svn_txdelta_op_t *)ops->elts;
+  window->new_data = svn_stringbuf__morph_into_string(new_data);
+
+  return window;
+}
+
+/* Benchmark applying WINDOWS to SOURCE, called NAME, and print the
+ * results.  If TARGET is not NULL, the windows must produce it when
+ * applied in order. */
+static svn_error_t *
+bench_windows(const char *name,
+              const apr_array_header_t *windows,
+              const svn_stringbuf_t *source,
+              const svn_stringbuf_t *target,
+              apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *output;
+  apr_size_t tview_len = 0;
+  apr_size_t ops = 0;
+  apr_time_t best[2];
+  int repeat, mode, i, k;
+
+  for (i = 0; i < windows->nelts; ++i)
+    {
+      svn_txdelta_window_t *window
+        = APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *);
+
+      tview_len += window->tview_len;
+      ops += window->num_ops;
+    }
+
+  repeat = (int)MAX(TARGET_VOLUME / MAX(tview_len, 1), 1);
+  output = svn_stringbuf_create_ensure(tview_len + SVN_TXDELTA__APPLY_PADDING,
+                                       scratch_pool);
+
+  for (mode = 0; mode < 2; ++mode)
+    {
+      best[mode] = APR_INT64_MAX;
+      for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+        {
+          apr_time_t start = apr_time_now();
+          apr_time_t usecs;
+
+          for (k = 0; k < repeat; ++k)
+            {
+              int w;
+
+              output->len = 0;
+              for (w = 0; w < windows->nelts; ++w)
+                {
+                  svn_txdelta_window_t *window
+                    = APR_ARRAY_IDX(windows, w, svn_txdelta_window_t *);
+                  const char *sbuf = source->data + window->sview_offset;
+                  char *tbuf = output->data + output->len;
+
+                  if (mode == 0)
+                    {
+                      apr_size_t len = window->tview_len;
+                      svn_txdelta_apply_instructions(window, sbuf, tbuf,
+                                                     &len);
+                    }
+                  else
+                    {
+                      SVN_ERR(svn_txdelta__apply_window(
+                                window, sbuf, window->sview_len, tbuf,
+                                output->blocksize - output->len));
+                    }
+
+                  output->len += window->tview_len;
+                }
+            }
+
+          usecs = apr_time_now() - start;
+          if (usecs < best[mode])
+            best[mode] = usecs;
+        }
+
+      /* Make sure that we actually reconstruct the target. */
+      output->data[output->len] = '\0';
+      if (target && !svn_stringbuf_compare(output, target))
+        return svn_error_createf(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                                 "Applying the windows of %s failed", name);
+    }
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%-30s %7" APR_SIZE_T_FMT " ops  %8.1f MB/s"
+                             "  %8.1f MB/s (apply_window)\n",
+                             name, ops,
+                             perf_bench__per_second((double)tview_len * repeat
+                                                      / 1e6,
+                                                    best[0]),
+                             perf_bench__per_second((double)tview_len * repeat
+                                                      / 1e6,
+                                                    best[1])));
+
+  return SVN_NO_ERROR;
+}
+
+/* Benchmark a single synthetic window called NAME with instructions of
+ * up to MAX_LEN bytes, and mostly runs if RUNS is set. */
+static svn_error_t *
+bench_synthetic(const char *name,
+                apr_size_t max_len,
+                svn_boolean_t runs,
+                apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *source = perf_bench__random_data(SYNTHETIC_SIZE, 42,
+                                                    scratch_pool);
+  apr_array_header_t *windows = apr_array_make(scratch_pool, 1,
+                                               sizeof(svn_txdelta_window_t *));
+
+  APR_ARRAY_PUSH(windows, svn_txdelta_window_t *)
+    = make_synthetic_window(source, max_len, runs, scratch_pool);
+
+  return svn_error_trace(bench_windows(name, windows, source, NULL,
+                                       scratch_pool));
+}
+
+/* Benchmark the windows taken from CONTENTS of a file called NAME.
+ * Implements perf_bench__corpus_func_t. */
+static svn_error_t *
+bench_file(const char *name,
+           svn_stringbuf_t *contents,
+           apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *windows;
+  svn_stringbuf_t *empty = svn_stringbuf_create_empty(scratch_pool);
+  svn_stringbuf_t *next;
+  apr_uint32_t seed = 1234;
+
+  next = perf_bench__next_version(contents, 1 + (int)(contents->len / 4096),
+                                  &seed, scratch_pool);
+  windows = apr_array_make(scratch_pool, 16, sizeof(svn_txdelta_window_t *));
+  SVN_ERR(perf_bench__collect_windows(windows, contents, next,
+                                      scratch_pool));
+  SVN_ERR(bench_windows(apr_pstrcat(scratch_pool, name, " (edited)",
+                                    SVN_VA_NULL),
+                        windows, contents, next, scratch_pool));
+
+  windows = apr_array_make(scratch_pool, 16, sizeof(svn_txdelta_window_t *));
+  SVN_ERR(perf_bench__collect_windows(windows, empty, contents,
+                                      scratch_pool));
+  SVN_ERR(bench_windows(apr_pstrcat(scratch_pool, name, " (self)",
+                                    SVN_VA_NULL),
+                        windows, empty, contents, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__apply(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool;
+
+  if (argc > 0)
+    return svn_error_trace(perf_bench__run_files(argc, argv, bench_file,
+                                                 pool));
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(bench_synthetic("short ops", 16, FALSE, iterpool));
+  svn_pool_clear(iterpool);
+  SVN_ERR(bench_synthetic("medium ops", 64, FALSE, iterpool));
+  svn_pool_clear(iterpool);
+  SVN_ERR(bench_synthetic("runs", 256, TRUE, iterpool));
+  svn_pool_clear(iterpool);
+  SVN_ERR(bench_synthetic("long ops", 4096, FALSE, iterpool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
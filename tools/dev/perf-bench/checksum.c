@@ -0,0 +1,233 @@
+/*
+ * checksum.c:  measure the throughput of the checksum functions
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench checksum [FILE]
+ *
+ * Report the throughput in MB/s of the checksum functions used in the
+ * delta, diff and repository code, once with all CPU-specific code paths
+ * enabled and once with the portable implementation only.  Every function
+ * gets called for blocks of various sizes.  The data is taken from FILE
+ * or, without arguments, generated at random.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_checksum.h"
+
+#include "private/svn_adler32.h"
+#include "private/svn_cpu.h"
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Size of the generated data. */
+#define SYNTHETIC_SIZE (1024 * 1024)
+
+/* Checksum this many bytes per measurement. */
+#define VOLUME (256 * 1024 * 1024)
+
+/* Results of all checksum calculations get added here, so the compiler
+ * can't optimize them away. */
+static volatile apr_uint32_t result_sink = 0;
+
+/* The checksum functions that we measure. */
+typedef enum kernel_t
+{
+  kernel_adler32,
+  kernel_fnv1a_32,
+  kernel_fnv1a_32x4,
+  kernel_md5,
+  kernel_sha1,
+  kernel_md5_and_sha1,
+  kernel_md5_sha1,
+  kernel_count
+} kernel_t;
+
+/* Names of the kernels, indexed by kernel_t. */
+static const char *kernel_names[kernel_count] =
+  {
+    "Adler-32",
+    "FNV-1a",
+    "FNV-1a x4",
+    "MD5",
+    "SHA1",
+    "MD5, SHA1 separately",
+    "MD5 and SHA1 in one pass"
+  };
+
+/* Calculate the checksum KERNEL over LEN bytes at DATA and return some
+ * part of it in *RESULT.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_kernel(apr_uint32_t *result,
+           kernel_t kernel,
+           const char *data,
+           apr_size_t len,
+           apr_pool_t *scratch_pool)
+{
+  svn_checksum_t *checksum;
+  svn_checksum_t *sha1;
+  svn_checksum__md5_sha1_ctx_t *ctx;
+
+  switch (kernel)
+    {
+      case kernel_adler32:
+        *result = svn__adler32(0, data, len);
+        break;
+
+      case kernel_fnv1a_32:
+        *result = svn__fnv1a_32(data, len);
+        break;
+
+      case kernel_fnv1a_32x4:
+        *result = svn__fnv1a_32x4(data, len);
+        break;
+
+      case kernel_md5:
+      case kernel_sha1:
+        SVN_ERR(svn_checksum(&checksum,
+                             kernel == kernel_md5 ? svn_checksum_md5
+                                                  : svn_checksum_sha1,
+                             data, len, scratch_pool));
+        *result = checksum->digest[0];
+        break;
+
+      case kernel_md5_and_sha1:
+        SVN_ERR(svn_checksum(&checksum, svn_checksum_md5, data, len,
+                             scratch_pool));
+        SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, data, len,
+                             scratch_pool));
+        *result = checksum->digest[0] + sha1->digest[0];
+        break;
+
+      case kernel_md5_sha1:
+        ctx = svn_checksum__md5_sha1_ctx_create(TRUE, scratch_pool);
+        SVN_ERR(svn_checksum__md5_sha1_update(ctx, data, len));
+        SVN_ERR(svn_checksum__md5_sha1_final(&checksum, &sha1, ctx,
+                                             scratch_pool));
+        *result = checksum->digest[0] + sha1->digest[0];
+        break;
+
+      default:
+        SVN_ERR_MALFUNCTION();
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Measure KERNEL over DATA in blocks of BLOCK_SIZE bytes with and without
+ * CPU-specific code and print the results. */
+static svn_error_t *
+bench_kernel(kernel_t kernel,
+             const svn_stringbuf_t *data,
+             apr_size_t block_size,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_size_t blocks = data->len / block_size;
+  apr_size_t repeat = VOLUME / (blocks * block_size) + 1;
+  double mb = (double)(repeat * blocks * block_size) / (1024.0 * 1024.0);
+  apr_time_t best[2];
+  int mode, i;
+
+  for (mode = 0; mode < 2; ++mode)
+    {
+      svn_cpu__set_features_mask(mode == 0 ? ~(apr_uint32_t)0 : 0);
+      best[mode] = APR_INT64_MAX;
+
+      for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+        {
+          apr_time_t start = apr_time_now();
+          apr_time_t usecs;
+          apr_size_t k, b;
+
+          for (k = 0; k < repeat; ++k)
+            {
+              svn_pool_clear(iterpool);
+              for (b = 0; b < blocks; ++b)
+                {
+                  apr_uint32_t result;
+                  SVN_ERR(run_kernel(&result, kernel,
+                                     data->data + b * block_size,
+                                     block_size, iterpool));
+                  result_sink += result;
+                }
+            }
+
+          usecs = apr_time_now() - start;
+          if (usecs < best[mode])
+            best[mode] = usecs;
+        }
+    }
+
+  svn_cpu__set_features_mask(~(apr_uint32_t)0);
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%-26s %8" APR_SIZE_T_FMT " B"
+                             "  %8.1f MB/s  %8.1f MB/s (portable)\n",
+                             kernel_names[kernel], block_size,
+                             perf_bench__per_second(mb, best[0]),
+                             perf_bench__per_second(mb, best[1])));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__checksum(int argc, const char *argv[], apr_pool_t *pool)
+{
+  static const apr_size_t block_sizes[] = { 64, 4096, SYNTHETIC_SIZE };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_stringbuf_t *data;
+  int kernel;
+
+  SVN_ERR(perf_bench__print_cpu_features(pool));
+
+  if (argc > 0)
+    {
+      const char *path = svn_dirent_internal_style(argv[0], pool);
+      SVN_ERR(svn_stringbuf_from_file2(&data, path, pool));
+    }
+  else
+    {
+      data = perf_bench__random_data(SYNTHETIC_SIZE, 42, pool);
+    }
+
+  for (kernel = 0; kernel < kernel_count; ++kernel)
+    {
+      int i;
+      for (i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); ++i)
+        {
+          svn_pool_clear(iterpool);
+          if (block_sizes[i] <= data->len)
+            SVN_ERR(bench_kernel(kernel, data, block_sizes[i], iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,225 @@
+/*
+ * compose.c:  measure the composition of delta chains
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench compose [FILE...]
+ *
+ * Simulate the history of each FILE as a chain of CHAIN_LENGTH deltas,
+ * each one applying a few random edits to the previous version.  Then
+ * report how many chains per second can be combined into a single
+ * delta, once by folding them with svn_txdelta_compose_windows() and
+ * once with svn_txdelta__compose_windows_n().  Only the first delta
+ * window of each FILE is used.  Without arguments, synthetic text and
+ * binary corpora are used instead.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_io.h"
+#include "svn_delta.h"
+
+#include "private/svn_delta_private.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Size of the generated corpora and maximum size of the files read.
+ * Larger data would not fit into a single delta window. */
+#define SYNTHETIC_SIZE (100 * 1024)
+
+/* Number of deltas per chain. */
+#define CHAIN_LENGTH 50
+
+/* Combine each chain this many times per measurement. */
+#define REPEAT 20
+
+/* Set *WINDOW to the first window of the delta from SOURCE to TARGET.
+ * Allocate it in POOL. */
+static svn_error_t *
+make_window(svn_txdelta_window_t **window,
+            svn_stringbuf_t *source,
+            svn_stringbuf_t *target,
+            apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *stream;
+
+  svn_txdelta2(&stream,
+               svn_stream_from_stringbuf(source, pool),
+               svn_stream_from_stringbuf(target, pool),
+               FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_next_window(window, stream, pool));
+}
+
+/* Return the result of folding WINDOWS with svn_txdelta_compose_windows().
+ * Allocate it in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+static svn_txdelta_window_t *
+compose_pairwise(const apr_array_header_t *windows,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pools[2];
+  svn_txdelta_window_t *composite;
+  int current = 0;
+  int i;
+
+  pools[0] = svn_pool_create(scratch_pool);
+  pools[1] = svn_pool_create(scratch_pool);
+
+  composite = APR_ARRAY_IDX(windows, windows->nelts - 1,
+                            svn_txdelta_window_t *);
+  for (i = windows->nelts - 2; i >= 0; --i)
+    {
+      apr_pool_t *pool = result_pool;
+
+      if (composite->src_ops == 0)
+        break;
+
+      if (i > 0)
+        {
+          pool = pools[current];
+          svn_pool_clear(pool);
+          current = 1 - current;
+        }
+
+      composite = svn_txdelta_compose_windows(
+                    APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *),
+                    composite, pool);
+    }
+
+  return composite;
+}
+
+/* Return the target of WINDOW applied to SOURCE allocated in POOL. */
+static svn_stringbuf_t *
+apply_window(svn_txdelta_window_t *window,
+             const svn_stringbuf_t *source,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(window->tview_len,
+                                                        pool);
+  target->len = window->tview_len;
+  svn_txdelta_apply_instructions(window, source->data + window->sview_offset,
+                                 target->data, &target->len);
+  target->data[target->len] = '\0';
+
+  return target;
+}
+
+/* Benchmark the history of the corpus BASE called NAME and print the
+ * results.  Only the first SYNTHETIC_SIZE bytes of BASE are used.
+ * Implements perf_bench__corpus_func_t. */
+static svn_error_t *
+bench_corpus(const char *name,
+             svn_stringbuf_t *base,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *windows = apr_array_make(scratch_pool, CHAIN_LENGTH,
+                                               sizeof(svn_txdelta_window_t *));
+  svn_stringbuf_t *version;
+  svn_txdelta_window_t *composite = NULL;
+  apr_time_t best[2];
+  apr_uint32_t seed = 1234;
+  int mode, i, k;
+
+  if (base->len > SYNTHETIC_SIZE)
+    svn_stringbuf_chop(base, base->len - SYNTHETIC_SIZE);
+
+  version = base;
+  for (i = 0; i < CHAIN_LENGTH; ++i)
+    {
+      int edits = 1 + perf_bench__random(&seed) % 8;
+      svn_stringbuf_t *next = perf_bench__next_version(version, edits, &seed,
+                                                       scratch_pool);
+      svn_txdelta_window_t *window;
+
+      SVN_ERR(make_window(&window, version, next, scratch_pool));
+      APR_ARRAY_PUSH(windows, svn_txdelta_window_t *) = window;
+      version = next;
+    }
+
+  for (mode = 0; mode < 2; ++mode)
+    {
+      best[mode] = APR_INT64_MAX;
+      for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+        {
+          apr_time_t start = apr_time_now();
+          apr_time_t usecs;
+
+          for (k = 0; k < REPEAT; ++k)
+            {
+              svn_pool_clear(iterpool);
+              if (mode == 0)
+                composite = compose_pairwise(windows, iterpool, iterpool);
+              else
+                composite = svn_txdelta__compose_windows_n(windows, iterpool,
+                                                           iterpool);
+            }
+
+          usecs = apr_time_now() - start;
+          if (usecs < best[mode])
+            best[mode] = usecs;
+        }
+
+      /* Make sure that we actually reconstruct the latest version. */
+      if (!svn_stringbuf_compare(apply_window(composite, base, iterpool),
+                                 version))
+        return svn_error_createf(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                                 "Composite delta for %s is wrong", name);
+    }
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%-30s %3d deltas, %5d ops  %8.1f chains/s"
+                             "  %8.1f chains/s (bulk)\n",
+                             name, CHAIN_LENGTH, composite->num_ops,
+                             perf_bench__per_second(REPEAT, best[0]),
+                             perf_bench__per_second(REPEAT, best[1])));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__compose(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool;
+
+  if (argc > 0)
+    return svn_error_trace(perf_bench__run_files(argc, argv, bench_corpus,
+                                                 pool));
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(bench_corpus("synthetic text",
+                       perf_bench__text_corpus(SYNTHETIC_SIZE, iterpool),
+                       iterpool));
+  svn_pool_clear(iterpool);
+  SVN_ERR(bench_corpus("synthetic binary",
+                       perf_bench__binary_corpus(SYNTHETIC_SIZE, 16384,
+                                                 iterpool),
+                       iterpool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,237 @@
+/*
+ * compress.c:  compare the svndiff compression codecs
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench compress [FILE...]
+ *
+ * Compress each FILE in svndiff window sized blocks with zlib, LZ4 and,
+ * if available, zstd at various levels and report the compression ratio
+ * as well as the compression and decompression throughput in MB/s.
+ * Without arguments, synthetic text and binary corpora are used instead.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_sorts.h"
+
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Size of the generated corpora. */
+#define SYNTHETIC_SIZE (16 * 1024 * 1024)
+
+/* Size of the blocks to compress individually.  This is the size of
+ * a classic svndiff window. */
+#define BLOCK_SIZE (100 * 1024)
+
+/* The codecs to compare. */
+typedef enum codec_t
+{
+  codec_zlib,
+  codec_lz4,
+  codec_zstd
+} codec_t;
+
+/* A codec together with the compression level to use with it. */
+typedef struct method_t
+{
+  const char *name;
+  codec_t codec;
+  int level;
+} method_t;
+
+static const method_t methods[] =
+{
+  { "zlib-1",  codec_zlib, 1 },
+  { "zlib-5",  codec_zlib, SVN__COMPRESSION_ZLIB_DEFAULT },
+  { "zlib-9",  codec_zlib, SVN__COMPRESSION_ZLIB_MAX },
+  { "lz4",     codec_lz4,  0 },
+  { "zstd-1",  codec_zstd, SVN__COMPRESSION_ZSTD_MIN },
+  { "zstd-3",  codec_zstd, SVN__COMPRESSION_ZSTD_DEFAULT },
+  { "zstd-9",  codec_zstd, 9 },
+  { "zstd-19", codec_zstd, SVN__COMPRESSION_ZSTD_MAX }
+};
+
+/* Compress DATA of LEN bytes into OUT using METHOD. */
+static svn_error_t *
+compress(svn_stringbuf_t *out,
+         const char *data,
+         apr_size_t len,
+         const method_t *method)
+{
+  switch (method->codec)
+    {
+      case codec_zlib:
+        return svn__compress_zlib(data, len, out, method->level);
+      case codec_lz4:
+        return svn__compress_lz4(data, len, out);
+      default:
+        return svn__compress_zstd(data, len, out, method->level);
+    }
+}
+
+/* Decompress DATA of LEN bytes into OUT using METHOD. */
+static svn_error_t *
+decompress(svn_stringbuf_t *out,
+           const char *data,
+           apr_size_t len,
+           const method_t *method)
+{
+  switch (method->codec)
+    {
+      case codec_zlib:
+        return svn__decompress_zlib(data, len, out, BLOCK_SIZE);
+      case codec_lz4:
+        return svn__decompress_lz4(data, len, out, BLOCK_SIZE);
+      default:
+        return svn__decompress_zstd(data, len, out, BLOCK_SIZE);
+    }
+}
+
+/* Compress and decompress CORPUS block by block using METHOD.  Return the
+ * total compressed size in *PACKED and the time taken for either step in
+ * *COMPRESS_USECS and *DECOMPRESS_USECS, respectively. */
+static svn_error_t *
+run_method(apr_size_t *packed,
+           apr_time_t *compress_usecs,
+           apr_time_t *decompress_usecs,
+           const svn_stringbuf_t *corpus,
+           const method_t *method,
+           apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *blocks;
+  svn_stringbuf_t *unpacked = svn_stringbuf_create_ensure(BLOCK_SIZE,
+                                                          scratch_pool);
+  apr_size_t offset;
+  apr_time_t start;
+  int i;
+
+  blocks = apr_array_make(scratch_pool,
+                          (int)(corpus->len / BLOCK_SIZE + 1),
+                          sizeof(svn_stringbuf_t *));
+
+  *packed = 0;
+  start = apr_time_now();
+  for (offset = 0; offset < corpus->len; offset += BLOCK_SIZE)
+    {
+      apr_size_t len = MIN(BLOCK_SIZE, corpus->len - offset);
+      svn_stringbuf_t *block = svn_stringbuf_create_empty(scratch_pool);
+
+      SVN_ERR(compress(block, corpus->data + offset, len, method));
+      APR_ARRAY_PUSH(blocks, svn_stringbuf_t *) = block;
+      *packed += block->len;
+    }
+  *compress_usecs = apr_time_now() - start;
+
+  start = apr_time_now();
+  for (i = 0; i < blocks->nelts; ++i)
+    {
+      const svn_stringbuf_t *block = APR_ARRAY_IDX(blocks, i,
+                                                   svn_stringbuf_t *);
+      SVN_ERR(decompress(unpacked, block->data, block->len, method));
+    }
+  *decompress_usecs = apr_time_now() - start;
+
+  return SVN_NO_ERROR;
+}
+
+/* Benchmark all available methods on the corpus CORPUS called NAME and
+ * print the results.  Implements perf_bench__corpus_func_t. */
+static svn_error_t *
+bench_corpus(const char *name,
+             svn_stringbuf_t *corpus,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  double mb = (double)corpus->len / (1024.0 * 1024.0);
+  int m, i;
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool, "%s (%.1f MB):\n", name, mb));
+
+  for (m = 0; m < sizeof(methods) / sizeof(methods[0]); ++m)
+    {
+      const method_t *method = &methods[m];
+      apr_time_t best_compress = APR_INT64_MAX;
+      apr_time_t best_decompress = APR_INT64_MAX;
+      apr_size_t packed = 0;
+
+      if (method->codec == codec_zstd && !svn__zstd_available())
+        continue;
+
+      for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+        {
+          apr_time_t compress_usecs, decompress_usecs;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(run_method(&packed, &compress_usecs, &decompress_usecs,
+                             corpus, method, iterpool));
+          if (compress_usecs < best_compress)
+            best_compress = compress_usecs;
+          if (decompress_usecs < best_decompress)
+            best_decompress = decompress_usecs;
+        }
+
+      SVN_ERR(svn_cmdline_printf(scratch_pool,
+                                 "  %-8s %6.2f%%  %8.1f MB/s compress"
+                                 "  %8.1f MB/s decompress\n",
+                                 method->name,
+                                 100.0 * (double)packed
+                                       / (double)(corpus->len
+                                                  ? corpus->len : 1),
+                                 perf_bench__per_second(mb, best_compress),
+                                 perf_bench__per_second(mb,
+                                                        best_decompress)));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__compress(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool;
+
+  if (!svn__zstd_available())
+    SVN_ERR(svn_cmdline_printf(pool, "zstd support not compiled in\n"));
+
+  if (argc > 0)
+    return svn_error_trace(perf_bench__run_files(argc, argv, bench_corpus,
+                                                 pool));
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(bench_corpus("synthetic text",
+                       perf_bench__text_corpus(SYNTHETIC_SIZE, iterpool),
+                       iterpool));
+  svn_pool_clear(iterpool);
+  SVN_ERR(bench_corpus("synthetic binary",
+                       perf_bench__binary_corpus(SYNTHETIC_SIZE, 65536,
+                                                 iterpool),
+                       iterpool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
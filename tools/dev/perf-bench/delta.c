@@ -0,0 +1,162 @@
+/*
+ * delta.c:  measure the throughput of the xdelta engine
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench delta [FILE...]
+ *
+ * Deltify each FILE against a slightly modified copy of itself and report
+ * the throughput in MB/s, once with all CPU-specific code paths enabled
+ * and once with the portable implementation only.  Without arguments,
+ * synthetic text and binary corpora are used instead.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_io.h"
+#include "svn_delta.h"
+
+#include "private/svn_cpu.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Size of the generated corpora. */
+#define SYNTHETIC_SIZE (16 * 1024 * 1024)
+
+/* Return a copy of SOURCE with a number of random edits applied to it.
+ * Allocate the result in POOL. */
+static svn_stringbuf_t *
+make_target(const svn_stringbuf_t *source, apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_dup(source, pool);
+  apr_uint32_t seed = 1234;
+  apr_size_t edits = source->len / 4096 + 1;
+
+  while (edits-- && target->len)
+    {
+      apr_size_t pos = perf_bench__random(&seed) % target->len;
+      apr_size_t count = perf_bench__random(&seed) % 256;
+      if (edits % 2)
+        svn_stringbuf_remove(target, pos, count);
+      else
+        svn_stringbuf_insert(target, pos, source->data,
+                             count < source->len ? count : source->len);
+    }
+
+  return target;
+}
+
+/* Deltify TARGET against SOURCE and return the time taken in *USECS. */
+static svn_error_t *
+run_delta(apr_time_t *usecs,
+          const svn_stringbuf_t *source,
+          const svn_stringbuf_t *target,
+          apr_pool_t *scratch_pool)
+{
+  svn_txdelta_stream_t *stream;
+  svn_string_t source_str, target_str;
+  apr_time_t start;
+
+  source_str.data = source->data;
+  source_str.len = source->len;
+  target_str.data = target->data;
+  target_str.len = target->len;
+
+  start = apr_time_now();
+  svn_txdelta2(&stream,
+               svn_stream_from_string(&source_str, scratch_pool),
+               svn_stream_from_string(&target_str, scratch_pool),
+               FALSE, scratch_pool);
+  SVN_ERR(svn_txdelta_send_txstream(stream, svn_delta_noop_window_handler,
+                                    NULL, scratch_pool));
+  *usecs = apr_time_now() - start;
+
+  return SVN_NO_ERROR;
+}
+
+/* Benchmark the corpus SOURCE called NAME with and without CPU-specific
+ * code and print the results.  Implements perf_bench__corpus_func_t. */
+static svn_error_t *
+bench_corpus(const char *name,
+             svn_stringbuf_t *source,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *target = make_target(source, scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  double mb = (double)target->len / (1024.0 * 1024.0);
+  apr_time_t best[2];
+  int mode, i;
+
+  for (mode = 0; mode < 2; ++mode)
+    {
+      svn_cpu__set_features_mask(mode == 0 ? ~(apr_uint32_t)0 : 0);
+      best[mode] = APR_INT64_MAX;
+
+      for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+        {
+          apr_time_t usecs;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(run_delta(&usecs, source, target, iterpool));
+          if (usecs < best[mode])
+            best[mode] = usecs;
+        }
+    }
+
+  svn_cpu__set_features_mask(~(apr_uint32_t)0);
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%-30s %8.1f MB  %8.1f MB/s  %8.1f MB/s"
+                             " (portable)\n",
+                             name, mb,
+                             perf_bench__per_second(mb, best[0]),
+                             perf_bench__per_second(mb, best[1])));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__delta(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool;
+
+  SVN_ERR(perf_bench__print_cpu_features(pool));
+
+  if (argc > 0)
+    return svn_error_trace(perf_bench__run_files(argc, argv, bench_corpus,
+                                                 pool));
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(bench_corpus("synthetic text",
+                       perf_bench__text_corpus(SYNTHETIC_SIZE, iterpool),
+                       iterpool));
+  svn_pool_clear(iterpool);
+  SVN_ERR(bench_corpus("synthetic binary",
+                       perf_bench__binary_corpus(SYNTHETIC_SIZE, 65536,
+                                                 iterpool),
+                       iterpool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,255 @@
+/*
+ * diff.c:  compare the performance of the diff algorithms
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench diff [ORIGINAL MODIFIED]
+ *
+ * Report the time it takes to diff ORIGINAL against MODIFIED with the
+ * default (Myers) and with the histogram algorithm, together with the
+ * number of changed lines found by each of them.  Without arguments,
+ * run on a set of generated inputs that are known to be hard for the
+ * Myers algorithm.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_diff.h"
+#include "svn_utf.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Number of lines in the generated inputs. */
+#define SYNTHETIC_LINES 50000
+
+/* The kinds of generated inputs. */
+typedef enum input_t
+{
+  /* Long runs of the same few lines, e.g. generated tables, with
+   * scattered changes. */
+  input_repeated,
+
+  /* Records starting with a unique key followed by lines from a small
+   * set, with every fifth record changed. */
+  input_records,
+
+  /* A file where every line got replaced. */
+  input_rewritten,
+
+  input_count
+} input_t;
+
+/* Names of the inputs, indexed by input_t. */
+static const char *input_names[input_count] =
+  {
+    "repeated lines",
+    "records",
+    "rewritten"
+  };
+
+/* Set *ORIGINAL and *MODIFIED to the generated input INPUT, allocated
+ * in RESULT_POOL. */
+static void
+make_input(svn_string_t **original,
+           svn_string_t **modified,
+           input_t input,
+           apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *text[2];
+  apr_uint32_t seed = 42;
+  int i;
+
+  text[0] = svn_stringbuf_create_empty(result_pool);
+  text[1] = svn_stringbuf_create_empty(result_pool);
+
+  for (i = 0; i < SYNTHETIC_LINES; ++i)
+    {
+      const char *line;
+      const char *changed_line;
+
+      switch (input)
+        {
+          case input_repeated:
+            line = apr_psprintf(result_pool, "%d\n", i % 3);
+            changed_line = perf_bench__random(&seed) % 50
+                         ? line
+                         : apr_psprintf(result_pool, "%d\n",
+                                        perf_bench__random(&seed) % 5);
+            break;
+
+          case input_records:
+            if (i % 6 == 0)
+              line = changed_line = apr_psprintf(result_pool, "key %d\n", i);
+            else
+              {
+                line = apr_psprintf(result_pool, "value %d\n",
+                                    perf_bench__random(&seed) % 4);
+                changed_line = (i / 6) % 5
+                             ? line
+                             : apr_psprintf(result_pool, "value %d\n",
+                                            perf_bench__random(&seed) % 4);
+              }
+            break;
+
+          default:
+            line = apr_psprintf(result_pool, "%d\n",
+                                perf_bench__random(&seed) % 7);
+            changed_line = apr_psprintf(result_pool, "new %d\n",
+                                        perf_bench__random(&seed) % 7);
+            break;
+        }
+
+      svn_stringbuf_appendcstr(text[0], line);
+      svn_stringbuf_appendcstr(text[1], changed_line);
+    }
+
+  *original = svn_string_create_from_buf(text[0], result_pool);
+  *modified = svn_string_create_from_buf(text[1], result_pool);
+}
+
+/* Set *COUNT to the number of lines in ORIGINAL and MODIFIED that are
+ * not part of common ranges in DIFF.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+count_changes(apr_off_t *count,
+              svn_diff_t *diff,
+              const svn_string_t *original,
+              const svn_string_t *modified,
+              apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *output = svn_stringbuf_create_empty(scratch_pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(output, scratch_pool);
+  apr_size_t i;
+
+  /* Count the removed and added lines of the unified diff. */
+  SVN_ERR(svn_diff_mem_string_output_unified3(stream, diff, FALSE, NULL,
+                                              NULL, NULL,
+                                              SVN_APR_LOCALE_CHARSET,
+                                              original, modified, 0,
+                                              NULL, NULL, scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  *count = 0;
+  for (i = 0; i + 1 < output->len; ++i)
+    if (output->data[i] == '\n'
+        && (output->data[i + 1] == '+' || output->data[i + 1] == '-'))
+      ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+/* Diff ORIGINAL against MODIFIED with both algorithms and print the
+ * results under NAME. */
+static svn_error_t *
+bench_input(const char *name,
+            const svn_string_t *original,
+            const svn_string_t *modified,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_diff_file_options_t *options
+    = svn_diff_file_options_create(scratch_pool);
+  apr_time_t best[2];
+  apr_off_t changes[2];
+  int mode, i;
+
+  for (mode = 0; mode < 2; ++mode)
+    {
+      options->histogram = (mode == 1);
+      best[mode] = APR_INT64_MAX;
+
+      for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+        {
+          svn_diff_t *diff;
+          apr_time_t start = apr_time_now();
+          apr_time_t usecs;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_diff_mem_string_diff(&diff, original, modified,
+                                           options, iterpool));
+
+          usecs = apr_time_now() - start;
+          if (usecs < best[mode])
+            best[mode] = usecs;
+
+          SVN_ERR(count_changes(&changes[mode], diff, original, modified,
+                                iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%-16s Myers %9.3f s %8" APR_OFF_T_FMT
+                             " lines  histogram %9.3f s %8" APR_OFF_T_FMT
+                             " lines\n",
+                             name,
+                             (double)best[0] / 1e6, changes[0],
+                             (double)best[1] / 1e6, changes[1]));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__diff(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool;
+  svn_string_t *original;
+  svn_string_t *modified;
+  int input;
+
+  if (argc > 1)
+    {
+      svn_stringbuf_t *contents[2];
+
+      SVN_ERR(svn_stringbuf_from_file2(&contents[0],
+                                       svn_dirent_internal_style(argv[0],
+                                                                 pool),
+                                       pool));
+      SVN_ERR(svn_stringbuf_from_file2(&contents[1],
+                                       svn_dirent_internal_style(argv[1],
+                                                                 pool),
+                                       pool));
+
+      original = svn_string_create_from_buf(contents[0], pool);
+      modified = svn_string_create_from_buf(contents[1], pool);
+
+      return svn_error_trace(bench_input(svn_dirent_basename(argv[0], pool),
+                                         original, modified, pool));
+    }
+
+  iterpool = svn_pool_create(pool);
+  for (input = 0; input < input_count; ++input)
+    {
+      svn_pool_clear(iterpool);
+
+      make_input(&original, &modified, input, iterpool);
+      SVN_ERR(bench_input(input_names[input], original, modified, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,138 @@
+/*
+ * perf-bench.c:  micro-benchmarks for the delta, diff and checksum code
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench SUBCOMMAND [ARGS...]
+ *
+ * Run the micro-benchmark SUBCOMMAND and print its results.  Every
+ * measurement is repeated PERF_BENCH__ROUNDS times and the best one gets
+ * reported.  Without ARGS, the subcommands work on generated inputs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* A subcommand with its name and its usage text. */
+typedef struct cmd_desc_t
+{
+  const char *name;
+  perf_bench__cmd_t func;
+  const char *help;
+} cmd_desc_t;
+
+static const cmd_desc_t cmd_table[] =
+{
+  { "delta", perf_bench__delta,
+    "delta [FILE...]\n"
+    "  Deltify each FILE against a slightly modified copy of itself and\n"
+    "  report the throughput in MB/s, once with all CPU-specific code\n"
+    "  paths enabled and once with the portable implementation only.\n" },
+
+  { "compress", perf_bench__compress,
+    "compress [FILE...]\n"
+    "  Compress each FILE in svndiff window sized blocks with zlib, LZ4\n"
+    "  and, if available, zstd at various levels and report the\n"
+    "  compression ratio as well as the compression and decompression\n"
+    "  throughput in MB/s.\n" },
+
+  { "svndiff", perf_bench__svndiff,
+    "svndiff [FILE...]\n"
+    "  Turn each FILE into txdelta windows and report the throughput in\n"
+    "  MB/s of encoding them as compressed svndiff with 1, 2, 4 and 8\n"
+    "  threads.  Only the encoding is measured, not the deltification.\n" },
+
+  { "compose", perf_bench__compose,
+    "compose [FILE...]\n"
+    "  Simulate the history of each FILE as a chain of deltas and report\n"
+    "  how many chains per second can be combined into a single delta,\n"
+    "  once pairwise and once in bulk.\n" },
+
+  { "apply", perf_bench__apply,
+    "apply [FILE...]\n"
+    "  Report the throughput in MB of target data per second of applying\n"
+    "  delta windows with svn_txdelta_apply_instructions() and with\n"
+    "  svn_txdelta__apply_window().\n" },
+
+  { "checksum", perf_bench__checksum,
+    "checksum [FILE]\n"
+    "  Report the throughput in MB/s of the checksum functions for blocks\n"
+    "  of various sizes, once with all CPU-specific code paths enabled\n"
+    "  and once with the portable implementation only.\n" },
+
+  { "diff", perf_bench__diff,
+    "diff [ORIGINAL MODIFIED]\n"
+    "  Report the time it takes to diff ORIGINAL against MODIFIED with the\n"
+    "  Myers and with the histogram algorithm, together with the number\n"
+    "  of changed lines found by each of them.\n" },
+
+  { NULL }
+};
+
+/* Print the usage text of all subcommands to STDERR. */
+static svn_error_t *
+print_usage(apr_pool_t *pool)
+{
+  const cmd_desc_t *cmd;
+
+  SVN_ERR(svn_cmdline_fputs("usage: perf-bench SUBCOMMAND [ARGS...]\n"
+                            "Without ARGS, generated inputs are used.\n"
+                            "\n"
+                            "Available subcommands:\n",
+                            stderr, pool));
+  for (cmd = cmd_table; cmd->name; ++cmd)
+    SVN_ERR(svn_cmdline_fprintf(stderr, pool, "\n%s", cmd->help));
+
+  return SVN_NO_ERROR;
+}
+
+int main (int argc, const char *argv[])
+{
+  apr_pool_t *pool = NULL;
+  const cmd_desc_t *cmd;
+  svn_error_t *err;
+
+  apr_initialize();
+  atexit(apr_terminate);
+
+  pool = svn_pool_create(NULL);
+
+  for (cmd = cmd_table; cmd->name; ++cmd)
+    if (argc > 1 && strcmp(argv[1], cmd->name) == 0)
+      break;
+
+  if (cmd->name)
+    err = cmd->func(argc - 2, argv + 2, pool);
+  else
+    err = print_usage(pool);
+
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "perf-bench: ");
+
+  return cmd->name ? EXIT_SUCCESS : EXIT_FAILURE;
+}
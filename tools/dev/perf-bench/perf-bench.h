@@ -0,0 +1,150 @@
+/*
+ * perf-bench.h:  shared declarations of the perf-bench subcommands
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef PERF_BENCH_H
+#define PERF_BENCH_H
+
+#include <apr_tables.h>
+#include <apr_time.h>
+
+#include "svn_types.h"
+#include "svn_string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/*** Command dispatch. ***/
+
+/* Run a subcommand with its ARGC arguments ARGV, i.e. without the program
+ * and subcommand names.  Use POOL for all allocations. */
+typedef svn_error_t *(*perf_bench__cmd_t)(int argc,
+                                          const char *argv[],
+                                          apr_pool_t *pool);
+
+/* Measure the throughput of the xdelta engine. */
+svn_error_t *
+perf_bench__delta(int argc, const char *argv[], apr_pool_t *pool);
+
+/* Compare the svndiff compression codecs. */
+svn_error_t *
+perf_bench__compress(int argc, const char *argv[], apr_pool_t *pool);
+
+/* Measure the svndiff encoder throughput per thread count. */
+svn_error_t *
+perf_bench__svndiff(int argc, const char *argv[], apr_pool_t *pool);
+
+/* Measure the composition of delta chains. */
+svn_error_t *
+perf_bench__compose(int argc, const char *argv[], apr_pool_t *pool);
+
+/* Measure the application of delta windows. */
+svn_error_t *
+perf_bench__apply(int argc, const char *argv[], apr_pool_t *pool);
+
+/* Measure the throughput of the checksum functions. */
+svn_error_t *
+perf_bench__checksum(int argc, const char *argv[], apr_pool_t *pool);
+
+/* Compare the performance of the diff algorithms. */
+svn_error_t *
+perf_bench__diff(int argc, const char *argv[], apr_pool_t *pool);
+
+
+/*** Shared helpers, see util.c. ***/
+
+/* Repeat each measurement this many times and report the best one. */
+#define PERF_BENCH__ROUNDS 3
+
+/* Return the next value of a simple LCG, good enough for generating test
+ * data, and update *SEED accordingly. */
+apr_uint32_t
+perf_bench__random(apr_uint32_t *seed);
+
+/* Return SIZE random bytes generated from SEED, allocated in POOL. */
+svn_stringbuf_t *
+perf_bench__random_data(apr_size_t size,
+                        apr_uint32_t seed,
+                        apr_pool_t *pool);
+
+/* Return a text-like corpus of SIZE bytes allocated in POOL. */
+svn_stringbuf_t *
+perf_bench__text_corpus(apr_size_t size,
+                        apr_pool_t *pool);
+
+/* Return a binary corpus of SIZE bytes allocated in POOL.  After the
+ * first RANDOM_PREFIX bytes, it consists of random bytes interspersed with
+ * repeated blocks, like in typical object files and archives. */
+svn_stringbuf_t *
+perf_bench__binary_corpus(apr_size_t size,
+                          apr_size_t random_prefix,
+                          apr_pool_t *pool);
+
+/* Return a copy of SOURCE with EDITS random edits of up to 128 bytes
+ * each applied to it, using and updating *SEED.  Allocate the result in
+ * POOL. */
+svn_stringbuf_t *
+perf_bench__next_version(const svn_stringbuf_t *source,
+                         int edits,
+                         apr_uint32_t *seed,
+                         apr_pool_t *pool);
+
+/* Append copies of the windows of the delta from SOURCE to TARGET to
+ * WINDOWS, allocated in the pool of WINDOWS.  Use SCRATCH_POOL for
+ * temporary allocations. */
+svn_error_t *
+perf_bench__collect_windows(apr_array_header_t *windows,
+                            svn_stringbuf_t *source,
+                            svn_stringbuf_t *target,
+                            apr_pool_t *scratch_pool);
+
+/* Return AMOUNT per second, given that it took USECS microseconds. */
+double
+perf_bench__per_second(double amount,
+                       apr_time_t usecs);
+
+/* Print the CPU features that svn_cpu__features() reports.  Use
+ * SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+perf_bench__print_cpu_features(apr_pool_t *scratch_pool);
+
+/* Benchmark a corpus CORPUS called NAME.  Use SCRATCH_POOL for temporary
+ * allocations. */
+typedef svn_error_t *(*perf_bench__corpus_func_t)(const char *name,
+                                                  svn_stringbuf_t *corpus,
+                                                  apr_pool_t *scratch_pool);
+
+/* Call BENCH_CORPUS for the contents of each of the ARGC files in ARGV.
+ * Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+perf_bench__run_files(int argc,
+                      const char *argv[],
+                      perf_bench__corpus_func_t bench_corpus,
+                      apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* PERF_BENCH_H */
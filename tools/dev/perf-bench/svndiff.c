@@ -0,0 +1,175 @@
+/*
+ * svndiff.c:  measure the svndiff encoder throughput per thread count
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Usage: perf-bench svndiff [FILE...]
+ *
+ * Turn each FILE into txdelta windows and report the throughput in MB/s
+ * of encoding them as compressed svndiff with 1, 2, 4 and 8 threads.
+ * Only the encoding is measured, not the deltification.  Without
+ * arguments, a synthetic text corpus is used instead.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_io.h"
+#include "svn_delta.h"
+
+#include "private/svn_delta_private.h"
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+/* Size of the generated corpus. */
+#define SYNTHETIC_SIZE (32 * 1024 * 1024)
+
+/* An svndiff format together with the compression level to use. */
+typedef struct format_t
+{
+  const char *name;
+  int version;
+  int level;
+} format_t;
+
+static const format_t formats[] =
+{
+  { "svndiff1 (zlib-5)",  1, SVN__COMPRESSION_ZLIB_DEFAULT },
+  { "svndiff2 (lz4)",     2, 0 },
+  { "svndiff4 (zstd-3)",  4, SVN__COMPRESSION_ZSTD_DEFAULT }
+};
+
+static const int thread_counts[] = { 1, 2, 4, 8 };
+
+/* Encode WINDOWS in FORMAT using THREAD_COUNT threads.  Return the
+ * encoded data in *OUTPUT and the time taken in *USECS.  Allocate the
+ * result in RESULT_POOL. */
+static svn_error_t *
+run_encoder(svn_stringbuf_t **output,
+            apr_time_t *usecs,
+            const apr_array_header_t *windows,
+            const format_t *format,
+            int thread_count,
+            apr_pool_t *result_pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  apr_time_t start;
+  int i;
+
+  *output = svn_stringbuf_create_empty(result_pool);
+
+  start = apr_time_now();
+  svn_txdelta__to_svndiff_parallel(&handler, &handler_baton,
+                                   svn_stream_from_stringbuf(*output,
+                                                             result_pool),
+                                   format->version, format->level, NULL,
+                                   thread_count, result_pool);
+  for (i = 0; i < windows->nelts; ++i)
+    SVN_ERR(handler(APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *),
+                    handler_baton));
+  SVN_ERR(handler(NULL, handler_baton));
+  *usecs = apr_time_now() - start;
+
+  return SVN_NO_ERROR;
+}
+
+/* Benchmark the corpus CORPUS called NAME with all formats and thread
+ * counts and print the results.  Implements perf_bench__corpus_func_t. */
+static svn_error_t *
+bench_corpus(const char *name,
+             svn_stringbuf_t *corpus,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *windows = apr_array_make(scratch_pool, 16,
+                                               sizeof(svn_txdelta_window_t *));
+  double mb = (double)corpus->len / (1024.0 * 1024.0);
+  int f, t, i;
+
+  /* Deltify against an empty source once, such that we only measure the
+   * encoder later on. */
+  SVN_ERR(perf_bench__collect_windows(windows,
+                                      svn_stringbuf_create_empty(
+                                        scratch_pool),
+                                      corpus, scratch_pool));
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool, "%s (%.1f MB, %d windows):\n",
+                             name, mb, windows->nelts));
+
+  for (f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+    {
+      const format_t *format = &formats[f];
+      svn_stringbuf_t *reference = NULL;
+
+      if (format->version == 4 && !svn__zstd_available())
+        continue;
+
+      for (t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t)
+        {
+          apr_time_t best = APR_INT64_MAX;
+          svn_stringbuf_t *output = NULL;
+
+          for (i = 0; i < PERF_BENCH__ROUNDS; ++i)
+            {
+              apr_time_t usecs;
+
+              svn_pool_clear(iterpool);
+              SVN_ERR(run_encoder(&output, &usecs, windows, format,
+                                  thread_counts[t], iterpool));
+              if (usecs < best)
+                best = usecs;
+            }
+
+          /* All thread counts must produce the same data. */
+          if (reference == NULL)
+            reference = svn_stringbuf_dup(output, scratch_pool);
+          else if (!svn_stringbuf_compare(reference, output))
+            return svn_error_createf(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                                     "Output of %s differs with %d threads",
+                                     format->name, thread_counts[t]);
+
+          SVN_ERR(svn_cmdline_printf(scratch_pool,
+                                     "  %-18s %2d threads  %8.1f MB/s\n",
+                                     format->name, thread_counts[t],
+                                     perf_bench__per_second(mb, best)));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__svndiff(int argc, const char *argv[], apr_pool_t *pool)
+{
+  if (argc > 0)
+    return svn_error_trace(perf_bench__run_files(argc, argv, bench_corpus,
+                                                 pool));
+
+  return svn_error_trace(bench_corpus("synthetic text",
+                                      perf_bench__text_corpus(SYNTHETIC_SIZE,
+                                                              pool),
+                                      pool));
+}
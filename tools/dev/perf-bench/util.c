@@ -0,0 +1,197 @@
+/*
+ * util.c:  helpers shared by the perf-bench subcommands
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_delta.h"
+#include "svn_sorts.h"
+
+#include "private/svn_cpu.h"
+
+#include "svn_private_config.h"
+
+#include "perf-bench.h"
+
+apr_uint32_t
+perf_bench__random(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+svn_stringbuf_t *
+perf_bench__random_data(apr_size_t size,
+                        apr_uint32_t seed,
+                        apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(size, pool);
+
+  while (result->len < size)
+    svn_stringbuf_appendbyte(result, (char)perf_bench__random(&seed));
+
+  return result;
+}
+
+svn_stringbuf_t *
+perf_bench__text_corpus(apr_size_t size,
+                        apr_pool_t *pool)
+{
+  static const char *words[] = { "static ", "int ", "return ", "svn_error_t ",
+                                 "*", "pool", "(", ")", ";\n", "  ", "if ",
+                                 "{\n", "}\n", "SVN_ERR", "apr_size_t ",
+                                 "const char ", "len", "= ", "0", ", " };
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(size, pool);
+  apr_uint32_t seed = 42;
+
+  while (result->len < size)
+    svn_stringbuf_appendcstr(result,
+                             words[perf_bench__random(&seed)
+                                   % (sizeof(words) / sizeof(words[0]))]);
+
+  return result;
+}
+
+svn_stringbuf_t *
+perf_bench__binary_corpus(apr_size_t size,
+                          apr_size_t random_prefix,
+                          apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(size, pool);
+  apr_uint32_t seed = 4711;
+
+  while (result->len < size)
+    {
+      apr_size_t count = 64 + perf_bench__random(&seed) % 4096;
+      if (result->len > random_prefix && perf_bench__random(&seed) % 4 == 0)
+        {
+          apr_size_t from = perf_bench__random(&seed) % (result->len - count);
+          svn_stringbuf_appendbytes(result, result->data + from, count);
+        }
+      else
+        while (count--)
+          svn_stringbuf_appendbyte(result, (char)perf_bench__random(&seed));
+    }
+
+  return result;
+}
+
+svn_stringbuf_t *
+perf_bench__next_version(const svn_stringbuf_t *source,
+                         int edits,
+                         apr_uint32_t *seed,
+                         apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_dup(source, pool);
+
+  while (edits-- && target->len)
+    {
+      apr_size_t pos = perf_bench__random(seed) % target->len;
+      apr_size_t count = perf_bench__random(seed) % 128;
+      if (edits % 2)
+        svn_stringbuf_remove(target, pos, count);
+      else
+        svn_stringbuf_insert(target, pos, source->data + pos,
+                             MIN(count, source->len - pos));
+    }
+
+  return target;
+}
+
+/* Implements svn_txdelta_window_handler_t.  Append a copy of WINDOW to
+ * the apr_array_header_t * BATON. */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window, void *baton)
+{
+  apr_array_header_t *windows = baton;
+
+  if (window)
+    APR_ARRAY_PUSH(windows, svn_txdelta_window_t *)
+      = svn_txdelta_window_dup(window, windows->pool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+perf_bench__collect_windows(apr_array_header_t *windows,
+                            svn_stringbuf_t *source,
+                            svn_stringbuf_t *target,
+                            apr_pool_t *scratch_pool)
+{
+  svn_txdelta_stream_t *stream;
+
+  svn_txdelta2(&stream,
+               svn_stream_from_stringbuf(source, scratch_pool),
+               svn_stream_from_stringbuf(target, scratch_pool),
+               FALSE, scratch_pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(stream, collect_window,
+                                                   windows, scratch_pool));
+}
+
+double
+perf_bench__per_second(double amount,
+                       apr_time_t usecs)
+{
+  return amount * 1e6 / (double)(usecs ? usecs : 1);
+}
+
+svn_error_t *
+perf_bench__print_cpu_features(apr_pool_t *scratch_pool)
+{
+  apr_uint32_t features = svn_cpu__features();
+
+  return svn_error_trace(
+           svn_cmdline_printf(scratch_pool, "CPU features:%s%s%s%s\n",
+                              features & SVN_CPU__SSE2 ? " SSE2" : "",
+                              features & SVN_CPU__SSSE3 ? " SSSE3" : "",
+                              features & SVN_CPU__AVX2 ? " AVX2" : "",
+                              features & SVN_CPU__SHA ? " SHA" : ""));
+}
+
+svn_error_t *
+perf_bench__run_files(int argc,
+                      const char *argv[],
+                      perf_bench__corpus_func_t bench_corpus,
+                      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < argc; ++i)
+    {
+      const char *path;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      path = svn_dirent_internal_style(argv[i], iterpool);
+      SVN_ERR(svn_stringbuf_from_file2(&contents, path, iterpool));
+      SVN_ERR(bench_corpus(svn_dirent_basename(path, iterpool), contents,
+                           iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}